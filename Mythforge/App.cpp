@@ -2,8 +2,15 @@
 #include "App.h"
 
 #include <ppltasks.h>
+#include <fstream>
+#include <sstream>
 #include "Renderer.h"
 #include "DeviceUtils.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "MemoryTracker.h"
+#include "AllocationTracker.h"
+#include "CommandCapture.h"
 
 using namespace Mythforge;
 
@@ -19,6 +26,9 @@ using namespace Windows::Graphics::Display;
 
 using Microsoft::WRL::ComPtr;
 
+// Fotogramas de calentamiento tras los que el bucle no debera volver a asignar memoria dinmica.
+static const uint64_t AllocationWarmupFrames = 120;
+
 // La plantilla de la aplicacin DirectX 12 est documentada en https://go.microsoft.com/fwlink/?LinkID=613670&clcid=0x409
 
 // La funcin principal solo se utiliza para inicializar nuestra clase IFrameworkView.
@@ -46,40 +56,195 @@ App::App() :
 void App::Run()
 {
 	auto Destroy = [this]() -> void {
+		simulation->Stop();
+		startup.reset();
+		uploads.reset();
 		cube->Destroy();
 		renderer->Destroy();
 	};
 
+	Profiler::SetThreadName("Main");
+
+	// Desde aqu el renderer es del hilo de render: Run prepara los paquetes y RenderFrame los graba.
+	renderThread = std::make_shared<RenderThread>(static_cast<uint32_t>(_countof(framePackets)), [this](uint32_t packet) {
+		RenderFrame(framePackets[packet]);
+	});
+
 	while (!m_windowClosed)
 	{
 		if (m_windowVisible)
 		{
+			PROFILE_SCOPE("Frame");
+			// Un recurso del arranque que no se pudo cargar termina la aplicacin, como antes lo haca la carga sncrona.
+			startup->ThrowIfFailed();
+
+			// Si el hilo de render va un fotograma por detrs, se espera aqu, antes de leer la entrada.
+			uint32_t packetIndex = renderThread->Acquire();
+			FramePacket& packet = framePackets[packetIndex];
+			if (packet.statusReady)
+			{
+				Windows::UI::ViewManagement::ApplicationView::GetForCurrentView()->Title = ref new Platform::String(packet.status);
+				packet.statusReady = false;
+			}
+
+			timer.Tick([]() {});
+
 			CoreWindow::GetForCurrentThread()->Dispatcher->ProcessEvents(CoreProcessEventsOption::ProcessAllIfPresent);
 
-			renderer->ResetCommands();
+			// Desde aqu hasta Submit se cuentan las asignaciones de la preparacin del paquete, de todos los hilos.
+			AllocationScope allocationScope("Frame");
+			AllocationCounters frameAllocationStart = AllocationTracker::Totals();
+			packet.arena.Reset();
+			packet.frame = timer.GetFrameCount();
+			packet.requests = pendingRequests;
+			pendingRequests = RenderRequests();
 
-			PIXBeginEvent(renderer->commandQueue.Get(), 0, L"Render");
-			{
-				renderer->SetRenderTargets();
+			XMMATRIX view = XMMatrixLookToRH(cameraPos, cameraFw, up);
+			XMMATRIX viewProjection = XMMatrixMultiply(view, Renderer::Projection(outputSize));
+			XMStoreFloat4x4(&packet.viewProjection, viewProjection);
 
-				XMMATRIX view = XMMatrixLookToRH(cameraPos, cameraFw, up);
-				XMMATRIX viewProjection = XMMatrixMultiply(view, renderer->perspectiveMatrix);
+			// La simulacin avanza en su hilo; aqu solo se interpola su estado para el instante actual.
+			simulation->Interpolate(static_cast<int64_t>(Profiler::TimestampToMicroseconds(Profiler::Now())), frameTransforms);
+			BuildDrawPackets(world, frameTransforms.data(), viewProjection, sceneCulling, packet.arena, packet.drawList);
+			SortDrawPackets(packet.drawList, packet.drawQueue, *jobSystem);
 
-				cube->UpdateConstantBuffer(renderer->backBufferIndex, viewProjection);
-				cube->Render(renderer->commandList, renderer->backBufferIndex);
+			packet.allocations = AllocationTracker::Totals() - frameAllocationStart;
 
-				renderer->Present();
+			// Pasado el calentamiento, un fotograma que asigna es una regresin: se avisa del primero.
+			if (packet.allocations.allocations > 0 && timer.GetFrameCount() > AllocationWarmupFrames && !steadyAllocationReported)
+			{
+				char message[160];
+				snprintf(message, sizeof(message), "Fotograma %llu: %llu asignaciones (%llu bytes) en el bucle estable\n",
+					static_cast<unsigned long long>(timer.GetFrameCount()),
+					static_cast<unsigned long long>(packet.allocations.allocations),
+					static_cast<unsigned long long>(packet.allocations.bytes));
+				OutputDebugStringA(message);
+				steadyAllocationReported = true;
 			}
-			PIXEndEvent(renderer->commandQueue.Get());
 
+			renderThread->Submit(packetIndex);
 		}
 		else
 		{
 			CoreWindow::GetForCurrentThread()->Dispatcher->ProcessEvents(CoreProcessEventsOption::ProcessOneAndAllPending);
 		}
 	}
+	renderThread->Stop();
 	Flush(renderer->commandQueue, renderer->fence, renderer->fenceValue, renderer->fenceEvent);
 	Destroy();
+
+	// Lo que siga registrado tras destruir la escena y el renderer no se ha liberado.
+	std::ostringstream leaks;
+	if (MemoryTracker::WriteLeakReport(leaks) > 0)
+	{
+		OutputDebugStringA(leaks.str().c_str());
+	}
+}
+
+// Graba y presenta un paquete. Se llama en el hilo de render, el nico que toca el renderer mientras Run est en marcha.
+void App::RenderFrame(FramePacket& packet)
+{
+	PROFILE_SCOPE("RenderFrame");
+	const RenderRequests& requests = packet.requests;
+	if (requests.resize)
+	{
+		renderer->Resize(requests.outputSize.width, requests.outputSize.height);
+	}
+	if (requests.toggleDynamicResolution)
+	{
+		ResolutionController& resolution = renderer->resolutionController;
+		resolution.SetEnabled(!resolution.IsEnabled());
+	}
+	if (requests.pacingModeSteps > 0)
+	{
+		FramePacer& pacer = renderer->framePacer;
+		uint32_t modeCount = static_cast<uint32_t>(FramePacingMode::Count);
+		pacer.SetMode(static_cast<FramePacingMode>((static_cast<uint32_t>(pacer.Mode()) + requests.pacingModeSteps) % modeCount));
+		pacer.ResetStats();
+	}
+	if (requests.toggleStateFiltering)
+	{
+		renderer->commandContext.SetStateFiltering(!renderer->commandContext.IsStateFiltering());
+	}
+	if (requests.captureFrames > 0)
+	{
+		CommandCapture::Start(requests.captureFrames);
+	}
+
+	// Se mira antes de grabar: si ya estaba, este fotograma dibuja la escena.
+	bool sceneResident = startup->RequiredReady();
+
+	// La espera del FramePacer retrasa la grabacin; el hilo de juego ya ley la entrada al preparar el paquete.
+	renderer->WaitForFrameStart();
+
+	// Cada dibujado usa su propia copia de las constantes; si no caben, se agranda el anillo con la GPU parada.
+	if (!cube->HasDrawCapacity(packet.drawQueue.Count()))
+	{
+		renderer->WaitForGpu();
+		cube->ReserveDraws(packet.drawQueue.Count());
+	}
+	renderer->ResetCommands();
+
+	PIXBeginEvent(renderer->commandQueue.Get(), 0, L"Render");
+	{
+		renderer->SetRenderTargets();
+
+		XMMATRIX viewProjection = XMLoadFloat4x4(&packet.viewProjection);
+		{
+			PROFILE_GPU_SCOPE(renderer->gpuProfiler, renderer->commandList.Get(), "Draw Packets");
+			RenderStatsPass statsPass("Draw Packets");
+			UINT drawIndex = 0;
+			for (const DrawQueueItem& item : packet.drawQueue)
+			{
+				const DrawPacket& drawPacket = packet.drawList.packets[item.value];
+				drawPacket.mesh->UpdateConstantBuffer(renderer->backBufferIndex, drawIndex, XMLoadFloat4x4(&drawPacket.world), viewProjection);
+				drawPacket.mesh->Render(renderer->commandContext, renderer->backBufferIndex, drawIndex);
+				drawIndex++;
+			}
+		}
+
+		renderer->Present();
+		if (sceneResident)
+		{
+			startup->OnScenePresented();
+		}
+
+		RenderStats::Add(RenderCounter::CpuAllocations, packet.allocations.allocations);
+		RenderStats::Add(RenderCounter::CpuAllocatedBytes, packet.allocations.bytes);
+		RenderStats::EndFrame();
+	}
+	PIXEndEvent(renderer->commandQueue.Get());
+
+	if (!startupReported && startup->Stats().Complete())
+	{
+		std::ostringstream report;
+		startup->WriteReport(report);
+		OutputDebugStringA(report.str().c_str());
+		startupReported = true;
+	}
+
+	// Una vez por segundo, los contadores del ltimo fotograma se dejan en el paquete; Run los pone en la barra de ttulo.
+	if (packet.frame % 60 == 0)
+	{
+		size_t length = RenderStats::FormatSummary(packet.status, _countof(packet.status));
+		const FramePacer& pacer = renderer->framePacer;
+		ResolutionSize renderSize = renderer->RenderSize();
+		swprintf(packet.status + length, _countof(packet.status) - length, L" | %hs %.1f ms, %llu late | %ux%u%ls",
+			FramePacer::ModeName(pacer.Mode()), pacer.Stats().AverageLatencyMs(),
+			static_cast<unsigned long long>(pacer.Stats().missedVsyncs),
+			renderSize.width, renderSize.height, renderer->resolutionController.IsEnabled() ? L"" : L" fija");
+		packet.statusReady = true;
+
+		UpdateMemoryBudget(renderer->adapter);
+	}
+
+	if (CommandCapture::HasFinishedCapture())
+	{
+		std::wstring path = std::wstring(Windows::Storage::ApplicationData::Current->LocalFolder->Path->Data()) +
+			L"\\capture_" + std::to_wstring(packet.frame) + L".mfcs";
+		std::ofstream capture(path, std::ios::binary);
+		CommandCapture::SaveFinishedCapture(capture);
+	}
 }
 
 // El primer mtodo al que se llama cuando se crea IFrameworkView.
@@ -106,18 +271,48 @@ void App::SetWindow(CoreWindow^ window)
 	window->Closed += 
 		ref new TypedEventHandler<CoreWindow^, CoreWindowEventArgs^>(this, &App::OnWindowClosed);
 
+	window->KeyDown +=
+		ref new TypedEventHandler<CoreWindow^, KeyEventArgs^>(this, &App::OnKeyDown);
+
 	CoreWindow::GetForCurrentThread()->Dispatcher->ProcessEvents(CoreProcessEventsOption::ProcessAllIfPresent);
 
+	MemoryTracker::SetBudgetAlarm(0.9, [](MemorySegment segment, const MemoryBudget& budget) {
+		char message[160];
+		sprintf_s(message, "Memoria %s al %.0f%% del presupuesto (%llu de %llu MB)\n", MemoryTracker::SegmentName(segment),
+			100.0 * budget.usageBytes / budget.budgetBytes, budget.usageBytes >> 20, budget.budgetBytes >> 20);
+		OutputDebugStringA(message);
+	});
+
+	// Los tiempos del arranque se cuentan desde aqu, con la creacin del dispositivo incluida.
+	startup = std::make_shared<StartupLoader>();
 	renderer = std::make_shared<Renderer>();
 	renderer->Initialize(CoreWindow::GetForCurrentThread());
+	outputSize = renderer->OutputSize();
 
-	renderer->ResetCommands();
+	jobSystem = std::make_shared<JobSystem>();
+	uploads = std::make_shared<UploadQueue>(renderer->d3dDevice, *jobSystem);
 
+	// Todas las cargas a la vez: el primer fotograma con la escena solo espera a la malla y al PSO del cubo.
+	// Las texturas y el pase de ampliacin llegan despus; hasta entonces se dibuja con SRV nulas y sin ampliar.
 	cube = std::make_shared<Cube>();
-	cube->Initialize(renderer->frameCount, renderer->d3dDevice, renderer->commandList);
-
-	renderer->CloseCommandsAndFlush();
-	cube->DestroyUploadResources();
+	cube->Initialize(renderer->d3dDevice, renderer->frameCount);
+	startup->Add("Cube mesh", cube->LoadMesh(*uploads), true);
+	startup->Add("Cube textures", cube->LoadTextures(*uploads), false);
+	startup->Add("Upscale pipeline", renderer->LoadUpscalePipeline(*jobSystem), false);
+	startup->Seal();
+
+	LocalBounds cubeBounds = ComputeLocalBounds(&Cube::vertices[0].Position, sizeof(VertexType), _countof(Cube::vertices));
+	world.Create(
+		Transform{ XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f },
+		cubeBounds,
+		InnerOccluderBox(cubeBounds),
+		SpinAnimation{ 0.02f },
+		BobAnimation{ 0.002f, 0.0f, 2.0f, 0.0f },
+		MeshInstance{ cube.get(), cube->pipelineSortId, cube->materialSortId, DrawLayer::Opaque });
+
+	// Desde aqu el hilo de simulacin escribe los Transform; las entidades deben existir ya.
+	simulation = std::make_shared<Simulation>(world, *jobSystem);
+	simulation->Start();
 }
 
 // Controladores de eventos del ciclo de vida de la aplicacin.
@@ -136,8 +331,36 @@ void App::OnSuspending(Platform::Object^ sender, SuspendingEventArgs^ args)
 	// la aplicacin se ver forzada a salir.
 	SuspendingDeferral^ deferral = args->SuspendingOperation->GetDeferral();
 
-	create_task([this, deferral]()
+	// Las estadsticas de fotogramas se escriben aqu, en el hilo de Run, que es el nico que las modifica.
+	// RenderStats la escribe el hilo de render: antes se espera a que grabe todo lo entregado.
+	if (renderThread != nullptr)
+	{
+		renderThread->Flush();
+	}
+	std::wstring localFolder = Windows::Storage::ApplicationData::Current->LocalFolder->Path->Data();
+	std::ofstream statsJson(localFolder + L"\\frame_stats.json");
+	timer.GetFrameStats().WriteJson(statsJson);
+	std::ofstream statsCsv(localFolder + L"\\frame_stats.csv");
+	timer.GetFrameStats().WriteCsv(statsCsv);
+	std::ofstream renderStatsCsv(localFolder + L"\\render_stats.csv");
+	RenderStats::WriteCsv(renderStatsCsv);
+	std::ofstream memoryReport(localFolder + L"\\memory_report.csv");
+	MemoryTracker::WriteReport(memoryReport);
+	std::ofstream allocationReport(localFolder + L"\\allocations.csv");
+	AllocationTracker::WriteReport(allocationReport);
+	if (startup != nullptr && startup->FullyLoaded())
+	{
+		std::ofstream startupReport(localFolder + L"\\startup.txt");
+		startup->WriteReport(startupReport);
+	}
+
+	create_task([this, deferral, localFolder]()
 	{
+#if MYTHFORGE_PROFILER
+		// La traza del perfilador se vuelca a la carpeta local de la aplicacin.
+		std::ofstream trace(localFolder + L"\\profile.json");
+		Profiler::WriteChromeTrace(trace);
+#endif
 		deferral->Complete();
 	});
 }
@@ -147,9 +370,12 @@ void App::OnSuspending(Platform::Object^ sender, SuspendingEventArgs^ args)
 
 void App::OnWindowSizeChanged(CoreWindow^ sender, WindowSizeChangedEventArgs^ args)
 {
+	// El renderer es del hilo de render: el tamao nuevo viaja con el paquete siguiente.
 	if (renderer != nullptr)
 	{
-		renderer->Resize(static_cast<UINT>(sender->Bounds.Width), static_cast<UINT>(sender->Bounds.Height));
+		outputSize = { static_cast<uint32_t>(sender->Bounds.Width), static_cast<uint32_t>(sender->Bounds.Height) };
+		pendingRequests.resize = true;
+		pendingRequests.outputSize = outputSize;
 	}
 }
 
@@ -163,4 +389,33 @@ void App::OnWindowClosed(CoreWindow^ sender, CoreWindowEventArgs^ args)
 	m_windowClosed = true;
 }
 
+void App::OnKeyDown(CoreWindow^ sender, KeyEventArgs^ args)
+{
+	// F9 captura el fotograma siguiente y F10 los 60 siguientes; la captura se guarda en la carpeta local.
+	// F7 pasa al siguiente modo del FramePacer.
+	// F8 activa o desactiva el filtro de estado redundante, para comparar capturas con y sin l.
+	// F6 activa o desactiva la resolucin dinmica; desactivada se dibuja a la escala mxima.
+	// Todo se aplica en el hilo de render, con el paquete siguiente.
+	if (args->VirtualKey == VirtualKey::F6)
+	{
+		pendingRequests.toggleDynamicResolution = !pendingRequests.toggleDynamicResolution;
+	}
+	else if (args->VirtualKey == VirtualKey::F7)
+	{
+		pendingRequests.pacingModeSteps++;
+	}
+	else if (args->VirtualKey == VirtualKey::F8)
+	{
+		pendingRequests.toggleStateFiltering = !pendingRequests.toggleStateFiltering;
+	}
+	else if (args->VirtualKey == VirtualKey::F9)
+	{
+		pendingRequests.captureFrames = 1;
+	}
+	else if (args->VirtualKey == VirtualKey::F10)
+	{
+		pendingRequests.captureFrames = 60;
+	}
+}
+
 
@@ -2,7 +2,15 @@
 
 #include "pch.h"
 #include "Renderer.h"
+#include "AssetLoading.h"
 #include "Cube.h"
+#include "FramePacket.h"
+#include "JobSystem.h"
+#include "RenderThread.h"
+#include "Scene.h"
+#include "Simulation.h"
+#include "StartupLoader.h"
+#include "StepTimer.h"
 
 using namespace DirectX;
 
@@ -30,14 +38,32 @@ namespace Mythforge
 		void OnWindowSizeChanged(Windows::UI::Core::CoreWindow^ sender, Windows::UI::Core::WindowSizeChangedEventArgs^ args);
 		void OnVisibilityChanged(Windows::UI::Core::CoreWindow^ sender, Windows::UI::Core::VisibilityChangedEventArgs^ args);
 		void OnWindowClosed(Windows::UI::Core::CoreWindow^ sender, Windows::UI::Core::CoreWindowEventArgs^ args);
+		void OnKeyDown(Windows::UI::Core::CoreWindow^ sender, Windows::UI::Core::KeyEventArgs^ args);
 
 	private:
+		void RenderFrame(FramePacket& packet);
+
 		bool m_windowClosed;
 		bool m_windowVisible;
 		std::shared_ptr<Renderer> renderer;
 
 		std::shared_ptr<Cube> cube;
 
+		std::shared_ptr<JobSystem> jobSystem;
+		std::shared_ptr<UploadQueue> uploads; // Cola de copia de las cargas; se destruye antes que jobSystem
+		std::shared_ptr<StartupLoader> startup; // Cargas del arranque; se destruye antes que uploads
+		World world;
+		std::shared_ptr<Simulation> simulation; // Anima world a paso fijo en su propio hilo
+		std::vector<Transform> frameTransforms; // Transform interpolados del fotograma, por índice de entidad
+		std::shared_ptr<RenderThread> renderThread; // Graba y presenta los paquetes que prepara Run
+		FramePacket framePackets[2]; // Uno se prepara mientras el otro se graba
+		RenderRequests pendingRequests; // Eventos de ventana y teclado para el paquete siguiente
+		ResolutionSize outputSize; // Tamaño de la ventana según el hilo de juego
+		SceneCulling sceneCulling;
+		DX::StepTimer timer;
+		bool steadyAllocationReported = false;
+		bool startupReported = false; // Solo lo toca el hilo de render
+
 		XMVECTOR cameraPos = {0.0f, 0.0f, -5.0f};
 		XMVECTOR cameraFw = { 0.0f, 0.0f, 1.0f, 0.0f };
 		XMVECTOR up = { 0.0f, 1.0f, 0.0f, 0.0f };
@@ -2,204 +2,293 @@
 #include "Cube.h"
 #include "DirectXHelper.h"
 #include "DeviceUtils.h"
+#include "RenderStats.h"
+#include "CommandContext.h"
+#include "CommandCapture.h"
+#include "DrawQueue.h"
+#include "AssetLoading.h"
 
-void Cube::Initialize(UINT numFrames, ComPtr<ID3D12Device2> d3dDevice, ComPtr<ID3D12GraphicsCommandList2> commandList)
+void Cube::Initialize(ComPtr<ID3D12Device2> d3dDevice, UINT numFrames)
 {
-	UpdateBufferResource(d3dDevice, commandList, vertexBuffer, vertexBufferUpload, _countof(vertices), sizeof(VertexType), vertices);
-	vertexBufferView.BufferLocation = vertexBuffer->GetGPUVirtualAddress();
-	vertexBufferView.SizeInBytes = sizeof(vertices);
-	vertexBufferView.StrideInBytes = sizeof(VertexType);
-	NAME_D3D12_OBJECT(vertexBuffer);
+	device = d3dDevice;
+	frameCount = numFrames;
+	cbvDescriptorSize = d3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	CreateDrawResources(initialDrawCapacity);
 
-	UpdateBufferResource(d3dDevice, commandList, indexBuffer, indexBufferUpload, _countof(indices), sizeof(UINT16), indices);
-	indexBufferView.BufferLocation = indexBuffer->GetGPUVirtualAddress();
-	indexBufferView.Format = DXGI_FORMAT_R16_UINT;
-	indexBufferView.SizeInBytes = sizeof(indices);
-	NAME_D3D12_OBJECT(indexBuffer);
+	// Los identificadores no dependen del PSO: las instancias se crean antes de que termine de compilar.
+	pipelineSortId = DrawKey::AllocatePipelineId();
+	materialSortId = DrawKey::AllocateMaterialId();
+}
 
-	D3D12_DESCRIPTOR_HEAP_DESC cbvsrvHeapDesc = {};
-	cbvsrvHeapDesc.NumDescriptors = numFrames+2;
-	cbvsrvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	cbvsrvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	DX::ThrowIfFailed(d3dDevice->CreateDescriptorHeap(&cbvsrvHeapDesc, IID_PPV_ARGS(&cbvsrvHeap)));
-	NAME_D3D12_OBJECT(cbvsrvHeap);
+void Cube::ReserveDraws(UINT draws)
+{
+	if (draws <= drawCapacity) return;
+	CreateDrawResources((std::max)(draws, drawCapacity * 2));
+}
 
-	CD3DX12_RESOURCE_DESC constantBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(numFrames * alignedConstantBufferSize);
-	DX::ThrowIfFailed(d3dDevice->CreateCommittedResource(
+void Cube::CreateDrawResources(UINT capacity)
+{
+	ComPtr<ID3D12Resource> newConstantBuffer;
+	CD3DX12_RESOURCE_DESC constantBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(UINT64(frameCount) * capacity * alignedConstantBufferSize);
+	DX::ThrowIfFailed(device->CreateCommittedResource(
 		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
 		D3D12_HEAP_FLAG_NONE,
 		&constantBufferDesc,
 		D3D12_RESOURCE_STATE_GENERIC_READ,
 		nullptr,
-		IID_PPV_ARGS(&constantBuffer)
+		IID_PPV_ARGS(&newConstantBuffer)
 	));
+	DX::SetName(newConstantBuffer.Get(), L"constantBuffer");
+	TrackResource(newConstantBuffer, MemoryCategory::Constants, "constantBuffer");
+	CommandCapture::RegisterResource(newConstantBuffer.Get(), D3D12_RESOURCE_STATE_GENERIC_READ);
 
-	NAME_D3D12_OBJECT(constantBuffer);
+	UINT8* newMappedConstantBuffer = nullptr;
+	CD3DX12_RANGE readRange(0, 0);
+	DX::ThrowIfFailed(newConstantBuffer->Map(0, &readRange, reinterpret_cast<void**>(&newMappedConstantBuffer)));
+	ZeroMemory(newMappedConstantBuffer, size_t(frameCount) * capacity * alignedConstantBufferSize);
 
-	D3D12_GPU_VIRTUAL_ADDRESS cbvGpuAddress = constantBuffer->GetGPUVirtualAddress();
-	CD3DX12_CPU_DESCRIPTOR_HANDLE cbvCpuHandle(cbvsrvHeap->GetCPUDescriptorHandleForHeapStart());
-	cbvDescriptorSize = d3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	// Las dos tablas de SRV van delante y los CBV de los dibujados detras, frame a frame.
+	D3D12_DESCRIPTOR_HEAP_DESC cbvsrvHeapDesc = {};
+	cbvsrvHeapDesc.NumDescriptors = drawTableStart + frameCount * capacity;
+	cbvsrvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	cbvsrvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	ComPtr<ID3D12DescriptorHeap> newHeap;
+	DX::ThrowIfFailed(device->CreateDescriptorHeap(&cbvsrvHeapDesc, IID_PPV_ARGS(&newHeap)));
+	DX::SetName(newHeap.Get(), L"cbvsrvHeap");
+	CommandCapture::RegisterDescriptorHeap(device.Get(), newHeap.Get());
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC nullSrvDesc = {};
+	nullSrvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	nullSrvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	nullSrvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+	nullSrvDesc.Texture2D.MipLevels = 1;
+	CD3DX12_CPU_DESCRIPTOR_HANDLE placeholderHandle(newHeap->GetCPUDescriptorHandleForHeapStart(), placeholderTable, cbvDescriptorSize);
+	for (UINT n = 0; n < 2; n++)
+	{
+		device->CreateShaderResourceView(nullptr, &nullSrvDesc, placeholderHandle);
+		CommandCapture::RegisterShaderResourceView(nullptr, &nullSrvDesc, placeholderHandle);
+		placeholderHandle.Offset(cbvDescriptorSize);
+	}
+	RenderStats::Add(RenderCounter::DescriptorWrites, 2);
 
-	for (UINT n = 0; n < numFrames; n++)
+	D3D12_GPU_VIRTUAL_ADDRESS cbvGpuAddress = newConstantBuffer->GetGPUVirtualAddress();
+	CD3DX12_CPU_DESCRIPTOR_HANDLE cbvCpuHandle(newHeap->GetCPUDescriptorHandleForHeapStart(), drawTableStart, cbvDescriptorSize);
+	for (UINT n = 0; n < frameCount * capacity; n++)
 	{
 		D3D12_CONSTANT_BUFFER_VIEW_DESC desc;
 		desc.BufferLocation = cbvGpuAddress;
 		desc.SizeInBytes = alignedConstantBufferSize;
-		d3dDevice->CreateConstantBufferView(&desc, cbvCpuHandle);
+		device->CreateConstantBufferView(&desc, cbvCpuHandle);
+		CommandCapture::RegisterConstantBufferView(desc, cbvCpuHandle);
 
 		cbvGpuAddress += desc.SizeInBytes;
 		cbvCpuHandle.Offset(cbvDescriptorSize);
 	}
+	RenderStats::Add(RenderCounter::DescriptorWrites, frameCount * capacity);
 
-	CD3DX12_RANGE readRange(0, 0);
-	DX::ThrowIfFailed(constantBuffer->Map(0, &readRange, reinterpret_cast<void**>(&mappedConstantBuffer)));
-	ZeroMemory(mappedConstantBuffer, numFrames * alignedConstantBufferSize);
-
-	D3D12_SHADER_RESOURCE_VIEW_DESC crateSrvDesc = {};
-	D3D12_SHADER_RESOURCE_VIEW_DESC fragileSrvDesc = {};
+	// LoadTextures puede estar escribiendo sus SRV en el heap anterior: el cambio se hace con el mutex tomado.
+	std::lock_guard<std::mutex> lock(heapMutex);
+	if (texturesResident.load(std::memory_order_acquire))
+	{
+		WriteTextureViews(newHeap.Get());
+	}
+	if (cbvsrvHeap)
+	{
+		CommandCapture::Unregister(cbvsrvHeap.Get());
+	}
+	cbvsrvHeap = newHeap;
+	constantBuffer = newConstantBuffer;
+	mappedConstantBuffer = newMappedConstantBuffer;
+	drawCapacity = capacity;
+}
 
-	CD3DX12_CPU_DESCRIPTOR_HANDLE crateCpuHandle(cbvCpuHandle);
-	CD3DX12_CPU_DESCRIPTOR_HANDLE fragileCpuHandle(cbvCpuHandle);
+void Cube::WriteTextureViews(ID3D12DescriptorHeap* heap)
+{
+	CD3DX12_CPU_DESCRIPTOR_HANDLE crateCpuHandle(heap->GetCPUDescriptorHandleForHeapStart(), textureTable, cbvDescriptorSize);
+	CD3DX12_CPU_DESCRIPTOR_HANDLE fragileCpuHandle(crateCpuHandle);
 	fragileCpuHandle.Offset(cbvDescriptorSize);
 
-	CreateTextureResource(d3dDevice, commandList, L"Assets/crate/crate.dds", crateTexture, crateTextureUpload, crateSrvDesc);
-	CreateTextureResource(d3dDevice, commandList, L"Assets/crate/fragile.dds", fragileTexture, fragileTextureUpload, fragileSrvDesc);
+	device->CreateShaderResourceView(crateTexture.Get(), &crateSrvDesc, crateCpuHandle);
+	device->CreateShaderResourceView(fragileTexture.Get(), &fragileSrvDesc, fragileCpuHandle);
+	CommandCapture::RegisterShaderResourceView(crateTexture.Get(), &crateSrvDesc, crateCpuHandle);
+	CommandCapture::RegisterShaderResourceView(fragileTexture.Get(), &fragileSrvDesc, fragileCpuHandle);
+	RenderStats::Add(RenderCounter::DescriptorWrites, 2);
+}
 
-	d3dDevice->CreateShaderResourceView(crateTexture.Get(), &crateSrvDesc, crateCpuHandle);
-	d3dDevice->CreateShaderResourceView(fragileTexture.Get(), &fragileSrvDesc, fragileCpuHandle);
+Task<void> Cube::LoadMesh(UploadQueue& uploads)
+{
+	// Las tareas no empiezan hasta WhenAll, que las arranca todas antes de esperar.
+	Task<ComPtr<ID3D12Resource>> vertexUpload = AssetLoading::UploadBuffer(uploads, vertices, _countof(vertices), sizeof(VertexType));
+	Task<ComPtr<ID3D12Resource>> indexUpload = AssetLoading::UploadBuffer(uploads, indices, _countof(indices), sizeof(UINT16));
+	Task<void> pipelineLoad = LoadPipeline(uploads.Jobs(), uploads.Device());
+	co_await WhenAll(vertexUpload, indexUpload, pipelineLoad);
 
-	auto createVSTask = DX::ReadDataAsync(L"Shaders\\VertexShaders\\TexCoord.cso").then([this](std::vector<byte>& fileData) {
-		vertexShader = fileData;
-	});
+	vertexBuffer = co_await vertexUpload;
+	vertexBufferView.BufferLocation = vertexBuffer->GetGPUVirtualAddress();
+	vertexBufferView.SizeInBytes = sizeof(vertices);
+	vertexBufferView.StrideInBytes = sizeof(VertexType);
+	NAME_D3D12_OBJECT(vertexBuffer);
 
-	auto createPSTask = DX::ReadDataAsync(L"Shaders\\PixelShaders\\TexCoord.cso").then([this](std::vector<byte>& fileData) {
-		pixelShader = fileData;
-	});
+	indexBuffer = co_await indexUpload;
+	indexBufferView.BufferLocation = indexBuffer->GetGPUVirtualAddress();
+	indexBufferView.Format = DXGI_FORMAT_R16_UINT;
+	indexBufferView.SizeInBytes = sizeof(indices);
+	NAME_D3D12_OBJECT(indexBuffer);
 
-	auto createPipelineStateTask = (createPSTask && createVSTask).then([this, d3dDevice]() {
+	co_await pipelineLoad;
+	meshResident.store(true, std::memory_order_release);
+}
+
+Task<void> Cube::LoadTextures(UploadQueue& uploads)
+{
+	Task<TextureUpload> crateUpload = AssetLoading::UploadTexture(uploads, L"Assets/crate/crate.dds");
+	Task<TextureUpload> fragileUpload = AssetLoading::UploadTexture(uploads, L"Assets/crate/fragile.dds");
+	co_await WhenAll(crateUpload, fragileUpload);
+
+	TextureUpload crate = co_await crateUpload;
+	TextureUpload fragile = co_await fragileUpload;
+	// Con el mutex: el render puede estar cambiando de heap para tener mas dibujados por frame.
+	std::lock_guard<std::mutex> lock(heapMutex);
+	crateTexture = crate.texture;
+	fragileTexture = fragile.texture;
+	crateSrvDesc = crate.srvDesc;
+	fragileSrvDesc = fragile.srvDesc;
+	WriteTextureViews(cbvsrvHeap.Get());
+	texturesResident.store(true, std::memory_order_release);
+}
+
+Task<void> Cube::LoadPipeline(JobSystem& jobSystem, ComPtr<ID3D12Device2> d3dDevice)
+{
+	Task<std::vector<uint8_t>> vertexShaderFile = AssetLoading::ReadFile(jobSystem, L"Shaders\\VertexShaders\\TexCoord.cso");
+	Task<std::vector<uint8_t>> pixelShaderFile = AssetLoading::ReadFile(jobSystem, L"Shaders\\PixelShaders\\TexCoord.cso");
+	co_await WhenAll(vertexShaderFile, pixelShaderFile);
+	std::vector<uint8_t> vertexShader = co_await vertexShaderFile;
+	std::vector<uint8_t> pixelShader = co_await pixelShaderFile;
+
+	{
+		CD3DX12_DESCRIPTOR_RANGE rangeCBV;
+		CD3DX12_DESCRIPTOR_RANGE rangeSRV;
+		CD3DX12_ROOT_PARAMETER parameter[2];
+
+		rangeCBV.Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0);
+		rangeSRV.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 2, 0);
+		parameter[0].InitAsDescriptorTable(1, &rangeCBV, D3D12_SHADER_VISIBILITY_VERTEX);
+		parameter[1].InitAsDescriptorTable(1, &rangeSRV, D3D12_SHADER_VISIBILITY_PIXEL);
+		D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags =
+			D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
+			D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+			D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS |
+			D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS;
+
+		CD3DX12_STATIC_SAMPLER_DESC samplers[1];
+		for (UINT i = 0; i < _countof(samplers); i++)
 		{
-			CD3DX12_DESCRIPTOR_RANGE rangeCBV;
-			CD3DX12_DESCRIPTOR_RANGE rangeSRV;
-			CD3DX12_ROOT_PARAMETER parameter[2];
-
-			rangeCBV.Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0);
-			rangeSRV.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 2, 0);
-			parameter[0].InitAsDescriptorTable(1, &rangeCBV, D3D12_SHADER_VISIBILITY_VERTEX);
-			parameter[1].InitAsDescriptorTable(1, &rangeSRV, D3D12_SHADER_VISIBILITY_PIXEL);
-			D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags =
-				D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
-				D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
-				D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS |
-				D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS;
-
-			CD3DX12_STATIC_SAMPLER_DESC samplers[1];
-			for (UINT i = 0; i < _countof(samplers); i++)
-			{
-				samplers[i].Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
-				samplers[i].AddressU = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
-				samplers[i].AddressV = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
-				samplers[i].AddressW = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
-				samplers[i].MipLODBias = 0;
-				samplers[i].MaxAnisotropy = 0;
-				samplers[i].ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
-				samplers[i].BorderColor = D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK;
-				samplers[i].MinLOD = 0.0f;
-				samplers[i].MaxLOD = D3D12_FLOAT32_MAX;
-				samplers[i].ShaderRegister = i;
-				samplers[i].RegisterSpace = 0;
-				samplers[i].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
-			}
-
-			CD3DX12_ROOT_SIGNATURE_DESC descRootSignatue;
-			descRootSignatue.Init(_countof(parameter), parameter, _countof(samplers), samplers, rootSignatureFlags);
-
-			ComPtr<ID3DBlob> pSignature;
-			ComPtr<ID3DBlob> pError;
-
-			DX::ThrowIfFailed(D3D12SerializeRootSignature(&descRootSignatue, D3D_ROOT_SIGNATURE_VERSION_1, pSignature.GetAddressOf(), pError.GetAddressOf()));
-			DX::ThrowIfFailed(d3dDevice->CreateRootSignature(0, pSignature->GetBufferPointer(), pSignature->GetBufferSize(), IID_PPV_ARGS(&rootSignature)));
-			NAME_D3D12_OBJECT(rootSignature);
+			samplers[i].Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+			samplers[i].AddressU = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+			samplers[i].AddressV = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+			samplers[i].AddressW = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+			samplers[i].MipLODBias = 0;
+			samplers[i].MaxAnisotropy = 0;
+			samplers[i].ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
+			samplers[i].BorderColor = D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK;
+			samplers[i].MinLOD = 0.0f;
+			samplers[i].MaxLOD = D3D12_FLOAT32_MAX;
+			samplers[i].ShaderRegister = i;
+			samplers[i].RegisterSpace = 0;
+			samplers[i].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
 		}
 
-		static const D3D12_INPUT_ELEMENT_DESC inputLayout[] =
-		{
-			{"POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, offsetof(VertexType,Position), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-			{"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, offsetof(VertexType,TextCoord), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}
-		};
-
-		D3D12_GRAPHICS_PIPELINE_STATE_DESC state = {};
-		state.InputLayout = { inputLayout, _countof(inputLayout) };
-		state.pRootSignature = rootSignature.Get();
-		state.VS = CD3DX12_SHADER_BYTECODE(&vertexShader[0], vertexShader.size());
-		state.PS = CD3DX12_SHADER_BYTECODE(&pixelShader[0], pixelShader.size());
-		state.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
-		state.RasterizerState.CullMode = D3D12_CULL_MODE_FRONT;
-		state.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
-		state.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
-		state.SampleMask = UINT_MAX;
-		state.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-		state.NumRenderTargets = 1;
-		state.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
-		state.DSVFormat = DXGI_FORMAT_D32_FLOAT;
-		state.SampleDesc.Count = 1;
-
-		DX::ThrowIfFailed(d3dDevice->CreateGraphicsPipelineState(&state, IID_PPV_ARGS(&pipelineState)));
-
-		vertexShader.clear();
-		pixelShader.clear();
-		loadingComplete = true;
-	});
+		CD3DX12_ROOT_SIGNATURE_DESC descRootSignatue;
+		descRootSignatue.Init(_countof(parameter), parameter, _countof(samplers), samplers, rootSignatureFlags);
+
+		ComPtr<ID3DBlob> pSignature;
+		ComPtr<ID3DBlob> pError;
+
+		DX::ThrowIfFailed(D3D12SerializeRootSignature(&descRootSignatue, D3D_ROOT_SIGNATURE_VERSION_1, pSignature.GetAddressOf(), pError.GetAddressOf()));
+		DX::ThrowIfFailed(d3dDevice->CreateRootSignature(0, pSignature->GetBufferPointer(), pSignature->GetBufferSize(), IID_PPV_ARGS(&rootSignature)));
+		NAME_D3D12_OBJECT(rootSignature);
+		CommandCapture::RegisterRootSignature(rootSignature.Get(), pSignature->GetBufferPointer(), pSignature->GetBufferSize());
+	}
+
+	static const D3D12_INPUT_ELEMENT_DESC inputLayout[] =
+	{
+		{"POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, offsetof(VertexType,Position), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+		{"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, offsetof(VertexType,TextCoord), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}
+	};
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC state = {};
+	state.InputLayout = { inputLayout, _countof(inputLayout) };
+	state.pRootSignature = rootSignature.Get();
+	state.VS = CD3DX12_SHADER_BYTECODE(&vertexShader[0], vertexShader.size());
+	state.PS = CD3DX12_SHADER_BYTECODE(&pixelShader[0], pixelShader.size());
+	state.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+	state.RasterizerState.CullMode = D3D12_CULL_MODE_FRONT;
+	state.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+	state.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+	state.SampleMask = UINT_MAX;
+	state.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	state.NumRenderTargets = 1;
+	state.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+	state.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+	state.SampleDesc.Count = 1;
+
+	pipelineState = co_await AssetLoading::CompilePSO(jobSystem, d3dDevice, state);
 }
 
-void Cube::DestroyUploadResources()
+void Cube::Destroy()
 {
-	vertexBufferUpload->Release();
-	indexBufferUpload->Release();
-	crateTextureUpload->Release();
-	fragileTextureUpload->Release();
+	// Con Reset y no Release: si se cierra antes de que acaben las cargas, parte de los recursos aun no existen.
+	crateTexture.Reset();
+	fragileTexture.Reset();
+	vertexBuffer.Reset();
+	indexBuffer.Reset();
+	constantBuffer.Reset();
+	mappedConstantBuffer = nullptr;
+	if (cbvsrvHeap)
+	{
+		CommandCapture::Unregister(cbvsrvHeap.Get());
+	}
+	cbvsrvHeap.Reset();
+	rootSignature.Reset();
+	pipelineState.Reset();
+	device.Reset();
 }
 
-void Cube::Destroy()
+UINT Cube::DrawSlot(UINT backBufferIndex, UINT drawIndex) const
 {
-	crateTexture->Release();
-	fragileTexture->Release();
-	vertexBuffer->Release();
-	indexBuffer->Release();
-	constantBuffer->Release();
-	cbvsrvHeap->Release();
-	rootSignature->Release();
-	pipelineState->Release();
+	return backBufferIndex * drawCapacity + drawIndex;
 }
 
-void Cube::UpdateConstantBuffer(UINT backBufferIndex, XMMATRIX viewProjection)
+void Cube::UpdateConstantBuffer(UINT backBufferIndex, UINT drawIndex, XMMATRIX world, XMMATRIX viewProjection)
 {
-	if (!loadingComplete) return;
+	if (!meshResident.load(std::memory_order_acquire)) return;
 
-	yRotation += yRotationStep;
-	yTranslation += yTranslationStep;
-	XMMATRIX world = XMMatrixMultiply(XMMatrixRotationY(yRotation), XMMatrixTranslation(0, 2*sinf(yTranslation),0));
-	XMMATRIX wvp = XMMatrixTranspose(XMMatrixMultiply(world, viewProjection));
+	UINT offset = DrawSlot(backBufferIndex, drawIndex) * alignedConstantBufferSize;
+	ConstantWriter<ObjectConstants> constants(mappedConstantBuffer + offset);
+	constants.Set<&ObjectConstants::worldViewProjection>(XMMatrixMultiply(world, viewProjection));
+	RenderStats::Add(RenderCounter::UploadBytes, sizeof(ObjectConstants));
 
-	UINT8* destination = mappedConstantBuffer + (backBufferIndex * alignedConstantBufferSize);
-	memcpy(destination, &wvp, sizeof(wvp));
+	// La captura relee la memoria mapeada, que es lenta de leer; solo lo hace mientras graba.
+	CommandCapture::RecordBufferWrite(constantBuffer.Get(), offset, constants.Data(), sizeof(ObjectConstants));
 }
 
-void Cube::Render(ComPtr<ID3D12GraphicsCommandList2> commandList, UINT backBufferIndex)
+void Cube::Render(CommandContext& context, UINT backBufferIndex, UINT drawIndex)
 {
-	if (!loadingComplete) return;
+	if (!meshResident.load(std::memory_order_acquire)) return;
 
-	commandList->SetGraphicsRootSignature(rootSignature.Get());
+	context.SetGraphicsRootSignature(rootSignature.Get());
 	ID3D12DescriptorHeap* ppHeaps[] = { cbvsrvHeap.Get() };
-	commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
-	commandList->SetPipelineState(pipelineState.Get());
-
-	CD3DX12_GPU_DESCRIPTOR_HANDLE cbvGpuHandle(cbvsrvHeap->GetGPUDescriptorHandleForHeapStart(), backBufferIndex, cbvDescriptorSize);
-	CD3DX12_GPU_DESCRIPTOR_HANDLE texGpuHandle(cbvsrvHeap->GetGPUDescriptorHandleForHeapStart(), 3, cbvDescriptorSize);
-	commandList->SetGraphicsRootDescriptorTable(0, cbvGpuHandle);
-	commandList->SetGraphicsRootDescriptorTable(1, texGpuHandle);
-
-	commandList->IASetPrimitiveTopology(D3D10_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	commandList->IASetVertexBuffers(0, 1, &vertexBufferView);
-	commandList->IASetIndexBuffer(&indexBufferView);
-	commandList->DrawIndexedInstanced(_countof(indices), 1, 0, 0, 0);
+	context.SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+	context.SetPipelineState(pipelineState.Get());
+
+	CD3DX12_GPU_DESCRIPTOR_HANDLE cbvGpuHandle(cbvsrvHeap->GetGPUDescriptorHandleForHeapStart(), drawTableStart + DrawSlot(backBufferIndex, drawIndex), cbvDescriptorSize);
+	UINT texTable = texturesResident.load(std::memory_order_acquire) ? textureTable : placeholderTable;
+	CD3DX12_GPU_DESCRIPTOR_HANDLE texGpuHandle(cbvsrvHeap->GetGPUDescriptorHandleForHeapStart(), texTable, cbvDescriptorSize);
+	context.SetGraphicsRootDescriptorTable(0, cbvGpuHandle);
+	context.SetGraphicsRootDescriptorTable(1, texGpuHandle);
+
+	context.IASetPrimitiveTopology(D3D10_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	context.IASetVertexBuffers(0, 1, &vertexBufferView);
+	context.IASetIndexBuffer(&indexBufferView);
+	context.DrawIndexedInstanced(_countof(indices), 1, 0, 0, 0);
 }
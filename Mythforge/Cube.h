@@ -1,5 +1,12 @@
 #pragma once
+#include <atomic>
+#include <mutex>
 #include "VertexFormats.h"
+#include "ShaderConstants.h"
+#include "Task.h"
+
+class CommandContext;
+class UploadQueue;
 
 using namespace Microsoft::WRL;
 using namespace DirectX;
@@ -56,46 +63,67 @@ struct Cube{
 
 	};
 
-	bool loadingComplete = false;
+	// Los pone la carga y los lee el hilo de render: la malla decide si se dibuja y las texturas la tabla de SRV se usa.
+	std::atomic<bool> meshResident{ false };
+	std::atomic<bool> texturesResident{ false };
 
 	ComPtr<ID3D12Resource>	vertexBuffer;
-	ComPtr<ID3D12Resource>	vertexBufferUpload;
 	D3D12_VERTEX_BUFFER_VIEW vertexBufferView;
 
 	ComPtr<ID3D12Resource>	indexBuffer;
-	ComPtr<ID3D12Resource>	indexBufferUpload;
 	D3D12_INDEX_BUFFER_VIEW indexBufferView;
 
+	// Cada dibujado tiene su copia de las constantes: la GPU ejecuta la lista cuando ya se han escrito
+	// todas, asi que dos dibujados de la misma malla no pueden compartirla. Hay drawCapacity copias
+	// por frame en vuelo, en un anillo indexado por frame y posicion en la DrawQueue.
+	ComPtr<ID3D12Device2>	device;
 	ComPtr<ID3D12Resource>	constantBuffer;
-	UINT8*					mappedConstantBuffer;
-	static constexpr UINT	alignedConstantBufferSize = (sizeof(XMMATRIX) + 255) & ~255;
-
+	UINT8*					mappedConstantBuffer = nullptr;
+	UINT					frameCount = 0;
+	UINT					drawCapacity = 0;
+	static constexpr UINT	initialDrawCapacity = 16;
+	static constexpr UINT	alignedConstantBufferSize = ConstantBufferLayout::ViewSize<ObjectConstants>();
+
+	// Dos tablas de dos SRV, la de vistas nulas mientras cargan las texturas y la definitiva, y
+	// detras un CBV por copia de las constantes.
 	ComPtr<ID3D12DescriptorHeap>	cbvsrvHeap;
 	UINT							cbvDescriptorSize;
+	static constexpr UINT			placeholderTable = 0;
+	static constexpr UINT			textureTable = 2;
+	static constexpr UINT			drawTableStart = 4;
+	std::mutex						heapMutex; // LoadTextures escribe en el heap y ReserveDraws lo cambia
 
 	ComPtr<ID3D12Resource>			crateTexture;
-	ComPtr<ID3D12Resource>			crateTextureUpload;
 	ComPtr<ID3D12Resource>			fragileTexture;
-	ComPtr<ID3D12Resource>			fragileTextureUpload;
-
-	std::vector<byte>				vertexShader;
-	std::vector<byte>				pixelShader;
+	D3D12_SHADER_RESOURCE_VIEW_DESC	crateSrvDesc = {};
+	D3D12_SHADER_RESOURCE_VIEW_DESC	fragileSrvDesc = {};
 
 	ComPtr<ID3D12RootSignature>		rootSignature;
 	ComPtr<ID3D12PipelineState>		pipelineState;
 
-	//Y Axis Rotation
-	static constexpr FLOAT			yRotationStep = 0.02f;
-	FLOAT							yRotation = 0.0f;
-
-	//Y Axis Translation
-	static constexpr FLOAT			yTranslationStep = 0.002f;
-	FLOAT							yTranslation = 0.0f;
-
-	void Initialize(UINT numFrames, ComPtr<ID3D12Device2> d3dDevice, ComPtr<ID3D12GraphicsCommandList2> commandList);
-	void DestroyUploadResources();
+	// Identificadores del PSO y del material en la clave de DrawQueue.
+	UINT							pipelineSortId = 0;
+	UINT							materialSortId = 0;
+
+	// Lo que no espera a ningun fichero: heap, constantes, SRV nulas e identificadores de orden.
+	void Initialize(ComPtr<ID3D12Device2> d3dDevice, UINT numFrames);
+	// Buffers y PSO en paralelo; sin ellos no se dibuja. Pone meshResident al terminar.
+	Task<void> LoadMesh(UploadQueue& uploads);
+	Task<void> LoadPipeline(JobSystem& jobSystem, ComPtr<ID3D12Device2> d3dDevice);
+	// Texturas y su tabla de SRV; hasta entonces el cubo se dibuja con las vistas nulas, que leen negro.
+	Task<void> LoadTextures(UploadQueue& uploads);
 	void Destroy();
-	void UpdateConstantBuffer(UINT backBufferIndex, XMMATRIX viewProjection);
-	void Render(ComPtr<ID3D12GraphicsCommandList2> commandList, UINT backBufferIndex);
+	// Dibujados por frame que caben en el anillo de constantes.
+	bool HasDrawCapacity(UINT draws) const { return draws <= drawCapacity; }
+	// Agranda el anillo; la GPU no puede tener ningun frame en vuelo.
+	void ReserveDraws(UINT draws);
+	// drawIndex es la posicion del dibujado en la DrawQueue del frame, menor que la capacidad reservada.
+	void UpdateConstantBuffer(UINT backBufferIndex, UINT drawIndex, XMMATRIX world, XMMATRIX viewProjection);
+	void Render(CommandContext& context, UINT backBufferIndex, UINT drawIndex);
+
+private:
+	void CreateDrawResources(UINT capacity);
+	void WriteTextureViews(ID3D12DescriptorHeap* heap);
+	UINT DrawSlot(UINT backBufferIndex, UINT drawIndex) const;
 };
 
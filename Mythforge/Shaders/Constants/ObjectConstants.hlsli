@@ -0,0 +1,6 @@
+// Generado desde Source/ShaderConstants.h por ShaderCompiler; no se edita a mano.
+
+cbuffer ObjectConstants : register(b0)
+{
+    float4x4 worldViewProjection : packoffset(c0);
+};
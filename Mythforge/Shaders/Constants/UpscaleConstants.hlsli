@@ -0,0 +1,7 @@
+// Generado desde Source/ShaderConstants.h por ShaderCompiler; no se edita a mano.
+
+cbuffer UpscaleConstants : register(b0)
+{
+    float2 uvScale : packoffset(c0);
+    float2 uvMax : packoffset(c0.z);
+};
@@ -1,7 +1,12 @@
 Texture2D texs[] : register(t0);
 SamplerState samp0 : register(s0);
 
-static const uint numTextures = 2;
+// Cuantas texturas se mezclan; el motor carga la permutacion por defecto.
+#ifndef NUM_TEXTURES
+#define NUM_TEXTURES 2 // axis: 1 2
+#endif
+
+static const uint numTextures = NUM_TEXTURES;
 static const float GAMMA = 2.2f;
 static const float INVGAMMA = 1.0f/GAMMA;
 
@@ -0,0 +1,17 @@
+#include "../Constants/UpscaleConstants.hlsli"
+
+Texture2D sceneColor : register(t0);
+SamplerState linearClamp : register(s0);
+
+struct PixelShaderInput
+{
+    float4 pos : SV_POSITION;
+    float2 uv : TEXCOORD;
+};
+
+float4 main(PixelShaderInput input) : SV_Target
+{
+    // Solo la esquina dibujada del destino interno; el filtro bilineal no debe mezclar texels de fuera.
+    float2 uv = min(input.uv * uvScale, uvMax);
+    return float4(sceneColor.Sample(linearClamp, uv).rgb, 1.0f);
+}
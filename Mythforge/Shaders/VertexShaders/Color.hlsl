@@ -1,7 +1,4 @@
-cbuffer WorldViewProjectionConstantBuffer : register(b0)
-{
-    matrix wvp;
-};
+#include "../Constants/ObjectConstants.hlsli"
 
 struct VertexShaderInput
 {
@@ -19,7 +16,7 @@ PixelShaderInput main(VertexShaderInput input)
 {
     PixelShaderInput output;
     
-    float4 pos = mul(float4(input.pos, 1.0f), wvp);
+    float4 pos = mul(float4(input.pos, 1.0f), worldViewProjection);
     float3 color = input.color;
     
     output.pos = pos;
@@ -0,0 +1,18 @@
+struct PixelShaderInput
+{
+    float4 pos : SV_POSITION;
+    float2 uv : TEXCOORD;
+};
+
+// Un triangulo que cubre la pantalla: uv de (0,0) a (2,2), sin buffer de vertices.
+PixelShaderInput main(uint vertexId : SV_VertexID)
+{
+    PixelShaderInput output;
+
+    float2 uv = float2((vertexId << 1) & 2, vertexId & 2);
+
+    output.pos = float4(uv * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+    output.uv = uv;
+
+    return output;
+}
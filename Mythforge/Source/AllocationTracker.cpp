@@ -0,0 +1,274 @@
+﻿/**
+ * @file AllocationTracker.cpp
+ * @brief Sustitución de los operadores globales new y delete y contadores de asignaciones.
+ */
+
+#include "pch.h"
+#include "AllocationTracker.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace
+{
+    constexpr uint32_t MaxTags = 64;
+    constexpr uint32_t MaxNesting = 16;
+
+    struct TagCounters {
+        std::atomic<const char*> name{ nullptr };
+        std::atomic<uint64_t>    allocations{ 0 };
+        std::atomic<uint64_t>    bytes{ 0 };
+        std::atomic<uint64_t>    frees{ 0 };
+    };
+
+    /**
+     * @struct ThreadState
+     * @brief Contadores y pila de etiquetas de un hilo.
+     *
+     * Se inicializa de forma constante: operator new puede llamarse en cualquier momento de la vida
+     * del hilo y no debe disparar una inicialización dinámica que a su vez asigne.
+     */
+    struct ThreadState {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+        uint64_t frees = 0;
+        int32_t  tagStack[MaxNesting] = {};
+        uint32_t tagDepth = 0;
+
+        /// Etiqueta más interna, o -1.
+        int32_t CurrentTag() const { return tagDepth > 0 && tagDepth <= MaxNesting ? tagStack[tagDepth - 1] : -1; }
+    };
+
+    std::atomic<uint64_t> totalAllocations{ 0 };
+    std::atomic<uint64_t> totalBytes{ 0 };
+    std::atomic<uint64_t> totalFrees{ 0 };
+    TagCounters           tags[MaxTags];
+
+    thread_local ThreadState threadState;
+
+    /// Busca la etiqueta por nombre o ocupa un hueco libre; -1 si la tabla está llena.
+    int32_t FindOrAddTag(const char* tag)
+    {
+        for (uint32_t i = 0; i < MaxTags; i++)
+        {
+            const char* name = tags[i].name.load(std::memory_order_acquire);
+            if (!name)
+            {
+                if (tags[i].name.compare_exchange_strong(name, tag, std::memory_order_acq_rel))
+                {
+                    return static_cast<int32_t>(i);
+                }
+            }
+            if (name == tag || strcmp(name, tag) == 0)
+            {
+                return static_cast<int32_t>(i);
+            }
+        }
+        return -1;
+    }
+
+    int32_t FindTag(const char* tag)
+    {
+        for (uint32_t i = 0; i < MaxTags; i++)
+        {
+            const char* name = tags[i].name.load(std::memory_order_acquire);
+            if (!name) return -1;
+            if (name == tag || strcmp(name, tag) == 0) return static_cast<int32_t>(i);
+        }
+        return -1;
+    }
+
+    void RecordAllocation(size_t size)
+    {
+        ThreadState& thread = threadState;
+        thread.allocations++;
+        thread.bytes += size;
+        totalAllocations.fetch_add(1, std::memory_order_relaxed);
+        totalBytes.fetch_add(size, std::memory_order_relaxed);
+
+        int32_t tag = thread.CurrentTag();
+        if (tag >= 0)
+        {
+            tags[tag].allocations.fetch_add(1, std::memory_order_relaxed);
+            tags[tag].bytes.fetch_add(size, std::memory_order_relaxed);
+        }
+    }
+
+    void RecordFree()
+    {
+        ThreadState& thread = threadState;
+        thread.frees++;
+        totalFrees.fetch_add(1, std::memory_order_relaxed);
+
+        int32_t tag = thread.CurrentTag();
+        if (tag >= 0)
+        {
+            tags[tag].frees.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    AllocationCounters Load(const TagCounters& counters)
+    {
+        AllocationCounters result;
+        result.allocations = counters.allocations.load(std::memory_order_relaxed);
+        result.bytes = counters.bytes.load(std::memory_order_relaxed);
+        result.frees = counters.frees.load(std::memory_order_relaxed);
+        return result;
+    }
+
+#if MYTHFORGE_TRACK_ALLOCATIONS
+    void* Allocate(size_t size)
+    {
+        void* memory = malloc(size ? size : 1);
+        if (memory)
+        {
+            RecordAllocation(size);
+        }
+        return memory;
+    }
+
+    void* AllocateAligned(size_t size, size_t alignment)
+    {
+#if defined(_MSC_VER)
+        void* memory = _aligned_malloc(size ? size : 1, alignment);
+#else
+        // aligned_alloc exige un tamaño múltiplo de la alineación.
+        size_t rounded = ((size ? size : 1) + alignment - 1) & ~(alignment - 1);
+        void* memory = aligned_alloc(alignment, rounded);
+#endif
+        if (memory)
+        {
+            RecordAllocation(size);
+        }
+        return memory;
+    }
+
+    void Free(void* memory)
+    {
+        if (!memory) return;
+        RecordFree();
+        free(memory);
+    }
+
+    void FreeAligned(void* memory)
+    {
+        if (!memory) return;
+        RecordFree();
+#if defined(_MSC_VER)
+        _aligned_free(memory);
+#else
+        free(memory);
+#endif
+    }
+#endif
+}
+
+namespace AllocationTracker
+{
+    AllocationCounters Totals()
+    {
+        AllocationCounters result;
+        result.allocations = totalAllocations.load(std::memory_order_relaxed);
+        result.bytes = totalBytes.load(std::memory_order_relaxed);
+        result.frees = totalFrees.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    AllocationCounters ThreadTotals()
+    {
+        const ThreadState& thread = threadState;
+        return { thread.allocations, thread.bytes, thread.frees };
+    }
+
+    void BeginScope(const char* tag)
+    {
+        ThreadState& thread = threadState;
+        if (thread.tagDepth < MaxNesting)
+        {
+            thread.tagStack[thread.tagDepth] = FindOrAddTag(tag);
+        }
+        thread.tagDepth++;
+    }
+
+    void EndScope()
+    {
+        ThreadState& thread = threadState;
+        if (thread.tagDepth > 0)
+        {
+            thread.tagDepth--;
+        }
+    }
+
+    AllocationCounters TagTotals(const char* tag)
+    {
+        int32_t index = FindTag(tag);
+        return index >= 0 ? Load(tags[index]) : AllocationCounters();
+    }
+
+    void WriteReport(std::ostream& stream)
+    {
+        AllocationCounters total = Totals();
+        stream << "tag,allocations,bytes,frees\n";
+        stream << "(total)," << total.allocations << ',' << total.bytes << ',' << total.frees << '\n';
+        for (const TagCounters& tag : tags)
+        {
+            const char* name = tag.name.load(std::memory_order_acquire);
+            if (!name) break;
+            AllocationCounters counters = Load(tag);
+            stream << name << ',' << counters.allocations << ',' << counters.bytes << ',' << counters.frees << '\n';
+        }
+    }
+}
+
+#if MYTHFORGE_TRACK_ALLOCATIONS
+
+void* operator new(size_t size)
+{
+    void* memory = Allocate(size);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new[](size_t size)
+{
+    void* memory = Allocate(size);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return Allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return Allocate(size); }
+
+void operator delete(void* memory) noexcept { Free(memory); }
+void operator delete[](void* memory) noexcept { Free(memory); }
+void operator delete(void* memory, size_t) noexcept { Free(memory); }
+void operator delete[](void* memory, size_t) noexcept { Free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { Free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { Free(memory); }
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    void* memory = AllocateAligned(size, static_cast<size_t>(alignment));
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    void* memory = AllocateAligned(size, static_cast<size_t>(alignment));
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return AllocateAligned(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return AllocateAligned(size, static_cast<size_t>(alignment)); }
+
+void operator delete(void* memory, std::align_val_t) noexcept { FreeAligned(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { FreeAligned(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { FreeAligned(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { FreeAligned(memory); }
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept { FreeAligned(memory); }
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept { FreeAligned(memory); }
+
+#endif
@@ -0,0 +1,72 @@
+﻿/**
+ * @file AllocationTracker.h
+ * @brief Contadores de asignaciones de memoria dinámica de CPU, globales, por hilo y por etiqueta.
+ *
+ * AllocationTracker.cpp sustituye los operadores globales new y delete (todas sus variantes) por
+ * versiones sobre malloc que cuentan asignaciones y bytes. Cada hilo acumula en contadores propios
+ * y los totales globales son atómicos relajados, de modo que leerlos no bloquea. AllocationScope
+ * etiqueta las asignaciones hechas en su ámbito en el hilo actual, para localizar quién asigna.
+ *
+ * Solo se ve lo que pasa por operator new: malloc directo, HeapAlloc o las asignaciones del
+ * runtime de Direct3D quedan fuera.
+ */
+
+#pragma once
+#include <cstdint>
+#include <ostream>
+
+#ifndef MYTHFORGE_TRACK_ALLOCATIONS
+#define MYTHFORGE_TRACK_ALLOCATIONS 1
+#endif
+
+/**
+ * @struct AllocationCounters
+ * @brief Asignaciones, bytes pedidos y liberaciones acumulados.
+ */
+struct AllocationCounters {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+    uint64_t frees = 0;
+
+    AllocationCounters operator-(const AllocationCounters& other) const
+    {
+        return { allocations - other.allocations, bytes - other.bytes, frees - other.frees };
+    }
+};
+
+namespace AllocationTracker
+{
+    /// Totales de todos los hilos desde el arranque.
+    AllocationCounters Totals();
+
+    /// Totales del hilo actual desde que empezó.
+    AllocationCounters ThreadTotals();
+
+    /**
+     * @brief Etiqueta las asignaciones siguientes del hilo actual (nombre con duración estática).
+     *
+     * Las etiquetas se anidan; cuenta la más interna. Caben 64 etiquetas distintas: las demás
+     * solo suman en los totales.
+     */
+    void BeginScope(const char* tag);
+    void EndScope();
+
+    /// Totales acumulados bajo la etiqueta, o ceros si no se ha usado.
+    AllocationCounters TagTotals(const char* tag);
+
+    /// Tabla con los totales y los de cada etiqueta.
+    void WriteReport(std::ostream& stream);
+}
+
+/**
+ * @class AllocationScope
+ * @brief Etiqueta de asignaciones ligada a la vida del objeto.
+ */
+class AllocationScope {
+public:
+    explicit AllocationScope(const char* tag) { AllocationTracker::BeginScope(tag); }
+    ~AllocationScope() { AllocationTracker::EndScope(); }
+
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+};
@@ -0,0 +1,180 @@
+﻿/**
+ * @file AssetLoading.cpp
+ * @brief Implementación de la cola de copia y de las tareas de carga de recursos.
+ */
+
+#include "pch.h"
+#include "AssetLoading.h"
+#include "CommandCapture.h"
+#include "DeviceUtils.h"
+#include "DirectXHelper.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+
+using Microsoft::WRL::ComPtr;
+
+struct UploadQueue::CopyList {
+    ComPtr<ID3D12CommandAllocator>      allocator;
+    ComPtr<ID3D12GraphicsCommandList2>  commandList;
+};
+
+UploadQueue::UploadQueue(ComPtr<ID3D12Device2> device, JobSystem& jobSystem)
+    : device(device), jobSystem(jobSystem)
+{
+    D3D12_COMMAND_QUEUE_DESC desc = {};
+    desc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+    DX::ThrowIfFailed(device->CreateCommandQueue(&desc, IID_PPV_ARGS(&queue)));
+    NAME_D3D12_OBJECT(queue);
+
+    fence = CreateFence(device);
+    fenceEvent = CreateEventHandle();
+    retireThread = std::thread(&UploadQueue::RetireLoop, this);
+}
+
+UploadQueue::~UploadQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    retireThread.join();
+    CloseHandle(fenceEvent);
+}
+
+UploadQueue::CopyAwaiter UploadQueue::Copy(const std::function<void(ID3D12GraphicsCommandList2*)>& record)
+{
+    CopyList* list = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!freeLists.empty())
+        {
+            list = freeLists.back();
+            freeLists.pop_back();
+        }
+        else
+        {
+            lists.push_back(std::make_unique<CopyList>());
+            list = lists.back().get();
+        }
+    }
+
+    // Una lista libre ya no está en la GPU: el hilo de retirada solo la devuelve tras su valla.
+    if (!list->allocator)
+    {
+        DX::ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&list->allocator)));
+        DX::ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, list->allocator.Get(), nullptr, IID_PPV_ARGS(&list->commandList)));
+    }
+    else
+    {
+        DX::ThrowIfFailed(list->allocator->Reset());
+        DX::ThrowIfFailed(list->commandList->Reset(list->allocator.Get(), nullptr));
+    }
+
+    try
+    {
+        record(list->commandList.Get());
+    }
+    catch (...)
+    {
+        list->commandList->Close();
+        std::lock_guard<std::mutex> lock(mutex);
+        freeLists.push_back(list);
+        throw;
+    }
+    DX::ThrowIfFailed(list->commandList->Close());
+    return { *this, list };
+}
+
+void UploadQueue::Execute(CopyList* list, TaskDetail::coroutine_handle<> continuation)
+{
+    {
+        // Envío y valla con el mutex tomado: la cola de retirada queda en el mismo orden que las vallas.
+        std::lock_guard<std::mutex> lock(mutex);
+        ID3D12CommandList* const commandLists[] = { list->commandList.Get() };
+        queue->ExecuteCommandLists(_countof(commandLists), commandLists);
+        UINT64 value = Signal(queue, fence, fenceValue);
+        pending.push_back({ value, list, continuation });
+    }
+    wake.notify_one();
+}
+
+void UploadQueue::RetireLoop()
+{
+    Profiler::SetThreadName("Upload");
+    for (;;)
+    {
+        PendingCopy copy;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() { return stopping || !pending.empty(); });
+            if (pending.empty()) return;
+            copy = pending.front();
+            pending.pop_front();
+        }
+
+        WaitForFenceValue(fence, copy.fenceValue, fenceEvent);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            freeLists.push_back(copy.list);
+        }
+        jobSystem.Submit([continuation = copy.continuation]() { continuation.resume(); });
+    }
+}
+
+namespace AssetLoading
+{
+    Task<ComPtr<ID3D12Resource>> UploadBuffer(UploadQueue& uploads, const void* data, size_t numElements, size_t elementSize, MemoryCategory category)
+    {
+        co_await ResumeOn(uploads.Jobs());
+
+        ComPtr<ID3D12Resource> buffer;
+        ComPtr<ID3D12Resource> upload;
+        co_await uploads.Copy([&](ID3D12GraphicsCommandList2* commandList) {
+            UpdateBufferResource(uploads.Device(), commandList, buffer, upload, numElements, elementSize, data, category);
+        });
+        co_return buffer;
+    }
+
+    Task<TextureUpload> UploadTexture(UploadQueue& uploads, std::filesystem::path path, DXGI_FORMAT srvFormat)
+    {
+        std::vector<uint8_t> file = co_await ReadFile(uploads.Jobs(), path);
+
+        TextureUpload result;
+        std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+        DX::ThrowIfFailed(DirectX::LoadDDSTextureFromMemory(uploads.Device(), file.data(), file.size(), result.texture.ReleaseAndGetAddressOf(), subresources));
+        TrackResource(result.texture, MemoryCategory::Textures);
+        UINT subresourceCount = static_cast<UINT>(subresources.size());
+        CommandCapture::RegisterTexture(result.texture.Get(), D3D12_RESOURCE_STATE_COMMON, subresources.data(), subresourceCount);
+
+        ComPtr<ID3D12Resource> upload;
+        UINT64 uploadSize = GetRequiredIntermediateSize(result.texture.Get(), 0, subresourceCount);
+        DX::ThrowIfFailed(uploads.Device()->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &CD3DX12_RESOURCE_DESC::Buffer(uploadSize), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&upload)));
+        TrackResource(upload, MemoryCategory::Upload);
+
+        co_await uploads.Copy([&](ID3D12GraphicsCommandList2* commandList) {
+            UpdateSubresources(commandList, result.texture.Get(), upload.Get(), 0, 0, subresourceCount, subresources.data());
+            RenderStats::Add(RenderCounter::CopyCommands, subresources.size());
+            RenderStats::Add(RenderCounter::UploadBytes, uploadSize);
+        });
+
+        result.srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+        result.srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        result.srvDesc.Format = srvFormat;
+        result.srvDesc.Texture2D.MipLevels = subresourceCount;
+        result.srvDesc.Texture2D.MostDetailedMip = 0;
+        result.srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
+        co_return result;
+    }
+
+    Task<ComPtr<ID3D12PipelineState>> CompilePSO(JobSystem& jobSystem, ComPtr<ID3D12Device2> device, D3D12_GRAPHICS_PIPELINE_STATE_DESC desc)
+    {
+        co_await ResumeOn(jobSystem);
+        PROFILE_SCOPE("CompilePSO");
+
+        ComPtr<ID3D12PipelineState> pipeline;
+        DX::ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pipeline)));
+        CommandCapture::RegisterPipeline(pipeline.Get(), desc);
+        co_return pipeline;
+    }
+}
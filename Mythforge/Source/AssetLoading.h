@@ -0,0 +1,116 @@
+﻿/**
+ * @file AssetLoading.h
+ * @brief Subidas a GPU y creación de PSO como Task, sobre una cola de copia propia.
+ *
+ * UploadQueue graba cada subida en su propia lista de copia y la envía a una cola COPY distinta
+ * de la de render. Un hilo de retirada espera las vallas en orden y reanuda cada corrutina en el
+ * JobSystem cuando la GPU ha terminado su copia; hasta entonces el recurso intermedio vive en el
+ * marco de la corrutina. Los recursos que pasan por la cola de copia vuelven a COMMON al acabar
+ * y el primer uso en la cola de render los promociona solos, así que no hace falta ninguna barrera.
+ *
+ * Con esto, la carga de un recurso se escribe en secuencia:
+ *
+ *     TextureUpload crate = co_await AssetLoading::UploadTexture(uploads, L"Assets/crate/crate.dds");
+ */
+
+#pragma once
+#include <d3d12.h>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <wrl.h>
+#include "AsyncFile.h"
+#include "MemoryTracker.h"
+#include "Task.h"
+
+/**
+ * @class UploadQueue
+ * @brief Cola de copia para las cargas, con esperas de valla que reanudan en el JobSystem.
+ *
+ * Se destruye cuando ya no queda ninguna carga en marcha; el destructor espera a la GPU.
+ */
+class UploadQueue {
+public:
+    UploadQueue(Microsoft::WRL::ComPtr<ID3D12Device2> device, JobSystem& jobSystem);
+    ~UploadQueue();
+
+    UploadQueue(const UploadQueue&) = delete;
+    UploadQueue& operator=(const UploadQueue&) = delete;
+
+    ID3D12Device2* Device() const { return device.Get(); }
+    JobSystem& Jobs() const { return jobSystem; }
+
+    struct CopyList;
+
+    /**
+     * @struct CopyAwaiter
+     * @brief Envía la lista grabada al suspender y sigue en el JobSystem cuando la GPU la ha ejecutado.
+     */
+    struct CopyAwaiter {
+        UploadQueue& queue;
+        CopyList*    list;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(TaskDetail::coroutine_handle<> handle) { queue.Execute(list, handle); }
+        void await_resume() const noexcept {}
+    };
+
+    /// Graba record en una lista de copia en el hilo que llama; la lista se envía al esperar el resultado.
+    CopyAwaiter Copy(const std::function<void(ID3D12GraphicsCommandList2*)>& record);
+
+private:
+    struct PendingCopy {
+        UINT64                          fenceValue;
+        CopyList*                       list;
+        TaskDetail::coroutine_handle<>  continuation;
+    };
+
+    void Execute(CopyList* list, TaskDetail::coroutine_handle<> continuation);
+    void RetireLoop();
+
+    Microsoft::WRL::ComPtr<ID3D12Device2>       device;
+    JobSystem&                                  jobSystem;
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue>  queue;
+    Microsoft::WRL::ComPtr<ID3D12Fence>         fence;
+    UINT64                                      fenceValue = 0;
+    HANDLE                                      fenceEvent;
+
+    std::mutex                                  mutex;              ///< Protege las listas, el envío y la cola de retirada
+    std::condition_variable                     wake;
+    std::vector<std::unique_ptr<CopyList>>      lists;              ///< Todas las creadas; crecen con las copias en vuelo
+    std::vector<CopyList*>                      freeLists;          ///< Las que la GPU ya terminó
+    std::deque<PendingCopy>                     pending;            ///< En orden de valla
+    bool                                        stopping = false;
+    std::thread                                 retireThread;
+};
+
+/**
+ * @struct TextureUpload
+ * @brief Textura ya copiada en GPU y la vista que le corresponde.
+ */
+struct TextureUpload {
+    Microsoft::WRL::ComPtr<ID3D12Resource> texture;
+    D3D12_SHADER_RESOURCE_VIEW_DESC        srvDesc = {};
+};
+
+namespace AssetLoading
+{
+    /// Búfer de GPU con los datos copiados. data tiene que seguir vivo hasta que la tarea acabe.
+    Task<Microsoft::WRL::ComPtr<ID3D12Resource>> UploadBuffer(UploadQueue& uploads, const void* data, size_t numElements, size_t elementSize, MemoryCategory category = MemoryCategory::VertexIndex);
+
+    /// Lee el DDS, crea la textura y la copia entera con todos sus niveles de mip.
+    Task<TextureUpload> UploadTexture(UploadQueue& uploads, std::filesystem::path path, DXGI_FORMAT srvFormat = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB);
+
+    /**
+     * @brief Crea el PSO en un hilo del JobSystem y lo registra en CommandCapture.
+     *
+     * Los punteros del descriptor (shaders, input layout, firma raíz) tienen que seguir vivos hasta
+     * que la tarea acabe; lo normal es que sean locales de la corrutina que la espera.
+     */
+    Task<Microsoft::WRL::ComPtr<ID3D12PipelineState>> CompilePSO(JobSystem& jobSystem, Microsoft::WRL::ComPtr<ID3D12Device2> device, D3D12_GRAPHICS_PIPELINE_STATE_DESC desc);
+}
@@ -0,0 +1,33 @@
+﻿/**
+ * @file AsyncFile.cpp
+ * @brief Implementación de la lectura de ficheros en el JobSystem.
+ */
+
+#include "pch.h"
+#include "AsyncFile.h"
+#include "Profiler.h"
+#include <fstream>
+#include <stdexcept>
+
+namespace AssetLoading
+{
+    Task<std::vector<uint8_t>> ReadFile(JobSystem& jobSystem, std::filesystem::path path)
+    {
+        co_await ResumeOn(jobSystem);
+        PROFILE_SCOPE("ReadFile");
+
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+        {
+            throw std::runtime_error("No se puede abrir " + path.string());
+        }
+
+        std::vector<uint8_t> data(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        if (!file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())))
+        {
+            throw std::runtime_error("No se puede leer " + path.string());
+        }
+        co_return data;
+    }
+}
@@ -0,0 +1,22 @@
+﻿/**
+ * @file AsyncFile.h
+ * @brief Lectura de ficheros como Task que se reanuda en el JobSystem.
+ *
+ * Sustituye a DX::ReadDataAsync, que pasa por StorageFile de WinRT y solo encadena con then. Las
+ * rutas relativas parten de la carpeta de instalación, que es el directorio de trabajo de la app.
+ */
+
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+#include "Task.h"
+
+namespace AssetLoading
+{
+    /**
+     * @brief Contenido completo del fichero. La lectura ocupa un hilo del JobSystem y la tarea sigue en él.
+     * @throws std::runtime_error si el fichero no se puede abrir o leer entero.
+     */
+    Task<std::vector<uint8_t>> ReadFile(JobSystem& jobSystem, std::filesystem::path path);
+}
@@ -0,0 +1,657 @@
+﻿/**
+ * @file Bvh.cpp
+ * @brief Implementación de la jerarquía de cuatro hijos: construcción SAH por cubetas, colapso, reajuste y consultas.
+ */
+
+#include "pch.h"
+#include "Bvh.h"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <numeric>
+
+namespace
+{
+    constexpr uint32_t TraversalStackSize = 512;
+    constexpr uint32_t RangeBlockSize = 4096;
+
+    struct RangeInfo {
+        XMVECTOR boxMin;
+        XMVECTOR boxMax;
+        XMVECTOR centroidMin;
+        XMVECTOR centroidMax;
+    };
+
+    struct Bin {
+        XMVECTOR boxMin;
+        XMVECTOR boxMax;
+        uint32_t count;
+    };
+
+    using BinArray = std::array<Bin, Bvh4::BinCount>;
+
+    RangeInfo EmptyRange()
+    {
+        RangeInfo info;
+        info.boxMin = XMVectorReplicate(FLT_MAX);
+        info.boxMax = XMVectorReplicate(-FLT_MAX);
+        info.centroidMin = info.boxMin;
+        info.centroidMax = info.boxMax;
+        return info;
+    }
+
+    void ClearBins(BinArray& bins)
+    {
+        for (Bin& bin : bins)
+        {
+            bin.boxMin = XMVectorReplicate(FLT_MAX);
+            bin.boxMax = XMVectorReplicate(-FLT_MAX);
+            bin.count = 0;
+        }
+    }
+
+    float SurfaceArea(FXMVECTOR boxMin, FXMVECTOR boxMax)
+    {
+        XMFLOAT3 size;
+        XMStoreFloat3(&size, XMVectorMax(XMVectorSubtract(boxMax, boxMin), XMVectorZero()));
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    float SurfaceArea(const XMFLOAT3& extents)
+    {
+        if (extents.x < 0.0f) return 0.0f;
+        return 8.0f * (extents.x * extents.y + extents.y * extents.z + extents.z * extents.x);
+    }
+
+    float Component(FXMVECTOR v, int axis)
+    {
+        XMFLOAT3 values;
+        XMStoreFloat3(&values, v);
+        return (&values.x)[axis];
+    }
+
+    void SetLane(AabbBlock& block, uint32_t lane, FXMVECTOR boxMin, FXMVECTOR boxMax)
+    {
+        XMFLOAT3 center;
+        XMFLOAT3 extents;
+        XMStoreFloat3(&center, XMVectorScale(XMVectorAdd(boxMin, boxMax), 0.5f));
+        XMStoreFloat3(&extents, XMVectorScale(XMVectorSubtract(boxMax, boxMin), 0.5f));
+        block.centerX[lane] = center.x;
+        block.centerY[lane] = center.y;
+        block.centerZ[lane] = center.z;
+        block.extentX[lane] = extents.x;
+        block.extentY[lane] = extents.y;
+        block.extentZ[lane] = extents.z;
+    }
+
+    void LaneBox(const AabbBlock& block, uint32_t lane, XMVECTOR& boxMin, XMVECTOR& boxMax)
+    {
+        XMVECTOR center = XMVectorSet(block.centerX[lane], block.centerY[lane], block.centerZ[lane], 0.0f);
+        XMVECTOR extents = XMVectorSet(block.extentX[lane], block.extentY[lane], block.extentZ[lane], 0.0f);
+        boxMin = XMVectorSubtract(center, extents);
+        boxMax = XMVectorAdd(center, extents);
+    }
+
+    inline XMVECTOR Load4(const float* values)
+    {
+        return XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(values));
+    }
+
+    // Distancia de entrada de un rayo en una caja por el método de las franjas; false si no la atraviesa.
+    bool IntersectRayBox(const XMFLOAT3& center, const XMFLOAT3& extents, const XMFLOAT3& origin, const XMFLOAT3& inverseDirection, float maxDistance, float& distance)
+    {
+        float tMin = 0.0f;
+        float tMax = maxDistance;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float c = (&center.x)[axis];
+            float e = (&extents.x)[axis];
+            float o = (&origin.x)[axis];
+            float inv = (&inverseDirection.x)[axis];
+            float t1 = (c - e - o) * inv;
+            float t2 = (c + e - o) * inv;
+            tMin = (std::max)(tMin, (std::min)(t1, t2));
+            tMax = (std::min)(tMax, (std::max)(t1, t2));
+        }
+        distance = tMin;
+        return tMin <= tMax;
+    }
+}
+
+void Bvh4::Build(const CullingBounds& bounds, JobSystem* jobSystem)
+{
+    nodes.clear();
+    orderedBounds.Clear();
+
+    uint32_t count = bounds.count;
+    primitiveIndices.resize(count);
+    std::iota(primitiveIndices.begin(), primitiveIndices.end(), 0u);
+    if (count == 0) return;
+
+    buildPrimitives.resize(count);
+    auto preparePrimitives = [this, &bounds](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            XMFLOAT3 center = bounds.Center(i);
+            XMFLOAT3 extents = bounds.Extents(i);
+            XMVECTOR c = XMLoadFloat3(&center);
+            XMVECTOR e = XMLoadFloat3(&extents);
+            XMStoreFloat3(&buildPrimitives[i].boxMin, XMVectorSubtract(c, e));
+            XMStoreFloat3(&buildPrimitives[i].boxMax, XMVectorAdd(c, e));
+            buildPrimitives[i].centroid = center;
+        }
+    };
+    if (jobSystem)
+    {
+        jobSystem->ParallelFor(count, RangeBlockSize, preparePrimitives);
+    }
+    else
+    {
+        preparePrimitives(0, count);
+    }
+
+    // Un árbol binario con al menos un primitivo por hoja tiene como mucho 2n - 1 nodos.
+    buildNodes.resize(2 * static_cast<size_t>(count));
+    buildNodeCount.store(1);
+    BuildRange(jobSystem, 0, 0, count, 0);
+
+    nodes.reserve(buildNodeCount.load() / 2 + 1);
+    Collapse(0);
+
+    for (uint32_t index : primitiveIndices)
+    {
+        orderedBounds.Add(bounds.Center(index), bounds.Extents(index));
+    }
+
+    buildNodes.clear();
+}
+
+void Bvh4::BuildRange(JobSystem* jobSystem, uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t depth)
+{
+    bool parallel = jobSystem != nullptr && count >= ParallelThreshold;
+    uint32_t* indices = primitiveIndices.data() + first;
+
+    // Cajas del rango y de sus centroides.
+    auto accumulateRange = [this, indices](uint32_t begin, uint32_t end, RangeInfo& info) {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            const BuildPrimitive& primitive = buildPrimitives[indices[i]];
+            XMVECTOR centroid = XMLoadFloat3(&primitive.centroid);
+            info.boxMin = XMVectorMin(info.boxMin, XMLoadFloat3(&primitive.boxMin));
+            info.boxMax = XMVectorMax(info.boxMax, XMLoadFloat3(&primitive.boxMax));
+            info.centroidMin = XMVectorMin(info.centroidMin, centroid);
+            info.centroidMax = XMVectorMax(info.centroidMax, centroid);
+        }
+    };
+
+    RangeInfo range = EmptyRange();
+    if (parallel)
+    {
+        uint32_t blocks = (count + RangeBlockSize - 1) / RangeBlockSize;
+        std::vector<RangeInfo> partial(blocks, EmptyRange());
+        jobSystem->ParallelFor(blocks, 1, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t block = begin; block < end; block++)
+            {
+                accumulateRange(block * RangeBlockSize, (std::min)((block + 1) * RangeBlockSize, count), partial[block]);
+            }
+        });
+        for (const RangeInfo& info : partial)
+        {
+            range.boxMin = XMVectorMin(range.boxMin, info.boxMin);
+            range.boxMax = XMVectorMax(range.boxMax, info.boxMax);
+            range.centroidMin = XMVectorMin(range.centroidMin, info.centroidMin);
+            range.centroidMax = XMVectorMax(range.centroidMax, info.centroidMax);
+        }
+    }
+    else
+    {
+        accumulateRange(0, count, range);
+    }
+
+    BuildNode& node = buildNodes[nodeIndex];
+    XMStoreFloat3(&node.boxMin, range.boxMin);
+    XMStoreFloat3(&node.boxMax, range.boxMax);
+    node.left = 0;
+    node.first = first;
+    node.count = count;
+
+    if (count == 1) return;
+
+    XMFLOAT3 spread;
+    XMStoreFloat3(&spread, XMVectorSubtract(range.centroidMax, range.centroidMin));
+    int axis = (spread.x >= spread.y && spread.x >= spread.z) ? 0 : (spread.y >= spread.z ? 1 : 2);
+    float axisMin = Component(range.centroidMin, axis);
+    float axisSpread = (&spread.x)[axis];
+
+    uint32_t middle = first;
+    bool medianSplit = axisSpread <= 0.0f || depth >= MaxSahDepth;
+
+    if (!medianSplit)
+    {
+        float binScale = BinCount * (1.0f - 1e-5f) / axisSpread;
+        auto binOf = [this, axis, axisMin, binScale](uint32_t primitive) {
+            float centroid = (&buildPrimitives[primitive].centroid.x)[axis];
+            return (std::min)(static_cast<uint32_t>((centroid - axisMin) * binScale), BinCount - 1);
+        };
+
+        auto accumulateBins = [this, indices, &binOf](uint32_t begin, uint32_t end, BinArray& bins) {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                const BuildPrimitive& primitive = buildPrimitives[indices[i]];
+                Bin& bin = bins[binOf(indices[i])];
+                bin.boxMin = XMVectorMin(bin.boxMin, XMLoadFloat3(&primitive.boxMin));
+                bin.boxMax = XMVectorMax(bin.boxMax, XMLoadFloat3(&primitive.boxMax));
+                bin.count++;
+            }
+        };
+
+        BinArray bins;
+        ClearBins(bins);
+        if (parallel)
+        {
+            uint32_t blocks = (count + RangeBlockSize - 1) / RangeBlockSize;
+            std::vector<BinArray> partial(blocks);
+            jobSystem->ParallelFor(blocks, 1, [&](uint32_t begin, uint32_t end) {
+                for (uint32_t block = begin; block < end; block++)
+                {
+                    ClearBins(partial[block]);
+                    accumulateBins(block * RangeBlockSize, (std::min)((block + 1) * RangeBlockSize, count), partial[block]);
+                }
+            });
+            for (const BinArray& blockBins : partial)
+            {
+                for (uint32_t b = 0; b < BinCount; b++)
+                {
+                    bins[b].boxMin = XMVectorMin(bins[b].boxMin, blockBins[b].boxMin);
+                    bins[b].boxMax = XMVectorMax(bins[b].boxMax, blockBins[b].boxMax);
+                    bins[b].count += blockBins[b].count;
+                }
+            }
+        }
+        else
+        {
+            accumulateBins(0, count, bins);
+        }
+
+        // Barrido desde la derecha para tener el área y el número de primitivos de cada partición derecha.
+        float rightArea[BinCount];
+        uint32_t rightCount[BinCount];
+        XMVECTOR sweepMin = XMVectorReplicate(FLT_MAX);
+        XMVECTOR sweepMax = XMVectorReplicate(-FLT_MAX);
+        uint32_t sweepCount = 0;
+        for (uint32_t b = BinCount - 1; b > 0; b--)
+        {
+            sweepMin = XMVectorMin(sweepMin, bins[b].boxMin);
+            sweepMax = XMVectorMax(sweepMax, bins[b].boxMax);
+            sweepCount += bins[b].count;
+            rightArea[b] = SurfaceArea(sweepMin, sweepMax);
+            rightCount[b] = sweepCount;
+        }
+
+        // Coste SAH con coste de recorrido e intersección unitarios; la división b deja [0, b) a la izquierda.
+        float parentArea = (std::max)(SurfaceArea(range.boxMin, range.boxMax), FLT_MIN);
+        float bestCost = FLT_MAX;
+        uint32_t bestSplit = 0;
+        sweepMin = XMVectorReplicate(FLT_MAX);
+        sweepMax = XMVectorReplicate(-FLT_MAX);
+        sweepCount = 0;
+        for (uint32_t b = 1; b < BinCount; b++)
+        {
+            sweepMin = XMVectorMin(sweepMin, bins[b - 1].boxMin);
+            sweepMax = XMVectorMax(sweepMax, bins[b - 1].boxMax);
+            sweepCount += bins[b - 1].count;
+            if (sweepCount == 0 || rightCount[b] == 0) continue;
+
+            float cost = 1.0f + (SurfaceArea(sweepMin, sweepMax) * sweepCount + rightArea[b] * rightCount[b]) / parentArea;
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestSplit = b;
+            }
+        }
+
+        if (count <= MaxLeafSize && bestCost >= static_cast<float>(count)) return;
+
+        if (bestSplit != 0)
+        {
+            uint32_t* split = std::partition(indices, indices + count, [&binOf, bestSplit](uint32_t primitive) {
+                return binOf(primitive) < bestSplit;
+            });
+            middle = first + static_cast<uint32_t>(split - indices);
+        }
+        medianSplit = middle == first || middle == first + count;
+    }
+    else if (count <= MaxLeafSize)
+    {
+        return;
+    }
+
+    if (medianSplit)
+    {
+        middle = first + count / 2;
+        std::nth_element(indices, indices + count / 2, indices + count, [this, axis](uint32_t a, uint32_t b) {
+            return (&buildPrimitives[a].centroid.x)[axis] < (&buildPrimitives[b].centroid.x)[axis];
+        });
+    }
+
+    uint32_t left = buildNodeCount.fetch_add(2);
+    buildNodes[nodeIndex].left = left;
+
+    if (parallel)
+    {
+        jobSystem->ParallelFor(2, 1, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t side = begin; side < end; side++)
+            {
+                if (side == 0) BuildRange(jobSystem, left, first, middle - first, depth + 1);
+                else BuildRange(jobSystem, left + 1, middle, first + count - middle, depth + 1);
+            }
+        });
+    }
+    else
+    {
+        BuildRange(jobSystem, left, first, middle - first, depth + 1);
+        BuildRange(jobSystem, left + 1, middle, first + count - middle, depth + 1);
+    }
+}
+
+uint32_t Bvh4::Collapse(uint32_t buildNode)
+{
+    // Se abren los hijos interiores de mayor área hasta reunir cuatro hijos.
+    uint32_t entries[4];
+    uint32_t entryCount = 0;
+    if (buildNodes[buildNode].left == 0)
+    {
+        entries[entryCount++] = buildNode;
+    }
+    else
+    {
+        entries[entryCount++] = buildNodes[buildNode].left;
+        entries[entryCount++] = buildNodes[buildNode].left + 1;
+    }
+
+    while (entryCount < 4)
+    {
+        int widest = -1;
+        float widestArea = -1.0f;
+        for (uint32_t i = 0; i < entryCount; i++)
+        {
+            const BuildNode& entry = buildNodes[entries[i]];
+            if (entry.left == 0) continue;
+
+            float area = SurfaceArea(XMLoadFloat3(&entry.boxMin), XMLoadFloat3(&entry.boxMax));
+            if (area > widestArea)
+            {
+                widestArea = area;
+                widest = static_cast<int>(i);
+            }
+        }
+        if (widest < 0) break;
+
+        uint32_t opened = buildNodes[entries[widest]].left;
+        entries[widest] = opened;
+        entries[entryCount++] = opened + 1;
+    }
+
+    uint32_t nodeIndex = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+    {
+        Bvh4Node& node = nodes[nodeIndex];
+        for (uint32_t lane = 0; lane < 4; lane++)
+        {
+            node.bounds.centerX[lane] = node.bounds.centerY[lane] = node.bounds.centerZ[lane] = 0.0f;
+            node.bounds.extentX[lane] = node.bounds.extentY[lane] = node.bounds.extentZ[lane] = -FLT_MAX;
+            node.child[lane] = Bvh4Node::EmptyChild;
+            node.first[lane] = 0;
+            node.count[lane] = 0;
+        }
+    }
+
+    for (uint32_t lane = 0; lane < entryCount; lane++)
+    {
+        const BuildNode& entry = buildNodes[entries[lane]];
+        uint32_t child = entry.left == 0 ? Bvh4Node::LeafChild : Collapse(entries[lane]);
+
+        // Collapse puede haber realojado el vector de nodos.
+        Bvh4Node& node = nodes[nodeIndex];
+        SetLane(node.bounds, lane, XMLoadFloat3(&entry.boxMin), XMLoadFloat3(&entry.boxMax));
+        node.child[lane] = child;
+        node.first[lane] = entry.first;
+        node.count[lane] = entry.count;
+    }
+
+    return nodeIndex;
+}
+
+void Bvh4::Refit(const CullingBounds& bounds)
+{
+    if (bounds.count != primitiveIndices.size())
+    {
+        Build(bounds);
+        return;
+    }
+
+    for (uint32_t i = 0; i < bounds.count; i++)
+    {
+        uint32_t index = primitiveIndices[i];
+        orderedBounds.Set(i, bounds.Center(index), bounds.Extents(index));
+    }
+
+    // Los hijos siempre tienen un índice mayor que el padre, así que basta un recorrido inverso.
+    for (size_t i = nodes.size(); i-- > 0;)
+    {
+        Bvh4Node& node = nodes[i];
+        for (uint32_t lane = 0; lane < 4; lane++)
+        {
+            if (node.child[lane] == Bvh4Node::EmptyChild) continue;
+
+            XMVECTOR boxMin = XMVectorReplicate(FLT_MAX);
+            XMVECTOR boxMax = XMVectorReplicate(-FLT_MAX);
+            if (node.child[lane] == Bvh4Node::LeafChild)
+            {
+                for (uint32_t p = node.first[lane]; p < node.first[lane] + node.count[lane]; p++)
+                {
+                    XMFLOAT3 center = orderedBounds.Center(p);
+                    XMFLOAT3 extents = orderedBounds.Extents(p);
+                    XMVECTOR c = XMLoadFloat3(&center);
+                    XMVECTOR e = XMLoadFloat3(&extents);
+                    boxMin = XMVectorMin(boxMin, XMVectorSubtract(c, e));
+                    boxMax = XMVectorMax(boxMax, XMVectorAdd(c, e));
+                }
+            }
+            else
+            {
+                const Bvh4Node& child = nodes[node.child[lane]];
+                for (uint32_t childLane = 0; childLane < 4; childLane++)
+                {
+                    if (child.child[childLane] == Bvh4Node::EmptyChild) continue;
+
+                    XMVECTOR childMin;
+                    XMVECTOR childMax;
+                    LaneBox(child.bounds, childLane, childMin, childMax);
+                    boxMin = XMVectorMin(boxMin, childMin);
+                    boxMax = XMVectorMax(boxMax, childMax);
+                }
+            }
+            SetLane(node.bounds, lane, boxMin, boxMax);
+        }
+    }
+}
+
+void Bvh4::AppendRange(uint32_t first, uint32_t count, std::vector<uint32_t>& visible) const
+{
+    visible.insert(visible.end(), primitiveIndices.begin() + first, primitiveIndices.begin() + first + count);
+}
+
+void Bvh4::CullFrustum(const Frustum& frustum, std::vector<uint32_t>& visible, CullingStats* stats) const
+{
+    if (nodes.empty()) return;
+
+    FrustumLanes lanes = PrepareFrustumLanes(frustum);
+    size_t visibleBefore = visible.size();
+    uint32_t objectsTested = 0;
+    uint32_t nodesVisited = 0;
+
+    uint32_t stack[TraversalStackSize];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const Bvh4Node& node = nodes[stack[--stackSize]];
+        nodesVisited++;
+
+        uint32_t insideMask;
+        uint32_t visibleMask = TestAabbBlock(lanes, node.bounds, &insideMask);
+
+        for (uint32_t lane = 0; lane < 4; lane++)
+        {
+            if (!(visibleMask & (1u << lane))) continue;
+
+            if (insideMask & (1u << lane))
+            {
+                AppendRange(node.first[lane], node.count[lane], visible);
+            }
+            else if (node.child[lane] == Bvh4Node::LeafChild)
+            {
+                uint32_t first = node.first[lane];
+                uint32_t end = first + node.count[lane];
+                for (uint32_t block = first >> 2; block * 4 < end; block++)
+                {
+                    uint32_t mask = TestAabbBlock(lanes, orderedBounds.blocks[block]);
+                    for (uint32_t blockLane = 0; blockLane < 4; blockLane++)
+                    {
+                        uint32_t ordered = block * 4 + blockLane;
+                        if ((mask & (1u << blockLane)) && ordered >= first && ordered < end)
+                        {
+                            visible.push_back(primitiveIndices[ordered]);
+                        }
+                    }
+                }
+                objectsTested += node.count[lane];
+            }
+            else
+            {
+                stack[stackSize++] = node.child[lane];
+            }
+        }
+    }
+
+    if (stats)
+    {
+        stats->objectsTested += objectsTested;
+        stats->nodesVisited += nodesVisited;
+        stats->visible += static_cast<uint32_t>(visible.size() - visibleBefore);
+    }
+}
+
+bool Bvh4::Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, RayHit& hit) const
+{
+    if (nodes.empty()) return false;
+
+    // Se evitan divisiones por cero para que las franjas paralelas al rayo den infinitos con signo.
+    XMFLOAT3 inverseDirection;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float d = (&direction.x)[axis];
+        if (fabsf(d) < 1e-20f) d = d < 0.0f ? -1e-20f : 1e-20f;
+        (&inverseDirection.x)[axis] = 1.0f / d;
+    }
+
+    XMVECTOR ox = XMVectorReplicate(origin.x);
+    XMVECTOR oy = XMVectorReplicate(origin.y);
+    XMVECTOR oz = XMVectorReplicate(origin.z);
+    XMVECTOR ix = XMVectorReplicate(inverseDirection.x);
+    XMVECTOR iy = XMVectorReplicate(inverseDirection.y);
+    XMVECTOR iz = XMVectorReplicate(inverseDirection.z);
+
+    bool found = false;
+    float closest = maxDistance;
+
+    uint32_t stack[TraversalStackSize];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const Bvh4Node& node = nodes[stack[--stackSize]];
+
+        XMVECTOR cx = Load4(node.bounds.centerX);
+        XMVECTOR cy = Load4(node.bounds.centerY);
+        XMVECTOR cz = Load4(node.bounds.centerZ);
+        XMVECTOR ex = Load4(node.bounds.extentX);
+        XMVECTOR ey = Load4(node.bounds.extentY);
+        XMVECTOR ez = Load4(node.bounds.extentZ);
+
+        XMVECTOR t1x = XMVectorMultiply(XMVectorSubtract(XMVectorSubtract(cx, ex), ox), ix);
+        XMVECTOR t2x = XMVectorMultiply(XMVectorSubtract(XMVectorAdd(cx, ex), ox), ix);
+        XMVECTOR t1y = XMVectorMultiply(XMVectorSubtract(XMVectorSubtract(cy, ey), oy), iy);
+        XMVECTOR t2y = XMVectorMultiply(XMVectorSubtract(XMVectorAdd(cy, ey), oy), iy);
+        XMVECTOR t1z = XMVectorMultiply(XMVectorSubtract(XMVectorSubtract(cz, ez), oz), iz);
+        XMVECTOR t2z = XMVectorMultiply(XMVectorSubtract(XMVectorAdd(cz, ez), oz), iz);
+
+        XMVECTOR tEnter = XMVectorMax(XMVectorMax(XMVectorMin(t1x, t2x), XMVectorMin(t1y, t2y)), XMVectorMax(XMVectorMin(t1z, t2z), XMVectorZero()));
+        XMVECTOR tExit = XMVectorMin(XMVectorMin(XMVectorMax(t1x, t2x), XMVectorMax(t1y, t2y)), XMVectorMax(t1z, t2z));
+        XMVECTOR hits = XMVectorAndInt(XMVectorLessOrEqual(tEnter, tExit), XMVectorLess(tEnter, XMVectorReplicate(closest)));
+        uint32_t hitMask = VectorLaneMask(hits);
+
+        for (uint32_t lane = 0; lane < 4; lane++)
+        {
+            if (!(hitMask & (1u << lane)) || node.child[lane] == Bvh4Node::EmptyChild) continue;
+
+            if (node.child[lane] == Bvh4Node::LeafChild)
+            {
+                for (uint32_t p = node.first[lane]; p < node.first[lane] + node.count[lane]; p++)
+                {
+                    float distance;
+                    if (IntersectRayBox(orderedBounds.Center(p), orderedBounds.Extents(p), origin, inverseDirection, closest, distance))
+                    {
+                        closest = distance;
+                        hit.primitive = primitiveIndices[p];
+                        hit.distance = distance;
+                        found = true;
+                    }
+                }
+            }
+            else
+            {
+                stack[stackSize++] = node.child[lane];
+            }
+        }
+    }
+
+    return found;
+}
+
+float Bvh4::SahCost() const
+{
+    if (nodes.empty()) return 0.0f;
+
+    const Bvh4Node& root = nodes[0];
+    XMVECTOR rootMin = XMVectorReplicate(FLT_MAX);
+    XMVECTOR rootMax = XMVectorReplicate(-FLT_MAX);
+    for (uint32_t lane = 0; lane < 4; lane++)
+    {
+        if (root.child[lane] == Bvh4Node::EmptyChild) continue;
+
+        XMVECTOR laneMin;
+        XMVECTOR laneMax;
+        LaneBox(root.bounds, lane, laneMin, laneMax);
+        rootMin = XMVectorMin(rootMin, laneMin);
+        rootMax = XMVectorMax(rootMax, laneMax);
+    }
+
+    float rootArea = (std::max)(SurfaceArea(rootMin, rootMax), FLT_MIN);
+    float cost = 1.0f;
+    for (const Bvh4Node& node : nodes)
+    {
+        for (uint32_t lane = 0; lane < 4; lane++)
+        {
+            if (node.child[lane] == Bvh4Node::EmptyChild) continue;
+
+            XMFLOAT3 extents(node.bounds.extentX[lane], node.bounds.extentY[lane], node.bounds.extentZ[lane]);
+            float weight = node.child[lane] == Bvh4Node::LeafChild ? static_cast<float>(node.count[lane]) : 1.0f;
+            cost += SurfaceArea(extents) / rootArea * weight;
+        }
+    }
+    return cost;
+}
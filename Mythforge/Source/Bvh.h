@@ -0,0 +1,108 @@
+﻿/**
+ * @file Bvh.h
+ * @brief Define una jerarquía de volúmenes envolventes de cuatro hijos para recorte, selección y sombras.
+ *
+ * La construcción usa SAH por cubetas sobre un árbol binario, repartiendo los subárboles grandes
+ * entre los hilos del JobSystem, y después colapsa el árbol en nodos de cuatro hijos guardados en
+ * profundidad. Cada nodo guarda las cajas de sus cuatro hijos en un AabbBlock, de modo que un
+ * recorrido prueba los cuatro hijos con una sola pasada vectorial.
+ */
+
+#pragma once
+#include <DirectXMath.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "Culling.h"
+#include "JobSystem.h"
+
+using namespace DirectX;
+
+/**
+ * @struct Bvh4Node
+ * @brief Nodo de cuatro hijos. Los primitivos de cada hijo ocupan el rango [first, first + count) en orden de la jerarquía.
+ */
+struct alignas(16) Bvh4Node {
+    static constexpr uint32_t LeafChild = 0xFFFFFFFE; ///< El hijo es una hoja
+    static constexpr uint32_t EmptyChild = 0xFFFFFFFF; ///< Carril sin hijo
+
+    AabbBlock bounds; ///< Caja de cada hijo
+    uint32_t child[4]; ///< Índice del nodo hijo, LeafChild o EmptyChild
+    uint32_t first[4]; ///< Primer primitivo del subárbol de cada hijo
+    uint32_t count[4]; ///< Primitivos del subárbol de cada hijo
+};
+
+/**
+ * @struct RayHit
+ * @brief Resultado de un rayo contra las cajas de los primitivos.
+ */
+struct RayHit {
+    uint32_t primitive; ///< Índice original del primitivo
+    float distance; ///< Distancia de entrada del rayo en la caja
+};
+
+/**
+ * @class Bvh4
+ * @brief Índice espacial sobre cajas de primitivos, con reconstrucción completa o reajuste incremental.
+ */
+class Bvh4 {
+public:
+    static constexpr uint32_t MaxLeafSize = 8; ///< Primitivos máximos por hoja
+    static constexpr uint32_t BinCount = 16; ///< Cubetas por eje en la evaluación SAH
+    static constexpr uint32_t ParallelThreshold = 16 * 1024; ///< Primitivos a partir de los que se paraleliza un rango
+    static constexpr uint32_t MaxSahDepth = 64; ///< Profundidad a partir de la que se divide por la mediana
+
+    /**
+     * @brief Construye la jerarquía sobre las cajas dadas.
+     * @param jobSystem Si no es nulo, los subárboles grandes se construyen en paralelo.
+     */
+    void Build(const CullingBounds& bounds, JobSystem* jobSystem = nullptr);
+
+    /**
+     * @brief Actualiza las cajas de los nodos tras mover primitivos, sin cambiar la topología.
+     *
+     * Es mucho más barato que Build, pero la calidad del árbol se degrada si los objetos se
+     * desplazan mucho; SahCost permite decidir cuándo reconstruir.
+     */
+    void Refit(const CullingBounds& bounds);
+
+    /// Añade a visible los índices originales de los primitivos que intersecan el frustum.
+    void CullFrustum(const Frustum& frustum, std::vector<uint32_t>& visible, CullingStats* stats = nullptr) const;
+
+    /// Busca la caja de primitivo más cercana que atraviesa el rayo. Devuelve false si no hay ninguna.
+    bool Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, RayHit& hit) const;
+
+    /// Coste SAH del árbol relativo a la caja raíz.
+    float SahCost() const;
+
+    uint32_t NodeCount() const { return static_cast<uint32_t>(nodes.size()); }
+    uint32_t PrimitiveCount() const { return static_cast<uint32_t>(primitiveIndices.size()); }
+    const std::vector<Bvh4Node>& Nodes() const { return nodes; }
+
+private:
+    struct BuildPrimitive {
+        XMFLOAT3 boxMin;
+        XMFLOAT3 boxMax;
+        XMFLOAT3 centroid;
+    };
+
+    struct BuildNode {
+        XMFLOAT3 boxMin;
+        XMFLOAT3 boxMax;
+        uint32_t left; ///< Hijo izquierdo (el derecho es left + 1); 0 en las hojas
+        uint32_t first;
+        uint32_t count;
+    };
+
+    void BuildRange(JobSystem* jobSystem, uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t depth);
+    uint32_t Collapse(uint32_t buildNode);
+    void AppendRange(uint32_t first, uint32_t count, std::vector<uint32_t>& visible) const;
+
+    std::vector<Bvh4Node>       nodes; ///< Nodos en orden de profundidad; los hijos siempre van detrás del padre
+    std::vector<uint32_t>       primitiveIndices; ///< Índice original de cada primitivo en orden de la jerarquía
+    CullingBounds               orderedBounds; ///< Cajas de los primitivos en orden de la jerarquía
+
+    std::vector<BuildPrimitive> buildPrimitives;
+    std::vector<BuildNode>      buildNodes;
+    std::atomic<uint32_t>       buildNodeCount{ 0 };
+};
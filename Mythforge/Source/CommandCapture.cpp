@@ -0,0 +1,520 @@
+﻿/**
+ * @file CommandCapture.cpp
+ * @brief Implementación del registro de objetos y de la captura de comandos.
+ */
+
+#include "pch.h"
+#include "CommandCapture.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    constexpr size_t MaxInitialData = 1 << 24;
+
+    /**
+     * @struct HeapInfo
+     * @brief Rango de handles de un heap de descriptores y las vistas escritas en él.
+     */
+    struct HeapInfo {
+        SIZE_T                    cpuStart = 0;
+        UINT64                    gpuStart = 0;     ///< 0 si el heap no es visible para los shaders
+        uint32_t                  increment = 0;
+        uint32_t                  count = 0;
+        std::vector<CapturedView> views;
+        std::vector<bool>         written;
+    };
+
+    /**
+     * @struct CapturedObject
+     * @brief Objeto registrado: su paquete de definición ya serializado, con el CaptureId al principio.
+     */
+    struct CapturedObject {
+        CaptureId                 id = 0;
+        CommandOp                 op = CommandOp::DefineResource;
+        std::vector<uint8_t>      definition;
+        D3D12_GPU_VIRTUAL_ADDRESS gpuAddress = 0;   ///< Solo búferes
+        uint64_t                  gpuSize = 0;
+        HeapInfo                  heap;             ///< Solo heaps de descriptores
+    };
+
+    struct Registry {
+        std::mutex                                       mutex;
+        std::unordered_map<const void*, CapturedObject>  objects;
+        CaptureId                                        nextId = 1;
+        CommandStreamWriter                              writer;
+        std::atomic<uint32_t>                            remainingFrames{ 0 };
+        uint32_t                                         frameNumber = 0;
+        std::atomic<bool>                                recording{ false };
+        bool                                             finished = false;
+    };
+
+    Registry& GetRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    void WriteDefinition(Registry& registry, const CapturedObject& object)
+    {
+        registry.writer.Write(object.op, object.definition.data(), static_cast<uint32_t>(object.definition.size()));
+    }
+
+    /**
+     * @brief Sustituye o añade el objeto con un CaptureId nuevo. Con el mutex tomado.
+     *
+     * fixed es la estructura de definición sin id; extra, los datos que la siguen.
+     */
+    template<typename T>
+    CapturedObject& Define(Registry& registry, const void* key, CommandOp op, T fixed, const void* extra = nullptr, size_t extraSize = 0)
+    {
+        auto previous = registry.objects.find(key);
+        if (previous != registry.objects.end())
+        {
+            if (registry.recording.load(std::memory_order_relaxed))
+            {
+                registry.writer.Write(CommandOp::ReleaseObject, ObjectCommand{ previous->second.id });
+            }
+            registry.objects.erase(previous);
+        }
+
+        fixed.id = registry.nextId++;
+        CapturedObject& object = registry.objects[key];
+        object.id = fixed.id;
+        object.op = op;
+        object.definition.resize(sizeof(T) + extraSize);
+        memcpy(object.definition.data(), &fixed, sizeof(T));
+        if (extraSize)
+        {
+            memcpy(object.definition.data() + sizeof(T), extra, extraSize);
+        }
+
+        if (registry.recording.load(std::memory_order_relaxed))
+        {
+            WriteDefinition(registry, object);
+        }
+        return object;
+    }
+
+    CaptureId FindLocked(Registry& registry, const void* object)
+    {
+        auto found = registry.objects.find(object);
+        return found != registry.objects.end() ? found->second.id : 0;
+    }
+
+    CaptureId FindBufferLocked(Registry& registry, D3D12_GPU_VIRTUAL_ADDRESS address, uint64_t& offset)
+    {
+        for (const auto& entry : registry.objects)
+        {
+            const CapturedObject& object = entry.second;
+            if (object.gpuSize && address >= object.gpuAddress && address < object.gpuAddress + object.gpuSize)
+            {
+                offset = address - object.gpuAddress;
+                return object.id;
+            }
+        }
+        offset = 0;
+        return 0;
+    }
+
+    /// Heap que contiene el handle de CPU, o nullptr.
+    CapturedObject* FindHeapLocked(Registry& registry, SIZE_T handle, uint32_t& index)
+    {
+        for (auto& entry : registry.objects)
+        {
+            HeapInfo& heap = entry.second.heap;
+            if (heap.count && handle >= heap.cpuStart && handle < heap.cpuStart + SIZE_T(heap.increment) * heap.count)
+            {
+                index = static_cast<uint32_t>((handle - heap.cpuStart) / heap.increment);
+                return &entry.second;
+            }
+        }
+        return nullptr;
+    }
+
+    /// Guarda la vista en su heap y la emite si se está capturando. Con el mutex tomado.
+    void DefineView(Registry& registry, D3D12_CPU_DESCRIPTOR_HANDLE handle, CapturedView view)
+    {
+        CapturedObject* heap = FindHeapLocked(registry, handle.ptr, view.index);
+        if (!heap) return;
+
+        view.heap = heap->id;
+        heap->heap.views[view.index] = view;
+        heap->heap.written[view.index] = true;
+        if (registry.recording.load(std::memory_order_relaxed))
+        {
+            registry.writer.Write(CommandOp::DefineView, view);
+        }
+    }
+
+    /// Definiciones de todo lo registrado, en orden de registro, seguidas de las vistas.
+    void WriteSnapshot(Registry& registry)
+    {
+        std::vector<const CapturedObject*> ordered;
+        ordered.reserve(registry.objects.size());
+        for (const auto& entry : registry.objects)
+        {
+            ordered.push_back(&entry.second);
+        }
+        std::sort(ordered.begin(), ordered.end(), [](const CapturedObject* a, const CapturedObject* b) { return a->id < b->id; });
+
+        for (const CapturedObject* object : ordered)
+        {
+            WriteDefinition(registry, *object);
+        }
+        for (const CapturedObject* object : ordered)
+        {
+            for (uint32_t i = 0; i < object->heap.count; i++)
+            {
+                if (object->heap.written[i])
+                {
+                    registry.writer.Write(CommandOp::DefineView, object->heap.views[i]);
+                }
+            }
+        }
+    }
+}
+
+namespace CommandCapture
+{
+    void RegisterResource(ID3D12Resource* resource, D3D12_RESOURCE_STATES state, const void* initialData, size_t initialDataSize)
+    {
+        D3D12_RESOURCE_DESC desc = resource->GetDesc();
+        D3D12_HEAP_PROPERTIES heapProperties = {};
+        heapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
+        resource->GetHeapProperties(&heapProperties, nullptr);
+
+        if (initialDataSize > MaxInitialData)
+        {
+            initialData = nullptr;
+            initialDataSize = 0;
+        }
+
+        CapturedResource captured = {};
+        captured.dimension = desc.Dimension;
+        captured.width = desc.Width;
+        captured.height = desc.Height;
+        captured.depthOrArraySize = desc.DepthOrArraySize;
+        captured.mipLevels = desc.MipLevels;
+        captured.format = desc.Format;
+        captured.sampleCount = desc.SampleDesc.Count;
+        captured.flags = desc.Flags;
+        captured.heapType = heapProperties.Type;
+        captured.state = state;
+        captured.initialDataSize = initialData ? static_cast<uint32_t>(initialDataSize) : 0;
+
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        CapturedObject& object = Define(registry, resource, CommandOp::DefineResource, captured, initialData, captured.initialDataSize);
+        if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+        {
+            object.gpuAddress = resource->GetGPUVirtualAddress();
+            object.gpuSize = desc.Width;
+        }
+    }
+
+    void RegisterTexture(ID3D12Resource* texture, D3D12_RESOURCE_STATES state, const D3D12_SUBRESOURCE_DATA* subresources, uint32_t subresourceCount)
+    {
+        D3D12_RESOURCE_DESC desc = texture->GetDesc();
+        bool packable = desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE2D &&
+            (desc.Format == DXGI_FORMAT_R8G8B8A8_UNORM || desc.Format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB ||
+             desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM || desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB);
+        if (!packable || subresourceCount != desc.MipLevels * desc.DepthOrArraySize)
+        {
+            RegisterResource(texture, state);
+            return;
+        }
+
+        std::vector<uint8_t> packed;
+        for (uint32_t i = 0; i < subresourceCount; i++)
+        {
+            uint32_t mip = i % desc.MipLevels;
+            size_t rowSize = (std::max)(static_cast<size_t>(desc.Width >> mip), size_t(1)) * 4;
+            uint32_t rows = (std::max)(desc.Height >> mip, 1u);
+            const uint8_t* source = static_cast<const uint8_t*>(subresources[i].pData);
+            for (uint32_t row = 0; row < rows; row++)
+            {
+                packed.insert(packed.end(), source, source + rowSize);
+                source += subresources[i].RowPitch;
+            }
+        }
+        RegisterResource(texture, state, packed.data(), packed.size());
+    }
+
+    void RegisterRootSignature(ID3D12RootSignature* rootSignature, const void* blob, size_t blobSize)
+    {
+        CapturedRootSignature captured = {};
+        captured.blobSize = static_cast<uint32_t>(blobSize);
+
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        Define(registry, rootSignature, CommandOp::DefineRootSignature, captured, blob, blobSize);
+    }
+
+    void RegisterPipeline(ID3D12PipelineState* pipeline, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+    {
+        CapturedPipeline captured = {};
+        captured.inputElementCount = desc.InputLayout.NumElements;
+        captured.vertexShaderSize = static_cast<uint32_t>(desc.VS.BytecodeLength);
+        captured.pixelShaderSize = static_cast<uint32_t>(desc.PS.BytecodeLength);
+        captured.topologyType = desc.PrimitiveTopologyType;
+        captured.renderTargetCount = desc.NumRenderTargets;
+        captured.renderTargetFormat = desc.NumRenderTargets ? desc.RTVFormats[0] : DXGI_FORMAT_UNKNOWN;
+        captured.depthStencilFormat = desc.DSVFormat;
+        captured.sampleCount = desc.SampleDesc.Count;
+        captured.fillMode = desc.RasterizerState.FillMode;
+        captured.cullMode = desc.RasterizerState.CullMode;
+        captured.frontCounterClockwise = desc.RasterizerState.FrontCounterClockwise;
+        captured.depthEnable = desc.DepthStencilState.DepthEnable;
+        captured.depthWriteMask = desc.DepthStencilState.DepthWriteMask;
+        captured.depthFunc = desc.DepthStencilState.DepthFunc;
+
+        // Input layout y bytecodes van seguidos detrás de la estructura.
+        std::vector<uint8_t> extra(sizeof(CapturedInputElement) * captured.inputElementCount + captured.vertexShaderSize + captured.pixelShaderSize);
+        CapturedInputElement* elements = reinterpret_cast<CapturedInputElement*>(extra.data());
+        for (uint32_t i = 0; i < captured.inputElementCount; i++)
+        {
+            const D3D12_INPUT_ELEMENT_DESC& source = desc.InputLayout.pInputElementDescs[i];
+            CapturedInputElement element = {};
+            strncpy_s(element.semanticName, source.SemanticName, _TRUNCATE);
+            element.semanticIndex = source.SemanticIndex;
+            element.format = source.Format;
+            element.inputSlot = source.InputSlot;
+            element.alignedByteOffset = source.AlignedByteOffset;
+            element.perInstance = source.InputSlotClass == D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA;
+            element.instanceStepRate = source.InstanceDataStepRate;
+            memcpy(&elements[i], &element, sizeof(element));
+        }
+        uint8_t* shaders = extra.data() + sizeof(CapturedInputElement) * captured.inputElementCount;
+        if (captured.vertexShaderSize) memcpy(shaders, desc.VS.pShaderBytecode, captured.vertexShaderSize);
+        if (captured.pixelShaderSize) memcpy(shaders + captured.vertexShaderSize, desc.PS.pShaderBytecode, captured.pixelShaderSize);
+
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        captured.rootSignature = FindLocked(registry, desc.pRootSignature);
+        Define(registry, pipeline, CommandOp::DefinePipeline, captured, extra.data(), extra.size());
+    }
+
+    void RegisterDescriptorHeap(ID3D12Device* device, ID3D12DescriptorHeap* heap)
+    {
+        D3D12_DESCRIPTOR_HEAP_DESC desc = heap->GetDesc();
+        CapturedDescriptorHeap captured = {};
+        captured.type = desc.Type;
+        captured.count = desc.NumDescriptors;
+        captured.shaderVisible = (desc.Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE) != 0;
+
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        HeapInfo& info = Define(registry, heap, CommandOp::DefineDescriptorHeap, captured).heap;
+        info.cpuStart = heap->GetCPUDescriptorHandleForHeapStart().ptr;
+        info.gpuStart = captured.shaderVisible ? heap->GetGPUDescriptorHandleForHeapStart().ptr : 0;
+        info.increment = device->GetDescriptorHandleIncrementSize(desc.Type);
+        info.count = desc.NumDescriptors;
+        info.views.assign(desc.NumDescriptors, CapturedView());
+        info.written.assign(desc.NumDescriptors, false);
+    }
+
+    void RegisterConstantBufferView(const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc, D3D12_CPU_DESCRIPTOR_HANDLE handle)
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        CapturedView view = {};
+        view.kind = CapturedViewKind::ConstantBuffer;
+        view.resource = FindBufferLocked(registry, desc.BufferLocation, view.bufferOffset);
+        view.bufferSize = desc.SizeInBytes;
+        DefineView(registry, handle, view);
+    }
+
+    void RegisterShaderResourceView(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc, D3D12_CPU_DESCRIPTOR_HANDLE handle)
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        CapturedView view = {};
+        view.kind = CapturedViewKind::ShaderResource;
+        view.resource = FindLocked(registry, resource);
+        if (desc)
+        {
+            view.format = desc->Format;
+            view.viewDimension = desc->ViewDimension;
+            if (desc->ViewDimension == D3D12_SRV_DIMENSION_TEXTURE2D)
+            {
+                view.mipLevels = desc->Texture2D.MipLevels;
+                view.mostDetailedMip = desc->Texture2D.MostDetailedMip;
+            }
+        }
+        DefineView(registry, handle, view);
+    }
+
+    void RegisterRenderTargetView(ID3D12Resource* resource, D3D12_CPU_DESCRIPTOR_HANDLE handle)
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        CapturedView view = {};
+        view.kind = CapturedViewKind::RenderTarget;
+        view.resource = FindLocked(registry, resource);
+        DefineView(registry, handle, view);
+    }
+
+    void RegisterDepthStencilView(ID3D12Resource* resource, const D3D12_DEPTH_STENCIL_VIEW_DESC* desc, D3D12_CPU_DESCRIPTOR_HANDLE handle)
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        CapturedView view = {};
+        view.kind = CapturedViewKind::DepthStencil;
+        view.resource = FindLocked(registry, resource);
+        if (desc)
+        {
+            view.format = desc->Format;
+            view.viewDimension = desc->ViewDimension;
+        }
+        DefineView(registry, handle, view);
+    }
+
+    void Unregister(const void* object)
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        auto found = registry.objects.find(object);
+        if (found == registry.objects.end()) return;
+
+        if (registry.recording.load(std::memory_order_relaxed))
+        {
+            registry.writer.Write(CommandOp::ReleaseObject, ObjectCommand{ found->second.id });
+        }
+        registry.objects.erase(found);
+    }
+
+    void Start(uint32_t frameCount)
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        if (!registry.recording.load(std::memory_order_relaxed))
+        {
+            registry.remainingFrames.store(frameCount, std::memory_order_relaxed);
+        }
+    }
+
+    bool IsRecording()
+    {
+        return GetRegistry().recording.load(std::memory_order_relaxed);
+    }
+
+    void BeginFrame()
+    {
+        Registry& registry = GetRegistry();
+        if (!registry.recording.load(std::memory_order_relaxed) && registry.remainingFrames.load(std::memory_order_relaxed) == 0)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        if (!registry.recording.load(std::memory_order_relaxed))
+        {
+            registry.writer.Clear();
+            registry.finished = false;
+            registry.frameNumber = 0;
+            WriteSnapshot(registry);
+            registry.recording.store(true, std::memory_order_relaxed);
+        }
+        registry.writer.Write(CommandOp::BeginFrame, FrameCommand{ registry.frameNumber++ });
+    }
+
+    void EndFrame()
+    {
+        Registry& registry = GetRegistry();
+        if (!registry.recording.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.writer.Write(CommandOp::EndFrame, nullptr, 0);
+        if (registry.remainingFrames.fetch_sub(1, std::memory_order_relaxed) == 1)
+        {
+            registry.recording.store(false, std::memory_order_relaxed);
+            registry.finished = true;
+        }
+    }
+
+    bool HasFinishedCapture()
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        return registry.finished;
+    }
+
+    void SaveFinishedCapture(std::ostream& stream)
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        if (!registry.finished) return;
+
+        registry.writer.Save(stream);
+        registry.writer.Clear();
+        registry.finished = false;
+    }
+
+    CaptureId Find(const void* object)
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        return FindLocked(registry, object);
+    }
+
+    CaptureId FindBuffer(D3D12_GPU_VIRTUAL_ADDRESS address, uint64_t& offset)
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        return FindBufferLocked(registry, address, offset);
+    }
+
+    CaptureId FindDescriptor(D3D12_CPU_DESCRIPTOR_HANDLE handle, uint32_t& index)
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        CapturedObject* heap = FindHeapLocked(registry, handle.ptr, index);
+        return heap ? heap->id : 0;
+    }
+
+    CaptureId FindDescriptor(D3D12_GPU_DESCRIPTOR_HANDLE handle, uint32_t& index)
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (const auto& entry : registry.objects)
+        {
+            const HeapInfo& heap = entry.second.heap;
+            if (heap.gpuStart && handle.ptr >= heap.gpuStart && handle.ptr < heap.gpuStart + UINT64(heap.increment) * heap.count)
+            {
+                index = static_cast<uint32_t>((handle.ptr - heap.gpuStart) / heap.increment);
+                return entry.second.id;
+            }
+        }
+        index = 0;
+        return 0;
+    }
+
+    void RecordPacket(CommandOp op, const void* payload, uint32_t payloadSize, const void* extra, uint32_t extraSize)
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        if (registry.recording.load(std::memory_order_relaxed))
+        {
+            registry.writer.Write(op, payload, payloadSize, extra, extraSize);
+        }
+    }
+
+    void RecordBufferWrite(ID3D12Resource* resource, uint64_t offset, const void* data, size_t size)
+    {
+        if (!IsRecording()) return;
+
+        BufferWriteCommand command = {};
+        command.resource = Find(resource);
+        command.size = static_cast<uint32_t>(size);
+        command.offset = offset;
+        Record(CommandOp::WriteBuffer, command, data, command.size);
+    }
+}
@@ -0,0 +1,89 @@
+﻿/**
+ * @file CommandCapture.h
+ * @brief Captura del flujo de comandos de Direct3D 12 del motor en el formato de CommandStream.
+ *
+ * Los objetos que usan los fotogramas se registran al crearse: recursos, firmas raíz, pipelines,
+ * heaps de descriptores y vistas. El registro guarda su descripción (y el contenido inicial de los
+ * búferes y de las texturas RGBA8) para poder volcarla al empezar una captura, que puede pedirse en cualquier
+ * momento. Mientras se captura, CommandContext y las escrituras en búferes mapeados añaden sus
+ * paquetes traduciendo punteros, direcciones de GPU y descriptores a CaptureId.
+ *
+ * La captura se hace en memoria y solo en el hilo que graba el fotograma; el registro admite
+ * llamadas desde cualquier hilo.
+ */
+
+#pragma once
+#include <d3d12.h>
+#include <ostream>
+#include "CommandStream.h"
+
+namespace CommandCapture
+{
+    /**
+     * @brief Registra un recurso.
+     * @param state Estado en el que está el recurso entre fotogramas.
+     * @param initialData Contenido inicial; solo se conserva hasta 16 MB, los mayores se reproducen a cero.
+     */
+    void RegisterResource(ID3D12Resource* resource, D3D12_RESOURCE_STATES state, const void* initialData = nullptr, size_t initialDataSize = 0);
+
+    /**
+     * @brief Registra una textura con el contenido de sus subrecursos.
+     *
+     * Los formatos RGBA8 y BGRA8 se guardan con las filas compactadas, como describe
+     * CapturedResource; el resto se registra sin contenido.
+     */
+    void RegisterTexture(ID3D12Resource* texture, D3D12_RESOURCE_STATES state, const D3D12_SUBRESOURCE_DATA* subresources, uint32_t subresourceCount);
+
+    void RegisterRootSignature(ID3D12RootSignature* rootSignature, const void* blob, size_t blobSize);
+
+    /// Registra el pipeline; su firma raíz debe estar registrada.
+    void RegisterPipeline(ID3D12PipelineState* pipeline, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+
+    void RegisterDescriptorHeap(ID3D12Device* device, ID3D12DescriptorHeap* heap);
+
+    /// Vistas escritas en un heap registrado; los handles fuera de heaps registrados se ignoran.
+    void RegisterConstantBufferView(const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc, D3D12_CPU_DESCRIPTOR_HANDLE handle);
+    void RegisterShaderResourceView(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc, D3D12_CPU_DESCRIPTOR_HANDLE handle);
+    void RegisterRenderTargetView(ID3D12Resource* resource, D3D12_CPU_DESCRIPTOR_HANDLE handle);
+    void RegisterDepthStencilView(ID3D12Resource* resource, const D3D12_DEPTH_STENCIL_VIEW_DESC* desc, D3D12_CPU_DESCRIPTOR_HANDLE handle);
+
+    /// Da de baja un objeto destruido. Las claves desconocidas se ignoran.
+    void Unregister(const void* object);
+
+    /// Pide capturar los frameCount fotogramas siguientes, a partir del próximo BeginFrame.
+    void Start(uint32_t frameCount);
+
+    bool IsRecording();
+
+    /// Delimitan un fotograma; los llama el Renderer.
+    void BeginFrame();
+    void EndFrame();
+
+    /// true cuando hay una captura terminada pendiente de guardar.
+    bool HasFinishedCapture();
+
+    /// Escribe la captura terminada y la descarta.
+    void SaveFinishedCapture(std::ostream& stream);
+
+    /// Identificador de un objeto registrado, o 0.
+    CaptureId Find(const void* object);
+
+    /// Búfer registrado que contiene la dirección, y desplazamiento dentro de él.
+    CaptureId FindBuffer(D3D12_GPU_VIRTUAL_ADDRESS address, uint64_t& offset);
+
+    /// Heap registrado que contiene el descriptor, y su índice.
+    CaptureId FindDescriptor(D3D12_CPU_DESCRIPTOR_HANDLE handle, uint32_t& index);
+    CaptureId FindDescriptor(D3D12_GPU_DESCRIPTOR_HANDLE handle, uint32_t& index);
+
+    /// Añade un paquete a la captura en curso. Quien llama comprueba antes IsRecording.
+    void RecordPacket(CommandOp op, const void* payload, uint32_t payloadSize, const void* extra = nullptr, uint32_t extraSize = 0);
+
+    template<typename T>
+    void Record(CommandOp op, const T& payload, const void* extra = nullptr, uint32_t extraSize = 0)
+    {
+        RecordPacket(op, &payload, sizeof(T), extra, extraSize);
+    }
+
+    /// Escritura de CPU en un búfer mapeado, si se está capturando.
+    void RecordBufferWrite(ID3D12Resource* resource, uint64_t offset, const void* data, size_t size);
+}
@@ -0,0 +1,340 @@
+﻿/**
+ * @file CommandContext.cpp
+ * @brief Implementación de la capa de grabación de comandos.
+ */
+
+#include "pch.h"
+#include "CommandContext.h"
+#include "CommandCapture.h"
+#include "RenderStats.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    uint64_t PrimitiveCount(D3D12_PRIMITIVE_TOPOLOGY topology, UINT indexCount)
+    {
+        switch (topology)
+        {
+        case D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST: return indexCount / 3;
+        case D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP: return indexCount > 2 ? indexCount - 2 : 0;
+        case D3D_PRIMITIVE_TOPOLOGY_LINELIST: return indexCount / 2;
+        case D3D_PRIMITIVE_TOPOLOGY_LINESTRIP: return indexCount > 1 ? indexCount - 1 : 0;
+        default: return indexCount;
+        }
+    }
+
+    bool SameView(const D3D12_VERTEX_BUFFER_VIEW& a, const D3D12_VERTEX_BUFFER_VIEW& b)
+    {
+        return a.BufferLocation == b.BufferLocation && a.SizeInBytes == b.SizeInBytes && a.StrideInBytes == b.StrideInBytes;
+    }
+}
+
+void CommandContext::Reset(ID3D12GraphicsCommandList2* commandList)
+{
+    this->commandList = commandList;
+    InvalidateState();
+}
+
+void CommandContext::InvalidateState()
+{
+    rootSignature = nullptr;
+    memset(descriptorHeaps, 0, sizeof(descriptorHeaps));
+    descriptorHeapCount = 0;
+    pipelineState = nullptr;
+    memset(rootTables, 0, sizeof(rootTables));
+    topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+    memset(vertexBuffers, 0, sizeof(vertexBuffers));
+    indexBuffer = {};
+}
+
+void CommandContext::SetStateFiltering(bool enabled)
+{
+    stateFiltering = enabled;
+}
+
+void CommandContext::SetGraphicsRootSignature(ID3D12RootSignature* rootSignature)
+{
+    if (stateFiltering && rootSignature && rootSignature == this->rootSignature)
+    {
+        RenderStats::Add(RenderCounter::SkippedRootSignatureChanges);
+        return;
+    }
+
+    commandList->SetGraphicsRootSignature(rootSignature);
+    RenderStats::Add(RenderCounter::RootSignatureChanges);
+
+    // Cambiar de firma deja sin definir los argumentos raíz.
+    this->rootSignature = rootSignature;
+    memset(rootTables, 0, sizeof(rootTables));
+
+    if (CommandCapture::IsRecording())
+    {
+        CommandCapture::Record(CommandOp::SetRootSignature, ObjectCommand{ CommandCapture::Find(rootSignature) });
+    }
+}
+
+void CommandContext::SetDescriptorHeaps(UINT count, ID3D12DescriptorHeap* const* heaps)
+{
+    if (stateFiltering && count > 0 && count == descriptorHeapCount && std::equal(heaps, heaps + count, descriptorHeaps))
+    {
+        RenderStats::Add(RenderCounter::SkippedDescriptorHeapChanges);
+        return;
+    }
+
+    commandList->SetDescriptorHeaps(count, heaps);
+    RenderStats::Add(RenderCounter::DescriptorHeapChanges);
+
+    // Las tablas raíz apuntan dentro de los montones anteriores: se vuelven a fijar.
+    descriptorHeapCount = count <= MaxDescriptorHeaps ? count : 0;
+    std::copy(heaps, heaps + descriptorHeapCount, descriptorHeaps);
+    memset(rootTables, 0, sizeof(rootTables));
+
+    if (CommandCapture::IsRecording())
+    {
+        SetDescriptorHeapsCommand command = {};
+        command.count = (std::min)(count, 2u);
+        for (UINT i = 0; i < command.count; i++)
+        {
+            command.heaps[i] = CommandCapture::Find(heaps[i]);
+        }
+        CommandCapture::Record(CommandOp::SetDescriptorHeaps, command);
+    }
+}
+
+void CommandContext::SetPipelineState(ID3D12PipelineState* pipelineState)
+{
+    if (stateFiltering && pipelineState && pipelineState == this->pipelineState)
+    {
+        RenderStats::Add(RenderCounter::SkippedPipelineChanges);
+        return;
+    }
+
+    commandList->SetPipelineState(pipelineState);
+    RenderStats::Add(RenderCounter::PipelineChanges);
+    this->pipelineState = pipelineState;
+
+    if (CommandCapture::IsRecording())
+    {
+        CommandCapture::Record(CommandOp::SetPipeline, ObjectCommand{ CommandCapture::Find(pipelineState) });
+    }
+}
+
+void CommandContext::SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor)
+{
+    if (rootParameterIndex < MaxRootTables)
+    {
+        D3D12_GPU_DESCRIPTOR_HANDLE& bound = rootTables[rootParameterIndex];
+        if (stateFiltering && bound.ptr != 0 && bound.ptr == baseDescriptor.ptr)
+        {
+            RenderStats::Add(RenderCounter::SkippedRootParameterWrites);
+            return;
+        }
+        bound = baseDescriptor;
+    }
+
+    commandList->SetGraphicsRootDescriptorTable(rootParameterIndex, baseDescriptor);
+    RenderStats::Add(RenderCounter::RootParameterWrites);
+
+    if (CommandCapture::IsRecording())
+    {
+        SetRootTableCommand command = {};
+        command.rootIndex = rootParameterIndex;
+        command.heap = CommandCapture::FindDescriptor(baseDescriptor, command.index);
+        CommandCapture::Record(CommandOp::SetRootTable, command);
+    }
+}
+
+void CommandContext::IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)
+{
+    if (stateFiltering && topology != D3D_PRIMITIVE_TOPOLOGY_UNDEFINED && topology == this->topology)
+    {
+        RenderStats::Add(RenderCounter::SkippedTopologyChanges);
+        return;
+    }
+
+    commandList->IASetPrimitiveTopology(topology);
+    RenderStats::Add(RenderCounter::TopologyChanges);
+    this->topology = topology;
+
+    if (CommandCapture::IsRecording())
+    {
+        CommandCapture::Record(CommandOp::SetTopology, SetTopologyCommand{ static_cast<uint32_t>(topology) });
+    }
+}
+
+void CommandContext::IASetVertexBuffers(UINT startSlot, UINT count, const D3D12_VERTEX_BUFFER_VIEW* views)
+{
+    if (startSlot + count <= MaxVertexBuffers && views)
+    {
+        bool redundant = stateFiltering;
+        for (UINT i = 0; i < count && redundant; i++)
+        {
+            const D3D12_VERTEX_BUFFER_VIEW& bound = vertexBuffers[startSlot + i];
+            redundant = bound.BufferLocation != 0 && SameView(bound, views[i]);
+        }
+        if (redundant)
+        {
+            RenderStats::Add(RenderCounter::SkippedVertexBufferBinds, count);
+            return;
+        }
+        std::copy(views, views + count, vertexBuffers + startSlot);
+    }
+    else
+    {
+        memset(vertexBuffers, 0, sizeof(vertexBuffers));
+    }
+
+    commandList->IASetVertexBuffers(startSlot, count, views);
+    RenderStats::Add(RenderCounter::VertexBufferBinds, count);
+
+    if (CommandCapture::IsRecording())
+    {
+        for (UINT i = 0; i < count; i++)
+        {
+            SetVertexBufferCommand command = {};
+            command.slot = startSlot + i;
+            command.resource = CommandCapture::FindBuffer(views[i].BufferLocation, command.offset);
+            command.size = views[i].SizeInBytes;
+            command.stride = views[i].StrideInBytes;
+            CommandCapture::Record(CommandOp::SetVertexBuffer, command);
+        }
+    }
+}
+
+void CommandContext::IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view)
+{
+    if (stateFiltering && view && indexBuffer.BufferLocation != 0 && view->BufferLocation == indexBuffer.BufferLocation &&
+        view->SizeInBytes == indexBuffer.SizeInBytes && view->Format == indexBuffer.Format)
+    {
+        RenderStats::Add(RenderCounter::SkippedIndexBufferBinds);
+        return;
+    }
+
+    commandList->IASetIndexBuffer(view);
+    RenderStats::Add(RenderCounter::IndexBufferBinds);
+    indexBuffer = view ? *view : D3D12_INDEX_BUFFER_VIEW{};
+
+    if (CommandCapture::IsRecording())
+    {
+        SetIndexBufferCommand command = {};
+        if (view)
+        {
+            command.resource = CommandCapture::FindBuffer(view->BufferLocation, command.offset);
+            command.format = view->Format;
+            command.size = view->SizeInBytes;
+        }
+        CommandCapture::Record(CommandOp::SetIndexBuffer, command);
+    }
+}
+
+void CommandContext::DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation)
+{
+    commandList->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+    RenderStats::Add(RenderCounter::DrawCalls);
+    RenderStats::Add(RenderCounter::Primitives, PrimitiveCount(topology, indexCountPerInstance) * instanceCount);
+
+    if (CommandCapture::IsRecording())
+    {
+        DrawIndexedCommand command = { indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation };
+        CommandCapture::Record(CommandOp::DrawIndexed, command);
+    }
+}
+
+void CommandContext::ResourceBarrier(UINT count, const D3D12_RESOURCE_BARRIER* barriers)
+{
+    commandList->ResourceBarrier(count, barriers);
+    RenderStats::Add(RenderCounter::Barriers, count);
+
+    if (CommandCapture::IsRecording())
+    {
+        for (UINT i = 0; i < count; i++)
+        {
+            if (barriers[i].Type != D3D12_RESOURCE_BARRIER_TYPE_TRANSITION) continue;
+
+            const D3D12_RESOURCE_TRANSITION_BARRIER& transition = barriers[i].Transition;
+            BarrierCommand command = {};
+            command.resource = CommandCapture::Find(transition.pResource);
+            command.subresource = transition.Subresource;
+            command.before = transition.StateBefore;
+            command.after = transition.StateAfter;
+            CommandCapture::Record(CommandOp::Barrier, command);
+        }
+    }
+}
+
+void CommandContext::RSSetViewports(UINT count, const D3D12_VIEWPORT* viewports)
+{
+    commandList->RSSetViewports(count, viewports);
+
+    if (count > 0 && CommandCapture::IsRecording())
+    {
+        const D3D12_VIEWPORT& viewport = viewports[0];
+        ViewportCommand command = { viewport.TopLeftX, viewport.TopLeftY, viewport.Width, viewport.Height, viewport.MinDepth, viewport.MaxDepth };
+        CommandCapture::Record(CommandOp::SetViewport, command);
+    }
+}
+
+void CommandContext::RSSetScissorRects(UINT count, const D3D12_RECT* rects)
+{
+    commandList->RSSetScissorRects(count, rects);
+
+    if (count > 0 && CommandCapture::IsRecording())
+    {
+        ScissorCommand command = { rects[0].left, rects[0].top, rects[0].right, rects[0].bottom };
+        CommandCapture::Record(CommandOp::SetScissor, command);
+    }
+}
+
+void CommandContext::ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE renderTargetView, const FLOAT color[4])
+{
+    commandList->ClearRenderTargetView(renderTargetView, color, 0, nullptr);
+    RenderStats::Add(RenderCounter::Clears);
+
+    if (CommandCapture::IsRecording())
+    {
+        ClearRenderTargetCommand command = {};
+        command.heap = CommandCapture::FindDescriptor(renderTargetView, command.index);
+        for (int i = 0; i < 4; i++)
+        {
+            command.color[i] = color[i];
+        }
+        CommandCapture::Record(CommandOp::ClearRenderTarget, command);
+    }
+}
+
+void CommandContext::ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE depthStencilView, D3D12_CLEAR_FLAGS flags, FLOAT depth, UINT8 stencil)
+{
+    commandList->ClearDepthStencilView(depthStencilView, flags, depth, stencil, 0, nullptr);
+    RenderStats::Add(RenderCounter::Clears);
+
+    if (CommandCapture::IsRecording())
+    {
+        ClearDepthCommand command = {};
+        command.heap = CommandCapture::FindDescriptor(depthStencilView, command.index);
+        command.flags = flags;
+        command.depth = depth;
+        command.stencil = stencil;
+        CommandCapture::Record(CommandOp::ClearDepth, command);
+    }
+}
+
+void CommandContext::OMSetRenderTargets(UINT count, const D3D12_CPU_DESCRIPTOR_HANDLE* renderTargetViews, BOOL singleHandleToDescriptorRange, const D3D12_CPU_DESCRIPTOR_HANDLE* depthStencilView)
+{
+    commandList->OMSetRenderTargets(count, renderTargetViews, singleHandleToDescriptorRange, depthStencilView);
+    RenderStats::Add(RenderCounter::RenderTargetBinds);
+
+    if (CommandCapture::IsRecording())
+    {
+        SetRenderTargetsCommand command = {};
+        if (count > 0)
+        {
+            command.renderTargetHeap = CommandCapture::FindDescriptor(renderTargetViews[0], command.renderTargetIndex);
+        }
+        if (depthStencilView)
+        {
+            command.depthStencilHeap = CommandCapture::FindDescriptor(*depthStencilView, command.depthStencilIndex);
+        }
+        CommandCapture::Record(CommandOp::SetRenderTargets, command);
+    }
+}
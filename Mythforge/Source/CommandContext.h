@@ -0,0 +1,76 @@
+﻿/**
+ * @file CommandContext.h
+ * @brief Capa de grabación de comandos sobre una ID3D12GraphicsCommandList.
+ *
+ * Las rutas de dibujado del motor graban a través de CommandContext en lugar de usar la lista
+ * directamente. Cada método reenvía la llamada a Direct3D, suma los contadores de RenderStats
+ * correspondientes y, si hay una captura en marcha, añade el paquete equivalente a CommandCapture.
+ * Los nombres y parámetros son los de ID3D12GraphicsCommandList.
+ *
+ * El contexto recuerda el estado de entrada que ya está fijado en la lista (firma raíz, montones
+ * de descriptores, PSO, tablas raíz, topología y búferes de vértices e índices) y descarta las
+ * llamadas que no lo cambian: no llegan a Direct3D ni a la captura y solo suman a los contadores
+ * Skipped* de RenderStats. Así los objetos que comparten material pagan el estado una sola vez.
+ */
+
+#pragma once
+#include <d3d12.h>
+
+/**
+ * @class CommandContext
+ * @brief Lista de comandos del fotograma con contadores y captura.
+ */
+class CommandContext {
+public:
+    /// Empieza a grabar sobre la lista, que ya debe estar abierta. Olvida el estado recordado.
+    void Reset(ID3D12GraphicsCommandList2* commandList);
+
+    /// Olvida el estado recordado; necesario tras fijar estado directamente sobre Get().
+    void InvalidateState();
+
+    /// Con el filtro desactivado todas las llamadas se reenvían, para comparar capturas.
+    void SetStateFiltering(bool enabled);
+    bool IsStateFiltering() const { return stateFiltering; }
+
+    ID3D12GraphicsCommandList2* Get() const { return commandList; }
+
+    void SetGraphicsRootSignature(ID3D12RootSignature* rootSignature);
+    void SetDescriptorHeaps(UINT count, ID3D12DescriptorHeap* const* heaps);
+    void SetPipelineState(ID3D12PipelineState* pipelineState);
+    void SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor);
+    void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology);
+    void IASetVertexBuffers(UINT startSlot, UINT count, const D3D12_VERTEX_BUFFER_VIEW* views);
+    void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view);
+    void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation);
+
+    /// Solo las transiciones se capturan.
+    void ResourceBarrier(UINT count, const D3D12_RESOURCE_BARRIER* barriers);
+
+    /// Se captura solo el primer viewport y el primer rectángulo.
+    void RSSetViewports(UINT count, const D3D12_VIEWPORT* viewports);
+    void RSSetScissorRects(UINT count, const D3D12_RECT* rects);
+
+    void ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE renderTargetView, const FLOAT color[4]);
+    void ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE depthStencilView, D3D12_CLEAR_FLAGS flags, FLOAT depth, UINT8 stencil);
+
+    /// Se captura como mucho un destino de color.
+    void OMSetRenderTargets(UINT count, const D3D12_CPU_DESCRIPTOR_HANDLE* renderTargetViews, BOOL singleHandleToDescriptorRange, const D3D12_CPU_DESCRIPTOR_HANDLE* depthStencilView);
+
+private:
+    static constexpr UINT MaxDescriptorHeaps = 2;   ///< CBV/SRV/UAV y muestreadores
+    static constexpr UINT MaxRootTables = 8;
+    static constexpr UINT MaxVertexBuffers = 4;
+
+    ID3D12GraphicsCommandList2* commandList = nullptr;
+    bool                        stateFiltering = true;
+
+    // Estado fijado en la lista. Un puntero o una dirección nula significa desconocido.
+    ID3D12RootSignature*        rootSignature = nullptr;
+    ID3D12DescriptorHeap*       descriptorHeaps[MaxDescriptorHeaps] = {};
+    UINT                        descriptorHeapCount = 0;
+    ID3D12PipelineState*        pipelineState = nullptr;
+    D3D12_GPU_DESCRIPTOR_HANDLE rootTables[MaxRootTables] = {};
+    D3D12_PRIMITIVE_TOPOLOGY    topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED; ///< También para contar primitivas
+    D3D12_VERTEX_BUFFER_VIEW    vertexBuffers[MaxVertexBuffers] = {};
+    D3D12_INDEX_BUFFER_VIEW     indexBuffer = {};
+};
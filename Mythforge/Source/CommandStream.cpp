@@ -0,0 +1,279 @@
+﻿/**
+ * @file CommandStream.cpp
+ * @brief Implementación del formato de captura de comandos y de su reproducción.
+ */
+
+#include "pch.h"
+#include "CommandStream.h"
+#include "Profiler.h"
+#include <cstring>
+#include <iterator>
+
+namespace
+{
+    const char     streamMagic[4] = { 'M', 'F', 'C', 'S' };
+    const uint32_t streamVersion = 1;
+
+    struct PacketHeader {
+        uint16_t op;
+        uint16_t reserved;
+        uint32_t size;          ///< Bytes de datos, sin contar la cabecera ni el relleno
+    };
+
+    /// Los paquetes empiezan alineados a 8 bytes para poder leer las estructuras en su sitio.
+    size_t Padded(size_t size)
+    {
+        return (size + 7) & ~size_t(7);
+    }
+
+    const char* const opNames[] = {
+        "BeginFrame",
+        "EndFrame",
+        "DefineResource",
+        "DefineRootSignature",
+        "DefinePipeline",
+        "DefineDescriptorHeap",
+        "DefineView",
+        "ReleaseObject",
+        "WriteBuffer",
+        "SetRootSignature",
+        "SetDescriptorHeaps",
+        "SetPipeline",
+        "SetRootTable",
+        "SetTopology",
+        "SetVertexBuffer",
+        "SetIndexBuffer",
+        "SetViewport",
+        "SetScissor",
+        "SetRenderTargets",
+        "ClearRenderTarget",
+        "ClearDepth",
+        "Barrier",
+        "DrawIndexed",
+        "Present",
+    };
+    static_assert(sizeof(opNames) / sizeof(opNames[0]) == static_cast<size_t>(CommandOp::Count), "Falta el nombre de alguna operación");
+
+    /// Estructura fija al principio del paquete, o nullptr si el paquete es más corto.
+    template<typename T>
+    const T* Fixed(const CommandPacket& packet, size_t extraSize = 0)
+    {
+        return packet.size >= sizeof(T) + extraSize ? reinterpret_cast<const T*>(packet.payload) : nullptr;
+    }
+
+    const uint8_t* Extra(const CommandPacket& packet, size_t fixedSize)
+    {
+        return packet.payload + fixedSize;
+    }
+
+    /// Entrega un paquete al backend; false si está truncado o la operación no existe.
+    bool Dispatch(const CommandPacket& packet, CommandSink& sink)
+    {
+        switch (packet.op)
+        {
+        case CommandOp::BeginFrame:
+            if (auto command = Fixed<FrameCommand>(packet)) { sink.BeginFrame(*command); return true; }
+            return false;
+        case CommandOp::EndFrame:
+            sink.EndFrame();
+            return true;
+        case CommandOp::DefineResource:
+        {
+            auto resource = Fixed<CapturedResource>(packet);
+            if (!resource || !Fixed<CapturedResource>(packet, resource->initialDataSize)) return false;
+            sink.DefineResource(*resource, resource->initialDataSize ? Extra(packet, sizeof(CapturedResource)) : nullptr);
+            return true;
+        }
+        case CommandOp::DefineRootSignature:
+        {
+            auto rootSignature = Fixed<CapturedRootSignature>(packet);
+            if (!rootSignature || !Fixed<CapturedRootSignature>(packet, rootSignature->blobSize)) return false;
+            sink.DefineRootSignature(*rootSignature, Extra(packet, sizeof(CapturedRootSignature)));
+            return true;
+        }
+        case CommandOp::DefinePipeline:
+        {
+            auto pipeline = Fixed<CapturedPipeline>(packet);
+            if (!pipeline) return false;
+            size_t elementsSize = sizeof(CapturedInputElement) * pipeline->inputElementCount;
+            if (!Fixed<CapturedPipeline>(packet, elementsSize + pipeline->vertexShaderSize + pipeline->pixelShaderSize)) return false;
+            const uint8_t* elements = Extra(packet, sizeof(CapturedPipeline));
+            sink.DefinePipeline(*pipeline, reinterpret_cast<const CapturedInputElement*>(elements),
+                elements + elementsSize, elements + elementsSize + pipeline->vertexShaderSize);
+            return true;
+        }
+        case CommandOp::DefineDescriptorHeap:
+            if (auto heap = Fixed<CapturedDescriptorHeap>(packet)) { sink.DefineDescriptorHeap(*heap); return true; }
+            return false;
+        case CommandOp::DefineView:
+            if (auto view = Fixed<CapturedView>(packet)) { sink.DefineView(*view); return true; }
+            return false;
+        case CommandOp::ReleaseObject:
+            if (auto command = Fixed<ObjectCommand>(packet)) { sink.ReleaseObject(*command); return true; }
+            return false;
+        case CommandOp::WriteBuffer:
+        {
+            auto write = Fixed<BufferWriteCommand>(packet);
+            if (!write || !Fixed<BufferWriteCommand>(packet, write->size)) return false;
+            sink.WriteBuffer(*write, Extra(packet, sizeof(BufferWriteCommand)));
+            return true;
+        }
+        case CommandOp::SetRootSignature:
+            if (auto command = Fixed<ObjectCommand>(packet)) { sink.SetRootSignature(*command); return true; }
+            return false;
+        case CommandOp::SetDescriptorHeaps:
+            if (auto command = Fixed<SetDescriptorHeapsCommand>(packet)) { sink.SetDescriptorHeaps(*command); return true; }
+            return false;
+        case CommandOp::SetPipeline:
+            if (auto command = Fixed<ObjectCommand>(packet)) { sink.SetPipeline(*command); return true; }
+            return false;
+        case CommandOp::SetRootTable:
+            if (auto command = Fixed<SetRootTableCommand>(packet)) { sink.SetRootTable(*command); return true; }
+            return false;
+        case CommandOp::SetTopology:
+            if (auto command = Fixed<SetTopologyCommand>(packet)) { sink.SetTopology(*command); return true; }
+            return false;
+        case CommandOp::SetVertexBuffer:
+            if (auto command = Fixed<SetVertexBufferCommand>(packet)) { sink.SetVertexBuffer(*command); return true; }
+            return false;
+        case CommandOp::SetIndexBuffer:
+            if (auto command = Fixed<SetIndexBufferCommand>(packet)) { sink.SetIndexBuffer(*command); return true; }
+            return false;
+        case CommandOp::SetViewport:
+            if (auto command = Fixed<ViewportCommand>(packet)) { sink.SetViewport(*command); return true; }
+            return false;
+        case CommandOp::SetScissor:
+            if (auto command = Fixed<ScissorCommand>(packet)) { sink.SetScissor(*command); return true; }
+            return false;
+        case CommandOp::SetRenderTargets:
+            if (auto command = Fixed<SetRenderTargetsCommand>(packet)) { sink.SetRenderTargets(*command); return true; }
+            return false;
+        case CommandOp::ClearRenderTarget:
+            if (auto command = Fixed<ClearRenderTargetCommand>(packet)) { sink.ClearRenderTarget(*command); return true; }
+            return false;
+        case CommandOp::ClearDepth:
+            if (auto command = Fixed<ClearDepthCommand>(packet)) { sink.ClearDepth(*command); return true; }
+            return false;
+        case CommandOp::Barrier:
+            if (auto command = Fixed<BarrierCommand>(packet)) { sink.Barrier(*command); return true; }
+            return false;
+        case CommandOp::DrawIndexed:
+            if (auto command = Fixed<DrawIndexedCommand>(packet)) { sink.DrawIndexed(*command); return true; }
+            return false;
+        case CommandOp::Present:
+            sink.Present();
+            return true;
+        default:
+            return false;
+        }
+    }
+}
+
+void CommandStreamWriter::Write(CommandOp op, const void* payload, uint32_t payloadSize, const void* extra, uint32_t extraSize)
+{
+    size_t start = data.size();
+    PacketHeader header = { static_cast<uint16_t>(op), 0, payloadSize + extraSize };
+    data.resize(start + sizeof(PacketHeader) + Padded(header.size));
+    uint8_t* destination = data.data() + start;
+    memcpy(destination, &header, sizeof(header));
+    if (payloadSize)
+    {
+        memcpy(destination + sizeof(header), payload, payloadSize);
+    }
+    if (extraSize)
+    {
+        memcpy(destination + sizeof(header) + payloadSize, extra, extraSize);
+    }
+    packetCount++;
+}
+
+void CommandStreamWriter::Save(std::ostream& stream) const
+{
+    stream.write(streamMagic, sizeof(streamMagic));
+    stream.write(reinterpret_cast<const char*>(&streamVersion), sizeof(streamVersion));
+    stream.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+}
+
+bool CommandStreamReader::Load(std::istream& stream)
+{
+    char magic[sizeof(streamMagic)];
+    uint32_t version = 0;
+    stream.read(magic, sizeof(magic));
+    stream.read(reinterpret_cast<char*>(&version), sizeof(version));
+    if (!stream || memcmp(magic, streamMagic, sizeof(magic)) != 0 || version != streamVersion)
+    {
+        return false;
+    }
+
+    data.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    position = 0;
+    return true;
+}
+
+bool CommandStreamReader::Next(CommandPacket& packet)
+{
+    if (position + sizeof(PacketHeader) > data.size())
+    {
+        return false;
+    }
+
+    PacketHeader header;
+    memcpy(&header, data.data() + position, sizeof(header));
+    size_t next = position + sizeof(PacketHeader) + Padded(header.size);
+    if (next > data.size())
+    {
+        return false;
+    }
+
+    packet.op = static_cast<CommandOp>(header.op);
+    packet.payload = data.data() + position + sizeof(PacketHeader);
+    packet.size = header.size;
+    position = next;
+    return true;
+}
+
+const char* CommandOpName(CommandOp op)
+{
+    return op < CommandOp::Count ? opNames[static_cast<size_t>(op)] : "Unknown";
+}
+
+void CommandReplayStats::Write(std::ostream& stream) const
+{
+    stream << "op,calls,totalUs,averageUs\n";
+    for (size_t i = 0; i < static_cast<size_t>(CommandOp::Count); i++)
+    {
+        if (calls[i] == 0) continue;
+        double totalUs = Profiler::TicksToMicroseconds(ticks[i]);
+        stream << opNames[i] << ',' << calls[i] << ',' << totalUs << ',' << totalUs / static_cast<double>(calls[i]) << '\n';
+    }
+}
+
+bool ReplayCommandStream(CommandStreamReader& reader, CommandSink& sink, CommandReplayStats* stats)
+{
+    CommandPacket packet;
+    while (reader.Next(packet))
+    {
+        uint64_t start = Profiler::Now();
+        if (!Dispatch(packet, sink))
+        {
+            return false;
+        }
+
+        if (stats)
+        {
+            size_t op = static_cast<size_t>(packet.op);
+            stats->ticks[op] += Profiler::Now() - start;
+            stats->calls[op]++;
+            if (packet.op == CommandOp::EndFrame)
+            {
+                stats->frames++;
+            }
+        }
+    }
+    return reader.AtEnd();
+}
+
+bool DispatchCommandPacket(const CommandPacket& packet, CommandSink& sink)
+{
+    return Dispatch(packet, sink);
+}
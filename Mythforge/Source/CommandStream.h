@@ -0,0 +1,412 @@
+﻿/**
+ * @file CommandStream.h
+ * @brief Formato binario de captura del flujo de comandos y su reproducción sobre un backend.
+ *
+ * Una captura guarda, como paquetes {operación, tamaño, datos}, las definiciones de los objetos
+ * que usa el fotograma (recursos, firmas raíz, pipelines, heaps y vistas de descriptores), las
+ * escrituras de CPU en búferes y los comandos grabados, fotograma a fotograma. Los objetos se
+ * identifican por un CaptureId y los enumerados de Direct3D se guardan como enteros, así que esta
+ * parte no depende de Direct3D y compila en cualquier plataforma: ReplayCommandStream recorre una
+ * captura y la entrega a un CommandSink, que puede ser la GPU (D3D12CommandSink) o NullCommandSink,
+ * midiendo el coste de CPU de cada tipo de llamada.
+ *
+ * Los datos se escriben en el orden de bytes de la máquina (little-endian en todas las plataformas
+ * soportadas).
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+/// Identificador de un objeto dentro de una captura; 0 es nulo.
+using CaptureId = uint32_t;
+
+enum class CommandOp : uint16_t {
+    BeginFrame,
+    EndFrame,
+    DefineResource,
+    DefineRootSignature,
+    DefinePipeline,
+    DefineDescriptorHeap,
+    DefineView,
+    ReleaseObject,
+    WriteBuffer,
+    SetRootSignature,
+    SetDescriptorHeaps,
+    SetPipeline,
+    SetRootTable,
+    SetTopology,
+    SetVertexBuffer,
+    SetIndexBuffer,
+    SetViewport,
+    SetScissor,
+    SetRenderTargets,
+    ClearRenderTarget,
+    ClearDepth,
+    Barrier,
+    DrawIndexed,
+    Present,
+    Count
+};
+
+/**
+ * @struct CapturedResource
+ * @brief Descripción de un recurso. Le siguen initialDataSize bytes de contenido inicial.
+ *
+ * En las texturas el contenido son todos los subrecursos seguidos, en el orden de Direct3D (mips
+ * de cada elemento del array), con las filas compactadas a ancho * 4 bytes; solo se guardan los
+ * formatos RGBA8 y BGRA8. Los recursos cuyo contenido no se guarda se reproducen a cero.
+ */
+struct CapturedResource {
+    CaptureId id;
+    uint32_t  dimension;        ///< D3D12_RESOURCE_DIMENSION
+    uint64_t  width;
+    uint32_t  height;
+    uint16_t  depthOrArraySize;
+    uint16_t  mipLevels;
+    uint32_t  format;           ///< DXGI_FORMAT
+    uint32_t  sampleCount;
+    uint32_t  flags;            ///< D3D12_RESOURCE_FLAGS
+    uint32_t  heapType;         ///< D3D12_HEAP_TYPE
+    uint32_t  state;            ///< D3D12_RESOURCE_STATES en el que está el recurso entre fotogramas
+    uint32_t  initialDataSize;
+};
+
+/**
+ * @struct CapturedRootSignature
+ * @brief Firma raíz serializada. Le siguen blobSize bytes.
+ */
+struct CapturedRootSignature {
+    CaptureId id;
+    uint32_t  blobSize;
+};
+
+/**
+ * @struct CapturedInputElement
+ * @brief Elemento del input layout de un pipeline.
+ */
+struct CapturedInputElement {
+    char     semanticName[24];
+    uint32_t semanticIndex;
+    uint32_t format;            ///< DXGI_FORMAT
+    uint32_t inputSlot;
+    uint32_t alignedByteOffset;
+    uint32_t perInstance;
+    uint32_t instanceStepRate;
+};
+
+/**
+ * @struct CapturedPipeline
+ * @brief Pipeline gráfico. Le siguen inputElementCount CapturedInputElement y los bytecodes de VS y PS.
+ *
+ * Solo se guarda el estado que el motor cambia respecto a los valores por defecto de d3dx12:
+ * rasterizador, profundidad, formatos y topología. La mezcla es siempre la de por defecto.
+ */
+struct CapturedPipeline {
+    CaptureId id;
+    CaptureId rootSignature;
+    uint32_t  inputElementCount;
+    uint32_t  vertexShaderSize;
+    uint32_t  pixelShaderSize;
+    uint32_t  topologyType;     ///< D3D12_PRIMITIVE_TOPOLOGY_TYPE
+    uint32_t  renderTargetCount;
+    uint32_t  renderTargetFormat;
+    uint32_t  depthStencilFormat;
+    uint32_t  sampleCount;
+    uint32_t  fillMode;
+    uint32_t  cullMode;
+    uint32_t  frontCounterClockwise;
+    uint32_t  depthEnable;
+    uint32_t  depthWriteMask;
+    uint32_t  depthFunc;
+};
+
+/**
+ * @struct CapturedDescriptorHeap
+ * @brief Heap de descriptores.
+ */
+struct CapturedDescriptorHeap {
+    CaptureId id;
+    uint32_t  type;             ///< D3D12_DESCRIPTOR_HEAP_TYPE
+    uint32_t  count;
+    uint32_t  shaderVisible;
+};
+
+enum class CapturedViewKind : uint32_t {
+    ConstantBuffer,
+    ShaderResource,
+    RenderTarget,
+    DepthStencil
+};
+
+/**
+ * @struct CapturedView
+ * @brief Vista escrita en una posición de un heap de descriptores.
+ */
+struct CapturedView {
+    CaptureId        heap;
+    uint32_t         index;
+    CapturedViewKind kind;
+    CaptureId        resource;
+    uint32_t         format;        ///< 0 para el formato del recurso
+    uint32_t         viewDimension; ///< D3D12_SRV_DIMENSION o D3D12_DSV_DIMENSION; 0 para la vista por defecto
+    uint32_t         mipLevels;
+    uint32_t         mostDetailedMip;
+    uint64_t         bufferOffset;  ///< Solo vistas de constantes
+    uint32_t         bufferSize;
+    uint32_t         reserved;
+};
+
+/**
+ * @struct BufferWriteCommand
+ * @brief Escritura de CPU en un búfer mapeado. Le siguen size bytes.
+ */
+struct BufferWriteCommand {
+    CaptureId resource;
+    uint32_t  size;
+    uint64_t  offset;
+};
+
+struct FrameCommand {
+    uint32_t frame;
+};
+
+/// Payload de SetRootSignature, SetPipeline y ReleaseObject.
+struct ObjectCommand {
+    CaptureId id;
+};
+
+struct SetDescriptorHeapsCommand {
+    uint32_t  count;
+    CaptureId heaps[2];
+};
+
+struct SetRootTableCommand {
+    uint32_t  rootIndex;
+    CaptureId heap;
+    uint32_t  index;
+};
+
+struct SetTopologyCommand {
+    uint32_t topology;          ///< D3D_PRIMITIVE_TOPOLOGY
+};
+
+struct SetVertexBufferCommand {
+    uint32_t  slot;
+    CaptureId resource;
+    uint64_t  offset;
+    uint32_t  size;
+    uint32_t  stride;
+};
+
+struct SetIndexBufferCommand {
+    CaptureId resource;
+    uint32_t  format;
+    uint64_t  offset;
+    uint32_t  size;
+    uint32_t  reserved;
+};
+
+struct ViewportCommand {
+    float x, y, width, height, minDepth, maxDepth;
+};
+
+struct ScissorCommand {
+    int32_t left, top, right, bottom;
+};
+
+/// Un destino de color como mucho; heap 0 si no hay.
+struct SetRenderTargetsCommand {
+    CaptureId renderTargetHeap;
+    uint32_t  renderTargetIndex;
+    CaptureId depthStencilHeap;
+    uint32_t  depthStencilIndex;
+};
+
+struct ClearRenderTargetCommand {
+    CaptureId heap;
+    uint32_t  index;
+    float     color[4];
+};
+
+struct ClearDepthCommand {
+    CaptureId heap;
+    uint32_t  index;
+    uint32_t  flags;            ///< D3D12_CLEAR_FLAGS
+    float     depth;
+    uint32_t  stencil;
+};
+
+/// Transición de estado de un recurso.
+struct BarrierCommand {
+    CaptureId resource;
+    uint32_t  subresource;
+    uint32_t  before;
+    uint32_t  after;
+};
+
+struct DrawIndexedCommand {
+    uint32_t indexCount;
+    uint32_t instanceCount;
+    uint32_t startIndex;
+    int32_t  baseVertex;
+    uint32_t startInstance;
+};
+
+/**
+ * @class CommandStreamWriter
+ * @brief Acumula paquetes en memoria y los vuelca a un fichero de captura.
+ */
+class CommandStreamWriter {
+public:
+    void Clear() { data.clear(); packetCount = 0; }
+
+    /// Añade un paquete con su estructura fija y, detrás, extraSize bytes opcionales.
+    void Write(CommandOp op, const void* payload, uint32_t payloadSize, const void* extra = nullptr, uint32_t extraSize = 0);
+
+    template<typename T>
+    void Write(CommandOp op, const T& payload, const void* extra = nullptr, uint32_t extraSize = 0)
+    {
+        Write(op, &payload, sizeof(T), extra, extraSize);
+    }
+
+    /// Cabecera del formato seguida de todos los paquetes.
+    void Save(std::ostream& stream) const;
+
+    size_t   Size() const { return data.size(); }
+    uint32_t PacketCount() const { return packetCount; }
+
+private:
+    std::vector<uint8_t> data;
+    uint32_t             packetCount = 0;
+};
+
+/**
+ * @struct CommandPacket
+ * @brief Paquete leído de una captura. Los punteros apuntan a la memoria del lector.
+ */
+struct CommandPacket {
+    CommandOp      op;
+    const uint8_t* payload;
+    uint32_t       size;
+};
+
+/**
+ * @class CommandStreamReader
+ * @brief Recorre los paquetes de un fichero de captura.
+ */
+class CommandStreamReader {
+public:
+    /// Lee el fichero entero y comprueba la cabecera.
+    bool Load(std::istream& stream);
+
+    /// Siguiente paquete; false al terminar o si el paquete está truncado.
+    bool Next(CommandPacket& packet);
+
+    /// true si se han leído todos los paquetes sin encontrar ninguno truncado.
+    bool AtEnd() const { return position == data.size(); }
+
+    void Rewind() { position = 0; }
+
+private:
+    std::vector<uint8_t> data;
+    size_t               position = 0;
+};
+
+/**
+ * @class CommandSink
+ * @brief Backend que recibe los paquetes de una reproducción.
+ *
+ * Los datos que siguen a cada definición se pasan ya separados; su tamaño está en la propia
+ * estructura. Los punteros solo son válidos durante la llamada.
+ */
+class CommandSink {
+public:
+    virtual ~CommandSink() = default;
+
+    virtual void BeginFrame(const FrameCommand& command) = 0;
+    virtual void EndFrame() = 0;
+    virtual void DefineResource(const CapturedResource& resource, const void* initialData) = 0;
+    virtual void DefineRootSignature(const CapturedRootSignature& rootSignature, const void* blob) = 0;
+    virtual void DefinePipeline(const CapturedPipeline& pipeline, const CapturedInputElement* inputElements, const void* vertexShader, const void* pixelShader) = 0;
+    virtual void DefineDescriptorHeap(const CapturedDescriptorHeap& heap) = 0;
+    virtual void DefineView(const CapturedView& view) = 0;
+    virtual void ReleaseObject(const ObjectCommand& command) = 0;
+    virtual void WriteBuffer(const BufferWriteCommand& command, const void* data) = 0;
+    virtual void SetRootSignature(const ObjectCommand& command) = 0;
+    virtual void SetDescriptorHeaps(const SetDescriptorHeapsCommand& command) = 0;
+    virtual void SetPipeline(const ObjectCommand& command) = 0;
+    virtual void SetRootTable(const SetRootTableCommand& command) = 0;
+    virtual void SetTopology(const SetTopologyCommand& command) = 0;
+    virtual void SetVertexBuffer(const SetVertexBufferCommand& command) = 0;
+    virtual void SetIndexBuffer(const SetIndexBufferCommand& command) = 0;
+    virtual void SetViewport(const ViewportCommand& command) = 0;
+    virtual void SetScissor(const ScissorCommand& command) = 0;
+    virtual void SetRenderTargets(const SetRenderTargetsCommand& command) = 0;
+    virtual void ClearRenderTarget(const ClearRenderTargetCommand& command) = 0;
+    virtual void ClearDepth(const ClearDepthCommand& command) = 0;
+    virtual void Barrier(const BarrierCommand& command) = 0;
+    virtual void DrawIndexed(const DrawIndexedCommand& command) = 0;
+    virtual void Present() = 0;
+};
+
+/**
+ * @class NullCommandSink
+ * @brief Backend que descarta todo. Mide el coste del propio recorrido de la captura.
+ */
+class NullCommandSink : public CommandSink {
+public:
+    void BeginFrame(const FrameCommand&) override {}
+    void EndFrame() override {}
+    void DefineResource(const CapturedResource&, const void*) override {}
+    void DefineRootSignature(const CapturedRootSignature&, const void*) override {}
+    void DefinePipeline(const CapturedPipeline&, const CapturedInputElement*, const void*, const void*) override {}
+    void DefineDescriptorHeap(const CapturedDescriptorHeap&) override {}
+    void DefineView(const CapturedView&) override {}
+    void ReleaseObject(const ObjectCommand&) override {}
+    void WriteBuffer(const BufferWriteCommand&, const void*) override {}
+    void SetRootSignature(const ObjectCommand&) override {}
+    void SetDescriptorHeaps(const SetDescriptorHeapsCommand&) override {}
+    void SetPipeline(const ObjectCommand&) override {}
+    void SetRootTable(const SetRootTableCommand&) override {}
+    void SetTopology(const SetTopologyCommand&) override {}
+    void SetVertexBuffer(const SetVertexBufferCommand&) override {}
+    void SetIndexBuffer(const SetIndexBufferCommand&) override {}
+    void SetViewport(const ViewportCommand&) override {}
+    void SetScissor(const ScissorCommand&) override {}
+    void SetRenderTargets(const SetRenderTargetsCommand&) override {}
+    void ClearRenderTarget(const ClearRenderTargetCommand&) override {}
+    void ClearDepth(const ClearDepthCommand&) override {}
+    void Barrier(const BarrierCommand&) override {}
+    void DrawIndexed(const DrawIndexedCommand&) override {}
+    void Present() override {}
+};
+
+/**
+ * @struct CommandReplayStats
+ * @brief Llamadas y tiempo de CPU por tipo de paquete de una reproducción.
+ */
+struct CommandReplayStats {
+    uint64_t calls[static_cast<size_t>(CommandOp::Count)] = {};
+    uint64_t ticks[static_cast<size_t>(CommandOp::Count)] = {};   ///< Ticks del reloj del perfilador
+    uint32_t frames = 0;
+
+    /// Tabla con llamadas, tiempo total y medio por llamada de cada operación, en microsegundos.
+    void Write(std::ostream& stream) const;
+};
+
+/// Nombre de la operación, para informes.
+const char* CommandOpName(CommandOp op);
+
+/**
+ * @brief Entrega todos los paquetes de la captura al backend.
+ * @param stats Si no es nulo, acumula llamadas y tiempo de cada operación.
+ * @return false si la captura tiene un paquete desconocido o truncado; lo anterior ya se ha entregado.
+ */
+bool ReplayCommandStream(CommandStreamReader& reader, CommandSink& sink, CommandReplayStats* stats = nullptr);
+
+/// Entrega un solo paquete al backend; false si está truncado o la operación no existe.
+bool DispatchCommandPacket(const CommandPacket& packet, CommandSink& sink);
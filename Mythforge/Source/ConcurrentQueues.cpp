@@ -0,0 +1,116 @@
+﻿/**
+ * @file ConcurrentQueues.cpp
+ * @brief Implementación de EventCount y de la cola intrusiva MpscQueue.
+ */
+
+#include "pch.h"
+#include "ConcurrentQueues.h"
+
+namespace ConcurrentQueues
+{
+    size_t RoundUpCapacity(size_t value)
+    {
+        size_t capacity = 2;
+        while (capacity < value)
+        {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+}
+
+uint64_t EventCount::PrepareWait()
+{
+    // Esta suma y la de Notify se ordenan entre sí: o Notify ve waiters > 0 o lee esta suma y con
+    // ella todo lo que el que avisa publicó antes, que el que espera verá al volver a comprobar.
+    waiters.fetch_add(1, std::memory_order_acq_rel);
+    return epoch.load(std::memory_order_relaxed);
+}
+
+void EventCount::CancelWait()
+{
+    waiters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void EventCount::Wait(uint64_t key)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this, key]() { return epoch.load(std::memory_order_relaxed) != key; });
+    }
+    waiters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void EventCount::NotifyOne()
+{
+    Notify(false);
+}
+
+void EventCount::NotifyAll()
+{
+    Notify(true);
+}
+
+void EventCount::Notify(bool all)
+{
+    // Una lectura con escritura y no una barrera: la ordena respecto a PrepareWait sin depender de fences, que ThreadSanitizer no entiende.
+    if (waiters.fetch_add(0, std::memory_order_acq_rel) == 0) return;
+
+    // El cambio de epoch va bajo el mutex: un Wait que aún no duerme lo ve al comprobar su condición.
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        epoch.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (all)
+    {
+        condition.notify_all();
+    }
+    else
+    {
+        condition.notify_one();
+    }
+}
+
+MpscQueue::MpscQueue()
+    : head(&stub), tail(&stub)
+{
+}
+
+void MpscQueue::Push(MpscNode* node)
+{
+    node->next.store(nullptr, std::memory_order_relaxed);
+    MpscNode* previous = head.exchange(node, std::memory_order_acq_rel);
+    // Entre el exchange y este store la lista está cortada: Pop lo ve como un Push a medias.
+    previous->next.store(node, std::memory_order_release);
+}
+
+MpscNode* MpscQueue::Pop()
+{
+    MpscNode* first = tail;
+    MpscNode* next = first->next.load(std::memory_order_acquire);
+    if (first == &stub)
+    {
+        if (!next) return nullptr;
+        tail = next;
+        first = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+    if (next)
+    {
+        tail = next;
+        return first;
+    }
+
+    // first es el último nodo enlazado. Si no es el último encolado, hay un Push a medias.
+    if (first != head.load(std::memory_order_acquire)) return nullptr;
+
+    // Se vuelve a poner el stub detrás para poder soltar first sin dejar la lista vacía.
+    Push(&stub);
+    next = first->next.load(std::memory_order_acquire);
+    if (next)
+    {
+        tail = next;
+        return first;
+    }
+    return nullptr;
+}
@@ -0,0 +1,273 @@
+﻿/**
+ * @file ConcurrentQueues.h
+ * @brief Colas sin bloqueos para pasar trabajo entre hilos y un EventCount para dormir mientras están vacías.
+ *
+ * - SpscRing: anillo acotado de un productor y un consumidor. Cada lado guarda una copia del
+ *   índice del otro y solo la relee cuando el anillo parece lleno o vacío, así que en régimen
+ *   estable cada operación toca una sola línea de caché compartida.
+ * - MpmcQueue: cola acotada de varios productores y consumidores (Dmitry Vyukov). Cada celda lleva
+ *   un número de secuencia que dice si está libre u ocupada para la vuelta actual del anillo; los
+ *   índices de escritura y lectura se reservan con compare-exchange.
+ * - MpscQueue: cola intrusiva sin límite de varios productores y un consumidor (Vyukov). Push es
+ *   un solo exchange; los nodos los pone quien llama, así que no asigna memoria.
+ *
+ * Ninguna bloquea. Para esperar a que haya algo se usa un EventCount junto a la cola: el
+ * consumidor anuncia que va a dormir, vuelve a mirar la cola y solo entonces duerme; el productor
+ * avisa después de publicar y solo paga el mutex si hay alguien durmiendo. Los índices y datos
+ * que escriben hilos distintos van en líneas de caché separadas.
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+constexpr size_t CacheLineSize = 64;
+
+namespace ConcurrentQueues
+{
+    /// Potencia de dos mayor o igual que value, al menos 2.
+    size_t RoundUpCapacity(size_t value);
+}
+
+/**
+ * @class EventCount
+ * @brief Espera sin condiciones perdidas sobre un estado que se comprueba sin bloqueos.
+ *
+ * Uso del lado que espera:
+ *
+ *     for (;;) {
+ *         if (queue.TryPop(item)) break;
+ *         uint64_t key = event.PrepareWait();
+ *         if (queue.TryPop(item)) { event.CancelWait(); break; }
+ *         event.Wait(key);
+ *     }
+ *
+ * El lado que publica llama a NotifyOne o NotifyAll después de cambiar el estado.
+ */
+class EventCount {
+public:
+    /// Anuncia la espera. Después hay que volver a comprobar el estado y llamar a CancelWait o a Wait.
+    uint64_t PrepareWait();
+    void CancelWait();
+
+    /// Duerme hasta un Notify posterior a PrepareWait. Puede volver sin que el estado haya cambiado.
+    void Wait(uint64_t key);
+
+    /// Sin nadie esperando no toca el mutex.
+    void NotifyOne();
+    void NotifyAll();
+
+private:
+    void Notify(bool all);
+
+    std::atomic<uint32_t>   waiters{ 0 };
+    std::atomic<uint64_t>   epoch{ 0 };
+    std::mutex              mutex;
+    std::condition_variable condition;
+};
+
+/**
+ * @class SpscRing
+ * @brief Anillo acotado de un productor y un consumidor.
+ *
+ * TryPush solo desde el hilo productor y TryPop y Empty solo desde el consumidor. La capacidad se
+ * redondea a potencia de dos. T debe poder construirse por defecto y asignarse por movimiento.
+ */
+template<typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+        : mask(ConcurrentQueues::RoundUpCapacity(capacity) - 1), items(new T[mask + 1])
+    {
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t Capacity() const { return mask + 1; }
+
+    /// false si está lleno.
+    template<typename U>
+    bool TryPush(U&& value)
+    {
+        size_t position = producer.tail.load(std::memory_order_relaxed);
+        if (position - producer.cachedHead > mask)
+        {
+            producer.cachedHead = consumer.head.load(std::memory_order_acquire);
+            if (position - producer.cachedHead > mask) return false;
+        }
+        items[position & mask] = std::forward<U>(value);
+        producer.tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// false si está vacío.
+    bool TryPop(T& value)
+    {
+        size_t position = consumer.head.load(std::memory_order_relaxed);
+        if (position == consumer.cachedTail)
+        {
+            consumer.cachedTail = producer.tail.load(std::memory_order_acquire);
+            if (position == consumer.cachedTail) return false;
+        }
+        value = std::move(items[position & mask]);
+        consumer.head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Empty() const
+    {
+        return consumer.head.load(std::memory_order_relaxed) == producer.tail.load(std::memory_order_acquire);
+    }
+
+private:
+    struct alignas(CacheLineSize) Producer {
+        std::atomic<size_t> tail{ 0 };
+        size_t              cachedHead = 0;     ///< Última lectura de consumer.head
+    };
+
+    struct alignas(CacheLineSize) Consumer {
+        std::atomic<size_t> head{ 0 };
+        size_t              cachedTail = 0;     ///< Última lectura de producer.tail
+    };
+
+    const size_t         mask;
+    std::unique_ptr<T[]> items;
+    Producer             producer;
+    Consumer             consumer;
+};
+
+/**
+ * @class MpmcQueue
+ * @brief Cola acotada de varios productores y varios consumidores.
+ *
+ * FIFO para cada productor. La capacidad se redondea a potencia de dos. T debe poder construirse
+ * por defecto y asignarse por movimiento.
+ */
+template<typename T>
+class MpmcQueue {
+public:
+    explicit MpmcQueue(size_t capacity)
+        : mask(ConcurrentQueues::RoundUpCapacity(capacity) - 1), cells(new Cell[mask + 1])
+    {
+        for (size_t i = 0; i <= mask; i++)
+        {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    size_t Capacity() const { return mask + 1; }
+
+    /// false si está llena.
+    template<typename U>
+    bool TryPush(U&& value)
+    {
+        size_t position = enqueuePosition.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell& cell = cells[position & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0)
+            {
+                // Celda libre en esta vuelta: es nuestra si nadie ha movido el índice mientras tanto.
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    cell.value = std::forward<U>(value);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                // La celda aún tiene el valor de la vuelta anterior.
+                return false;
+            }
+            else
+            {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// false si está vacía.
+    bool TryPop(T& value)
+    {
+        size_t position = dequeuePosition.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell& cell = cells[position & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+            if (difference == 0)
+            {
+                if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    value = std::move(cell.value);
+                    // La celda queda libre para la vuelta siguiente.
+                    cell.sequence.store(position + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = dequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T                   value;
+    };
+
+    const size_t            mask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(CacheLineSize) std::atomic<size_t> enqueuePosition{ 0 };
+    alignas(CacheLineSize) std::atomic<size_t> dequeuePosition{ 0 };
+};
+
+/**
+ * @struct MpscNode
+ * @brief Enlace que se incluye en los objetos que viajan por una MpscQueue.
+ */
+struct MpscNode {
+    std::atomic<MpscNode*> next{ nullptr };
+};
+
+/**
+ * @class MpscQueue
+ * @brief Cola intrusiva sin límite de varios productores y un consumidor.
+ *
+ * El nodo pertenece a la cola desde Push hasta que Pop lo devuelve. Pop solo desde el hilo
+ * consumidor; puede devolver nullptr aunque haya nodos si un productor está a medio Push, y en
+ * ese caso basta con volver a intentarlo.
+ */
+class MpscQueue {
+public:
+    MpscQueue();
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void Push(MpscNode* node);
+    MpscNode* Pop();
+
+private:
+    alignas(CacheLineSize) std::atomic<MpscNode*> head;    ///< Último nodo encolado; lo mueven los productores
+    alignas(CacheLineSize) MpscNode*              tail;    ///< Próximo nodo a sacar; solo el consumidor
+    MpscNode                                      stub;    ///< Nodo vacío que mantiene la lista no vacía
+};
@@ -0,0 +1,280 @@
+/**
+ * @file ConstantBufferLayout.h
+ * @brief Constant buffers descritos una sola vez para C++ y HLSL, con el empaquetado de HLSL comprobado al compilar.
+ *
+ * Un constant buffer se describe con una lista de campos en forma de macro X:
+ *
+ *     #define MYTHFORGE_OBJECT_CONSTANTS(FIELD) \
+ *         FIELD(Hlsl::float4x4, worldViewProjection)
+ *     MYTHFORGE_CONSTANT_BUFFER(ObjectConstants, 0, MYTHFORGE_OBJECT_CONSTANTS)
+ *
+ * De ahí salen el struct de C++, su tabla de campos y un static_assert que compara el offset de
+ * cada campo en C++ con el que le da HLSL: los campos van seguidos salvo que uno cruce un límite
+ * de 16 bytes, y las matrices y los arrays empiezan registro. Si no coinciden no compila, y hay que
+ * reordenar los campos o poner el relleno como un campo más, a la vista. HlslDeclaration escribe la
+ * declaración de HLSL con un packoffset por campo, así que el shader no puede entender otra cosa;
+ * ShaderCompiler la deja en Shaders/Constants.
+ *
+ * ConstantWriter escribe cada campo directamente en la memoria mapeada, que es de escritura
+ * combinada: se escribe sin leerla y sin copia intermedia. Las matrices de HLSL se guardan por
+ * columnas; Hlsl::Store traspone al escribir una XMMATRIX y es el único sitio que lo hace.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+
+namespace Hlsl
+{
+    struct float2 { float x, y; };
+    struct float3 { float x, y, z; };
+    struct float4 { float x, y, z, w; };
+    struct uint2 { uint32_t x, y; };
+    struct uint4 { uint32_t x, y, z, w; };
+    struct float4x4 { float m[4][4]; };     ///< Por columnas, como lo lee HLSL
+
+    template<typename T>
+    void Store(T* destination, const T& value)
+    {
+        memcpy(destination, &value, sizeof(T));
+    }
+
+#if defined(DIRECTX_MATH_VERSION)
+    static_assert(sizeof(float4x4) == sizeof(DirectX::XMFLOAT4X4), "float4x4 tiene que poder guardarse con XMStoreFloat4x4");
+
+    inline void Store(float4x4* destination, DirectX::FXMMATRIX value)
+    {
+        DirectX::XMStoreFloat4x4(reinterpret_cast<DirectX::XMFLOAT4X4*>(destination), DirectX::XMMatrixTranspose(value));
+    }
+
+    inline void Store(float4* destination, DirectX::FXMVECTOR value)
+    {
+        DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*>(destination), value);
+    }
+
+    inline void Store(float3* destination, DirectX::FXMVECTOR value)
+    {
+        DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(destination), value);
+    }
+
+    inline void Store(float2* destination, DirectX::FXMVECTOR value)
+    {
+        DirectX::XMStoreFloat2(reinterpret_cast<DirectX::XMFLOAT2*>(destination), value);
+    }
+#endif
+}
+
+/**
+ * @struct HlslType
+ * @brief Nombre y tamaño en HLSL de un tipo de campo. Un tipo sin especialización no compila.
+ */
+template<typename T>
+struct HlslType;
+
+template<const char* Name, uint32_t Size, bool NewRegister = false>
+struct HlslTypeInfo {
+    static constexpr const char* name = Name;
+    static constexpr uint32_t size = Size;
+    static constexpr uint32_t count = 0;            ///< Elementos si es un array
+    static constexpr bool newRegister = NewRegister;  ///< Empieza en un registro de 16 bytes aunque quepa en el anterior
+};
+
+namespace HlslTypeNames
+{
+    inline constexpr char Float[] = "float";
+    inline constexpr char Float2[] = "float2";
+    inline constexpr char Float3[] = "float3";
+    inline constexpr char Float4[] = "float4";
+    inline constexpr char Int[] = "int";
+    inline constexpr char Uint[] = "uint";
+    inline constexpr char Uint2[] = "uint2";
+    inline constexpr char Uint4[] = "uint4";
+    inline constexpr char Float4x4[] = "float4x4";
+}
+
+template<> struct HlslType<float> : HlslTypeInfo<HlslTypeNames::Float, 4> {};
+template<> struct HlslType<Hlsl::float2> : HlslTypeInfo<HlslTypeNames::Float2, 8> {};
+template<> struct HlslType<Hlsl::float3> : HlslTypeInfo<HlslTypeNames::Float3, 12> {};
+template<> struct HlslType<Hlsl::float4> : HlslTypeInfo<HlslTypeNames::Float4, 16> {};
+template<> struct HlslType<int32_t> : HlslTypeInfo<HlslTypeNames::Int, 4> {};
+template<> struct HlslType<uint32_t> : HlslTypeInfo<HlslTypeNames::Uint, 4> {};
+template<> struct HlslType<Hlsl::uint2> : HlslTypeInfo<HlslTypeNames::Uint2, 8> {};
+template<> struct HlslType<Hlsl::uint4> : HlslTypeInfo<HlslTypeNames::Uint4, 16> {};
+template<> struct HlslType<Hlsl::float4x4> : HlslTypeInfo<HlslTypeNames::Float4x4, 64, true> {};
+
+/// En HLSL cada elemento de un array empieza registro. Con elementos de 16 bytes el array de C++ ocupa lo mismo.
+template<typename T, size_t N>
+struct HlslType<T[N]> {
+    static_assert(HlslType<T>::size % 16 == 0, "En un cbuffer solo se admiten arrays de elementos de 16 bytes");
+    static constexpr const char* name = HlslType<T>::name;
+    static constexpr uint32_t size = static_cast<uint32_t>(N) * HlslType<T>::size;
+    static constexpr uint32_t count = static_cast<uint32_t>(N);
+    static constexpr bool newRegister = true;
+};
+
+/**
+ * @struct ConstantField
+ * @brief Un campo de un constant buffer: su tipo en HLSL y dónde está en el struct de C++.
+ */
+struct ConstantField {
+    const char* name;
+    const char* type;
+    uint32_t    offset;         ///< offsetof en C++
+    uint32_t    size;
+    uint32_t    count;          ///< Elementos si es un array, 0 si no
+    bool        newRegister;
+};
+
+template<typename T>
+constexpr ConstantField DescribeConstantField(const char* name, size_t offset)
+{
+    return { name, HlslType<T>::name, static_cast<uint32_t>(offset), HlslType<T>::size, HlslType<T>::count, HlslType<T>::newRegister };
+}
+
+/**
+ * @struct ConstantBufferTraits
+ * @brief Nombre, registro y campos de un constant buffer. La especializa MYTHFORGE_CONSTANT_BUFFER.
+ */
+template<typename Buffer>
+struct ConstantBufferTraits;
+
+namespace ConstantBufferLayout
+{
+    constexpr uint32_t RegisterBytes = 16;
+    constexpr uint32_t ViewAlignment = 256;     ///< D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT
+    constexpr uint32_t MaxBytes = 4096 * RegisterBytes;
+
+    constexpr uint32_t AlignUp(uint32_t value, uint32_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    /// Offset que HLSL da a un campo cuando ya hay end bytes ocupados.
+    constexpr uint32_t HlslOffset(uint32_t end, const ConstantField& field)
+    {
+        bool crosses = end % RegisterBytes != 0 && end % RegisterBytes + field.size > RegisterBytes;
+        return field.newRegister || crosses ? AlignUp(end, RegisterBytes) : end;
+    }
+
+    /// Índice del primer campo que no está en C++ donde lo pone HLSL, o el número de campos si están todos.
+    template<size_t N>
+    constexpr size_t FirstMismatch(const ConstantField (&fields)[N])
+    {
+        uint32_t end = 0;
+        for (size_t i = 0; i < N; i++)
+        {
+            if (fields[i].offset != HlslOffset(end, fields[i])) return i;
+            end = fields[i].offset + fields[i].size;
+        }
+        return N;
+    }
+
+    /// Tamaño del buffer en HLSL, en registros enteros.
+    template<size_t N>
+    constexpr uint32_t HlslSize(const ConstantField (&fields)[N])
+    {
+        return N ? AlignUp(fields[N - 1].offset + fields[N - 1].size, RegisterBytes) : 0;
+    }
+
+    /// Bytes de relleno que pone HLSL: entre campos y al final del último registro.
+    template<size_t N>
+    constexpr uint32_t PaddingBytes(const ConstantField (&fields)[N])
+    {
+        uint32_t used = 0;
+        for (size_t i = 0; i < N; i++)
+        {
+            used += fields[i].size;
+        }
+        return HlslSize(fields) - used;
+    }
+
+    /// Lo que ocupa una CBV del buffer: D3D12 coloca cada una en múltiplos de 256 bytes.
+    template<typename Buffer>
+    constexpr uint32_t ViewSize()
+    {
+        return AlignUp(HlslSize(ConstantBufferTraits<Buffer>::fields), ViewAlignment);
+    }
+
+    /// Declaración de HLSL del buffer, con un packoffset por campo.
+    template<typename Buffer>
+    std::string HlslDeclaration()
+    {
+        using Traits = ConstantBufferTraits<Buffer>;
+        std::string text = std::string("cbuffer ") + Traits::name + " : register(b" + std::to_string(Traits::registerIndex) + ")\n{\n";
+        for (const ConstantField& field : Traits::fields)
+        {
+            text += std::string("    ") + field.type + " " + field.name;
+            if (field.count)
+            {
+                text += "[" + std::to_string(field.count) + "]";
+            }
+            text += " : packoffset(c" + std::to_string(field.offset / RegisterBytes);
+            uint32_t component = field.offset % RegisterBytes / 4;
+            if (component)
+            {
+                text += std::string(".") + "xyzw"[component];
+            }
+            text += ");\n";
+        }
+        return text + "};\n";
+    }
+}
+
+/**
+ * @class ConstantWriter
+ * @brief Escribe campos de un constant buffer en la memoria mapeada de una de sus copias.
+ */
+template<typename Buffer>
+class ConstantWriter {
+public:
+    explicit ConstantWriter(void* mapped) : buffer(static_cast<Buffer*>(mapped)) {}
+
+    /// Guarda value en el campo Member, convirtiéndolo con Hlsl::Store si no es del tipo del campo.
+    template<auto Member, typename Value>
+    void Set(const Value& value)
+    {
+        Hlsl::Store(&(buffer->*Member), value);
+    }
+
+    /// El buffer entero, para lo que ya se preparó en la CPU.
+    void SetAll(const Buffer& value)
+    {
+        memcpy(buffer, &value, sizeof(Buffer));
+    }
+
+    const Buffer* Data() const { return buffer; }
+
+private:
+    Buffer* buffer;
+};
+
+#define MYTHFORGE_CONSTANT_MEMBER(type, member) ConstantMemberType<type> member;
+#define MYTHFORGE_CONSTANT_FIELD(type, member) DescribeConstantField<type>(#member, offsetof(Buffer, member)),
+
+/// Permite declarar arrays con la sintaxis de tipo de la lista de campos: Hlsl::float4[4].
+template<typename T>
+using ConstantMemberType = T;
+
+/**
+ * @brief Declara el struct Name con los campos de FIELDS, su ConstantBufferTraits y la comprobación
+ *        de que su disposición es la de HLSL. Register es el índice del registro b.
+ */
+#define MYTHFORGE_CONSTANT_BUFFER(Name, Register, FIELDS)                                          \
+    struct Name {                                                                                   \
+        FIELDS(MYTHFORGE_CONSTANT_MEMBER)                                                           \
+    };                                                                                              \
+    template<>                                                                                      \
+    struct ConstantBufferTraits<Name> {                                                             \
+        using Buffer = Name;                                                                        \
+        static constexpr const char* name = #Name;                                                  \
+        static constexpr uint32_t registerIndex = Register;                                         \
+        static constexpr ConstantField fields[] = { FIELDS(MYTHFORGE_CONSTANT_FIELD) };             \
+    };                                                                                              \
+    static_assert(ConstantBufferLayout::FirstMismatch(ConstantBufferTraits<Name>::fields) ==        \
+        std::size(ConstantBufferTraits<Name>::fields),                                              \
+        #Name ": un campo no está donde lo pone HLSL; hay que reordenar o añadir el relleno");       \
+    static_assert(ConstantBufferLayout::HlslSize(ConstantBufferTraits<Name>::fields) <=             \
+        ConstantBufferLayout::MaxBytes, #Name ": no cabe en un constant buffer")
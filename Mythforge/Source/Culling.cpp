@@ -0,0 +1,186 @@
+﻿/**
+ * @file Culling.cpp
+ * @brief Implementación del recorte por frustum.
+ */
+
+#include "pch.h"
+#include "Culling.h"
+#include <algorithm>
+#include <cfloat>
+
+namespace
+{
+    inline XMVECTOR Load4(const float* values)
+    {
+        return XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(values));
+    }
+
+    void AppendLanes(uint32_t mask, uint32_t base, uint32_t begin, uint32_t end, std::vector<uint32_t>& visible)
+    {
+        for (uint32_t lane = 0; lane < 4; lane++)
+        {
+            uint32_t index = base + lane;
+            if ((mask & (1u << lane)) && index >= begin && index < end)
+            {
+                visible.push_back(index);
+            }
+        }
+    }
+}
+
+FrustumLanes PrepareFrustumLanes(const Frustum& frustum)
+{
+    FrustumLanes lanes;
+    for (int i = 0; i < 6; i++)
+    {
+        const XMFLOAT4& plane = frustum.planes[i];
+        lanes.nx[i] = XMVectorReplicate(plane.x);
+        lanes.ny[i] = XMVectorReplicate(plane.y);
+        lanes.nz[i] = XMVectorReplicate(plane.z);
+        lanes.d[i] = XMVectorReplicate(plane.w);
+        lanes.absNx[i] = XMVectorAbs(lanes.nx[i]);
+        lanes.absNy[i] = XMVectorAbs(lanes.ny[i]);
+        lanes.absNz[i] = XMVectorAbs(lanes.nz[i]);
+    }
+    return lanes;
+}
+
+Frustum ExtractFrustum(FXMMATRIX viewProjection)
+{
+    // Con vectores fila, clip = v * M; las filas de la traspuesta son las columnas de M.
+    XMMATRIX columns = XMMatrixTranspose(viewProjection);
+    XMVECTOR planes[6] = {
+        XMVectorAdd(columns.r[3], columns.r[0]),
+        XMVectorSubtract(columns.r[3], columns.r[0]),
+        XMVectorAdd(columns.r[3], columns.r[1]),
+        XMVectorSubtract(columns.r[3], columns.r[1]),
+        columns.r[2],
+        XMVectorSubtract(columns.r[3], columns.r[2])
+    };
+
+    Frustum frustum;
+    for (int i = 0; i < 6; i++)
+    {
+        XMStoreFloat4(&frustum.planes[i], XMPlaneNormalize(planes[i]));
+    }
+    return frustum;
+}
+
+void CullingBounds::Add(const XMFLOAT3& center, const XMFLOAT3& extents)
+{
+    if ((count & 3) == 0)
+    {
+        // Los carriles sin usar tienen semiextensión negativa y quedan siempre fuera.
+        AabbBlock empty = {};
+        std::fill(std::begin(empty.extentX), std::end(empty.extentX), -FLT_MAX);
+        std::fill(std::begin(empty.extentY), std::end(empty.extentY), -FLT_MAX);
+        std::fill(std::begin(empty.extentZ), std::end(empty.extentZ), -FLT_MAX);
+        blocks.push_back(empty);
+    }
+    Set(count++, center, extents);
+}
+
+void CullingBounds::Set(uint32_t index, const XMFLOAT3& center, const XMFLOAT3& extents)
+{
+    AabbBlock& block = blocks[index >> 2];
+    uint32_t lane = index & 3;
+    block.centerX[lane] = center.x;
+    block.centerY[lane] = center.y;
+    block.centerZ[lane] = center.z;
+    block.extentX[lane] = extents.x;
+    block.extentY[lane] = extents.y;
+    block.extentZ[lane] = extents.z;
+}
+
+XMFLOAT3 CullingBounds::Center(uint32_t index) const
+{
+    const AabbBlock& block = blocks[index >> 2];
+    uint32_t lane = index & 3;
+    return XMFLOAT3(block.centerX[lane], block.centerY[lane], block.centerZ[lane]);
+}
+
+XMFLOAT3 CullingBounds::Extents(uint32_t index) const
+{
+    const AabbBlock& block = blocks[index >> 2];
+    uint32_t lane = index & 3;
+    return XMFLOAT3(block.extentX[lane], block.extentY[lane], block.extentZ[lane]);
+}
+
+uint32_t TestAabbBlock(const FrustumLanes& lanes, const AabbBlock& block, uint32_t* insideMask)
+{
+    XMVECTOR cx = Load4(block.centerX);
+    XMVECTOR cy = Load4(block.centerY);
+    XMVECTOR cz = Load4(block.centerZ);
+    XMVECTOR ex = Load4(block.extentX);
+    XMVECTOR ey = Load4(block.extentY);
+    XMVECTOR ez = Load4(block.extentZ);
+
+    XMVECTOR outside = XMVectorFalseInt();
+    XMVECTOR crossing = XMVectorFalseInt();
+    for (int i = 0; i < 6; i++)
+    {
+        XMVECTOR distance = XMVectorMultiplyAdd(cz, lanes.nz[i], XMVectorMultiplyAdd(cy, lanes.ny[i], XMVectorMultiplyAdd(cx, lanes.nx[i], lanes.d[i])));
+        XMVECTOR radius = XMVectorMultiplyAdd(ez, lanes.absNz[i], XMVectorMultiplyAdd(ey, lanes.absNy[i], XMVectorMultiply(ex, lanes.absNx[i])));
+        outside = XMVectorOrInt(outside, XMVectorLess(XMVectorAdd(distance, radius), XMVectorZero()));
+        crossing = XMVectorOrInt(crossing, XMVectorLess(XMVectorSubtract(distance, radius), XMVectorZero()));
+    }
+
+    uint32_t visible = ~VectorLaneMask(outside) & 0xF;
+    if (insideMask)
+    {
+        *insideMask = visible & ~VectorLaneMask(crossing);
+    }
+    return visible;
+}
+
+uint32_t TestSphereBlock(const FrustumLanes& lanes, const SphereBlock& block)
+{
+    XMVECTOR cx = Load4(block.centerX);
+    XMVECTOR cy = Load4(block.centerY);
+    XMVECTOR cz = Load4(block.centerZ);
+    XMVECTOR negativeRadius = XMVectorNegate(Load4(block.radius));
+
+    XMVECTOR outside = XMVectorFalseInt();
+    for (int i = 0; i < 6; i++)
+    {
+        XMVECTOR distance = XMVectorMultiplyAdd(cz, lanes.nz[i], XMVectorMultiplyAdd(cy, lanes.ny[i], XMVectorMultiplyAdd(cx, lanes.nx[i], lanes.d[i])));
+        outside = XMVectorOrInt(outside, XMVectorLess(distance, negativeRadius));
+    }
+    return ~VectorLaneMask(outside) & 0xF;
+}
+
+void CullAabbs(const Frustum& frustum, const CullingBounds& bounds, std::vector<uint32_t>& visible, CullingStats* stats)
+{
+    FrustumLanes lanes = PrepareFrustumLanes(frustum);
+    size_t visibleBefore = visible.size();
+
+    for (uint32_t block = 0; block < bounds.blocks.size(); block++)
+    {
+        uint32_t mask = TestAabbBlock(lanes, bounds.blocks[block]);
+        AppendLanes(mask, block * 4, 0, bounds.count, visible);
+    }
+
+    if (stats)
+    {
+        stats->objectsTested += bounds.count;
+        stats->visible += static_cast<uint32_t>(visible.size() - visibleBefore);
+    }
+}
+
+void CullSpheres(const Frustum& frustum, const SphereBlock* blocks, uint32_t count, std::vector<uint32_t>& visible, CullingStats* stats)
+{
+    FrustumLanes lanes = PrepareFrustumLanes(frustum);
+    size_t visibleBefore = visible.size();
+
+    for (uint32_t block = 0; block * 4 < count; block++)
+    {
+        uint32_t mask = TestSphereBlock(lanes, blocks[block]);
+        AppendLanes(mask, block * 4, 0, count, visible);
+    }
+
+    if (stats)
+    {
+        stats->objectsTested += count;
+        stats->visible += static_cast<uint32_t>(visible.size() - visibleBefore);
+    }
+}
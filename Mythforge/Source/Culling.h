@@ -0,0 +1,128 @@
+﻿/**
+ * @file Culling.h
+ * @brief Define el recorte por frustum de cajas y esferas, probando cuatro volúmenes a la vez.
+ *
+ * Los volúmenes se guardan en bloques de cuatro con los componentes separados (SoA), de
+ * modo que cada plano del frustum se prueba contra cuatro objetos con una sola operación
+ * vectorial de DirectXMath (SSE en x86/x64, NEON en ARM/ARM64).
+ */
+
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+using namespace DirectX;
+
+/**
+ * @brief Convierte el resultado de una comparación por carril en una máscara de 4 bits.
+ */
+inline uint32_t VectorLaneMask(FXMVECTOR mask)
+{
+#if defined(_XM_SSE_INTRINSICS_)
+    return static_cast<uint32_t>(_mm_movemask_ps(mask));
+#else
+    XMUINT4 lanes;
+    XMStoreUInt4(&lanes, mask);
+    return (lanes.x >> 31) | ((lanes.y >> 31) << 1) | ((lanes.z >> 31) << 2) | ((lanes.w >> 31) << 3);
+#endif
+}
+
+/**
+ * @struct Frustum
+ * @brief Seis planos normalizados con la normal hacia el interior: izquierda, derecha, abajo, arriba, cerca y lejos.
+ */
+struct Frustum {
+    XMFLOAT4 planes[6];
+};
+
+/**
+ * @brief Extrae los planos del frustum de una matriz vista-proyección (convención de vector fila, z en [0, 1]).
+ */
+Frustum ExtractFrustum(FXMMATRIX viewProjection);
+
+/**
+ * @struct AabbBlock
+ * @brief Cuatro cajas alineadas con los ejes expresadas como centro y semiextensión.
+ */
+struct alignas(16) AabbBlock {
+    float centerX[4];
+    float centerY[4];
+    float centerZ[4];
+    float extentX[4];
+    float extentY[4];
+    float extentZ[4];
+};
+
+/**
+ * @struct SphereBlock
+ * @brief Cuatro esferas expresadas como centro y radio.
+ */
+struct alignas(16) SphereBlock {
+    float centerX[4];
+    float centerY[4];
+    float centerZ[4];
+    float radius[4];
+};
+
+/**
+ * @struct CullingBounds
+ * @brief Colección de cajas en bloques de cuatro. Los huecos del último bloque nunca son visibles.
+ */
+struct CullingBounds {
+    std::vector<AabbBlock>  blocks;
+    uint32_t                count = 0;
+
+    void Clear() { blocks.clear(); count = 0; }
+    void Add(const XMFLOAT3& center, const XMFLOAT3& extents);
+    void Set(uint32_t index, const XMFLOAT3& center, const XMFLOAT3& extents);
+    XMFLOAT3 Center(uint32_t index) const;
+    XMFLOAT3 Extents(uint32_t index) const;
+};
+
+/**
+ * @struct CullingStats
+ * @brief Contadores de la última pasada de recorte.
+ */
+struct CullingStats {
+    uint32_t objectsTested = 0; ///< Volúmenes de objeto probados contra el frustum
+    uint32_t nodesVisited = 0; ///< Nodos de la jerarquía visitados
+    uint32_t visible = 0; ///< Objetos que pasan el recorte
+};
+
+/**
+ * @struct FrustumLanes
+ * @brief Planos del frustum replicados en los cuatro carriles, preparados una vez por pasada de recorte.
+ */
+struct FrustumLanes {
+    XMVECTOR nx[6];
+    XMVECTOR ny[6];
+    XMVECTOR nz[6];
+    XMVECTOR d[6];
+    XMVECTOR absNx[6];
+    XMVECTOR absNy[6];
+    XMVECTOR absNz[6];
+};
+
+FrustumLanes PrepareFrustumLanes(const Frustum& frustum);
+
+/**
+ * @brief Devuelve una máscara de 4 bits con las cajas del bloque que intersecan el frustum.
+ * @param insideMask Si no es nulo, recibe la máscara de las cajas completamente dentro del frustum.
+ */
+uint32_t TestAabbBlock(const FrustumLanes& lanes, const AabbBlock& block, uint32_t* insideMask = nullptr);
+
+/**
+ * @brief Devuelve una máscara de 4 bits con las esferas del bloque que intersecan el frustum.
+ */
+uint32_t TestSphereBlock(const FrustumLanes& lanes, const SphereBlock& block);
+
+/**
+ * @brief Prueba todas las cajas por fuerza bruta y añade a visible los índices que pasan el recorte.
+ */
+void CullAabbs(const Frustum& frustum, const CullingBounds& bounds, std::vector<uint32_t>& visible, CullingStats* stats = nullptr);
+
+/**
+ * @brief Prueba todas las esferas por fuerza bruta y añade a visible los índices que pasan el recorte.
+ */
+void CullSpheres(const Frustum& frustum, const SphereBlock* blocks, uint32_t count, std::vector<uint32_t>& visible, CullingStats* stats = nullptr);
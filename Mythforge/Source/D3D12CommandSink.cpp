@@ -0,0 +1,421 @@
+﻿/**
+ * @file D3D12CommandSink.cpp
+ * @brief Implementación de la reproducción de capturas sobre Direct3D 12.
+ */
+
+#include "pch.h"
+#include "D3D12CommandSink.h"
+#include "d3dx12.h"
+#include <algorithm>
+#include <cstring>
+
+D3D12CommandSink::D3D12CommandSink(ID3D12Device* device)
+    : device(device)
+{
+    D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+    if (!Check(device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&queue)))) return;
+    if (!Check(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&allocator)))) return;
+    if (!Check(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, allocator.Get(), nullptr, IID_PPV_ARGS(&commandList)))) return;
+    if (!Check(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)))) return;
+    fenceEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+}
+
+D3D12CommandSink::~D3D12CommandSink()
+{
+    if (commandList && pendingWork)
+    {
+        ExecuteAndWait();
+    }
+    if (fenceEvent)
+    {
+        CloseHandle(fenceEvent);
+    }
+}
+
+bool D3D12CommandSink::Check(HRESULT result)
+{
+    if (FAILED(result) && SUCCEEDED(status))
+    {
+        status = result;
+    }
+    return SUCCEEDED(result);
+}
+
+ID3D12Resource* D3D12CommandSink::LookupResource(CaptureId id)
+{
+    auto found = resources.find(id);
+    return found != resources.end() ? found->second.resource.Get() : nullptr;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE D3D12CommandSink::CpuHandle(CaptureId heap, uint32_t index, bool& found)
+{
+    auto entry = heaps.find(heap);
+    found = entry != heaps.end();
+    if (!found)
+    {
+        return D3D12_CPU_DESCRIPTOR_HANDLE{ 0 };
+    }
+    return CD3DX12_CPU_DESCRIPTOR_HANDLE(entry->second.heap->GetCPUDescriptorHandleForHeapStart(), index, entry->second.increment);
+}
+
+void D3D12CommandSink::ExecuteAndWait()
+{
+    if (!commandList || !fence) return;
+
+    if (Check(commandList->Close()))
+    {
+        ID3D12CommandList* lists[] = { commandList.Get() };
+        queue->ExecuteCommandLists(1, lists);
+    }
+
+    Check(queue->Signal(fence.Get(), ++fenceValue));
+    if (fence->GetCompletedValue() < fenceValue && Check(fence->SetEventOnCompletion(fenceValue, fenceEvent)))
+    {
+        WaitForSingleObject(fenceEvent, INFINITE);
+    }
+
+    uploads.clear();
+    pendingWork = false;
+    Check(allocator->Reset());
+    Check(commandList->Reset(allocator.Get(), nullptr));
+}
+
+void D3D12CommandSink::BeginFrame(const FrameCommand&)
+{
+}
+
+void D3D12CommandSink::EndFrame()
+{
+    ExecuteAndWait();
+}
+
+void D3D12CommandSink::DefineResource(const CapturedResource& resource, const void* initialData)
+{
+    D3D12_RESOURCE_DESC desc = {};
+    desc.Dimension = static_cast<D3D12_RESOURCE_DIMENSION>(resource.dimension);
+    desc.Width = resource.width;
+    desc.Height = resource.height;
+    desc.DepthOrArraySize = resource.depthOrArraySize;
+    desc.MipLevels = resource.mipLevels;
+    desc.Format = static_cast<DXGI_FORMAT>(resource.format);
+    desc.SampleDesc.Count = resource.sampleCount ? resource.sampleCount : 1;
+    desc.Layout = desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER ? D3D12_TEXTURE_LAYOUT_ROW_MAJOR : D3D12_TEXTURE_LAYOUT_UNKNOWN;
+    desc.Flags = static_cast<D3D12_RESOURCE_FLAGS>(resource.flags);
+
+    D3D12_HEAP_TYPE heapType = static_cast<D3D12_HEAP_TYPE>(resource.heapType);
+    D3D12_RESOURCE_STATES state = static_cast<D3D12_RESOURCE_STATES>(resource.state);
+    bool copyInitialData = initialData && heapType == D3D12_HEAP_TYPE_DEFAULT;
+    D3D12_RESOURCE_STATES createState = state;
+    if (heapType == D3D12_HEAP_TYPE_UPLOAD) createState = D3D12_RESOURCE_STATE_GENERIC_READ;
+    else if (heapType == D3D12_HEAP_TYPE_READBACK) createState = D3D12_RESOURCE_STATE_COPY_DEST;
+    else if (copyInitialData) createState = D3D12_RESOURCE_STATE_COPY_DEST;
+
+    Resource created;
+    CD3DX12_HEAP_PROPERTIES heapProperties(heapType);
+    if (!Check(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &desc, createState, nullptr, IID_PPV_ARGS(&created.resource))))
+    {
+        return;
+    }
+
+    if (heapType == D3D12_HEAP_TYPE_UPLOAD)
+    {
+        D3D12_RANGE readRange = { 0, 0 };
+        if (Check(created.resource->Map(0, &readRange, reinterpret_cast<void**>(&created.mapped))) && initialData)
+        {
+            memcpy(created.mapped, initialData, resource.initialDataSize);
+        }
+    }
+    else if (copyInitialData)
+    {
+        // El contenido inicial sube por un búfer intermedio que vive hasta el final del fotograma.
+        // Las texturas llegan con las filas compactadas (ancho * 4 bytes), como las describe CapturedResource.
+        std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+        if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+        {
+            subresources.push_back({ initialData, static_cast<LONG_PTR>(resource.initialDataSize), static_cast<LONG_PTR>(resource.initialDataSize) });
+        }
+        else
+        {
+            const uint8_t* source = static_cast<const uint8_t*>(initialData);
+            for (uint32_t i = 0; i < static_cast<uint32_t>(desc.MipLevels) * desc.DepthOrArraySize; i++)
+            {
+                uint32_t mip = i % desc.MipLevels;
+                LONG_PTR rowPitch = static_cast<LONG_PTR>((std::max)(desc.Width >> mip, UINT64(1)) * 4);
+                LONG_PTR slicePitch = rowPitch * (std::max)(desc.Height >> mip, 1u);
+                subresources.push_back({ source, rowPitch, slicePitch });
+                source += slicePitch;
+            }
+        }
+
+        ComPtr<ID3D12Resource> upload;
+        CD3DX12_HEAP_PROPERTIES uploadHeap(D3D12_HEAP_TYPE_UPLOAD);
+        CD3DX12_RESOURCE_DESC uploadDesc = CD3DX12_RESOURCE_DESC::Buffer(GetRequiredIntermediateSize(created.resource.Get(), 0, static_cast<UINT>(subresources.size())));
+        if (Check(device->CreateCommittedResource(&uploadHeap, D3D12_HEAP_FLAG_NONE, &uploadDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&upload))))
+        {
+            UpdateSubresources(commandList.Get(), created.resource.Get(), upload.Get(), 0, 0, static_cast<UINT>(subresources.size()), subresources.data());
+            uploads.push_back(upload);
+        }
+        if (state != D3D12_RESOURCE_STATE_COPY_DEST)
+        {
+            CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(created.resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, state);
+            commandList->ResourceBarrier(1, &barrier);
+        }
+        pendingWork = true;
+    }
+
+    resources[resource.id] = created;
+}
+
+void D3D12CommandSink::DefineRootSignature(const CapturedRootSignature& rootSignature, const void* blob)
+{
+    ComPtr<ID3D12RootSignature> created;
+    if (Check(device->CreateRootSignature(0, blob, rootSignature.blobSize, IID_PPV_ARGS(&created))))
+    {
+        rootSignatures[rootSignature.id] = created;
+    }
+}
+
+void D3D12CommandSink::DefinePipeline(const CapturedPipeline& pipeline, const CapturedInputElement* inputElements, const void* vertexShader, const void* pixelShader)
+{
+    auto rootSignature = rootSignatures.find(pipeline.rootSignature);
+    if (rootSignature == rootSignatures.end()) return;
+
+    std::vector<D3D12_INPUT_ELEMENT_DESC> elements(pipeline.inputElementCount);
+    for (uint32_t i = 0; i < pipeline.inputElementCount; i++)
+    {
+        const CapturedInputElement& source = inputElements[i];
+        elements[i].SemanticName = source.semanticName;
+        elements[i].SemanticIndex = source.semanticIndex;
+        elements[i].Format = static_cast<DXGI_FORMAT>(source.format);
+        elements[i].InputSlot = source.inputSlot;
+        elements[i].AlignedByteOffset = source.alignedByteOffset;
+        elements[i].InputSlotClass = source.perInstance ? D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA : D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA;
+        elements[i].InstanceDataStepRate = source.instanceStepRate;
+    }
+
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
+    desc.InputLayout = { elements.data(), pipeline.inputElementCount };
+    desc.pRootSignature = rootSignature->second.Get();
+    desc.VS = { vertexShader, pipeline.vertexShaderSize };
+    desc.PS = { pixelShader, pipeline.pixelShaderSize };
+    desc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+    desc.RasterizerState.FillMode = static_cast<D3D12_FILL_MODE>(pipeline.fillMode);
+    desc.RasterizerState.CullMode = static_cast<D3D12_CULL_MODE>(pipeline.cullMode);
+    desc.RasterizerState.FrontCounterClockwise = pipeline.frontCounterClockwise;
+    desc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+    desc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+    desc.DepthStencilState.DepthEnable = pipeline.depthEnable;
+    desc.DepthStencilState.DepthWriteMask = static_cast<D3D12_DEPTH_WRITE_MASK>(pipeline.depthWriteMask);
+    desc.DepthStencilState.DepthFunc = static_cast<D3D12_COMPARISON_FUNC>(pipeline.depthFunc);
+    desc.SampleMask = UINT_MAX;
+    desc.PrimitiveTopologyType = static_cast<D3D12_PRIMITIVE_TOPOLOGY_TYPE>(pipeline.topologyType);
+    desc.NumRenderTargets = pipeline.renderTargetCount;
+    desc.RTVFormats[0] = static_cast<DXGI_FORMAT>(pipeline.renderTargetFormat);
+    desc.DSVFormat = static_cast<DXGI_FORMAT>(pipeline.depthStencilFormat);
+    desc.SampleDesc.Count = pipeline.sampleCount ? pipeline.sampleCount : 1;
+
+    ComPtr<ID3D12PipelineState> created;
+    if (Check(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&created))))
+    {
+        pipelines[pipeline.id] = created;
+    }
+}
+
+void D3D12CommandSink::DefineDescriptorHeap(const CapturedDescriptorHeap& heap)
+{
+    D3D12_DESCRIPTOR_HEAP_DESC desc = {};
+    desc.Type = static_cast<D3D12_DESCRIPTOR_HEAP_TYPE>(heap.type);
+    desc.NumDescriptors = heap.count;
+    desc.Flags = heap.shaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+
+    DescriptorHeap created;
+    if (Check(device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&created.heap))))
+    {
+        created.increment = device->GetDescriptorHandleIncrementSize(desc.Type);
+        heaps[heap.id] = created;
+    }
+}
+
+void D3D12CommandSink::DefineView(const CapturedView& view)
+{
+    bool found = false;
+    D3D12_CPU_DESCRIPTOR_HANDLE handle = CpuHandle(view.heap, view.index, found);
+    ID3D12Resource* resource = LookupResource(view.resource);
+    // Una SRV sin recurso y con dimensión es una vista nula, como las que se dibujan mientras cargan las texturas.
+    bool nullView = view.kind == CapturedViewKind::ShaderResource && view.resource == 0 && view.viewDimension != 0;
+    if (!found || (!resource && !nullView)) return;
+
+    switch (view.kind)
+    {
+    case CapturedViewKind::ConstantBuffer:
+    {
+        D3D12_CONSTANT_BUFFER_VIEW_DESC desc = { resource->GetGPUVirtualAddress() + view.bufferOffset, view.bufferSize };
+        device->CreateConstantBufferView(&desc, handle);
+        break;
+    }
+    case CapturedViewKind::ShaderResource:
+    {
+        D3D12_SHADER_RESOURCE_VIEW_DESC desc = {};
+        desc.Format = static_cast<DXGI_FORMAT>(view.format);
+        desc.ViewDimension = static_cast<D3D12_SRV_DIMENSION>(view.viewDimension);
+        desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        desc.Texture2D.MipLevels = view.mipLevels;
+        desc.Texture2D.MostDetailedMip = view.mostDetailedMip;
+        device->CreateShaderResourceView(resource, view.viewDimension ? &desc : nullptr, handle);
+        break;
+    }
+    case CapturedViewKind::RenderTarget:
+        device->CreateRenderTargetView(resource, nullptr, handle);
+        break;
+    case CapturedViewKind::DepthStencil:
+    {
+        D3D12_DEPTH_STENCIL_VIEW_DESC desc = {};
+        desc.Format = static_cast<DXGI_FORMAT>(view.format);
+        desc.ViewDimension = static_cast<D3D12_DSV_DIMENSION>(view.viewDimension);
+        device->CreateDepthStencilView(resource, view.viewDimension ? &desc : nullptr, handle);
+        break;
+    }
+    }
+}
+
+void D3D12CommandSink::ReleaseObject(const ObjectCommand& command)
+{
+    // La GPU puede seguir usando el objeto en el fotograma en curso.
+    auto resource = resources.find(command.id);
+    if (resource != resources.end())
+    {
+        if (pendingWork) uploads.push_back(resource->second.resource);
+        resources.erase(resource);
+    }
+    rootSignatures.erase(command.id);
+    pipelines.erase(command.id);
+    heaps.erase(command.id);
+}
+
+void D3D12CommandSink::WriteBuffer(const BufferWriteCommand& command, const void* data)
+{
+    auto resource = resources.find(command.resource);
+    if (resource == resources.end() || !resource->second.mapped) return;
+    memcpy(resource->second.mapped + command.offset, data, command.size);
+}
+
+void D3D12CommandSink::SetRootSignature(const ObjectCommand& command)
+{
+    auto rootSignature = rootSignatures.find(command.id);
+    if (rootSignature == rootSignatures.end()) return;
+    commandList->SetGraphicsRootSignature(rootSignature->second.Get());
+    pendingWork = true;
+}
+
+void D3D12CommandSink::SetDescriptorHeaps(const SetDescriptorHeapsCommand& command)
+{
+    ID3D12DescriptorHeap* bound[2] = {};
+    for (uint32_t i = 0; i < command.count && i < 2; i++)
+    {
+        auto heap = heaps.find(command.heaps[i]);
+        if (heap == heaps.end()) return;
+        bound[i] = heap->second.heap.Get();
+    }
+    commandList->SetDescriptorHeaps(command.count, bound);
+}
+
+void D3D12CommandSink::SetPipeline(const ObjectCommand& command)
+{
+    auto pipeline = pipelines.find(command.id);
+    if (pipeline == pipelines.end()) return;
+    commandList->SetPipelineState(pipeline->second.Get());
+}
+
+void D3D12CommandSink::SetRootTable(const SetRootTableCommand& command)
+{
+    auto heap = heaps.find(command.heap);
+    if (heap == heaps.end()) return;
+    CD3DX12_GPU_DESCRIPTOR_HANDLE handle(heap->second.heap->GetGPUDescriptorHandleForHeapStart(), command.index, heap->second.increment);
+    commandList->SetGraphicsRootDescriptorTable(command.rootIndex, handle);
+}
+
+void D3D12CommandSink::SetTopology(const SetTopologyCommand& command)
+{
+    commandList->IASetPrimitiveTopology(static_cast<D3D12_PRIMITIVE_TOPOLOGY>(command.topology));
+}
+
+void D3D12CommandSink::SetVertexBuffer(const SetVertexBufferCommand& command)
+{
+    ID3D12Resource* resource = LookupResource(command.resource);
+    if (!resource) return;
+    D3D12_VERTEX_BUFFER_VIEW view = { resource->GetGPUVirtualAddress() + command.offset, command.size, command.stride };
+    commandList->IASetVertexBuffers(command.slot, 1, &view);
+}
+
+void D3D12CommandSink::SetIndexBuffer(const SetIndexBufferCommand& command)
+{
+    ID3D12Resource* resource = LookupResource(command.resource);
+    if (!resource)
+    {
+        commandList->IASetIndexBuffer(nullptr);
+        return;
+    }
+    D3D12_INDEX_BUFFER_VIEW view = { resource->GetGPUVirtualAddress() + command.offset, command.size, static_cast<DXGI_FORMAT>(command.format) };
+    commandList->IASetIndexBuffer(&view);
+}
+
+void D3D12CommandSink::SetViewport(const ViewportCommand& command)
+{
+    D3D12_VIEWPORT viewport = { command.x, command.y, command.width, command.height, command.minDepth, command.maxDepth };
+    commandList->RSSetViewports(1, &viewport);
+}
+
+void D3D12CommandSink::SetScissor(const ScissorCommand& command)
+{
+    D3D12_RECT rect = { command.left, command.top, command.right, command.bottom };
+    commandList->RSSetScissorRects(1, &rect);
+}
+
+void D3D12CommandSink::SetRenderTargets(const SetRenderTargetsCommand& command)
+{
+    bool hasRenderTarget = false;
+    bool hasDepthStencil = false;
+    D3D12_CPU_DESCRIPTOR_HANDLE renderTarget = CpuHandle(command.renderTargetHeap, command.renderTargetIndex, hasRenderTarget);
+    D3D12_CPU_DESCRIPTOR_HANDLE depthStencil = CpuHandle(command.depthStencilHeap, command.depthStencilIndex, hasDepthStencil);
+    commandList->OMSetRenderTargets(hasRenderTarget ? 1 : 0, hasRenderTarget ? &renderTarget : nullptr, FALSE, hasDepthStencil ? &depthStencil : nullptr);
+}
+
+void D3D12CommandSink::ClearRenderTarget(const ClearRenderTargetCommand& command)
+{
+    bool found = false;
+    D3D12_CPU_DESCRIPTOR_HANDLE handle = CpuHandle(command.heap, command.index, found);
+    if (!found) return;
+    commandList->ClearRenderTargetView(handle, command.color, 0, nullptr);
+    pendingWork = true;
+}
+
+void D3D12CommandSink::ClearDepth(const ClearDepthCommand& command)
+{
+    bool found = false;
+    D3D12_CPU_DESCRIPTOR_HANDLE handle = CpuHandle(command.heap, command.index, found);
+    if (!found) return;
+    commandList->ClearDepthStencilView(handle, static_cast<D3D12_CLEAR_FLAGS>(command.flags), command.depth, static_cast<UINT8>(command.stencil), 0, nullptr);
+    pendingWork = true;
+}
+
+void D3D12CommandSink::Barrier(const BarrierCommand& command)
+{
+    ID3D12Resource* resource = LookupResource(command.resource);
+    if (!resource) return;
+    CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(resource,
+        static_cast<D3D12_RESOURCE_STATES>(command.before), static_cast<D3D12_RESOURCE_STATES>(command.after), command.subresource);
+    commandList->ResourceBarrier(1, &barrier);
+    pendingWork = true;
+}
+
+void D3D12CommandSink::DrawIndexed(const DrawIndexedCommand& command)
+{
+    commandList->DrawIndexedInstanced(command.indexCount, command.instanceCount, command.startIndex, command.baseVertex, command.startInstance);
+    pendingWork = true;
+}
+
+void D3D12CommandSink::Present()
+{
+    // Sin cadena de intercambio: el fotograma se entrega en EndFrame.
+}
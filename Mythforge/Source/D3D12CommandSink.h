@@ -0,0 +1,94 @@
+﻿/**
+ * @file D3D12CommandSink.h
+ * @brief Backend de reproducción de capturas sobre un dispositivo Direct3D 12.
+ *
+ * Recrea los objetos definidos en la captura y graba sus comandos en una lista propia que se
+ * ejecuta y se espera al final de cada fotograma. Los búferes de intercambio se reproducen como
+ * texturas normales, así que no hace falta ventana. Los errores no interrumpen la reproducción:
+ * el comando afectado se descarta y Status devuelve el primer HRESULT fallido.
+ */
+
+#pragma once
+#include <d3d12.h>
+#include <wrl/client.h>
+#include <unordered_map>
+#include <vector>
+#include "CommandStream.h"
+
+/**
+ * @class D3D12CommandSink
+ * @brief Reproduce una captura en la GPU.
+ */
+class D3D12CommandSink : public CommandSink {
+public:
+    explicit D3D12CommandSink(ID3D12Device* device);
+    ~D3D12CommandSink() override;
+
+    D3D12CommandSink(const D3D12CommandSink&) = delete;
+    D3D12CommandSink& operator=(const D3D12CommandSink&) = delete;
+
+    /// S_OK, o el primer error encontrado.
+    HRESULT Status() const { return status; }
+
+    void BeginFrame(const FrameCommand& command) override;
+    void EndFrame() override;
+    void DefineResource(const CapturedResource& resource, const void* initialData) override;
+    void DefineRootSignature(const CapturedRootSignature& rootSignature, const void* blob) override;
+    void DefinePipeline(const CapturedPipeline& pipeline, const CapturedInputElement* inputElements, const void* vertexShader, const void* pixelShader) override;
+    void DefineDescriptorHeap(const CapturedDescriptorHeap& heap) override;
+    void DefineView(const CapturedView& view) override;
+    void ReleaseObject(const ObjectCommand& command) override;
+    void WriteBuffer(const BufferWriteCommand& command, const void* data) override;
+    void SetRootSignature(const ObjectCommand& command) override;
+    void SetDescriptorHeaps(const SetDescriptorHeapsCommand& command) override;
+    void SetPipeline(const ObjectCommand& command) override;
+    void SetRootTable(const SetRootTableCommand& command) override;
+    void SetTopology(const SetTopologyCommand& command) override;
+    void SetVertexBuffer(const SetVertexBufferCommand& command) override;
+    void SetIndexBuffer(const SetIndexBufferCommand& command) override;
+    void SetViewport(const ViewportCommand& command) override;
+    void SetScissor(const ScissorCommand& command) override;
+    void SetRenderTargets(const SetRenderTargetsCommand& command) override;
+    void ClearRenderTarget(const ClearRenderTargetCommand& command) override;
+    void ClearDepth(const ClearDepthCommand& command) override;
+    void Barrier(const BarrierCommand& command) override;
+    void DrawIndexed(const DrawIndexedCommand& command) override;
+    void Present() override;
+
+private:
+    template<typename T>
+    using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+    struct Resource {
+        ComPtr<ID3D12Resource> resource;
+        uint8_t*               mapped = nullptr;   ///< Solo heaps de subida
+    };
+
+    struct DescriptorHeap {
+        ComPtr<ID3D12DescriptorHeap> heap;
+        uint32_t                     increment = 0;
+    };
+
+    bool Check(HRESULT result);
+    ID3D12Resource* LookupResource(CaptureId id);
+    D3D12_CPU_DESCRIPTOR_HANDLE CpuHandle(CaptureId heap, uint32_t index, bool& found);
+
+    /// Cierra la lista, la ejecuta, espera a la GPU y la vuelve a abrir.
+    void ExecuteAndWait();
+
+    ComPtr<ID3D12Device>                                       device;
+    ComPtr<ID3D12CommandQueue>                                 queue;
+    ComPtr<ID3D12CommandAllocator>                             allocator;
+    ComPtr<ID3D12GraphicsCommandList>                          commandList;
+    ComPtr<ID3D12Fence>                                        fence;
+    HANDLE                                                     fenceEvent = nullptr;
+    uint64_t                                                   fenceValue = 0;
+    HRESULT                                                    status = S_OK;
+    bool                                                       pendingWork = false;
+
+    std::unordered_map<CaptureId, Resource>                    resources;
+    std::unordered_map<CaptureId, ComPtr<ID3D12RootSignature>> rootSignatures;
+    std::unordered_map<CaptureId, ComPtr<ID3D12PipelineState>> pipelines;
+    std::unordered_map<CaptureId, DescriptorHeap>              heaps;
+    std::vector<ComPtr<ID3D12Resource>>                        uploads; ///< Copias de contenido inicial en vuelo
+};
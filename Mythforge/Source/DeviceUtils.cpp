@@ -1,8 +1,56 @@
 #include "pch.h"
 #include "DeviceUtils.h"
 #include "DirectXHelper.h"
+#include "RenderStats.h"
+#include "CommandCapture.h"
 #include <Windows.h>
 #include <iostream>
+#include <atomic>
+
+namespace
+{
+	// Objeto COM mnimo que se guarda como dato privado de cada recurso registrado. El recurso lo
+	// libera al destruirse y entonces se da de baja la asignacin, sin importar quin solt la ltima referencia.
+	class MemoryReleaseNotifier : public IUnknown
+	{
+	public:
+		explicit MemoryReleaseNotifier(const void* key) : key(key) {}
+
+		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+		{
+			if (!object) return E_POINTER;
+			if (riid == __uuidof(IUnknown))
+			{
+				*object = static_cast<IUnknown*>(this);
+				AddRef();
+				return S_OK;
+			}
+			*object = nullptr;
+			return E_NOINTERFACE;
+		}
+
+		ULONG STDMETHODCALLTYPE AddRef() override { return ++references; }
+
+		ULONG STDMETHODCALLTYPE Release() override
+		{
+			ULONG remaining = --references;
+			if (remaining == 0)
+			{
+				MemoryTracker::OnRelease(key);
+				CommandCapture::Unregister(key);
+				delete this;
+			}
+			return remaining;
+		}
+
+	private:
+		const void*        key;
+		std::atomic<ULONG> references{ 1 };
+	};
+
+	// {6F1C9E2A-4B7D-4E0F-9A31-5C2D8B7E4F10}
+	const GUID memoryTrackerGuid = { 0x6f1c9e2a, 0x4b7d, 0x4e0f, { 0x9a, 0x31, 0x5c, 0x2d, 0x8b, 0x7e, 0x4f, 0x10 } };
+}
 
 ComPtr<IDXGIAdapter4> GetAdapter()
 {
@@ -140,6 +188,7 @@ ComPtr<ID3D12DescriptorHeap> CreateDescriptorHeap(ComPtr<ID3D12Device2> device,
 
     ComPtr<ID3D12DescriptorHeap> descriptorHeap;
     DX::ThrowIfFailed(device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&descriptorHeap)));
+    CommandCapture::RegisterDescriptorHeap(device.Get(), descriptorHeap.Get());
 
     return descriptorHeap;
 }
@@ -154,6 +203,9 @@ void UpdateRenderTargetViews(ComPtr<ID3D12Device2> device, ComPtr<IDXGISwapChain
 		ComPtr<ID3D12Resource> backBuffer;
         DX::ThrowIfFailed(swapChain->GetBuffer(i, IID_PPV_ARGS(&backBuffer)));
         device->CreateRenderTargetView(backBuffer.Get(), nullptr, rtvHandle);
+		TrackResource(backBuffer, MemoryCategory::RenderTargets, "backBuffer");
+		CommandCapture::RegisterResource(backBuffer.Get(), D3D12_RESOURCE_STATE_PRESENT);
+		CommandCapture::RegisterRenderTargetView(backBuffer.Get(), rtvHandle);
 		renderTargets[i] = backBuffer;
         rtvHandle.Offset(rtvDescriptorSize);
     }
@@ -189,6 +241,8 @@ void UpdateDepthStencilView(ComPtr<ID3D12Device2> device, ComPtr<ID3D12Descripto
     ));
 
 	NAME_D3D12_OBJECT(depthStencil);
+	TrackResource(depthStencil, MemoryCategory::RenderTargets, "depthStencil");
+	CommandCapture::RegisterResource(depthStencil.Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE);
 
     D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
     dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
@@ -196,6 +250,25 @@ void UpdateDepthStencilView(ComPtr<ID3D12Device2> device, ComPtr<ID3D12Descripto
 	dsvDesc.Texture2D.MipSlice = 0;
     dsvDesc.Flags = D3D12_DSV_FLAG_NONE;
     device->CreateDepthStencilView(depthStencil.Get(), &dsvDesc, descriptorHeap->GetCPUDescriptorHandleForHeapStart());
+	CommandCapture::RegisterDepthStencilView(depthStencil.Get(), &dsvDesc, descriptorHeap->GetCPUDescriptorHandleForHeapStart());
+}
+
+void CreateRenderTargetTexture(ComPtr<ID3D12Device2> device, ComPtr<ID3D12Resource>& texture, UINT width, UINT height, DXGI_FORMAT format, D3D12_RESOURCE_STATES initialState, const FLOAT clearColor[4])
+{
+	CD3DX12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(format, width, height, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+	CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
+	CD3DX12_CLEAR_VALUE clearValue(format, clearColor);
+
+	DX::ThrowIfFailed(device->CreateCommittedResource(
+		&heapProperties,
+		D3D12_HEAP_FLAG_NONE,
+		&textureDesc,
+		initialState,
+		&clearValue,
+		IID_PPV_ARGS(&texture)
+	));
+
+	CommandCapture::RegisterResource(texture.Get(), initialState);
 }
 
 ComPtr<ID3D12CommandAllocator> CreateCommandAllocator(ComPtr<ID3D12Device2> device)
@@ -230,14 +303,14 @@ HANDLE CreateEventHandle()
     return fenceEvent;
 }
 
-UINT64 Signal(ComPtr<ID3D12CommandQueue> commandQueue, ComPtr<ID3D12Fence> fence, UINT64& fenceValue)
+UINT64 Signal(const ComPtr<ID3D12CommandQueue>& commandQueue, const ComPtr<ID3D12Fence>& fence, UINT64& fenceValue)
 {
     UINT64 fenceSignalValue = ++fenceValue;
     DX::ThrowIfFailed(commandQueue->Signal(fence.Get(), fenceSignalValue));
     return fenceSignalValue;
 }
 
-void WaitForFenceValue(ComPtr<ID3D12Fence> fence, UINT64 fenceValue, HANDLE fenceEvent)
+void WaitForFenceValue(const ComPtr<ID3D12Fence>& fence, UINT64 fenceValue, HANDLE fenceEvent)
 {
     if (fence->GetCompletedValue() < fenceValue)
     {
@@ -246,13 +319,13 @@ void WaitForFenceValue(ComPtr<ID3D12Fence> fence, UINT64 fenceValue, HANDLE fenc
     }
 }
 
-void Flush(ComPtr<ID3D12CommandQueue> commandQueue, ComPtr<ID3D12Fence> fence, UINT64& fenceValue, HANDLE fenceEvent)
+void Flush(const ComPtr<ID3D12CommandQueue>& commandQueue, const ComPtr<ID3D12Fence>& fence, UINT64& fenceValue, HANDLE fenceEvent)
 {
     UINT64 fenceSignalValue = Signal(commandQueue, fence, fenceValue);
     WaitForFenceValue(fence, fenceSignalValue, fenceEvent);
 }
 
-void UpdateBufferResource(ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList2> commandList, ComPtr<ID3D12Resource>& pDestinationResource, ComPtr<ID3D12Resource>& pIntermediateResource, size_t numElements, size_t elementSize, const void* bufferData)
+void UpdateBufferResource(ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList2> commandList, ComPtr<ID3D12Resource>& pDestinationResource, ComPtr<ID3D12Resource>& pIntermediateResource, size_t numElements, size_t elementSize, const void* bufferData, MemoryCategory category)
 {
 	size_t bufferSize = numElements * elementSize;
 
@@ -265,6 +338,9 @@ void UpdateBufferResource(ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCom
 		IID_PPV_ARGS(&pDestinationResource)));              // Output resource
 
 	NAME_D3D12_OBJECT(pDestinationResource);
+	TrackResource(pDestinationResource, category);
+	// Tras la copia inicial el bfer vuelve a COMMON y se promociona solo al usarse.
+	CommandCapture::RegisterResource(pDestinationResource.Get(), D3D12_RESOURCE_STATE_COMMON, bufferData, bufferData ? bufferSize : 0);
 
 	if (bufferData)
 	{
@@ -277,6 +353,7 @@ void UpdateBufferResource(ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCom
 			IID_PPV_ARGS(&pIntermediateResource)));
 
 		NAME_D3D12_OBJECT(pIntermediateResource);
+		TrackResource(pIntermediateResource, MemoryCategory::Upload);
 		D3D12_SUBRESOURCE_DATA subresourceData = {};
 		subresourceData.pData = bufferData;
 		subresourceData.RowPitch = bufferSize;
@@ -285,6 +362,8 @@ void UpdateBufferResource(ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCom
 		UpdateSubresources(commandList.Get(),
 			pDestinationResource.Get(), pIntermediateResource.Get(),
 			0, 0, 1, &subresourceData);
+		RenderStats::Add(RenderCounter::CopyCommands);
+		RenderStats::Add(RenderCounter::UploadBytes, bufferSize);
 	}
 
 }
@@ -294,15 +373,21 @@ void CreateTextureResource(ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCo
 	std::unique_ptr<uint8_t[]> ddsData;
 	std::vector<D3D12_SUBRESOURCE_DATA> subresources;
 	DX::ThrowIfFailed(DirectX::LoadDDSTextureFromFile(device.Get(), path, texture.ReleaseAndGetAddressOf(), ddsData, subresources));
+	TrackResource(texture, MemoryCategory::Textures);
+	CommandCapture::RegisterTexture(texture.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, subresources.data(), static_cast<uint32_t>(subresources.size()));
 
 	auto uploadBufferSize = GetRequiredIntermediateSize(texture.Get(), 0, static_cast<UINT>(subresources.size()));
 
 	DX::ThrowIfFailed(device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&textureUpload)));
+	TrackResource(textureUpload, MemoryCategory::Upload);
 
 	UpdateSubresources(commandList.Get(), texture.Get(), textureUpload.Get(), 0, 0, static_cast<UINT>(subresources.size()), subresources.data());
+	RenderStats::Add(RenderCounter::CopyCommands, subresources.size());
+	RenderStats::Add(RenderCounter::UploadBytes, uploadBufferSize);
 
 	auto transition = CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 	commandList->ResourceBarrier(1, &transition);
+	RenderStats::Add(RenderCounter::Barriers);
 
 	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
@@ -311,3 +396,58 @@ void CreateTextureResource(ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCo
 	srvDesc.Texture2D.MostDetailedMip = 0;
 	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
 }
+
+void TrackResource(ComPtr<ID3D12Resource> resource, MemoryCategory category, const char* name)
+{
+	// Un recurso ya registrado conserva su notificador; sustituirlo dara de baja el registro nuevo.
+	UINT dataSize = 0;
+	if (SUCCEEDED(resource->GetPrivateData(memoryTrackerGuid, &dataSize, nullptr)))
+	{
+		return;
+	}
+
+	ComPtr<ID3D12Device> device;
+	DX::ThrowIfFailed(resource->GetDevice(IID_PPV_ARGS(&device)));
+	D3D12_RESOURCE_DESC desc = resource->GetDesc();
+	D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = device->GetResourceAllocationInfo(0, 1, &desc);
+
+	// Los heaps de subida y de lectura viven en memoria del sistema en los adaptadores dedicados.
+	MemorySegment segment = MemorySegment::Local;
+	D3D12_HEAP_PROPERTIES heapProperties;
+	if (SUCCEEDED(resource->GetHeapProperties(&heapProperties, nullptr)) &&
+		(heapProperties.Type == D3D12_HEAP_TYPE_UPLOAD || heapProperties.Type == D3D12_HEAP_TYPE_READBACK))
+	{
+		segment = MemorySegment::NonLocal;
+	}
+
+	char debugName[128] = {};
+	if (!name)
+	{
+		wchar_t wideName[128] = {};
+		UINT nameSize = sizeof(wideName) - sizeof(wchar_t);
+		if (SUCCEEDED(resource->GetPrivateData(WKPDID_D3DDebugObjectNameW, &nameSize, wideName)))
+		{
+			WideCharToMultiByte(CP_UTF8, 0, wideName, -1, debugName, sizeof(debugName) - 1, nullptr, nullptr);
+		}
+		name = debugName;
+	}
+
+	MemoryTracker::OnAllocate(resource.Get(), category, segment, allocationInfo.SizeInBytes, name);
+
+	ComPtr<IUnknown> notifier;
+	notifier.Attach(new MemoryReleaseNotifier(resource.Get()));
+	DX::ThrowIfFailed(resource->SetPrivateDataInterface(memoryTrackerGuid, notifier.Get()));
+}
+
+void UpdateMemoryBudget(const ComPtr<IDXGIAdapter4>& adapter)
+{
+	DXGI_QUERY_VIDEO_MEMORY_INFO info;
+	if (SUCCEEDED(adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info)))
+	{
+		MemoryTracker::UpdateBudget(MemorySegment::Local, info.Budget, info.CurrentUsage);
+	}
+	if (SUCCEEDED(adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL, &info)))
+	{
+		MemoryTracker::UpdateBudget(MemorySegment::NonLocal, info.Budget, info.CurrentUsage);
+	}
+}
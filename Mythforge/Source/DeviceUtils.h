@@ -4,6 +4,7 @@
 #include <dxgi1_6.h>
 #include <wrl.h>
 #include <Windows.h>
+#include "MemoryTracker.h"
 
 using namespace Microsoft::WRL;
 using namespace Platform;
@@ -16,12 +17,20 @@ ComPtr<IDXGISwapChain4> CreateSwapChain(CoreWindow^ window, ComPtr<ID3D12Command
 ComPtr<ID3D12DescriptorHeap> CreateDescriptorHeap(ComPtr<ID3D12Device2> device, uint32_t numDescriptors, D3D12_DESCRIPTOR_HEAP_TYPE = D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
 void UpdateRenderTargetViews(ComPtr<ID3D12Device2> device, ComPtr<IDXGISwapChain4> swapChain, ComPtr<ID3D12DescriptorHeap> descriptorHeap, ComPtr<ID3D12Resource> renderTargets[], UINT bufferCount);
 void UpdateDepthStencilView(ComPtr<ID3D12Device2> device, ComPtr<ID3D12DescriptorHeap> descriptorHeap, ComPtr<ID3D12Resource>& depthStencil, UINT width, UINT height);
+// Textura que puede ser destino de render y leerse en un shader, con clearColor como valor de borrado optimizado.
+void CreateRenderTargetTexture(ComPtr<ID3D12Device2> device, ComPtr<ID3D12Resource>& texture, UINT width, UINT height, DXGI_FORMAT format, D3D12_RESOURCE_STATES initialState, const FLOAT clearColor[4]);
 ComPtr<ID3D12CommandAllocator> CreateCommandAllocator(ComPtr<ID3D12Device2> device);
 ComPtr<ID3D12GraphicsCommandList2> CreateCommandList(ComPtr<ID3D12Device2> device, ComPtr<ID3D12CommandAllocator> commandAllocator);
 ComPtr<ID3D12Fence> CreateFence(ComPtr<ID3D12Device2> device);
 HANDLE CreateEventHandle();
-UINT64 Signal(ComPtr<ID3D12CommandQueue> commandQueue, ComPtr<ID3D12Fence> fence, UINT64& fenceValue);
-void WaitForFenceValue(ComPtr<ID3D12Fence> fence, UINT64 fenceValue, HANDLE fenceEvent);
-void Flush(ComPtr<ID3D12CommandQueue> commandQueue, ComPtr<ID3D12Fence> fence, UINT64& fenceValue, HANDLE fenceEvent);
-void UpdateBufferResource(ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList2> commandList, ComPtr<ID3D12Resource>& pDestinationResource, ComPtr<ID3D12Resource>& pIntermediateResource, size_t numElements, size_t elementSize, const void* bufferData);
-void CreateTextureResource(ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList2> commandList, const LPWSTR path, ComPtr<ID3D12Resource>& texture, ComPtr<ID3D12Resource>& textureUpload, D3D12_SHADER_RESOURCE_VIEW_DESC& srvDesc, DXGI_FORMAT textureFormat = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB);
\ No newline at end of file
+UINT64 Signal(const ComPtr<ID3D12CommandQueue>& commandQueue, const ComPtr<ID3D12Fence>& fence, UINT64& fenceValue);
+void WaitForFenceValue(const ComPtr<ID3D12Fence>& fence, UINT64 fenceValue, HANDLE fenceEvent);
+void Flush(const ComPtr<ID3D12CommandQueue>& commandQueue, const ComPtr<ID3D12Fence>& fence, UINT64& fenceValue, HANDLE fenceEvent);
+void UpdateBufferResource(ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList2> commandList, ComPtr<ID3D12Resource>& pDestinationResource, ComPtr<ID3D12Resource>& pIntermediateResource, size_t numElements, size_t elementSize, const void* bufferData, MemoryCategory category = MemoryCategory::VertexIndex);
+void CreateTextureResource(ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList2> commandList, const LPWSTR path, ComPtr<ID3D12Resource>& texture, ComPtr<ID3D12Resource>& textureUpload, D3D12_SHADER_RESOURCE_VIEW_DESC& srvDesc, DXGI_FORMAT textureFormat = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB);
+
+// Registra el recurso en MemoryTracker; se da de baja solo cuando el recurso se destruye.
+// Sin nombre explícito se usa el nombre de depuración del recurso, si lo tiene.
+void TrackResource(ComPtr<ID3D12Resource> resource, MemoryCategory category, const char* name = nullptr);
+// Pasa a MemoryTracker el presupuesto y el uso de memoria que informa el adaptador.
+void UpdateMemoryBudget(const ComPtr<IDXGIAdapter4>& adapter);
\ No newline at end of file
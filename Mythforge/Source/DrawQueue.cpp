@@ -0,0 +1,202 @@
+﻿/**
+ * @file DrawQueue.cpp
+ * @brief Implementación de la clave de dibujado y de la ordenación por radix.
+ */
+
+#include "pch.h"
+#include "DrawQueue.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace
+{
+    constexpr uint32_t DigitBits = 8;
+    constexpr uint32_t Buckets = 1u << DigitBits;
+    constexpr uint32_t Digits = 64 / DigitBits;
+
+    std::atomic<uint32_t> nextPipelineId{ 1 };
+    std::atomic<uint32_t> nextMaterialId{ 1 };
+
+    constexpr uint64_t FieldMask(uint32_t bits)
+    {
+        return (uint64_t(1) << bits) - 1;
+    }
+
+    uint64_t QuantizeDepth(float depth)
+    {
+        if (!(depth > 0.0f)) return 0;
+        if (depth >= 1.0f) return FieldMask(DrawKey::DepthBits);
+        return static_cast<uint64_t>(static_cast<double>(depth) * static_cast<double>(FieldMask(DrawKey::DepthBits)));
+    }
+
+    uint32_t Digit(uint64_t key, uint32_t digit)
+    {
+        return static_cast<uint32_t>(key >> (digit * DigitBits)) & (Buckets - 1);
+    }
+}
+
+namespace DrawKey
+{
+    uint64_t Make(uint32_t pass, DrawLayer layer, uint32_t pipeline, uint32_t material, float depth)
+    {
+        uint64_t key = (pass & FieldMask(PassBits)) << (64 - PassBits);
+        key |= (static_cast<uint64_t>(layer) & FieldMask(LayerBits)) << (64 - PassBits - LayerBits);
+
+        uint64_t depthField = QuantizeDepth(depth);
+        if (layer == DrawLayer::Transparent)
+        {
+            // De atrás hacia delante: la profundidad invertida manda sobre el estado.
+            key |= (FieldMask(DepthBits) - depthField) << (PipelineBits + MaterialBits);
+            key |= (pipeline & FieldMask(PipelineBits)) << MaterialBits;
+            key |= material & FieldMask(MaterialBits);
+        }
+        else
+        {
+            key |= (pipeline & FieldMask(PipelineBits)) << (MaterialBits + DepthBits);
+            key |= (material & FieldMask(MaterialBits)) << DepthBits;
+            key |= depthField;
+        }
+        return key;
+    }
+
+    uint32_t Pass(uint64_t key)
+    {
+        return static_cast<uint32_t>(key >> (64 - PassBits));
+    }
+
+    DrawLayer Layer(uint64_t key)
+    {
+        return static_cast<DrawLayer>((key >> (64 - PassBits - LayerBits)) & FieldMask(LayerBits));
+    }
+
+    uint32_t AllocatePipelineId()
+    {
+        return nextPipelineId.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint32_t AllocateMaterialId()
+    {
+        return nextMaterialId.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void DrawQueue::Sort(JobSystem* jobs)
+{
+    PROFILE_FUNCTION();
+    uint64_t start = Profiler::Now();
+
+    const uint32_t count = Count();
+    stats = DrawQueueStats();
+    stats.items = count;
+    if (count < 2) return;
+
+    uint32_t blocks = 1;
+    if (jobs && jobs->WorkerCount() > 0)
+    {
+        blocks = (std::min)({ count / MinBlockSize, MaxBlocks, (jobs->WorkerCount() + 1) * 4 });
+        blocks = (std::max)(blocks, 1u);
+    }
+    const uint32_t blockSize = (count + blocks - 1) / blocks;
+    stats.blocks = blocks;
+
+    scratch.resize(count);
+    histograms.resize(static_cast<size_t>(Digits) * blocks * Buckets);
+
+    DrawQueueItem* source = items.data();
+    DrawQueueItem* destination = scratch.data();
+    uint32_t* counts = histograms.data();
+
+    auto forEachBlock = [&](auto&& fn) {
+        if (blocks == 1)
+        {
+            fn(0u, 0u, count);
+            return;
+        }
+        jobs->ParallelFor(blocks, 1, [&](uint32_t first, uint32_t last) {
+            for (uint32_t block = first; block < last; block++)
+            {
+                uint32_t begin = block * blockSize;
+                fn(block, begin, (std::min)(begin + blockSize, count));
+            }
+        });
+    };
+    auto blockCounts = [&](uint32_t digit, uint32_t block) {
+        return counts + (static_cast<size_t>(digit) * blocks + block) * Buckets;
+    };
+
+    // Histograma de los ocho dígitos en una sola lectura. Los totales no dependen del orden, así
+    // que sirven para saltar los dígitos constantes; los de cada bloque valen para la primera pasada.
+    forEachBlock([&](uint32_t block, uint32_t begin, uint32_t end) {
+        uint32_t local[Digits][Buckets] = {};
+        for (uint32_t i = begin; i < end; i++)
+        {
+            uint64_t key = source[i].key;
+            for (uint32_t digit = 0; digit < Digits; digit++)
+            {
+                local[digit][Digit(key, digit)]++;
+            }
+        }
+        for (uint32_t digit = 0; digit < Digits; digit++)
+        {
+            memcpy(blockCounts(digit, block), local[digit], sizeof(local[digit]));
+        }
+    });
+
+    bool firstPass = true;
+    for (uint32_t digit = 0; digit < Digits; digit++)
+    {
+        uint32_t firstBucket = Digit(source[0].key, digit);
+        uint32_t total = 0;
+        for (uint32_t block = 0; block < blocks; block++)
+        {
+            total += blockCounts(digit, block)[firstBucket];
+        }
+        if (total == count) continue;
+
+        if (!firstPass)
+        {
+            forEachBlock([&](uint32_t block, uint32_t begin, uint32_t end) {
+                uint32_t* histogram = blockCounts(digit, block);
+                memset(histogram, 0, Buckets * sizeof(uint32_t));
+                for (uint32_t i = begin; i < end; i++)
+                {
+                    histogram[Digit(source[i].key, digit)]++;
+                }
+            });
+        }
+        firstPass = false;
+
+        // Posición de salida de cada cubo en cada bloque: los bloques anteriores van antes, así la pasada es estable.
+        uint32_t offset = 0;
+        for (uint32_t bucket = 0; bucket < Buckets; bucket++)
+        {
+            for (uint32_t block = 0; block < blocks; block++)
+            {
+                uint32_t& slot = blockCounts(digit, block)[bucket];
+                uint32_t bucketCount = slot;
+                slot = offset;
+                offset += bucketCount;
+            }
+        }
+
+        forEachBlock([&](uint32_t block, uint32_t begin, uint32_t end) {
+            uint32_t* offsets = blockCounts(digit, block);
+            for (uint32_t i = begin; i < end; i++)
+            {
+                destination[offsets[Digit(source[i].key, digit)]++] = source[i];
+            }
+        });
+
+        std::swap(source, destination);
+        stats.passes++;
+    }
+
+    if (source != items.data())
+    {
+        items.swap(scratch);
+    }
+    stats.sortTicks = Profiler::Now() - start;
+}
@@ -0,0 +1,102 @@
+﻿/**
+ * @file DrawQueue.h
+ * @brief Cola de dibujados ordenada por una clave de 64 bits.
+ *
+ * Cada envío lleva una clave que codifica, de más a menos significativo, el pase, la capa
+ * (opaca o transparente), el PSO, el material y un cubo de profundidad. Ordenar por la clave
+ * agrupa los dibujados que comparten estado, de modo que CommandContext descarta la mayoría de
+ * cambios, y dentro de cada material deja los opacos de delante hacia atrás para aprovechar el
+ * early-Z. En la capa transparente la profundidad invertida sube por encima del PSO: se dibuja de
+ * atrás hacia delante aunque cueste más cambios de estado.
+ *
+ * La ordenación es un radix sort LSD de 8 bits por pasada repartido en bloques con el JobSystem;
+ * las pasadas cuyo dígito es igual en todas las claves se saltan, así que los bits que no se usan
+ * no cuestan nada. Es estable: a igual clave se conserva el orden de envío.
+ */
+
+#pragma once
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+enum class DrawLayer : uint32_t {
+    Opaque,
+    Transparent,
+};
+
+namespace DrawKey
+{
+    constexpr uint32_t PassBits = 4;
+    constexpr uint32_t LayerBits = 2;
+    constexpr uint32_t PipelineBits = 14;
+    constexpr uint32_t MaterialBits = 20;
+    constexpr uint32_t DepthBits = 24;
+    static_assert(PassBits + LayerBits + PipelineBits + MaterialBits + DepthBits == 64, "La clave debe ocupar 64 bits");
+
+    /**
+     * @brief Compone la clave de un dibujado.
+     * @param depth Profundidad normalizada en [0, 1]; fuera de rango se satura.
+     * Los identificadores más anchos que su campo se truncan.
+     */
+    uint64_t Make(uint32_t pass, DrawLayer layer, uint32_t pipeline, uint32_t material, float depth);
+
+    uint32_t Pass(uint64_t key);
+    DrawLayer Layer(uint64_t key);
+
+    /// Identificadores pequeños y únicos para los campos de PSO y material. Empiezan en 1.
+    uint32_t AllocatePipelineId();
+    uint32_t AllocateMaterialId();
+}
+
+/**
+ * @struct DrawQueueItem
+ * @brief Clave y valor opaco del envío, normalmente el índice del paquete en su DrawList.
+ */
+struct DrawQueueItem {
+    uint64_t key;
+    uint32_t value;
+};
+
+/**
+ * @struct DrawQueueStats
+ * @brief Coste de la última ordenación.
+ */
+struct DrawQueueStats {
+    uint32_t items = 0;
+    uint32_t blocks = 0;            ///< Bloques en que se repartió el trabajo
+    uint32_t passes = 0;            ///< Pasadas de dispersión ejecutadas, de 8 posibles
+    uint64_t sortTicks = 0;         ///< En ticks del perfilador
+};
+
+/**
+ * @class DrawQueue
+ * @brief Envíos de un fotograma; se vacía con Clear y se recorre ordenada tras Sort.
+ *
+ * La memoria se conserva entre fotogramas: en régimen estable Push y Sort no asignan.
+ */
+class DrawQueue {
+public:
+    static constexpr uint32_t MinBlockSize = 16384;    ///< Elementos por bloque por debajo de los que no compensa repartir
+    static constexpr uint32_t MaxBlocks = 64;
+
+    void Clear() { items.clear(); }
+    void Reserve(uint32_t count) { items.reserve(count); }
+    void Push(uint64_t key, uint32_t value) { items.push_back(DrawQueueItem{ key, value }); }
+
+    /// Ordena por clave de forma estable. Sin JobSystem todo se hace en el hilo que llama.
+    void Sort(JobSystem* jobs = nullptr);
+
+    uint32_t Count() const { return static_cast<uint32_t>(items.size()); }
+    const DrawQueueItem& operator[](uint32_t index) const { return items[index]; }
+    const DrawQueueItem* begin() const { return items.data(); }
+    const DrawQueueItem* end() const { return items.data() + items.size(); }
+
+    const DrawQueueStats& Stats() const { return stats; }
+
+private:
+    std::vector<DrawQueueItem> items;
+    std::vector<DrawQueueItem> scratch;
+    std::vector<uint32_t>      histograms;  ///< 256 contadores por bloque y dígito
+    DrawQueueStats             stats;
+};
@@ -0,0 +1,138 @@
+﻿/**
+ * @file DynamicResolution.cpp
+ * @brief Implementación del controlador de resolución dinámica y de la geometría del destino interno.
+ */
+
+#include "pch.h"
+#include "DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr double MinAreaFactor = 0.1;  ///< Un fotograma desastroso no baja la fracción de píxeles más de 10 veces
+
+    uint32_t ScaleAxis(uint32_t output, float scale, uint32_t limit, uint32_t alignment)
+    {
+        alignment = (std::max)(alignment, 1u);
+        uint32_t size = static_cast<uint32_t>(std::lround(static_cast<double>(output) * scale / alignment)) * alignment;
+        size = (std::min)(size, limit);
+        return (std::max)(size, (std::min)(alignment, limit));
+    }
+}
+
+namespace DynamicResolution
+{
+    ResolutionSize ScaledSize(ResolutionSize output, float scale, ResolutionSize limit, uint32_t alignment)
+    {
+        ResolutionSize size;
+        size.width = ScaleAxis(output.width, scale, limit.width, alignment);
+        size.height = ScaleAxis(output.height, scale, limit.height, alignment);
+        return size;
+    }
+
+    RenderViewport Viewport(ResolutionSize size)
+    {
+        RenderViewport viewport;
+        viewport.width = static_cast<float>(size.width);
+        viewport.height = static_cast<float>(size.height);
+        return viewport;
+    }
+
+    RenderScissor Scissor(ResolutionSize size)
+    {
+        RenderScissor scissor;
+        scissor.right = static_cast<int32_t>(size.width);
+        scissor.bottom = static_cast<int32_t>(size.height);
+        return scissor;
+    }
+
+    float AspectRatio(ResolutionSize output)
+    {
+        return output.height ? static_cast<float>(output.width) / static_cast<float>(output.height) : 1.0f;
+    }
+
+    UpscaleConstants Upscale(ResolutionSize rendered, ResolutionSize target)
+    {
+        UpscaleConstants constants = {};
+        if (target.width == 0 || target.height == 0) return constants;
+
+        float width = static_cast<float>(target.width);
+        float height = static_cast<float>(target.height);
+        constants.uvScale.x = rendered.width / width;
+        constants.uvScale.y = rendered.height / height;
+        constants.uvMax.x = (rendered.width - 0.5f) / width;
+        constants.uvMax.y = (rendered.height - 0.5f) / height;
+        return constants;
+    }
+}
+
+ResolutionController::ResolutionController(const ResolutionControllerConfig& config)
+    : config(config), scale(config.maxScale), area(static_cast<double>(config.maxScale) * config.maxScale)
+{
+}
+
+float ResolutionController::ClampScale(float value) const
+{
+    return (std::min)((std::max)(value, config.minScale), config.maxScale);
+}
+
+void ResolutionController::SetEnabled(bool value)
+{
+    enabled = value;
+    scale = config.maxScale;
+    area = static_cast<double>(scale) * scale;
+    lastError = 0.0;
+    previousError = 0.0;
+    settling = config.settleFrames;
+}
+
+float ResolutionController::Update(double gpuMs)
+{
+    if (!enabled || !(gpuMs > 0.0)) return scale;
+    if (settling > 0)
+    {
+        settling--;
+        return scale;
+    }
+
+    // Error relativo: positivo si sobra tiempo. Dentro de la banda muerta se da por bueno y no se
+    // toca nada: en forma incremental, pasar el error a cero deshace la parte proporcional de la
+    // última corrección, y el ruido alrededor del borde de la banda movería la escala sin parar.
+    double error = (config.gpuBudgetMs - gpuMs) / config.gpuBudgetMs;
+    if (std::fabs(error) < config.deadband)
+    {
+        lastError = 0.0;
+        previousError = 0.0;
+        return scale;
+    }
+
+    // PID incremental: se calcula el cambio, no la salida, así que el integrador no se satura en los límites.
+    double delta = config.proportional * (error - lastError)
+        + config.integral * error
+        + config.derivative * (error - 2.0 * lastError + previousError);
+    previousError = lastError;
+    lastError = error;
+
+    double minArea = static_cast<double>(config.minScale) * config.minScale;
+    double maxArea = static_cast<double>(config.maxScale) * config.maxScale;
+    area = (std::min)((std::max)(area * (std::max)(1.0 + delta, MinAreaFactor), minArea), maxArea);
+
+    float target = ClampScale(static_cast<float>(std::sqrt(area)));
+    if (target > scale + config.maxGrowth)
+    {
+        // Subir despacio: un pico de tiempo tras subir demasiado se ve, bajar a tiempo no siempre.
+        target = scale + config.maxGrowth;
+        area = static_cast<double>(target) * target;
+    }
+
+    // Histéresis: los cambios pequeños se acumulan en area hasta superar el paso mínimo, salvo al llegar a un límite.
+    bool atLimit = target != scale && (target == config.minScale || target == config.maxScale);
+    if (std::fabs(target - scale) >= config.minStep || atLimit)
+    {
+        scale = target;
+        settling = config.settleFrames;
+        changes++;
+    }
+    return scale;
+}
@@ -0,0 +1,120 @@
+﻿/**
+ * @file DynamicResolution.h
+ * @brief Resolución dinámica: escala de render ajustada al tiempo de GPU y geometría del destino interno.
+ *
+ * La escena se dibuja en un destino interno del tamaño de la salida por la escala máxima; cada
+ * fotograma solo se usa la esquina superior izquierda, del tamaño de la salida por la escala
+ * actual, y un pase final la amplía al búfer trasero. Cambiar de escala es cambiar el viewport:
+ * no se crean recursos ni se vacía la GPU.
+ *
+ * ResolutionController decide la escala con un PID en forma incremental sobre la fracción de
+ * píxeles, que es lo que el tiempo de GPU sigue aproximadamente. Una banda muerta alrededor del
+ * presupuesto y un paso mínimo evitan oscilar entre escalas vecinas; tras aplicar un cambio espera
+ * a que los tiempos medidos lo reflejen antes de volver a actuar, porque llegan varios fotogramas
+ * tarde. Ni el controlador ni las funciones de geometría tocan Direct3D: se prueban con tiempos
+ * y tamaños inventados.
+ */
+
+#pragma once
+#include <cstdint>
+#include "ShaderConstants.h"
+
+/**
+ * @struct ResolutionSize
+ * @brief Tamaño en píxeles.
+ */
+struct ResolutionSize {
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+/**
+ * @struct RenderViewport
+ * @brief Mismos campos y orden que D3D12_VIEWPORT.
+ */
+struct RenderViewport {
+    float topLeftX = 0.0f;
+    float topLeftY = 0.0f;
+    float width = 0.0f;
+    float height = 0.0f;
+    float minDepth = 0.0f;
+    float maxDepth = 1.0f;
+};
+
+/**
+ * @struct RenderScissor
+ * @brief Mismos campos y orden que D3D12_RECT.
+ */
+struct RenderScissor {
+    int32_t left = 0;
+    int32_t top = 0;
+    int32_t right = 0;
+    int32_t bottom = 0;
+};
+
+namespace DynamicResolution
+{
+    /// Tamaño de la región dibujada a una escala, redondeado a múltiplos de alignment y dentro de limit.
+    ResolutionSize ScaledSize(ResolutionSize output, float scale, ResolutionSize limit, uint32_t alignment);
+
+    RenderViewport Viewport(ResolutionSize size);
+    RenderScissor Scissor(ResolutionSize size);
+
+    /// Relación de aspecto de la salida; la proyección no cambia con la escala.
+    float AspectRatio(ResolutionSize output);
+
+    /// Constantes para ampliar la región dibujada, de tamaño rendered, de un destino de tamaño target.
+    UpscaleConstants Upscale(ResolutionSize rendered, ResolutionSize target);
+}
+
+/**
+ * @struct ResolutionControllerConfig
+ * @brief Parámetros del controlador. Los tiempos van en milisegundos.
+ */
+struct ResolutionControllerConfig {
+    double   gpuBudgetMs = 14.0;    ///< Tiempo de GPU objetivo; por debajo del periodo de refresco para dejar margen
+    float    minScale = 0.5f;       ///< Por eje
+    float    maxScale = 1.0f;       ///< Por eje; fija el tamaño del destino interno
+    float    proportional = 0.5f;
+    float    integral = 0.25f;
+    float    derivative = 0.1f;
+    float    deadband = 0.05f;      ///< Fracción del presupuesto alrededor de él en la que no se corrige
+    float    minStep = 0.02f;       ///< Cambio de escala más pequeño que se aplica
+    float    maxGrowth = 0.05f;     ///< Subida máxima de escala por cambio; bajar no tiene límite
+    uint32_t settleFrames = 3;      ///< Medidas que se ignoran tras un cambio, las que aún son de la escala anterior
+};
+
+/**
+ * @class ResolutionController
+ * @brief Escala de render por eje a partir del tiempo de GPU de cada fotograma.
+ */
+class ResolutionController {
+public:
+    explicit ResolutionController(const ResolutionControllerConfig& config = ResolutionControllerConfig());
+
+    /// Con el control desactivado la escala vuelve a la máxima y los tiempos se ignoran.
+    void SetEnabled(bool enabled);
+    bool IsEnabled() const { return enabled; }
+
+    const ResolutionControllerConfig& Config() const { return config; }
+
+    /// Tiempo de GPU de un fotograma terminado. Devuelve la escala que deben usar los siguientes.
+    float Update(double gpuMs);
+
+    float Scale() const { return scale; }
+
+    /// Cambios de escala aplicados desde el principio.
+    uint64_t Changes() const { return changes; }
+
+private:
+    float ClampScale(float value) const;
+
+    ResolutionControllerConfig config;
+    bool     enabled = true;
+    float    scale;                 ///< Escala aplicada
+    double   area;                  ///< Fracción de píxeles que pide el PID, sin pasos mínimos
+    double   lastError = 0.0;
+    double   previousError = 0.0;
+    uint32_t settling = 0;
+    uint64_t changes = 0;
+};
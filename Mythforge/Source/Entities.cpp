@@ -0,0 +1,209 @@
+﻿/**
+ * @file Entities.cpp
+ * @brief Implementación del almacenamiento de entidades por arquetipos.
+ */
+
+#include "pch.h"
+#include "Entities.h"
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+
+namespace
+{
+    std::mutex                  componentRegistryMutex;
+    std::deque<ComponentInfo>   componentRegistry;
+
+    uint32_t AlignUp(uint32_t value, uint32_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+ComponentTypeId RegisterComponentType(size_t size, size_t alignment)
+{
+    std::lock_guard<std::mutex> lock(componentRegistryMutex);
+    if (componentRegistry.size() >= MaxComponentTypes)
+    {
+        throw std::length_error("Demasiados tipos de componente registrados");
+    }
+    componentRegistry.push_back({ size, alignment });
+    return static_cast<ComponentTypeId>(componentRegistry.size() - 1);
+}
+
+const ComponentInfo& GetComponentInfo(ComponentTypeId type)
+{
+    std::lock_guard<std::mutex> lock(componentRegistryMutex);
+    return componentRegistry[type];
+}
+
+Archetype::Archetype(const ComponentMask& mask) : mask(mask)
+{
+    uint32_t rowSize = sizeof(Entity);
+    uint32_t alignmentSlack = 0;
+    for (ComponentTypeId type = 0; type < MaxComponentTypes; type++)
+    {
+        if (!mask.test(type)) continue;
+
+        const ComponentInfo& info = GetComponentInfo(type);
+        columnIndex[type] = static_cast<uint8_t>(types.size());
+        types.push_back(type);
+        columnSizes.push_back(static_cast<uint32_t>(info.size));
+        rowSize += static_cast<uint32_t>(info.size);
+        alignmentSlack += static_cast<uint32_t>(info.alignment);
+    }
+
+    // Se reparte el chunk en columnas; se reduce la capacidad hasta que el relleno de alineación quepa.
+    capacity = static_cast<uint32_t>((EntityChunkSize - alignmentSlack) / rowSize);
+    for (;;)
+    {
+        columnOffsets.clear();
+        uint32_t offset = capacity * sizeof(Entity);
+        for (ComponentTypeId type : types)
+        {
+            const ComponentInfo& info = GetComponentInfo(type);
+            offset = AlignUp(offset, static_cast<uint32_t>(info.alignment));
+            columnOffsets.push_back(offset);
+            offset += capacity * static_cast<uint32_t>(info.size);
+        }
+
+        if (offset <= EntityChunkSize || capacity <= 1) break;
+        capacity--;
+    }
+
+    if (capacity == 0)
+    {
+        throw std::length_error("Los componentes del arquetipo no caben en un chunk");
+    }
+}
+
+Archetype::Location Archetype::Allocate(Entity entity)
+{
+    if (chunks.empty() || chunks.back().count == capacity)
+    {
+        Chunk chunk;
+        chunk.storage = spareChunk ? std::move(spareChunk) : std::make_unique<ChunkStorage>();
+        chunks.push_back(std::move(chunk));
+    }
+
+    uint32_t chunkIndex = static_cast<uint32_t>(chunks.size() - 1);
+    uint32_t row = chunks.back().count++;
+    Entities(chunkIndex)[row] = entity;
+    entityCount++;
+
+    return { chunkIndex, row };
+}
+
+Entity Archetype::RemoveSwap(Location location)
+{
+    uint32_t lastChunk = static_cast<uint32_t>(chunks.size() - 1);
+    uint32_t lastRow = chunks[lastChunk].count - 1;
+    Entity moved;
+
+    if (location.chunk != lastChunk || location.row != lastRow)
+    {
+        // La última fila del arquetipo ocupa el hueco para mantener los chunks densos.
+        moved = Entities(lastChunk)[lastRow];
+        Entities(location.chunk)[location.row] = moved;
+        for (size_t column = 0; column < types.size(); column++)
+        {
+            size_t size = columnSizes[column];
+            uint8_t* destination = chunks[location.chunk].storage->bytes + columnOffsets[column] + location.row * size;
+            const uint8_t* source = chunks[lastChunk].storage->bytes + columnOffsets[column] + lastRow * size;
+            memcpy(destination, source, size);
+        }
+    }
+
+    chunks[lastChunk].count--;
+    entityCount--;
+    if (chunks[lastChunk].count == 0)
+    {
+        spareChunk = std::move(chunks[lastChunk].storage);
+        chunks.pop_back();
+    }
+
+    return moved;
+}
+
+Archetype& World::GetOrCreateArchetype(const ComponentMask& mask)
+{
+    auto found = archetypeLookup.find(mask.to_ullong());
+    if (found != archetypeLookup.end())
+    {
+        return *found->second;
+    }
+
+    archetypes.push_back(std::make_unique<Archetype>(mask));
+    Archetype* archetype = archetypes.back().get();
+    archetypeLookup.emplace(mask.to_ullong(), archetype);
+    return *archetype;
+}
+
+Entity World::AllocateEntity()
+{
+    Entity entity;
+    if (!freeIndices.empty())
+    {
+        entity.index = freeIndices.back();
+        freeIndices.pop_back();
+    }
+    else
+    {
+        entity.index = static_cast<uint32_t>(records.size());
+        records.emplace_back();
+    }
+
+    entity.generation = records[entity.index].generation;
+    aliveCount++;
+    return entity;
+}
+
+bool World::IsAlive(Entity entity) const
+{
+    return entity.index < records.size() &&
+        records[entity.index].archetype != nullptr &&
+        records[entity.index].generation == entity.generation;
+}
+
+void World::Destroy(Entity entity)
+{
+    if (!IsAlive(entity)) return;
+
+    EntityRecord& record = records[entity.index];
+    RemoveFromArchetype(record);
+    record.archetype = nullptr;
+    record.generation++;
+    freeIndices.push_back(entity.index);
+    aliveCount--;
+}
+
+void World::MoveEntity(Entity entity, Archetype& destination)
+{
+    EntityRecord& record = records[entity.index];
+    Archetype& source = *record.archetype;
+    Archetype::Location location = destination.Allocate(entity);
+
+    for (size_t column = 0; column < source.types.size(); column++)
+    {
+        ComponentTypeId type = source.types[column];
+        if (!destination.Has(type)) continue;
+
+        size_t size = source.columnSizes[column];
+        memcpy(destination.Column(location.chunk, type) + location.row * size,
+            source.Column(record.location.chunk, type) + record.location.row * size,
+            size);
+    }
+
+    RemoveFromArchetype(record);
+    record.archetype = &destination;
+    record.location = location;
+}
+
+void World::RemoveFromArchetype(EntityRecord& record)
+{
+    Entity moved = record.archetype->RemoveSwap(record.location);
+    if (moved.IsValid())
+    {
+        records[moved.index].location = record.location;
+    }
+}
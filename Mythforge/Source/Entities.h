@@ -0,0 +1,297 @@
+﻿/**
+ * @file Entities.h
+ * @brief Define un almacenamiento de entidades por arquetipos con componentes contiguos en chunks.
+ *
+ * Cada combinación distinta de componentes (arquetipo) guarda sus entidades en chunks de
+ * EntityChunkSize bytes. Dentro de un chunk cada componente ocupa un array contiguo
+ * (estructura de arrays), de modo que los sistemas recorren memoria densa.
+ *
+ * Los componentes deben ser trivialmente copiables: los cambios estructurales mueven
+ * filas entre arquetipos con memcpy. No se permiten cambios estructurales (Create, Destroy,
+ * Add, Remove) mientras se itera una consulta.
+ */
+
+#pragma once
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "JobSystem.h"
+
+constexpr uint32_t MaxComponentTypes = 64; ///< Número máximo de tipos de componente distintos
+constexpr size_t EntityChunkSize = 16 * 1024; ///< Tamaño en bytes de cada chunk de un arquetipo
+
+using ComponentTypeId = uint32_t;
+using ComponentMask = std::bitset<MaxComponentTypes>;
+
+/**
+ * @struct ComponentInfo
+ * @brief Tamaño y alineación de un tipo de componente registrado.
+ */
+struct ComponentInfo {
+    size_t size;
+    size_t alignment;
+};
+
+ComponentTypeId RegisterComponentType(size_t size, size_t alignment);
+const ComponentInfo& GetComponentInfo(ComponentTypeId type);
+
+/**
+ * @brief Devuelve el identificador del tipo de componente T, registrándolo la primera vez.
+ */
+template<typename T>
+ComponentTypeId ComponentType()
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Los componentes deben ser trivialmente copiables");
+    static const ComponentTypeId id = RegisterComponentType(sizeof(T), alignof(T));
+    return id;
+}
+
+template<typename... Ts>
+ComponentMask ComponentMaskOf()
+{
+    ComponentMask mask;
+    (mask.set(ComponentType<Ts>()), ...);
+    return mask;
+}
+
+/**
+ * @struct Entity
+ * @brief Identificador de entidad. La generación invalida los identificadores de entidades destruidas.
+ */
+struct Entity {
+    static constexpr uint32_t InvalidIndex = 0xFFFFFFFF;
+
+    uint32_t index = InvalidIndex; ///< Índice en la tabla de entidades del World
+    uint32_t generation = 0; ///< Generación del índice cuando se creó la entidad
+
+    bool IsValid() const { return index != InvalidIndex; }
+    bool operator==(const Entity& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const Entity& other) const { return !(*this == other); }
+};
+
+/**
+ * @class Archetype
+ * @brief Conjunto de entidades que comparten exactamente el mismo conjunto de componentes.
+ */
+class Archetype {
+public:
+    explicit Archetype(const ComponentMask& mask);
+
+    const ComponentMask& Mask() const { return mask; }
+    bool Has(ComponentTypeId type) const { return mask.test(type); }
+
+    uint32_t ChunkCount() const { return static_cast<uint32_t>(chunks.size()); }
+    uint32_t ChunkEntityCount(uint32_t chunk) const { return chunks[chunk].count; }
+    uint32_t ChunkCapacity() const { return capacity; }
+    uint32_t EntityCount() const { return entityCount; }
+
+    Entity* Entities(uint32_t chunk) { return reinterpret_cast<Entity*>(chunks[chunk].storage->bytes); }
+
+    uint8_t* Column(uint32_t chunk, ComponentTypeId type)
+    {
+        return chunks[chunk].storage->bytes + columnOffsets[columnIndex[type]];
+    }
+
+    template<typename T>
+    T* Components(uint32_t chunk) { return reinterpret_cast<T*>(Column(chunk, ComponentType<T>())); }
+
+private:
+    friend class World;
+
+    struct alignas(64) ChunkStorage {
+        uint8_t bytes[EntityChunkSize];
+    };
+
+    struct Chunk {
+        std::unique_ptr<ChunkStorage> storage;
+        uint32_t count = 0;
+    };
+
+    struct Location {
+        uint32_t chunk;
+        uint32_t row;
+    };
+
+    Location Allocate(Entity entity);
+    Entity RemoveSwap(Location location);
+
+    ComponentMask                           mask;
+    std::vector<ComponentTypeId>            types; ///< Tipos de componente en orden de columna
+    std::array<uint8_t, MaxComponentTypes>  columnIndex = {}; ///< Columna de cada tipo presente
+    std::vector<uint32_t>                   columnOffsets; ///< Desplazamiento de cada columna dentro del chunk
+    std::vector<uint32_t>                   columnSizes; ///< Tamaño del componente de cada columna
+    uint32_t                                capacity = 0; ///< Entidades por chunk
+    std::vector<Chunk>                      chunks;
+    std::unique_ptr<ChunkStorage>           spareChunk; ///< Chunk liberado que se reutiliza para evitar reservas
+    uint32_t                                entityCount = 0;
+};
+
+/**
+ * @class World
+ * @brief Tabla de entidades y sus arquetipos. Punto de entrada para crear entidades y lanzar consultas.
+ */
+class World {
+public:
+    World() = default;
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+
+    template<typename... Ts>
+    Entity Create(const Ts&... components)
+    {
+        Archetype& archetype = GetOrCreateArchetype(ComponentMaskOf<Ts...>());
+        Entity entity = AllocateEntity();
+        Archetype::Location location = archetype.Allocate(entity);
+        (new (archetype.Components<Ts>(location.chunk) + location.row) Ts(components), ...);
+
+        EntityRecord& record = records[entity.index];
+        record.archetype = &archetype;
+        record.location = location;
+        return entity;
+    }
+
+    void Destroy(Entity entity);
+    bool IsAlive(Entity entity) const;
+
+    /// Tamaño de la tabla de entidades: el índice de toda entidad viva es menor.
+    uint32_t IndexCapacity() const { return static_cast<uint32_t>(records.size()); }
+    uint32_t EntityCount() const { return aliveCount; }
+
+    template<typename T>
+    void Add(Entity entity, const T& component)
+    {
+        if (!IsAlive(entity)) return;
+
+        EntityRecord& record = records[entity.index];
+        ComponentTypeId type = ComponentType<T>();
+        if (!record.archetype->Has(type))
+        {
+            ComponentMask mask = record.archetype->Mask();
+            mask.set(type);
+            MoveEntity(entity, GetOrCreateArchetype(mask));
+        }
+        new (record.archetype->Components<T>(record.location.chunk) + record.location.row) T(component);
+    }
+
+    template<typename T>
+    void Remove(Entity entity)
+    {
+        if (!IsAlive(entity)) return;
+
+        EntityRecord& record = records[entity.index];
+        ComponentTypeId type = ComponentType<T>();
+        if (!record.archetype->Has(type)) return;
+
+        ComponentMask mask = record.archetype->Mask();
+        mask.reset(type);
+        MoveEntity(entity, GetOrCreateArchetype(mask));
+    }
+
+    template<typename T>
+    bool Has(Entity entity) const
+    {
+        return IsAlive(entity) && records[entity.index].archetype->Has(ComponentType<T>());
+    }
+
+    /// Devuelve el componente T de la entidad, o nullptr si no lo tiene.
+    template<typename T>
+    T* Get(Entity entity)
+    {
+        if (!Has<T>(entity)) return nullptr;
+        const EntityRecord& record = records[entity.index];
+        return record.archetype->Components<T>(record.location.chunk) + record.location.row;
+    }
+
+    /**
+     * @brief Recorre todos los chunks que contienen al menos los componentes Ts.
+     * @param fn Función fn(uint32_t count, const Entity* entities, Ts*... columns).
+     */
+    template<typename... Ts, typename F>
+    void ForEachChunk(F&& fn)
+    {
+        ComponentMask required = ComponentMaskOf<Ts...>();
+        for (auto& archetype : archetypes)
+        {
+            if ((archetype->Mask() & required) != required) continue;
+
+            for (uint32_t chunk = 0; chunk < archetype->ChunkCount(); chunk++)
+            {
+                fn(archetype->ChunkEntityCount(chunk), archetype->Entities(chunk), archetype->template Components<Ts>(chunk)...);
+            }
+        }
+    }
+
+    /**
+     * @brief Recorre todas las entidades que tienen al menos los componentes Ts.
+     * @param fn Función fn(Ts&... components).
+     */
+    template<typename... Ts, typename F>
+    void ForEach(F&& fn)
+    {
+        ForEachChunk<Ts...>([&fn](uint32_t count, const Entity*, Ts*... columns) {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                fn(columns[i]...);
+            }
+        });
+    }
+
+    /**
+     * @brief Igual que ForEachChunk, pero reparte los chunks entre los hilos del JobSystem.
+     *
+     * fn se invoca concurrentemente sobre chunks distintos; no debe escribir en estado compartido
+     * sin sincronizar.
+     */
+    template<typename... Ts, typename F>
+    void ParallelForEachChunk(JobSystem& jobSystem, F&& fn)
+    {
+        ComponentMask required = ComponentMaskOf<Ts...>();
+        for (auto& archetype : archetypes)
+        {
+            if ((archetype->Mask() & required) != required) continue;
+
+            Archetype* matched = archetype.get();
+            jobSystem.ParallelFor(matched->ChunkCount(), 1, [matched, &fn](uint32_t begin, uint32_t end) {
+                for (uint32_t chunk = begin; chunk < end; chunk++)
+                {
+                    fn(matched->ChunkEntityCount(chunk), matched->Entities(chunk), matched->template Components<Ts>(chunk)...);
+                }
+            });
+        }
+    }
+
+    template<typename... Ts, typename F>
+    void ParallelForEach(JobSystem& jobSystem, F&& fn)
+    {
+        ParallelForEachChunk<Ts...>(jobSystem, [&fn](uint32_t count, const Entity*, Ts*... columns) {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                fn(columns[i]...);
+            }
+        });
+    }
+
+private:
+    struct EntityRecord {
+        Archetype*          archetype = nullptr;
+        Archetype::Location location = {};
+        uint32_t            generation = 0;
+    };
+
+    Archetype& GetOrCreateArchetype(const ComponentMask& mask);
+    Entity AllocateEntity();
+    void MoveEntity(Entity entity, Archetype& destination);
+    void RemoveFromArchetype(EntityRecord& record);
+
+    std::vector<EntityRecord>                           records; ///< Registro de cada índice de entidad
+    std::vector<uint32_t>                               freeIndices; ///< Índices reutilizables
+    std::vector<std::unique_ptr<Archetype>>             archetypes;
+    std::unordered_map<unsigned long long, Archetype*>  archetypeLookup; ///< Arquetipo por máscara de componentes
+    uint32_t                                            aliveCount = 0;
+};
@@ -0,0 +1,56 @@
+﻿/**
+ * @file FrameArena.cpp
+ * @brief Implementación de la memoria lineal por fotograma.
+ */
+
+#include "pch.h"
+#include "FrameArena.h"
+
+FrameArena::FrameArena(size_t capacity)
+    : buffer(new uint8_t[capacity]), capacity(capacity)
+{
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+    // Alinea el desplazamiento dentro del bloque; el bloque sale de new y ya viene alineado a max_align_t.
+    size_t current = offset.load(std::memory_order_relaxed);
+    size_t begin;
+    do
+    {
+        begin = (current + alignment - 1) & ~(alignment - 1);
+        if (begin + size > capacity)
+        {
+            break;
+        }
+    } while (!offset.compare_exchange_weak(current, begin + size, std::memory_order_relaxed));
+
+    if (begin + size <= capacity)
+    {
+        return buffer.get() + begin;
+    }
+
+    // Sin espacio: bloque propio del montículo, que se libera en el próximo Reset.
+    std::lock_guard<std::mutex> lock(overflowMutex);
+    overflowBlocks.emplace_back(new uint8_t[size + alignment]);
+    overflowBytes += size + alignment;
+    uintptr_t address = reinterpret_cast<uintptr_t>(overflowBlocks.back().get());
+    return reinterpret_cast<void*>((address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1));
+}
+
+void FrameArena::Reset()
+{
+    size_t used = Used() + overflowBytes;
+    highWater = (std::max)(highWater, used);
+
+    if (overflowBytes > 0)
+    {
+        capacity = used + used / 2;
+        buffer.reset(new uint8_t[capacity]);
+        overflowBlocks.clear();
+        overflowBytes = 0;
+        growCount++;
+    }
+
+    offset.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,106 @@
+﻿/**
+ * @file FrameArena.h
+ * @brief Memoria lineal para datos de CPU que solo viven durante un fotograma.
+ *
+ * Allocate reserva avanzando un desplazamiento atómico sobre un bloque fijo, así que puede
+ * llamarse desde varios hilos a la vez; nada se libera por separado y Reset lo recupera todo al
+ * empezar el fotograma siguiente. Si un fotograma se queda sin espacio, lo que falta se pide al
+ * montículo y en el Reset siguiente el bloque crece para que el caso no se repita.
+ */
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+/**
+ * @class FrameArena
+ * @brief Asignador lineal que se vacía entero en cada fotograma.
+ */
+class FrameArena {
+public:
+    explicit FrameArena(size_t capacity = 1 << 20);
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    /// Devuelve memoria sin inicializar válida hasta el próximo Reset. alignment debe ser potencia de dos.
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    /// Espacio para count objetos de T, sin construir. T debe poder destruirse trivialmente.
+    template<typename T>
+    T* AllocateArray(size_t count)
+    {
+        return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    /**
+     * @brief Recupera toda la memoria del fotograma anterior.
+     *
+     * No puede coincidir con ningún Allocate. Si hubo desbordamiento, el bloque crece a vez y
+     * media lo usado en el fotograma, desbordamiento incluido, para dejar margen al siguiente.
+     */
+    void Reset();
+
+    size_t Capacity() const { return capacity; }
+
+    /// Bytes usados del bloque en el fotograma actual, sin contar el desbordamiento.
+    size_t Used() const { return offset.load(std::memory_order_relaxed); }
+
+    /// Mayor uso de un fotograma, desbordamiento incluido.
+    size_t HighWater() const { return highWater; }
+
+    /// Veces que el bloque ha tenido que crecer.
+    uint32_t GrowCount() const { return growCount; }
+
+private:
+    std::unique_ptr<uint8_t[]>              buffer;
+    size_t                                  capacity;
+    std::atomic<size_t>                     offset{ 0 };
+    std::mutex                              overflowMutex; ///< Protege overflowBlocks y overflowBytes
+    std::vector<std::unique_ptr<uint8_t[]>> overflowBlocks; ///< Memoria pedida al montículo al llenarse el bloque
+    size_t                                  overflowBytes = 0;
+    size_t                                  highWater = 0;
+    uint32_t                                growCount = 0;
+};
+
+/**
+ * @class FrameArenaAllocator
+ * @brief Adaptador para usar una FrameArena con contenedores de la biblioteca estándar.
+ *
+ * deallocate no hace nada: la memoria se recupera en el Reset de la arena, así que el
+ * contenedor no debe sobrevivir al fotograma.
+ */
+template<typename T>
+class FrameArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit FrameArenaAllocator(FrameArena& arena) : arena(&arena) {}
+
+    template<typename U>
+    FrameArenaAllocator(const FrameArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t count) { return arena->AllocateArray<T>(count); }
+    void deallocate(T*, size_t) {}
+
+    template<typename U>
+    bool operator==(const FrameArenaAllocator<U>& other) const { return arena == other.arena; }
+    template<typename U>
+    bool operator!=(const FrameArenaAllocator<U>& other) const { return arena != other.arena; }
+
+private:
+    template<typename U>
+    friend class FrameArenaAllocator;
+
+    FrameArena* arena;
+};
+
+/// Vector cuya memoria sale de una FrameArena.
+template<typename T>
+using FrameVector = std::vector<T, FrameArenaAllocator<T>>;
@@ -0,0 +1,209 @@
+﻿/**
+ * @file FramePacer.cpp
+ * @brief Implementación del controlador de ritmo de fotogramas.
+ */
+
+#include "pch.h"
+#include "FramePacer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr double PredictorWeight = 1.0 / 8.0;
+    constexpr int64_t MarginDecayDivisor = 32;  ///< Un fotograma a tiempo quita 1/32 del margen sobrante
+
+    /// División redondeando hacia menos infinito, también con numerador negativo.
+    int64_t FloorDiv(int64_t value, int64_t divisor)
+    {
+        int64_t quotient = value / divisor;
+        return (value % divisor != 0 && (value < 0) != (divisor < 0)) ? quotient - 1 : quotient;
+    }
+}
+
+void FrameTimePredictor::Add(int64_t sample)
+{
+    double value = static_cast<double>(sample);
+    if (!primed)
+    {
+        mean = value;
+        deviation = 0.0;
+        primed = true;
+        return;
+    }
+    deviation += (std::fabs(value - mean) - deviation) * PredictorWeight;
+    mean += (value - mean) * PredictorWeight;
+}
+
+int64_t FrameTimePredictor::Predict() const
+{
+    return primed ? static_cast<int64_t>(std::ceil(mean + 2.0 * deviation)) : 0;
+}
+
+FramePacer::FramePacer(const FramePacerConfig& config)
+    : config(config), refreshPeriod(config.refreshPeriod), periodEstimate(static_cast<double>(config.refreshPeriod)), margin(config.minMargin)
+{
+}
+
+const char* FramePacer::ModeName(FramePacingMode mode)
+{
+    switch (mode)
+    {
+    case FramePacingMode::Unpaced: return "Unpaced";
+    case FramePacingMode::LowLatency: return "LowLatency";
+    case FramePacingMode::LatencyCapped: return "LatencyCapped";
+    default: return "?";
+    }
+}
+
+void FramePacer::OnVsync(int64_t time, uint64_t refreshCount)
+{
+    if (haveVsync && refreshCount > vsyncCount && time > vsyncTime)
+    {
+        // Se descartan medidas a más del 25% del periodo actual: suelen ser saltos del contador.
+        double measured = static_cast<double>(time - vsyncTime) / static_cast<double>(refreshCount - vsyncCount);
+        if (measured > periodEstimate * 0.75 && measured < periodEstimate * 1.25)
+        {
+            periodEstimate += (measured - periodEstimate) * PredictorWeight;
+            refreshPeriod = std::llround(periodEstimate);
+        }
+    }
+    vsyncTime = time;
+    vsyncCount = refreshCount;
+    haveVsync = true;
+}
+
+int64_t FramePacer::NextVsync(int64_t time) const
+{
+    int64_t periods = FloorDiv(time - vsyncTime + refreshPeriod - 1, refreshPeriod);
+    return vsyncTime + periods * refreshPeriod;
+}
+
+uint32_t FramePacer::ChooseInterval(int64_t cpu, int64_t gpu)
+{
+    if (config.mode == FramePacingMode::Unpaced) return 1;
+
+    // Con CPU y GPU solapadas, el ritmo lo marca la más lenta de las dos. El margen solo adelanta
+    // el inicio, no limita cuántos fotogramas caben.
+    int64_t cost = (std::max)(cpu, gpu);
+    uint32_t needed = static_cast<uint32_t>((std::max<int64_t>)(1, (cost + refreshPeriod - 1) / refreshPeriod));
+    needed = (std::min)(needed, config.maxInterval);
+
+    // Subir es inmediato para no perder vsyncs; bajar espera a que sobre tiempo varios fotogramas seguidos.
+    if (needed >= interval)
+    {
+        interval = needed;
+        framesBelowInterval = 0;
+    }
+    else if (++framesBelowInterval >= config.intervalHoldFrames)
+    {
+        interval = needed;
+        framesBelowInterval = 0;
+    }
+    return interval;
+}
+
+FramePlan FramePacer::Plan(int64_t now)
+{
+    FramePlan plan;
+    plan.frame = nextFrame++;
+    plan.predictedCpu = cpuTime.Predict();
+    plan.predictedGpu = gpuTime.Predict();
+
+    if (config.mode == FramePacingMode::LatencyCapped)
+    {
+        margin = (std::min)(margin, (std::max<int64_t>)(0, config.latencyCap - plan.predictedCpu - plan.predictedGpu));
+    }
+    plan.margin = config.mode == FramePacingMode::Unpaced ? 0 : margin;
+    plan.interval = ChooseInterval(plan.predictedCpu, plan.predictedGpu);
+
+    if (!haveVsync)
+    {
+        vsyncTime = now;
+        haveVsync = true;
+    }
+
+    // La vsync más temprana que el fotograma puede alcanzar y, si ya hay uno en cola, no antes de su turno.
+    int64_t gpuStart = (std::max)(now + plan.predictedCpu, gpuFree);
+    plan.target = NextVsync(gpuStart + plan.predictedGpu + plan.margin);
+    if (lastTarget != 0)
+    {
+        // Se redondea a la vsync más cercana: si el periodo o la fase se han corregido desde el último
+        // objetivo, sumarle periodos sin más dejaría los siguientes fuera de la rejilla para siempre.
+        int64_t turn = NextVsync(lastTarget + static_cast<int64_t>(plan.interval) * refreshPeriod - refreshPeriod / 2);
+        plan.target = (std::max)(plan.target, turn);
+    }
+
+    if (config.mode == FramePacingMode::Unpaced)
+    {
+        plan.start = now;
+    }
+    else
+    {
+        // Lo más tarde posible: la GPU acaba margin antes de la vsync. El objetivo ya deja la GPU libre a tiempo.
+        plan.start = (std::max)(now, plan.target - plan.margin - plan.predictedGpu - plan.predictedCpu);
+    }
+
+    gpuFree = (std::max)(plan.start + plan.predictedCpu, gpuFree) + plan.predictedGpu;
+    lastTarget = plan.target;
+    stats.waitTotal += plan.start - now;
+    plans[plan.frame % PlanHistory] = plan;
+    return plan;
+}
+
+void FramePacer::CompleteFrame(const FrameTiming& timing)
+{
+    cpuTime.Add(timing.cpuEnd - timing.start);
+    int64_t end = timing.cpuEnd;
+    if (timing.gpuEnd != 0)
+    {
+        gpuTime.Add(timing.gpuEnd - timing.gpuStart);
+        end = timing.gpuEnd;
+    }
+
+    const FramePlan& plan = plans[timing.frame % PlanHistory];
+    if (plan.frame != timing.frame) return;
+
+    // Sin predicciones el plan no podía acertar; no debe inflar el margen.
+    bool predicted = plan.predictedCpu != 0 || plan.predictedGpu != 0;
+
+    // Sin la vsync real, el fotograma se ve en la primera tras acabar, nunca antes de su objetivo ni del anterior.
+    int64_t displayed = timing.displayed;
+    if (displayed == 0)
+    {
+        displayed = (std::max)(NextVsync(end), plan.target);
+        if (lastDisplayed != 0)
+        {
+            displayed = (std::max)(displayed, lastDisplayed + refreshPeriod);
+        }
+    }
+    lastDisplayed = displayed;
+
+    int64_t latency = displayed - timing.start;
+    stats.frames++;
+    stats.latencyTotal += latency;
+    stats.latencyMax = (std::max)(stats.latencyMax, latency);
+
+    // Media vsync de tolerancia: la vsync real y la de la rejilla no coinciden al microsegundo.
+    if (displayed > plan.target + refreshPeriod / 2)
+    {
+        stats.missedVsyncs++;
+
+        // Los fotogramas ya planificados detrás de este se verán con el mismo retraso. Se desplaza
+        // una vez la rejilla de objetivos para vaciar la cola; sus fallos ya no cuentan para el margen.
+        if (timing.frame <= recoveredThrough) return;
+        recoveredThrough = nextFrame - 1;
+        lastTarget += displayed - plan.target;
+        gpuFree = (std::max)(gpuFree, end);
+
+        // Se recupera lo que faltó y un margen mínimo más.
+        if (predicted)
+        {
+            margin = (std::min)(config.maxMargin, margin + (std::max<int64_t>)(0, end - (plan.target - plan.margin)) + config.minMargin);
+        }
+    }
+    else if (margin > config.minMargin)
+    {
+        margin -= (std::max<int64_t>)(1, (margin - config.minMargin) / MarginDecayDivisor);
+    }
+}
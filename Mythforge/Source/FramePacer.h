@@ -0,0 +1,151 @@
+﻿/**
+ * @file FramePacer.h
+ * @brief Controlador de ritmo de fotogramas: cuándo empezar cada uno para llegar a su vsync con la menor latencia.
+ *
+ * El controlador predice el tiempo de CPU y de GPU del fotograma siguiente (media móvil más dos
+ * desviaciones) y, sobre la rejilla de vsyncs de la pantalla, elige la vsync objetivo y el
+ * instante más tardío en que puede empezar a leer la entrada y grabar para no perderla. Entre
+ * la vsync prevista y la real deja un margen que crece cuando un fotograma llega tarde y se
+ * reduce poco a poco mientras todos llegan a tiempo.
+ *
+ * No mide nada ni duerme: recibe tiempos en microsegundos de un reloj monotónico cualquiera, de
+ * modo que con las mismas entradas toma siempre las mismas decisiones y puede probarse con una
+ * pantalla y una GPU simuladas. El Renderer le da los tiempos reales y espera lo que indique.
+ */
+
+#pragma once
+#include <cstdint>
+
+enum class FramePacingMode : uint32_t {
+    Unpaced,        ///< Empieza en cuanto hay búfer libre, como antes; la latencia crece con la cola
+    LowLatency,     ///< Justo a tiempo; el margen crece lo necesario para no perder vsyncs
+    LatencyCapped,  ///< Justo a tiempo, pero el margen nunca lleva la latencia prevista por encima del tope
+    Count
+};
+
+/**
+ * @struct FramePacerConfig
+ * @brief Parámetros del controlador. Los tiempos van en microsegundos.
+ */
+struct FramePacerConfig {
+    FramePacingMode mode = FramePacingMode::LowLatency;
+    int64_t         refreshPeriod = 16667;  ///< Valor inicial; OnVsync lo corrige con lo medido
+    int64_t         latencyCap = 33333;     ///< Latencia máxima de entrada a imagen en LatencyCapped
+    int64_t         minMargin = 500;
+    int64_t         maxMargin = 8000;
+    uint32_t        maxInterval = 4;        ///< Vsyncs máximos entre presentaciones
+    uint32_t        intervalHoldFrames = 30; ///< Fotogramas seguidos que debe sobrar tiempo antes de bajar el intervalo
+};
+
+/**
+ * @struct FramePlan
+ * @brief Decisión para un fotograma.
+ */
+struct FramePlan {
+    uint64_t frame = 0;
+    int64_t  start = 0;             ///< Cuándo empezar a leer la entrada y grabar
+    int64_t  target = 0;            ///< Vsync en la que debería verse
+    uint32_t interval = 1;          ///< Intervalo de sincronización para Present
+    int64_t  predictedCpu = 0;
+    int64_t  predictedGpu = 0;
+    int64_t  margin = 0;
+};
+
+/**
+ * @struct FrameTiming
+ * @brief Lo que tardó de verdad un fotograma planificado; puede llegar unos fotogramas después.
+ */
+struct FrameTiming {
+    uint64_t frame = 0;
+    int64_t  start = 0;             ///< Cuándo empezó realmente
+    int64_t  cpuEnd = 0;            ///< Envío a la cola
+    int64_t  gpuStart = 0;          ///< 0 si no se conoce; entonces solo cuenta la CPU
+    int64_t  gpuEnd = 0;
+    int64_t  displayed = 0;         ///< Vsync en que se mostró; con 0 se deduce de gpuEnd y del objetivo
+};
+
+/**
+ * @struct FramePacerStats
+ * @brief Resultado acumulado de los fotogramas completados.
+ */
+struct FramePacerStats {
+    uint64_t frames = 0;
+    uint64_t missedVsyncs = 0;      ///< Fotogramas mostrados después de su objetivo
+    int64_t  latencyTotal = 0;      ///< Suma de inicio a imagen
+    int64_t  latencyMax = 0;
+    int64_t  waitTotal = 0;         ///< Tiempo que los planes mandaron esperar
+
+    double AverageLatencyMs() const { return frames ? static_cast<double>(latencyTotal) / frames / 1000.0 : 0.0; }
+};
+
+/**
+ * @class FrameTimePredictor
+ * @brief Media y desviación absoluta media exponenciales de una duración.
+ */
+class FrameTimePredictor {
+public:
+    void Add(int64_t sample);
+
+    /// Media más dos desviaciones; 0 sin muestras.
+    int64_t Predict() const;
+
+private:
+    double mean = 0.0;
+    double deviation = 0.0;
+    bool   primed = false;
+};
+
+/**
+ * @class FramePacer
+ * @brief Decide el inicio y el intervalo de cada fotograma a partir de los tiempos medidos.
+ */
+class FramePacer {
+public:
+    explicit FramePacer(const FramePacerConfig& config = FramePacerConfig());
+
+    void SetMode(FramePacingMode mode) { config.mode = mode; }
+    FramePacingMode Mode() const { return config.mode; }
+    const FramePacerConfig& Config() const { return config; }
+
+    /// Vsync observada; con dos o más se estima el periodo de refresco.
+    void OnVsync(int64_t time, uint64_t refreshCount);
+    int64_t RefreshPeriod() const { return refreshPeriod; }
+
+    /// Plan del fotograma siguiente. Quien llama espera hasta start antes de leer la entrada.
+    FramePlan Plan(int64_t now);
+
+    /// Tiempos reales de un fotograma ya planificado.
+    void CompleteFrame(const FrameTiming& timing);
+
+    const FramePacerStats& Stats() const { return stats; }
+    void ResetStats() { stats = FramePacerStats(); }
+
+    /// Primera vsync de la rejilla en o después de time.
+    int64_t NextVsync(int64_t time) const;
+
+    static const char* ModeName(FramePacingMode mode);
+
+private:
+    static constexpr uint32_t PlanHistory = 8; ///< Planes recordados para casar con tiempos que llegan tarde
+
+    uint32_t ChooseInterval(int64_t cpu, int64_t gpu);
+
+    FramePacerConfig   config;
+    FrameTimePredictor cpuTime;
+    FrameTimePredictor gpuTime;
+    int64_t            refreshPeriod;
+    double             periodEstimate;          ///< refreshPeriod sin redondear
+    int64_t            vsyncTime = 0;           ///< Una vsync conocida, origen de la rejilla
+    uint64_t           vsyncCount = 0;
+    bool               haveVsync = false;
+    int64_t            margin;
+    uint32_t           interval = 1;
+    uint32_t           framesBelowInterval = 0;
+    int64_t            gpuFree = 0;             ///< Fin previsto de la GPU con lo ya planificado
+    int64_t            lastTarget = 0;
+    int64_t            lastDisplayed = 0;
+    uint64_t           nextFrame = 1;
+    uint64_t           recoveredThrough = 0;    ///< Último fotograma planificado cuando se recuperó el último fallo
+    FramePlan          plans[PlanHistory];
+    FramePacerStats    stats;
+};
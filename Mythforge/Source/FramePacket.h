@@ -0,0 +1,57 @@
+﻿/**
+ * @file FramePacket.h
+ * @brief Todo lo que el hilo de juego prepara para que el hilo de render grabe un fotograma.
+ *
+ * Una vez entregado a RenderThread, el paquete es inmutable para el hilo de juego: el hilo de
+ * render solo lee de él y escribe en la parte de resultados, que el hilo de juego lee cuando lo
+ * vuelve a tomar. Cada paquete tiene su propia FrameArena, porque la lista de dibujado del
+ * fotograma que se graba sigue viva mientras se prepara la del siguiente.
+ */
+
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include "AllocationTracker.h"
+#include "DrawQueue.h"
+#include "DynamicResolution.h"
+#include "FrameArena.h"
+#include "Scene.h"
+
+using namespace DirectX;
+
+/**
+ * @struct RenderRequests
+ * @brief Cambios de estado del renderer pedidos desde el hilo de juego (ventana y teclado).
+ *
+ * El renderer solo se toca desde el hilo de render: los eventos de la ventana se anotan aquí y
+ * viajan con el paquete siguiente.
+ */
+struct RenderRequests {
+    bool           resize = false;
+    ResolutionSize outputSize;                  ///< Tamaño nuevo de la salida si resize
+    bool           toggleDynamicResolution = false;
+    bool           toggleStateFiltering = false;
+    uint32_t       pacingModeSteps = 0;         ///< Veces que se avanza el modo del FramePacer
+    uint32_t       captureFrames = 0;           ///< Si no es 0, se captura a partir de este fotograma
+};
+
+/**
+ * @struct FramePacket
+ * @brief Vista, lista de dibujado ordenada y peticiones de un fotograma.
+ */
+struct FramePacket {
+    static constexpr uint32_t StatusLength = 224;
+
+    // Lo escribe el hilo de juego antes de Submit.
+    uint64_t           frame = 0;
+    XMFLOAT4X4         viewProjection;
+    FrameArena         arena;                   ///< Memoria de drawList
+    DrawList           drawList;
+    DrawQueue          drawQueue;               ///< Orden de dibujado de drawList
+    RenderRequests     requests;
+    AllocationCounters allocations;             ///< Asignaciones de CPU mientras se preparaba
+
+    // Lo escribe el hilo de render; el hilo de juego lo lee al volver a tomar el paquete.
+    bool               statusReady = false;
+    wchar_t            status[StatusLength] = {};   ///< Texto para la barra de título
+};
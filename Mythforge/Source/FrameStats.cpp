@@ -0,0 +1,138 @@
+﻿/**
+ * @file FrameStats.cpp
+ * @brief Implementación del historial de tiempos de fotograma.
+ */
+
+#include "pch.h"
+#include "FrameStats.h"
+#include <algorithm>
+#include <cmath>
+
+FrameStats::FrameStats(uint32_t capacity) :
+    frames(new float[(std::max)(capacity, 1u)]),
+    sorted(new float[(std::max)(capacity, 1u)]),
+    capacity((std::max)(capacity, 1u))
+{
+}
+
+void FrameStats::AddFrame(double frameMs)
+{
+    if (count == capacity)
+    {
+        sum -= frames[next];
+    }
+    else
+    {
+        count++;
+    }
+
+    frames[next] = static_cast<float>(frameMs);
+    sum += frames[next];
+    next = (next + 1) % capacity;
+
+    // La suma incremental acumula error de redondeo; se recalcula en cada vuelta del anillo.
+    if (next == 0)
+    {
+        sum = 0.0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            sum += frames[i];
+        }
+    }
+
+    totalFrames++;
+    if (frameMs > hitchBudgetMs)
+    {
+        totalHitches++;
+    }
+}
+
+void FrameStats::Reset()
+{
+    next = 0;
+    count = 0;
+    sum = 0.0;
+    totalFrames = 0;
+    totalHitches = 0;
+}
+
+FrameStatsSummary FrameStats::Summarize() const
+{
+    FrameStatsSummary summary;
+    summary.frameCount = count;
+    if (count == 0)
+    {
+        return summary;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        sorted[i] = frames[i];
+        if (frames[i] > hitchBudgetMs)
+        {
+            summary.hitchCount++;
+        }
+    }
+    std::sort(sorted.get(), sorted.get() + count);
+
+    // Percentil por rango más cercano: el menor valor que deja por debajo al menos p * count fotogramas.
+    auto percentile = [this](double p) {
+        uint32_t rank = static_cast<uint32_t>(std::ceil(p * count));
+        return static_cast<double>(sorted[(std::max)(rank, 1u) - 1]);
+    };
+
+    summary.meanMs = sum / count;
+    summary.minMs = sorted[0];
+    summary.maxMs = sorted[count - 1];
+    summary.p50Ms = percentile(0.50);
+    summary.p95Ms = percentile(0.95);
+    summary.p99Ms = percentile(0.99);
+    summary.p999Ms = percentile(0.999);
+    summary.averageFps = summary.meanMs > 0.0 ? 1000.0 / summary.meanMs : 0.0;
+
+    // 1% low: FPS medios del 1% de fotogramas más lentos (al menos uno).
+    uint32_t slowCount = (std::max)(count / 100, 1u);
+    double slowSum = 0.0;
+    for (uint32_t i = count - slowCount; i < count; i++)
+    {
+        slowSum += sorted[i];
+    }
+    summary.onePercentLowFps = slowSum > 0.0 ? 1000.0 * slowCount / slowSum : 0.0;
+    return summary;
+}
+
+void FrameStats::WriteCsv(std::ostream& stream) const
+{
+    stream << "frame,ms,hitch\n";
+    uint64_t firstFrame = totalFrames - count;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        float ms = Frame(i);
+        stream << firstFrame + i << ',' << ms << ',' << (ms > hitchBudgetMs ? 1 : 0) << '\n';
+    }
+}
+
+void FrameStats::WriteJson(std::ostream& stream) const
+{
+    FrameStatsSummary summary = Summarize();
+    stream << "{\"frameCount\":" << summary.frameCount
+           << ",\"meanMs\":" << summary.meanMs
+           << ",\"minMs\":" << summary.minMs
+           << ",\"maxMs\":" << summary.maxMs
+           << ",\"p50Ms\":" << summary.p50Ms
+           << ",\"p95Ms\":" << summary.p95Ms
+           << ",\"p99Ms\":" << summary.p99Ms
+           << ",\"p999Ms\":" << summary.p999Ms
+           << ",\"averageFps\":" << summary.averageFps
+           << ",\"onePercentLowFps\":" << summary.onePercentLowFps
+           << ",\"hitchBudgetMs\":" << hitchBudgetMs
+           << ",\"hitchCount\":" << summary.hitchCount
+           << ",\"totalFrames\":" << totalFrames
+           << ",\"totalHitches\":" << totalHitches
+           << ",\"framesMs\":[";
+    for (uint32_t i = 0; i < count; i++)
+    {
+        stream << (i ? "," : "") << Frame(i);
+    }
+    stream << "]}\n";
+}
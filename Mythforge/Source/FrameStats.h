@@ -0,0 +1,84 @@
+﻿/**
+ * @file FrameStats.h
+ * @brief Historial de tiempos de fotograma con percentiles, 1% low y detección de tirones.
+ *
+ * Los FPS medios esconden los tirones: un fotograma de 100 ms entre cien de 16 ms apenas mueve
+ * la media. FrameStats guarda los últimos fotogramas en un anillo y resume la ventana con
+ * percentiles y el 1% low (FPS medios del 1% de fotogramas más lentos). Toda la memoria se
+ * reserva al construirlo; AddFrame y Summarize no asignan.
+ */
+
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+/**
+ * @struct FrameStatsSummary
+ * @brief Resumen de la ventana de fotogramas.
+ */
+struct FrameStatsSummary {
+    uint32_t frameCount = 0;        ///< Fotogramas en la ventana
+    double   meanMs = 0.0;
+    double   minMs = 0.0;
+    double   maxMs = 0.0;
+    double   p50Ms = 0.0;
+    double   p95Ms = 0.0;
+    double   p99Ms = 0.0;
+    double   p999Ms = 0.0;
+    double   averageFps = 0.0;
+    double   onePercentLowFps = 0.0;
+    uint32_t hitchCount = 0;        ///< Fotogramas de la ventana por encima del presupuesto
+};
+
+class FrameStats {
+public:
+    static constexpr uint32_t DefaultCapacity = 1024;
+
+    explicit FrameStats(uint32_t capacity = DefaultCapacity);
+
+    /// Un fotograma que dura más que budgetMs cuenta como tirón. Por defecto, dos fotogramas a 60 Hz.
+    void SetHitchBudget(double budgetMs) { hitchBudgetMs = budgetMs; }
+    double HitchBudget() const { return hitchBudgetMs; }
+
+    /// Añade la duración de un fotograma. O(1).
+    void AddFrame(double frameMs);
+
+    /// Vacía la ventana y los contadores.
+    void Reset();
+
+    uint32_t Capacity() const { return capacity; }
+    uint32_t Count() const { return count; }
+
+    /// Media de la ventana, mantenida de forma incremental.
+    double RollingMeanMs() const { return count ? sum / count : 0.0; }
+
+    /// Duración del fotograma más reciente.
+    double LastFrameMs() const { return count ? frames[(next + capacity - 1) % capacity] : 0.0; }
+
+    /// Tirones desde el último Reset, incluidos los que ya han salido de la ventana.
+    uint64_t TotalHitches() const { return totalHitches; }
+    uint64_t TotalFrames() const { return totalFrames; }
+
+    /// Calcula percentiles y 1% low de la ventana ordenando una copia reservada de antemano.
+    FrameStatsSummary Summarize() const;
+
+    /// Una fila por fotograma de la ventana, del más antiguo al más reciente.
+    void WriteCsv(std::ostream& stream) const;
+
+    /// Resumen y duraciones de la ventana como objeto JSON.
+    void WriteJson(std::ostream& stream) const;
+
+private:
+    float Frame(uint32_t age) const { return frames[(next + capacity - count + age) % capacity]; }
+
+    std::unique_ptr<float[]>    frames;
+    std::unique_ptr<float[]>    sorted;         ///< Copia de trabajo de Summarize
+    uint32_t                    capacity;
+    uint32_t                    next = 0;
+    uint32_t                    count = 0;
+    double                      sum = 0.0;
+    double                      hitchBudgetMs = 2000.0 / 60.0;
+    uint64_t                    totalFrames = 0;
+    uint64_t                    totalHitches = 0;
+};
@@ -0,0 +1,146 @@
+﻿/**
+ * @file GpuProfiler.cpp
+ * @brief Implementación del perfilador de GPU sobre Direct3D 12.
+ */
+
+#include "pch.h"
+#include "GpuProfiler.h"
+#include "DirectXHelper.h"
+#include "d3dx12.h"
+#include "DeviceUtils.h"
+
+void GpuProfiler::Initialize(ID3D12Device* device, ID3D12CommandQueue* queue, uint32_t frameCount, uint32_t maxScopesPerFrame)
+{
+    this->queue = queue;
+    ring.Initialize(frameCount, maxScopesPerFrame);
+
+    D3D12_QUERY_HEAP_DESC heapDesc = {};
+    heapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+    heapDesc.Count = ring.TotalQueries();
+    DX::ThrowIfFailed(device->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(&queryHeap)));
+    queryHeap->SetName(L"GpuProfiler queryHeap");
+
+    CD3DX12_HEAP_PROPERTIES readbackHeap(D3D12_HEAP_TYPE_READBACK);
+    CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(uint64_t) * ring.TotalQueries());
+    DX::ThrowIfFailed(device->CreateCommittedResource(&readbackHeap, D3D12_HEAP_FLAG_NONE, &bufferDesc,
+        D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&readbackBuffer)));
+    readbackBuffer->SetName(L"GpuProfiler readbackBuffer");
+    TrackResource(readbackBuffer, MemoryCategory::Readback, "GpuProfiler readbackBuffer");
+
+    DX::ThrowIfFailed(queue->GetTimestampFrequency(&gpuFrequency));
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    cpuFrequency = static_cast<uint64_t>(frequency.QuadPart);
+
+    if (!track)
+    {
+        track = Profiler::CreateTrack("GPU");
+    }
+}
+
+void GpuProfiler::Destroy()
+{
+    queryHeap.Reset();
+    readbackBuffer.Reset();
+    queue.Reset();
+    recording = false;
+}
+
+GpuClockCalibration GpuProfiler::Calibrate() const
+{
+    GpuClockCalibration calibration;
+    calibration.gpuFrequency = gpuFrequency;
+
+    // GetClockCalibration relaciona la GPU con QueryPerformanceCounter; la segunda lectura pasa de QPC al reloj del perfilador.
+    uint64_t cpuTimestamp = 0;
+    if (FAILED(queue->GetClockCalibration(&calibration.gpuTimestamp, &cpuTimestamp)))
+    {
+        return calibration;
+    }
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    uint64_t profilerNow = Profiler::Now();
+
+    calibration.cpuTicksPerMicrosecond = Profiler::TicksPerMicrosecond();
+    double elapsedMicroseconds = static_cast<double>(static_cast<uint64_t>(now.QuadPart) - cpuTimestamp) * 1e6 / static_cast<double>(cpuFrequency);
+    calibration.cpuTicks = profilerNow - static_cast<uint64_t>(elapsedMicroseconds * calibration.cpuTicksPerMicrosecond);
+    return calibration;
+}
+
+void GpuProfiler::ReadBack(uint32_t slot)
+{
+    const uint32_t first = ring.FirstQuery(slot);
+    D3D12_RANGE readRange = { sizeof(uint64_t) * first, sizeof(uint64_t) * (first + ring.QueriesPerFrame()) };
+    void* data = nullptr;
+    DX::ThrowIfFailed(readbackBuffer->Map(0, &readRange, &data));
+    const std::vector<GpuScopeTiming>& timings = ring.Resolve(slot, static_cast<const uint64_t*>(data) + first);
+    D3D12_RANGE writtenRange = { 0, 0 };
+    readbackBuffer->Unmap(0, &writtenRange);
+
+    for (const GpuScopeTiming& timing : timings)
+    {
+        Profiler::RecordZone(track, timing.name, timing.cpuStart, timing.cpuEnd, timing.depth);
+    }
+}
+
+bool GpuProfiler::BeginFrame(ID3D12GraphicsCommandList* commandList, uint32_t slot)
+{
+    if (!queryHeap) return false;
+
+    bool readBack = ring.IsPending(slot);
+    if (readBack)
+    {
+        ReadBack(slot);
+    }
+
+    frameSlot = slot;
+    recording = true;
+    ring.BeginFrame(slot, Calibrate());
+    BeginScope(commandList, "GPU Frame");
+    return readBack;
+}
+
+void GpuProfiler::BeginScope(ID3D12GraphicsCommandList* commandList, const char* name)
+{
+    if (!recording) return;
+
+#if defined(MYTHFORGE_PROFILER_PIX)
+    PIXBeginEvent(commandList, 0, name);
+#endif
+    uint32_t query = ring.BeginScope(name);
+    if (query != GpuTimestampRing::InvalidQuery)
+    {
+        commandList->EndQuery(queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, query);
+    }
+}
+
+void GpuProfiler::EndScope(ID3D12GraphicsCommandList* commandList)
+{
+    if (!recording) return;
+
+    uint32_t query = ring.EndScope();
+    if (query != GpuTimestampRing::InvalidQuery)
+    {
+        commandList->EndQuery(queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, query);
+    }
+#if defined(MYTHFORGE_PROFILER_PIX)
+    PIXEndEvent(commandList);
+#endif
+}
+
+void GpuProfiler::EndFrame(ID3D12GraphicsCommandList* commandList)
+{
+    if (!recording) return;
+
+    EndScope(commandList);
+    recording = false;
+
+    uint32_t queryCount = ring.EndFrame();
+    if (queryCount > 0)
+    {
+        uint32_t first = ring.FirstQuery(frameSlot);
+        commandList->ResolveQueryData(queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, first, queryCount,
+            readbackBuffer.Get(), sizeof(uint64_t) * first);
+    }
+}
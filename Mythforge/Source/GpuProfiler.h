@@ -0,0 +1,91 @@
+﻿/**
+ * @file GpuProfiler.h
+ * @brief Perfilador de GPU con consultas de timestamp y lectura asíncrona por fotograma.
+ *
+ * Los ámbitos escriben un timestamp al empezar y otro al terminar en la lista de comandos. Al
+ * final del fotograma las consultas se resuelven en un búfer de lectura con un hueco por
+ * fotograma en vuelo; el hueco se lee cuando vuelve a tocarle, después de que Renderer haya
+ * esperado su fence, así que nunca se detiene la CPU para leer resultados. Los ámbitos
+ * resueltos se añaden a la pista "GPU" del perfilador de CPU, alineados con su línea de tiempo.
+ */
+
+#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+#include <vector>
+#include "GpuTimestampRing.h"
+#include "Profiler.h"
+
+class GpuProfiler {
+public:
+    /**
+     * @brief Crea el heap de consultas y el búfer de lectura.
+     * @param frameCount Fotogramas en vuelo; cada uno usa su propio hueco.
+     */
+    void Initialize(ID3D12Device* device, ID3D12CommandQueue* queue, uint32_t frameCount, uint32_t maxScopesPerFrame = 64);
+    void Destroy();
+
+    /**
+     * @brief Lee los resultados anteriores del hueco y empieza a grabar el fotograma.
+     *
+     * Debe llamarse con la lista ya reiniciada y cuando la GPU haya terminado el fotograma que
+     * usó antes ese hueco, igual que su command allocator.
+     * @return true si se leyeron resultados; LastFrame es entonces el fotograma que usó el hueco.
+     */
+    bool BeginFrame(ID3D12GraphicsCommandList* commandList, uint32_t frameSlot);
+
+    void BeginScope(ID3D12GraphicsCommandList* commandList, const char* name);
+    void EndScope(ID3D12GraphicsCommandList* commandList);
+
+    /// Cierra el ámbito del fotograma y resuelve sus consultas en el búfer de lectura.
+    void EndFrame(ID3D12GraphicsCommandList* commandList);
+
+    /// Ámbitos del último fotograma leído, con unos fotogramas de retraso.
+    const std::vector<GpuScopeTiming>& LastFrame() const { return ring.LastFrame(); }
+    double LastFrameMs() const { return ring.LastFrameMs(); }
+
+private:
+    GpuClockCalibration Calibrate() const;
+    void ReadBack(uint32_t frameSlot);
+
+    Microsoft::WRL::ComPtr<ID3D12QueryHeap>     queryHeap;
+    Microsoft::WRL::ComPtr<ID3D12Resource>      readbackBuffer;
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue>  queue;
+    GpuTimestampRing                            ring;
+    ProfilerTrack*                              track = nullptr;
+    uint64_t                                    gpuFrequency = 1;
+    uint64_t                                    cpuFrequency = 1;   ///< Ticks por segundo de QueryPerformanceCounter
+    uint32_t                                    frameSlot = 0;
+    bool                                        recording = false;
+};
+
+/**
+ * @class GpuProfileScope
+ * @brief Ámbito de GPU ligado a la vida del objeto.
+ */
+class GpuProfileScope {
+public:
+    GpuProfileScope(GpuProfiler& profiler, ID3D12GraphicsCommandList* commandList, const char* name)
+        : profiler(profiler), commandList(commandList)
+    {
+        profiler.BeginScope(commandList, name);
+    }
+
+    ~GpuProfileScope()
+    {
+        profiler.EndScope(commandList);
+    }
+
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+    GpuProfiler&                profiler;
+    ID3D12GraphicsCommandList*  commandList;
+};
+
+#if MYTHFORGE_PROFILER
+#define PROFILE_GPU_SCOPE(profiler, commandList, name) GpuProfileScope MYTHFORGE_PROFILE_CONCAT(gpuProfileScope, __LINE__)(profiler, commandList, name)
+#else
+#define PROFILE_GPU_SCOPE(profiler, commandList, name) ((void)0)
+#endif
@@ -0,0 +1,122 @@
+﻿/**
+ * @file GpuTimestampRing.cpp
+ * @brief Implementación del anillo de consultas de timestamp.
+ */
+
+#include "pch.h"
+#include "GpuTimestampRing.h"
+#include <algorithm>
+#include <cassert>
+
+uint64_t GpuToCpuTicks(const GpuClockCalibration& calibration, uint64_t gpuTimestamp)
+{
+    // Diferencia con signo: los timestamps pueden ser anteriores a la calibración.
+    double gpuMicroseconds = static_cast<double>(static_cast<int64_t>(gpuTimestamp - calibration.gpuTimestamp)) * 1e6 /
+                             static_cast<double>(calibration.gpuFrequency);
+    return calibration.cpuTicks + static_cast<int64_t>(gpuMicroseconds * calibration.cpuTicksPerMicrosecond);
+}
+
+void GpuTimestampRing::Initialize(uint32_t frameCount, uint32_t maxScopesPerFrame)
+{
+    this->frameCount = frameCount;
+    queriesPerFrame = 2 * maxScopesPerFrame;
+    frames.assign(frameCount, Frame());
+    for (Frame& frame : frames)
+    {
+        frame.scopes.reserve(maxScopesPerFrame);
+    }
+    openScopes.reserve(maxScopesPerFrame);
+    resolved.reserve(maxScopesPerFrame);
+}
+
+void GpuTimestampRing::BeginFrame(uint32_t frameSlot, const GpuClockCalibration& calibration)
+{
+    assert(frameSlot < frameCount && !frames[frameSlot].pending);
+
+    currentSlot = frameSlot;
+    Frame& frame = frames[frameSlot];
+    frame.scopes.clear();
+    frame.calibration = calibration;
+    frame.queryCount = 0;
+    openScopes.clear();
+}
+
+uint32_t GpuTimestampRing::BeginScope(const char* name)
+{
+    Frame& frame = frames[currentSlot];
+    uint32_t depth = static_cast<uint32_t>(openScopes.size());
+
+    // Se reservan las dos consultas a la vez para que todo ámbito abierto pueda cerrarse.
+    if (frame.queryCount + 2 > queriesPerFrame)
+    {
+        openScopes.push_back(InvalidQuery);
+        return InvalidQuery;
+    }
+
+    uint32_t beginQuery = frame.queryCount++;
+    uint32_t endQuery = frame.queryCount++;
+    openScopes.push_back(static_cast<uint32_t>(frame.scopes.size()));
+    frame.scopes.push_back(Scope{ name, beginQuery, endQuery, depth });
+    return FirstQuery(currentSlot) + beginQuery;
+}
+
+uint32_t GpuTimestampRing::EndScope()
+{
+    assert(!openScopes.empty());
+
+    uint32_t scope = openScopes.back();
+    openScopes.pop_back();
+    if (scope == InvalidQuery)
+    {
+        return InvalidQuery;
+    }
+    return FirstQuery(currentSlot) + frames[currentSlot].scopes[scope].endQuery;
+}
+
+uint32_t GpuTimestampRing::EndFrame()
+{
+    assert(openScopes.empty());
+
+    Frame& frame = frames[currentSlot];
+    frame.pending = frame.queryCount > 0;
+    return frame.queryCount;
+}
+
+const std::vector<GpuScopeTiming>& GpuTimestampRing::Resolve(uint32_t frameSlot, const uint64_t* timestamps)
+{
+    Frame& frame = frames[frameSlot];
+    frame.pending = false;
+    resolved.clear();
+    lastFrameMs = 0.0;
+    if (frame.scopes.empty())
+    {
+        return resolved;
+    }
+
+    uint64_t first = UINT64_MAX;
+    uint64_t last = 0;
+    for (uint32_t i = 0; i < frame.queryCount; i++)
+    {
+        first = (std::min)(first, timestamps[i]);
+        last = (std::max)(last, timestamps[i]);
+    }
+
+    const double msPerTick = 1000.0 / static_cast<double>(frame.calibration.gpuFrequency);
+    for (const Scope& scope : frame.scopes)
+    {
+        uint64_t begin = timestamps[scope.beginQuery];
+        // Un final anterior al inicio solo puede venir de una consulta no escrita: se toma duración cero.
+        uint64_t end = (std::max)(begin, timestamps[scope.endQuery]);
+
+        GpuScopeTiming timing;
+        timing.name = scope.name;
+        timing.depth = scope.depth;
+        timing.startMs = static_cast<double>(begin - first) * msPerTick;
+        timing.durationMs = static_cast<double>(end - begin) * msPerTick;
+        timing.cpuStart = GpuToCpuTicks(frame.calibration, begin);
+        timing.cpuEnd = GpuToCpuTicks(frame.calibration, end);
+        resolved.push_back(timing);
+    }
+    lastFrameMs = static_cast<double>(last - first) * msPerTick;
+    return resolved;
+}
@@ -0,0 +1,114 @@
+﻿/**
+ * @file GpuTimestampRing.h
+ * @brief Reparto de consultas de timestamp por fotograma y resolución de sus resultados.
+ *
+ * Esta parte del perfilador de GPU no toca Direct3D: asigna los índices de consulta de cada
+ * ámbito dentro de un anillo de fotogramas y, cuando llegan los timestamps leídos de la GPU,
+ * los convierte en milisegundos y en ticks del perfilador de CPU. Se puede alimentar con
+ * timestamps sintéticos para comprobar el emparejamiento y las conversiones.
+ */
+
+#pragma once
+#include <cstdint>
+#include <vector>
+
+/**
+ * @struct GpuClockCalibration
+ * @brief Lectura simultánea del reloj de la GPU y del reloj del perfilador de CPU.
+ */
+struct GpuClockCalibration {
+    uint64_t gpuTimestamp = 0;
+    uint64_t gpuFrequency = 1;              ///< Ticks de GPU por segundo
+    uint64_t cpuTicks = 0;                  ///< Profiler::Now() en el mismo instante
+    double   cpuTicksPerMicrosecond = 1.0;
+};
+
+/// Pasa un timestamp de GPU al reloj del perfilador de CPU.
+uint64_t GpuToCpuTicks(const GpuClockCalibration& calibration, uint64_t gpuTimestamp);
+
+/**
+ * @struct GpuScopeTiming
+ * @brief Duración de un ámbito de GPU ya resuelto.
+ */
+struct GpuScopeTiming {
+    const char* name;
+    uint32_t    depth;
+    double      startMs;    ///< Desde el primer timestamp del fotograma
+    double      durationMs;
+    uint64_t    cpuStart;   ///< Inicio en ticks del perfilador de CPU
+    uint64_t    cpuEnd;
+};
+
+/**
+ * @class GpuTimestampRing
+ * @brief Anillo de fotogramas con las consultas de timestamp de cada uno.
+ *
+ * Cada fotograma en vuelo ocupa un hueco con 2 * maxScopesPerFrame consultas consecutivas. Un
+ * hueco solo se reutiliza después de resolverlo, cuando la GPU ya ha terminado ese fotograma.
+ */
+class GpuTimestampRing {
+public:
+    static constexpr uint32_t InvalidQuery = UINT32_MAX;
+
+    void Initialize(uint32_t frameCount, uint32_t maxScopesPerFrame);
+
+    uint32_t FrameCount() const { return frameCount; }
+    uint32_t QueriesPerFrame() const { return queriesPerFrame; }
+    uint32_t TotalQueries() const { return frameCount * queriesPerFrame; }
+
+    /// Primera consulta del hueco; los resultados del hueco empiezan en ese índice.
+    uint32_t FirstQuery(uint32_t frameSlot) const { return frameSlot * queriesPerFrame; }
+
+    /// Empieza a grabar el fotograma en el hueco indicado, que no debe tener resultados pendientes.
+    void BeginFrame(uint32_t frameSlot, const GpuClockCalibration& calibration);
+
+    /**
+     * @brief Abre un ámbito y devuelve la consulta que debe marcar su inicio.
+     * @return InvalidQuery si el fotograma ya no tiene consultas libres; el ámbito se ignora.
+     */
+    uint32_t BeginScope(const char* name);
+
+    /// Cierra el ámbito abierto más reciente y devuelve la consulta de su final (o InvalidQuery).
+    uint32_t EndScope();
+
+    /// Termina el fotograma. Devuelve cuántas consultas se usaron desde FirstQuery.
+    uint32_t EndFrame();
+
+    /// Indica si el hueco tiene consultas grabadas que aún no se han resuelto.
+    bool IsPending(uint32_t frameSlot) const { return frameSlot < frames.size() && frames[frameSlot].pending; }
+
+    /**
+     * @brief Convierte los timestamps del hueco en tiempos por ámbito.
+     * @param timestamps Resultados de las consultas del hueco, empezando por FirstQuery.
+     */
+    const std::vector<GpuScopeTiming>& Resolve(uint32_t frameSlot, const uint64_t* timestamps);
+
+    /// Tiempos del último fotograma resuelto.
+    const std::vector<GpuScopeTiming>& LastFrame() const { return resolved; }
+
+    /// Duración en GPU del último fotograma resuelto, del primer al último timestamp.
+    double LastFrameMs() const { return lastFrameMs; }
+
+private:
+    struct Scope {
+        const char* name;
+        uint32_t    beginQuery;     ///< Relativas a FirstQuery
+        uint32_t    endQuery;
+        uint32_t    depth;
+    };
+
+    struct Frame {
+        std::vector<Scope>  scopes;
+        GpuClockCalibration calibration;
+        uint32_t            queryCount = 0;
+        bool                pending = false;
+    };
+
+    std::vector<Frame>          frames;
+    std::vector<uint32_t>       openScopes;     ///< Índices en scopes de los ámbitos abiertos
+    std::vector<GpuScopeTiming> resolved;
+    uint32_t                    frameCount = 0;
+    uint32_t                    queriesPerFrame = 0;
+    uint32_t                    currentSlot = 0;
+    double                      lastFrameMs = 0.0;
+};
@@ -0,0 +1,148 @@
+﻿/**
+ * @file JobSystem.cpp
+ * @brief Implementación del pool de hilos de trabajo.
+ */
+
+#include "pch.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "AllocationTracker.h"
+#include <string>
+
+JobSystem::JobSystem(unsigned threadCount)
+{
+    if (threadCount == 0)
+    {
+        unsigned hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+
+    // Estados de ParallelFor suficientes para varios niveles de anidamiento sin asignar durante el fotograma.
+    statePool.reserve(InitialStates * (threadCount + 1));
+    freeStates.reserve(statePool.capacity());
+    while (statePool.size() < statePool.capacity())
+    {
+        statePool.push_back(std::make_unique<ParallelForState>());
+        freeStates.push_back(statePool.back().get());
+    }
+
+    workers.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; i++)
+    {
+        workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void JobSystem::Submit(std::function<void()> job)
+{
+    if (workers.empty())
+    {
+        job();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (jobCount == jobs.size())
+        {
+            // Anillo lleno: se desenrolla en uno del doble de tamaño. Solo ocurre mientras la cola crece.
+            std::vector<std::function<void()>> grown((std::max)(jobs.size() * 2, size_t(64)));
+            for (size_t i = 0; i < jobCount; i++)
+            {
+                grown[i] = std::move(jobs[(jobHead + i) % jobs.size()]);
+            }
+            jobs.swap(grown);
+            jobHead = 0;
+        }
+        jobs[(jobHead + jobCount) % jobs.size()] = std::move(job);
+        jobCount++;
+    }
+    wake.notify_one();
+}
+
+JobSystem::ParallelForState* JobSystem::AcquireState()
+{
+    std::lock_guard<std::mutex> lock(stateMutex);
+    if (freeStates.empty())
+    {
+        // ReleaseState no debe asignar: freeStates siempre tiene sitio para todo el pool.
+        statePool.push_back(std::make_unique<ParallelForState>());
+        if (freeStates.capacity() < statePool.size())
+        {
+            freeStates.reserve(statePool.capacity());
+        }
+        freeStates.push_back(statePool.back().get());
+    }
+
+    ParallelForState* state = freeStates.back();
+    freeStates.pop_back();
+    state->next.store(0, std::memory_order_relaxed);
+    state->completed.store(0, std::memory_order_relaxed);
+    return state;
+}
+
+void JobSystem::ReleaseState(ParallelForState* state)
+{
+    if (state->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        freeStates.push_back(state);
+    }
+}
+
+void JobSystem::WorkerLoop(unsigned index)
+{
+    Profiler::SetThreadName(("Worker " + std::to_string(index)).c_str());
+
+    for (;;)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() { return stopping || jobCount > 0; });
+            if (jobCount == 0) return;
+
+            job = std::move(jobs[jobHead]);
+            jobs[jobHead] = nullptr;
+            jobHead = (jobHead + 1) % jobs.size();
+            jobCount--;
+        }
+
+        PROFILE_SCOPE("Job");
+        AllocationScope allocationScope("Job");
+        job();
+    }
+}
+
+void JobSystem::RunParallelFor(ParallelForState& state)
+{
+    for (;;)
+    {
+        uint32_t begin = state.next.fetch_add(state.grain, std::memory_order_relaxed);
+        if (begin >= state.count) return;
+
+        uint32_t end = (std::min)(begin + state.grain, state.count);
+        state.body(state.context, begin, end);
+
+        uint32_t finished = state.completed.fetch_add(end - begin, std::memory_order_acq_rel) + (end - begin);
+        if (finished == state.count)
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.done.notify_all();
+        }
+    }
+}
@@ -0,0 +1,117 @@
+﻿/**
+ * @file JobSystem.h
+ * @brief Define un pool de hilos de trabajo sencillo para repartir tareas del motor entre núcleos.
+ */
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @class JobSystem
+ * @brief Pool de hilos con una cola de trabajos compartida y un ParallelFor bloqueante.
+ *
+ * El hilo que llama a ParallelFor también procesa rangos mientras espera, por lo que
+ * es seguro llamarlo con cero hilos de trabajo o desde dentro de otro trabajo.
+ */
+class JobSystem {
+public:
+    explicit JobSystem(unsigned threadCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    /// Encola un trabajo que se ejecutará en algún hilo del pool.
+    void Submit(std::function<void()> job);
+
+    /// Número de hilos de trabajo (sin contar el hilo que llama).
+    unsigned WorkerCount() const { return static_cast<unsigned>(workers.size()); }
+
+    /**
+     * @brief Ejecuta fn(begin, end) sobre [0, count) en bloques de tamaño grain y espera a que termine.
+     * @param count Número total de elementos.
+     * @param grain Número de elementos por bloque (mínimo 1).
+     * @param fn Función invocada con cada rango [begin, end).
+     */
+    template<typename F>
+    void ParallelFor(uint32_t count, uint32_t grain, F&& fn)
+    {
+        if (count == 0) return;
+        if (grain == 0) grain = 1;
+
+        uint32_t blocks = (count + grain - 1) / grain;
+        if (blocks == 1 || workers.empty())
+        {
+            fn(0u, count);
+            return;
+        }
+
+        // El estado sale de un pool y la llamada se guarda como puntero más contexto: en régimen
+        // estable ParallelFor no asigna memoria.
+        ParallelForState* state = AcquireState();
+        state->count = count;
+        state->grain = grain;
+        state->body = [](void* context, uint32_t begin, uint32_t end) { (*static_cast<std::remove_reference_t<F>*>(context))(begin, end); };
+        state->context = const_cast<void*>(static_cast<const void*>(std::addressof(fn)));
+
+        // Los trabajos auxiliares pueden empezar después de que el llamante haya vuelto; cada uno
+        // suelta su referencia y el último devuelve el estado al pool.
+        uint32_t helpers = (std::min)(blocks - 1, WorkerCount());
+        state->references.store(helpers + 1, std::memory_order_relaxed);
+        for (uint32_t i = 0; i < helpers; i++)
+        {
+            Submit([this, state]() {
+                RunParallelFor(*state);
+                ReleaseState(state);
+            });
+        }
+
+        RunParallelFor(*state);
+
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->done.wait(lock, [state]() { return state->completed.load(std::memory_order_acquire) == state->count; });
+        }
+        ReleaseState(state);
+    }
+
+private:
+    static constexpr size_t InitialStates = 8; ///< Estados de ParallelFor preasignados por hilo
+
+    struct ParallelForState {
+        uint32_t count = 0;
+        uint32_t grain = 1;
+        std::atomic<uint32_t> next{ 0 };
+        std::atomic<uint32_t> completed{ 0 };
+        std::atomic<uint32_t> references{ 0 };
+        void (*body)(void*, uint32_t, uint32_t) = nullptr;
+        void* context = nullptr;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+
+    static void RunParallelFor(ParallelForState& state);
+    ParallelForState* AcquireState();
+    void ReleaseState(ParallelForState* state);
+    void WorkerLoop(unsigned index);
+
+    std::vector<std::thread>                        workers; ///< Hilos de trabajo
+    std::vector<std::function<void()>>              jobs; ///< Anillo de trabajos pendientes; crece al llenarse
+    size_t                                          jobHead = 0; ///< Posición del trabajo más antiguo
+    size_t                                          jobCount = 0;
+    std::mutex                                      mutex; ///< Protege el anillo de trabajos
+    std::condition_variable                         wake; ///< Despierta a los hilos cuando hay trabajo
+    bool                                            stopping = false;
+    std::vector<std::unique_ptr<ParallelForState>>  statePool; ///< Estados de ParallelFor, libres y en uso
+    std::vector<ParallelForState*>                  freeStates;
+    std::mutex                                      stateMutex; ///< Protege statePool y freeStates
+};
@@ -0,0 +1,219 @@
+﻿/**
+ * @file MemoryTracker.cpp
+ * @brief Implementación de la contabilidad de memoria de GPU.
+ */
+
+#include "pch.h"
+#include "MemoryTracker.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+    struct CategoryCounters {
+        std::atomic<uint64_t> currentBytes{ 0 };
+        std::atomic<uint64_t> peakBytes{ 0 };
+        std::atomic<uint64_t> totalAllocations{ 0 };
+        std::atomic<uint64_t> liveAllocations{ 0 };
+    };
+
+    struct Allocation {
+        MemoryCategory category;
+        MemorySegment  segment;
+        uint64_t       bytes;
+        std::string    name;
+    };
+
+    struct SegmentState {
+        std::atomic<uint64_t> currentBytes{ 0 };
+        MemoryBudget          budget;       ///< Protegido por el mutex del registro
+        bool                  alarmRaised = false;
+    };
+
+    struct Registry {
+        std::mutex                                    mutex;
+        std::unordered_map<const void*, Allocation>   allocations;
+        CategoryCounters                              categories[static_cast<size_t>(MemoryCategory::Count)];
+        SegmentState                                  segments[static_cast<size_t>(MemorySegment::Count)];
+        double                                        alarmFraction = 0.9;
+        std::function<void(MemorySegment, const MemoryBudget&)> alarm;
+    };
+
+    Registry& GetRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    const char* const categoryNames[] = { "Textures", "VertexIndex", "Constants", "RenderTargets", "Upload", "Readback", "Other" };
+    static_assert(sizeof(categoryNames) / sizeof(categoryNames[0]) == static_cast<size_t>(MemoryCategory::Count), "Falta el nombre de alguna categoría");
+
+    const char* const segmentNames[] = { "Local", "NonLocal" };
+    static_assert(sizeof(segmentNames) / sizeof(segmentNames[0]) == static_cast<size_t>(MemorySegment::Count), "Falta el nombre de algún segmento");
+
+    void RaisePeak(std::atomic<uint64_t>& peak, uint64_t value)
+    {
+        uint64_t previous = peak.load(std::memory_order_relaxed);
+        while (value > previous && !peak.compare_exchange_weak(previous, value, std::memory_order_relaxed)) {}
+    }
+
+    double ToMegabytes(uint64_t bytes)
+    {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+}
+
+namespace MemoryTracker
+{
+    const char* CategoryName(MemoryCategory category)
+    {
+        return categoryNames[static_cast<size_t>(category)];
+    }
+
+    const char* SegmentName(MemorySegment segment)
+    {
+        return segmentNames[static_cast<size_t>(segment)];
+    }
+
+    void OnAllocate(const void* key, MemoryCategory category, MemorySegment segment, uint64_t bytes, const char* name)
+    {
+        Registry& registry = GetRegistry();
+        {
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            // Una clave repetida sustituye a la anterior, que ya no puede estar viva.
+            auto previous = registry.allocations.find(key);
+            if (previous != registry.allocations.end())
+            {
+                Allocation stale = previous->second;
+                registry.allocations.erase(previous);
+                CategoryCounters& counters = registry.categories[static_cast<size_t>(stale.category)];
+                counters.currentBytes.fetch_sub(stale.bytes, std::memory_order_relaxed);
+                counters.liveAllocations.fetch_sub(1, std::memory_order_relaxed);
+                registry.segments[static_cast<size_t>(stale.segment)].currentBytes.fetch_sub(stale.bytes, std::memory_order_relaxed);
+            }
+            registry.allocations.emplace(key, Allocation{ category, segment, bytes, name ? name : "" });
+        }
+
+        CategoryCounters& counters = registry.categories[static_cast<size_t>(category)];
+        uint64_t current = counters.currentBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        RaisePeak(counters.peakBytes, current);
+        counters.totalAllocations.fetch_add(1, std::memory_order_relaxed);
+        counters.liveAllocations.fetch_add(1, std::memory_order_relaxed);
+        registry.segments[static_cast<size_t>(segment)].currentBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void OnRelease(const void* key)
+    {
+        Registry& registry = GetRegistry();
+        Allocation allocation;
+        {
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            auto found = registry.allocations.find(key);
+            if (found == registry.allocations.end())
+            {
+                return;
+            }
+            allocation = std::move(found->second);
+            registry.allocations.erase(found);
+        }
+
+        CategoryCounters& counters = registry.categories[static_cast<size_t>(allocation.category)];
+        counters.currentBytes.fetch_sub(allocation.bytes, std::memory_order_relaxed);
+        counters.liveAllocations.fetch_sub(1, std::memory_order_relaxed);
+        registry.segments[static_cast<size_t>(allocation.segment)].currentBytes.fetch_sub(allocation.bytes, std::memory_order_relaxed);
+    }
+
+    MemoryCategoryStats CategoryStats(MemoryCategory category)
+    {
+        const CategoryCounters& counters = GetRegistry().categories[static_cast<size_t>(category)];
+        MemoryCategoryStats stats;
+        stats.currentBytes = counters.currentBytes.load(std::memory_order_relaxed);
+        stats.peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+        stats.totalAllocations = counters.totalAllocations.load(std::memory_order_relaxed);
+        stats.liveAllocations = counters.liveAllocations.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    uint64_t SegmentBytes(MemorySegment segment)
+    {
+        return GetRegistry().segments[static_cast<size_t>(segment)].currentBytes.load(std::memory_order_relaxed);
+    }
+
+    void SetBudgetAlarm(double fraction, std::function<void(MemorySegment, const MemoryBudget&)> callback)
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.alarmFraction = fraction;
+        registry.alarm = std::move(callback);
+    }
+
+    void UpdateBudget(MemorySegment segment, uint64_t budgetBytes, uint64_t usageBytes)
+    {
+        Registry& registry = GetRegistry();
+        std::function<void(MemorySegment, const MemoryBudget&)> alarm;
+        MemoryBudget budget;
+        {
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            SegmentState& state = registry.segments[static_cast<size_t>(segment)];
+            state.budget.budgetBytes = budgetBytes;
+            state.budget.usageBytes = (std::max)(usageBytes, state.currentBytes.load(std::memory_order_relaxed));
+            budget = state.budget;
+
+            bool over = budgetBytes > 0 && static_cast<double>(budget.usageBytes) > registry.alarmFraction * static_cast<double>(budgetBytes);
+            if (over && !state.alarmRaised)
+            {
+                alarm = registry.alarm;
+            }
+            state.alarmRaised = over;
+        }
+
+        // Fuera del mutex, para que el callback pueda consultar el tracker.
+        if (alarm)
+        {
+            alarm(segment, budget);
+        }
+    }
+
+    MemoryBudget Budget(MemorySegment segment)
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        return registry.segments[static_cast<size_t>(segment)].budget;
+    }
+
+    void WriteReport(std::ostream& stream)
+    {
+        stream << "category,currentMB,peakMB,liveAllocations,totalAllocations\n";
+        for (uint32_t i = 0; i < static_cast<uint32_t>(MemoryCategory::Count); i++)
+        {
+            MemoryCategoryStats stats = CategoryStats(static_cast<MemoryCategory>(i));
+            stream << categoryNames[i] << ',' << ToMegabytes(stats.currentBytes) << ',' << ToMegabytes(stats.peakBytes) << ','
+                   << stats.liveAllocations << ',' << stats.totalAllocations << '\n';
+        }
+
+        stream << "\nsegment,trackedMB,usageMB,budgetMB\n";
+        for (uint32_t i = 0; i < static_cast<uint32_t>(MemorySegment::Count); i++)
+        {
+            MemoryBudget budget = Budget(static_cast<MemorySegment>(i));
+            stream << segmentNames[i] << ',' << ToMegabytes(SegmentBytes(static_cast<MemorySegment>(i))) << ','
+                   << ToMegabytes(budget.usageBytes) << ',' << ToMegabytes(budget.budgetBytes) << '\n';
+        }
+    }
+
+    size_t WriteLeakReport(std::ostream& stream)
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (const auto& entry : registry.allocations)
+        {
+            const Allocation& allocation = entry.second;
+            stream << "Recurso sin liberar: " << (allocation.name.empty() ? "(sin nombre)" : allocation.name.c_str())
+                   << " [" << categoryNames[static_cast<size_t>(allocation.category)] << ", "
+                   << segmentNames[static_cast<size_t>(allocation.segment)] << "] " << allocation.bytes << " bytes\n";
+        }
+        return registry.allocations.size();
+    }
+}
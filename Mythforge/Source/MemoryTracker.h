@@ -0,0 +1,97 @@
+﻿/**
+ * @file MemoryTracker.h
+ * @brief Contabilidad de la memoria de recursos de GPU por categoría y alarmas de presupuesto.
+ *
+ * Cada recurso creado se registra con una categoría y el segmento de memoria donde vive: local
+ * (VRAM) o no local (memoria del sistema visible para la GPU, como los heaps de subida). Los
+ * contadores por categoría son atómicos y se pueden leer desde cualquier hilo sin bloquear; el
+ * registro de recursos vivos, que solo se toca al crear o destruir, usa un mutex y alimenta el
+ * informe de fugas del cierre. Esta parte no depende de Direct3D: TrackResource y
+ * UpdateMemoryBudget, en DeviceUtils, la conectan con los recursos y con DXGI.
+ */
+
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <ostream>
+
+enum class MemoryCategory : uint32_t {
+    Textures,
+    VertexIndex,
+    Constants,
+    RenderTargets,
+    Upload,
+    Readback,
+    Other,
+    Count
+};
+
+enum class MemorySegment : uint32_t {
+    Local,      ///< Memoria de vídeo
+    NonLocal,   ///< Memoria del sistema accesible por la GPU
+    Count
+};
+
+/**
+ * @struct MemoryCategoryStats
+ * @brief Estado de una categoría.
+ */
+struct MemoryCategoryStats {
+    uint64_t currentBytes = 0;
+    uint64_t peakBytes = 0;
+    uint64_t totalAllocations = 0;  ///< Desde el arranque
+    uint64_t liveAllocations = 0;
+};
+
+/**
+ * @struct MemoryBudget
+ * @brief Presupuesto y uso de un segmento según el adaptador.
+ */
+struct MemoryBudget {
+    uint64_t budgetBytes = 0;
+    uint64_t usageBytes = 0;
+};
+
+namespace MemoryTracker
+{
+    const char* CategoryName(MemoryCategory category);
+    const char* SegmentName(MemorySegment segment);
+
+    /**
+     * @brief Registra una asignación.
+     * @param key Identifica la asignación hasta OnRelease; normalmente el ID3D12Resource.
+     * @param name Nombre para el informe de fugas; se copia.
+     */
+    void OnAllocate(const void* key, MemoryCategory category, MemorySegment segment, uint64_t bytes, const char* name = nullptr);
+
+    /// Da de baja la asignación. Las claves desconocidas se ignoran.
+    void OnRelease(const void* key);
+
+    MemoryCategoryStats CategoryStats(MemoryCategory category);
+
+    /// Bytes registrados ahora mismo en el segmento.
+    uint64_t SegmentBytes(MemorySegment segment);
+
+    /**
+     * @brief Configura la alarma de presupuesto.
+     *
+     * El callback se llama cuando el uso de un segmento pasa de fraction * presupuesto, y no se
+     * repite hasta que el uso vuelve a bajar de ese umbral.
+     */
+    void SetBudgetAlarm(double fraction, std::function<void(MemorySegment, const MemoryBudget&)> callback);
+
+    /**
+     * @brief Actualiza el presupuesto del segmento y comprueba la alarma.
+     *
+     * Como uso se toma el mayor entre el que informa el adaptador y el registrado aquí.
+     */
+    void UpdateBudget(MemorySegment segment, uint64_t budgetBytes, uint64_t usageBytes);
+
+    MemoryBudget Budget(MemorySegment segment);
+
+    /// Tabla por categoría y por segmento.
+    void WriteReport(std::ostream& stream);
+
+    /// Lista las asignaciones que siguen vivas. Devuelve cuántas hay.
+    size_t WriteLeakReport(std::ostream& stream);
+}
@@ -0,0 +1,324 @@
+﻿/**
+ * @file Occlusion.cpp
+ * @brief Implementación del búfer de oclusión enmascarado y de la prueba de oclusos.
+ */
+
+#include "pch.h"
+#include "Occlusion.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+    constexpr uint32_t FullMask = 0xFFFFFFFF;
+    constexpr float MinTriangleArea = 1e-6f;
+
+    const uint32_t BoxIndices[36] = {
+        0, 1, 3, 0, 3, 2,
+        4, 6, 7, 4, 7, 5,
+        0, 4, 5, 0, 5, 1,
+        2, 3, 7, 2, 7, 6,
+        0, 2, 6, 0, 6, 4,
+        1, 5, 7, 1, 7, 3
+    };
+
+    float ElapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Máscara de los píxeles de una tesela dentro de las columnas [x0, x1] y las filas [y0, y1], en coordenadas de tesela.
+    uint32_t RectMask(uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1)
+    {
+        uint32_t rowMask = ((1u << (x1 - x0 + 1)) - 1) << x0;
+        uint32_t mask = 0;
+        for (uint32_t y = y0; y <= y1; y++)
+        {
+            mask |= rowMask << (y * OcclusionBuffer::TileWidth);
+        }
+        return mask;
+    }
+}
+
+OcclusionBuffer::OcclusionBuffer(uint32_t width, uint32_t height) :
+    width((std::max)(width + TileWidth - 1, TileWidth) / TileWidth * TileWidth),
+    height((std::max)(height + TileHeight - 1, TileHeight) / TileHeight * TileHeight),
+    triangles(0)
+{
+    tilesX = this->width / TileWidth;
+    tilesY = this->height / TileHeight;
+    tiles.resize(static_cast<size_t>(tilesX) * tilesY);
+    Clear(XMMatrixIdentity());
+}
+
+void OcclusionBuffer::Clear(FXMMATRIX viewProjection)
+{
+    XMStoreFloat4x4(&this->viewProjection, viewProjection);
+    std::fill(tiles.begin(), tiles.end(), Tile{ 0, 1.0f, 1.0f });
+    triangles = 0;
+}
+
+void OcclusionBuffer::RasterizeTriangles(const XMFLOAT3* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t triangleCount, CXMMATRIX world)
+{
+    XMMATRIX worldViewProjection = XMMatrixMultiply(world, XMLoadFloat4x4(&viewProjection));
+    clipVertices.resize(vertexCount);
+    XMVector3TransformStream(clipVertices.data(), sizeof(XMFLOAT4), vertices, sizeof(XMFLOAT3), vertexCount, worldViewProjection);
+
+    XMVECTOR scale = XMVectorSet(0.5f * width, -0.5f * height, 1.0f, 1.0f);
+    XMVECTOR offset = XMVectorSet(0.5f * width, 0.5f * height, 0.0f, 0.0f);
+
+    for (uint32_t t = 0; t < triangleCount; t++)
+    {
+        const XMFLOAT4& c0 = clipVertices[indices[3 * t]];
+        const XMFLOAT4& c1 = clipVertices[indices[3 * t + 1]];
+        const XMFLOAT4& c2 = clipVertices[indices[3 * t + 2]];
+
+        // Con z en [0, 1], z >= 0 implica w > 0: el triángulo está entero delante del plano cercano.
+        if (c0.z < 0.0f || c1.z < 0.0f || c2.z < 0.0f) continue;
+
+        XMVECTOR v0 = XMVectorMultiplyAdd(XMVectorDivide(XMLoadFloat4(&c0), XMVectorReplicate(c0.w)), scale, offset);
+        XMVECTOR v1 = XMVectorMultiplyAdd(XMVectorDivide(XMLoadFloat4(&c1), XMVectorReplicate(c1.w)), scale, offset);
+        XMVECTOR v2 = XMVectorMultiplyAdd(XMVectorDivide(XMLoadFloat4(&c2), XMVectorReplicate(c2.w)), scale, offset);
+        RasterizeTriangle(v0, v1, v2);
+    }
+}
+
+void OcclusionBuffer::RasterizeBox(const XMFLOAT3& extents, CXMMATRIX world)
+{
+    XMFLOAT3 corners[8];
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        corners[i] = XMFLOAT3(
+            (i & 4) ? extents.x : -extents.x,
+            (i & 2) ? extents.y : -extents.y,
+            (i & 1) ? extents.z : -extents.z);
+    }
+    RasterizeTriangles(corners, 8, BoxIndices, 12, world);
+}
+
+void OcclusionBuffer::RasterizeTriangle(FXMVECTOR v0, FXMVECTOR v1, FXMVECTOR v2)
+{
+    XMFLOAT3 p[3];
+    XMStoreFloat3(&p[0], v0);
+    XMStoreFloat3(&p[1], v1);
+    XMStoreFloat3(&p[2], v2);
+
+    float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+    if (fabsf(area) < MinTriangleArea) return;
+    if (area < 0.0f)
+    {
+        std::swap(p[1], p[2]);
+        area = -area;
+    }
+
+    float minX = (std::min)({ p[0].x, p[1].x, p[2].x });
+    float maxX = (std::max)({ p[0].x, p[1].x, p[2].x });
+    float minY = (std::min)({ p[0].y, p[1].y, p[2].y });
+    float maxY = (std::max)({ p[0].y, p[1].y, p[2].y });
+    if (maxX <= 0.0f || maxY <= 0.0f || minX >= width || minY >= height) return;
+
+    uint32_t tileX0 = static_cast<uint32_t>((std::max)(minX, 0.0f)) / TileWidth;
+    uint32_t tileY0 = static_cast<uint32_t>((std::max)(minY, 0.0f)) / TileHeight;
+    uint32_t tileX1 = (std::min)(static_cast<uint32_t>(maxX) / TileWidth, tilesX - 1);
+    uint32_t tileY1 = (std::min)(static_cast<uint32_t>(maxY) / TileHeight, tilesY - 1);
+
+    // Ecuaciones de arista a*(x - ox) + b*(y - oy), positivas en el interior. El origen es siempre el
+    // mismo extremo de la arista, así que dos triángulos que la comparten obtienen valores exactamente
+    // opuestos y la regla arriba-izquierda asigna cada píxel de la arista a uno solo de ellos.
+    float a[3];
+    float b[3];
+    XMVECTOR originX[3];
+    float originY[3];
+    bool topLeft[3];
+    for (int i = 0; i < 3; i++)
+    {
+        const XMFLOAT3& from = p[i];
+        const XMFLOAT3& to = p[(i + 1) % 3];
+        a[i] = from.y - to.y;
+        b[i] = to.x - from.x;
+        const XMFLOAT3& origin = (from.x < to.x || (from.x == to.x && from.y < to.y)) ? from : to;
+        originX[i] = XMVectorReplicate(origin.x);
+        originY[i] = origin.y;
+        topLeft[i] = a[i] > 0.0f || (a[i] == 0.0f && b[i] > 0.0f);
+    }
+
+    // La profundidad z/w es lineal en pantalla; su máximo en una tesela está en una esquina.
+    float dzdx = ((p[1].z - p[0].z) * (p[2].y - p[0].y) - (p[2].z - p[0].z) * (p[1].y - p[0].y)) / area;
+    float dzdy = ((p[2].z - p[0].z) * (p[1].x - p[0].x) - (p[1].z - p[0].z) * (p[2].x - p[0].x)) / area;
+    float maxVertexDepth = (std::max)({ p[0].z, p[1].z, p[2].z });
+    float cornerX = dzdx > 0.0f ? TileWidth - 0.5f : 0.5f;
+    float cornerY = dzdy > 0.0f ? TileHeight - 0.5f : 0.5f;
+
+    const XMVECTOR leftOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+    const XMVECTOR rightOffsets = XMVectorSet(4.5f, 5.5f, 6.5f, 7.5f);
+
+    bool covered = false;
+    for (uint32_t tileY = tileY0; tileY <= tileY1; tileY++)
+    {
+        for (uint32_t tileX = tileX0; tileX <= tileX1; tileX++)
+        {
+            float x = static_cast<float>(tileX * TileWidth);
+            float y = static_cast<float>(tileY * TileHeight);
+
+            XMVECTOR columns = XMVectorReplicate(x);
+            XMVECTOR dxLeft[3];
+            XMVECTOR dxRight[3];
+            for (int i = 0; i < 3; i++)
+            {
+                dxLeft[i] = XMVectorScale(XMVectorSubtract(XMVectorAdd(columns, leftOffsets), originX[i]), a[i]);
+                dxRight[i] = XMVectorScale(XMVectorSubtract(XMVectorAdd(columns, rightOffsets), originX[i]), a[i]);
+            }
+
+            uint32_t coverage = 0;
+            for (uint32_t row = 0; row < TileHeight; row++)
+            {
+                float rowY = y + row + 0.5f;
+                XMVECTOR insideLeft = XMVectorTrueInt();
+                XMVECTOR insideRight = XMVectorTrueInt();
+                for (int i = 0; i < 3; i++)
+                {
+                    XMVECTOR dy = XMVectorReplicate(b[i] * (rowY - originY[i]));
+                    XMVECTOR edgeLeft = XMVectorAdd(dxLeft[i], dy);
+                    XMVECTOR edgeRight = XMVectorAdd(dxRight[i], dy);
+                    if (topLeft[i])
+                    {
+                        insideLeft = XMVectorAndInt(insideLeft, XMVectorGreaterOrEqual(edgeLeft, XMVectorZero()));
+                        insideRight = XMVectorAndInt(insideRight, XMVectorGreaterOrEqual(edgeRight, XMVectorZero()));
+                    }
+                    else
+                    {
+                        insideLeft = XMVectorAndInt(insideLeft, XMVectorGreater(edgeLeft, XMVectorZero()));
+                        insideRight = XMVectorAndInt(insideRight, XMVectorGreater(edgeRight, XMVectorZero()));
+                    }
+                }
+                uint32_t rowMask = VectorLaneMask(insideLeft) | (VectorLaneMask(insideRight) << 4);
+                coverage |= rowMask << (row * TileWidth);
+            }
+            if (coverage == 0) continue;
+
+            float planeDepth = p[0].z + dzdx * (x + cornerX - p[0].x) + dzdy * (y + cornerY - p[0].y);
+            UpdateTile(tiles[tileY * tilesX + tileX], coverage, (std::min)(planeDepth, maxVertexDepth));
+            covered = true;
+        }
+    }
+
+    if (covered) triangles++;
+}
+
+void OcclusionBuffer::UpdateTile(Tile& tile, uint32_t coverage, float triangleDepth)
+{
+    if (triangleDepth >= tile.depth) return;
+
+    // Si el triángulo está mucho más cerca que la capa de trabajo, fusionarlo la empeoraría: se descarta la capa.
+    if (tile.mask != 0 && tile.workDepth - triangleDepth > tile.depth - tile.workDepth)
+    {
+        tile.mask = 0;
+    }
+
+    tile.workDepth = tile.mask != 0 ? (std::max)(tile.workDepth, triangleDepth) : triangleDepth;
+    tile.mask |= coverage;
+
+    if (tile.mask == FullMask)
+    {
+        tile.depth = tile.workDepth;
+        tile.mask = 0;
+    }
+}
+
+bool OcclusionBuffer::IsVisible(const XMFLOAT3& center, const XMFLOAT3& extents) const
+{
+    XMMATRIX matrix = XMLoadFloat4x4(&viewProjection);
+    XMVECTOR c = XMLoadFloat3(&center);
+    XMVECTOR e = XMLoadFloat3(&extents);
+
+    float minX = FLT_MAX;
+    float maxX = -FLT_MAX;
+    float minY = FLT_MAX;
+    float maxY = -FLT_MAX;
+    float minDepth = FLT_MAX;
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        XMVECTOR sign = XMVectorSet((i & 4) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 1) ? 1.0f : -1.0f, 0.0f);
+        XMFLOAT4 clip;
+        XMStoreFloat4(&clip, XMVector3Transform(XMVectorMultiplyAdd(e, sign, c), matrix));
+
+        // Una esquina delante del plano cercano hace la caja visible de forma conservadora.
+        if (clip.z <= 0.0f) return true;
+
+        float x = (clip.x / clip.w + 1.0f) * 0.5f * width;
+        float y = (1.0f - clip.y / clip.w) * 0.5f * height;
+        minX = (std::min)(minX, x);
+        maxX = (std::max)(maxX, x);
+        minY = (std::min)(minY, y);
+        maxY = (std::max)(maxY, y);
+        minDepth = (std::min)(minDepth, clip.z / clip.w);
+    }
+
+    if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height) return false;
+
+    uint32_t pixelX0 = static_cast<uint32_t>((std::max)(minX, 0.0f));
+    uint32_t pixelY0 = static_cast<uint32_t>((std::max)(minY, 0.0f));
+    uint32_t pixelX1 = (std::min)(static_cast<uint32_t>(maxX), width - 1);
+    uint32_t pixelY1 = (std::min)(static_cast<uint32_t>(maxY), height - 1);
+
+    for (uint32_t tileY = pixelY0 / TileHeight; tileY <= pixelY1 / TileHeight; tileY++)
+    {
+        uint32_t rowBegin = tileY * TileHeight;
+        uint32_t y0 = (std::max)(pixelY0, rowBegin) - rowBegin;
+        uint32_t y1 = (std::min)(pixelY1, rowBegin + TileHeight - 1) - rowBegin;
+
+        for (uint32_t tileX = pixelX0 / TileWidth; tileX <= pixelX1 / TileWidth; tileX++)
+        {
+            const Tile& tile = tiles[tileY * tilesX + tileX];
+            if (minDepth <= tile.workDepth && minDepth <= tile.depth) return true;
+            if (minDepth > tile.depth) continue;
+
+            // La caja está entre ambas capas: solo la ocultan los píxeles de la capa de trabajo.
+            uint32_t columnBegin = tileX * TileWidth;
+            uint32_t x0 = (std::max)(pixelX0, columnBegin) - columnBegin;
+            uint32_t x1 = (std::min)(pixelX1, columnBegin + TileWidth - 1) - columnBegin;
+            if (RectMask(x0, x1, y0, y1) & ~tile.mask) return true;
+        }
+    }
+    return false;
+}
+
+void OcclusionBuffer::ResolveDepth(std::vector<float>& depth) const
+{
+    depth.resize(static_cast<size_t>(width) * height);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const Tile& tile = tiles[(y / TileHeight) * tilesX + x / TileWidth];
+            uint32_t bit = 1u << ((y % TileHeight) * TileWidth + x % TileWidth);
+            depth[static_cast<size_t>(y) * width + x] = (tile.mask & bit) ? (std::min)(tile.workDepth, tile.depth) : tile.depth;
+        }
+    }
+}
+
+void CullOccluded(const OcclusionBuffer& buffer, const CullingBounds& bounds, std::vector<uint32_t>& visible, OcclusionStats* stats)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    size_t kept = 0;
+    for (uint32_t index : visible)
+    {
+        if (buffer.IsVisible(bounds.Center(index), bounds.Extents(index)))
+        {
+            visible[kept++] = index;
+        }
+    }
+    uint32_t culled = static_cast<uint32_t>(visible.size() - kept);
+    uint32_t tested = static_cast<uint32_t>(visible.size());
+    visible.resize(kept);
+
+    if (stats)
+    {
+        stats->occludeesTested += tested;
+        stats->occludeesCulled += culled;
+        stats->testMs += ElapsedMs(start);
+    }
+}
@@ -0,0 +1,102 @@
+﻿/**
+ * @file Occlusion.h
+ * @brief Define el recorte por oclusión en CPU sobre un búfer de profundidad enmascarado de baja resolución.
+ *
+ * La pantalla se divide en teselas de 8x4 píxeles. Cada tesela guarda una máscara de 32 bits
+ * con los píxeles cubiertos por la capa de trabajo y dos profundidades conservadoras: la de
+ * referencia, válida para toda la tesela, y la de la capa de trabajo, válida solo para los
+ * píxeles de la máscara. Los oclusores se rasterizan evaluando las ecuaciones de arista de
+ * cuatro píxeles a la vez; los oclusos se prueban proyectando su caja a un rectángulo de
+ * pantalla con su profundidad más cercana. La cobertura se muestrea en el centro de cada píxel,
+ * de modo que un objeto visible solo por una rendija más estrecha que un píxel puede descartarse.
+ * Todo el proceso es de un solo hilo y no usa más que DirectXMath y la biblioteca estándar, así
+ * que el resultado es determinista. Tools/OcclusionTest lo comprueba.
+ */
+
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+#include "Culling.h"
+
+using namespace DirectX;
+
+/**
+ * @struct OcclusionStats
+ * @brief Contadores y tiempos del recorte por oclusión de un fotograma.
+ */
+struct OcclusionStats {
+    uint32_t occluders; ///< Oclusores rasterizados
+    uint32_t triangles; ///< Triángulos que llegaron a cubrir alguna tesela
+    uint32_t occludeesTested;
+    uint32_t occludeesCulled;
+    float rasterizeMs; ///< Tiempo de rasterización de oclusores
+    float testMs; ///< Tiempo de prueba de oclusos
+
+    float CulledPercent() const { return occludeesTested ? 100.0f * occludeesCulled / occludeesTested : 0.0f; }
+};
+
+/**
+ * @class OcclusionBuffer
+ * @brief Búfer de profundidad jerárquico (teselas con máscara de cobertura) para recorte por oclusión.
+ *
+ * La profundidad sigue la convención de la proyección de la aplicación: z/w en [0, 1], 0 en el plano cercano.
+ */
+class OcclusionBuffer {
+public:
+    static constexpr uint32_t TileWidth = 8;
+    static constexpr uint32_t TileHeight = 4;
+
+    /// El ancho se redondea a múltiplo de 8 y el alto a múltiplo de 4.
+    explicit OcclusionBuffer(uint32_t width = 256, uint32_t height = 144);
+
+    /// Vacía el búfer y fija la matriz vista-proyección con la que se rasterizará y probará.
+    void Clear(FXMMATRIX viewProjection);
+
+    /**
+     * @brief Rasteriza triángulos en espacio de objeto.
+     * @param indices Tres índices por triángulo. Se aceptan ambos sentidos de giro.
+     *
+     * Los triángulos que cruzan el plano cercano se descartan, lo que solo reduce la oclusión.
+     */
+    void RasterizeTriangles(const XMFLOAT3* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t triangleCount, CXMMATRIX world);
+
+    /// Rasteriza una caja orientada de semiextensión extents centrada en el origen de world.
+    void RasterizeBox(const XMFLOAT3& extents, CXMMATRIX world);
+
+    /// Devuelve true si alguna parte de la caja alineada en espacio de mundo puede ser visible.
+    bool IsVisible(const XMFLOAT3& center, const XMFLOAT3& extents) const;
+
+    /// Copia la profundidad conservadora de cada píxel, fila a fila, para depuración.
+    void ResolveDepth(std::vector<float>& depth) const;
+
+    uint32_t Width() const { return width; }
+    uint32_t Height() const { return height; }
+    uint32_t TrianglesRasterized() const { return triangles; }
+
+private:
+    struct Tile {
+        uint32_t mask; ///< Píxeles cubiertos por la capa de trabajo
+        float workDepth; ///< Profundidad máxima de la capa de trabajo
+        float depth; ///< Profundidad máxima de referencia de toda la tesela
+    };
+
+    void RasterizeTriangle(FXMVECTOR v0, FXMVECTOR v1, FXMVECTOR v2);
+    void UpdateTile(Tile& tile, uint32_t coverage, float triangleDepth);
+
+    uint32_t              width;
+    uint32_t              height;
+    uint32_t              tilesX;
+    uint32_t              tilesY;
+    std::vector<Tile>     tiles;
+    std::vector<XMFLOAT4> clipVertices; ///< Vértices transformados, reutilizados entre llamadas
+    XMFLOAT4X4            viewProjection;
+    uint32_t              triangles;
+};
+
+/**
+ * @brief Elimina de visible los índices de bounds cuya caja queda oculta en el búfer.
+ *
+ * Conserva el orden de los índices restantes y acumula contadores y tiempo de prueba en stats.
+ */
+void CullOccluded(const OcclusionBuffer& buffer, const CullingBounds& bounds, std::vector<uint32_t>& visible, OcclusionStats* stats = nullptr);
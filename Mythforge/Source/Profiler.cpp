@@ -0,0 +1,298 @@
+﻿/**
+ * @file Profiler.cpp
+ * @brief Implementación de las pistas por hilo, el reloj y la exportación del perfilador.
+ */
+
+#include "pch.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define MYTHFORGE_PROFILER_RDTSC 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+/**
+ * @struct ProfileEvent
+ * @brief Zona ya cerrada tal como se guarda en el anillo.
+ */
+struct ProfileEvent {
+    const char* name;
+    uint64_t    start;
+    uint64_t    end;
+    uint32_t    depth;
+};
+
+/**
+ * @struct ProfilerTrack
+ * @brief Anillo de eventos de un hilo o de una pista sin hilo, como la GPU.
+ *
+ * Solo escribe un hilo; written se publica con release para que el volcado vea los
+ * eventos completos. Las pistas pertenecen al registro y sobreviven a sus hilos.
+ */
+struct ProfilerTrack {
+    static constexpr uint64_t Capacity = 1 << 16;
+
+    std::unique_ptr<ProfileEvent[]> events{ new ProfileEvent[Capacity] };
+    std::atomic<uint64_t>           written{ 0 };
+    std::atomic<uint64_t>           cleared{ 0 };   ///< Eventos anteriores a este índice no se vuelcan.
+    uint32_t                        depth = 0;
+    uint32_t                        threadIndex = 0;
+    std::string                     name;
+};
+
+namespace
+{
+    struct Registry {
+        std::mutex                                  mutex;
+        std::vector<std::unique_ptr<ProfilerTrack>> tracks;
+    };
+
+    Registry& GetRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    std::atomic<bool> profilerEnabled{ true };
+
+    thread_local ProfilerTrack* currentTrack = nullptr;
+
+    ProfilerTrack* RegisterTrack(std::string name)
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.tracks.push_back(std::make_unique<ProfilerTrack>());
+        ProfilerTrack* track = registry.tracks.back().get();
+        track->threadIndex = static_cast<uint32_t>(registry.tracks.size());
+        track->name = name.empty() ? "Thread " + std::to_string(track->threadIndex) : std::move(name);
+        return track;
+    }
+
+    ProfilerTrack& CurrentTrack()
+    {
+        if (!currentTrack)
+        {
+            currentTrack = RegisterTrack(std::string());
+        }
+        return *currentTrack;
+    }
+
+    void Append(ProfilerTrack& track, const ProfileEvent& event)
+    {
+        uint64_t index = track.written.load(std::memory_order_relaxed);
+        track.events[index & (ProfilerTrack::Capacity - 1)] = event;
+        track.written.store(index + 1, std::memory_order_release);
+    }
+
+    /// Pareja de lecturas simultáneas del reloj del perfilador y de steady_clock.
+    struct ClockAnchor {
+        uint64_t                              ticks;
+        std::chrono::steady_clock::time_point time;
+
+        static ClockAnchor Capture()
+        {
+            return ClockAnchor{ Profiler::Now(), std::chrono::steady_clock::now() };
+        }
+    };
+
+    /// Tiempo entre las dos lecturas de la calibración; con 20 ms el error de steady_clock queda en unas pocas ppm.
+    constexpr std::chrono::milliseconds CalibrationInterval(20);
+
+    const ClockAnchor& StartAnchor()
+    {
+        static const ClockAnchor anchor = ClockAnchor::Capture();
+        return anchor;
+    }
+
+    // Fija el origen de la traza al cargar el módulo, antes de que se abra ninguna zona.
+    const ClockAnchor& startAnchorInit = StartAnchor();
+
+    void WriteJsonString(std::ostream& stream, const char* text)
+    {
+        stream << '"';
+        for (const char* c = text; *c; ++c)
+        {
+            switch (*c)
+            {
+            case '"':  stream << "\\\""; break;
+            case '\\': stream << "\\\\"; break;
+            case '\n': stream << "\\n"; break;
+            case '\t': stream << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(*c) >= 0x20)
+                {
+                    stream << *c;
+                }
+                break;
+            }
+        }
+        stream << '"';
+    }
+}
+
+namespace Profiler
+{
+    uint64_t Now()
+    {
+#if defined(MYTHFORGE_PROFILER_RDTSC)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    double TicksPerMicrosecond()
+    {
+#if defined(MYTHFORGE_PROFILER_RDTSC)
+        // Se calibra una sola vez, con la primera conversión, y todas usan la misma razón: el mismo
+        // tick da siempre los mismos microsegundos. Si el módulo lleva menos del intervalo cargado,
+        // el hilo que convierte duerme hasta cumplirlo.
+        static const double ticksPerMicrosecond = []() {
+            std::this_thread::sleep_until(StartAnchor().time + CalibrationInterval);
+            ClockAnchor now = ClockAnchor::Capture();
+            double microseconds = std::chrono::duration<double, std::micro>(now.time - StartAnchor().time).count();
+            return static_cast<double>(now.ticks - StartAnchor().ticks) / microseconds;
+        }();
+        return ticksPerMicrosecond;
+#else
+        return 1000.0;
+#endif
+    }
+
+    double TicksToMicroseconds(uint64_t ticks)
+    {
+        return static_cast<double>(ticks) / TicksPerMicrosecond();
+    }
+
+    double TimestampToMicroseconds(uint64_t ticks)
+    {
+        return static_cast<double>(static_cast<int64_t>(ticks - StartAnchor().ticks)) / TicksPerMicrosecond();
+    }
+
+    void SetEnabled(bool enabled)
+    {
+        profilerEnabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool IsEnabled()
+    {
+        return profilerEnabled.load(std::memory_order_relaxed);
+    }
+
+    void SetThreadName(const char* name)
+    {
+        ProfilerTrack& track = CurrentTrack();
+        std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+        track.name = name;
+    }
+
+    void Clear()
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (auto& track : registry.tracks)
+        {
+            track->cleared.store(track->written.load(std::memory_order_acquire), std::memory_order_relaxed);
+        }
+    }
+
+    void EnterZone(const char* name)
+    {
+        ++CurrentTrack().depth;
+#if defined(MYTHFORGE_PROFILER_PIX)
+        PIXBeginEvent(0, name);
+#else
+        (void)name;
+#endif
+    }
+
+    void LeaveZone(const char* name, uint64_t start)
+    {
+        uint64_t end = Now();
+#if defined(MYTHFORGE_PROFILER_PIX)
+        PIXEndEvent();
+#endif
+        ProfilerTrack& track = CurrentTrack();
+        Append(track, ProfileEvent{ name, start, end, --track.depth });
+    }
+
+    ProfilerTrack* CreateTrack(const char* name)
+    {
+        return RegisterTrack(name);
+    }
+
+    void RecordZone(ProfilerTrack* track, const char* name, uint64_t start, uint64_t end, uint32_t depth)
+    {
+        if (IsEnabled())
+        {
+            Append(*track, ProfileEvent{ name, start, end, depth });
+        }
+    }
+
+    void WriteChromeTrace(std::ostream& stream)
+    {
+        const double ticksPerMicrosecond = TicksPerMicrosecond();
+        const uint64_t origin = StartAnchor().ticks;
+
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        for (auto& track : registry.tracks)
+        {
+            stream << (first ? "\n" : ",\n");
+            first = false;
+            stream << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << track->threadIndex << ",\"args\":{\"name\":";
+            WriteJsonString(stream, track->name.c_str());
+            stream << "}}";
+
+            uint64_t written = track->written.load(std::memory_order_acquire);
+            uint64_t begin = (std::max)(track->cleared.load(std::memory_order_relaxed),
+                                        written > ProfilerTrack::Capacity ? written - ProfilerTrack::Capacity : 0);
+            for (uint64_t i = begin; i < written; ++i)
+            {
+                const ProfileEvent& e = track->events[i & (ProfilerTrack::Capacity - 1)];
+                double timestamp = static_cast<double>(static_cast<int64_t>(e.start - origin)) / ticksPerMicrosecond;
+                double duration = static_cast<double>(e.end - e.start) / ticksPerMicrosecond;
+                stream << ",\n{\"ph\":\"X\",\"cat\":\"cpu\",\"name\":";
+                WriteJsonString(stream, e.name);
+                stream << ",\"pid\":1,\"tid\":" << track->threadIndex
+                       << ",\"ts\":" << timestamp << ",\"dur\":" << duration
+                       << ",\"args\":{\"depth\":" << e.depth << "}}";
+            }
+        }
+        stream << "\n]}\n";
+    }
+
+    double MeasureZoneOverhead(uint32_t iterations)
+    {
+        // Se mide sobre un anillo desechable para no ensuciar la traza del hilo.
+        ProfilerTrack& owner = CurrentTrack();
+        ProfilerTrack scratch;
+        currentTrack = &scratch;
+
+        auto begin = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; ++i)
+        {
+            ProfileZone zone("Profiler overhead");
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        currentTrack = &owner;
+        return iterations ? std::chrono::duration<double, std::nano>(end - begin).count() / iterations : 0.0;
+    }
+}
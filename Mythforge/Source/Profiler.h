@@ -0,0 +1,123 @@
+﻿/**
+ * @file Profiler.h
+ * @brief Perfilador de CPU por zonas con búferes por hilo y exportación a Chrome trace.
+ *
+ * Cada hilo escribe sus zonas en un anillo propio sin bloqueos: al cerrar una zona se guarda un
+ * evento completo (nombre, inicio, fin y profundidad) y se publica con un contador atómico. Las
+ * marcas de tiempo salen de rdtsc en x86/x64 y de steady_clock en el resto. Con USE_PIX las zonas
+ * también se reenvían como eventos de CPU de PIX. El volcado produce JSON en el formato de Chrome
+ * trace, que cargan chrome://tracing, Perfetto y el importador de Tracy.
+ *
+ * Los nombres de zona deben tener duración estática (literales o __FUNCTION__): solo se guarda el puntero.
+ */
+
+#pragma once
+#include <cstdint>
+#include <ostream>
+
+struct ProfilerTrack;
+
+#ifndef MYTHFORGE_PROFILER
+#define MYTHFORGE_PROFILER 1
+#endif
+
+#if !defined(MYTHFORGE_PROFILER_PIX) && defined(USE_PIX)
+#define MYTHFORGE_PROFILER_PIX 1
+#endif
+
+namespace Profiler
+{
+    /// Marca de tiempo en ticks del reloj del perfilador.
+    uint64_t Now();
+
+    /// Ticks del reloj del perfilador por microsegundo, calibrados una vez contra steady_clock.
+    double TicksPerMicrosecond();
+
+    /// Convierte una diferencia de ticks a microsegundos.
+    double TicksToMicroseconds(uint64_t ticks);
+
+    /**
+     * @brief Microsegundos de una marca de tiempo absoluta, contados desde el arranque del perfilador.
+     *
+     * Para instantes y no diferencias: con el contador de ciclos, convertir el valor absoluto con
+     * TicksToMicroseconds multiplica el error de calibración por todos los ticks desde el encendido.
+     */
+    double TimestampToMicroseconds(uint64_t ticks);
+
+    /// Activa o desactiva la grabación de zonas. Está activa por defecto.
+    void SetEnabled(bool enabled);
+    bool IsEnabled();
+
+    /// Nombre con el que aparece el hilo actual en la traza.
+    void SetThreadName(const char* name);
+
+    /**
+     * @brief Crea una pista que no pertenece a ningún hilo, como la línea de tiempo de la GPU.
+     *
+     * Sus zonas se añaden ya medidas con RecordZone, siempre desde un mismo hilo. La pista vive
+     * hasta el cierre del programa.
+     */
+    ProfilerTrack* CreateTrack(const char* name);
+
+    /// Añade a la pista una zona medida en ticks del reloj del perfilador.
+    void RecordZone(ProfilerTrack* track, const char* name, uint64_t start, uint64_t end, uint32_t depth);
+
+    /// Descarta los eventos grabados hasta ahora en todos los hilos.
+    void Clear();
+
+    /**
+     * @brief Escribe los eventos de todos los hilos como Chrome trace JSON.
+     *
+     * Puede llamarse con los hilos en marcha; si un hilo da la vuelta completa a su anillo
+     * durante el volcado, alguno de sus eventos más antiguos puede salir incoherente.
+     */
+    void WriteChromeTrace(std::ostream& stream);
+
+    /// Coste medio en nanosegundos de abrir y cerrar una zona vacía en el hilo actual.
+    double MeasureZoneOverhead(uint32_t iterations = 100000);
+
+    void EnterZone(const char* name);
+    void LeaveZone(const char* name, uint64_t start);
+}
+
+/**
+ * @class ProfileZone
+ * @brief Zona con ámbito: se mide desde su construcción hasta su destrucción.
+ */
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name) : name(Profiler::IsEnabled() ? name : nullptr)
+    {
+        if (this->name)
+        {
+            Profiler::EnterZone(this->name);
+            start = Profiler::Now();
+        }
+    }
+
+    ~ProfileZone()
+    {
+        if (name)
+        {
+            Profiler::LeaveZone(name, start);
+        }
+    }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* name;
+    uint64_t start = 0;
+};
+
+#define MYTHFORGE_PROFILE_CONCAT_INNER(a, b) a##b
+#define MYTHFORGE_PROFILE_CONCAT(a, b) MYTHFORGE_PROFILE_CONCAT_INNER(a, b)
+
+#if MYTHFORGE_PROFILER
+#define PROFILE_SCOPE(name) ProfileZone MYTHFORGE_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#endif
@@ -0,0 +1,289 @@
+﻿/**
+ * @file RenderStats.cpp
+ * @brief Implementación de los contadores de fotograma.
+ */
+
+#include "pch.h"
+#include "RenderStats.h"
+#include <atomic>
+#include <cstring>
+#include <cwchar>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    /**
+     * @struct AtomicCounters
+     * @brief Contadores que su hilo incrementa mientras EndFrame los vacía desde otro.
+     *
+     * Basta con orden relajado: cada incremento cae entero en un fotograma o en el siguiente.
+     */
+    struct AtomicCounters {
+        std::atomic<uint64_t> values[static_cast<size_t>(RenderCounter::Count)] = {};
+
+        void Add(RenderCounter counter, uint64_t amount)
+        {
+            values[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+        }
+
+        /// Suma los valores a target y los deja a cero.
+        void Drain(RenderCounters& target)
+        {
+            for (size_t i = 0; i < static_cast<size_t>(RenderCounter::Count); i++)
+            {
+                target.values[i] += values[i].exchange(0, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    /**
+     * @struct ThreadCounters
+     * @brief Bloque de contadores de un hilo.
+     *
+     * Solo lo escribe su hilo. EndFrame vacía los contadores aunque el hilo siga grabando, por
+     * ejemplo un cargador de recursos, y lee los nombres de pase publicados con passCount.
+     */
+    struct ThreadCounters {
+        static constexpr uint32_t MaxNesting = 8;
+
+        AtomicCounters        total;
+        AtomicCounters        passCounters[RenderFrameStats::MaxPasses];
+        const char*           passNames[RenderFrameStats::MaxPasses] = {};
+        std::atomic<uint32_t> passCount{ 0 };
+        int32_t               passStack[MaxNesting];
+        uint32_t              passDepth = 0;
+        uint32_t              passOverflow = 0;   ///< Pases abiertos por encima de MaxNesting, que no tienen entrada en passStack
+
+        /// Pase abierto más interno, o -1.
+        int32_t CurrentPass() const { return passDepth ? passStack[passDepth - 1] : -1; }
+
+        /// Busca el pase por nombre o lo añade; -1 si ya no caben más. Los nombres no se quitan nunca.
+        int32_t FindOrAddPass(const char* name)
+        {
+            uint32_t count = passCount.load(std::memory_order_relaxed);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                if (passNames[i] == name || strcmp(passNames[i], name) == 0)
+                {
+                    return static_cast<int32_t>(i);
+                }
+            }
+            if (count == RenderFrameStats::MaxPasses)
+            {
+                return -1;
+            }
+            passNames[count] = name;
+            passCount.store(count + 1, std::memory_order_release);
+            return static_cast<int32_t>(count);
+        }
+    };
+
+    constexpr uint32_t HistoryCapacity = 1024;
+
+    struct Registry {
+        std::mutex                                   mutex;
+        std::vector<std::unique_ptr<ThreadCounters>> threads;
+        RenderFrameStats                             lastFrame;
+        RenderCounters                               history[HistoryCapacity];
+        uint64_t                                     frameCount = 0;
+    };
+
+    Registry& GetRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    thread_local ThreadCounters* currentThread = nullptr;
+
+    ThreadCounters& CurrentThread()
+    {
+        if (!currentThread)
+        {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.threads.push_back(std::make_unique<ThreadCounters>());
+            currentThread = registry.threads.back().get();
+        }
+        return *currentThread;
+    }
+
+    /// Busca el pase por nombre o lo añade; -1 si ya no caben más.
+    int32_t FindOrAddPass(RenderPassStats* passes, uint32_t& passCount, const char* name)
+    {
+        for (uint32_t i = 0; i < passCount; i++)
+        {
+            if (passes[i].name == name || strcmp(passes[i].name, name) == 0)
+            {
+                return static_cast<int32_t>(i);
+            }
+        }
+        if (passCount == RenderFrameStats::MaxPasses)
+        {
+            return -1;
+        }
+        passes[passCount].name = name;
+        passes[passCount].counters = RenderCounters();
+        return static_cast<int32_t>(passCount++);
+    }
+
+    const char* const counterNames[] = {
+        "DrawCalls",
+        "Primitives",
+        "PipelineChanges",
+        "RootSignatureChanges",
+        "DescriptorHeapChanges",
+        "RootParameterWrites",
+        "TopologyChanges",
+        "VertexBufferBinds",
+        "IndexBufferBinds",
+        "RenderTargetBinds",
+        "Clears",
+        "Barriers",
+        "DescriptorWrites",
+        "CopyCommands",
+        "UploadBytes",
+        "CpuAllocations",
+        "CpuAllocatedBytes",
+        "SkippedRootSignatureChanges",
+        "SkippedDescriptorHeapChanges",
+        "SkippedPipelineChanges",
+        "SkippedRootParameterWrites",
+        "SkippedTopologyChanges",
+        "SkippedVertexBufferBinds",
+        "SkippedIndexBufferBinds",
+    };
+    static_assert(sizeof(counterNames) / sizeof(counterNames[0]) == static_cast<size_t>(RenderCounter::Count), "Falta el nombre de algún contador");
+}
+
+namespace RenderStats
+{
+    const char* CounterName(RenderCounter counter)
+    {
+        return counterNames[static_cast<size_t>(counter)];
+    }
+
+    void Add(RenderCounter counter, uint64_t amount)
+    {
+        ThreadCounters& thread = CurrentThread();
+        thread.total.Add(counter, amount);
+
+        int32_t pass = thread.CurrentPass();
+        if (pass >= 0)
+        {
+            thread.passCounters[pass].Add(counter, amount);
+        }
+    }
+
+    void BeginPass(const char* name)
+    {
+        ThreadCounters& thread = CurrentThread();
+        if (thread.passDepth < ThreadCounters::MaxNesting)
+        {
+            thread.passStack[thread.passDepth++] = thread.FindOrAddPass(name);
+        }
+        else
+        {
+            thread.passOverflow++;
+        }
+    }
+
+    void EndPass()
+    {
+        ThreadCounters& thread = CurrentThread();
+        if (thread.passOverflow > 0)
+        {
+            thread.passOverflow--;
+        }
+        else if (thread.passDepth > 0)
+        {
+            thread.passDepth--;
+        }
+    }
+
+    void EndFrame()
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        RenderFrameStats& frame = registry.lastFrame;
+        frame.frame = registry.frameCount;
+        frame.total = RenderCounters();
+        frame.passCount = 0;
+
+        for (auto& thread : registry.threads)
+        {
+            thread->total.Drain(frame.total);
+
+            // Los nombres de pase se conservan para que los índices de pases abiertos sigan siendo válidos.
+            uint32_t passCount = thread->passCount.load(std::memory_order_acquire);
+            for (uint32_t i = 0; i < passCount; i++)
+            {
+                int32_t pass = FindOrAddPass(frame.passes, frame.passCount, thread->passNames[i]);
+                if (pass >= 0)
+                {
+                    thread->passCounters[i].Drain(frame.passes[pass].counters);
+                }
+                else
+                {
+                    RenderCounters dropped;
+                    thread->passCounters[i].Drain(dropped);
+                }
+            }
+        }
+
+        registry.history[registry.frameCount % HistoryCapacity] = frame.total;
+        registry.frameCount++;
+    }
+
+    const RenderFrameStats& LastFrame()
+    {
+        return GetRegistry().lastFrame;
+    }
+
+    void WriteCsv(std::ostream& stream)
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        stream << "frame";
+        for (const char* name : counterNames)
+        {
+            stream << ',' << name;
+        }
+        stream << '\n';
+
+        uint64_t first = registry.frameCount > HistoryCapacity ? registry.frameCount - HistoryCapacity : 0;
+        for (uint64_t frame = first; frame < registry.frameCount; frame++)
+        {
+            const RenderCounters& counters = registry.history[frame % HistoryCapacity];
+            stream << frame;
+            for (uint64_t value : counters.values)
+            {
+                stream << ',' << value;
+            }
+            stream << '\n';
+        }
+    }
+
+    size_t FormatSummary(wchar_t* buffer, size_t bufferSize)
+    {
+        const RenderCounters& total = LastFrame().total;
+        uint64_t skipped = 0;
+        for (size_t i = static_cast<size_t>(RenderCounter::SkippedRootSignatureChanges); i <= static_cast<size_t>(RenderCounter::SkippedIndexBufferBinds); i++)
+        {
+            skipped += total.values[i];
+        }
+        int written = swprintf(buffer, bufferSize, L"Draws %llu | Tris %llu | PSO %llu | Skipped %llu | Barriers %llu | Upload %.1f KB | Allocs %llu",
+            static_cast<unsigned long long>(total[RenderCounter::DrawCalls]),
+            static_cast<unsigned long long>(total[RenderCounter::Primitives]),
+            static_cast<unsigned long long>(total[RenderCounter::PipelineChanges]),
+            static_cast<unsigned long long>(skipped),
+            static_cast<unsigned long long>(total[RenderCounter::Barriers]),
+            static_cast<double>(total[RenderCounter::UploadBytes]) / 1024.0,
+            static_cast<unsigned long long>(total[RenderCounter::CpuAllocations]));
+        return written > 0 ? static_cast<size_t>(written) : 0;
+    }
+}
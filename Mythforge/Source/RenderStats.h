@@ -0,0 +1,133 @@
+﻿/**
+ * @file RenderStats.h
+ * @brief Contadores por fotograma y por pase del trabajo enviado a la GPU.
+ *
+ * Las rutas que graban comandos (Cube::Render, Renderer::SetRenderTargets, UpdateBufferResource...)
+ * suman dibujos, cambios de estado, barreras, escrituras de descriptores y bytes subidos. Cada
+ * hilo acumula en su propio bloque con incrementos atómicos relajados, sin competir con los
+ * demás; RenderStats::EndFrame los funde en el resultado del fotograma y guarda los totales en
+ * un historial para el volcado CSV.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+enum class RenderCounter : uint32_t {
+    DrawCalls,
+    Primitives,
+    PipelineChanges,
+    RootSignatureChanges,
+    DescriptorHeapChanges,
+    RootParameterWrites,
+    TopologyChanges,
+    VertexBufferBinds,
+    IndexBufferBinds,
+    RenderTargetBinds,
+    Clears,
+    Barriers,
+    DescriptorWrites,
+    CopyCommands,
+    UploadBytes,
+    CpuAllocations,     ///< Asignaciones de memoria de CPU del fotograma, de AllocationTracker
+    CpuAllocatedBytes,
+    SkippedRootSignatureChanges,    ///< Llamadas descartadas por CommandContext porque no cambiaban el estado
+    SkippedDescriptorHeapChanges,
+    SkippedPipelineChanges,
+    SkippedRootParameterWrites,
+    SkippedTopologyChanges,
+    SkippedVertexBufferBinds,
+    SkippedIndexBufferBinds,
+    Count
+};
+
+/**
+ * @struct RenderCounters
+ * @brief Un valor por contador.
+ */
+struct RenderCounters {
+    uint64_t values[static_cast<size_t>(RenderCounter::Count)] = {};
+
+    uint64_t& operator[](RenderCounter counter) { return values[static_cast<size_t>(counter)]; }
+    uint64_t operator[](RenderCounter counter) const { return values[static_cast<size_t>(counter)]; }
+
+    RenderCounters& operator+=(const RenderCounters& other)
+    {
+        for (size_t i = 0; i < static_cast<size_t>(RenderCounter::Count); i++)
+        {
+            values[i] += other.values[i];
+        }
+        return *this;
+    }
+};
+
+/**
+ * @struct RenderPassStats
+ * @brief Contadores de un pase con nombre.
+ */
+struct RenderPassStats {
+    const char*    name = nullptr;
+    RenderCounters counters;
+};
+
+/**
+ * @struct RenderFrameStats
+ * @brief Resultado de un fotograma ya fundido.
+ */
+struct RenderFrameStats {
+    static constexpr uint32_t MaxPasses = 16;
+
+    uint64_t        frame = 0;
+    RenderCounters  total;
+    RenderPassStats passes[MaxPasses];
+    uint32_t        passCount = 0;
+};
+
+namespace RenderStats
+{
+    /// Nombre del contador, útil como cabecera de columna.
+    const char* CounterName(RenderCounter counter);
+
+    /// Suma al bloque del hilo actual y al pase más interno abierto en él, si lo hay.
+    void Add(RenderCounter counter, uint64_t amount = 1);
+
+    /**
+     * @brief Atribuye los contadores siguientes del hilo actual al pase indicado (nombre con duración estática).
+     *
+     * Se admiten ocho niveles de anidamiento; lo que se cuente dentro de pases más profundos va al
+     * octavo.
+     */
+    void BeginPass(const char* name);
+    void EndPass();
+
+    /**
+     * @brief Funde los bloques de todos los hilos en el resultado del fotograma y los pone a cero.
+     *
+     * Se llama una vez por fotograma, tras enviarlo. Otros hilos pueden seguir sumando mientras
+     * tanto, como los cargadores de recursos; lo que sumen cuenta en este fotograma o en el siguiente.
+     */
+    void EndFrame();
+
+    /// Último fotograma fundido.
+    const RenderFrameStats& LastFrame();
+
+    /// Totales de los últimos fotogramas, uno por fila, con el nombre de cada contador como columna.
+    void WriteCsv(std::ostream& stream);
+
+    /// Texto corto con los contadores principales del último fotograma, para mostrarlo en pantalla.
+    size_t FormatSummary(wchar_t* buffer, size_t bufferSize);
+}
+
+/**
+ * @class RenderStatsPass
+ * @brief Pase de contadores ligado a la vida del objeto.
+ */
+class RenderStatsPass {
+public:
+    explicit RenderStatsPass(const char* name) { RenderStats::BeginPass(name); }
+    ~RenderStatsPass() { RenderStats::EndPass(); }
+
+    RenderStatsPass(const RenderStatsPass&) = delete;
+    RenderStatsPass& operator=(const RenderStatsPass&) = delete;
+};
@@ -0,0 +1,148 @@
+﻿/**
+ * @file RenderThread.cpp
+ * @brief Implementación del hilo de render y de sus colas de paquetes.
+ */
+
+#include "pch.h"
+#include "RenderThread.h"
+#include "Profiler.h"
+#include <algorithm>
+
+namespace
+{
+    uint64_t MicrosecondsSince(uint64_t startTicks)
+    {
+        return static_cast<uint64_t>(Profiler::TicksToMicroseconds(Profiler::Now() - startTicks));
+    }
+}
+
+RenderThread::RenderThread(uint32_t depth, RenderFunction render)
+    : depth((std::max)(depth, 1u)), render(std::move(render)), freePackets(this->depth), readyPackets(this->depth)
+{
+    // Cada cola tiene sitio para todos los paquetes: TryPush nunca encuentra la cola llena.
+    for (uint32_t i = 0; i < this->depth; i++)
+    {
+        freePackets.TryPush(i);
+    }
+    thread = std::thread(&RenderThread::ThreadLoop, this);
+}
+
+RenderThread::~RenderThread()
+{
+    Stop();
+}
+
+void RenderThread::RethrowFailure() const
+{
+    if (failed.load(std::memory_order_acquire))
+    {
+        std::rethrow_exception(failure);
+    }
+}
+
+uint32_t RenderThread::Acquire()
+{
+    PROFILE_FUNCTION();
+    RethrowFailure();
+    uint32_t packet = 0;
+    if (freePackets.TryPop(packet)) return packet;
+
+    uint64_t start = Profiler::Now();
+    for (;;)
+    {
+        uint64_t key = packetFree.PrepareWait();
+        if (freePackets.TryPop(packet))
+        {
+            packetFree.CancelWait();
+            break;
+        }
+        if (failed.load(std::memory_order_acquire))
+        {
+            packetFree.CancelWait();
+            RethrowFailure();
+        }
+        packetFree.Wait(key);
+    }
+    stats.gameWait += MicrosecondsSince(start);
+    return packet;
+}
+
+void RenderThread::Submit(uint32_t packet)
+{
+    RethrowFailure();
+    pending.fetch_add(1, std::memory_order_relaxed);
+    readyPackets.TryPush(packet);
+    packetReady.NotifyOne();
+}
+
+void RenderThread::Flush()
+{
+    while (pending.load(std::memory_order_acquire) != 0)
+    {
+        uint64_t key = packetFree.PrepareWait();
+        if (pending.load(std::memory_order_acquire) == 0 || failed.load(std::memory_order_acquire))
+        {
+            packetFree.CancelWait();
+            break;
+        }
+        packetFree.Wait(key);
+    }
+    // Tras un fallo quedan paquetes sin grabar: pending ya no llega a cero.
+    RethrowFailure();
+}
+
+void RenderThread::Stop()
+{
+    stopping.store(true, std::memory_order_release);
+    packetReady.NotifyOne();
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+}
+
+void RenderThread::ThreadLoop()
+{
+    Profiler::SetThreadName("Render");
+    for (;;)
+    {
+        uint32_t packet = 0;
+        if (!readyPackets.TryPop(packet))
+        {
+            // stopping se publica después del último Submit: si está puesto y la cola vacía, no queda nada.
+            if (stopping.load(std::memory_order_acquire)) break;
+
+            uint64_t start = Profiler::Now();
+            uint64_t key = packetReady.PrepareWait();
+            if (readyPackets.Empty() && !stopping.load(std::memory_order_acquire))
+            {
+                packetReady.Wait(key);
+            }
+            else
+            {
+                packetReady.CancelWait();
+            }
+            stats.renderIdle += MicrosecondsSince(start);
+            continue;
+        }
+
+        try
+        {
+            render(packet);
+        }
+        catch (...)
+        {
+            // El paquete no se devuelve: el hilo de juego ya no puede seguir entregando.
+            failure = std::current_exception();
+            failed.store(true, std::memory_order_release);
+            packetFree.NotifyAll();
+            break;
+        }
+
+        stats.packets++;
+        freePackets.TryPush(packet);
+        pending.fetch_sub(1, std::memory_order_release);
+        // Acquire y Flush esperan en el mismo EventCount.
+        packetFree.NotifyAll();
+    }
+}
@@ -0,0 +1,91 @@
+﻿/**
+ * @file RenderThread.h
+ * @brief Hilo de render que graba y envía los paquetes de fotograma que prepara el hilo de juego.
+ *
+ * El hilo de juego y el de render se reparten un número fijo de paquetes, identificados por su
+ * índice. El de juego toma uno libre con Acquire, lo rellena y lo entrega con Submit; desde ese
+ * momento no vuelve a tocarlo hasta que el de render termina con él y lo devuelve a la cola de
+ * libres. Con dos paquetes se graba el fotograma N mientras se prepara el N+1: un fotograma de
+ * solapamiento de CPU, y el hilo de juego se detiene en Acquire si el de render se queda atrás.
+ *
+ * Las dos colas son SpscRing (cada una tiene un solo productor y un solo consumidor) y la espera
+ * va por EventCount, así que entregar y recuperar un paquete no toma ningún mutex mientras el
+ * otro hilo no esté dormido.
+ *
+ * Si la función de grabado lanza una excepción (un ThrowIfFailed por dispositivo perdido, por
+ * ejemplo), el hilo de render la guarda y deja de consumir paquetes; Acquire, Submit y Flush la
+ * relanzan en el hilo de juego, como si el fallo hubiera ocurrido allí.
+ *
+ * RenderThread no sabe qué contiene un paquete: recibe una función que graba el paquete de un
+ * índice. No depende de Direct3D, así que la herramienta CommandReplay la usa con sus backends.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <thread>
+#include "ConcurrentQueues.h"
+
+/**
+ * @struct RenderThreadStats
+ * @brief Contadores acumulados desde el arranque. Los tiempos van en microsegundos.
+ */
+struct RenderThreadStats {
+    uint64_t packets = 0;           ///< Paquetes grabados
+    uint64_t gameWait = 0;          ///< Tiempo del hilo de juego bloqueado en Acquire: el render va por detrás
+    uint64_t renderIdle = 0;        ///< Tiempo del hilo de render esperando paquete: el juego va por detrás
+};
+
+/**
+ * @class RenderThread
+ * @brief Hilo que consume, en orden, paquetes de una cola acotada.
+ */
+class RenderThread {
+public:
+    using RenderFunction = std::function<void(uint32_t packet)>;
+
+    /// depth paquetes en circulación, al menos 1; render se llama en el hilo de render. Arranca el hilo.
+    RenderThread(uint32_t depth, RenderFunction render);
+    ~RenderThread();
+
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    uint32_t Depth() const { return depth; }
+
+    /// Índice de un paquete libre; espera a que el hilo de render suelte uno. Relanza el fallo del hilo de render.
+    uint32_t Acquire();
+
+    /// Entrega al hilo de render el paquete tomado con Acquire. Relanza el fallo del hilo de render.
+    void Submit(uint32_t packet);
+
+    /// Espera a que se hayan grabado todos los paquetes entregados. Después el hilo de render no toca nada hasta el siguiente Submit.
+    /// Relanza el fallo del hilo de render.
+    void Flush();
+
+    /// Graba lo entregado y termina el hilo. No puede entregarse nada después.
+    void Stop();
+
+    /// Se lee sin sincronizar; vale para mostrarlo.
+    const RenderThreadStats& Stats() const { return stats; }
+
+private:
+    void ThreadLoop();
+    void RethrowFailure() const;
+
+    uint32_t               depth;
+    RenderFunction         render;
+    std::thread            thread;
+
+    SpscRing<uint32_t>     freePackets;         ///< Del hilo de render al de juego
+    SpscRing<uint32_t>     readyPackets;        ///< Del hilo de juego al de render
+    EventCount             packetFree;          ///< Despierta a Acquire y a Flush
+    EventCount             packetReady;         ///< Despierta al hilo de render
+    std::atomic<uint32_t>  pending{ 0 };        ///< Entregados y aún no grabados
+    std::atomic<bool>      stopping{ false };
+    std::exception_ptr     failure;             ///< Lo escribe el hilo de render antes de publicar failed
+    std::atomic<bool>      failed{ false };
+    RenderThreadStats      stats;               ///< gameWait lo escribe el hilo de juego; el resto, el de render
+};
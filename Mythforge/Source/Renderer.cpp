@@ -10,7 +10,38 @@
 #include <stdexcept>
 #include <iostream>
 #include "DeviceUtils.h"
+#include "AsyncFile.h"
+#include "CommandCapture.h"
+#include "Profiler.h"
+#include "RenderStats.h"
 #include <string>
+#include <thread>
+
+namespace
+{
+    /// Reloj del FramePacer: microsegundos del reloj del perfilador, el mismo al que GpuProfiler alinea la GPU.
+    int64_t PacerTime(uint64_t profilerTicks)
+    {
+        return static_cast<int64_t>(Profiler::TimestampToMicroseconds(profilerTicks));
+    }
+
+    int64_t PacerNow()
+    {
+        return PacerTime(Profiler::Now());
+    }
+
+    constexpr uint32_t RenderSizeAlignment = 8;   ///< La regin dibujada crece y decrece de 8 en 8 pxeles
+
+    D3D12_VIEWPORT ToD3D12(const RenderViewport& viewport)
+    {
+        return { viewport.topLeftX, viewport.topLeftY, viewport.width, viewport.height, viewport.minDepth, viewport.maxDepth };
+    }
+
+    D3D12_RECT ToD3D12(const RenderScissor& scissor)
+    {
+        return { scissor.left, scissor.top, scissor.right, scissor.bottom };
+    }
+}
 
 void Renderer::Initialize(CoreWindow^ coreWindow) {
     window = coreWindow;
@@ -25,22 +56,31 @@ void Renderer::Initialize(CoreWindow^ coreWindow) {
     }
 #endif
 
-    ComPtr<IDXGIAdapter4> dxgiAdapter4 = GetAdapter();
-    d3dDevice = CreateDevice(dxgiAdapter4);
+    adapter = GetAdapter();
+    d3dDevice = CreateDevice(adapter);
     commandQueue = CreateCommandQueue(d3dDevice);
     swapChain = CreateSwapChain(window.Get(), commandQueue, frameCount);
     backBufferIndex = swapChain->GetCurrentBackBufferIndex();
-    rtvDescriptorHeap = CreateDescriptorHeap(d3dDevice, frameCount);
+    // Tras las vistas de los bferes traseros va la de sceneColor.
+    rtvDescriptorHeap = CreateDescriptorHeap(d3dDevice, frameCount + 1);
     rtvDescriptorSize = d3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
     dsvDescriptorHeap = CreateDescriptorHeap(d3dDevice, 1, D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
 
+    D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
+    srvHeapDesc.NumDescriptors = 1;
+    srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+    srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+    DX::ThrowIfFailed(d3dDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&srvDescriptorHeap)));
+
     NAME_D3D12_OBJECT(d3dDevice);
     NAME_D3D12_OBJECT(commandQueue);
     NAME_D3D12_OBJECT(rtvDescriptorHeap);
     NAME_D3D12_OBJECT(dsvDescriptorHeap);
+    NAME_D3D12_OBJECT(srvDescriptorHeap);
 
     UpdateRenderTargetViews(d3dDevice, swapChain, rtvDescriptorHeap, renderTargets, frameCount);
-    UpdateDepthStencilView(d3dDevice, dsvDescriptorHeap, depthStencil, static_cast<int>(window->Bounds.Width), static_cast<int>(window->Bounds.Height));
+    UpdateViewportPerspective(static_cast<UINT>(window->Bounds.Width), static_cast<UINT>(window->Bounds.Height));
+    CreateSceneTarget();
 
     for (int i = 0; i < frameCount; i++) {
         commandAllocators[i] = CreateCommandAllocator(d3dDevice);
@@ -53,10 +93,17 @@ void Renderer::Initialize(CoreWindow^ coreWindow) {
     fence = CreateFence(d3dDevice);
     fenceEvent = CreateEventHandle();
 
-    UpdateViewportPerspective();
+    gpuProfiler.Initialize(d3dDevice.Get(), commandQueue.Get(), frameCount);
+
+    UpdateMemoryBudget(adapter);
 }
 
 void Renderer::Destroy() {
+    gpuProfiler.Destroy();
+    upscalePipeline.Reset();
+    upscaleRootSignature.Reset();
+    sceneColor.Reset();
+    srvDescriptorHeap.Reset();
     fence->Release();
     commandList->Release();
     for (auto commandAllocator : commandAllocators) {
@@ -66,17 +113,112 @@ void Renderer::Destroy() {
     for (auto renderTarget : renderTargets) {
         renderTarget->Release();
     }
+    swapChain.Reset();
     dsvDescriptorHeap->Release();
     rtvDescriptorHeap->Release();
     commandQueue->Release();
     d3dDevice->Release();
 }
 
-void Renderer::UpdateViewportPerspective() {
-    float aspectRatio = window->Bounds.Width / window->Bounds.Height;
-    scissorRect = { 0, 0, static_cast<LONG>(window->Bounds.Width), static_cast<LONG>(window->Bounds.Height) };
-    screenViewport = { 0.0f, 0.0f, window->Bounds.Width, window->Bounds.Height, 0.0f, 1.0f };
-    perspectiveMatrix = XMMatrixPerspectiveFovRH(fovAngleY, aspectRatio, 0.01f, 100.0f);
+XMMATRIX Renderer::Projection(ResolutionSize output)
+{
+    return XMMatrixPerspectiveFovRH(fovAngleY, DynamicResolution::AspectRatio(output), 0.01f, 100.0f);
+}
+
+void Renderer::UpdateViewportPerspective(UINT width, UINT height) {
+    outputSize = { width, height };
+
+    // El destino interno cubre al menos la salida: mientras cargan los shaders de ampliacin se usa su profundidad con el bfer trasero.
+    float targetScale = (std::max)(resolutionController.Config().maxScale, 1.0f);
+    targetSize = DynamicResolution::ScaledSize(outputSize, targetScale, ResolutionSize{ UINT32_MAX, UINT32_MAX }, 1);
+
+    scissorRect = ToD3D12(DynamicResolution::Scissor(outputSize));
+    screenViewport = ToD3D12(DynamicResolution::Viewport(outputSize));
+    perspectiveMatrix = Projection(outputSize);
+    ApplyRenderScale();
+}
+
+void Renderer::ApplyRenderScale()
+{
+    renderSize = DynamicResolution::ScaledSize(outputSize, resolutionController.Scale(), targetSize, RenderSizeAlignment);
+    renderViewport = ToD3D12(DynamicResolution::Viewport(renderSize));
+    renderScissor = ToD3D12(DynamicResolution::Scissor(renderSize));
+}
+
+void Renderer::CreateSceneTarget()
+{
+    // La escala actual solo cambia el viewport: el destino y la profundidad se crean una vez por tamao de salida.
+    depthStencil.Reset();
+    UpdateDepthStencilView(d3dDevice, dsvDescriptorHeap, depthStencil, targetSize.width, targetSize.height);
+
+    sceneColor.Reset();
+    CreateRenderTargetTexture(d3dDevice, sceneColor, targetSize.width, targetSize.height, DXGI_FORMAT_R8G8B8A8_UNORM,
+        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, DirectX::Colors::CornflowerBlue);
+    NAME_D3D12_OBJECT(sceneColor);
+    TrackResource(sceneColor, MemoryCategory::RenderTargets, "sceneColor");
+
+    CD3DX12_CPU_DESCRIPTOR_HANDLE rtv(rtvDescriptorHeap->GetCPUDescriptorHandleForHeapStart(), frameCount, rtvDescriptorSize);
+    d3dDevice->CreateRenderTargetView(sceneColor.Get(), nullptr, rtv);
+    CommandCapture::RegisterRenderTargetView(sceneColor.Get(), rtv);
+    d3dDevice->CreateShaderResourceView(sceneColor.Get(), nullptr, srvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
+    RenderStats::Add(RenderCounter::DescriptorWrites, 2);
+}
+
+Task<void> Renderer::LoadUpscalePipeline(JobSystem& jobSystem)
+{
+    Task<std::vector<uint8_t>> vertexShaderFile = AssetLoading::ReadFile(jobSystem, L"Shaders\\VertexShaders\\Fullscreen.cso");
+    Task<std::vector<uint8_t>> pixelShaderFile = AssetLoading::ReadFile(jobSystem, L"Shaders\\PixelShaders\\Upscale.cso");
+    co_await WhenAll(vertexShaderFile, pixelShaderFile);
+    std::vector<uint8_t> vertexShader = co_await vertexShaderFile;
+    std::vector<uint8_t> pixelShader = co_await pixelShaderFile;
+
+    // Las lecturas reanudan en el JobSystem: la firma y el PSO se crean en uno de sus hilos.
+    {
+        CD3DX12_DESCRIPTOR_RANGE rangeSRV;
+        CD3DX12_ROOT_PARAMETER parameter[2];
+        rangeSRV.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+        parameter[0].InitAsDescriptorTable(1, &rangeSRV, D3D12_SHADER_VISIBILITY_PIXEL);
+        parameter[1].InitAsConstants(sizeof(UpscaleConstants) / sizeof(uint32_t), 0, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+
+        CD3DX12_STATIC_SAMPLER_DESC sampler(0, D3D12_FILTER_MIN_MAG_MIP_LINEAR,
+            D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP);
+        sampler.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+        D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags =
+            D3D12_ROOT_SIGNATURE_FLAG_DENY_VERTEX_SHADER_ROOT_ACCESS |
+            D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+            D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS |
+            D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS;
+
+        CD3DX12_ROOT_SIGNATURE_DESC descRootSignature;
+        descRootSignature.Init(_countof(parameter), parameter, 1, &sampler, rootSignatureFlags);
+
+        ComPtr<ID3DBlob> pSignature;
+        ComPtr<ID3DBlob> pError;
+        DX::ThrowIfFailed(D3D12SerializeRootSignature(&descRootSignature, D3D_ROOT_SIGNATURE_VERSION_1, pSignature.GetAddressOf(), pError.GetAddressOf()));
+        DX::ThrowIfFailed(d3dDevice->CreateRootSignature(0, pSignature->GetBufferPointer(), pSignature->GetBufferSize(), IID_PPV_ARGS(&upscaleRootSignature)));
+        NAME_D3D12_OBJECT(upscaleRootSignature);
+
+        // Sin bfer de vrtices: el shader saca el tringulo de SV_VertexID.
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC state = {};
+        state.pRootSignature = upscaleRootSignature.Get();
+        state.VS = CD3DX12_SHADER_BYTECODE(vertexShader.data(), vertexShader.size());
+        state.PS = CD3DX12_SHADER_BYTECODE(pixelShader.data(), pixelShader.size());
+        state.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+        state.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+        state.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+        state.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+        state.DepthStencilState.DepthEnable = FALSE;
+        state.SampleMask = UINT_MAX;
+        state.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+        state.NumRenderTargets = 1;
+        state.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+        state.SampleDesc.Count = 1;
+
+        DX::ThrowIfFailed(d3dDevice->CreateGraphicsPipelineState(&state, IID_PPV_ARGS(&upscalePipeline)));
+        NAME_D3D12_OBJECT(upscalePipeline);
+    }
+    upscaleReady.store(true, std::memory_order_release);
 }
 
 void Renderer::Resize(UINT width, UINT height) {
@@ -96,49 +238,134 @@ void Renderer::Resize(UINT width, UINT height) {
 
     UpdateRenderTargetViews(d3dDevice, swapChain, rtvDescriptorHeap, renderTargets, frameCount);
 
-    depthStencil.Reset();
-    UpdateDepthStencilView(d3dDevice, dsvDescriptorHeap, depthStencil, width, height);
+    UpdateViewportPerspective(width, height);
+    CreateSceneTarget();
+}
+
+void Renderer::WaitForFrameStart()
+{
+    PROFILE_SCOPE("FramePacing");
+    framePlan = framePacer.Plan(PacerNow());
 
-    UpdateViewportPerspective();
+    // Sleep tiene resolucin de milisegundos: se duerme hasta 2 ms antes y el resto se espera cediendo el hilo.
+    int64_t remaining = framePlan.start - PacerNow();
+    if (remaining > 2000)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(remaining - 2000));
+    }
+    while (PacerNow() < framePlan.start)
+    {
+        std::this_thread::yield();
+    }
+    frameStart = PacerNow();
 }
 
 void Renderer::ResetCommands() {
-    auto commandAllocator = commandAllocators[backBufferIndex];
+    CommandCapture::BeginFrame();
+
+    ID3D12CommandAllocator* commandAllocator = commandAllocators[backBufferIndex].Get();
     commandAllocator->Reset();
-    commandList->Reset(commandAllocator.Get(), nullptr);
+    commandList->Reset(commandAllocator, nullptr);
+    commandContext.Reset(commandList.Get());
+
+    bool gpuTimingAvailable = gpuProfiler.BeginFrame(commandList.Get(), backBufferIndex);
+    CompletePacedFrame(gpuTimingAvailable);
+    if (gpuTimingAvailable)
+    {
+        resolutionController.Update(gpuProfiler.LastFrameMs());
+        ApplyRenderScale();
+    }
 }
 
-void Renderer::SetRenderTargets()
+void Renderer::CompletePacedFrame(bool gpuTimingAvailable)
 {
-    auto backBuffer = renderTargets[backBufferIndex];
+    // El fotograma que us este bfer ya ha terminado en la GPU: se esper su fence antes de reutilizarlo.
+    FrameTiming& timing = pacedFrames[backBufferIndex];
+    if (timing.frame == 0) return;
 
-    CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(backBuffer.Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
-    commandList->ResourceBarrier(1, &barrier);
+    const std::vector<GpuScopeTiming>& scopes = gpuProfiler.LastFrame();
+    if (gpuTimingAvailable && !scopes.empty() && scopes[0].depth == 0)
+    {
+        timing.gpuStart = PacerTime(scopes[0].cpuStart);
+        timing.gpuEnd = PacerTime(scopes[0].cpuEnd);
+    }
+    framePacer.CompleteFrame(timing);
+    timing = FrameTiming();
+}
 
-    commandList->RSSetViewports(1, &screenViewport);
-    commandList->RSSetScissorRects(1, &scissorRect);
+void Renderer::ObserveVsync()
+{
+    // Las estadsticas de DXGI dan la ltima vsync en QPC; se pasa al reloj del perfilador con una lectura doble.
+    DXGI_FRAME_STATISTICS statistics;
+    if (FAILED(swapChain->GetFrameStatistics(&statistics)) || statistics.SyncQPCTime.QuadPart == 0) return;
+
+    LARGE_INTEGER now;
+    LARGE_INTEGER frequency;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&frequency);
+    int64_t sinceVsync = (now.QuadPart - statistics.SyncQPCTime.QuadPart) * 1000000 / frequency.QuadPart;
+    framePacer.OnVsync(PacerNow() - sinceVsync, statistics.SyncRefreshCount);
+}
 
-    CD3DX12_CPU_DESCRIPTOR_HANDLE rtv(rtvDescriptorHeap->GetCPUDescriptorHandleForHeapStart(), backBufferIndex, rtvDescriptorSize);
-    commandList->ClearRenderTargetView(rtv, DirectX::Colors::CornflowerBlue, 0, nullptr);
+void Renderer::SetRenderTargets()
+{
+    // Con el pase de ampliacin listo la escena va a la regin de sceneColor que marca la escala; si no, al bfer trasero.
+    upscaling = upscaleReady.load(std::memory_order_acquire);
+    ID3D12Resource* target = upscaling ? sceneColor.Get() : renderTargets[backBufferIndex].Get();
+    D3D12_RESOURCE_STATES targetState = upscaling ? D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE : D3D12_RESOURCE_STATE_PRESENT;
+
+    CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(target, targetState, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    commandContext.ResourceBarrier(1, &barrier);
+
+    commandContext.RSSetViewports(1, upscaling ? &renderViewport : &screenViewport);
+    commandContext.RSSetScissorRects(1, upscaling ? &renderScissor : &scissorRect);
 
+    CD3DX12_CPU_DESCRIPTOR_HANDLE rtv(rtvDescriptorHeap->GetCPUDescriptorHandleForHeapStart(), upscaling ? frameCount : backBufferIndex, rtvDescriptorSize);
     CD3DX12_CPU_DESCRIPTOR_HANDLE dsv(dsvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-    commandList->ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+    {
+        PROFILE_GPU_SCOPE(gpuProfiler, commandList.Get(), "Clear");
+        commandContext.ClearRenderTargetView(rtv, DirectX::Colors::CornflowerBlue);
+        commandContext.ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0);
+    }
 
-    commandList->OMSetRenderTargets(1, &rtv, false, &dsv);
+    commandContext.OMSetRenderTargets(1, &rtv, false, &dsv);
 }
 
 void Renderer::Present()
 {
-    auto backBuffer = renderTargets[backBufferIndex];
+    if (upscaling)
+    {
+        PROFILE_GPU_SCOPE(gpuProfiler, commandList.Get(), "Upscale");
+        CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(sceneColor.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        commandContext.ResourceBarrier(1, &barrier);
+        Upscale();
+    }
+    else
+    {
+        const auto& backBuffer = renderTargets[backBufferIndex];
 
-    CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(backBuffer.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
-    commandList->ResourceBarrier(1, &barrier);
+        CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(backBuffer.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+        PROFILE_GPU_SCOPE(gpuProfiler, commandList.Get(), "Present Transition");
+        commandContext.ResourceBarrier(1, &barrier);
+    }
+    gpuProfiler.EndFrame(commandList.Get());
 
     DX::ThrowIfFailed(commandList->Close());
     ID3D12CommandList* const commandLists[] = { commandList.Get() };
     commandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
 
-    DX::ThrowIfFailed(swapChain->Present(1, 0));
+    FrameTiming& timing = pacedFrames[backBufferIndex];
+    timing.frame = framePlan.frame;
+    timing.start = frameStart;
+    timing.cpuEnd = PacerNow();
+
+    DX::ThrowIfFailed(swapChain->Present(framePlan.interval, 0));
+    ObserveVsync();
+    if (CommandCapture::IsRecording())
+    {
+        CommandCapture::RecordPacket(CommandOp::Present, nullptr, 0);
+    }
+    CommandCapture::EndFrame();
     frameFenceValues[backBufferIndex] = Signal(commandQueue, fence, fenceValue);
 
     backBufferIndex = swapChain->GetCurrentBackBufferIndex();
@@ -146,6 +373,45 @@ void Renderer::Present()
     WaitForFenceValue(fence, frameFenceValues[backBufferIndex], fenceEvent);
 }
 
+void Renderer::Upscale()
+{
+    // La captura se queda con la escena a resolucin de render: al reproducirla se presenta sceneColor.
+    ID3D12GraphicsCommandList2* list = commandList.Get();
+    const auto& backBuffer = renderTargets[backBufferIndex];
+
+    CD3DX12_RESOURCE_BARRIER toRenderTarget = CD3DX12_RESOURCE_BARRIER::Transition(backBuffer.Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    list->ResourceBarrier(1, &toRenderTarget);
+
+    CD3DX12_CPU_DESCRIPTOR_HANDLE rtv(rtvDescriptorHeap->GetCPUDescriptorHandleForHeapStart(), backBufferIndex, rtvDescriptorSize);
+    list->OMSetRenderTargets(1, &rtv, false, nullptr);
+    list->RSSetViewports(1, &screenViewport);
+    list->RSSetScissorRects(1, &scissorRect);
+
+    UpscaleConstants constants = DynamicResolution::Upscale(renderSize, targetSize);
+    ID3D12DescriptorHeap* heaps[] = { srvDescriptorHeap.Get() };
+    list->SetGraphicsRootSignature(upscaleRootSignature.Get());
+    list->SetDescriptorHeaps(_countof(heaps), heaps);
+    list->SetGraphicsRootDescriptorTable(0, srvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+    list->SetGraphicsRoot32BitConstants(1, sizeof(constants) / sizeof(uint32_t), &constants, 0);
+    list->SetPipelineState(upscalePipeline.Get());
+    list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    list->DrawInstanced(3, 1, 0, 0);
+
+    CD3DX12_RESOURCE_BARRIER toPresent = CD3DX12_RESOURCE_BARRIER::Transition(backBuffer.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+    list->ResourceBarrier(1, &toPresent);
+
+    // El estado fijado aqu no es el que recuerda CommandContext; los contadores se suman a mano.
+    commandContext.InvalidateState();
+    RenderStats::Add(RenderCounter::DrawCalls);
+    RenderStats::Add(RenderCounter::Primitives);
+    RenderStats::Add(RenderCounter::Barriers, 2);
+}
+
+void Renderer::WaitForGpu()
+{
+    Flush(commandQueue, fence, fenceValue, fenceEvent);
+}
+
 void Renderer::CloseCommandsAndFlush()
 {
     commandList->Close();
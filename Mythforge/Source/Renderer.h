@@ -9,6 +9,12 @@
 #include <dxgi1_6.h>
 #include <wrl.h>
 #include <Windows.h>
+#include <atomic>
+#include "GpuProfiler.h"
+#include "CommandContext.h"
+#include "FramePacer.h"
+#include "DynamicResolution.h"
+#include "Task.h"
 
 using namespace Microsoft::WRL;
 using namespace Platform;
@@ -18,11 +24,18 @@ class Renderer {
 public:
     
     void Initialize(CoreWindow^ coreWindow);
+    /// Shaders y PSO del pase de ampliacin. Hasta que acaba, la escena se dibuja directamente en el bfer trasero.
+    Task<void> LoadUpscalePipeline(JobSystem& jobSystem);
     void Destroy();
-    void UpdateViewportPerspective();
+    void UpdateViewportPerspective(UINT width, UINT height);
+    /// Solo desde el hilo que graba: no lee la ventana, el tamao llega como parmetro.
     void Resize(UINT width, UINT height);
+    /// Planifica el fotograma y espera a su inicio; debe llamarse antes de grabarlo.
+    void WaitForFrameStart();
     void ResetCommands();
     void CloseCommandsAndFlush();
+    /// Espera a que la GPU termine todo lo enviado; despus se pueden cambiar recursos que usan los fotogramas en vuelo.
+    void WaitForGpu();
     void SetRenderTargets();
     void Present();
 
@@ -38,11 +51,32 @@ public:
     HANDLE                              fenceEvent; ///< Evento para la sincronizacin del fence
 
     ComPtr<ID3D12GraphicsCommandList2>   commandList; ///< Lista de comandos de grficos
+    CommandContext                      commandContext; ///< Grabacin sobre commandList con contadores y captura
 
     UINT                                backBufferIndex;
 
     XMMATRIX                            perspectiveMatrix;
+
+    /// Proyeccin para una salida de ese tamao; el hilo de juego la calcula sin tocar el Renderer.
+    static XMMATRIX Projection(ResolutionSize output);
+
+    ComPtr<IDXGIAdapter4>               adapter; ///< Adaptador del dispositivo, para consultar el presupuesto de memoria
+
+    GpuProfiler                         gpuProfiler; ///< Tiempos de GPU por mbito
+    FramePacer                          framePacer; ///< Decide cundo empieza cada fotograma y su intervalo de Present
+    ResolutionController                resolutionController; ///< Escala de render segn el tiempo de GPU
+
+    /// Tamao de la salida y de la regin del destino interno en la que se dibuja este fotograma.
+    ResolutionSize OutputSize() const { return outputSize; }
+    ResolutionSize RenderSize() const { return upscaling ? renderSize : outputSize; }
 private:
+    void CompletePacedFrame(bool gpuTimingAvailable);
+    void ObserveVsync();
+    void CreateSceneTarget();
+    /// Recalcula la regin dibujada con la escala del controlador.
+    void ApplyRenderScale();
+    /// Ampla la escena al bfer trasero. Se graba directamente sobre commandList: no se captura.
+    void Upscale();
 
     Agile<CoreWindow> window;
 
@@ -57,9 +91,25 @@ private:
 
     UINT64                              frameFenceValues[frameCount] = {};
 
+    FramePlan                           framePlan; ///< Plan del fotograma en curso
+    int64_t                             frameStart = 0; ///< Inicio real, en microsegundos del reloj del perfilador
+    FrameTiming                         pacedFrames[frameCount]; ///< Fotogramas enviados a la espera de sus tiempos de GPU
+
     D3D12_VIEWPORT                      screenViewport;
     D3D12_RECT                          scissorRect;
+    D3D12_VIEWPORT                      renderViewport; ///< Regin dibujada del destino interno
+    D3D12_RECT                          renderScissor;
+
+    ResolutionSize                      outputSize;
+    ResolutionSize                      targetSize; ///< Destino interno: la salida a la escala mxima
+    ResolutionSize                      renderSize;
+    bool                                upscaling = false; ///< El fotograma en curso dibuja en sceneColor
 
     ComPtr<ID3D12Resource>              renderTargets[frameCount];
     ComPtr<ID3D12Resource>              depthStencil;
+    ComPtr<ID3D12Resource>              sceneColor; ///< Destino interno de la escena, del tamao de targetSize
+    ComPtr<ID3D12DescriptorHeap>        srvDescriptorHeap; ///< SRV de sceneColor para el pase de ampliacin
+    ComPtr<ID3D12RootSignature>         upscaleRootSignature;
+    ComPtr<ID3D12PipelineState>         upscalePipeline;
+    std::atomic<bool>                   upscaleReady{ false }; ///< Mientras cargan los shaders se dibuja directamente en el bfer trasero
 };
\ No newline at end of file
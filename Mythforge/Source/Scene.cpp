@@ -0,0 +1,146 @@
+﻿/**
+ * @file Scene.cpp
+ * @brief Implementación de los sistemas de escena.
+ */
+
+#include "pch.h"
+#include "Scene.h"
+#include "VectorStreams.h"
+#include "Profiler.h"
+#include <cassert>
+#include <chrono>
+
+XMMATRIX ComputeWorldMatrix(const Transform& transform)
+{
+    return XMMatrixMultiply(XMMatrixRotationY(transform.yRotation),
+        XMMatrixTranslation(transform.position.x, transform.position.y, transform.position.z));
+}
+
+Transform InterpolateTransform(const Transform& from, const Transform& to, float alpha)
+{
+    Transform result;
+    XMStoreFloat3(&result.position, XMVectorLerp(XMLoadFloat3(&from.position), XMLoadFloat3(&to.position), alpha));
+    result.yRotation = from.yRotation + alpha * remainderf(to.yRotation - from.yRotation, XM_2PI);
+    return result;
+}
+
+XMFLOAT3 ComputeWorldExtents(const Transform& transform, const LocalBounds& bounds)
+{
+    // Caja envolvente de la caja local girada sobre Y.
+    float c = fabsf(cosf(transform.yRotation));
+    float s = fabsf(sinf(transform.yRotation));
+    return XMFLOAT3(
+        c * bounds.extents.x + s * bounds.extents.z,
+        bounds.extents.y,
+        s * bounds.extents.x + c * bounds.extents.z);
+}
+
+LocalBounds ComputeLocalBounds(const void* positions, size_t stride, size_t count)
+{
+    Vector3Stream stream;
+    stream.Gather(positions, stride, count);
+
+    Vector3 boundsMin;
+    Vector3 boundsMax;
+    if (!ComputeBounds(stream, boundsMin, boundsMax)) return LocalBounds{ XMFLOAT3(0.0f, 0.0f, 0.0f) };
+
+    // La caja está centrada en el origen de la entidad: en cada eje se toma la mayor distancia a él.
+    Vector3 extents = Max(-boundsMin, boundsMax);
+    return LocalBounds{ XMFLOAT3(extents.x, extents.y, extents.z) };
+}
+
+OccluderBox InnerOccluderBox(const LocalBounds& bounds, float scale)
+{
+    assert(scale > 0.0f && scale < 1.0f);
+    return OccluderBox{ XMFLOAT3(bounds.extents.x * scale, bounds.extents.y * scale, bounds.extents.z * scale) };
+}
+
+void UpdateAnimation(World& world, JobSystem& jobSystem)
+{
+    PROFILE_FUNCTION();
+    world.ParallelForEachChunk<Transform, SpinAnimation>(jobSystem, [](uint32_t count, const Entity*, Transform* transforms, SpinAnimation* spins) {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            transforms[i].yRotation += spins[i].yRotationStep;
+        }
+    });
+
+    world.ParallelForEachChunk<Transform, BobAnimation>(jobSystem, [](uint32_t count, const Entity*, Transform* transforms, BobAnimation* bobs) {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            bobs[i].phase += bobs[i].phaseStep;
+            transforms[i].position.y = bobs[i].baseHeight + bobs[i].amplitude * sinf(bobs[i].phase);
+        }
+    });
+}
+
+void BuildDrawPackets(World& world, const Transform* transforms, FXMMATRIX viewProjection, SceneCulling& culling, FrameArena& frameArena, DrawList& drawList)
+{
+    PROFILE_FUNCTION();
+    culling.bounds.Clear();
+    culling.candidates.clear();
+    culling.visible.clear();
+    culling.stats = {};
+    culling.occlusionStats = {};
+
+    XMMATRIX clipMatrix = viewProjection;
+    // Transform sigue en las consultas para elegir las mismas entidades, pero su columna no se lee.
+    world.ForEachChunk<Transform, LocalBounds, MeshInstance>([&culling, &clipMatrix, transforms](uint32_t count, const Entity* entities, Transform*, LocalBounds* bounds, MeshInstance* meshes) {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const Transform& transform = transforms[entities[i].index];
+            DrawPacket packet;
+            XMStoreFloat4x4(&packet.world, ComputeWorldMatrix(transform));
+            packet.mesh = meshes[i].mesh;
+
+            // Profundidad del origen de la entidad, como la verá el z-buffer.
+            XMVECTOR clip = XMVector3Transform(XMLoadFloat3(&transform.position), clipMatrix);
+            float depth = XMVectorGetZ(clip) / XMVectorGetW(clip);
+            packet.sortKey = DrawKey::Make(0, meshes[i].layer, meshes[i].pipelineId, meshes[i].materialId, depth);
+            culling.candidates.push_back(packet);
+            culling.bounds.Add(transform.position, ComputeWorldExtents(transform, bounds[i]));
+        }
+    });
+
+    {
+        PROFILE_SCOPE("FrustumCulling");
+        culling.bvh.Refit(culling.bounds);
+        culling.bvh.CullFrustum(ExtractFrustum(viewProjection), culling.visible, &culling.stats);
+    }
+
+    {
+        PROFILE_SCOPE("OcclusionCulling");
+        auto rasterizeStart = std::chrono::steady_clock::now();
+        culling.occlusion.Clear(viewProjection);
+        world.ForEachChunk<Transform, OccluderBox>([&culling, transforms](uint32_t count, const Entity* entities, Transform*, OccluderBox* occluders) {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                culling.occlusion.RasterizeBox(occluders[i].extents, ComputeWorldMatrix(transforms[entities[i].index]));
+            }
+            culling.occlusionStats.occluders += count;
+        });
+        culling.occlusionStats.triangles = culling.occlusion.TrianglesRasterized();
+        culling.occlusionStats.rasterizeMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - rasterizeStart).count();
+
+        CullOccluded(culling.occlusion, culling.bounds, culling.visible, &culling.occlusionStats);
+    }
+
+    drawList.count = static_cast<uint32_t>(culling.visible.size());
+    drawList.packets = frameArena.AllocateArray<DrawPacket>(drawList.count);
+    for (uint32_t i = 0; i < drawList.count; i++)
+    {
+        drawList.packets[i] = culling.candidates[culling.visible[i]];
+    }
+}
+
+void SortDrawPackets(const DrawList& drawList, DrawQueue& queue, JobSystem& jobSystem)
+{
+    PROFILE_FUNCTION();
+    queue.Clear();
+    queue.Reserve(drawList.count);
+    for (uint32_t i = 0; i < drawList.count; i++)
+    {
+        queue.Push(drawList.packets[i].sortKey, i);
+    }
+    queue.Sort(&jobSystem);
+}
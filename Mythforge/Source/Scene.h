@@ -0,0 +1,146 @@
+﻿/**
+ * @file Scene.h
+ * @brief Componentes de escena y sistemas que los recorren sobre el World de entidades.
+ */
+
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "Bvh.h"
+#include "DrawQueue.h"
+#include "Entities.h"
+#include "FrameArena.h"
+#include "Occlusion.h"
+
+using namespace DirectX;
+
+struct Cube;
+
+/**
+ * @struct Transform
+ * @brief Posición y rotación sobre el eje Y de una entidad.
+ */
+struct Transform {
+    XMFLOAT3 position;
+    float yRotation;
+};
+
+/**
+ * @struct SpinAnimation
+ * @brief Rotación continua sobre el eje Y.
+ */
+struct SpinAnimation {
+    float yRotationStep; ///< Radianes por actualización
+};
+
+/**
+ * @struct BobAnimation
+ * @brief Oscilación vertical sinusoidal alrededor de la altura base.
+ */
+struct BobAnimation {
+    float phaseStep; ///< Incremento de fase por actualización
+    float phase;
+    float amplitude;
+    float baseHeight;
+};
+
+/**
+ * @struct LocalBounds
+ * @brief Semiextensión de la caja local de la entidad, centrada en su origen.
+ */
+struct LocalBounds {
+    XMFLOAT3 extents;
+};
+
+/**
+ * @struct OccluderBox
+ * @brief Caja opaca, centrada en el origen de la entidad, que se rasteriza como oclusor.
+ *
+ * Debe quedar dentro de la geometría visible para que el recorte sea conservador, y estrictamente
+ * dentro de LocalBounds: los oclusores se rasterizan antes de probar las entidades, también la
+ * propia, y con una caja igual a sus límites la entidad solo seguiría visible por la comparación
+ * inclusiva de IsVisible; cualquier redondeo de la profundidad podría recortarla contra sí misma.
+ * Con una caja interior, la cara más cercana de los límites queda siempre delante de la del
+ * oclusor. InnerOccluderBox la calcula.
+ */
+struct OccluderBox {
+    XMFLOAT3 extents;
+};
+
+/**
+ * @struct MeshInstance
+ * @brief Malla con la que se dibuja la entidad y el estado que la ordena en la DrawQueue.
+ */
+struct MeshInstance {
+    Cube*     mesh;
+    uint32_t  pipelineId; ///< De DrawKey::AllocatePipelineId
+    uint32_t  materialId; ///< De DrawKey::AllocateMaterialId
+    DrawLayer layer;
+};
+
+/**
+ * @struct DrawPacket
+ * @brief Datos necesarios para emitir el dibujado de una entidad en el fotograma actual.
+ */
+struct DrawPacket {
+    XMFLOAT4X4 world;
+    Cube* mesh;
+    uint64_t sortKey; ///< Clave de DrawKey con la profundidad del fotograma
+};
+
+/**
+ * @struct DrawList
+ * @brief Paquetes de dibujado de un fotograma, en memoria de su FrameArena.
+ */
+struct DrawList {
+    DrawPacket* packets = nullptr;
+    uint32_t    count = 0;
+
+    const DrawPacket* begin() const { return packets; }
+    const DrawPacket* end() const { return packets + count; }
+};
+
+/**
+ * @struct SceneCulling
+ * @brief Memoria reutilizada entre fotogramas por el recorte de la escena.
+ */
+struct SceneCulling {
+    CullingBounds           bounds; ///< Caja en espacio de mundo de cada candidato
+    Bvh4                    bvh; ///< Jerarquía sobre bounds; se reajusta cada fotograma y se reconstruye si cambia el número de candidatos
+    std::vector<DrawPacket> candidates; ///< Paquetes de todas las entidades dibujables
+    std::vector<uint32_t>   visible; ///< Índices de candidatos que pasan el recorte
+    CullingStats            stats;
+    OcclusionBuffer         occlusion; ///< Profundidad de los oclusores del fotograma
+    OcclusionStats          occlusionStats;
+};
+
+XMMATRIX ComputeWorldMatrix(const Transform& transform);
+/// Interpolación lineal; el giro va por el camino más corto.
+Transform InterpolateTransform(const Transform& from, const Transform& to, float alpha);
+XMFLOAT3 ComputeWorldExtents(const Transform& transform, const LocalBounds& bounds);
+
+/**
+ * @brief Caja local centrada en el origen que contiene todas las posiciones de una malla.
+ * @param positions Dirección de la primera posición (tres floats).
+ * @param stride Bytes entre vértices consecutivos.
+ */
+LocalBounds ComputeLocalBounds(const void* positions, size_t stride, size_t count);
+
+/// Oclusor estrictamente dentro de los límites: cada semiextensión multiplicada por scale, en (0, 1).
+OccluderBox InnerOccluderBox(const LocalBounds& bounds, float scale = 0.9f);
+
+void UpdateAnimation(World& world, JobSystem& jobSystem);
+/**
+ * @brief Recorta las entidades dibujables por frustum y por oclusión y emite sus paquetes de dibujado.
+ * @param transforms Transform de cada entidad por índice de entidad, normalmente los que interpola
+ * Simulation; los del World no se leen, así que la simulación puede seguir escribiéndolos.
+ * @param frameArena Memoria del fotograma de la que sale drawList; los paquetes valen hasta su Reset.
+ */
+void BuildDrawPackets(World& world, const Transform* transforms, FXMMATRIX viewProjection, SceneCulling& culling, FrameArena& frameArena, DrawList& drawList);
+
+/**
+ * @brief Llena la cola con los paquetes de drawList y la ordena por su clave.
+ *
+ * El valor de cada elemento es el índice del paquete en drawList.
+ */
+void SortDrawPackets(const DrawList& drawList, DrawQueue& queue, JobSystem& jobSystem);
@@ -0,0 +1,58 @@
+﻿/**
+ * @file ShaderConstants.h
+ * @brief Los constant buffers que comparten el motor y los shaders.
+ *
+ * Cada lista de campos es la única definición del buffer: el struct de C++ sale de aquí y la
+ * declaración de HLSL también, en Shaders/Constants/<Nombre>.hlsli, que ShaderCompiler regenera
+ * antes de compilar. Los shaders incluyen ese fichero en lugar de declarar el cbuffer.
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include "ConstantBufferLayout.h"
+
+/**
+ * Constantes de cada objeto, en b0 de los vertex shaders.
+ * worldViewProjection: transformación de modelo a recorte, para mul(float4(pos, 1), worldViewProjection).
+ */
+#define MYTHFORGE_OBJECT_CONSTANTS(FIELD) \
+    FIELD(Hlsl::float4x4, worldViewProjection)
+
+MYTHFORGE_CONSTANT_BUFFER(ObjectConstants, 0, MYTHFORGE_OBJECT_CONSTANTS);
+
+/**
+ * Constantes raíz del pase de ampliación, en b0 del pixel shader.
+ * uvScale: coordenada de textura del destino interno que corresponde a la esquina inferior derecha de la salida.
+ * uvMax: centro del último texel dibujado; el filtrado bilineal no debe leer fuera de la región.
+ */
+#define MYTHFORGE_UPSCALE_CONSTANTS(FIELD) \
+    FIELD(Hlsl::float2, uvScale) \
+    FIELD(Hlsl::float2, uvMax)
+
+MYTHFORGE_CONSTANT_BUFFER(UpscaleConstants, 0, MYTHFORGE_UPSCALE_CONSTANTS);
+
+namespace ShaderConstants
+{
+    /**
+     * @struct GeneratedInclude
+     * @brief Fichero de Shaders/Constants con la declaración de HLSL de un buffer.
+     */
+    struct GeneratedInclude {
+        std::string fileName;
+        std::string text;
+    };
+
+    template<typename Buffer>
+    GeneratedInclude Include()
+    {
+        return { std::string(ConstantBufferTraits<Buffer>::name) + ".hlsli",
+            "// Generado desde Source/ShaderConstants.h por ShaderCompiler; no se edita a mano.\n\n" + ConstantBufferLayout::HlslDeclaration<Buffer>() };
+    }
+
+    /// Todos los buffers de este fichero. Uno nuevo se añade aquí para que tenga su .hlsli.
+    inline std::vector<GeneratedInclude> Includes()
+    {
+        return { Include<ObjectConstants>(), Include<UpscaleConstants>() };
+    }
+}
@@ -0,0 +1,182 @@
+﻿/**
+ * @file Simulation.cpp
+ * @brief Implementación del hilo de simulación y de la interpolación de instantáneas.
+ */
+
+#include "pch.h"
+#include "Simulation.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    constexpr uint32_t InterpolationGrain = 4096;  ///< Entidades por bloque del ParallelFor de Interpolate
+
+    int64_t NowMicroseconds()
+    {
+        return static_cast<int64_t>(Profiler::TimestampToMicroseconds(Profiler::Now()));
+    }
+
+    int64_t TimerTicksToMicroseconds(uint64_t ticks)
+    {
+        return static_cast<int64_t>(ticks / (DX::StepTimer::TicksPerSecond / 1000000));
+    }
+}
+
+Simulation::Simulation(World& world, JobSystem& jobSystem, double stepSeconds)
+    : world(world), jobSystem(jobSystem), stepSeconds(stepSeconds)
+{
+    timer.SetFixedTimeStep(true);
+    timer.SetTargetElapsedSeconds(stepSeconds);
+    Publish(NowMicroseconds());
+}
+
+Simulation::~Simulation()
+{
+    Stop();
+}
+
+void Simulation::Start()
+{
+    if (running.exchange(true)) return;
+    thread = std::thread(&Simulation::ThreadLoop, this);
+}
+
+void Simulation::Stop()
+{
+    running.store(false, std::memory_order_release);
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+}
+
+template<typename TTick>
+void Simulation::Step(int64_t tickTime, const TTick& tick)
+{
+    bool stepped = false;
+    tick([this, &stepped]() {
+        PROFILE_SCOPE("SimulationStep");
+        UpdateAnimation(world, jobSystem);
+        stats.steps++;
+        stepped = true;
+    });
+
+    // Si hubo que recuperar varios pasos solo se publica el último. Su instante es el de Tick menos
+    // lo que sobró sin llegar a otro paso.
+    if (stepped)
+    {
+        Publish(tickTime - TimerTicksToMicroseconds(timer.GetLeftOverTicks()));
+    }
+}
+
+void Simulation::Advance(int64_t now, uint64_t elapsedTicks)
+{
+    Step(now, [this, elapsedTicks](const auto& update) { timer.Tick(elapsedTicks, update); });
+}
+
+void Simulation::ThreadLoop()
+{
+    Profiler::SetThreadName("Simulation");
+    timer.ResetElapsedTime();
+    const uint64_t stepTicks = DX::StepTimer::SecondsToTicks(stepSeconds);
+
+    while (running.load(std::memory_order_acquire))
+    {
+        // Los instantes se cuentan desde la lectura del reloj de Tick, no desde que acaban los pasos.
+        int64_t tickTime = NowMicroseconds();
+        Step(tickTime, [this](const auto& update) { timer.Tick(update); });
+
+        // Tick trunca cada intervalo a su unidad, así que se llama una vez por paso y no en la espera.
+        // Sleep tiene resolución de milisegundos: se duerme hasta 1 ms antes del paso siguiente y el resto se cede el hilo.
+        int64_t remaining = TimerTicksToMicroseconds(stepTicks - (std::min)(timer.GetLeftOverTicks(), stepTicks));
+        int64_t due = tickTime + remaining;
+        int64_t untilDue = due - NowMicroseconds();
+        if (untilDue > 1000)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(untilDue - 1000));
+        }
+        while (NowMicroseconds() < due && running.load(std::memory_order_relaxed))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void Simulation::Publish(int64_t time)
+{
+    PROFILE_FUNCTION();
+    uint32_t slot = 0;
+    {
+        std::lock_guard<std::mutex> lock(slotMutex);
+        while (slot == previousSlot || slot == currentSlot || slot == readSlots[0] || slot == readSlots[1])
+        {
+            slot++;
+        }
+    }
+
+    SimulationSnapshot& snapshot = snapshots[slot];
+    snapshot.tick = stats.steps;
+    snapshot.time = time;
+    snapshot.transforms.resize(world.IndexCapacity());
+    Transform* transforms = snapshot.transforms.data();
+    world.ForEachChunk<Transform>([transforms](uint32_t count, const Entity* entities, Transform* chunkTransforms) {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            transforms[entities[i].index] = chunkTransforms[i];
+        }
+    });
+
+    std::lock_guard<std::mutex> lock(slotMutex);
+    previousSlot = currentSlot == NoSlot ? slot : currentSlot;
+    currentSlot = slot;
+    stats.published++;
+}
+
+SimulationFrame Simulation::Interpolate(int64_t now, std::vector<Transform>& transforms)
+{
+    PROFILE_FUNCTION();
+    {
+        std::lock_guard<std::mutex> lock(slotMutex);
+        readSlots[0] = previousSlot;
+        readSlots[1] = currentSlot;
+    }
+    const SimulationSnapshot& previous = snapshots[readSlots[0]];
+    const SimulationSnapshot& current = snapshots[readSlots[1]];
+
+    // Un paso por detrás: el instante pedido cae casi siempre entre las dos instantáneas publicadas.
+    // Si la simulación se retrasa, se queda en la última en lugar de extrapolar.
+    int64_t renderTime = now - static_cast<int64_t>(stepSeconds * 1000000.0);
+    int64_t span = current.time - previous.time;
+    float alpha = 1.0f;
+    if (span > 0)
+    {
+        alpha = static_cast<float>((std::min)((std::max)(static_cast<double>(renderTime - previous.time) / span, 0.0), 1.0));
+    }
+    if (renderTime > current.time)
+    {
+        stats.heldFrames++;
+    }
+
+    SimulationFrame frame;
+    frame.previousTick = previous.tick;
+    frame.currentTick = current.tick;
+    frame.alpha = alpha;
+
+    uint32_t count = static_cast<uint32_t>(current.transforms.size());
+    uint32_t interpolated = (std::min)(count, static_cast<uint32_t>(previous.transforms.size()));
+    transforms.resize(count);
+    jobSystem.ParallelFor(count, InterpolationGrain, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            transforms[i] = i < interpolated ? InterpolateTransform(previous.transforms[i], current.transforms[i], alpha) : current.transforms[i];
+        }
+    });
+
+    std::lock_guard<std::mutex> lock(slotMutex);
+    readSlots[0] = NoSlot;
+    readSlots[1] = NoSlot;
+    return frame;
+}
@@ -0,0 +1,120 @@
+﻿/**
+ * @file Simulation.h
+ * @brief Simulación a paso fijo en su propio hilo, con instantáneas que el render interpola.
+ *
+ * El hilo de simulación avanza UpdateAnimation con un StepTimer en modo de paso fijo, de modo que
+ * la velocidad de las animaciones no depende del ritmo de fotogramas. Tras cada Tick que avanza
+ * publica una instantánea con los Transform de todas las entidades, indexados por índice de
+ * entidad y fechada con el instante de reloj que le corresponde. El render no lee los Transform
+ * del World: toma las dos últimas instantáneas publicadas e interpola entre ellas, un paso por
+ * detrás del instante actual para tener siempre las dos.
+ *
+ * Mientras la simulación está en marcha, el resto del motor solo puede leer del World componentes
+ * que la simulación no escribe (LocalBounds, MeshInstance, OccluderBox...) y no puede crear ni
+ * destruir entidades.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Scene.h"
+#include "StepTimer.h"
+
+class JobSystem;
+
+/**
+ * @struct SimulationSnapshot
+ * @brief Estado publicado por un paso de simulación.
+ */
+struct SimulationSnapshot {
+    uint64_t               tick = 0;    ///< Pasos simulados hasta esta instantánea
+    int64_t                time = 0;    ///< Instante que representa, en microsegundos del reloj del perfilador
+    std::vector<Transform> transforms;  ///< Por índice de entidad; las entradas sin Transform no significan nada
+};
+
+/**
+ * @struct SimulationFrame
+ * @brief Qué se interpoló para un fotograma.
+ */
+struct SimulationFrame {
+    uint64_t previousTick = 0;
+    uint64_t currentTick = 0;
+    float    alpha = 0.0f;              ///< 0 es la instantánea anterior y 1 la actual
+};
+
+/**
+ * @struct SimulationStats
+ * @brief Contadores acumulados desde el arranque.
+ */
+struct SimulationStats {
+    uint64_t steps = 0;                 ///< Pasos fijos ejecutados
+    uint64_t published = 0;             ///< Instantáneas publicadas; menos que steps si hubo que recuperar
+    uint64_t heldFrames = 0;            ///< Fotogramas que pidieron un instante posterior a la última instantánea
+};
+
+/**
+ * @class Simulation
+ * @brief Hilo de simulación a paso fijo que publica sus instantáneas por parejas para el render.
+ */
+class Simulation {
+public:
+    /// La primera instantánea se toma del World al construir; el hilo no arranca hasta Start.
+    Simulation(World& world, JobSystem& jobSystem, double stepSeconds = 1.0 / 60.0);
+    ~Simulation();
+
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
+    void Start();
+    /// Espera a que termine el paso en curso. Después el World vuelve a ser solo del llamante.
+    void Stop();
+
+    /**
+     * @brief Hace en el hilo que llama lo que el de simulación hace en cada vuelta, con un intervalo dado.
+     * @param now Microsegundos del reloj del perfilador en que se da por hecho el Tick.
+     * @param elapsedTicks Tiempo transcurrido desde el Tick anterior, en ticks de StepTimer.
+     *
+     * Solo con el hilo parado. Sirve para probar la simulación con intervalos conocidos.
+     */
+    void Advance(int64_t now, uint64_t elapsedTicks);
+
+    /**
+     * @brief Transform de cada entidad en el instante now, interpolados entre las dos últimas instantáneas.
+     * @param now Microsegundos del reloj del perfilador.
+     * @param transforms Se redimensiona al tamaño de la tabla de entidades; en régimen estable no asigna.
+     */
+    SimulationFrame Interpolate(int64_t now, std::vector<Transform>& transforms);
+
+    double StepSeconds() const { return stepSeconds; }
+
+    /// Se lee sin sincronizar; vale para mostrarlo.
+    const SimulationStats& Stats() const { return stats; }
+
+private:
+    /// Las dos publicadas, las dos que el render puede estar leyendo y la que se escribe.
+    static constexpr uint32_t SnapshotSlots = 5;
+    static constexpr uint32_t NoSlot = SnapshotSlots;
+
+    void ThreadLoop();
+    /// Los pasos fijos de un Tick y, si hubo alguno, la instantánea del último.
+    template<typename TTick>
+    void Step(int64_t tickTime, const TTick& tick);
+    void Publish(int64_t time);
+
+    World&             world;
+    JobSystem&         jobSystem;
+    double             stepSeconds;
+    DX::StepTimer      timer;
+    std::thread        thread;
+    std::atomic<bool>  running{ false };
+
+    SimulationSnapshot snapshots[SnapshotSlots];
+    std::mutex         slotMutex;              ///< Protege los índices de abajo, no el contenido de las instantáneas
+    uint32_t           previousSlot = NoSlot;
+    uint32_t           currentSlot = NoSlot;
+    uint32_t           readSlots[2] = { NoSlot, NoSlot };  ///< Las que está interpolando el render
+    SimulationStats    stats;
+};
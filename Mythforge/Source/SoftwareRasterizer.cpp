@@ -0,0 +1,805 @@
+﻿/**
+ * @file SoftwareRasterizer.cpp
+ * @brief Implementación del rasterizador de CPU por teselas.
+ */
+
+#include "pch.h"
+#include "SoftwareRasterizer.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "VectorMath.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    // Valores de los enumerados de Direct3D que usa la captura; CommandStream los guarda como enteros.
+    constexpr uint32_t DimensionBuffer = 1;             // D3D12_RESOURCE_DIMENSION_BUFFER
+    constexpr uint32_t DimensionTexture2D = 3;          // D3D12_RESOURCE_DIMENSION_TEXTURE2D
+    constexpr uint32_t FlagRenderTarget = 0x1;          // D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET
+    constexpr uint32_t FlagDepthStencil = 0x2;          // D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL
+    constexpr uint32_t FormatRgba8 = 28;                // DXGI_FORMAT_R8G8B8A8_UNORM
+    constexpr uint32_t FormatRgba8Srgb = 29;            // DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+    constexpr uint32_t FormatBgra8 = 87;                // DXGI_FORMAT_B8G8R8A8_UNORM
+    constexpr uint32_t FormatBgra8Srgb = 91;            // DXGI_FORMAT_B8G8R8A8_UNORM_SRGB
+    constexpr uint32_t FormatR32Uint = 42;              // DXGI_FORMAT_R32_UINT
+    constexpr uint32_t CullFront = 2;                   // D3D12_CULL_MODE_FRONT
+    constexpr uint32_t CullBack = 3;                    // D3D12_CULL_MODE_BACK
+    constexpr uint32_t TopologyTriangleList = 4;        // D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+    constexpr uint32_t ClearFlagDepth = 0x1;            // D3D12_CLEAR_FLAG_DEPTH
+
+    /// Número de texturas que suma el pixel shader TexCoord.
+    constexpr uint32_t TextureCount = 2;
+    constexpr float InverseGamma = 1.0f / 2.2f;
+
+    /// Los vértices se ajustan a 1/256 de píxel, la precisión de subpíxel de la GPU.
+    constexpr double SubpixelScale = 256.0;
+
+    struct ClipVertex {
+        float x, y, z, w;
+        float u, v;
+    };
+
+    constexpr uint32_t GammaTableSize = 1 << 16;
+
+    /**
+     * @struct ChannelTables
+     * @brief Conversión de un canal de 8 bits a float (lineal y sRGB) y corrección gamma de la salida.
+     *
+     * La tabla de gamma sustituye a pow en cada canal; con 16 bits de entrada el error es de menos
+     * de un nivel de 8 bits también cerca del negro, donde la curva es más empinada.
+     */
+    struct ChannelTables {
+        float   unorm[256];
+        float   srgb[256];
+        uint8_t gamma[GammaTableSize];
+
+        ChannelTables()
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                float value = i / 255.0f;
+                unorm[i] = value;
+                srgb[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+            }
+            for (uint32_t i = 0; i < GammaTableSize; i++)
+            {
+                gamma[i] = static_cast<uint8_t>(std::pow(i / float(GammaTableSize - 1), InverseGamma) * 255.0f + 0.5f);
+            }
+        }
+
+        /// pow(value, 1 / 2.2) saturado y convertido a 8 bits.
+        uint32_t Gamma(float value) const
+        {
+            value = (std::min)((std::max)(value, 0.0f), 1.0f);
+            return gamma[static_cast<uint32_t>(value * (GammaTableSize - 1) + 0.5f)];
+        }
+    };
+
+    const ChannelTables& Tables()
+    {
+        static const ChannelTables tables;
+        return tables;
+    }
+
+    uint32_t PackColor(const float color[4])
+    {
+        uint32_t packed = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            float value = (std::min)((std::max)(color[i], 0.0f), 1.0f);
+            packed |= static_cast<uint32_t>(value * 255.0f + 0.5f) << (8 * i);
+        }
+        return packed;
+    }
+
+    bool IsSrgb(uint32_t format)
+    {
+        return format == FormatRgba8Srgb || format == FormatBgra8Srgb;
+    }
+
+    /// Interpolación bilineal con sujeción a borde en un mip, con los cuatro canales en un registro.
+    Simd::Register SampleBilinear(const SoftwareRasterizer::Resource& texture, uint32_t mip, float u, float v)
+    {
+        const SoftwareRasterizer::MipLevel& level = texture.mips[mip];
+        float x = u * level.width - 0.5f;
+        float y = v * level.height - 0.5f;
+        float fx = std::floor(x);
+        float fy = std::floor(y);
+
+        int32_t maxX = static_cast<int32_t>(level.width) - 1;
+        int32_t maxY = static_cast<int32_t>(level.height) - 1;
+        int32_t x0 = (std::min)((std::max)(static_cast<int32_t>(fx), 0), maxX);
+        int32_t y0 = (std::min)((std::max)(static_cast<int32_t>(fy), 0), maxY);
+        int32_t x1 = (std::min)((std::max)(static_cast<int32_t>(fx) + 1, 0), maxX);
+        int32_t y1 = (std::min)((std::max)(static_cast<int32_t>(fy) + 1, 0), maxY);
+
+        const float* texels = texture.texels.data() + level.offset * 4;
+        Simd::Register t00 = Simd::Load4(texels + (y0 * level.width + x0) * 4);
+        Simd::Register t10 = Simd::Load4(texels + (y0 * level.width + x1) * 4);
+        Simd::Register t01 = Simd::Load4(texels + (y1 * level.width + x0) * 4);
+        Simd::Register t11 = Simd::Load4(texels + (y1 * level.width + x1) * 4);
+        Simd::Register tx = Simd::Replicate(x - fx);
+        Simd::Register top = Simd::Add(t00, Simd::Multiply(Simd::Subtract(t10, t00), tx));
+        Simd::Register bottom = Simd::Add(t01, Simd::Multiply(Simd::Subtract(t11, t01), tx));
+        return Simd::Add(top, Simd::Multiply(Simd::Subtract(bottom, top), Simd::Replicate(y - fy)));
+    }
+
+    /// Muestreo trilineal, como D3D12_FILTER_MIN_MAG_MIP_LINEAR con sujeción.
+    Simd::Register SampleTrilinear(const SoftwareRasterizer::Resource& texture, float u, float v, float lod)
+    {
+        float maxLod = static_cast<float>(texture.mips.size() - 1);
+        lod = (std::min)((std::max)(lod, 0.0f), maxLod);
+        uint32_t mip = static_cast<uint32_t>(lod);
+        float blend = lod - mip;
+
+        Simd::Register first = SampleBilinear(texture, mip, u, v);
+        if (blend > 0.0f && mip + 1 < texture.mips.size())
+        {
+            Simd::Register second = SampleBilinear(texture, mip + 1, u, v);
+            first = Simd::Add(first, Simd::Multiply(Simd::Subtract(second, first), Simd::Replicate(blend)));
+        }
+        return first;
+    }
+
+    /// Nivel de detalle a partir de las derivadas del cuádruple, en texels del mip 0.
+    float ComputeLod(const SoftwareRasterizer::Resource& texture, float dudx, float dvdx, float dudy, float dvdy)
+    {
+        if (texture.mips.empty()) return 0.0f;
+        float width = static_cast<float>(texture.mips[0].width);
+        float height = static_cast<float>(texture.mips[0].height);
+        float dx = (dudx * width) * (dudx * width) + (dvdx * height) * (dvdx * height);
+        float dy = (dudy * width) * (dudy * width) + (dvdy * height) * (dvdy * height);
+        float rho = (std::max)(dx, dy);
+        return rho > 0.0f ? 0.5f * std::log2(rho) : 0.0f;
+    }
+
+    bool DepthTest(uint32_t func, float value, float stored)
+    {
+        switch (func)
+        {
+        case 1: return false;               // NEVER
+        case 2: return value < stored;      // LESS
+        case 3: return value == stored;     // EQUAL
+        case 4: return value <= stored;     // LESS_EQUAL
+        case 5: return value > stored;      // GREATER
+        case 6: return value != stored;     // NOT_EQUAL
+        case 7: return value >= stored;     // GREATER_EQUAL
+        default: return true;               // ALWAYS
+        }
+    }
+
+    /// Recorta el polígono contra el semiespacio distance >= 0 (Sutherland-Hodgman).
+    template<typename Distance>
+    uint32_t ClipPolygon(const ClipVertex* input, uint32_t count, ClipVertex* output, Distance distance)
+    {
+        uint32_t written = 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const ClipVertex& a = input[i];
+            const ClipVertex& b = input[(i + 1) % count];
+            float da = distance(a);
+            float db = distance(b);
+            if (da >= 0.0f)
+            {
+                output[written++] = a;
+            }
+            if ((da >= 0.0f) != (db >= 0.0f))
+            {
+                float t = da / (da - db);
+                ClipVertex& v = output[written++];
+                v.x = a.x + (b.x - a.x) * t;
+                v.y = a.y + (b.y - a.y) * t;
+                v.z = a.z + (b.z - a.z) * t;
+                v.w = a.w + (b.w - a.w) * t;
+                v.u = a.u + (b.u - a.u) * t;
+                v.v = a.v + (b.v - a.v) * t;
+            }
+        }
+        return written;
+    }
+}
+
+double SoftwareRasterizerStats::DrawSeconds() const
+{
+    return Profiler::TicksToMicroseconds(drawTicks) * 1e-6;
+}
+
+double SoftwareRasterizerStats::MegapixelsPerSecond() const
+{
+    double seconds = DrawSeconds();
+    return seconds > 0.0 ? static_cast<double>(pixelsShaded) * 1e-6 / seconds : 0.0;
+}
+
+double SoftwareRasterizerStats::TrianglesPerSecond() const
+{
+    double seconds = DrawSeconds();
+    return seconds > 0.0 ? static_cast<double>(trianglesRasterized) / seconds : 0.0;
+}
+
+SoftwareRasterizer::SoftwareRasterizer(JobSystem* jobs)
+    : jobs(jobs)
+{
+}
+
+void SoftwareRasterizer::SetOutputSize(uint32_t width, uint32_t height)
+{
+    outputWidth = width;
+    outputHeight = height;
+}
+
+SoftwareRasterizer::Resource* SoftwareRasterizer::LookupResource(CaptureId id)
+{
+    auto found = resources.find(id);
+    return found != resources.end() ? &found->second : nullptr;
+}
+
+const CapturedView* SoftwareRasterizer::FindView(const Binding& binding) const
+{
+    auto heap = heaps.find(binding.heap);
+    if (heap == heaps.end() || binding.index >= heap->second.size())
+    {
+        return nullptr;
+    }
+    const CapturedView& view = heap->second[binding.index];
+    return view.resource ? &view : nullptr;
+}
+
+bool SoftwareRasterizer::ReadRenderTarget(std::vector<uint8_t>& pixels, uint32_t& width, uint32_t& height) const
+{
+    auto found = resources.find(presented ? presented : lastRenderTarget);
+    if (found == resources.end() || found->second.color.empty())
+    {
+        return false;
+    }
+
+    const Resource& target = found->second;
+    width = target.width;
+    height = target.height;
+    pixels.resize(target.color.size() * 4);
+    memcpy(pixels.data(), target.color.data(), pixels.size());
+    return true;
+}
+
+void SoftwareRasterizer::BeginFrame(const FrameCommand&)
+{
+    presented = 0;
+}
+
+void SoftwareRasterizer::EndFrame()
+{
+    stats.frames++;
+}
+
+void SoftwareRasterizer::DefineResource(const CapturedResource& resource, const void* initialData)
+{
+    Resource& created = resources[resource.id];
+    created = Resource();
+    created.desc = resource;
+    created.width = static_cast<uint32_t>(resource.width);
+    created.height = resource.height;
+
+    if (resource.dimension == DimensionBuffer)
+    {
+        created.bytes.assign(static_cast<size_t>(resource.width), 0);
+        if (initialData)
+        {
+            memcpy(created.bytes.data(), initialData, (std::min)(static_cast<size_t>(resource.initialDataSize), created.bytes.size()));
+        }
+        return;
+    }
+    if (resource.dimension != DimensionTexture2D)
+    {
+        return;
+    }
+
+    if (resource.flags & (FlagRenderTarget | FlagDepthStencil))
+    {
+        if (outputWidth && outputHeight)
+        {
+            created.width = outputWidth;
+            created.height = outputHeight;
+        }
+        size_t pixels = static_cast<size_t>(created.width) * created.height;
+        if (resource.flags & FlagRenderTarget) created.color.assign(pixels, 0);
+        if (resource.flags & FlagDepthStencil) created.depth.assign(pixels, 1.0f);
+        return;
+    }
+
+    // Texturas muestreables: se decodifican a RGBA lineal en float, con todos los mips del primer
+    // elemento del array, para filtrar los cuatro canales a la vez.
+    size_t texels = 0;
+    for (uint32_t mip = 0; mip < resource.mipLevels; mip++)
+    {
+        MipLevel level;
+        level.width = (std::max)(static_cast<uint32_t>(resource.width >> mip), 1u);
+        level.height = (std::max)(resource.height >> mip, 1u);
+        level.offset = texels;
+        texels += static_cast<size_t>(level.width) * level.height;
+        created.mips.push_back(level);
+    }
+    created.texels.assign(texels * 4, 0.0f);
+
+    bool bgra = resource.format == FormatBgra8 || resource.format == FormatBgra8Srgb;
+    bool rgba = resource.format == FormatRgba8 || resource.format == FormatRgba8Srgb;
+    if (initialData && (bgra || rgba) && resource.initialDataSize >= texels * 4)
+    {
+        const float* table = IsSrgb(resource.format) ? Tables().srgb : Tables().unorm;
+        const uint8_t* source = static_cast<const uint8_t*>(initialData);
+        float* destination = created.texels.data();
+        for (size_t i = 0; i < texels; i++, source += 4, destination += 4)
+        {
+            destination[0] = table[source[bgra ? 2 : 0]];
+            destination[1] = table[source[1]];
+            destination[2] = table[source[bgra ? 0 : 2]];
+            destination[3] = Tables().unorm[source[3]];
+        }
+    }
+}
+
+void SoftwareRasterizer::DefineRootSignature(const CapturedRootSignature&, const void*)
+{
+    // La disposición de la firma raíz va implícita en el programa emulado.
+}
+
+void SoftwareRasterizer::DefinePipeline(const CapturedPipeline& pipeline, const CapturedInputElement* inputElements, const void*, const void*)
+{
+    Pipeline& created = pipelines[pipeline.id];
+    created.desc = pipeline;
+    for (uint32_t i = 0; i < pipeline.inputElementCount; i++)
+    {
+        if (strcmp(inputElements[i].semanticName, "POSITION") == 0) created.positionOffset = inputElements[i].alignedByteOffset;
+        if (strcmp(inputElements[i].semanticName, "TEXCOORD") == 0) created.texCoordOffset = inputElements[i].alignedByteOffset;
+    }
+}
+
+void SoftwareRasterizer::DefineDescriptorHeap(const CapturedDescriptorHeap& heap)
+{
+    heaps[heap.id].assign(heap.count, CapturedView{});
+}
+
+void SoftwareRasterizer::DefineView(const CapturedView& view)
+{
+    auto heap = heaps.find(view.heap);
+    if (heap != heaps.end() && view.index < heap->second.size())
+    {
+        heap->second[view.index] = view;
+    }
+}
+
+void SoftwareRasterizer::ReleaseObject(const ObjectCommand& command)
+{
+    resources.erase(command.id);
+    pipelines.erase(command.id);
+    heaps.erase(command.id);
+}
+
+void SoftwareRasterizer::WriteBuffer(const BufferWriteCommand& command, const void* data)
+{
+    Resource* resource = LookupResource(command.resource);
+    if (resource && command.offset + command.size <= resource->bytes.size())
+    {
+        memcpy(resource->bytes.data() + command.offset, data, command.size);
+    }
+}
+
+void SoftwareRasterizer::SetRootSignature(const ObjectCommand&)
+{
+}
+
+void SoftwareRasterizer::SetDescriptorHeaps(const SetDescriptorHeapsCommand&)
+{
+}
+
+void SoftwareRasterizer::SetPipeline(const ObjectCommand& command)
+{
+    pipeline = command.id;
+}
+
+void SoftwareRasterizer::SetRootTable(const SetRootTableCommand& command)
+{
+    if (command.rootIndex < MaxRootTables)
+    {
+        rootTables[command.rootIndex] = Binding{ command.heap, command.index };
+    }
+}
+
+void SoftwareRasterizer::SetTopology(const SetTopologyCommand& command)
+{
+    topology = command.topology;
+}
+
+void SoftwareRasterizer::SetVertexBuffer(const SetVertexBufferCommand& command)
+{
+    if (command.slot == 0)
+    {
+        vertexBuffer = command;
+    }
+}
+
+void SoftwareRasterizer::SetIndexBuffer(const SetIndexBufferCommand& command)
+{
+    indexBuffer = command;
+}
+
+void SoftwareRasterizer::SetViewport(const ViewportCommand& command)
+{
+    viewport = command;
+}
+
+void SoftwareRasterizer::SetScissor(const ScissorCommand& command)
+{
+    scissor = command;
+}
+
+void SoftwareRasterizer::SetRenderTargets(const SetRenderTargetsCommand& command)
+{
+    renderTarget = Binding{ command.renderTargetHeap, command.renderTargetIndex };
+    depthStencil = Binding{ command.depthStencilHeap, command.depthStencilIndex };
+    if (const CapturedView* view = FindView(renderTarget))
+    {
+        lastRenderTarget = view->resource;
+    }
+}
+
+void SoftwareRasterizer::ClearRenderTarget(const ClearRenderTargetCommand& command)
+{
+    const CapturedView* view = FindView(Binding{ command.heap, command.index });
+    Resource* target = view ? LookupResource(view->resource) : nullptr;
+    if (target)
+    {
+        std::fill(target->color.begin(), target->color.end(), PackColor(command.color));
+    }
+}
+
+void SoftwareRasterizer::ClearDepth(const ClearDepthCommand& command)
+{
+    const CapturedView* view = FindView(Binding{ command.heap, command.index });
+    Resource* target = view ? LookupResource(view->resource) : nullptr;
+    if (target && (command.flags & ClearFlagDepth))
+    {
+        std::fill(target->depth.begin(), target->depth.end(), command.depth);
+    }
+}
+
+void SoftwareRasterizer::Barrier(const BarrierCommand&)
+{
+}
+
+void SoftwareRasterizer::Present()
+{
+    presented = lastRenderTarget;
+}
+
+void SoftwareRasterizer::DrawIndexed(const DrawIndexedCommand& command)
+{
+    uint64_t start = Profiler::Now();
+    stats.triangles += static_cast<uint64_t>(command.indexCount / 3) * command.instanceCount;
+
+    // Estado necesario para el programa TexCoord; lo que falte descarta el dibujo.
+    auto pipelineEntry = pipelines.find(pipeline);
+    const CapturedView* colorView = FindView(renderTarget);
+    const CapturedView* depthView = FindView(depthStencil);
+    const CapturedView* constantsView = FindView(rootTables[0]);
+    Resource* vertices = LookupResource(vertexBuffer.resource);
+    Resource* indices = LookupResource(indexBuffer.resource);
+    Resource* constants = constantsView ? LookupResource(constantsView->resource) : nullptr;
+    drawColor = colorView ? LookupResource(colorView->resource) : nullptr;
+    drawDepth = depthView ? LookupResource(depthView->resource) : nullptr;
+    if (pipelineEntry == pipelines.end() || topology != TopologyTriangleList || !drawColor || drawColor->color.empty() ||
+        !vertices || !indices || !constants || constantsView->bufferOffset + 64 > constants->bytes.size())
+    {
+        stats.drawTicks += Profiler::Now() - start;
+        return;
+    }
+    if (drawDepth && drawDepth->depth.size() != drawColor->color.size())
+    {
+        drawDepth = nullptr;
+    }
+    drawPipeline = &pipelineEntry->second;
+
+    for (uint32_t i = 0; i < TextureCount; i++)
+    {
+        Binding binding{ rootTables[1].heap, rootTables[1].index + i };
+        const CapturedView* view = FindView(binding);
+        const Resource* texture = view ? LookupResource(view->resource) : nullptr;
+        drawTextures[i] = texture && !texture->mips.empty() ? texture : nullptr;
+    }
+
+    // La matriz del cbuffer está en orden de columnas (mul(v, worldViewProjection) en HLSL, ver ObjectConstants): cada fila guardada es una salida.
+    float matrix[16];
+    memcpy(matrix, constants->bytes.data() + constantsView->bufferOffset, sizeof(matrix));
+
+    // Viewport y recorte, escalados si los destinos no tienen el tamaño capturado.
+    float scaleX = drawColor->desc.width ? static_cast<float>(drawColor->width) / static_cast<float>(drawColor->desc.width) : 1.0f;
+    float scaleY = drawColor->desc.height ? static_cast<float>(drawColor->height) / static_cast<float>(drawColor->desc.height) : 1.0f;
+    float viewportX = viewport.x * scaleX;
+    float viewportY = viewport.y * scaleY;
+    float viewportWidth = viewport.width * scaleX;
+    float viewportHeight = viewport.height * scaleY;
+    clipRect[0] = (std::max)({ 0, static_cast<int32_t>(std::floor(scissor.left * scaleX)), static_cast<int32_t>(std::floor(viewportX)) });
+    clipRect[1] = (std::max)({ 0, static_cast<int32_t>(std::floor(scissor.top * scaleY)), static_cast<int32_t>(std::floor(viewportY)) });
+    clipRect[2] = (std::min)({ static_cast<int32_t>(drawColor->width), static_cast<int32_t>(std::ceil(scissor.right * scaleX)), static_cast<int32_t>(std::ceil(viewportX + viewportWidth)) });
+    clipRect[3] = (std::min)({ static_cast<int32_t>(drawColor->height), static_cast<int32_t>(std::ceil(scissor.bottom * scaleY)), static_cast<int32_t>(std::ceil(viewportY + viewportHeight)) });
+    if (clipRect[0] >= clipRect[2] || clipRect[1] >= clipRect[3])
+    {
+        stats.drawTicks += Profiler::Now() - start;
+        return;
+    }
+
+    // Preparación: vértices, recorte contra los planos cercano y lejano, descarte de caras y ecuaciones.
+    const CapturedPipeline& state = drawPipeline->desc;
+    uint32_t indexSize = indexBuffer.format == FormatR32Uint ? 4 : 2;
+    size_t indexBytes = indexBuffer.offset < indices->bytes.size() ? (std::min)(static_cast<size_t>(indexBuffer.size), indices->bytes.size() - indexBuffer.offset) : 0;
+    size_t vertexLimit = vertexBuffer.offset < vertices->bytes.size() ? (std::min)(static_cast<size_t>(vertexBuffer.size), vertices->bytes.size() - vertexBuffer.offset) : 0;
+    size_t indexLimit = indexBytes / indexSize;
+    const uint8_t* indexData = indices->bytes.data() + (std::min)(static_cast<size_t>(indexBuffer.offset), indices->bytes.size());
+    const uint8_t* vertexData = vertices->bytes.data() + (std::min)(static_cast<size_t>(vertexBuffer.offset), vertices->bytes.size());
+    size_t vertexFootprint = (std::max)(drawPipeline->positionOffset + 12, drawPipeline->texCoordOffset + 8);
+
+    triangles.clear();
+    for (uint32_t first = 0; first + 3 <= command.indexCount && command.startIndex + first + 3 <= indexLimit; first += 3)
+    {
+        ClipVertex polygon[8];
+        ClipVertex clipped[8];
+        bool valid = true;
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            uint32_t index = 0;
+            memcpy(&index, indexData + (command.startIndex + first + corner) * indexSize, indexSize);
+            size_t offset = static_cast<size_t>(static_cast<int64_t>(index) + command.baseVertex) * vertexBuffer.stride;
+            if (static_cast<int64_t>(index) + command.baseVertex < 0 || offset + vertexFootprint > vertexLimit)
+            {
+                valid = false;
+                break;
+            }
+
+            float position[3];
+            float texCoord[2];
+            memcpy(position, vertexData + offset + drawPipeline->positionOffset, sizeof(position));
+            memcpy(texCoord, vertexData + offset + drawPipeline->texCoordOffset, sizeof(texCoord));
+
+            float clip[4];
+            for (int row = 0; row < 4; row++)
+            {
+                const float* m = matrix + row * 4;
+                clip[row] = position[0] * m[0] + position[1] * m[1] + position[2] * m[2] + m[3];
+            }
+            polygon[corner] = ClipVertex{ clip[0], clip[1], clip[2], clip[3], texCoord[0], texCoord[1] };
+        }
+        if (!valid) continue;
+
+        uint32_t count = ClipPolygon(polygon, 3, clipped, [](const ClipVertex& v) { return v.z; });
+        count = ClipPolygon(clipped, count, polygon, [](const ClipVertex& v) { return v.w - v.z; });
+
+        for (uint32_t fan = 1; fan + 1 < count; fan++)
+        {
+            const ClipVertex* corners[3] = { &polygon[0], &polygon[fan], &polygon[fan + 1] };
+            double x[3], y[3], attributes[4][3];
+            for (int i = 0; i < 3; i++)
+            {
+                const ClipVertex& v = *corners[i];
+                double inverseW = 1.0 / (std::max)(v.w, 1e-7f);
+                x[i] = std::round((viewportX + (v.x * inverseW + 1.0) * 0.5 * viewportWidth) * SubpixelScale) / SubpixelScale;
+                y[i] = std::round((viewportY + (1.0 - v.y * inverseW) * 0.5 * viewportHeight) * SubpixelScale) / SubpixelScale;
+                attributes[0][i] = viewport.minDepth + v.z * inverseW * (viewport.maxDepth - viewport.minDepth);
+                attributes[1][i] = inverseW;
+                attributes[2][i] = v.u * inverseW;
+                attributes[3][i] = v.v * inverseW;
+            }
+
+            // Con la y hacia abajo, área positiva es sentido horario.
+            double area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+            if (area == 0.0) continue;
+            bool front = state.frontCounterClockwise ? area < 0.0 : area > 0.0;
+            if ((state.cullMode == CullFront && front) || (state.cullMode == CullBack && !front)) continue;
+            if (area < 0.0)
+            {
+                std::swap(x[1], x[2]);
+                std::swap(y[1], y[2]);
+                for (auto& attribute : attributes) std::swap(attribute[1], attribute[2]);
+                area = -area;
+            }
+
+            Triangle triangle;
+            triangle.minX = (std::max)(clipRect[0], static_cast<int32_t>(std::floor((std::min)({ x[0], x[1], x[2] }))));
+            triangle.minY = (std::max)(clipRect[1], static_cast<int32_t>(std::floor((std::min)({ y[0], y[1], y[2] }))));
+            triangle.maxX = (std::min)(clipRect[2], static_cast<int32_t>(std::ceil((std::max)({ x[0], x[1], x[2] }))));
+            triangle.maxY = (std::min)(clipRect[3], static_cast<int32_t>(std::ceil((std::max)({ y[0], y[1], y[2] }))));
+            if (triangle.minX >= triangle.maxX || triangle.minY >= triangle.maxY) continue;
+
+            // Arista i: la opuesta al vértice i, positiva hacia dentro.
+            for (int i = 0; i < 3; i++)
+            {
+                int a = (i + 1) % 3;
+                int b = (i + 2) % 3;
+                triangle.edgeA[i] = y[a] - y[b];
+                triangle.edgeB[i] = x[b] - x[a];
+                triangle.edgeC[i] = -(triangle.edgeA[i] * x[a] + triangle.edgeB[i] * y[a]);
+                triangle.topLeft[i] = triangle.edgeA[i] > 0.0 || (triangle.edgeA[i] == 0.0 && triangle.edgeB[i] > 0.0);
+            }
+            for (int p = 0; p < 4; p++)
+            {
+                double* plane = triangle.planes[p];
+                plane[0] = plane[1] = plane[2] = 0.0;
+                for (int i = 0; i < 3; i++)
+                {
+                    plane[0] += triangle.edgeA[i] * attributes[p][i];
+                    plane[1] += triangle.edgeB[i] * attributes[p][i];
+                    plane[2] += triangle.edgeC[i] * attributes[p][i];
+                }
+                plane[0] /= area;
+                plane[1] /= area;
+                plane[2] /= area;
+            }
+            triangles.push_back(triangle);
+        }
+    }
+
+    if (!triangles.empty())
+    {
+        // Reparto por teselas. Los índices quedan en orden de envío dentro de cada tesela.
+        tilesX = (drawColor->width + TileSize - 1) / TileSize;
+        uint32_t tilesY = (drawColor->height + TileSize - 1) / TileSize;
+        uint32_t tileCount = tilesX * tilesY;
+        if (bins.size() < tileCount) bins.resize(tileCount);
+        if (tilePixels.size() < tileCount) tilePixels.resize(tileCount);
+        for (uint32_t tile = 0; tile < tileCount; tile++)
+        {
+            bins[tile].clear();
+            tilePixels[tile] = 0;
+        }
+        for (uint32_t i = 0; i < triangles.size(); i++)
+        {
+            const Triangle& triangle = triangles[i];
+            for (int32_t ty = triangle.minY / static_cast<int32_t>(TileSize); ty <= (triangle.maxY - 1) / static_cast<int32_t>(TileSize); ty++)
+            {
+                for (int32_t tx = triangle.minX / static_cast<int32_t>(TileSize); tx <= (triangle.maxX - 1) / static_cast<int32_t>(TileSize); tx++)
+                {
+                    bins[ty * tilesX + tx].push_back(i);
+                }
+            }
+        }
+
+        for (uint32_t instance = 0; instance < command.instanceCount; instance++)
+        {
+            auto rasterize = [this](uint32_t begin, uint32_t end) {
+                for (uint32_t tile = begin; tile < end; tile++) RasterizeTile(tile);
+            };
+            if (jobs) jobs->ParallelFor(tileCount, 4, rasterize);
+            else rasterize(0, tileCount);
+        }
+
+        for (uint32_t tile = 0; tile < tileCount; tile++)
+        {
+            stats.pixelsShaded += tilePixels[tile];
+        }
+        stats.trianglesRasterized += static_cast<uint64_t>(triangles.size()) * command.instanceCount;
+    }
+
+    stats.drawTicks += Profiler::Now() - start;
+}
+
+void SoftwareRasterizer::RasterizeTile(uint32_t tile)
+{
+    const std::vector<uint32_t>& bin = bins[tile];
+    if (bin.empty()) return;
+
+    const int32_t tileX = static_cast<int32_t>(tile % tilesX * TileSize);
+    const int32_t tileY = static_cast<int32_t>(tile / tilesX * TileSize);
+    const CapturedPipeline& state = drawPipeline->desc;
+    const bool depthTest = drawDepth && state.depthEnable;
+    const bool depthWrite = depthTest && state.depthWriteMask != 0;
+    const uint32_t width = drawColor->width;
+    uint32_t* color = drawColor->color.data();
+    float* depth = drawDepth ? drawDepth->depth.data() : nullptr;
+
+    // Carriles del cuádruple 2x2: (0,0) (1,0) (0,1) (1,1).
+    const Simd::Register laneX = Simd::Set(0.0f, 1.0f, 0.0f, 1.0f);
+    const Simd::Register laneY = Simd::Set(0.0f, 0.0f, 1.0f, 1.0f);
+    const ChannelTables& tables = Tables();
+    uint64_t shaded = 0;
+
+    for (uint32_t triangleIndex : bin)
+    {
+        const Triangle& triangle = triangles[triangleIndex];
+        int32_t x0 = (std::max)(tileX, triangle.minX);
+        int32_t y0 = (std::max)(tileY, triangle.minY);
+        int32_t x1 = (std::min)(tileX + static_cast<int32_t>(TileSize), triangle.maxX);
+        int32_t y1 = (std::min)(tileY + static_cast<int32_t>(TileSize), triangle.maxY);
+        if (x0 >= x1 || y0 >= y1) continue;
+
+        // Los cuádruples empiezan en coordenadas pares. Las ecuaciones se rebasan en doble precisión
+        // al centro del primer píxel para evaluarlas en float con valores pequeños.
+        int32_t quadX0 = x0 & ~1;
+        int32_t quadY0 = y0 & ~1;
+        double originX = quadX0 + 0.5;
+        double originY = quadY0 + 0.5;
+
+        Simd::Register edgeA[3], edgeB[3], edgeC[3];
+        bool topLeft[3];
+        for (int i = 0; i < 3; i++)
+        {
+            edgeA[i] = Simd::Replicate(static_cast<float>(triangle.edgeA[i]));
+            edgeB[i] = Simd::Replicate(static_cast<float>(triangle.edgeB[i]));
+            edgeC[i] = Simd::Replicate(static_cast<float>(triangle.edgeC[i] + triangle.edgeA[i] * originX + triangle.edgeB[i] * originY));
+            topLeft[i] = triangle.topLeft[i];
+        }
+        Simd::Register planeA[4], planeB[4], planeC[4];
+        for (int p = 0; p < 4; p++)
+        {
+            planeA[p] = Simd::Replicate(static_cast<float>(triangle.planes[p][0]));
+            planeB[p] = Simd::Replicate(static_cast<float>(triangle.planes[p][1]));
+            planeC[p] = Simd::Replicate(static_cast<float>(triangle.planes[p][2] + triangle.planes[p][0] * originX + triangle.planes[p][1] * originY));
+        }
+
+        for (int32_t qy = quadY0; qy < y1; qy += 2)
+        {
+            Simd::Register py = Simd::Add(laneY, Simd::Replicate(static_cast<float>(qy - quadY0)));
+            for (int32_t qx = quadX0; qx < x1; qx += 2)
+            {
+                Simd::Register px = Simd::Add(laneX, Simd::Replicate(static_cast<float>(qx - quadX0)));
+
+                // Un carril está dentro si ninguna arista es negativa; las que no son superior o izquierda excluyen el cero.
+                int outside = 0;
+                for (int i = 0; i < 3; i++)
+                {
+                    Simd::Register edge = Simd::Add(Simd::Add(Simd::Multiply(edgeA[i], px), Simd::Multiply(edgeB[i], py)), edgeC[i]);
+                    outside |= topLeft[i] ? Simd::SignMask(edge) : ~Simd::SignMask(Simd::Negate(edge)) & 0xF;
+                }
+                int covered = ~outside & 0xF;
+                if (!covered) continue;
+
+                // Fuera de la caja (recorte y tesela) en los bordes impares.
+                if (qx < x0) covered &= ~0x5;
+                if (qx + 1 >= x1) covered &= ~0xA;
+                if (qy < y0) covered &= ~0x3;
+                if (qy + 1 >= y1) covered &= ~0xC;
+                if (!covered) continue;
+
+                Simd::Register planes[4];
+                for (int p = 0; p < 4; p++)
+                {
+                    planes[p] = Simd::Add(Simd::Add(Simd::Multiply(planeA[p], px), Simd::Multiply(planeB[p], py)), planeC[p]);
+                }
+                float z[4], u[4], v[4];
+                Simd::Register w = Simd::Divide(Simd::Replicate(1.0f), planes[1]);
+                Simd::Store4(z, planes[0]);
+                Simd::Store4(u, Simd::Multiply(planes[2], w));
+                Simd::Store4(v, Simd::Multiply(planes[3], w));
+
+                // Derivadas gruesas del cuádruple, como ddx/ddy en la GPU.
+                float lods[TextureCount];
+                for (uint32_t t = 0; t < TextureCount; t++)
+                {
+                    lods[t] = drawTextures[t] ? ComputeLod(*drawTextures[t], u[1] - u[0], v[1] - v[0], u[2] - u[0], v[2] - v[0]) : 0.0f;
+                }
+
+                for (int lane = 0; lane < 4; lane++)
+                {
+                    if (!(covered & (1 << lane))) continue;
+
+                    size_t pixel = static_cast<size_t>(qy + (lane >> 1)) * width + static_cast<size_t>(qx + (lane & 1));
+                    if (depthTest)
+                    {
+                        if (!DepthTest(state.depthFunc, z[lane], depth[pixel])) continue;
+                        if (depthWrite) depth[pixel] = z[lane];
+                    }
+
+                    Simd::Register sum = Simd::Zero();
+                    for (uint32_t t = 0; t < TextureCount; t++)
+                    {
+                        if (drawTextures[t]) sum = Simd::Add(sum, SampleTrilinear(*drawTextures[t], u[lane], v[lane], lods[t]));
+                    }
+                    float rgb[4];
+                    Simd::Store4(rgb, sum);
+                    color[pixel] = tables.Gamma(rgb[0]) | (tables.Gamma(rgb[1]) << 8) | (tables.Gamma(rgb[2]) << 16) | 0xFF000000u;
+                    shaded++;
+                }
+            }
+        }
+    }
+
+    tilePixels[tile] += shaded;
+}
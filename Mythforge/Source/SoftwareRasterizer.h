@@ -0,0 +1,172 @@
+﻿/**
+ * @file SoftwareRasterizer.h
+ * @brief Backend de reproducción que rasteriza en CPU: imagen de referencia y render sin GPU.
+ *
+ * Reproduce capturas de CommandStream sin Direct3D. No interpreta el bytecode de los shaders:
+ * emula el programa TexCoord, el único que usa el motor (posición por la matriz de la tabla raíz 0;
+ * suma de las dos texturas de la tabla raíz 1 con filtrado trilineal y sujeción a borde, y
+ * corrección gamma). Las texturas sRGB se decodifican según el formato del recurso, no el de la vista. Del pipeline implementa listas de triángulos indexadas, recorte contra los
+ * planos cercano y lejano, el modo de descarte de caras y la prueba de profundidad, sobre destinos
+ * de color RGBA8 y de profundidad D32.
+ *
+ * Cada dibujo se prepara entero (vértices, recorte, ecuaciones de arista y de atributos) y sus
+ * triángulos se reparten en teselas de 64x64 píxeles, que se rasterizan en paralelo con el
+ * JobSystem. Dentro de la tesela las aristas se evalúan en grupos de 2x2 píxeles con
+ * Simd::Register; los cuatro carriles dan además las derivadas para elegir el mip, como en la GPU.
+ * Cada tesela procesa sus triángulos en el orden de envío, así que la imagen no depende del
+ * número de hilos.
+ */
+
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "CommandStream.h"
+
+class JobSystem;
+
+/**
+ * @struct SoftwareRasterizerStats
+ * @brief Trabajo y tiempo de los dibujos reproducidos.
+ */
+struct SoftwareRasterizerStats {
+    uint64_t frames = 0;
+    uint64_t triangles = 0;             ///< Triángulos enviados
+    uint64_t trianglesRasterized = 0;   ///< Los que quedan tras recortar y descartar caras
+    uint64_t pixelsShaded = 0;          ///< Píxeles que pasaron la prueba de profundidad
+    uint64_t drawTicks = 0;             ///< Tiempo dentro de DrawIndexed, en ticks del perfilador
+
+    double DrawSeconds() const;
+    double MegapixelsPerSecond() const;
+    double TrianglesPerSecond() const;
+};
+
+/**
+ * @class SoftwareRasterizer
+ * @brief Reproduce una captura en memoria de CPU.
+ */
+class SoftwareRasterizer : public CommandSink {
+public:
+    static constexpr uint32_t TileSize = 64;
+
+    /// Sin JobSystem, las teselas se procesan en el hilo que reproduce.
+    explicit SoftwareRasterizer(JobSystem* jobs = nullptr);
+
+    /**
+     * @brief Fuerza el tamaño de los destinos de color y profundidad definidos a partir de ahora.
+     *
+     * Los viewports y rectángulos de recorte se escalan en la misma proporción. 0 conserva el
+     * tamaño capturado.
+     */
+    void SetOutputSize(uint32_t width, uint32_t height);
+
+    const SoftwareRasterizerStats& Stats() const { return stats; }
+    void ResetStats() { stats = SoftwareRasterizerStats(); }
+
+    /// Copia, en RGBA8 por filas, el último destino presentado o, si no hay, el último en el que se dibujó.
+    bool ReadRenderTarget(std::vector<uint8_t>& pixels, uint32_t& width, uint32_t& height) const;
+
+    void BeginFrame(const FrameCommand& command) override;
+    void EndFrame() override;
+    void DefineResource(const CapturedResource& resource, const void* initialData) override;
+    void DefineRootSignature(const CapturedRootSignature& rootSignature, const void* blob) override;
+    void DefinePipeline(const CapturedPipeline& pipeline, const CapturedInputElement* inputElements, const void* vertexShader, const void* pixelShader) override;
+    void DefineDescriptorHeap(const CapturedDescriptorHeap& heap) override;
+    void DefineView(const CapturedView& view) override;
+    void ReleaseObject(const ObjectCommand& command) override;
+    void WriteBuffer(const BufferWriteCommand& command, const void* data) override;
+    void SetRootSignature(const ObjectCommand& command) override;
+    void SetDescriptorHeaps(const SetDescriptorHeapsCommand& command) override;
+    void SetPipeline(const ObjectCommand& command) override;
+    void SetRootTable(const SetRootTableCommand& command) override;
+    void SetTopology(const SetTopologyCommand& command) override;
+    void SetVertexBuffer(const SetVertexBufferCommand& command) override;
+    void SetIndexBuffer(const SetIndexBufferCommand& command) override;
+    void SetViewport(const ViewportCommand& command) override;
+    void SetScissor(const ScissorCommand& command) override;
+    void SetRenderTargets(const SetRenderTargetsCommand& command) override;
+    void ClearRenderTarget(const ClearRenderTargetCommand& command) override;
+    void ClearDepth(const ClearDepthCommand& command) override;
+    void Barrier(const BarrierCommand& command) override;
+    void DrawIndexed(const DrawIndexedCommand& command) override;
+    void Present() override;
+
+    struct MipLevel {
+        uint32_t width;
+        uint32_t height;
+        size_t   offset;    ///< En texels desde el principio de Resource::texels
+    };
+
+    /**
+     * @struct Resource
+     * @brief Memoria de un recurso según su uso: bytes de búfer, destino o textura muestreable.
+     */
+    struct Resource {
+        CapturedResource      desc;
+        uint32_t              width = 0;    ///< Tamaño real de los destinos; difiere del capturado con SetOutputSize
+        uint32_t              height = 0;
+        std::vector<uint8_t>  bytes;        ///< Búferes
+        std::vector<uint32_t> color;        ///< Destinos de color, RGBA8
+        std::vector<float>    depth;        ///< Destinos de profundidad
+        std::vector<float>    texels;       ///< Texturas, RGBA lineal con todos los mips seguidos
+        std::vector<MipLevel> mips;
+    };
+
+    /// Triángulo ya preparado en coordenadas de píxel: tres aristas y cuatro planos de atributos.
+    struct Triangle {
+        int32_t minX, minY, maxX, maxY;     ///< Caja en píxeles, con el máximo excluido
+        double  edgeA[3], edgeB[3], edgeC[3];
+        bool    topLeft[3];
+        double  planes[4][3];               ///< Profundidad, 1/w, u/w y v/w como a*x + b*y + c
+    };
+
+private:
+    struct Pipeline {
+        CapturedPipeline desc;
+        uint32_t         positionOffset = 0;
+        uint32_t         texCoordOffset = 0;
+    };
+
+    struct Binding {
+        CaptureId heap = 0;
+        uint32_t  index = 0;
+    };
+
+    static constexpr uint32_t MaxRootTables = 4;
+
+    Resource* LookupResource(CaptureId id);
+    const CapturedView* FindView(const Binding& binding) const;
+    void RasterizeTile(uint32_t tile);
+
+    JobSystem*                                               jobs;
+    uint32_t                                                 outputWidth = 0;
+    uint32_t                                                 outputHeight = 0;
+    SoftwareRasterizerStats                                  stats;
+
+    std::unordered_map<CaptureId, Resource>                  resources;
+    std::unordered_map<CaptureId, Pipeline>                  pipelines;
+    std::unordered_map<CaptureId, std::vector<CapturedView>> heaps;
+
+    CaptureId                                                pipeline = 0;
+    Binding                                                  rootTables[MaxRootTables];
+    uint32_t                                                 topology = 0;
+    SetVertexBufferCommand                                   vertexBuffer = {};
+    SetIndexBufferCommand                                    indexBuffer = {};
+    ViewportCommand                                          viewport = {};
+    ScissorCommand                                           scissor = {};
+    Binding                                                  renderTarget;
+    Binding                                                  depthStencil;
+    CaptureId                                                lastRenderTarget = 0;
+    CaptureId                                                presented = 0;
+
+    // Estado del dibujo en curso, compartido por las teselas.
+    std::vector<Triangle>                                    triangles;
+    std::vector<std::vector<uint32_t>>                       bins;
+    std::vector<uint64_t>                                    tilePixels;    ///< Píxeles sombreados por tesela en el dibujo
+    uint32_t                                                 tilesX = 0;
+    Resource*                                                drawColor = nullptr;
+    Resource*                                                drawDepth = nullptr;
+    const Resource*                                          drawTextures[2] = {};
+    const Pipeline*                                          drawPipeline = nullptr;
+    int32_t                                                  clipRect[4] = {};
+};
@@ -0,0 +1,147 @@
+﻿/**
+ * @file StartupLoader.cpp
+ * @brief Implementación del planificador de cargas del arranque.
+ */
+
+#include "pch.h"
+#include "StartupLoader.h"
+#include "Profiler.h"
+#include <cstdio>
+
+StartupLoader::StartupLoader()
+    : startTicks(Profiler::Now())
+{
+}
+
+StartupLoader::~StartupLoader()
+{
+    if (!sealed) Seal();
+    Wait();
+}
+
+void StartupLoader::Add(const char* name, Task<void> task, bool required)
+{
+    taskCount.fetch_add(1, std::memory_order_relaxed);
+    pending.fetch_add(1, std::memory_order_relaxed);
+    if (required)
+    {
+        pendingRequired.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    entries.push_back(std::make_unique<Entry>(Entry{ name, required, std::move(task) }));
+    Run(*this, *entries.back());
+}
+
+void StartupLoader::Seal()
+{
+    sealed = true;
+    uint64_t now = Profiler::Now();
+    ArriveRequired(now);
+    Arrive(now);
+}
+
+TaskDetail::Detached StartupLoader::Run(StartupLoader& loader, Entry& entry)
+{
+    co_await entry.task.WhenReady();
+    std::exception_ptr error;
+    try
+    {
+        entry.task.Result();
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+    loader.Complete(entry, error);
+}
+
+void StartupLoader::Complete(Entry& entry, std::exception_ptr error)
+{
+    uint64_t now = Profiler::Now();
+    entry.finishedTicks = now;
+    entry.failed = error != nullptr;
+    if (error)
+    {
+        failedCount.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!firstError) firstError = error;
+    }
+    completedCount.fetch_add(1, std::memory_order_relaxed);
+
+    if (entry.required)
+    {
+        ArriveRequired(now);
+    }
+    Arrive(now);
+}
+
+void StartupLoader::ArriveRequired(uint64_t now)
+{
+    if (pendingRequired.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        requiredReadyTicks.store(now, std::memory_order_release);
+    }
+}
+
+void StartupLoader::Arrive(uint64_t now)
+{
+    if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        // Con el mutex tomado: en cuanto Wait vuelve, el cargador puede dejar de existir.
+        std::lock_guard<std::mutex> lock(mutex);
+        fullyLoadedTicks.store(now, std::memory_order_release);
+        done.notify_all();
+    }
+}
+
+void StartupLoader::OnScenePresented()
+{
+    uint64_t expected = 0;
+    firstFrameTicks.compare_exchange_strong(expected, Profiler::Now(), std::memory_order_acq_rel);
+}
+
+void StartupLoader::ThrowIfFailed()
+{
+    if (failedCount.load(std::memory_order_acquire) == 0) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (firstError) std::rethrow_exception(firstError);
+}
+
+void StartupLoader::Wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]() { return FullyLoaded(); });
+}
+
+double StartupLoader::ElapsedMs(uint64_t ticks) const
+{
+    return ticks != 0 ? Profiler::TicksToMicroseconds(ticks - startTicks) / 1000.0 : 0.0;
+}
+
+StartupStats StartupLoader::Stats() const
+{
+    StartupStats stats;
+    stats.tasks = taskCount.load(std::memory_order_relaxed);
+    stats.completed = completedCount.load(std::memory_order_relaxed);
+    stats.failed = failedCount.load(std::memory_order_relaxed);
+    stats.requiredReadyMs = ElapsedMs(requiredReadyTicks.load(std::memory_order_acquire));
+    stats.firstFrameMs = ElapsedMs(firstFrameTicks.load(std::memory_order_acquire));
+    stats.fullyLoadedMs = ElapsedMs(fullyLoadedTicks.load(std::memory_order_acquire));
+    return stats;
+}
+
+void StartupLoader::WriteReport(std::ostream& out) const
+{
+    StartupStats stats = Stats();
+    char line[192];
+    snprintf(line, sizeof(line), "Arranque: %u tareas, %u con error | requeridas %.1f ms, primer fotograma %.1f ms, todo cargado %.1f ms\n",
+        stats.tasks, stats.failed, stats.requiredReadyMs, stats.firstFrameMs, stats.fullyLoadedMs);
+    out << line;
+    for (const std::unique_ptr<Entry>& entry : entries)
+    {
+        snprintf(line, sizeof(line), "  %-24s %8.1f ms%s%s\n", entry->name, ElapsedMs(entry->finishedTicks),
+            entry->required ? " requerida" : "", entry->failed ? " ERROR" : "");
+        out << line;
+    }
+}
@@ -0,0 +1,112 @@
+﻿/**
+ * @file StartupLoader.h
+ * @brief Cargas del arranque, todas a la vez, con un conjunto mínimo que decide el primer fotograma.
+ *
+ * Add arranca cada tarea en el momento. Las corrutinas de AssetLoading se reparten solas por el
+ * JobSystem y suben cada recurso a la GPU en cuanto está decodificado, sin esperar a los demás,
+ * así que la lectura, la decodificación, las copias y la compilación de PSO se solapan. Las tareas
+ * requeridas son las que el primer fotograma necesita: cuando han acabado todas, RequiredReady pasa
+ * a true y la app dibuja la escena. El resto llega después y cada objeto lo usa desde el fotograma
+ * siguiente a su carga.
+ *
+ * Los tiempos se cuentan desde la construcción con el reloj del perfilador: conjunto mínimo
+ * residente, primer fotograma presentado con la escena y todo cargado.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <ostream>
+#include <vector>
+#include "Task.h"
+
+/**
+ * @struct StartupStats
+ * @brief Tiempos del arranque en milisegundos; 0 mientras el hito no ha llegado.
+ */
+struct StartupStats {
+    uint32_t tasks = 0;
+    uint32_t completed = 0;
+    uint32_t failed = 0;
+    double   requiredReadyMs = 0.0;     ///< Han acabado las tareas requeridas
+    double   firstFrameMs = 0.0;        ///< Se presentó el primer fotograma que dibujó la escena
+    double   fullyLoadedMs = 0.0;       ///< Han acabado todas
+
+    bool Complete() const { return firstFrameMs > 0.0 && fullyLoadedMs > 0.0; }
+};
+
+/**
+ * @class StartupLoader
+ * @brief Lanza las cargas del arranque y mide cuándo se puede dibujar y cuándo ha acabado todo.
+ *
+ * Add y Seal se llaman desde un solo hilo. Se destruye antes que la UploadQueue y el JobSystem que
+ * usan sus tareas; el destructor espera a que acaben.
+ */
+class StartupLoader {
+public:
+    StartupLoader();
+    ~StartupLoader();
+
+    StartupLoader(const StartupLoader&) = delete;
+    StartupLoader& operator=(const StartupLoader&) = delete;
+
+    /// Arranca la tarea. Con required el primer fotograma no se dibuja hasta que acabe.
+    void Add(const char* name, Task<void> task, bool required);
+
+    /// No habrá más tareas: a partir de aquí pueden cumplirse RequiredReady y FullyLoaded.
+    void Seal();
+
+    bool RequiredReady() const { return requiredReadyTicks.load(std::memory_order_acquire) != 0; }
+    bool FullyLoaded() const { return fullyLoadedTicks.load(std::memory_order_acquire) != 0; }
+
+    /// Lo llama el hilo de render tras presentar un fotograma con la escena; solo cuenta el primero.
+    void OnScenePresented();
+
+    /// Relanza el error de la primera tarea que falló, si alguna lo hizo.
+    void ThrowIfFailed();
+
+    /// Bloquea hasta que acaben todas. No se llama desde un trabajo del JobSystem.
+    void Wait();
+
+    StartupStats Stats() const;
+
+    /// Los hitos y una línea por tarea con el momento en que acabó. Solo con FullyLoaded.
+    void WriteReport(std::ostream& out) const;
+
+private:
+    struct Entry {
+        const char* name;
+        bool        required;
+        Task<void>  task;
+        uint64_t    finishedTicks = 0;
+        bool        failed = false;
+    };
+
+    static TaskDetail::Detached Run(StartupLoader& loader, Entry& entry);
+    void Complete(Entry& entry, std::exception_ptr error);
+    void ArriveRequired(uint64_t now);
+    void Arrive(uint64_t now);
+    double ElapsedMs(uint64_t ticks) const;
+
+    uint64_t                            startTicks;
+    std::vector<std::unique_ptr<Entry>> entries;            ///< Solo los toca Add; cada Entry no se mueve
+    bool                                sealed = false;
+
+    // Cada contador empieza en 1 por Seal, para que no se cumpla antes de añadirlas todas.
+    std::atomic<uint32_t>               pendingRequired{ 1 };
+    std::atomic<uint32_t>               pending{ 1 };
+    std::atomic<uint32_t>               taskCount{ 0 };
+    std::atomic<uint32_t>               completedCount{ 0 };
+    std::atomic<uint32_t>               failedCount{ 0 };
+    std::atomic<uint64_t>               requiredReadyTicks{ 0 };
+    std::atomic<uint64_t>               firstFrameTicks{ 0 };
+    std::atomic<uint64_t>               fullyLoadedTicks{ 0 };
+
+    std::mutex                          mutex;              ///< Protege firstError y la espera de Wait
+    std::condition_variable             done;
+    std::exception_ptr                  firstError;
+};
@@ -1,10 +1,14 @@
 ﻿#pragma once
 
-#include <wrl.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include "FrameStats.h"
 
 namespace DX
 {
 	// Clase de asistente para controlar el tiempo de las animaciones y simulaciones.
+	// Usa std::chrono::steady_clock en lugar de QueryPerformanceCounter para poder compilarse fuera de Windows.
 	class StepTimer
 	{
 	public:
@@ -15,50 +19,48 @@ namespace DX
 			m_frameCount(0),
 			m_framesPerSecond(0),
 			m_framesThisSecond(0),
-			m_qpcSecondCounter(0),
+			m_secondCounter(0),
 			m_isFixedTimeStep(false),
-			m_targetElapsedTicks(TicksPerSecond / 60)
-		{
-			if (!QueryPerformanceFrequency(&m_qpcFrequency))
-			{
-				throw ref new Platform::FailureException();
-			}
-
-			if (!QueryPerformanceCounter(&m_qpcLastTime))
-			{
-				throw ref new Platform::FailureException();
-			}
-
+			m_targetElapsedTicks(TicksPerSecond / 60),
+			m_lastTime(Clock::now()),
 			// Inicializar delta máximo en una décima parte de un segundo.
-			m_qpcMaxDelta = m_qpcFrequency.QuadPart / 10;
+			m_maxDelta(TicksPerSecond / 10)
+		{
 		}
 
 		// Obtener el tiempo transcurrido desde la llamada a Update anterior.
-		uint64 GetElapsedTicks() const						{ return m_elapsedTicks; }
+		uint64_t GetElapsedTicks() const						{ return m_elapsedTicks; }
 		double GetElapsedSeconds() const					{ return TicksToSeconds(m_elapsedTicks); }
 
 		// Obtener el tiempo total desde el inicio del programa.
-		uint64 GetTotalTicks() const						{ return m_totalTicks; }
+		uint64_t GetTotalTicks() const						{ return m_totalTicks; }
 		double GetTotalSeconds() const						{ return TicksToSeconds(m_totalTicks); }
 
 		// Obtener el número total de actualizaciones desde el inicio del programa.
-		uint32 GetFrameCount() const						{ return m_frameCount; }
+		uint32_t GetFrameCount() const						{ return m_frameCount; }
 
 		// Obtener el valor de framerate actual.
-		uint32 GetFramesPerSecond() const					{ return m_framesPerSecond; }
+		uint32_t GetFramesPerSecond() const					{ return m_framesPerSecond; }
+
+		// Historial de duraciones reales de cada Tick, sin recortar, para percentiles y tirones.
+		FrameStats& GetFrameStats()							{ return m_frameStats; }
+		const FrameStats& GetFrameStats() const				{ return m_frameStats; }
+
+		// Tiempo acumulado que aún no llega a un paso fijo; 0 en modo variable.
+		uint64_t GetLeftOverTicks() const					{ return m_leftOverTicks; }
 
 		// Configurar si se va a usar el modo de timestep fijo o variable.
 		void SetFixedTimeStep(bool isFixedTimestep)			{ m_isFixedTimeStep = isFixedTimestep; }
 
 		// Configurar la frecuencia con la que se llama a Update cuando se usa el modo de timestep fijo.
-		void SetTargetElapsedTicks(uint64 targetElapsed)	{ m_targetElapsedTicks = targetElapsed; }
+		void SetTargetElapsedTicks(uint64_t targetElapsed)	{ m_targetElapsedTicks = targetElapsed; }
 		void SetTargetElapsedSeconds(double targetElapsed)	{ m_targetElapsedTicks = SecondsToTicks(targetElapsed); }
 
 		// Formato de entero que representa la hora en 10.000.000 pasos por segundo.
-		static const uint64 TicksPerSecond = 10000000;
+		static const uint64_t TicksPerSecond = 10000000;
 
-		static double TicksToSeconds(uint64 ticks)			{ return static_cast<double>(ticks) / TicksPerSecond; }
-		static uint64 SecondsToTicks(double seconds)		{ return static_cast<uint64>(seconds * TicksPerSecond); }
+		static double TicksToSeconds(uint64_t ticks)			{ return static_cast<double>(ticks) / TicksPerSecond; }
+		static uint64_t SecondsToTicks(double seconds)		{ return static_cast<uint64_t>(seconds * TicksPerSecond); }
 
 		// Después de una interrupción temporal intencionada (por ejemplo, una operación de E/S de bloqueo)
 		// se llama a esto para evitar que la lógica de timestep fijo intente una serie de
@@ -66,45 +68,44 @@ namespace DX
 
 		void ResetElapsedTime()
 		{
-			if (!QueryPerformanceCounter(&m_qpcLastTime))
-			{
-				throw ref new Platform::FailureException();
-			}
+			m_lastTime = Clock::now();
 
 			m_leftOverTicks = 0;
 			m_framesPerSecond = 0;
 			m_framesThisSecond = 0;
-			m_qpcSecondCounter = 0;
+			m_secondCounter = 0;
 		}
 
 		// Actualizar el estado del temporizador llamando a la función Update especificada el número de veces que sea necesario.
 		template<typename TUpdate>
 		void Tick(const TUpdate& update)
 		{
-			// Consultar la hora actual.
-			LARGE_INTEGER currentTime;
+			// Consultar la hora actual y convertir la diferencia al formato de marca de graduación canónico.
+			Clock::time_point currentTime = Clock::now();
 
-			if (!QueryPerformanceCounter(&currentTime))
-			{
-				throw ref new Platform::FailureException();
-			}
+			uint64_t timeDelta = static_cast<uint64_t>(std::chrono::duration_cast<Ticks>(currentTime - m_lastTime).count());
+
+			m_lastTime = currentTime;
+			Tick(timeDelta, update);
+		}
 
-			uint64 timeDelta = currentTime.QuadPart - m_qpcLastTime.QuadPart;
+		// Igual que Tick, pero con el tiempo transcurrido dado en lugar de medido con el reloj; sirve para
+		// simular intervalos conocidos.
+		template<typename TUpdate>
+		void Tick(uint64_t timeDelta, const TUpdate& update)
+		{
+			m_secondCounter += timeDelta;
 
-			m_qpcLastTime = currentTime;
-			m_qpcSecondCounter += timeDelta;
+			// Las estadísticas guardan la duración real, antes de recortarla.
+			m_frameStats.AddFrame(TicksToSeconds(timeDelta) * 1000.0);
 
 			// Fijar los deltas de tiempo excesivamente largos (p. ej., tras una pausa del depurador).
-			if (timeDelta > m_qpcMaxDelta)
+			if (timeDelta > m_maxDelta)
 			{
-				timeDelta = m_qpcMaxDelta;
+				timeDelta = m_maxDelta;
 			}
 
-			// Convertir las unidades QPC en un formato de marca de graduación canónico. Este no puede desbordarse debido al bloqueo anterior.
-			timeDelta *= TicksPerSecond;
-			timeDelta /= m_qpcFrequency.QuadPart;
-
-			uint32 lastFrameCount = m_frameCount;
+			uint32_t lastFrameCount = m_frameCount;
 
 			if (m_isFixedTimeStep)
 			{
@@ -117,7 +118,7 @@ namespace DX
 				// acumulando tantos pequeños errores que borraría el marco. Es mejor redondear estas 
 				// pequeñas desviaciones a cero para dejar que todo siga su curso.
 
-				if (abs(static_cast<int64>(timeDelta - m_targetElapsedTicks)) < TicksPerSecond / 4000)
+				if (abs(static_cast<int64_t>(timeDelta - m_targetElapsedTicks)) < TicksPerSecond / 4000)
 				{
 					timeDelta = m_targetElapsedTicks;
 				}
@@ -151,33 +152,37 @@ namespace DX
 				m_framesThisSecond++;
 			}
 
-			if (m_qpcSecondCounter >= static_cast<uint64>(m_qpcFrequency.QuadPart))
+			if (m_secondCounter >= TicksPerSecond)
 			{
 				m_framesPerSecond = m_framesThisSecond;
 				m_framesThisSecond = 0;
-				m_qpcSecondCounter %= m_qpcFrequency.QuadPart;
+				m_secondCounter %= TicksPerSecond;
 			}
 		}
 
 	private:
-		// Los datos de tiempo de origen usan unidades QPC.
-		LARGE_INTEGER m_qpcFrequency;
-		LARGE_INTEGER m_qpcLastTime;
-		uint64 m_qpcMaxDelta;
 
 		// Los datos de tiempo derivados usan un formato de marca de graduación canónico.
-		uint64 m_elapsedTicks;
-		uint64 m_totalTicks;
-		uint64 m_leftOverTicks;
+		uint64_t m_elapsedTicks;
+		uint64_t m_totalTicks;
+		uint64_t m_leftOverTicks;
 
 		// Miembros para seguimiento del valor de framerate actual.
-		uint32 m_frameCount;
-		uint32 m_framesPerSecond;
-		uint32 m_framesThisSecond;
-		uint64 m_qpcSecondCounter;
+		uint32_t m_frameCount;
+		uint32_t m_framesPerSecond;
+		uint32_t m_framesThisSecond;
+		uint64_t m_secondCounter;
 
 		// Miembros para configurar el modo fijo de timestep.
 		bool m_isFixedTimeStep;
-		uint64 m_targetElapsedTicks;
+		uint64_t m_targetElapsedTicks;
+
+		// Los datos de tiempo de origen usan steady_clock.
+		using Clock = std::chrono::steady_clock;
+		using Ticks = std::chrono::duration<int64_t, std::ratio<1, TicksPerSecond>>;
+		Clock::time_point m_lastTime;
+		uint64_t m_maxDelta;
+
+		FrameStats m_frameStats;
 	};
 }
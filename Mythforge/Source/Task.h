@@ -0,0 +1,356 @@
+﻿/**
+ * @file Task.h
+ * @brief Corrutinas que se reanudan en el JobSystem: Task, ResumeOn, WhenAll y SyncWait.
+ *
+ * Una Task<T> es perezosa: empieza cuando alguien la espera con co_await, WhenAll o SyncWait, y
+ * corre en el hilo que la espera hasta su primera suspensión. co_await ResumeOn(jobSystem) la
+ * pasa a un hilo del pool, y las esperas de fichero y de GPU de AssetLoading también reanudan
+ * allí. El código de carga se escribe en secuencia; lo que puede ir a la vez se espera con
+ * WhenAll, que arranca todas las tareas antes de suspender.
+ *
+ * El proyecto compila en C++17 porque C++/CX no admite /std:c++20: las corrutinas salen de /await
+ * y <experimental/coroutine>. Con un compilador que las trae de serie se usa <coroutine>.
+ *
+ * El resultado de una Task se recoge una sola vez, y la Task no se destruye mientras está en marcha.
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+#include "JobSystem.h"
+
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+namespace TaskDetail
+{
+    using std::coroutine_handle;
+    using std::suspend_always;
+    using std::suspend_never;
+}
+#else
+#include <experimental/coroutine>
+namespace TaskDetail
+{
+    using std::experimental::coroutine_handle;
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+}
+#endif
+
+template<typename T = void>
+class Task;
+
+namespace TaskDetail
+{
+    /**
+     * @struct PromiseBase
+     * @brief Lo que la promesa de una Task no necesita saber del resultado.
+     *
+     * La tarea al acabar y quien la espera al suspenderse se citan en arrived: el primero que
+     * llega lo marca y el segundo reanuda al que espera. Así una tarea que acaba sin suspenderse
+     * no reanuda nada desde dentro de su propio arranque.
+     */
+    struct PromiseBase {
+        coroutine_handle<>  continuation;
+        std::atomic<bool>   arrived{ false };
+        std::exception_ptr  exception;
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+
+            template<typename P>
+            void await_suspend(coroutine_handle<P> handle) noexcept
+            {
+                PromiseBase& promise = handle.promise();
+                if (promise.arrived.exchange(true, std::memory_order_acq_rel))
+                {
+                    promise.continuation.resume();
+                }
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void unhandled_exception() noexcept { exception = std::current_exception(); }
+    };
+
+    template<typename T>
+    struct Promise : PromiseBase {
+        std::optional<T> result;
+
+        Task<T> get_return_object() noexcept;
+
+        template<typename U>
+        void return_value(U&& value) { result.emplace(std::forward<U>(value)); }
+
+        T Take()
+        {
+            if (exception) std::rethrow_exception(exception);
+            return std::move(*result);
+        }
+    };
+
+    template<>
+    struct Promise<void> : PromiseBase {
+        Task<void> get_return_object() noexcept;
+        void return_void() noexcept {}
+
+        void Take()
+        {
+            if (exception) std::rethrow_exception(exception);
+        }
+    };
+
+    /// Arranca la tarea y suspende a quien espera hasta que acabe. Una tarea ya terminada no se vuelve a arrancar.
+    template<typename P>
+    struct StartAwaiter {
+        coroutine_handle<P> task;
+
+        bool await_ready() const noexcept { return !task || task.done(); }
+
+        bool await_suspend(coroutine_handle<> awaiting) noexcept
+        {
+            task.promise().continuation = awaiting;
+            task.resume();
+            return !task.promise().arrived.exchange(true, std::memory_order_acq_rel);
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    template<typename P>
+    struct ResultAwaiter : StartAwaiter<P> {
+        auto await_resume() { return this->task.promise().Take(); }
+    };
+
+    /// Corrutina que nadie espera; se destruye sola al acabar.
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() noexcept { return {}; }
+            suspend_never initial_suspend() noexcept { return {}; }
+            suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+
+    /// Tareas pendientes de un WhenAll, más una del propio WhenAll que suelta al acabar de arrancarlas.
+    struct Countdown {
+        std::atomic<size_t> pending{ 0 };
+        coroutine_handle<>  continuation;
+
+        /// true para el último en llegar, que es quien reanuda.
+        bool Arrive() noexcept { return pending.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+    };
+
+    template<typename P>
+    Detached Join(StartAwaiter<P> task, Countdown& countdown)
+    {
+        co_await task;
+        if (countdown.Arrive())
+        {
+            countdown.continuation.resume();
+        }
+    }
+
+    /// start(countdown) arranca count tareas con Join; se sigue cuando han acabado todas.
+    template<typename Start>
+    struct AllAwaiter {
+        size_t    count;
+        Start     start;
+        Countdown countdown;
+
+        AllAwaiter(size_t count, Start start) : count(count), start(std::move(start)) {}
+
+        bool await_ready() const noexcept { return count == 0; }
+
+        bool await_suspend(coroutine_handle<> awaiting)
+        {
+            countdown.pending.store(count + 1, std::memory_order_relaxed);
+            countdown.continuation = awaiting;
+            start(countdown);
+            return !countdown.Arrive();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    template<typename Start>
+    AllAwaiter<Start> AllOf(size_t count, Start start)
+    {
+        return AllAwaiter<Start>(count, std::move(start));
+    }
+
+    struct Signal {
+        std::mutex              mutex;
+        std::condition_variable done;
+        bool                    ready = false;
+
+        /// Avisa con el mutex tomado: en cuanto Wait vuelve, la señal puede dejar de existir.
+        void Set()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready = true;
+            done.notify_all();
+        }
+
+        void Wait()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this]() { return ready; });
+        }
+    };
+
+    template<typename P>
+    Detached SignalWhenDone(StartAwaiter<P> task, Signal& signal)
+    {
+        co_await task;
+        signal.Set();
+    }
+}
+
+/**
+ * @class Task
+ * @brief Corrutina perezosa con un resultado de tipo T o la excepción que la terminó.
+ */
+template<typename T>
+class Task {
+public:
+    using promise_type = TaskDetail::Promise<T>;
+
+    Task() = default;
+    explicit Task(TaskDetail::coroutine_handle<promise_type> handle) : handle(handle) {}
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle) handle.destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~Task()
+    {
+        if (handle) handle.destroy();
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    bool IsReady() const { return handle && handle.done(); }
+
+    /// co_await task arranca la tarea si no lo estaba, espera a que acabe y entrega su resultado o relanza su excepción.
+    TaskDetail::ResultAwaiter<promise_type> operator co_await() noexcept { return { { handle } }; }
+
+    /// Espera a que acabe sin recoger el resultado.
+    TaskDetail::StartAwaiter<promise_type> WhenReady() noexcept { return { handle }; }
+
+    /// Resultado de una tarea terminada.
+    T Result() { return handle.promise().Take(); }
+
+private:
+    TaskDetail::coroutine_handle<promise_type> handle = nullptr;
+};
+
+namespace TaskDetail
+{
+    template<typename T>
+    Task<T> Promise<T>::get_return_object() noexcept
+    {
+        return Task<T>(coroutine_handle<Promise<T>>::from_promise(*this));
+    }
+
+    inline Task<void> Promise<void>::get_return_object() noexcept
+    {
+        return Task<void>(coroutine_handle<Promise<void>>::from_promise(*this));
+    }
+}
+
+/**
+ * @struct JobSystemAwaiter
+ * @brief Sigue la corrutina en un hilo del JobSystem. Sin hilos de trabajo sigue en el mismo.
+ */
+struct JobSystemAwaiter {
+    JobSystem& jobSystem;
+
+    bool await_ready() const noexcept { return jobSystem.WorkerCount() == 0; }
+    void await_suspend(TaskDetail::coroutine_handle<> handle) { jobSystem.Submit([handle]() { handle.resume(); }); }
+    void await_resume() const noexcept {}
+};
+
+inline JobSystemAwaiter ResumeOn(JobSystem& jobSystem)
+{
+    return { jobSystem };
+}
+
+/**
+ * @brief Arranca todas las tareas y sigue cuando han acabado. Los resultados se recogen después
+ *        con co_await de cada una, que ya no suspende; las tareas tienen que vivir hasta entonces.
+ */
+template<typename... Ts>
+Task<void> WhenAll(Task<Ts>&... tasks)
+{
+    co_await TaskDetail::AllOf(sizeof...(Ts), [&](TaskDetail::Countdown& countdown) {
+        (TaskDetail::Join(tasks.WhenReady(), countdown), ...);
+    });
+}
+
+/// Resultados en el orden de las tareas. Si alguna falló se relanza la primera excepción en ese orden.
+template<typename T>
+Task<std::vector<T>> WhenAll(std::vector<Task<T>> tasks)
+{
+    co_await TaskDetail::AllOf(tasks.size(), [&](TaskDetail::Countdown& countdown) {
+        for (Task<T>& task : tasks)
+        {
+            TaskDetail::Join(task.WhenReady(), countdown);
+        }
+    });
+
+    std::vector<T> results;
+    results.reserve(tasks.size());
+    for (Task<T>& task : tasks)
+    {
+        results.push_back(task.Result());
+    }
+    co_return results;
+}
+
+inline Task<void> WhenAll(std::vector<Task<void>> tasks)
+{
+    co_await TaskDetail::AllOf(tasks.size(), [&](TaskDetail::Countdown& countdown) {
+        for (Task<void>& task : tasks)
+        {
+            TaskDetail::Join(task.WhenReady(), countdown);
+        }
+    });
+
+    for (Task<void>& task : tasks)
+    {
+        task.Result();
+    }
+}
+
+/**
+ * @brief Arranca la tarea y bloquea el hilo hasta que acabe.
+ *
+ * No se llama desde un trabajo del JobSystem: ocuparía un hilo que la tarea puede necesitar.
+ */
+template<typename T>
+T SyncWait(Task<T> task)
+{
+    TaskDetail::Signal signal;
+    TaskDetail::SignalWhenDone(task.WhenReady(), signal);
+    signal.Wait();
+    return task.Result();
+}
@@ -18,6 +18,7 @@ struct Vector2 {
 
     Vector2(float x = 0.0f, float y = 0.0f) : x(x), y(y) {}
     Vector2(const Vector2& other) : x(other.x), y(other.y) {}
+    Vector2& operator=(const Vector2& other) = default;
     explicit Vector2(const struct Vector3& v3);
     explicit Vector2(const struct Vector4& v4);
 
@@ -44,6 +45,7 @@ struct Vector3 {
 
     Vector3(float x = 0.0f, float y = 0.0f, float z = 0.0f) : x(x), y(y), z(z) {}
     Vector3(const Vector3& other) : x(other.x), y(other.y), z(other.z) {}
+    Vector3& operator=(const Vector3& other) = default;
     explicit Vector3(const Vector2& v2, float z = 0.0f);
     explicit Vector3(const struct Vector4& v4);
 
@@ -73,6 +75,7 @@ struct Vector4 {
 
     Vector4(float x = 0.0f, float y = 0.0f, float z = 0.0f, float w = 1.0f) : x(x), y(y), z(z), w(w) {}
     Vector4(const Vector4& other) : x(other.x), y(other.y), z(other.z), w(other.w) {}
+    Vector4& operator=(const Vector4& other) = default;
     explicit Vector4(const Vector2& v2, float z = 0.0f, float w = 1.0f);
     explicit Vector4(const Vector3& v3, float w = 1.0f);
 
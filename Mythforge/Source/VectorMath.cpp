@@ -0,0 +1,361 @@
+﻿/**
+ * @file VectorMath.cpp
+ * @brief Implementación de las matrices, los cuaterniones y los kernels por lotes de VectorMath.h.
+ */
+
+#include "pch.h"
+#include "VectorMath.h"
+
+using namespace Simd;
+
+namespace
+{
+    Matrix4x4 MakeMatrix(const Vector4& r0, const Vector4& r1, const Vector4& r2, const Vector4& r3)
+    {
+        Matrix4x4 m;
+        m.r[0] = r0;
+        m.r[1] = r1;
+        m.r[2] = r2;
+        m.r[3] = r3;
+        return m;
+    }
+
+#if defined(MYTHFORGE_SIMD_AVX2)
+    inline __m256 Broadcast2(float first, float second)
+    {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(first)), _mm_set1_ps(second), 1);
+    }
+
+    inline __m256 LoadRow2(const Vector4A& row)
+    {
+        return _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&row.x));
+    }
+#endif
+}
+
+Matrix4x4 MatrixIdentity()
+{
+    return MakeMatrix(
+        Vector4(1.0f, 0.0f, 0.0f, 0.0f),
+        Vector4(0.0f, 1.0f, 0.0f, 0.0f),
+        Vector4(0.0f, 0.0f, 1.0f, 0.0f),
+        Vector4(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+Matrix4x4 MatrixMultiply(const Matrix4x4& a, const Matrix4x4& b)
+{
+    Register b0 = Load(b.r[0]);
+    Register b1 = Load(b.r[1]);
+    Register b2 = Load(b.r[2]);
+    Register b3 = Load(b.r[3]);
+
+    Matrix4x4 result;
+    for (int i = 0; i < 4; i++)
+    {
+        Store4A(&result.r[i].x, Transform4(Load(a.r[i]), b0, b1, b2, b3));
+    }
+    return result;
+}
+
+Matrix4x4 MatrixTranspose(const Matrix4x4& m)
+{
+    return MakeMatrix(
+        Vector4(m.r[0].x, m.r[1].x, m.r[2].x, m.r[3].x),
+        Vector4(m.r[0].y, m.r[1].y, m.r[2].y, m.r[3].y),
+        Vector4(m.r[0].z, m.r[1].z, m.r[2].z, m.r[3].z),
+        Vector4(m.r[0].w, m.r[1].w, m.r[2].w, m.r[3].w));
+}
+
+Matrix4x4 MatrixTranslation(const Vector3& offset)
+{
+    Matrix4x4 m = MatrixIdentity();
+    m.r[3] = Vector4(offset, 1.0f);
+    return m;
+}
+
+Matrix4x4 MatrixScaling(const Vector3& scale)
+{
+    return MakeMatrix(
+        Vector4(scale.x, 0.0f, 0.0f, 0.0f),
+        Vector4(0.0f, scale.y, 0.0f, 0.0f),
+        Vector4(0.0f, 0.0f, scale.z, 0.0f),
+        Vector4(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+Matrix4x4 MatrixRotationX(float angle)
+{
+    float s = std::sin(angle);
+    float c = std::cos(angle);
+    return MakeMatrix(
+        Vector4(1.0f, 0.0f, 0.0f, 0.0f),
+        Vector4(0.0f, c, s, 0.0f),
+        Vector4(0.0f, -s, c, 0.0f),
+        Vector4(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+Matrix4x4 MatrixRotationY(float angle)
+{
+    float s = std::sin(angle);
+    float c = std::cos(angle);
+    return MakeMatrix(
+        Vector4(c, 0.0f, -s, 0.0f),
+        Vector4(0.0f, 1.0f, 0.0f, 0.0f),
+        Vector4(s, 0.0f, c, 0.0f),
+        Vector4(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+Matrix4x4 MatrixRotationZ(float angle)
+{
+    float s = std::sin(angle);
+    float c = std::cos(angle);
+    return MakeMatrix(
+        Vector4(c, s, 0.0f, 0.0f),
+        Vector4(-s, c, 0.0f, 0.0f),
+        Vector4(0.0f, 0.0f, 1.0f, 0.0f),
+        Vector4(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+Matrix4x4 MatrixRotationQuaternion(const Quaternion& q)
+{
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+    return MakeMatrix(
+        Vector4(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f),
+        Vector4(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f),
+        Vector4(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f),
+        Vector4(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+Matrix4x4 MatrixPerspectiveFovRH(float fovY, float aspectRatio, float nearZ, float farZ)
+{
+    float height = 1.0f / std::tan(0.5f * fovY);
+    float width = height / aspectRatio;
+    float range = farZ / (nearZ - farZ);
+    return MakeMatrix(
+        Vector4(width, 0.0f, 0.0f, 0.0f),
+        Vector4(0.0f, height, 0.0f, 0.0f),
+        Vector4(0.0f, 0.0f, range, -1.0f),
+        Vector4(0.0f, 0.0f, range * nearZ, 0.0f));
+}
+
+Matrix4x4 MatrixLookToRH(const Vector3& eye, const Vector3& direction, const Vector3& up)
+{
+    // Base de la cámara con el eje Z apuntando hacia atrás, como en DirectXMath.
+    Vector3 back = Normalize(-direction);
+    Vector3 right = Normalize(Cross(up, back));
+    Vector3 cameraUp = Cross(back, right);
+    return MakeMatrix(
+        Vector4(right.x, cameraUp.x, back.x, 0.0f),
+        Vector4(right.y, cameraUp.y, back.y, 0.0f),
+        Vector4(right.z, cameraUp.z, back.z, 0.0f),
+        Vector4(-Dot(right, eye), -Dot(cameraUp, eye), -Dot(back, eye), 1.0f));
+}
+
+Matrix4x4 MatrixInverse(const Matrix4x4& matrix, float* determinant)
+{
+    const float* m = &matrix.r[0].x;
+    float inv[16];
+
+    inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+    inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+    inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+    inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+    inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+    inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+    inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+    inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+    inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+    inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+    inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+    inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+    inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+    inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+    inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+    inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+    float det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+    if (determinant) *determinant = det;
+    if (det == 0.0f) return MatrixIdentity();
+
+    float scale = 1.0f / det;
+    Matrix4x4 result;
+    for (int i = 0; i < 4; i++)
+    {
+        result.r[i] = Vector4(inv[4 * i] * scale, inv[4 * i + 1] * scale, inv[4 * i + 2] * scale, inv[4 * i + 3] * scale);
+    }
+    return result;
+}
+
+Quaternion QuaternionRotationAxis(const Vector3& axis, float angle)
+{
+    Vector3 n = Normalize(axis) * std::sin(0.5f * angle);
+    Quaternion q;
+    q.x = n.x;
+    q.y = n.y;
+    q.z = n.z;
+    q.w = std::cos(0.5f * angle);
+    return q;
+}
+
+Quaternion QuaternionMultiply(const Quaternion& a, const Quaternion& b)
+{
+    // Producto de Hamilton b * a: primero se aplica a y después b.
+    Quaternion q;
+    q.x = b.w * a.x + b.x * a.w + b.y * a.z - b.z * a.y;
+    q.y = b.w * a.y - b.x * a.z + b.y * a.w + b.z * a.x;
+    q.z = b.w * a.z + b.x * a.y - b.y * a.x + b.z * a.w;
+    q.w = b.w * a.w - b.x * a.x - b.y * a.y - b.z * a.z;
+    return q;
+}
+
+Quaternion QuaternionConjugate(const Quaternion& q)
+{
+    Quaternion result;
+    result.x = -q.x;
+    result.y = -q.y;
+    result.z = -q.z;
+    result.w = q.w;
+    return result;
+}
+
+Quaternion QuaternionNormalize(const Quaternion& q)
+{
+    return StoreQuaternion(Normalize4(Load(q)));
+}
+
+Quaternion QuaternionSlerp(const Quaternion& a, const Quaternion& b, float t)
+{
+    Register qa = Load(a);
+    Register qb = Load(b);
+    float cosine = GetX(Dot4(qa, qb));
+    if (cosine < 0.0f)
+    {
+        qb = Negate(qb);
+        cosine = -cosine;
+    }
+
+    // Con cuaterniones casi iguales el seno se anula; la interpolación lineal es suficiente.
+    float weightA;
+    float weightB;
+    if (cosine > 0.9995f)
+    {
+        weightA = 1.0f - t;
+        weightB = t;
+    }
+    else
+    {
+        float angle = std::acos(cosine);
+        float inverseSine = 1.0f / std::sin(angle);
+        weightA = std::sin((1.0f - t) * angle) * inverseSine;
+        weightB = std::sin(t * angle) * inverseSine;
+    }
+    return StoreQuaternion(Normalize4(MultiplyAdd(qa, Replicate(weightA), Scale(qb, weightB))));
+}
+
+Vector3 Rotate(const Vector3& v, const Quaternion& q)
+{
+    // v' = v + w * t + u x t, con t = 2 * (u x v) y u la parte vectorial de q.
+    Register u = Load(q);
+    Register p = Load(v);
+    Register t = Scale(Cross3(u, p), 2.0f);
+    Register result = MultiplyAdd(Splat<3>(u), t, p);
+    return StoreVector3(Add(result, Cross3(u, t)));
+}
+
+void TransformPoints(const Matrix4x4& m, const Vector3* input, Vector3* output, size_t count)
+{
+    size_t i = 0;
+#if defined(MYTHFORGE_SIMD_AVX2)
+    __m256 rows0 = LoadRow2(m.r[0]);
+    __m256 rows1 = LoadRow2(m.r[1]);
+    __m256 rows2 = LoadRow2(m.r[2]);
+    __m256 rows3 = LoadRow2(m.r[3]);
+    for (; i + 2 <= count; i += 2)
+    {
+        __m256 x = Broadcast2(input[i].x, input[i + 1].x);
+        __m256 y = Broadcast2(input[i].y, input[i + 1].y);
+        __m256 z = Broadcast2(input[i].z, input[i + 1].z);
+        __m256 result = _mm256_fmadd_ps(x, rows0, _mm256_fmadd_ps(y, rows1, _mm256_fmadd_ps(z, rows2, rows3)));
+        Store3(&output[i].x, _mm256_castps256_ps128(result));
+        Store3(&output[i + 1].x, _mm256_extractf128_ps(result, 1));
+    }
+#endif
+
+    Register r0 = Load(m.r[0]);
+    Register r1 = Load(m.r[1]);
+    Register r2 = Load(m.r[2]);
+    Register r3 = Load(m.r[3]);
+    for (; i < count; i++)
+    {
+        Register result = MultiplyAdd(Replicate(input[i].z), r2, r3);
+        result = MultiplyAdd(Replicate(input[i].y), r1, result);
+        Store3(&output[i].x, MultiplyAdd(Replicate(input[i].x), r0, result));
+    }
+}
+
+void TransformVectors(const Matrix4x4& m, const Vector3* input, Vector3* output, size_t count)
+{
+    size_t i = 0;
+#if defined(MYTHFORGE_SIMD_AVX2)
+    __m256 rows0 = LoadRow2(m.r[0]);
+    __m256 rows1 = LoadRow2(m.r[1]);
+    __m256 rows2 = LoadRow2(m.r[2]);
+    for (; i + 2 <= count; i += 2)
+    {
+        __m256 x = Broadcast2(input[i].x, input[i + 1].x);
+        __m256 y = Broadcast2(input[i].y, input[i + 1].y);
+        __m256 z = Broadcast2(input[i].z, input[i + 1].z);
+        __m256 result = _mm256_fmadd_ps(x, rows0, _mm256_fmadd_ps(y, rows1, _mm256_mul_ps(z, rows2)));
+        Store3(&output[i].x, _mm256_castps256_ps128(result));
+        Store3(&output[i + 1].x, _mm256_extractf128_ps(result, 1));
+    }
+#endif
+
+    Register r0 = Load(m.r[0]);
+    Register r1 = Load(m.r[1]);
+    Register r2 = Load(m.r[2]);
+    for (; i < count; i++)
+    {
+        Register result = Multiply(Replicate(input[i].z), r2);
+        result = MultiplyAdd(Replicate(input[i].y), r1, result);
+        Store3(&output[i].x, MultiplyAdd(Replicate(input[i].x), r0, result));
+    }
+}
+
+void TransformVectors4(const Matrix4x4& m, const Vector4A* input, Vector4A* output, size_t count)
+{
+    size_t i = 0;
+#if defined(MYTHFORGE_SIMD_AVX2)
+    __m256 rows0 = LoadRow2(m.r[0]);
+    __m256 rows1 = LoadRow2(m.r[1]);
+    __m256 rows2 = LoadRow2(m.r[2]);
+    __m256 rows3 = LoadRow2(m.r[3]);
+    for (; i + 2 <= count; i += 2)
+    {
+        __m256 v = _mm256_loadu_ps(&input[i].x);
+        __m256 result = _mm256_mul_ps(_mm256_permute_ps(v, _MM_SHUFFLE(3, 3, 3, 3)), rows3);
+        result = _mm256_fmadd_ps(_mm256_permute_ps(v, _MM_SHUFFLE(2, 2, 2, 2)), rows2, result);
+        result = _mm256_fmadd_ps(_mm256_permute_ps(v, _MM_SHUFFLE(1, 1, 1, 1)), rows1, result);
+        result = _mm256_fmadd_ps(_mm256_permute_ps(v, _MM_SHUFFLE(0, 0, 0, 0)), rows0, result);
+        _mm256_storeu_ps(&output[i].x, result);
+    }
+#endif
+
+    Register r0 = Load(m.r[0]);
+    Register r1 = Load(m.r[1]);
+    Register r2 = Load(m.r[2]);
+    Register r3 = Load(m.r[3]);
+    for (; i < count; i++)
+    {
+        Store4A(&output[i].x, Transform4(Load(input[i]), r0, r1, r2, r3));
+    }
+}
+
+void NormalizeVectors(const Vector3* input, Vector3* output, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        Store3(&output[i].x, Normalize3(Load(input[i])));
+    }
+}
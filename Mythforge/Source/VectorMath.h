@@ -0,0 +1,540 @@
+﻿/**
+ * @file VectorMath.h
+ * @brief Capa de matemática vectorial portable sobre los tipos de Vector.h.
+ *
+ * Las operaciones trabajan sobre Simd::Register, que se traduce a SSE (con SSE4.1 y AVX2/FMA
+ * cuando el compilador los habilita), a NEON en ARM/ARM64 o a cuatro floats en el resto de
+ * plataformas. Definir MYTHFORGE_SIMD_SCALAR fuerza la implementación escalar en cualquier
+ * arquitectura. Vector2/Vector3/Vector4 mantienen su disposición en memoria; Vector4A,
+ * Matrix4x4 y Quaternion están alineados a 16 bytes para cargarse directamente en registros.
+ *
+ * Las matrices siguen la misma convención que DirectXMath: vectores fila (v * M), de modo que
+ * MatrixMultiply(A, B) aplica primero A y después B.
+ */
+
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include "Vector.h"
+
+#if defined(MYTHFORGE_SIMD_SCALAR)
+#elif defined(__AVX2__)
+#define MYTHFORGE_SIMD_SSE
+#define MYTHFORGE_SIMD_SSE4
+#define MYTHFORGE_SIMD_AVX2
+#elif defined(__SSE4_1__) || defined(__AVX__)
+#define MYTHFORGE_SIMD_SSE
+#define MYTHFORGE_SIMD_SSE4
+#elif defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define MYTHFORGE_SIMD_SSE
+#elif defined(_M_ARM) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define MYTHFORGE_SIMD_NEON
+#else
+#define MYTHFORGE_SIMD_SCALAR
+#endif
+
+#if defined(MYTHFORGE_SIMD_AVX2)
+#include <immintrin.h>
+#elif defined(MYTHFORGE_SIMD_SSE4)
+#include <smmintrin.h>
+#elif defined(MYTHFORGE_SIMD_SSE)
+#include <emmintrin.h>
+#elif defined(MYTHFORGE_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined(MYTHFORGE_SIMD_NEON) && (defined(_M_ARM64) || defined(__aarch64__))
+#define MYTHFORGE_SIMD_NEON64
+#endif
+
+static_assert(sizeof(Vector2) == 2 * sizeof(float), "Vector2 debe seguir siendo dos floats contiguos");
+static_assert(sizeof(Vector3) == 3 * sizeof(float), "Vector3 debe seguir siendo tres floats contiguos");
+static_assert(sizeof(Vector4) == 4 * sizeof(float), "Vector4 debe seguir siendo cuatro floats contiguos");
+
+/**
+ * @struct Vector4A
+ * @brief Vector4 alineado a 16 bytes.
+ */
+struct alignas(16) Vector4A : Vector4 {
+    using Vector4::Vector4;
+    Vector4A(const Vector4& v) : Vector4(v) {}
+};
+
+/**
+ * @struct Matrix4x4
+ * @brief Matriz 4x4 por filas, alineada a 16 bytes.
+ */
+struct alignas(16) Matrix4x4 {
+    Vector4A r[4];
+};
+
+/**
+ * @struct Quaternion
+ * @brief Cuaternión de rotación (x, y, z, w), con w como parte real. Por defecto es la identidad.
+ */
+struct alignas(16) Quaternion {
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+    float w = 1.0f;
+};
+
+namespace Simd
+{
+#if defined(MYTHFORGE_SIMD_SSE)
+    using Register = __m128;
+#elif defined(MYTHFORGE_SIMD_NEON)
+    using Register = float32x4_t;
+#else
+    struct alignas(16) Register { float v[4]; };
+#endif
+
+    /// Nombre de la implementación seleccionada en compilación.
+    inline const char* BackendName()
+    {
+#if defined(MYTHFORGE_SIMD_AVX2)
+        return "AVX2";
+#elif defined(MYTHFORGE_SIMD_SSE4)
+        return "SSE4.1";
+#elif defined(MYTHFORGE_SIMD_SSE)
+        return "SSE2";
+#elif defined(MYTHFORGE_SIMD_NEON)
+        return "NEON";
+#else
+        return "Scalar";
+#endif
+    }
+
+    inline Register Set(float x, float y, float z, float w)
+    {
+#if defined(MYTHFORGE_SIMD_SSE)
+        return _mm_setr_ps(x, y, z, w);
+#elif defined(MYTHFORGE_SIMD_NEON)
+        float values[4] = { x, y, z, w };
+        return vld1q_f32(values);
+#else
+        return Register{ { x, y, z, w } };
+#endif
+    }
+
+    inline Register Replicate(float value)
+    {
+#if defined(MYTHFORGE_SIMD_SSE)
+        return _mm_set1_ps(value);
+#elif defined(MYTHFORGE_SIMD_NEON)
+        return vdupq_n_f32(value);
+#else
+        return Register{ { value, value, value, value } };
+#endif
+    }
+
+    inline Register Zero() { return Replicate(0.0f); }
+
+    /// Carga tres floats sin requisitos de alineación; w queda a cero.
+    inline Register Load3(const float* values)
+    {
+#if defined(MYTHFORGE_SIMD_SSE)
+        __m128 xy = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(values)));
+        return _mm_movelh_ps(xy, _mm_load_ss(values + 2));
+#elif defined(MYTHFORGE_SIMD_NEON)
+        float32x2_t xy = vld1_f32(values);
+        float32x2_t z0 = vld1_lane_f32(values + 2, vdup_n_f32(0.0f), 0);
+        return vcombine_f32(xy, z0);
+#else
+        return Register{ { values[0], values[1], values[2], 0.0f } };
+#endif
+    }
+
+    /// Carga cuatro floats sin requisitos de alineación.
+    inline Register Load4(const float* values)
+    {
+#if defined(MYTHFORGE_SIMD_SSE)
+        return _mm_loadu_ps(values);
+#elif defined(MYTHFORGE_SIMD_NEON)
+        return vld1q_f32(values);
+#else
+        return Register{ { values[0], values[1], values[2], values[3] } };
+#endif
+    }
+
+    /// Carga cuatro floats alineados a 16 bytes.
+    inline Register Load4A(const float* values)
+    {
+#if defined(MYTHFORGE_SIMD_SSE)
+        return _mm_load_ps(values);
+#else
+        return Load4(values);
+#endif
+    }
+
+    inline void Store3(float* values, Register v)
+    {
+#if defined(MYTHFORGE_SIMD_SSE)
+        _mm_store_sd(reinterpret_cast<double*>(values), _mm_castps_pd(v));
+        _mm_store_ss(values + 2, _mm_movehl_ps(v, v));
+#elif defined(MYTHFORGE_SIMD_NEON)
+        vst1_f32(values, vget_low_f32(v));
+        vst1q_lane_f32(values + 2, v, 2);
+#else
+        values[0] = v.v[0];
+        values[1] = v.v[1];
+        values[2] = v.v[2];
+#endif
+    }
+
+    inline void Store4(float* values, Register v)
+    {
+#if defined(MYTHFORGE_SIMD_SSE)
+        _mm_storeu_ps(values, v);
+#elif defined(MYTHFORGE_SIMD_NEON)
+        vst1q_f32(values, v);
+#else
+        for (int i = 0; i < 4; i++) values[i] = v.v[i];
+#endif
+    }
+
+    inline void Store4A(float* values, Register v)
+    {
+#if defined(MYTHFORGE_SIMD_SSE)
+        _mm_store_ps(values, v);
+#else
+        Store4(values, v);
+#endif
+    }
+
+    inline float GetX(Register v)
+    {
+#if defined(MYTHFORGE_SIMD_SSE)
+        return _mm_cvtss_f32(v);
+#elif defined(MYTHFORGE_SIMD_NEON)
+        return vgetq_lane_f32(v, 0);
+#else
+        return v.v[0];
+#endif
+    }
+
+    /// Bit i a 1 si el carril i tiene el signo activo (negativos y -0). Sirve para probar cuatro valores a la vez.
+    inline int SignMask(Register v)
+    {
+#if defined(MYTHFORGE_SIMD_SSE)
+        return _mm_movemask_ps(v);
+#elif defined(MYTHFORGE_SIMD_NEON)
+        uint32_t bits[4];
+        vst1q_u32(bits, vshrq_n_u32(vreinterpretq_u32_f32(v), 31));
+        return static_cast<int>(bits[0] | (bits[1] << 1) | (bits[2] << 2) | (bits[3] << 3));
+#else
+        return (std::signbit(v.v[0]) ? 1 : 0) | (std::signbit(v.v[1]) ? 2 : 0) | (std::signbit(v.v[2]) ? 4 : 0) | (std::signbit(v.v[3]) ? 8 : 0);
+#endif
+    }
+
+#if defined(MYTHFORGE_SIMD_SSE)
+#define MYTHFORGE_SIMD_BINARY(name, sse, neon, scalar) \
+    inline Register name(Register a, Register b) { return sse(a, b); }
+#elif defined(MYTHFORGE_SIMD_NEON)
+#define MYTHFORGE_SIMD_BINARY(name, sse, neon, scalar) \
+    inline Register name(Register a, Register b) { return neon(a, b); }
+#else
+#define MYTHFORGE_SIMD_BINARY(name, sse, neon, scalar) \
+    inline Register name(Register a, Register b) \
+    { \
+        Register r; \
+        for (int i = 0; i < 4; i++) { float x = a.v[i]; float y = b.v[i]; r.v[i] = (scalar); } \
+        return r; \
+    }
+#endif
+
+    MYTHFORGE_SIMD_BINARY(Add, _mm_add_ps, vaddq_f32, x + y)
+    MYTHFORGE_SIMD_BINARY(Subtract, _mm_sub_ps, vsubq_f32, x - y)
+    MYTHFORGE_SIMD_BINARY(Multiply, _mm_mul_ps, vmulq_f32, x * y)
+    MYTHFORGE_SIMD_BINARY(Min, _mm_min_ps, vminq_f32, x < y ? x : y)
+    MYTHFORGE_SIMD_BINARY(Max, _mm_max_ps, vmaxq_f32, x > y ? x : y)
+
+#undef MYTHFORGE_SIMD_BINARY
+
+    inline Register Divide(Register a, Register b)
+    {
+#if defined(MYTHFORGE_SIMD_SSE)
+        return _mm_div_ps(a, b);
+#elif defined(MYTHFORGE_SIMD_NEON64)
+        return vdivq_f32(a, b);
+#elif defined(MYTHFORGE_SIMD_NEON)
+        // ARMv7 no tiene división vectorial; se divide carril a carril para conservar la precisión.
+        float x[4];
+        float y[4];
+        vst1q_f32(x, a);
+        vst1q_f32(y, b);
+        for (int i = 0; i < 4; i++) x[i] /= y[i];
+        return vld1q_f32(x);
+#else
+        Register r;
+        for (int i = 0; i < 4; i++) r.v[i] = a.v[i] / b.v[i];
+        return r;
+#endif
+    }
+
+    inline Register Sqrt(Register v)
+    {
+#if defined(MYTHFORGE_SIMD_SSE)
+        return _mm_sqrt_ps(v);
+#elif defined(MYTHFORGE_SIMD_NEON64)
+        return vsqrtq_f32(v);
+#elif defined(MYTHFORGE_SIMD_NEON)
+        float x[4];
+        vst1q_f32(x, v);
+        for (int i = 0; i < 4; i++) x[i] = std::sqrt(x[i]);
+        return vld1q_f32(x);
+#else
+        Register r;
+        for (int i = 0; i < 4; i++) r.v[i] = std::sqrt(v.v[i]);
+        return r;
+#endif
+    }
+
+    /// a * b + c. Con AVX2 y en ARM64 se usa la instrucción fusionada.
+    inline Register MultiplyAdd(Register a, Register b, Register c)
+    {
+#if defined(MYTHFORGE_SIMD_AVX2)
+        return _mm_fmadd_ps(a, b, c);
+#elif defined(MYTHFORGE_SIMD_SSE)
+        return _mm_add_ps(_mm_mul_ps(a, b), c);
+#elif defined(MYTHFORGE_SIMD_NEON64)
+        return vfmaq_f32(c, a, b);
+#elif defined(MYTHFORGE_SIMD_NEON)
+        return vmlaq_f32(c, a, b);
+#else
+        Register r;
+        for (int i = 0; i < 4; i++) r.v[i] = a.v[i] * b.v[i] + c.v[i];
+        return r;
+#endif
+    }
+
+    inline Register Scale(Register v, float s) { return Multiply(v, Replicate(s)); }
+    inline Register Negate(Register v) { return Subtract(Zero(), v); }
+
+    /// Replica en los cuatro carriles el componente indicado (0 = x, ..., 3 = w).
+    template <int Lane>
+    inline Register Splat(Register v)
+    {
+        static_assert(Lane >= 0 && Lane < 4, "Carril fuera de rango");
+#if defined(MYTHFORGE_SIMD_SSE)
+        return _mm_shuffle_ps(v, v, _MM_SHUFFLE(Lane, Lane, Lane, Lane));
+#elif defined(MYTHFORGE_SIMD_NEON)
+        return vdupq_n_f32(vgetq_lane_f32(v, Lane));
+#else
+        return Replicate(v.v[Lane]);
+#endif
+    }
+
+    /// Producto escalar de xyz, replicado en los cuatro carriles.
+    inline Register Dot3(Register a, Register b)
+    {
+#if defined(MYTHFORGE_SIMD_SSE4)
+        return _mm_dp_ps(a, b, 0x7F);
+#elif defined(MYTHFORGE_SIMD_SSE)
+        __m128 m = _mm_mul_ps(a, b);
+        __m128 yz = _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 1, 2, 1));
+        __m128 sum = _mm_add_ss(m, _mm_add_ss(yz, _mm_shuffle_ps(yz, yz, _MM_SHUFFLE(1, 1, 1, 1))));
+        return _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(0, 0, 0, 0));
+#elif defined(MYTHFORGE_SIMD_NEON)
+        float32x4_t m = vsetq_lane_f32(0.0f, vmulq_f32(a, b), 3);
+        float32x2_t pair = vpadd_f32(vget_low_f32(m), vget_high_f32(m));
+        return vdupq_lane_f32(vpadd_f32(pair, pair), 0);
+#else
+        return Replicate(a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2]);
+#endif
+    }
+
+    /// Producto escalar de los cuatro componentes, replicado en los cuatro carriles.
+    inline Register Dot4(Register a, Register b)
+    {
+#if defined(MYTHFORGE_SIMD_SSE4)
+        return _mm_dp_ps(a, b, 0xFF);
+#elif defined(MYTHFORGE_SIMD_SSE)
+        __m128 m = _mm_mul_ps(a, b);
+        __m128 sum = _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+#elif defined(MYTHFORGE_SIMD_NEON)
+        float32x4_t m = vmulq_f32(a, b);
+        float32x2_t pair = vpadd_f32(vget_low_f32(m), vget_high_f32(m));
+        return vdupq_lane_f32(vpadd_f32(pair, pair), 0);
+#else
+        return Replicate(a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2] + a.v[3] * b.v[3]);
+#endif
+    }
+
+    /// Producto vectorial de xyz; w queda a cero.
+    inline Register Cross3(Register a, Register b)
+    {
+#if defined(MYTHFORGE_SIMD_SSE)
+        __m128 aYzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 bYzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 c = _mm_sub_ps(_mm_mul_ps(a, bYzx), _mm_mul_ps(aYzx, b));
+        return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+#elif defined(MYTHFORGE_SIMD_NEON)
+        // Rotación (x, y, z, w) -> (y, z, x, y) a partir de las mitades del registro; el carril w no se usa.
+        float32x4_t aYzx = vcombine_f32(vext_f32(vget_low_f32(a), vget_high_f32(a), 1), vget_low_f32(a));
+        float32x4_t bYzx = vcombine_f32(vext_f32(vget_low_f32(b), vget_high_f32(b), 1), vget_low_f32(b));
+        float32x4_t c = vsubq_f32(vmulq_f32(a, bYzx), vmulq_f32(aYzx, b));
+        float32x4_t cYzx = vcombine_f32(vext_f32(vget_low_f32(c), vget_high_f32(c), 1), vget_low_f32(c));
+        return vsetq_lane_f32(0.0f, cYzx, 3);
+#else
+        return Register{ {
+            a.v[1] * b.v[2] - a.v[2] * b.v[1],
+            a.v[2] * b.v[0] - a.v[0] * b.v[2],
+            a.v[0] * b.v[1] - a.v[1] * b.v[0],
+            0.0f } };
+#endif
+    }
+
+    /// Normaliza xyz. Un vector de longitud cero se devuelve sin cambios.
+    inline Register Normalize3(Register v)
+    {
+        Register lengthSquared = Dot3(v, v);
+        if (GetX(lengthSquared) <= 0.0f) return v;
+        return Divide(v, Sqrt(lengthSquared));
+    }
+
+    /// Normaliza los cuatro componentes. Un vector de longitud cero se devuelve sin cambios.
+    inline Register Normalize4(Register v)
+    {
+        Register lengthSquared = Dot4(v, v);
+        if (GetX(lengthSquared) <= 0.0f) return v;
+        return Divide(v, Sqrt(lengthSquared));
+    }
+
+    inline Register Load(const Vector3& v) { return Load3(&v.x); }
+    inline Register Load(const Vector4& v) { return Load4(&v.x); }
+    inline Register Load(const Vector4A& v) { return Load4A(&v.x); }
+    inline Register Load(const Quaternion& q) { return Load4A(&q.x); }
+
+    inline Vector3 StoreVector3(Register v) { Vector3 r; Store3(&r.x, v); return r; }
+    inline Vector4 StoreVector4(Register v) { Vector4 r; Store4(&r.x, v); return r; }
+    inline Quaternion StoreQuaternion(Register v) { Quaternion q; Store4A(&q.x, v); return q; }
+
+    /// Transforma v (los cuatro componentes) por las filas r0..r3: v.x * r0 + v.y * r1 + v.z * r2 + v.w * r3.
+    inline Register Transform4(Register v, Register r0, Register r1, Register r2, Register r3)
+    {
+        Register result = Multiply(Splat<3>(v), r3);
+        result = MultiplyAdd(Splat<2>(v), r2, result);
+        result = MultiplyAdd(Splat<1>(v), r1, result);
+        return MultiplyAdd(Splat<0>(v), r0, result);
+    }
+}
+
+// Operadores por valor sobre los tipos de Vector.h.
+
+inline Vector2 operator+(const Vector2& a, const Vector2& b) { return Vector2(a.x + b.x, a.y + b.y); }
+inline Vector2 operator-(const Vector2& a, const Vector2& b) { return Vector2(a.x - b.x, a.y - b.y); }
+inline Vector2 operator*(const Vector2& v, float s) { return Vector2(v.x * s, v.y * s); }
+inline Vector2 operator*(float s, const Vector2& v) { return v * s; }
+inline Vector2 operator/(const Vector2& v, float s) { return Vector2(v.x / s, v.y / s); }
+inline Vector2 operator-(const Vector2& v) { return Vector2(-v.x, -v.y); }
+inline float Dot(const Vector2& a, const Vector2& b) { return a.x * b.x + a.y * b.y; }
+inline float Length(const Vector2& v) { return std::sqrt(Dot(v, v)); }
+
+inline Vector3 operator+(const Vector3& a, const Vector3& b) { return Simd::StoreVector3(Simd::Add(Simd::Load(a), Simd::Load(b))); }
+inline Vector3 operator-(const Vector3& a, const Vector3& b) { return Simd::StoreVector3(Simd::Subtract(Simd::Load(a), Simd::Load(b))); }
+inline Vector3 operator*(const Vector3& a, const Vector3& b) { return Simd::StoreVector3(Simd::Multiply(Simd::Load(a), Simd::Load(b))); }
+inline Vector3 operator*(const Vector3& v, float s) { return Simd::StoreVector3(Simd::Scale(Simd::Load(v), s)); }
+inline Vector3 operator*(float s, const Vector3& v) { return v * s; }
+inline Vector3 operator/(const Vector3& v, float s) { return v * (1.0f / s); }
+inline Vector3 operator-(const Vector3& v) { return Vector3(-v.x, -v.y, -v.z); }
+inline Vector3& operator+=(Vector3& a, const Vector3& b) { return a = a + b; }
+inline Vector3& operator-=(Vector3& a, const Vector3& b) { return a = a - b; }
+inline Vector3& operator*=(Vector3& v, float s) { return v = v * s; }
+inline float Dot(const Vector3& a, const Vector3& b) { return Simd::GetX(Simd::Dot3(Simd::Load(a), Simd::Load(b))); }
+inline Vector3 Cross(const Vector3& a, const Vector3& b) { return Simd::StoreVector3(Simd::Cross3(Simd::Load(a), Simd::Load(b))); }
+inline float Length(const Vector3& v) { return std::sqrt(Dot(v, v)); }
+inline Vector3 Normalize(const Vector3& v) { return Simd::StoreVector3(Simd::Normalize3(Simd::Load(v))); }
+inline Vector3 Min(const Vector3& a, const Vector3& b) { return Simd::StoreVector3(Simd::Min(Simd::Load(a), Simd::Load(b))); }
+inline Vector3 Max(const Vector3& a, const Vector3& b) { return Simd::StoreVector3(Simd::Max(Simd::Load(a), Simd::Load(b))); }
+inline Vector3 Lerp(const Vector3& a, const Vector3& b, float t) { return a + (b - a) * t; }
+
+inline Vector4 operator+(const Vector4& a, const Vector4& b) { return Simd::StoreVector4(Simd::Add(Simd::Load(a), Simd::Load(b))); }
+inline Vector4 operator-(const Vector4& a, const Vector4& b) { return Simd::StoreVector4(Simd::Subtract(Simd::Load(a), Simd::Load(b))); }
+inline Vector4 operator*(const Vector4& a, const Vector4& b) { return Simd::StoreVector4(Simd::Multiply(Simd::Load(a), Simd::Load(b))); }
+inline Vector4 operator*(const Vector4& v, float s) { return Simd::StoreVector4(Simd::Scale(Simd::Load(v), s)); }
+inline Vector4 operator*(float s, const Vector4& v) { return v * s; }
+inline Vector4 operator/(const Vector4& v, float s) { return v * (1.0f / s); }
+inline Vector4 operator-(const Vector4& v) { return Vector4(-v.x, -v.y, -v.z, -v.w); }
+inline float Dot(const Vector4& a, const Vector4& b) { return Simd::GetX(Simd::Dot4(Simd::Load(a), Simd::Load(b))); }
+inline float Length(const Vector4& v) { return std::sqrt(Dot(v, v)); }
+inline Vector4 Normalize(const Vector4& v) { return Simd::StoreVector4(Simd::Normalize4(Simd::Load(v))); }
+
+// Matrices.
+
+Matrix4x4 MatrixIdentity();
+Matrix4x4 MatrixMultiply(const Matrix4x4& a, const Matrix4x4& b);
+Matrix4x4 MatrixTranspose(const Matrix4x4& m);
+Matrix4x4 MatrixTranslation(const Vector3& offset);
+Matrix4x4 MatrixScaling(const Vector3& scale);
+Matrix4x4 MatrixRotationX(float angle);
+Matrix4x4 MatrixRotationY(float angle);
+Matrix4x4 MatrixRotationZ(float angle);
+Matrix4x4 MatrixRotationQuaternion(const Quaternion& q);
+
+/// Proyección en perspectiva para un sistema de mano derecha, con z en [0, 1].
+Matrix4x4 MatrixPerspectiveFovRH(float fovY, float aspectRatio, float nearZ, float farZ);
+
+/// Matriz de vista de mano derecha mirando en la dirección direction.
+Matrix4x4 MatrixLookToRH(const Vector3& eye, const Vector3& direction, const Vector3& up);
+
+/**
+ * @brief Inversa general por cofactores.
+ * @param determinant Si no es nulo, recibe el determinante. Con determinante cero devuelve la identidad.
+ */
+Matrix4x4 MatrixInverse(const Matrix4x4& m, float* determinant = nullptr);
+
+inline Matrix4x4 operator*(const Matrix4x4& a, const Matrix4x4& b) { return MatrixMultiply(a, b); }
+
+/// Transforma un punto (w = 1) sin dividir por w.
+inline Vector3 TransformPoint(const Vector3& p, const Matrix4x4& m)
+{
+    Simd::Register v = Simd::Load(p);
+    Simd::Register result = Simd::MultiplyAdd(Simd::Splat<2>(v), Simd::Load(m.r[2]), Simd::Load(m.r[3]));
+    result = Simd::MultiplyAdd(Simd::Splat<1>(v), Simd::Load(m.r[1]), result);
+    return Simd::StoreVector3(Simd::MultiplyAdd(Simd::Splat<0>(v), Simd::Load(m.r[0]), result));
+}
+
+/// Transforma una dirección (w = 0).
+inline Vector3 TransformVector(const Vector3& d, const Matrix4x4& m)
+{
+    Simd::Register v = Simd::Load(d);
+    Simd::Register result = Simd::Multiply(Simd::Splat<2>(v), Simd::Load(m.r[2]));
+    result = Simd::MultiplyAdd(Simd::Splat<1>(v), Simd::Load(m.r[1]), result);
+    return Simd::StoreVector3(Simd::MultiplyAdd(Simd::Splat<0>(v), Simd::Load(m.r[0]), result));
+}
+
+inline Vector4 TransformVector4(const Vector4& v, const Matrix4x4& m)
+{
+    return Simd::StoreVector4(Simd::Transform4(Simd::Load(v), Simd::Load(m.r[0]), Simd::Load(m.r[1]), Simd::Load(m.r[2]), Simd::Load(m.r[3])));
+}
+
+// Cuaterniones.
+
+Quaternion QuaternionRotationAxis(const Vector3& axis, float angle);
+
+/// Composición de rotaciones: el resultado aplica primero a y después b, como MatrixMultiply.
+Quaternion QuaternionMultiply(const Quaternion& a, const Quaternion& b);
+Quaternion QuaternionConjugate(const Quaternion& q);
+Quaternion QuaternionNormalize(const Quaternion& q);
+
+/// Interpolación esférica por el camino más corto.
+Quaternion QuaternionSlerp(const Quaternion& a, const Quaternion& b, float t);
+
+/// Rota v por el cuaternión unitario q.
+Vector3 Rotate(const Vector3& v, const Quaternion& q);
+
+// Kernels por lotes. Las entradas y salidas pueden solaparse solo si son el mismo array.
+
+/// Transforma count puntos (w = 1) sin dividir por w.
+void TransformPoints(const Matrix4x4& m, const Vector3* input, Vector3* output, size_t count);
+
+/// Transforma count direcciones (w = 0).
+void TransformVectors(const Matrix4x4& m, const Vector3* input, Vector3* output, size_t count);
+
+/// Transforma count vectores de cuatro componentes.
+void TransformVectors4(const Matrix4x4& m, const Vector4A* input, Vector4A* output, size_t count);
+
+/// Normaliza count vectores; los de longitud cero se copian sin cambios.
+void NormalizeVectors(const Vector3* input, Vector3* output, size_t count);
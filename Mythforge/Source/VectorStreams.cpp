@@ -0,0 +1,153 @@
+﻿/**
+ * @file VectorStreams.cpp
+ * @brief Implementación de los flujos SoA y de sus kernels por lotes.
+ */
+
+#include "pch.h"
+#include "VectorStreams.h"
+#include <algorithm>
+
+using namespace Simd;
+
+Matrix4x4x8 BroadcastMatrix(const Matrix4x4& matrix)
+{
+    Matrix4x4x8 result;
+    for (int row = 0; row < 4; row++)
+    {
+        const float* values = &matrix.r[row].x;
+        for (int column = 0; column < 4; column++)
+        {
+            result.m[row][column] = Replicate8(values[column]);
+        }
+    }
+    return result;
+}
+
+Matrix4x4x8 LoadMatrices(const Matrix4x4* matrices)
+{
+    Matrix4x4x8 result;
+    alignas(32) float lanes[8];
+    for (int row = 0; row < 4; row++)
+    {
+        for (int column = 0; column < 4; column++)
+        {
+            for (int lane = 0; lane < 8; lane++)
+            {
+                lanes[lane] = (&matrices[lane].r[row].x)[column];
+            }
+            result.m[row][column] = Load8(lanes);
+        }
+    }
+    return result;
+}
+
+void Vector3Stream::Resize(size_t newCount)
+{
+    count = newCount;
+    blocks.resize((newCount + 7) / 8);
+}
+
+void Vector3Stream::PadTail()
+{
+    if (count == 0 || (count & 7) == 0) return;
+
+    Vector3Block& block = blocks.back();
+    size_t last = (count - 1) & 7;
+    for (size_t lane = last + 1; lane < 8; lane++)
+    {
+        block.x[lane] = block.x[last];
+        block.y[lane] = block.y[last];
+        block.z[lane] = block.z[last];
+    }
+}
+
+void Vector3Stream::Gather(const void* first, size_t stride, size_t elementCount)
+{
+    Resize(elementCount);
+    const uint8_t* source = static_cast<const uint8_t*>(first);
+    for (size_t i = 0; i < elementCount; i++)
+    {
+        const float* values = reinterpret_cast<const float*>(source + i * stride);
+        Vector3Block& block = blocks[i >> 3];
+        block.x[i & 7] = values[0];
+        block.y[i & 7] = values[1];
+        block.z[i & 7] = values[2];
+    }
+    PadTail();
+}
+
+void Vector3Stream::Scatter(void* first, size_t stride) const
+{
+    uint8_t* destination = static_cast<uint8_t*>(first);
+    for (size_t i = 0; i < count; i++)
+    {
+        float* values = reinterpret_cast<float*>(destination + i * stride);
+        const Vector3Block& block = blocks[i >> 3];
+        values[0] = block.x[i & 7];
+        values[1] = block.y[i & 7];
+        values[2] = block.z[i & 7];
+    }
+}
+
+void TransformPoints(const Matrix4x4& matrix, const Vector3Stream& input, Vector3Stream& output)
+{
+    Matrix4x4x8 transform = BroadcastMatrix(matrix);
+    output.Resize(input.Count());
+    const Vector3Block* source = input.Blocks();
+    Vector3Block* destination = output.Blocks();
+    for (size_t i = 0; i < input.BlockCount(); i++)
+    {
+        StoreBlock(destination[i], TransformPoint(LoadBlock(source[i]), transform));
+    }
+}
+
+void TransformVectors(const Matrix4x4& matrix, const Vector3Stream& input, Vector3Stream& output)
+{
+    Matrix4x4x8 transform = BroadcastMatrix(matrix);
+    output.Resize(input.Count());
+    const Vector3Block* source = input.Blocks();
+    Vector3Block* destination = output.Blocks();
+    for (size_t i = 0; i < input.BlockCount(); i++)
+    {
+        StoreBlock(destination[i], TransformVector(LoadBlock(source[i]), transform));
+    }
+}
+
+void NormalizeVectors(Vector3Stream& stream)
+{
+    Vector3Block* blocks = stream.Blocks();
+    for (size_t i = 0; i < stream.BlockCount(); i++)
+    {
+        StoreBlock(blocks[i], Normalize(LoadBlock(blocks[i])));
+    }
+}
+
+bool ComputeBounds(const Vector3Stream& stream, Vector3& boundsMin, Vector3& boundsMax)
+{
+    if (stream.Count() == 0) return false;
+
+    // Los carriles de relleno repiten el último vector, así que se pueden incluir sin comprobarlos.
+    const Vector3Block* blocks = stream.Blocks();
+    Vector3x8 low = LoadBlock(blocks[0]);
+    Vector3x8 high = low;
+    for (size_t i = 1; i < stream.BlockCount(); i++)
+    {
+        Vector3x8 v = LoadBlock(blocks[i]);
+        low = Vector3x8{ Min8(low.x, v.x), Min8(low.y, v.y), Min8(low.z, v.z) };
+        high = Vector3x8{ Max8(high.x, v.x), Max8(high.y, v.y), Max8(high.z, v.z) };
+    }
+
+    Vector3Block lowLanes;
+    Vector3Block highLanes;
+    StoreBlock(lowLanes, low);
+    StoreBlock(highLanes, high);
+    boundsMin = Vector3(
+        *std::min_element(lowLanes.x, lowLanes.x + 8),
+        *std::min_element(lowLanes.y, lowLanes.y + 8),
+        *std::min_element(lowLanes.z, lowLanes.z + 8));
+    boundsMax = Vector3(
+        *std::max_element(highLanes.x, highLanes.x + 8),
+        *std::max_element(highLanes.y, highLanes.y + 8),
+        *std::max_element(highLanes.z, highLanes.z + 8));
+    return true;
+}
@@ -0,0 +1,242 @@
+﻿/**
+ * @file VectorStreams.h
+ * @brief Flujos de vectores en estructura de arrays (SoA) para procesar geometría de ocho en ocho.
+ *
+ * Procesar un Vector3 por registro desaprovecha el carril w y obliga a barajar componentes en
+ * los productos escalares. Aquí cada registro guarda la misma componente de ocho vectores, de
+ * modo que un producto escalar son tres multiplicaciones sin barajados. Float8 usa un registro
+ * AVX de 256 bits cuando MYTHFORGE_SIMD_AVX2 está activo y dos Simd::Register en el resto de
+ * implementaciones de VectorMath.h.
+ *
+ * Vector3Stream guarda los datos en bloques de ocho (AoSoA) y se rellena desde arrays AoS con
+ * cualquier separación entre elementos, como las posiciones de Cube::vertices.
+ */
+
+#pragma once
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "VectorMath.h"
+
+namespace Simd
+{
+    /**
+     * @struct Float8
+     * @brief Ocho floats en uno o dos registros.
+     */
+    struct Float8 {
+#if defined(MYTHFORGE_SIMD_AVX2)
+        __m256 v;
+#else
+        Register lo;
+        Register hi;
+#endif
+    };
+
+    inline Float8 Replicate8(float value)
+    {
+#if defined(MYTHFORGE_SIMD_AVX2)
+        return Float8{ _mm256_set1_ps(value) };
+#else
+        return Float8{ Replicate(value), Replicate(value) };
+#endif
+    }
+
+    /// Carga ocho floats alineados a 32 bytes.
+    inline Float8 Load8(const float* values)
+    {
+#if defined(MYTHFORGE_SIMD_AVX2)
+        return Float8{ _mm256_load_ps(values) };
+#else
+        return Float8{ Load4A(values), Load4A(values + 4) };
+#endif
+    }
+
+    /// Guarda ocho floats alineados a 32 bytes.
+    inline void Store8(float* values, const Float8& f)
+    {
+#if defined(MYTHFORGE_SIMD_AVX2)
+        _mm256_store_ps(values, f.v);
+#else
+        Store4A(values, f.lo);
+        Store4A(values + 4, f.hi);
+#endif
+    }
+
+#if defined(MYTHFORGE_SIMD_AVX2)
+#define MYTHFORGE_FLOAT8_BINARY(name, avx, narrow) \
+    inline Float8 name(const Float8& a, const Float8& b) { return Float8{ avx(a.v, b.v) }; }
+#else
+#define MYTHFORGE_FLOAT8_BINARY(name, avx, narrow) \
+    inline Float8 name(const Float8& a, const Float8& b) { return Float8{ narrow(a.lo, b.lo), narrow(a.hi, b.hi) }; }
+#endif
+
+    MYTHFORGE_FLOAT8_BINARY(Add8, _mm256_add_ps, Add)
+    MYTHFORGE_FLOAT8_BINARY(Subtract8, _mm256_sub_ps, Subtract)
+    MYTHFORGE_FLOAT8_BINARY(Multiply8, _mm256_mul_ps, Multiply)
+    MYTHFORGE_FLOAT8_BINARY(Divide8, _mm256_div_ps, Divide)
+    MYTHFORGE_FLOAT8_BINARY(Min8, _mm256_min_ps, Min)
+    MYTHFORGE_FLOAT8_BINARY(Max8, _mm256_max_ps, Max)
+
+#undef MYTHFORGE_FLOAT8_BINARY
+
+    inline Float8 MultiplyAdd8(const Float8& a, const Float8& b, const Float8& c)
+    {
+#if defined(MYTHFORGE_SIMD_AVX2)
+        return Float8{ _mm256_fmadd_ps(a.v, b.v, c.v) };
+#else
+        return Float8{ MultiplyAdd(a.lo, b.lo, c.lo), MultiplyAdd(a.hi, b.hi, c.hi) };
+#endif
+    }
+
+    inline Float8 Sqrt8(const Float8& f)
+    {
+#if defined(MYTHFORGE_SIMD_AVX2)
+        return Float8{ _mm256_sqrt_ps(f.v) };
+#else
+        return Float8{ Sqrt(f.lo), Sqrt(f.hi) };
+#endif
+    }
+}
+
+/**
+ * @struct Vector3x8
+ * @brief Ocho Vector3 con las componentes separadas.
+ */
+struct Vector3x8 {
+    Simd::Float8 x;
+    Simd::Float8 y;
+    Simd::Float8 z;
+};
+
+/**
+ * @struct Matrix4x4x8
+ * @brief Ocho matrices 4x4; m[fila][columna] guarda ese elemento de las ocho.
+ */
+struct Matrix4x4x8 {
+    Simd::Float8 m[4][4];
+};
+
+/// Replica una matriz en los ocho carriles.
+Matrix4x4x8 BroadcastMatrix(const Matrix4x4& matrix);
+
+/// Reparte ocho matrices, una por carril.
+Matrix4x4x8 LoadMatrices(const Matrix4x4* matrices);
+
+inline Simd::Float8 Dot(const Vector3x8& a, const Vector3x8& b)
+{
+    using namespace Simd;
+    return MultiplyAdd8(a.z, b.z, MultiplyAdd8(a.y, b.y, Multiply8(a.x, b.x)));
+}
+
+inline Vector3x8 Cross(const Vector3x8& a, const Vector3x8& b)
+{
+    using namespace Simd;
+    return Vector3x8{
+        Subtract8(Multiply8(a.y, b.z), Multiply8(a.z, b.y)),
+        Subtract8(Multiply8(a.z, b.x), Multiply8(a.x, b.z)),
+        Subtract8(Multiply8(a.x, b.y), Multiply8(a.y, b.x)) };
+}
+
+/// Transforma ocho puntos (w = 1) por la matriz de su carril, sin dividir por w.
+inline Vector3x8 TransformPoint(const Vector3x8& p, const Matrix4x4x8& t)
+{
+    using namespace Simd;
+    Vector3x8 result;
+    result.x = MultiplyAdd8(p.x, t.m[0][0], MultiplyAdd8(p.y, t.m[1][0], MultiplyAdd8(p.z, t.m[2][0], t.m[3][0])));
+    result.y = MultiplyAdd8(p.x, t.m[0][1], MultiplyAdd8(p.y, t.m[1][1], MultiplyAdd8(p.z, t.m[2][1], t.m[3][1])));
+    result.z = MultiplyAdd8(p.x, t.m[0][2], MultiplyAdd8(p.y, t.m[1][2], MultiplyAdd8(p.z, t.m[2][2], t.m[3][2])));
+    return result;
+}
+
+/// Transforma ocho direcciones (w = 0) por la matriz de su carril.
+inline Vector3x8 TransformVector(const Vector3x8& d, const Matrix4x4x8& t)
+{
+    using namespace Simd;
+    Vector3x8 result;
+    result.x = MultiplyAdd8(d.x, t.m[0][0], MultiplyAdd8(d.y, t.m[1][0], Multiply8(d.z, t.m[2][0])));
+    result.y = MultiplyAdd8(d.x, t.m[0][1], MultiplyAdd8(d.y, t.m[1][1], Multiply8(d.z, t.m[2][1])));
+    result.z = MultiplyAdd8(d.x, t.m[0][2], MultiplyAdd8(d.y, t.m[1][2], Multiply8(d.z, t.m[2][2])));
+    return result;
+}
+
+/// Normaliza ocho vectores; los de longitud cero siguen siendo cero.
+inline Vector3x8 Normalize(const Vector3x8& v)
+{
+    using namespace Simd;
+    Float8 inverseLength = Divide8(Replicate8(1.0f), Sqrt8(Max8(Dot(v, v), Replicate8(FLT_MIN))));
+    return Vector3x8{ Multiply8(v.x, inverseLength), Multiply8(v.y, inverseLength), Multiply8(v.z, inverseLength) };
+}
+
+/**
+ * @struct Vector3Block
+ * @brief Bloque de ocho Vector3 en memoria SoA.
+ */
+struct alignas(32) Vector3Block {
+    float x[8];
+    float y[8];
+    float z[8];
+};
+
+inline Vector3x8 LoadBlock(const Vector3Block& block)
+{
+    return Vector3x8{ Simd::Load8(block.x), Simd::Load8(block.y), Simd::Load8(block.z) };
+}
+
+inline void StoreBlock(Vector3Block& block, const Vector3x8& v)
+{
+    Simd::Store8(block.x, v.x);
+    Simd::Store8(block.y, v.y);
+    Simd::Store8(block.z, v.z);
+}
+
+/**
+ * @class Vector3Stream
+ * @brief Array de Vector3 guardado en bloques SoA de ocho.
+ *
+ * Los carriles sobrantes del último bloque repiten el último vector, de modo que los kernels
+ * pueden procesar bloques completos sin alterar límites ni producir divisiones por cero.
+ */
+class Vector3Stream {
+public:
+    /**
+     * @brief Copia elementCount vectores de un array AoS.
+     * @param first Dirección del primer Vector3 (o de los tres floats equivalentes).
+     * @param stride Bytes entre elementos consecutivos.
+     */
+    void Gather(const void* first, size_t stride, size_t elementCount);
+
+    /// Escribe los vectores en un array AoS con la separación indicada.
+    void Scatter(void* first, size_t stride) const;
+
+    void Gather(const Vector3* values, size_t elementCount) { Gather(values, sizeof(Vector3), elementCount); }
+    void Scatter(Vector3* values) const { Scatter(values, sizeof(Vector3)); }
+
+    size_t Count() const { return count; }
+    size_t BlockCount() const { return blocks.size(); }
+    Vector3Block* Blocks() { return blocks.data(); }
+    const Vector3Block* Blocks() const { return blocks.data(); }
+
+    /// Ajusta el tamaño sin inicializar los datos nuevos; útil como destino de un kernel.
+    void Resize(size_t newCount);
+
+    /// Repite el último vector en los carriles sobrantes tras escribir el flujo directamente.
+    void PadTail();
+
+private:
+    std::vector<Vector3Block> blocks;
+    size_t                    count = 0;
+};
+
+/// Transforma los puntos (w = 1) de input; output se redimensiona y puede ser el mismo flujo.
+void TransformPoints(const Matrix4x4& matrix, const Vector3Stream& input, Vector3Stream& output);
+
+/// Transforma las direcciones (w = 0) de input; output se redimensiona y puede ser el mismo flujo.
+void TransformVectors(const Matrix4x4& matrix, const Vector3Stream& input, Vector3Stream& output);
+
+/// Normaliza los vectores del flujo en su sitio.
+void NormalizeVectors(Vector3Stream& stream);
+
+/// Caja alineada que contiene todos los vectores. Con un flujo vacío devuelve false.
+bool ComputeBounds(const Vector3Stream& stream, Vector3& boundsMin, Vector3& boundsMax);
@@ -0,0 +1,416 @@
+﻿/**
+ * @file AssetLoadBenchmark.cpp
+ * @brief Compara la carga de cientos de recursos en serie y en paralelo con Task y AssetLoading::ReadFile.
+ *
+ * Uso: AssetLoadBenchmark [--assets N] [--dir carpeta] [--threads N] [--io-us N] [--repeat N] [--required N]
+ *
+ * Escribe en la carpeta (por defecto una temporal) N texturas RGBA8 sin comprimir, de 64 a 512
+ * píxeles de lado, si no están ya. Cargar una es esperar la latencia del almacenamiento, leerla
+ * con ReadFile y generar su cadena de mips con un filtro de caja, como haría el motor con una
+ * textura que no los trae. --io-us es esa latencia: una espera que no ocupa hilos del pool, como
+ * la E/S solapada de un disco frío; con 0 solo cuenta la caché de ficheros del sistema.
+ *
+ * En serie se espera cada carga con SyncWait antes de pedir la siguiente; en paralelo se piden
+ * todas con WhenAll. Se escribe en CSV el mejor tiempo de --repeat repeticiones de cada modo y
+ * se comprueba que los dos cargan lo mismo; devuelve 1 si no.
+ *
+ * Una segunda tabla mide el arranque con StartupLoader: las --required primeras (por defecto una
+ * de cada diez) son las que necesita el primer fotograma y el resto llega después. Se compara con
+ * el arranque síncrono, en el que el primer fotograma espera a la carga en serie de todas.
+ *
+ * Compila en cualquier plataforma con corrutinas de C++20 (en MSVC vale /std:c++17 /await):
+ *
+ *     g++ -std=c++20 -O2 -I Tools/AssetLoadBenchmark -I Mythforge/Source
+ *         Tools/AssetLoadBenchmark/AssetLoadBenchmark.cpp Mythforge/Source/AsyncFile.cpp
+ *         Mythforge/Source/StartupLoader.cpp Mythforge/Source/JobSystem.cpp
+ *         Mythforge/Source/AllocationTracker.cpp Mythforge/Source/Profiler.cpp -pthread
+ */
+
+#include "pch.h"
+#include "AsyncFile.h"
+#include "JobSystem.h"
+#include "StartupLoader.h"
+#include "Task.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr uint32_t AssetMagic = 0x5854464D;  ///< "MFTX"
+
+    struct AssetHeader {
+        uint32_t magic;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    struct LoadedAsset {
+        uint32_t mips = 0;
+        uint64_t bytes = 0;
+        uint64_t checksum = 0;
+    };
+
+    /**
+     * @class DelayQueue
+     * @brief Esperas de duración fija que no ocupan hilos del pool.
+     *
+     * Un hilo propio reanuda cada corrutina en el JobSystem cuando vence su plazo.
+     */
+    class DelayQueue {
+    public:
+        explicit DelayQueue(JobSystem& jobSystem) : jobSystem(jobSystem), thread(&DelayQueue::Loop, this) {}
+
+        ~DelayQueue()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            thread.join();
+        }
+
+        struct Awaiter {
+            DelayQueue&               queue;
+            std::chrono::microseconds delay;
+
+            bool await_ready() const noexcept { return delay.count() <= 0; }
+            void await_suspend(TaskDetail::coroutine_handle<> handle) { queue.Add(Clock::now() + delay, handle); }
+            void await_resume() const noexcept {}
+        };
+
+        Awaiter After(std::chrono::microseconds delay) { return { *this, delay }; }
+
+    private:
+        void Add(Clock::time_point time, TaskDetail::coroutine_handle<> handle)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                due.emplace(time, handle);
+            }
+            wake.notify_one();
+        }
+
+        void Loop()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!stopping || !due.empty())
+            {
+                if (due.empty())
+                {
+                    wake.wait(lock);
+                    continue;
+                }
+                auto first = due.begin();
+                if (first->first > Clock::now())
+                {
+                    wake.wait_until(lock, first->first);
+                    continue;
+                }
+                TaskDetail::coroutine_handle<> handle = first->second;
+                due.erase(first);
+                lock.unlock();
+                jobSystem.Submit([handle]() { handle.resume(); });
+                lock.lock();
+            }
+        }
+
+        JobSystem&                                               jobSystem;
+        std::mutex                                               mutex;
+        std::condition_variable                                  wake;
+        std::multimap<Clock::time_point, TaskDetail::coroutine_handle<>> due;
+        bool                                                     stopping = false;
+        std::thread                                              thread;
+    };
+
+    std::filesystem::path AssetPath(const std::filesystem::path& directory, uint32_t index)
+    {
+        return directory / ("asset" + std::to_string(index) + ".mftx");
+    }
+
+    /// Lados de 64, 128, 256 y 512 píxeles, repartidos por igual.
+    uint32_t AssetSide(uint32_t index)
+    {
+        return 64u << (index % 4);
+    }
+
+    void WriteAssets(const std::filesystem::path& directory, uint32_t count)
+    {
+        std::filesystem::create_directories(directory);
+        uint32_t state = 2463534242u;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            AssetHeader header = { AssetMagic, AssetSide(i), AssetSide(i) };
+            uint64_t size = sizeof(header) + uint64_t(header.width) * header.height * 4;
+            std::filesystem::path path = AssetPath(directory, i);
+            std::error_code error;
+            if (std::filesystem::file_size(path, error) == size) continue;
+
+            std::vector<uint8_t> pixels(static_cast<size_t>(size - sizeof(header)));
+            for (uint8_t& value : pixels)
+            {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                value = static_cast<uint8_t>(state);
+            }
+            std::ofstream file(path, std::ios::binary);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+            if (!file)
+            {
+                throw std::runtime_error("No se puede escribir " + path.string());
+            }
+        }
+    }
+
+    uint64_t Hash(uint64_t hash, const uint8_t* data, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ data[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    /// Cadena de mips completa con un filtro de caja 2x2; el resumen cubre todos los niveles.
+    LoadedAsset Decode(const std::vector<uint8_t>& file)
+    {
+        AssetHeader header;
+        if (file.size() < sizeof(header)) throw std::runtime_error("Recurso truncado");
+        memcpy(&header, file.data(), sizeof(header));
+        if (header.magic != AssetMagic || file.size() != sizeof(header) + uint64_t(header.width) * header.height * 4)
+        {
+            throw std::runtime_error("Recurso no válido");
+        }
+
+        LoadedAsset asset;
+        std::vector<uint8_t> level(file.begin() + sizeof(header), file.end());
+        std::vector<uint8_t> next;
+        uint32_t width = header.width;
+        uint32_t height = header.height;
+        asset.checksum = Hash(14695981039346656037ull, level.data(), level.size());
+        asset.bytes = level.size();
+        asset.mips = 1;
+        while (width > 1 || height > 1)
+        {
+            uint32_t nextWidth = (std::max)(width / 2, 1u);
+            uint32_t nextHeight = (std::max)(height / 2, 1u);
+            next.resize(size_t(nextWidth) * nextHeight * 4);
+            for (uint32_t y = 0; y < nextHeight; y++)
+            {
+                const uint8_t* row0 = &level[size_t(y * 2) * width * 4];
+                const uint8_t* row1 = &level[size_t((std::min)(y * 2 + 1, height - 1)) * width * 4];
+                for (uint32_t x = 0; x < nextWidth; x++)
+                {
+                    uint32_t x0 = x * 2 * 4;
+                    uint32_t x1 = (std::min)(x * 2 + 1, width - 1) * 4;
+                    for (uint32_t c = 0; c < 4; c++)
+                    {
+                        next[(size_t(y) * nextWidth + x) * 4 + c] = static_cast<uint8_t>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+                    }
+                }
+            }
+            level.swap(next);
+            width = nextWidth;
+            height = nextHeight;
+            asset.checksum = Hash(asset.checksum, level.data(), level.size());
+            asset.bytes += level.size();
+            asset.mips++;
+        }
+        return asset;
+    }
+
+    Task<LoadedAsset> LoadAsset(JobSystem& jobSystem, DelayQueue& storage, std::filesystem::path path, std::chrono::microseconds latency)
+    {
+        co_await storage.After(latency);
+        std::vector<uint8_t> file = co_await AssetLoading::ReadFile(jobSystem, path);
+        co_return Decode(file);
+    }
+
+    struct Run {
+        double             seconds = 0.0;
+        std::vector<LoadedAsset> assets;
+    };
+
+    Run LoadSerial(JobSystem& jobSystem, DelayQueue& storage, const std::filesystem::path& directory, uint32_t count, std::chrono::microseconds latency)
+    {
+        Run run;
+        run.assets.reserve(count);
+        Clock::time_point start = Clock::now();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            run.assets.push_back(SyncWait(LoadAsset(jobSystem, storage, AssetPath(directory, i), latency)));
+        }
+        run.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return run;
+    }
+
+    Run LoadParallel(JobSystem& jobSystem, DelayQueue& storage, const std::filesystem::path& directory, uint32_t count, std::chrono::microseconds latency)
+    {
+        Run run;
+        Clock::time_point start = Clock::now();
+        std::vector<Task<LoadedAsset>> tasks;
+        tasks.reserve(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            tasks.push_back(LoadAsset(jobSystem, storage, AssetPath(directory, i), latency));
+        }
+        run.assets = SyncWait(WhenAll(std::move(tasks)));
+        run.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return run;
+    }
+
+    Task<void> LoadInto(JobSystem& jobSystem, DelayQueue& storage, std::filesystem::path path, std::chrono::microseconds latency, LoadedAsset& asset)
+    {
+        asset = co_await LoadAsset(jobSystem, storage, std::move(path), latency);
+    }
+
+    struct StartupRun {
+        StartupStats             stats;
+        std::vector<LoadedAsset> assets;
+    };
+
+    /// Las requeridas se piden primero, como en la app: son las primeras en la cola del JobSystem.
+    StartupRun LoadStartup(JobSystem& jobSystem, DelayQueue& storage, const std::filesystem::path& directory, uint32_t count, uint32_t required, std::chrono::microseconds latency)
+    {
+        StartupRun run;
+        run.assets.resize(count);
+        StartupLoader loader;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            loader.Add("asset", LoadInto(jobSystem, storage, AssetPath(directory, i), latency, run.assets[i]), i < required);
+        }
+        loader.Seal();
+        loader.Wait();
+        loader.ThrowIfFailed();
+        run.stats = loader.Stats();
+        return run;
+    }
+
+    bool SameAssets(const std::vector<LoadedAsset>& a, const std::vector<LoadedAsset>& b)
+    {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            if (a[i].checksum != b[i].checksum || a[i].mips != b[i].mips) return false;
+        }
+        return true;
+    }
+
+    int Usage()
+    {
+        std::cerr << "Uso: AssetLoadBenchmark [--assets N] [--dir carpeta] [--threads N] [--io-us N] [--repeat N] [--required N]\n";
+        return 2;
+    }
+
+    void WriteRow(const char* mode, uint32_t threads, const Run& run)
+    {
+        uint64_t bytes = 0;
+        for (const LoadedAsset& asset : run.assets)
+        {
+            bytes += asset.bytes;
+        }
+        std::cout << mode << ',' << run.assets.size() << ',' << threads << ',' << run.seconds * 1000.0 << ','
+            << run.assets.size() / run.seconds << ',' << bytes / run.seconds / (1024.0 * 1024.0) << '\n';
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t count = 400;
+    uint32_t threads = 0;
+    uint32_t repeat = 3;
+    uint32_t required = 0;
+    int64_t ioMicroseconds = 0;
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "MythforgeAssetLoadBenchmark";
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--assets") == 0 && i + 1 < argc)
+        {
+            count = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc)
+        {
+            directory = argv[++i];
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--io-us") == 0 && i + 1 < argc)
+        {
+            ioMicroseconds = strtoll(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+        {
+            repeat = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--required") == 0 && i + 1 < argc)
+        {
+            required = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            return Usage();
+        }
+    }
+    if (count == 0 || repeat == 0 || required > count)
+    {
+        return Usage();
+    }
+    if (required == 0)
+    {
+        required = (std::max)(count / 10, 1u);
+    }
+
+    WriteAssets(directory, count);
+
+    // Sin --threads, los mismos hilos que usa el motor: uno menos que núcleos.
+    JobSystem jobSystem(threads);
+    DelayQueue storage(jobSystem);
+    std::chrono::microseconds latency(ioMicroseconds);
+
+    Run serial;
+    Run parallel;
+    StartupRun startup;
+    for (uint32_t i = 0; i < repeat; i++)
+    {
+        Run run = LoadSerial(jobSystem, storage, directory, count, latency);
+        if (i == 0 || run.seconds < serial.seconds) serial = std::move(run);
+        run = LoadParallel(jobSystem, storage, directory, count, latency);
+        if (i == 0 || run.seconds < parallel.seconds) parallel = std::move(run);
+        StartupRun startupRun = LoadStartup(jobSystem, storage, directory, count, required, latency);
+        if (i == 0 || startupRun.stats.requiredReadyMs < startup.stats.requiredReadyMs) startup = std::move(startupRun);
+    }
+
+    std::cout << "mode,assets,threads,ms,assetsPerSec,decodedMBPerSec\n";
+    WriteRow("serial", jobSystem.WorkerCount(), serial);
+    WriteRow("parallel", jobSystem.WorkerCount(), parallel);
+
+    // En el arranque síncrono el primer fotograma espera a que acabe la carga en serie de todo.
+    std::cout << "\nstartup,assets,required,threads,firstFrameMs,fullyLoadedMs\n";
+    std::cout << "serial," << count << ',' << required << ',' << jobSystem.WorkerCount() << ','
+        << serial.seconds * 1000.0 << ',' << serial.seconds * 1000.0 << '\n';
+    std::cout << "concurrent," << count << ',' << required << ',' << jobSystem.WorkerCount() << ','
+        << startup.stats.requiredReadyMs << ',' << startup.stats.fullyLoadedMs << '\n';
+
+    if (!SameAssets(serial.assets, parallel.assets) || !SameAssets(serial.assets, startup.assets))
+    {
+        std::cerr << "Las cargas en serie, en paralelo y del arranque no coinciden\n";
+        return 1;
+    }
+    return 0;
+}
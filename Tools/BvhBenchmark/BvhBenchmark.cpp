@@ -0,0 +1,316 @@
+﻿/**
+ * @file BvhBenchmark.cpp
+ * @brief Mide la construcción, el reajuste y las consultas de Bvh4 de cien mil a diez millones de primitivos.
+ *
+ * Uso: BvhBenchmark [--sizes N,N,...] [--threads N] [--repeat N] [--rays N] [--verify N]
+ *
+ * Para cada tamaño (por defecto 100000, 1000000 y 10000000) se reparten cajas de 0,5 a 2 m por un
+ * volumen aplanado cuyo lado crece con la raíz cúbica del número de cajas, de modo que la
+ * densidad es la misma en todos. Se mide:
+ *
+ * - build: Build en un solo hilo.
+ * - build-parallel: Build con el JobSystem.
+ * - refit: Refit después de mover todas las cajas hasta un metro.
+ * - rebuild: Build en paralelo sobre las cajas movidas, para comparar su coste SAH con el de refit.
+ * - cull: CullFrustum con 16 vistas desde dentro del volumen.
+ * - raycast: Raycast con --rays rayos al azar (por defecto 100000).
+ *
+ * Se escribe en CSV el mejor tiempo de --repeat repeticiones, el rendimiento (primitivos, vistas
+ * o rayos por segundo) y, en las construcciones, el coste SAH. Hasta --verify primitivos (por
+ * defecto un millón) se comparan las consultas con la fuerza bruta; devuelve 1 si no coinciden.
+ * Necesita DirectXMath, que en Windows viene con el SDK:
+ *
+ *     cl /std:c++17 /O2 /EHsc /I Tools\BvhBenchmark /I Mythforge\Source Tools\BvhBenchmark\BvhBenchmark.cpp
+ *         Mythforge\Source\Culling.cpp Mythforge\Source\Bvh.cpp Mythforge\Source\JobSystem.cpp
+ *         Mythforge\Source\AllocationTracker.cpp Mythforge\Source\Profiler.cpp
+ *
+ * En otras plataformas, con DIRECTXMATH apuntando a un clon de microsoft/DirectXMath y
+ * DIRECTX_HEADERS a uno de microsoft/DirectX-Headers, que trae el sal.h que DirectXMath incluye:
+ *
+ *     g++ -std=c++17 -O2 -isystem "$DIRECTXMATH/Inc" -isystem "$DIRECTX_HEADERS/include/wsl/stubs"
+ *         -I Tools/BvhBenchmark -I Mythforge/Source Tools/BvhBenchmark/BvhBenchmark.cpp
+ *         Mythforge/Source/Culling.cpp Mythforge/Source/Bvh.cpp Mythforge/Source/JobSystem.cpp
+ *         Mythforge/Source/AllocationTracker.cpp Mythforge/Source/Profiler.cpp -pthread
+ */
+
+#include "pch.h"
+#include "Bvh.h"
+#include "Culling.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr uint32_t ViewCount = 16;
+    constexpr uint32_t VerifiedRays = 256;
+
+    /// Semilado del volumen para count cajas: unas 0,1 cajas por metro cúbico.
+    float VolumeHalfSize(uint32_t count)
+    {
+        return 0.5f * std::cbrt(count * 10.0f * 10.0f);
+    }
+
+    CullingBounds RandomBoxes(uint32_t count, std::mt19937& random)
+    {
+        float half = VolumeHalfSize(count);
+        std::uniform_real_distribution<float> position(-half, half);
+        std::uniform_real_distribution<float> extent(0.25f, 1.0f);
+
+        CullingBounds bounds;
+        bounds.blocks.reserve((count + 3) / 4);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            bounds.Add(XMFLOAT3(position(random), 0.1f * position(random), position(random)),
+                XMFLOAT3(extent(random), extent(random), extent(random)));
+        }
+        return bounds;
+    }
+
+    void MoveBoxes(CullingBounds& bounds, std::mt19937& random)
+    {
+        std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+        for (uint32_t i = 0; i < bounds.count; i++)
+        {
+            XMFLOAT3 center = bounds.Center(i);
+            center.x += offset(random);
+            center.y += offset(random);
+            center.z += offset(random);
+            bounds.Set(i, center, bounds.Extents(i));
+        }
+    }
+
+    std::vector<Frustum> RandomViews(uint32_t count, std::mt19937& random)
+    {
+        float half = VolumeHalfSize(count);
+        std::uniform_real_distribution<float> position(-half, half);
+        std::uniform_real_distribution<float> heading(0.0f, XM_2PI);
+        XMMATRIX projection = XMMatrixPerspectiveFovRH(70.0f * XM_PI / 180.0f, 16.0f / 9.0f, 0.1f, 200.0f);
+
+        std::vector<Frustum> views;
+        for (uint32_t i = 0; i < ViewCount; i++)
+        {
+            float angle = heading(random);
+            XMVECTOR eye = XMVectorSet(position(random), 0.0f, position(random), 1.0f);
+            XMVECTOR forward = XMVectorSet(std::sin(angle), 0.0f, std::cos(angle), 0.0f);
+            XMMATRIX view = XMMatrixLookToRH(eye, forward, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+            views.push_back(ExtractFrustum(XMMatrixMultiply(view, projection)));
+        }
+        return views;
+    }
+
+    struct Ray {
+        XMFLOAT3 origin;
+        XMFLOAT3 direction;
+    };
+
+    std::vector<Ray> RandomRays(uint32_t primitives, uint32_t count, std::mt19937& random)
+    {
+        float half = VolumeHalfSize(primitives);
+        std::uniform_real_distribution<float> position(-half, half);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        std::vector<Ray> rays(count);
+        for (Ray& ray : rays)
+        {
+            ray.origin = XMFLOAT3(position(random), 0.1f * position(random), position(random));
+            XMFLOAT3 direction(unit(random), 0.1f * unit(random), unit(random));
+            XMStoreFloat3(&ray.direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+        }
+        return rays;
+    }
+
+    /// Distancia de entrada del rayo más cercana entre todas las cajas, o maxDistance si no toca ninguna.
+    float BruteForceRaycast(const CullingBounds& bounds, const Ray& ray, float maxDistance)
+    {
+        float closest = maxDistance;
+        for (uint32_t i = 0; i < bounds.count; i++)
+        {
+            XMFLOAT3 center = bounds.Center(i);
+            XMFLOAT3 extents = bounds.Extents(i);
+            float enter = 0.0f;
+            float exit = maxDistance;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                float inverse = 1.0f / (&ray.direction.x)[axis];
+                float t1 = ((&center.x)[axis] - (&extents.x)[axis] - (&ray.origin.x)[axis]) * inverse;
+                float t2 = ((&center.x)[axis] + (&extents.x)[axis] - (&ray.origin.x)[axis]) * inverse;
+                enter = std::max(enter, std::min(t1, t2));
+                exit = std::min(exit, std::max(t1, t2));
+            }
+            if (enter <= exit && enter < closest)
+            {
+                closest = enter;
+            }
+        }
+        return closest;
+    }
+
+    template<typename Run>
+    double Best(uint32_t repeat, Run&& run)
+    {
+        double best = 0.0;
+        for (uint32_t i = 0; i < repeat; i++)
+        {
+            Clock::time_point start = Clock::now();
+            run();
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            if (i == 0 || seconds < best) best = seconds;
+        }
+        return best;
+    }
+
+    void WriteRow(const char* benchmark, uint32_t primitives, uint32_t threads, double seconds, double work, const char* unit, float sahCost = 0.0f)
+    {
+        std::cout << benchmark << ',' << primitives << ',' << threads << ',' << seconds * 1000.0 << ','
+            << work / seconds << ',' << unit << ',';
+        if (sahCost > 0.0f)
+        {
+            std::cout << sahCost;
+        }
+        std::cout << '\n';
+    }
+
+    int Usage()
+    {
+        std::cerr << "Uso: BvhBenchmark [--sizes N,N,...] [--threads N] [--repeat N] [--rays N] [--verify N]\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<uint32_t> sizes = { 100000, 1000000, 10000000 };
+    uint32_t threads = 0;
+    uint32_t repeat = 3;
+    uint32_t rayCount = 100000;
+    uint32_t verifyLimit = 1000000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc)
+        {
+            sizes.clear();
+            for (char* cursor = argv[++i]; *cursor; )
+            {
+                sizes.push_back(static_cast<uint32_t>(strtoul(cursor, &cursor, 10)));
+                if (*cursor == ',') cursor++;
+                else if (*cursor) return Usage();
+            }
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+        {
+            repeat = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--rays") == 0 && i + 1 < argc)
+        {
+            rayCount = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--verify") == 0 && i + 1 < argc)
+        {
+            verifyLimit = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            return Usage();
+        }
+    }
+    if (sizes.empty() || std::find(sizes.begin(), sizes.end(), 0u) != sizes.end() || repeat == 0 || rayCount == 0)
+    {
+        return Usage();
+    }
+
+    JobSystem jobSystem(threads);
+    uint32_t workers = jobSystem.WorkerCount() + 1;
+    bool ok = true;
+
+    std::cout << "benchmark,primitives,threads,ms,throughput,unit,sahCost\n";
+    for (uint32_t size : sizes)
+    {
+        std::mt19937 random(size);
+        CullingBounds bounds = RandomBoxes(size, random);
+        Bvh4 bvh;
+
+        double seconds = Best(repeat, [&]() { bvh.Build(bounds); });
+        WriteRow("build", size, 1, seconds, size, "primitives/s", bvh.SahCost());
+
+        seconds = Best(repeat, [&]() { bvh.Build(bounds, &jobSystem); });
+        WriteRow("build-parallel", size, workers, seconds, size, "primitives/s", bvh.SahCost());
+
+        // Refit sobre las cajas movidas; repetirlo no cambia nada más que el tiempo.
+        CullingBounds moved = bounds;
+        MoveBoxes(moved, random);
+        seconds = Best(repeat, [&]() { bvh.Refit(moved); });
+        WriteRow("refit", size, 1, seconds, size, "primitives/s", bvh.SahCost());
+
+        Bvh4 rebuilt;
+        seconds = Best(repeat, [&]() { rebuilt.Build(moved, &jobSystem); });
+        WriteRow("rebuild", size, workers, seconds, size, "primitives/s", rebuilt.SahCost());
+
+        std::vector<Frustum> views = RandomViews(size, random);
+        std::vector<uint32_t> visible;
+        seconds = Best(repeat, [&]() {
+            for (const Frustum& frustum : views)
+            {
+                visible.clear();
+                bvh.CullFrustum(frustum, visible);
+            }
+        });
+        WriteRow("cull", size, 1, seconds, ViewCount, "views/s");
+
+        std::vector<Ray> rays = RandomRays(size, rayCount, random);
+        float maxDistance = 2.0f * VolumeHalfSize(size);
+        uint32_t hits = 0;
+        seconds = Best(repeat, [&]() {
+            hits = 0;
+            for (const Ray& ray : rays)
+            {
+                RayHit hit;
+                hits += bvh.Raycast(ray.origin, ray.direction, maxDistance, hit);
+            }
+        });
+        WriteRow("raycast", size, 1, seconds, rayCount, "rays/s");
+
+        if (size > verifyLimit) continue;
+
+        // Se comprueba el árbol reajustado, que es el que más fácil tendría cajas mal actualizadas.
+        for (const Frustum& frustum : views)
+        {
+            std::vector<uint32_t> expected;
+            visible.clear();
+            CullAabbs(frustum, moved, expected);
+            bvh.CullFrustum(frustum, visible);
+            std::sort(expected.begin(), expected.end());
+            std::sort(visible.begin(), visible.end());
+            ok = ok && visible == expected;
+        }
+        for (uint32_t i = 0; i < VerifiedRays && i < rays.size(); i++)
+        {
+            RayHit hit;
+            bool found = bvh.Raycast(rays[i].origin, rays[i].direction, maxDistance, hit);
+            float expected = BruteForceRaycast(moved, rays[i], maxDistance);
+            bool expectedFound = expected < maxDistance;
+            ok = ok && found == expectedFound && (!found || std::fabs(hit.distance - expected) <= 1e-3f * std::max(1.0f, expected));
+        }
+    }
+
+    if (!ok)
+    {
+        std::cerr << "Las consultas de Bvh4 no coinciden con la fuerza bruta\n";
+        return 1;
+    }
+    return 0;
+}
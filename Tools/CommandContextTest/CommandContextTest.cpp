@@ -0,0 +1,377 @@
+﻿/**
+ * @file CommandContextTest.cpp
+ * @brief Prueba del filtro de estado redundante de CommandContext sobre una lista de Direct3D 12.
+ *
+ * Uso: CommandContextTest [--draws N]
+ *
+ * Graba fotogramas de N dibujos (por defecto 100, un número par) sobre una lista de comandos real
+ * a través de CommandContext, con la misma secuencia de estado que Cube::Render: firma raíz,
+ * montón de descriptores, PSO, dos tablas raíz (una distinta por dibujo), topología y búferes de
+ * vértices e índices. La lista no se ejecuta. Tras cada fotograma se leen los contadores de
+ * RenderStats y se comprueba:
+ *
+ * - filtered: con el filtro activo cada estado compartido llega a la lista una vez y las demás
+ *   llamadas cuentan como Skipped*; la tabla que cambia en cada dibujo se envía siempre.
+ * - unfiltered: sin filtro se reenvían todas las llamadas y no se descarta ninguna.
+ * - topology: alternando TRIANGLELIST y TRIANGLESTRIP cada cambio cuenta en TopologyChanges y
+ *   las primitivas se cuentan con la topología vigente.
+ * - pipelines: alternando dos PSO se envían todos y la topología repetida se sigue descartando.
+ * - invalidate: tras InvalidateState a mitad de fotograma el estado se vuelve a enviar una vez.
+ * - reset: Reset olvida el estado del fotograma anterior y el primero se repite igual.
+ *
+ * Escribe en la salida estándar los contadores de cada fotograma, en CSV, y devuelve 1 si algo
+ * falla. Solo compila en Windows; crea un dispositivo sobre el adaptador por defecto:
+ *
+ *     cl /std:c++17 /O2 /EHsc /I Tools\CommandContextTest /I Mythforge\Source Tools\CommandContextTest\CommandContextTest.cpp
+ *         Mythforge\Source\CommandContext.cpp Mythforge\Source\CommandCapture.cpp Mythforge\Source\RenderStats.cpp
+ */
+
+#include "pch.h"
+#include "CommandContext.h"
+#include "RenderStats.h"
+#include <d3dcompiler.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+
+#pragma comment(lib, "d3d12.lib")
+#pragma comment(lib, "d3dcompiler.lib")
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    constexpr UINT DescriptorCount = 1024;
+    constexpr UINT IndexCount = 36;
+    constexpr UINT64 BufferSize = 64 * 1024;
+
+    const char shaderSource[] =
+        "float4 VSMain(float3 position : POSITION) : SV_Position { return float4(position, 1.0f); }\n"
+        "float4 PSMain() : SV_Target { return float4(1.0f, 1.0f, 1.0f, 1.0f); }\n";
+
+    /**
+     * @struct Objects
+     * @brief Objetos de Direct3D sobre los que se graba; no se dibuja nada con ellos.
+     */
+    struct Objects {
+        ComPtr<ID3D12Device>                device;
+        ComPtr<ID3D12CommandAllocator>      allocator;
+        ComPtr<ID3D12GraphicsCommandList2>  commandList;
+        ComPtr<ID3D12RootSignature>         rootSignature;
+        ComPtr<ID3D12PipelineState>         pipelines[2];
+        ComPtr<ID3D12DescriptorHeap>        heap;
+        ComPtr<ID3D12Resource>              buffer;
+        UINT                                descriptorSize = 0;
+    };
+
+    int Usage()
+    {
+        std::cerr << "Uso: CommandContextTest [--draws N]\n";
+        return 2;
+    }
+
+    bool Report(const char* name, bool passed)
+    {
+        std::cerr << name << (passed ? ": ok\n" : ": FALLO\n");
+        return passed;
+    }
+
+    bool Compile(const char* entryPoint, const char* target, ComPtr<ID3DBlob>& blob)
+    {
+        ComPtr<ID3DBlob> errors;
+        return SUCCEEDED(D3DCompile(shaderSource, sizeof(shaderSource) - 1, nullptr, nullptr, nullptr, entryPoint, target, 0, 0, &blob, &errors));
+    }
+
+    bool Create(Objects& objects)
+    {
+        if (FAILED(D3D12CreateDevice(nullptr, D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&objects.device))))
+        {
+            return false;
+        }
+        ID3D12Device* device = objects.device.Get();
+
+        if (FAILED(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&objects.allocator))) ||
+            FAILED(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, objects.allocator.Get(), nullptr, IID_PPV_ARGS(&objects.commandList))))
+        {
+            return false;
+        }
+
+        // Dos tablas como las de Cube::Render: constantes del objeto y textura del material.
+        CD3DX12_DESCRIPTOR_RANGE ranges[2];
+        ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0);
+        ranges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+        CD3DX12_ROOT_PARAMETER parameters[2];
+        parameters[0].InitAsDescriptorTable(1, &ranges[0], D3D12_SHADER_VISIBILITY_VERTEX);
+        parameters[1].InitAsDescriptorTable(1, &ranges[1], D3D12_SHADER_VISIBILITY_PIXEL);
+        CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc(2, parameters, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+        ComPtr<ID3DBlob> rootSignatureBlob;
+        ComPtr<ID3DBlob> errors;
+        if (FAILED(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &rootSignatureBlob, &errors)) ||
+            FAILED(device->CreateRootSignature(0, rootSignatureBlob->GetBufferPointer(), rootSignatureBlob->GetBufferSize(), IID_PPV_ARGS(&objects.rootSignature))))
+        {
+            return false;
+        }
+
+        ComPtr<ID3DBlob> vertexShader;
+        ComPtr<ID3DBlob> pixelShader;
+        if (!Compile("VSMain", "vs_5_0", vertexShader) || !Compile("PSMain", "ps_5_0", pixelShader))
+        {
+            return false;
+        }
+
+        const D3D12_INPUT_ELEMENT_DESC inputLayout[] = {
+            { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        };
+
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC pipelineDesc = {};
+        pipelineDesc.pRootSignature = objects.rootSignature.Get();
+        pipelineDesc.VS = CD3DX12_SHADER_BYTECODE(vertexShader.Get());
+        pipelineDesc.PS = CD3DX12_SHADER_BYTECODE(pixelShader.Get());
+        pipelineDesc.InputLayout = { inputLayout, _countof(inputLayout) };
+        pipelineDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+        pipelineDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+        pipelineDesc.DepthStencilState.DepthEnable = FALSE;
+        pipelineDesc.SampleMask = UINT_MAX;
+        pipelineDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+        pipelineDesc.NumRenderTargets = 1;
+        pipelineDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+        pipelineDesc.SampleDesc.Count = 1;
+
+        // El segundo PSO solo cambia el recorte de caras, lo justo para ser otro objeto.
+        for (UINT i = 0; i < 2; i++)
+        {
+            pipelineDesc.RasterizerState.CullMode = i == 0 ? D3D12_CULL_MODE_BACK : D3D12_CULL_MODE_NONE;
+            if (FAILED(device->CreateGraphicsPipelineState(&pipelineDesc, IID_PPV_ARGS(&objects.pipelines[i]))))
+            {
+                return false;
+            }
+        }
+
+        D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+        heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+        heapDesc.NumDescriptors = DescriptorCount;
+        heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+        if (FAILED(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&objects.heap))))
+        {
+            return false;
+        }
+        objects.descriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+        CD3DX12_HEAP_PROPERTIES uploadHeap(D3D12_HEAP_TYPE_UPLOAD);
+        CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(BufferSize);
+        return SUCCEEDED(device->CreateCommittedResource(&uploadHeap, D3D12_HEAP_FLAG_NONE, &bufferDesc,
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&objects.buffer)));
+    }
+
+    /// Graba un dibujo con la secuencia de estado completa, como si cada objeto la fijara por su cuenta.
+    void Draw(CommandContext& context, const Objects& objects, uint32_t draw, uint32_t pipeline, D3D12_PRIMITIVE_TOPOLOGY topology)
+    {
+        context.SetGraphicsRootSignature(objects.rootSignature.Get());
+        ID3D12DescriptorHeap* heaps[] = { objects.heap.Get() };
+        context.SetDescriptorHeaps(_countof(heaps), heaps);
+        context.SetPipelineState(objects.pipelines[pipeline].Get());
+
+        // La tabla 0 cambia en cada dibujo; la 1 es la misma para todos.
+        D3D12_GPU_DESCRIPTOR_HANDLE heapStart = objects.heap->GetGPUDescriptorHandleForHeapStart();
+        context.SetGraphicsRootDescriptorTable(0, CD3DX12_GPU_DESCRIPTOR_HANDLE(heapStart, draw % (DescriptorCount - 1), objects.descriptorSize));
+        context.SetGraphicsRootDescriptorTable(1, CD3DX12_GPU_DESCRIPTOR_HANDLE(heapStart, DescriptorCount - 1, objects.descriptorSize));
+
+        context.IASetPrimitiveTopology(topology);
+        D3D12_GPU_VIRTUAL_ADDRESS address = objects.buffer->GetGPUVirtualAddress();
+        D3D12_VERTEX_BUFFER_VIEW vertexBuffer = { address, 24 * 12, 12 };
+        D3D12_INDEX_BUFFER_VIEW indexBuffer = { address + BufferSize / 2, IndexCount * sizeof(uint16_t), DXGI_FORMAT_R16_UINT };
+        context.IASetVertexBuffers(0, 1, &vertexBuffer);
+        context.IASetIndexBuffer(&indexBuffer);
+        context.DrawIndexedInstanced(IndexCount, 1, 0, 0, 0);
+    }
+
+    /// Qué cambia de un dibujo a otro en un fotograma de prueba.
+    enum class Pattern {
+        Shared,         ///< Mismo PSO y topología en todos
+        Topologies,     ///< TRIANGLELIST y TRIANGLESTRIP alternados
+        Pipelines,      ///< Los dos PSO alternados
+        Invalidate,     ///< Como Shared, con InvalidateState a mitad
+    };
+
+    /// Graba un fotograma sobre una lista recién abierta y devuelve sus contadores.
+    RenderCounters Record(Objects& objects, CommandContext& context, Pattern pattern, bool filtering, uint32_t draws)
+    {
+        objects.allocator->Reset();
+        objects.commandList->Reset(objects.allocator.Get(), nullptr);
+        context.Reset(objects.commandList.Get());
+        context.SetStateFiltering(filtering);
+
+        for (uint32_t draw = 0; draw < draws; draw++)
+        {
+            if (pattern == Pattern::Invalidate && draw == draws / 2)
+            {
+                context.InvalidateState();
+            }
+            uint32_t pipeline = pattern == Pattern::Pipelines ? draw % 2 : 0;
+            D3D12_PRIMITIVE_TOPOLOGY topology = pattern == Pattern::Topologies && draw % 2 ? D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP : D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+            Draw(context, objects, draw, pipeline, topology);
+        }
+
+        objects.commandList->Close();
+        RenderStats::EndFrame();
+        return RenderStats::LastFrame().total;
+    }
+
+    struct Expected {
+        RenderCounter counter;
+        uint64_t      value;
+    };
+
+    /// Compara los contadores indicados y escribe en la salida de error los que no cuadran.
+    bool Matches(const char* name, const RenderCounters& counters, std::initializer_list<Expected> expected)
+    {
+        bool matches = true;
+        for (const Expected& entry : expected)
+        {
+            if (counters[entry.counter] != entry.value)
+            {
+                std::cerr << name << ": " << RenderStats::CounterName(entry.counter) << " = " << counters[entry.counter]
+                          << ", se esperaba " << entry.value << '\n';
+                matches = false;
+            }
+        }
+        return matches;
+    }
+
+    void WriteRow(const char* name, const RenderCounters& counters)
+    {
+        std::cout << name;
+        for (uint64_t value : counters.values)
+        {
+            std::cout << ',' << value;
+        }
+        std::cout << '\n';
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t draws = 100;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--draws") == 0 && i + 1 < argc)
+        {
+            draws = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            return Usage();
+        }
+    }
+    if (draws < 2 || draws % 2)
+    {
+        return Usage();
+    }
+
+    Objects objects;
+    if (!Create(objects))
+    {
+        std::cerr << "No se pudieron crear los objetos de Direct3D 12\n";
+        return 1;
+    }
+    objects.commandList->Close();
+
+    CommandContext context;
+    const uint64_t n = draws;
+    bool passed = true;
+
+    RenderCounters filtered = Record(objects, context, Pattern::Shared, true, draws);
+    passed &= Report("filtered", Matches("filtered", filtered, {
+        { RenderCounter::DrawCalls, n },
+        { RenderCounter::Primitives, n * IndexCount / 3 },
+        { RenderCounter::RootSignatureChanges, 1 },
+        { RenderCounter::SkippedRootSignatureChanges, n - 1 },
+        { RenderCounter::DescriptorHeapChanges, 1 },
+        { RenderCounter::SkippedDescriptorHeapChanges, n - 1 },
+        { RenderCounter::PipelineChanges, 1 },
+        { RenderCounter::SkippedPipelineChanges, n - 1 },
+        { RenderCounter::RootParameterWrites, n + 1 },
+        { RenderCounter::SkippedRootParameterWrites, n - 1 },
+        { RenderCounter::TopologyChanges, 1 },
+        { RenderCounter::SkippedTopologyChanges, n - 1 },
+        { RenderCounter::VertexBufferBinds, 1 },
+        { RenderCounter::SkippedVertexBufferBinds, n - 1 },
+        { RenderCounter::IndexBufferBinds, 1 },
+        { RenderCounter::SkippedIndexBufferBinds, n - 1 },
+    }));
+
+    RenderCounters unfiltered = Record(objects, context, Pattern::Shared, false, draws);
+    passed &= Report("unfiltered", Matches("unfiltered", unfiltered, {
+        { RenderCounter::DrawCalls, n },
+        { RenderCounter::RootSignatureChanges, n },
+        { RenderCounter::DescriptorHeapChanges, n },
+        { RenderCounter::PipelineChanges, n },
+        { RenderCounter::RootParameterWrites, 2 * n },
+        { RenderCounter::TopologyChanges, n },
+        { RenderCounter::VertexBufferBinds, n },
+        { RenderCounter::IndexBufferBinds, n },
+        { RenderCounter::SkippedRootSignatureChanges, 0 },
+        { RenderCounter::SkippedDescriptorHeapChanges, 0 },
+        { RenderCounter::SkippedPipelineChanges, 0 },
+        { RenderCounter::SkippedRootParameterWrites, 0 },
+        { RenderCounter::SkippedTopologyChanges, 0 },
+        { RenderCounter::SkippedVertexBufferBinds, 0 },
+        { RenderCounter::SkippedIndexBufferBinds, 0 },
+    }));
+
+    RenderCounters topologies = Record(objects, context, Pattern::Topologies, true, draws);
+    passed &= Report("topology", Matches("topology", topologies, {
+        { RenderCounter::TopologyChanges, n },
+        { RenderCounter::SkippedTopologyChanges, 0 },
+        { RenderCounter::Primitives, n / 2 * (IndexCount / 3) + n / 2 * (IndexCount - 2) },
+        { RenderCounter::PipelineChanges, 1 },
+        { RenderCounter::SkippedPipelineChanges, n - 1 },
+    }));
+
+    RenderCounters pipelines = Record(objects, context, Pattern::Pipelines, true, draws);
+    passed &= Report("pipelines", Matches("pipelines", pipelines, {
+        { RenderCounter::PipelineChanges, n },
+        { RenderCounter::SkippedPipelineChanges, 0 },
+        { RenderCounter::TopologyChanges, 1 },
+        { RenderCounter::SkippedTopologyChanges, n - 1 },
+        { RenderCounter::RootSignatureChanges, 1 },
+    }));
+
+    RenderCounters invalidated = Record(objects, context, Pattern::Invalidate, true, draws);
+    passed &= Report("invalidate", Matches("invalidate", invalidated, {
+        { RenderCounter::RootSignatureChanges, 2 },
+        { RenderCounter::SkippedRootSignatureChanges, n - 2 },
+        { RenderCounter::DescriptorHeapChanges, 2 },
+        { RenderCounter::PipelineChanges, 2 },
+        { RenderCounter::SkippedPipelineChanges, n - 2 },
+        { RenderCounter::RootParameterWrites, n + 2 },
+        { RenderCounter::SkippedRootParameterWrites, n - 2 },
+        { RenderCounter::TopologyChanges, 2 },
+        { RenderCounter::SkippedTopologyChanges, n - 2 },
+        { RenderCounter::VertexBufferBinds, 2 },
+        { RenderCounter::IndexBufferBinds, 2 },
+    }));
+
+    // El fotograma anterior acabó con el mismo estado que usa el primero: si Reset no lo
+    // olvidara, el primer dibujo se descartaría entero.
+    RenderCounters repeated = Record(objects, context, Pattern::Shared, true, draws);
+    passed &= Report("reset", memcmp(repeated.values, filtered.values, sizeof(filtered.values)) == 0);
+
+    std::cout << "frame";
+    for (size_t i = 0; i < static_cast<size_t>(RenderCounter::Count); i++)
+    {
+        std::cout << ',' << RenderStats::CounterName(static_cast<RenderCounter>(i));
+    }
+    std::cout << '\n';
+    WriteRow("filtered", filtered);
+    WriteRow("unfiltered", unfiltered);
+    WriteRow("topology", topologies);
+    WriteRow("pipelines", pipelines);
+    WriteRow("invalidate", invalidated);
+    WriteRow("reset", repeated);
+
+    return passed ? 0 : 1;
+}
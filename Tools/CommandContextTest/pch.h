@@ -0,0 +1,18 @@
+﻿/**
+ * @file pch.h
+ * @brief Cabecera precompilada mínima para compilar fuentes del motor fuera del proyecto UWP.
+ */
+
+#pragma once
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <wrl/client.h>
+#include <d3d12.h>
+#include "d3dx12.h"
+#endif
+
+#include <cstdint>
+#include <memory>
+#include <vector>
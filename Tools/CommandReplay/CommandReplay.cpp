@@ -0,0 +1,371 @@
+﻿/**
+ * @file CommandReplay.cpp
+ * @brief Herramienta de línea de comandos que reproduce una captura de Mythforge (.mfcs).
+ *
+ * Uso: CommandReplay captura.mfcs [--backend null|software|d3d12] [--repeat N]
+ *                      [--size AnchoxAlto] [--output imagen.ppm] [--benchmark]
+ *                      [--pipeline [--game-us N]]
+ *
+ * Reproduce la captura N veces sobre el backend elegido y escribe en la salida estándar el número
+ * de llamadas y el tiempo de CPU de cada tipo de comando, en CSV. El backend null solo mide el
+ * recorrido de la captura; software la rasteriza en CPU (SoftwareRasterizer), con --size cambia
+ * la resolución de los destinos y con --output guarda el último fotograma presentado, que sirve
+ * como imagen de referencia. --benchmark rasteriza la captura a 1080p y a 4K y escribe el
+ * rendimiento en lugar de la tabla de comandos.
+ *
+ * --pipeline mide el reparto entre hilo de juego y de render del motor (RenderThread): cada
+ * fotograma de la captura es un paquete que el hilo principal prepara, separando sus comandos y
+ * gastando --game-us microsegundos de CPU que representan la actualización y el recorte de una
+ * escena, y que el backend graba. Se ejecuta en serie en un solo hilo y después con RenderThread
+ * y dos paquetes, y se escribe el ritmo de fotogramas de cada modo. Con el backend null todo el
+ * tiempo es de CPU.
+ *
+ * Los backends null y software compilan en cualquier plataforma:
+ *
+ *     g++ -std=c++17 -O2 -I Tools/CommandReplay -I Mythforge/Source Tools/CommandReplay/CommandReplay.cpp
+ *         Mythforge/Source/CommandStream.cpp Mythforge/Source/SoftwareRasterizer.cpp
+ *         Mythforge/Source/JobSystem.cpp Mythforge/Source/AllocationTracker.cpp
+ *         Mythforge/Source/Profiler.cpp Mythforge/Source/RenderThread.cpp
+ *         Mythforge/Source/ConcurrentQueues.cpp -pthread
+ *
+ * En Windows se añade Mythforge/Source/D3D12CommandSink.cpp y se enlaza con d3d12.lib para tener
+ * también el backend d3d12, que crea un dispositivo sobre el adaptador por defecto.
+ */
+
+#include "pch.h"
+#include "CommandStream.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "RenderThread.h"
+#include "SoftwareRasterizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#if defined(_WIN32)
+#include "D3D12CommandSink.h"
+#pragma comment(lib, "d3d12.lib")
+#endif
+
+namespace
+{
+    int Usage()
+    {
+        std::cerr << "Uso: CommandReplay captura.mfcs [--backend null|software|d3d12] [--repeat N] [--size AnchoxAlto] [--output imagen.ppm] [--benchmark] [--pipeline [--game-us N]]\n";
+        return 2;
+    }
+
+    /// PPM binario (P6): sin dependencias y legible por cualquier herramienta de comparación de imágenes.
+    bool WritePpm(const char* path, const std::vector<uint8_t>& rgba, uint32_t width, uint32_t height)
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "P6\n" << width << ' ' << height << "\n255\n";
+        for (size_t i = 0; i < rgba.size(); i += 4)
+        {
+            file.write(reinterpret_cast<const char*>(&rgba[i]), 3);
+        }
+        return static_cast<bool>(file);
+    }
+
+    bool Replay(CommandStreamReader& reader, CommandSink& sink, uint32_t repeat, CommandReplayStats& stats)
+    {
+        for (uint32_t i = 0; i < repeat; i++)
+        {
+            reader.Rewind();
+            if (!ReplayCommandStream(reader, sink, &stats))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Paquete de fotograma de --pipeline: los comandos de un fotograma de la captura.
+    struct ReplayPacket {
+        std::vector<CommandPacket> commands;
+    };
+
+    /**
+     * @struct PipelineRun
+     * @brief Resultado de una pasada de --pipeline.
+     */
+    struct PipelineRun {
+        uint64_t          frames = 0;
+        double            seconds = 0.0;
+        bool              complete = true;
+        RenderThreadStats thread;
+    };
+
+    /// Trabajo del hilo de juego: los comandos hasta el siguiente EndFrame y gameMicroseconds de CPU. false al acabar la captura.
+    bool PrepareFrame(CommandStreamReader& reader, uint32_t gameMicroseconds, ReplayPacket& packet)
+    {
+        packet.commands.clear();
+        CommandPacket command;
+        while (reader.Next(command))
+        {
+            packet.commands.push_back(command);
+            if (command.op == CommandOp::EndFrame) break;
+        }
+
+        auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(gameMicroseconds);
+        while (std::chrono::steady_clock::now() < end)
+        {
+        }
+        return !packet.commands.empty();
+    }
+
+    bool RenderFrame(const ReplayPacket& packet, CommandSink& sink)
+    {
+        for (const CommandPacket& command : packet.commands)
+        {
+            if (!DispatchCommandPacket(command, sink))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Con pipelined, el backend graba en un RenderThread con dos paquetes mientras el hilo principal prepara el siguiente.
+    PipelineRun RunPipeline(CommandStreamReader& reader, CommandSink& sink, uint32_t repeat, uint32_t gameMicroseconds, bool pipelined)
+    {
+        PipelineRun run;
+        ReplayPacket packets[2];
+        std::unique_ptr<RenderThread> renderThread;
+        if (pipelined)
+        {
+            // Solo el hilo de render escribe complete, y se lee después de Stop.
+            renderThread = std::make_unique<RenderThread>(static_cast<uint32_t>(std::size(packets)), [&](uint32_t packet) {
+                run.complete = RenderFrame(packets[packet], sink) && run.complete;
+            });
+        }
+
+        // Al acabar cada repetición sobra un paquete tomado y vacío; se usa en la siguiente.
+        uint32_t spare = UINT32_MAX;
+        uint64_t start = Profiler::Now();
+        for (uint32_t i = 0; i < repeat; i++)
+        {
+            reader.Rewind();
+            for (;;)
+            {
+                uint32_t packet = spare != UINT32_MAX ? spare : renderThread ? renderThread->Acquire() : 0;
+                spare = UINT32_MAX;
+                if (!PrepareFrame(reader, gameMicroseconds, packets[packet]))
+                {
+                    spare = packet;
+                    break;
+                }
+                run.frames++;
+                if (renderThread)
+                {
+                    renderThread->Submit(packet);
+                }
+                else
+                {
+                    run.complete = RenderFrame(packets[packet], sink) && run.complete;
+                }
+            }
+            run.complete = run.complete && reader.AtEnd();
+        }
+        if (renderThread)
+        {
+            renderThread->Stop();
+            run.thread = renderThread->Stats();
+        }
+        run.seconds = Profiler::TicksToMicroseconds(Profiler::Now() - start) * 1e-6;
+        return run;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = nullptr;
+    std::string backend = "null";
+    uint32_t repeat = 1;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    const char* output = nullptr;
+    bool benchmark = false;
+    bool pipeline = false;
+    uint32_t gameMicroseconds = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc)
+        {
+            backend = argv[++i];
+        }
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+        {
+            repeat = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+        {
+            if (sscanf(argv[++i], "%ux%u", &width, &height) != 2) return Usage();
+        }
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+        {
+            output = argv[++i];
+        }
+        else if (strcmp(argv[i], "--benchmark") == 0)
+        {
+            benchmark = true;
+        }
+        else if (strcmp(argv[i], "--pipeline") == 0)
+        {
+            pipeline = true;
+        }
+        else if (strcmp(argv[i], "--game-us") == 0 && i + 1 < argc)
+        {
+            gameMicroseconds = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (!path && argv[i][0] != '-')
+        {
+            path = argv[i];
+        }
+        else
+        {
+            return Usage();
+        }
+    }
+    if (!path || repeat == 0)
+    {
+        return Usage();
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    CommandStreamReader reader;
+    if (!file || !reader.Load(file))
+    {
+        std::cerr << path << ": no es una captura válida\n";
+        return 1;
+    }
+
+    if (benchmark)
+    {
+        // Cada resolución reproduce la captura repeat veces con todos los hilos disponibles.
+        JobSystem jobs;
+        const uint32_t sizes[][2] = { { 1920, 1080 }, { 3840, 2160 } };
+        std::cout << "resolution,frames,msPerFrame,outputMpixPerSec,shadedMpixPerSec,trianglesPerSec\n";
+        for (const auto& size : sizes)
+        {
+            SoftwareRasterizer sink(&jobs);
+            sink.SetOutputSize(size[0], size[1]);
+            CommandReplayStats ignored;
+            uint64_t start = Profiler::Now();
+            if (!Replay(reader, sink, repeat, ignored))
+            {
+                std::cerr << path << ": captura truncada o con paquetes desconocidos\n";
+                return 1;
+            }
+            double seconds = Profiler::TicksToMicroseconds(Profiler::Now() - start) * 1e-6;
+            const SoftwareRasterizerStats& rasterizer = sink.Stats();
+            uint64_t frames = (std::max)(rasterizer.frames, uint64_t(1));
+            std::cout << size[0] << 'x' << size[1] << ',' << rasterizer.frames << ',' << seconds * 1000.0 / frames << ','
+                      << static_cast<double>(size[0]) * size[1] * frames * 1e-6 / seconds << ','
+                      << rasterizer.MegapixelsPerSecond() << ',' << rasterizer.TrianglesPerSecond() << '\n';
+        }
+        return 0;
+    }
+
+    if (pipeline)
+    {
+        // Los objetos se definen de nuevo en cada repetición; el backend d3d12 tendría que recrearse entre ellas.
+        JobSystem jobs;
+        std::unique_ptr<CommandSink> sink;
+        if (backend == "null")
+        {
+            sink = std::make_unique<NullCommandSink>();
+        }
+        else if (backend == "software")
+        {
+            auto rasterizer = std::make_unique<SoftwareRasterizer>(&jobs);
+            rasterizer->SetOutputSize(width, height);
+            sink = std::move(rasterizer);
+        }
+        else
+        {
+            std::cerr << "--pipeline solo admite los backends null y software\n";
+            return 2;
+        }
+
+        std::cout << "mode,frames,msPerFrame,framesPerSec,gameWaitMs,renderIdleMs\n";
+        for (bool pipelined : { false, true })
+        {
+            PipelineRun run = RunPipeline(reader, *sink, repeat, gameMicroseconds, pipelined);
+            if (!run.complete)
+            {
+                std::cerr << path << ": captura truncada o con paquetes desconocidos\n";
+                return 1;
+            }
+            uint64_t frames = (std::max)(run.frames, uint64_t(1));
+            std::cout << (pipelined ? "pipelined" : "serial") << ',' << run.frames << ',' << run.seconds * 1000.0 / frames << ','
+                      << run.frames / run.seconds << ',' << run.thread.gameWait * 1e-3 << ',' << run.thread.renderIdle * 1e-3 << '\n';
+        }
+        return 0;
+    }
+
+    CommandReplayStats stats;
+    bool complete = false;
+    if (backend == "null")
+    {
+        NullCommandSink sink;
+        complete = Replay(reader, sink, repeat, stats);
+    }
+    else if (backend == "software")
+    {
+        JobSystem jobs;
+        SoftwareRasterizer sink(&jobs);
+        sink.SetOutputSize(width, height);
+        complete = Replay(reader, sink, repeat, stats);
+
+        std::vector<uint8_t> pixels;
+        uint32_t imageWidth = 0;
+        uint32_t imageHeight = 0;
+        if (output && (!sink.ReadRenderTarget(pixels, imageWidth, imageHeight) || !WritePpm(output, pixels, imageWidth, imageHeight)))
+        {
+            std::cerr << output << ": no se pudo escribir la imagen\n";
+            complete = false;
+        }
+    }
+#if defined(_WIN32)
+    else if (backend == "d3d12")
+    {
+        Microsoft::WRL::ComPtr<ID3D12Device> device;
+        if (FAILED(D3D12CreateDevice(nullptr, D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&device))))
+        {
+            std::cerr << "No se pudo crear el dispositivo Direct3D 12\n";
+            return 1;
+        }
+
+        // Cada repetición recrea los objetos, así que cada una usa su propio backend.
+        for (uint32_t i = 0; i < repeat && (i == 0 || complete); i++)
+        {
+            D3D12CommandSink sink(device.Get());
+            complete = Replay(reader, sink, 1, stats);
+            if (FAILED(sink.Status()))
+            {
+                std::cerr << "Error de Direct3D 12 durante la reproducción: 0x" << std::hex << static_cast<uint32_t>(sink.Status()) << std::dec << '\n';
+                complete = false;
+            }
+        }
+    }
+#endif
+    else
+    {
+        return Usage();
+    }
+
+    stats.Write(std::cout);
+    if (!complete)
+    {
+        std::cerr << path << ": captura truncada o con paquetes desconocidos\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,396 @@
+﻿/**
+ * @file CommandStreamTest.cpp
+ * @brief Prueba de ida y vuelta del formato de captura de CommandStream.h.
+ *
+ * Uso: CommandStreamTest [--frames N] [--seed N]
+ *
+ * Escribe N fotogramas (por defecto 200) con todas las operaciones del formato, con contenido y
+ * tamaños al azar en las estructuras y en los datos que las siguen, y los reproduce sobre un
+ * backend que anota cada llamada con una huella de sus bytes. Se comprueba:
+ *
+ * - roundtrip: el backend recibe las mismas llamadas, en el mismo orden y con los mismos bytes
+ *   que se escribieron, y las estadísticas cuentan cada operación y cada fotograma.
+ * - rewind: tras Rewind, una segunda reproducción entrega lo mismo.
+ * - header: Load rechaza un fichero con otra firma, otra versión o sin cabecera completa.
+ * - truncated: cortada en cualquier byte, la captura o no carga o se reproduce hasta el último
+ *   paquete completo y devuelve false.
+ * - corrupt: un paquete con operación desconocida, o cuyos datos dicen ser más largos que el
+ *   paquete, detiene la reproducción con false sin entregarlo.
+ *
+ * Devuelve 1 si algo falla. Compila en cualquier plataforma:
+ *
+ *     g++ -std=c++17 -O2 -I Tools/CommandStreamTest -I Mythforge/Source Tools/CommandStreamTest/CommandStreamTest.cpp
+ *         Mythforge/Source/CommandStream.cpp Mythforge/Source/Profiler.cpp
+ */
+
+#include "pch.h"
+#include "CommandStream.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace
+{
+    constexpr size_t FileHeaderSize = 8;    ///< Firma y versión
+    constexpr size_t PacketHeaderSize = 8;  ///< Operación, reservado y tamaño
+
+    /// Una llamada recibida o esperada: operación y huella FNV-1a de todos sus bytes.
+    struct Call {
+        CommandOp op;
+        uint64_t  hash;
+
+        bool operator==(const Call& other) const { return op == other.op && hash == other.hash; }
+    };
+
+    uint64_t Hash(uint64_t hash, const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    constexpr uint64_t HashSeed = 14695981039346656037ull;
+
+    /**
+     * @class RecordingSink
+     * @brief Backend que anota cada llamada con la huella de la estructura y de los datos que la siguen.
+     */
+    class RecordingSink : public CommandSink {
+    public:
+        std::vector<Call> calls;
+
+        void BeginFrame(const FrameCommand& command) override { Record(CommandOp::BeginFrame, command); }
+        void EndFrame() override { calls.push_back(Call{ CommandOp::EndFrame, HashSeed }); }
+        void DefineResource(const CapturedResource& resource, const void* initialData) override
+        {
+            Record(CommandOp::DefineResource, resource, initialData, resource.initialDataSize);
+        }
+        void DefineRootSignature(const CapturedRootSignature& rootSignature, const void* blob) override
+        {
+            Record(CommandOp::DefineRootSignature, rootSignature, blob, rootSignature.blobSize);
+        }
+        void DefinePipeline(const CapturedPipeline& pipeline, const CapturedInputElement* inputElements, const void* vertexShader, const void* pixelShader) override
+        {
+            uint64_t hash = Hash(HashSeed, &pipeline, sizeof(pipeline));
+            hash = Hash(hash, inputElements, sizeof(CapturedInputElement) * pipeline.inputElementCount);
+            hash = Hash(hash, vertexShader, pipeline.vertexShaderSize);
+            calls.push_back(Call{ CommandOp::DefinePipeline, Hash(hash, pixelShader, pipeline.pixelShaderSize) });
+        }
+        void DefineDescriptorHeap(const CapturedDescriptorHeap& heap) override { Record(CommandOp::DefineDescriptorHeap, heap); }
+        void DefineView(const CapturedView& view) override { Record(CommandOp::DefineView, view); }
+        void ReleaseObject(const ObjectCommand& command) override { Record(CommandOp::ReleaseObject, command); }
+        void WriteBuffer(const BufferWriteCommand& command, const void* data) override { Record(CommandOp::WriteBuffer, command, data, command.size); }
+        void SetRootSignature(const ObjectCommand& command) override { Record(CommandOp::SetRootSignature, command); }
+        void SetDescriptorHeaps(const SetDescriptorHeapsCommand& command) override { Record(CommandOp::SetDescriptorHeaps, command); }
+        void SetPipeline(const ObjectCommand& command) override { Record(CommandOp::SetPipeline, command); }
+        void SetRootTable(const SetRootTableCommand& command) override { Record(CommandOp::SetRootTable, command); }
+        void SetTopology(const SetTopologyCommand& command) override { Record(CommandOp::SetTopology, command); }
+        void SetVertexBuffer(const SetVertexBufferCommand& command) override { Record(CommandOp::SetVertexBuffer, command); }
+        void SetIndexBuffer(const SetIndexBufferCommand& command) override { Record(CommandOp::SetIndexBuffer, command); }
+        void SetViewport(const ViewportCommand& command) override { Record(CommandOp::SetViewport, command); }
+        void SetScissor(const ScissorCommand& command) override { Record(CommandOp::SetScissor, command); }
+        void SetRenderTargets(const SetRenderTargetsCommand& command) override { Record(CommandOp::SetRenderTargets, command); }
+        void ClearRenderTarget(const ClearRenderTargetCommand& command) override { Record(CommandOp::ClearRenderTarget, command); }
+        void ClearDepth(const ClearDepthCommand& command) override { Record(CommandOp::ClearDepth, command); }
+        void Barrier(const BarrierCommand& command) override { Record(CommandOp::Barrier, command); }
+        void DrawIndexed(const DrawIndexedCommand& command) override { Record(CommandOp::DrawIndexed, command); }
+        void Present() override { calls.push_back(Call{ CommandOp::Present, HashSeed }); }
+
+    private:
+        template<typename T>
+        void Record(CommandOp op, const T& command, const void* extra = nullptr, size_t extraSize = 0)
+        {
+            calls.push_back(Call{ op, Hash(Hash(HashSeed, &command, sizeof(T)), extra, extraSize) });
+        }
+    };
+
+    /**
+     * @class ScriptWriter
+     * @brief Escribe paquetes y anota, para cada uno, la llamada que el backend debe recibir y dónde empieza.
+     */
+    class ScriptWriter {
+    public:
+        CommandStreamWriter writer;
+        std::vector<Call>   expected;
+        std::vector<size_t> offsets;    ///< Posición de cada paquete en el fichero guardado
+        uint32_t            frames = 0;
+
+        template<typename T>
+        void Write(CommandOp op, const T& command, const std::vector<uint8_t>& extra = std::vector<uint8_t>())
+        {
+            offsets.push_back(FileHeaderSize + writer.Size());
+            writer.Write(op, command, extra.data(), static_cast<uint32_t>(extra.size()));
+            expected.push_back(Call{ op, Hash(Hash(HashSeed, &command, sizeof(T)), extra.data(), extra.size()) });
+        }
+
+        void WriteEmpty(CommandOp op)
+        {
+            offsets.push_back(FileHeaderSize + writer.Size());
+            writer.Write(op, nullptr, 0);
+            expected.push_back(Call{ op, HashSeed });
+        }
+
+        std::string Save() const
+        {
+            std::ostringstream stream;
+            writer.Save(stream);
+            return stream.str();
+        }
+    };
+
+    /// Rellena los bytes de una estructura al azar; los campos de tamaño se fijan después.
+    template<typename T>
+    T RandomCommand(std::mt19937& rng)
+    {
+        T command;
+        uint8_t* bytes = reinterpret_cast<uint8_t*>(&command);
+        for (size_t i = 0; i < sizeof(T); i++)
+        {
+            bytes[i] = static_cast<uint8_t>(rng());
+        }
+        return command;
+    }
+
+    std::vector<uint8_t> RandomBytes(std::mt19937& rng, size_t size)
+    {
+        std::vector<uint8_t> bytes(size);
+        for (uint8_t& byte : bytes)
+        {
+            byte = static_cast<uint8_t>(rng());
+        }
+        return bytes;
+    }
+
+    /// Un fotograma con todas las operaciones; las definiciones llevan datos de tamaño al azar.
+    void WriteFrame(ScriptWriter& script, std::mt19937& rng)
+    {
+        std::uniform_int_distribution<uint32_t> small(0, 300);
+
+        script.Write(CommandOp::BeginFrame, FrameCommand{ script.frames });
+
+        CapturedResource resource = RandomCommand<CapturedResource>(rng);
+        resource.initialDataSize = small(rng);
+        script.Write(CommandOp::DefineResource, resource, RandomBytes(rng, resource.initialDataSize));
+
+        CapturedRootSignature rootSignature = RandomCommand<CapturedRootSignature>(rng);
+        rootSignature.blobSize = small(rng);
+        script.Write(CommandOp::DefineRootSignature, rootSignature, RandomBytes(rng, rootSignature.blobSize));
+
+        CapturedPipeline pipeline = RandomCommand<CapturedPipeline>(rng);
+        pipeline.inputElementCount = small(rng) % 5;
+        pipeline.vertexShaderSize = small(rng);
+        pipeline.pixelShaderSize = small(rng);
+        size_t pipelineExtra = sizeof(CapturedInputElement) * pipeline.inputElementCount + pipeline.vertexShaderSize + pipeline.pixelShaderSize;
+        script.Write(CommandOp::DefinePipeline, pipeline, RandomBytes(rng, pipelineExtra));
+
+        script.Write(CommandOp::DefineDescriptorHeap, RandomCommand<CapturedDescriptorHeap>(rng));
+        script.Write(CommandOp::DefineView, RandomCommand<CapturedView>(rng));
+
+        BufferWriteCommand write = RandomCommand<BufferWriteCommand>(rng);
+        write.size = small(rng);
+        script.Write(CommandOp::WriteBuffer, write, RandomBytes(rng, write.size));
+
+        script.Write(CommandOp::Barrier, RandomCommand<BarrierCommand>(rng));
+        script.Write(CommandOp::SetRenderTargets, RandomCommand<SetRenderTargetsCommand>(rng));
+        script.Write(CommandOp::ClearRenderTarget, RandomCommand<ClearRenderTargetCommand>(rng));
+        script.Write(CommandOp::ClearDepth, RandomCommand<ClearDepthCommand>(rng));
+        script.Write(CommandOp::SetViewport, RandomCommand<ViewportCommand>(rng));
+        script.Write(CommandOp::SetScissor, RandomCommand<ScissorCommand>(rng));
+        uint32_t draws = 1 + small(rng) % 8;
+        for (uint32_t i = 0; i < draws; i++)
+        {
+            script.Write(CommandOp::SetRootSignature, RandomCommand<ObjectCommand>(rng));
+            script.Write(CommandOp::SetDescriptorHeaps, RandomCommand<SetDescriptorHeapsCommand>(rng));
+            script.Write(CommandOp::SetPipeline, RandomCommand<ObjectCommand>(rng));
+            script.Write(CommandOp::SetRootTable, RandomCommand<SetRootTableCommand>(rng));
+            script.Write(CommandOp::SetTopology, RandomCommand<SetTopologyCommand>(rng));
+            script.Write(CommandOp::SetVertexBuffer, RandomCommand<SetVertexBufferCommand>(rng));
+            script.Write(CommandOp::SetIndexBuffer, RandomCommand<SetIndexBufferCommand>(rng));
+            script.Write(CommandOp::DrawIndexed, RandomCommand<DrawIndexedCommand>(rng));
+        }
+        script.Write(CommandOp::ReleaseObject, RandomCommand<ObjectCommand>(rng));
+        script.WriteEmpty(CommandOp::Present);
+        script.WriteEmpty(CommandOp::EndFrame);
+        script.frames++;
+    }
+
+    /// Carga bytes como fichero de captura; false si Load los rechaza.
+    bool Load(const std::string& bytes, CommandStreamReader& reader)
+    {
+        std::istringstream stream(bytes);
+        return reader.Load(stream);
+    }
+
+    bool IsPrefix(const std::vector<Call>& calls, const std::vector<Call>& expected, size_t length)
+    {
+        if (calls.size() != length || length > expected.size()) return false;
+        for (size_t i = 0; i < length; i++)
+        {
+            if (!(calls[i] == expected[i])) return false;
+        }
+        return true;
+    }
+
+    bool TestRoundTrip(const ScriptWriter& script, bool& rewindPassed)
+    {
+        CommandStreamReader reader;
+        if (!Load(script.Save(), reader)) return false;
+
+        RecordingSink sink;
+        CommandReplayStats stats;
+        bool passed = ReplayCommandStream(reader, sink, &stats) && reader.AtEnd() && sink.calls == script.expected &&
+                      stats.frames == script.frames;
+
+        uint64_t expectedCalls[static_cast<size_t>(CommandOp::Count)] = {};
+        for (const Call& call : script.expected)
+        {
+            expectedCalls[static_cast<size_t>(call.op)]++;
+        }
+        passed = passed && memcmp(expectedCalls, stats.calls, sizeof(expectedCalls)) == 0;
+
+        reader.Rewind();
+        RecordingSink again;
+        rewindPassed = ReplayCommandStream(reader, again, nullptr) && again.calls == script.expected;
+        return passed;
+    }
+
+    bool TestHeader(const std::string& bytes)
+    {
+        CommandStreamReader reader;
+        std::string magic = bytes;
+        magic[0] = 'X';
+        std::string version = bytes;
+        version[4]++;
+        return !Load(magic, reader) && !Load(version, reader) && !Load(bytes.substr(0, FileHeaderSize - 1), reader) &&
+               Load(bytes.substr(0, FileHeaderSize), reader);
+    }
+
+    bool TestTruncated(const ScriptWriter& script)
+    {
+        std::string bytes = script.Save();
+        for (size_t length = 0; length < bytes.size(); length++)
+        {
+            CommandStreamReader reader;
+            if (!Load(bytes.substr(0, length), reader))
+            {
+                if (length >= FileHeaderSize) return false;
+                continue;
+            }
+
+            // Solo se entregan los paquetes que caben enteros, relleno incluido.
+            size_t complete = 0;
+            while (complete < script.offsets.size() &&
+                   (complete + 1 < script.offsets.size() ? script.offsets[complete + 1] : bytes.size()) <= length)
+            {
+                complete++;
+            }
+
+            RecordingSink sink;
+            bool replayed = ReplayCommandStream(reader, sink, nullptr);
+            bool atPacketEnd = length == (complete < script.offsets.size() ? script.offsets[complete] : bytes.size());
+            if (replayed != atPacketEnd || !IsPrefix(sink.calls, script.expected, complete)) return false;
+        }
+        return true;
+    }
+
+    bool TestCorrupt(const ScriptWriter& script)
+    {
+        std::string bytes = script.Save();
+        bool passed = true;
+
+        // Operación desconocida en el tercer paquete.
+        std::string unknown = bytes;
+        uint16_t op = static_cast<uint16_t>(CommandOp::Count);
+        memcpy(&unknown[script.offsets[2]], &op, sizeof(op));
+
+        // El WriteBuffer dice traer un byte más de los que lleva el paquete.
+        std::string oversized = bytes;
+        size_t write = 0;
+        while (script.expected[write].op != CommandOp::WriteBuffer) write++;
+        uint32_t writeSize;
+        memcpy(&writeSize, &oversized[script.offsets[write] + PacketHeaderSize + offsetof(BufferWriteCommand, size)], sizeof(writeSize));
+        uint32_t packetSize;
+        memcpy(&packetSize, &oversized[script.offsets[write] + 4], sizeof(packetSize));
+        writeSize = packetSize - static_cast<uint32_t>(sizeof(BufferWriteCommand)) + 1;
+        memcpy(&oversized[script.offsets[write] + PacketHeaderSize + offsetof(BufferWriteCommand, size)], &writeSize, sizeof(writeSize));
+
+        const std::pair<const std::string*, size_t> cases[] = { { &unknown, 2 }, { &oversized, write } };
+        for (const auto& corrupt : cases)
+        {
+            CommandStreamReader reader;
+            RecordingSink sink;
+            passed = Load(*corrupt.first, reader) && !ReplayCommandStream(reader, sink, nullptr) &&
+                     IsPrefix(sink.calls, script.expected, corrupt.second) && passed;
+        }
+        return passed;
+    }
+
+    bool Report(const char* name, bool passed)
+    {
+        std::cout << name << ": " << (passed ? "ok" : "FALLO") << '\n';
+        return passed;
+    }
+
+    int Usage()
+    {
+        std::cerr << "Uso: CommandStreamTest [--frames N] [--seed N]\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t frames = 200;
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            frames = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            return Usage();
+        }
+    }
+    if (frames == 0)
+    {
+        return Usage();
+    }
+
+    std::mt19937 rng(seed);
+    ScriptWriter script;
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        WriteFrame(script, rng);
+    }
+
+    // El corte byte a byte es cuadrático: se hace sobre una captura de tres fotogramas.
+    ScriptWriter small;
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        WriteFrame(small, rng);
+    }
+
+    std::cout << "frames,packets,bytes\n" << frames << ',' << script.writer.PacketCount() << ',' << script.Save().size() << '\n';
+    bool rewind = false;
+    bool passed = Report("roundtrip", TestRoundTrip(script, rewind));
+    passed = Report("rewind", rewind) && passed;
+    passed = Report("header", TestHeader(script.Save())) && passed;
+    passed = Report("truncated", TestTruncated(small)) && passed;
+    passed = Report("corrupt", TestCorrupt(script)) && passed;
+    return passed ? 0 : 1;
+}
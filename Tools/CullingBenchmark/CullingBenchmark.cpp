@@ -0,0 +1,270 @@
+﻿/**
+ * @file CullingBenchmark.cpp
+ * @brief Compara el recorte por frustum escalar, el vectorial por fuerza bruta y el de la jerarquía Bvh4 en una ciudad sintética.
+ *
+ * Uso: CullingBenchmark [--blocks N] [--views N] [--repeat N]
+ *
+ * La ciudad es una cuadrícula de N x N manzanas (por defecto 100 x 100, 200 000 objetos) de 60 m
+ * separadas por calles de 12 m. Cada manzana tiene cuatro edificios de 8 a 150 m de alto y, en la
+ * acera y la calzada, farolas, coches y marquesinas. Las vistas (por defecto 32) son cámaras a la
+ * altura de los ojos en cruces al azar, mirando en cualquier dirección con un plano lejano a
+ * 1500 m, como las de un juego en primera persona.
+ *
+ * Para cada vista se recorta la escena de tres maneras:
+ *
+ * - scalar: cada caja contra los seis planos, de una en una, como se haría sin Culling.h.
+ * - simd: CullAabbs, cuatro cajas a la vez por fuerza bruta.
+ * - bvh: Bvh4::CullFrustum, que descarta o acepta subárboles enteros.
+ *
+ * Se escribe en CSV el mejor tiempo por vista de --repeat repeticiones, los objetos probados y
+ * visibles por vista, los objetos de la escena resueltos por microsegundo y la aceleración
+ * respecto a scalar. Los tres tienen que dar el mismo conjunto visible; devuelve 1 si no.
+ * Necesita DirectXMath, que en Windows viene con el SDK:
+ *
+ *     cl /std:c++17 /O2 /EHsc /I Tools\CullingBenchmark /I Mythforge\Source Tools\CullingBenchmark\CullingBenchmark.cpp
+ *         Mythforge\Source\Culling.cpp Mythforge\Source\Bvh.cpp Mythforge\Source\JobSystem.cpp
+ *         Mythforge\Source\AllocationTracker.cpp Mythforge\Source\Profiler.cpp
+ *
+ * En otras plataformas, con DIRECTXMATH apuntando a un clon de microsoft/DirectXMath y
+ * DIRECTX_HEADERS a uno de microsoft/DirectX-Headers, que trae el sal.h que DirectXMath incluye:
+ *
+ *     g++ -std=c++17 -O2 -isystem "$DIRECTXMATH/Inc" -isystem "$DIRECTX_HEADERS/include/wsl/stubs"
+ *         -I Tools/CullingBenchmark -I Mythforge/Source Tools/CullingBenchmark/CullingBenchmark.cpp
+ *         Mythforge/Source/Culling.cpp Mythforge/Source/Bvh.cpp Mythforge/Source/JobSystem.cpp
+ *         Mythforge/Source/AllocationTracker.cpp Mythforge/Source/Profiler.cpp -pthread
+ */
+
+#include "pch.h"
+#include "Bvh.h"
+#include "Culling.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr float BlockSize = 60.0f;
+    constexpr float StreetWidth = 12.0f;
+    constexpr float EyeHeight = 1.7f;
+    constexpr float FarPlane = 1500.0f;
+
+    /// Añade las manzanas de la ciudad, centrada en el origen.
+    CullingBounds BuildCity(uint32_t blocks)
+    {
+        std::mt19937 random(27);
+        std::uniform_real_distribution<float> height(8.0f, 150.0f);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        CullingBounds bounds;
+        float pitch = BlockSize + StreetWidth;
+        float origin = -0.5f * pitch * blocks;
+        for (uint32_t row = 0; row < blocks; row++)
+        {
+            for (uint32_t column = 0; column < blocks; column++)
+            {
+                float x0 = origin + column * pitch;
+                float z0 = origin + row * pitch;
+
+                // Cuatro edificios por manzana, con un patio entre ellos.
+                for (uint32_t building = 0; building < 4; building++)
+                {
+                    float halfHeight = 0.5f * height(random);
+                    float x = x0 + (building & 1 ? 45.0f : 15.0f);
+                    float z = z0 + (building & 2 ? 45.0f : 15.0f);
+                    bounds.Add(XMFLOAT3(x, halfHeight, z), XMFLOAT3(13.0f, halfHeight, 13.0f));
+                }
+
+                // Farolas en la acera de los dos lados que dan a la calle.
+                for (uint32_t lamp = 0; lamp < 4; lamp++)
+                {
+                    float along = x0 + 7.5f + lamp * 15.0f;
+                    bounds.Add(XMFLOAT3(along, 2.5f, z0 + BlockSize + 1.0f), XMFLOAT3(0.15f, 2.5f, 0.15f));
+                    bounds.Add(XMFLOAT3(x0 + BlockSize + 1.0f, 2.5f, z0 + 7.5f + lamp * 15.0f), XMFLOAT3(0.15f, 2.5f, 0.15f));
+                }
+
+                // Coches aparcados o circulando en las dos calles.
+                for (uint32_t car = 0; car < 3; car++)
+                {
+                    float along = x0 + BlockSize * unit(random);
+                    bounds.Add(XMFLOAT3(along, 0.75f, z0 + BlockSize + 4.0f), XMFLOAT3(2.2f, 0.75f, 1.0f));
+                    bounds.Add(XMFLOAT3(x0 + BlockSize + 8.0f, 0.75f, z0 + BlockSize * unit(random)), XMFLOAT3(1.0f, 0.75f, 2.2f));
+                }
+
+                // Marquesinas y quioscos.
+                bounds.Add(XMFLOAT3(x0 + 30.0f, 1.5f, z0 + BlockSize + 1.5f), XMFLOAT3(2.0f, 1.5f, 0.8f));
+                bounds.Add(XMFLOAT3(x0 + BlockSize + 1.5f, 1.5f, z0 + 30.0f), XMFLOAT3(0.8f, 1.5f, 2.0f));
+            }
+        }
+        return bounds;
+    }
+
+    /// Frustums de cámaras a pie de calle en cruces al azar.
+    std::vector<Frustum> StreetViews(uint32_t blocks, uint32_t count)
+    {
+        std::mt19937 random(127);
+        std::uniform_int_distribution<uint32_t> crossing(0, blocks - 1);
+        std::uniform_real_distribution<float> heading(0.0f, XM_2PI);
+
+        float pitch = BlockSize + StreetWidth;
+        float origin = -0.5f * pitch * blocks;
+        XMMATRIX projection = XMMatrixPerspectiveFovRH(70.0f * XM_PI / 180.0f, 16.0f / 9.0f, 0.1f, FarPlane);
+
+        std::vector<Frustum> views;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            float x = origin + crossing(random) * pitch + BlockSize + 0.5f * StreetWidth;
+            float z = origin + crossing(random) * pitch + BlockSize + 0.5f * StreetWidth;
+            float angle = heading(random);
+            XMVECTOR eye = XMVectorSet(x, EyeHeight, z, 1.0f);
+            XMVECTOR forward = XMVectorSet(std::sin(angle), 0.0f, std::cos(angle), 0.0f);
+            XMMATRIX view = XMMatrixLookToRH(eye, forward, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+            views.push_back(ExtractFrustum(XMMatrixMultiply(view, projection)));
+        }
+        return views;
+    }
+
+    /// Una caja cada vez, con la misma prueba y el mismo orden de operaciones que TestAabbBlock.
+    void CullScalar(const Frustum& frustum, const CullingBounds& bounds, std::vector<uint32_t>& visible)
+    {
+        for (uint32_t i = 0; i < bounds.count; i++)
+        {
+            const AabbBlock& block = bounds.blocks[i >> 2];
+            uint32_t lane = i & 3;
+            bool outside = false;
+            for (const XMFLOAT4& plane : frustum.planes)
+            {
+                float distance = block.centerZ[lane] * plane.z + (block.centerY[lane] * plane.y + (block.centerX[lane] * plane.x + plane.w));
+                float radius = block.extentZ[lane] * std::fabs(plane.z) + (block.extentY[lane] * std::fabs(plane.y) + block.extentX[lane] * std::fabs(plane.x));
+                if (distance + radius < 0.0f)
+                {
+                    outside = true;
+                    break;
+                }
+            }
+            if (!outside)
+            {
+                visible.push_back(i);
+            }
+        }
+    }
+
+    struct Result {
+        double seconds = 0.0;   ///< Mejor tiempo de todas las vistas
+        uint64_t tested = 0;
+        uint64_t visible = 0;
+        std::vector<std::vector<uint32_t>> visibleSets;
+    };
+
+    template<typename Cull>
+    Result Measure(const std::vector<Frustum>& views, uint32_t repeat, Cull&& cull)
+    {
+        Result result;
+        result.visibleSets.resize(views.size());
+        for (uint32_t r = 0; r < repeat; r++)
+        {
+            uint64_t tested = 0;
+            uint64_t visible = 0;
+            Clock::time_point start = Clock::now();
+            for (size_t i = 0; i < views.size(); i++)
+            {
+                std::vector<uint32_t>& set = result.visibleSets[i];
+                set.clear();
+                tested += cull(views[i], set);
+                visible += set.size();
+            }
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            if (r == 0 || seconds < result.seconds) result.seconds = seconds;
+            result.tested = tested;
+            result.visible = visible;
+        }
+        for (std::vector<uint32_t>& set : result.visibleSets)
+        {
+            std::sort(set.begin(), set.end());
+        }
+        return result;
+    }
+
+    void WriteRow(const char* method, uint32_t objects, size_t views, const Result& result, double scalarSeconds)
+    {
+        double microsecondsPerView = result.seconds * 1e6 / views;
+        std::cout << method << ',' << objects << ',' << views << ',' << microsecondsPerView / 1000.0 << ','
+            << result.tested / views << ',' << result.visible / views << ',' << objects / microsecondsPerView << ','
+            << scalarSeconds / result.seconds << '\n';
+    }
+
+    int Usage()
+    {
+        std::cerr << "Uso: CullingBenchmark [--blocks N] [--views N] [--repeat N]\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t blocks = 100;
+    uint32_t viewCount = 32;
+    uint32_t repeat = 5;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--blocks") == 0 && i + 1 < argc)
+        {
+            blocks = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--views") == 0 && i + 1 < argc)
+        {
+            viewCount = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+        {
+            repeat = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            return Usage();
+        }
+    }
+    if (blocks == 0 || viewCount == 0 || repeat == 0)
+    {
+        return Usage();
+    }
+
+    CullingBounds city = BuildCity(blocks);
+    std::vector<Frustum> views = StreetViews(blocks, viewCount);
+    Bvh4 bvh;
+    bvh.Build(city);
+
+    Result scalar = Measure(views, repeat, [&](const Frustum& frustum, std::vector<uint32_t>& visible) {
+        CullScalar(frustum, city, visible);
+        return city.count;
+    });
+    Result simd = Measure(views, repeat, [&](const Frustum& frustum, std::vector<uint32_t>& visible) {
+        CullingStats stats;
+        CullAabbs(frustum, city, visible, &stats);
+        return stats.objectsTested;
+    });
+    Result hierarchy = Measure(views, repeat, [&](const Frustum& frustum, std::vector<uint32_t>& visible) {
+        CullingStats stats;
+        bvh.CullFrustum(frustum, visible, &stats);
+        return stats.objectsTested;
+    });
+
+    std::cout << "method,objects,views,msPerView,testedPerView,visiblePerView,objectsPerUs,speedup\n";
+    WriteRow("scalar", city.count, views.size(), scalar, scalar.seconds);
+    WriteRow("simd", city.count, views.size(), simd, scalar.seconds);
+    WriteRow("bvh", city.count, views.size(), hierarchy, scalar.seconds);
+
+    if (simd.visibleSets != scalar.visibleSets || hierarchy.visibleSets != scalar.visibleSets)
+    {
+        std::cerr << "Los conjuntos visibles no coinciden\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,306 @@
+﻿/**
+ * @file DrawQueueBenchmark.cpp
+ * @brief Mide la ordenación de DrawQueue y los cambios de estado que ahorra en una escena de materiales mezclados.
+ *
+ * Uso: DrawQueueBenchmark [--threads N] [--repeat N] [--draws N]
+ *
+ * La escena tiene 64 materiales repartidos entre 8 PSO; los 8 últimos son transparentes. Cada
+ * envío toma un material al azar y una profundidad al azar en [0, 1], y se envía en ese orden,
+ * como llegaría de recorrer las entidades.
+ *
+ * Para 100 000, 300 000 y 1 000 000 de envíos se escribe en CSV el mejor tiempo de --repeat
+ * ordenaciones con DrawQueue::Sort sin JobSystem, con un JobSystem de N hilos de trabajo (por
+ * defecto los del equipo menos uno) y con std::stable_sort por la clave, los millones de envíos
+ * por segundo y las pasadas y bloques de la última. Después, para una escena de --draws envíos
+ * (por defecto 10 000), los cambios de PSO y de material al recorrerla en orden de envío y ya
+ * ordenada. Se comprueba:
+ *
+ * - sorted: las dos ordenaciones de DrawQueue dan la misma secuencia que std::stable_sort,
+ *   conservando el orden de envío a igual clave.
+ * - keys: los opacos van antes que los transparentes; los opacos, agrupados por PSO y material
+ *   y de delante hacia atrás dentro de cada material, y los transparentes, de atrás hacia delante.
+ * - changes: ya ordenada, la capa opaca cambia de PSO y de material una vez por cada uno que usa.
+ *
+ * Devuelve 1 si algo falla. Compila en cualquier plataforma:
+ *
+ *     g++ -std=c++17 -O2 -I Tools/DrawQueueBenchmark -I Mythforge/Source Tools/DrawQueueBenchmark/DrawQueueBenchmark.cpp
+ *         Mythforge/Source/DrawQueue.cpp Mythforge/Source/JobSystem.cpp
+ *         Mythforge/Source/AllocationTracker.cpp Mythforge/Source/Profiler.cpp -pthread
+ */
+
+#include "pch.h"
+#include "DrawQueue.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr uint32_t Materials = 64;
+    constexpr uint32_t Pipelines = 8;
+    constexpr uint32_t TransparentMaterials = 8;
+
+    /**
+     * @struct Draw
+     * @brief Envío de la escena de prueba; los identificadores empiezan en 1, como los de DrawKey.
+     */
+    struct Draw {
+        uint32_t  pipeline;
+        uint32_t  material;
+        DrawLayer layer;
+        float     depth;
+        uint64_t  key;
+    };
+
+    std::vector<Draw> BuildScene(uint32_t count, uint32_t seed)
+    {
+        std::mt19937 random(seed);
+        std::uniform_int_distribution<uint32_t> material(0, Materials - 1);
+        std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+
+        std::vector<Draw> draws(count);
+        for (Draw& draw : draws)
+        {
+            uint32_t index = material(random);
+            draw.pipeline = index % Pipelines + 1;
+            draw.material = index + 1;
+            draw.layer = index >= Materials - TransparentMaterials ? DrawLayer::Transparent : DrawLayer::Opaque;
+            draw.depth = depth(random);
+            draw.key = DrawKey::Make(0, draw.layer, draw.pipeline, draw.material, draw.depth);
+        }
+        return draws;
+    }
+
+    void Fill(DrawQueue& queue, const std::vector<Draw>& draws)
+    {
+        queue.Clear();
+        for (uint32_t i = 0; i < static_cast<uint32_t>(draws.size()); i++)
+        {
+            queue.Push(draws[i].key, i);
+        }
+    }
+
+    /// Orden de referencia: índices de envío ordenados de forma estable por la clave.
+    std::vector<uint32_t> ReferenceOrder(const std::vector<Draw>& draws)
+    {
+        std::vector<uint32_t> order(draws.size());
+        for (uint32_t i = 0; i < static_cast<uint32_t>(order.size()); i++)
+        {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return draws[a].key < draws[b].key; });
+        return order;
+    }
+
+    bool SameOrder(const DrawQueue& queue, const std::vector<uint32_t>& order)
+    {
+        if (queue.Count() != order.size()) return false;
+        for (uint32_t i = 0; i < queue.Count(); i++)
+        {
+            if (queue[i].value != order[i]) return false;
+        }
+        return true;
+    }
+
+    struct Timing {
+        double         seconds = 0.0;   ///< Mejor tiempo
+        DrawQueueStats stats;
+        bool           sorted = true;
+    };
+
+    Timing MeasureQueue(DrawQueue& queue, const std::vector<Draw>& draws, const std::vector<uint32_t>& order, JobSystem* jobs, uint32_t repeat)
+    {
+        Timing timing;
+        for (uint32_t r = 0; r < repeat; r++)
+        {
+            Fill(queue, draws);
+            Clock::time_point start = Clock::now();
+            queue.Sort(jobs);
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            if (r == 0 || seconds < timing.seconds) timing.seconds = seconds;
+            timing.stats = queue.Stats();
+            timing.sorted = timing.sorted && SameOrder(queue, order);
+        }
+        return timing;
+    }
+
+    double MeasureStableSort(const std::vector<Draw>& draws, uint32_t repeat)
+    {
+        std::vector<DrawQueueItem> items(draws.size());
+        double best = 0.0;
+        for (uint32_t r = 0; r < repeat; r++)
+        {
+            for (uint32_t i = 0; i < static_cast<uint32_t>(items.size()); i++)
+            {
+                items[i] = DrawQueueItem{ draws[i].key, i };
+            }
+            Clock::time_point start = Clock::now();
+            std::stable_sort(items.begin(), items.end(), [](const DrawQueueItem& a, const DrawQueueItem& b) { return a.key < b.key; });
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            if (r == 0 || seconds < best) best = seconds;
+        }
+        return best;
+    }
+
+    void WriteRow(const char* method, size_t count, unsigned threads, double seconds, uint32_t passes, uint32_t blocks)
+    {
+        std::cout << method << ',' << count << ',' << threads << ',' << seconds * 1000.0 << ','
+            << count / seconds / 1e6 << ',' << passes << ',' << blocks << '\n';
+    }
+
+    /// Recorre la escena en el orden dado contando los cambios de PSO y de material.
+    template<typename Order>
+    void CountChanges(const std::vector<Draw>& draws, uint32_t count, Order&& order, uint32_t& pipelineChanges, uint32_t& materialChanges)
+    {
+        pipelineChanges = 0;
+        materialChanges = 0;
+        const Draw* previous = nullptr;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const Draw& draw = draws[order(i)];
+            if (!previous || draw.pipeline != previous->pipeline) pipelineChanges++;
+            if (!previous || draw.material != previous->material) materialChanges++;
+            previous = &draw;
+        }
+    }
+
+    /// Opacos antes que transparentes; los opacos por PSO, material y profundidad creciente; los transparentes por profundidad decreciente.
+    bool KeysInOrder(const DrawQueue& queue, const std::vector<Draw>& draws)
+    {
+        for (uint32_t i = 1; i < queue.Count(); i++)
+        {
+            const Draw& a = draws[queue[i - 1].value];
+            const Draw& b = draws[queue[i].value];
+            if (DrawKey::Layer(queue[i].key) != b.layer || DrawKey::Pass(queue[i].key) != 0) return false;
+            if (a.layer != b.layer)
+            {
+                if (a.layer != DrawLayer::Opaque) return false;
+                continue;
+            }
+            if (a.layer == DrawLayer::Transparent)
+            {
+                if (a.depth < b.depth) return false;
+            }
+            else if (a.pipeline != b.pipeline)
+            {
+                if (a.pipeline > b.pipeline) return false;
+            }
+            else if (a.material != b.material)
+            {
+                if (a.material > b.material) return false;
+            }
+            else if (a.depth > b.depth)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Report(const char* name, bool passed)
+    {
+        std::cerr << name << (passed ? ": ok\n" : ": FALLO\n");
+        return passed;
+    }
+
+    int Usage()
+    {
+        std::cerr << "Uso: DrawQueueBenchmark [--threads N] [--repeat N] [--draws N]\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    unsigned hardware = std::thread::hardware_concurrency();
+    unsigned threads = hardware > 1 ? hardware - 1 : 1;
+    uint32_t repeat = 5;
+    uint32_t drawCount = 10000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+        {
+            repeat = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--draws") == 0 && i + 1 < argc)
+        {
+            drawCount = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            return Usage();
+        }
+    }
+    if (repeat == 0 || drawCount == 0)
+    {
+        return Usage();
+    }
+
+    JobSystem jobs(threads);
+    DrawQueue queue;
+    bool sorted = true;
+
+    std::cout << "method,draws,threads,ms,millionDrawsPerSecond,passes,blocks\n";
+    for (uint32_t count : { 100000u, 300000u, 1000000u })
+    {
+        std::vector<Draw> draws = BuildScene(count, count);
+        std::vector<uint32_t> order = ReferenceOrder(draws);
+
+        Timing serial = MeasureQueue(queue, draws, order, nullptr, repeat);
+        Timing parallel = MeasureQueue(queue, draws, order, &jobs, repeat);
+        double stableSort = MeasureStableSort(draws, repeat);
+        sorted = sorted && serial.sorted && parallel.sorted;
+
+        WriteRow("radix", count, 0, serial.seconds, serial.stats.passes, serial.stats.blocks);
+        WriteRow("radixJobs", count, jobs.WorkerCount(), parallel.seconds, parallel.stats.passes, parallel.stats.blocks);
+        WriteRow("stableSort", count, 0, stableSort, 0, 0);
+    }
+
+    std::vector<Draw> scene = BuildScene(drawCount, 1);
+    Fill(queue, scene);
+    queue.Sort(&jobs);
+    sorted = sorted && SameOrder(queue, ReferenceOrder(scene));
+
+    uint32_t submittedPipelines, submittedMaterials;
+    uint32_t sortedPipelines, sortedMaterials;
+    CountChanges(scene, drawCount, [](uint32_t i) { return i; }, submittedPipelines, submittedMaterials);
+    CountChanges(scene, drawCount, [&](uint32_t i) { return queue[i].value; }, sortedPipelines, sortedMaterials);
+
+    // Los opacos ocupan el principio de la cola ya ordenada.
+    uint32_t opaqueCount = 0;
+    bool usedPipelines[Pipelines + 1] = {};
+    bool usedMaterials[Materials + 1] = {};
+    while (opaqueCount < drawCount && scene[queue[opaqueCount].value].layer == DrawLayer::Opaque)
+    {
+        const Draw& draw = scene[queue[opaqueCount].value];
+        usedPipelines[draw.pipeline] = true;
+        usedMaterials[draw.material] = true;
+        opaqueCount++;
+    }
+    uint32_t opaquePipelines, opaqueMaterials;
+    CountChanges(scene, opaqueCount, [&](uint32_t i) { return queue[i].value; }, opaquePipelines, opaqueMaterials);
+
+    std::cout << "\norder,draws,pipelineChanges,materialChanges\n";
+    std::cout << "submitted," << drawCount << ',' << submittedPipelines << ',' << submittedMaterials << '\n';
+    std::cout << "sorted," << drawCount << ',' << sortedPipelines << ',' << sortedMaterials << '\n';
+
+    bool passed = true;
+    passed &= Report("sorted", sorted);
+    passed &= Report("keys", KeysInOrder(queue, scene));
+    passed &= Report("changes", opaquePipelines == std::count(std::begin(usedPipelines), std::end(usedPipelines), true) &&
+                                opaqueMaterials == std::count(std::begin(usedMaterials), std::end(usedMaterials), true));
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,314 @@
+﻿/**
+ * @file DynamicResolutionTest.cpp
+ * @brief Prueba ResolutionController con cargas de GPU guionizadas y la geometría del destino interno.
+ *
+ * Uso: DynamicResolutionTest [--frames N] [--seed N]
+ *
+ * Cada escenario simula N fotogramas (por defecto 1200) con la configuración por defecto, 14 ms
+ * de presupuesto. La GPU tarda 1 ms fijo, el de la ampliación, más la carga del escenario a escala
+ * 1 por la fracción de píxeles dibujada, más un ruido normal de 0,2 ms; como en el motor, cada
+ * tiempo llega al controlador tres fotogramas después. Los escenarios son:
+ *
+ * - over: 24 ms de carga; la escala baja hasta que la GPU entra en el presupuesto.
+ * - under: 8 ms; la escala se queda en la máxima.
+ * - clamp: 100 ms; no cabe ni a la escala mínima, que es donde se queda.
+ * - recover: 24 ms la primera mitad y 8 ms la segunda; vuelve a la escala máxima.
+ * - oscillating: la carga oscila entre 12 y 24 ms con un periodo de 240 fotogramas.
+ * - noise: 12,5 ms, dentro de la banda muerta salvo por el ruido.
+ *
+ * Se escribe en CSV, por escenario, la escala final, los cambios, el tiempo de GPU medio tras el
+ * primer cuarto y en el último cuarto, y los fotogramas que pasan del presupuesto más la banda
+ * muerta tras el primer cuarto. Se comprueba:
+ *
+ * - converge: en over la GPU media del último cuarto queda a menos de un 10% del presupuesto con
+ *   una escala intermedia; en oscillating la media tras el primer cuarto queda a menos de un 5% y
+ *   como mucho un 20% de los fotogramas se pasa. under y noise no cambian la escala, clamp acaba
+ *   en la mínima y recover en la máxima.
+ * - steps: en todos los escenarios la escala queda entre la mínima y la máxima, cada cambio es de
+ *   al menos minStep salvo al llegar a un límite, ninguna subida pasa de maxGrowth y tras cada
+ *   cambio se ignoran settleFrames medidas.
+ * - disabled: al desactivar el control la escala vuelve a la máxima y los tiempos no la mueven.
+ * - size: para escalas de 0,5 a 1 y varias salidas, ScaledSize da múltiplos de 8 salvo donde
+ *   recorta el destino, nunca mayores que él, a menos de 4 píxeles de la salida por la escala y
+ *   crecientes con ella.
+ * - upscale: uvScale es la fracción del destino dibujada y uvMax el centro de su último texel.
+ *
+ * Devuelve 1 si algo falla. Compila en cualquier plataforma:
+ *
+ *     g++ -std=c++17 -O2 -I Tools/DynamicResolutionTest -I Mythforge/Source Tools/DynamicResolutionTest/DynamicResolutionTest.cpp
+ *         Mythforge/Source/DynamicResolution.cpp
+ */
+
+#include "pch.h"
+#include "DynamicResolution.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <random>
+
+namespace
+{
+    constexpr double FixedGpuMs = 1.0;
+    constexpr double NoiseMs = 0.2;
+    constexpr uint32_t TimingDelay = 3;     ///< Fotogramas que tarda un tiempo de GPU en llegar al controlador
+    constexpr double Pi = 3.14159265358979323846;
+
+    /// Carga de GPU a escala 1, en milisegundos, del fotograma frame de frames.
+    using LoadFunction = double (*)(uint32_t frame, uint32_t frames);
+
+    struct Scenario {
+        const char*  name;
+        LoadFunction load;
+    };
+
+    const Scenario scenarios[] = {
+        { "over", [](uint32_t, uint32_t) { return 24.0; } },
+        { "under", [](uint32_t, uint32_t) { return 8.0; } },
+        { "clamp", [](uint32_t, uint32_t) { return 100.0; } },
+        { "recover", [](uint32_t frame, uint32_t frames) { return frame < frames / 2 ? 24.0 : 8.0; } },
+        { "oscillating", [](uint32_t frame, uint32_t) { return 18.0 + 6.0 * std::sin(2.0 * Pi * frame / 240.0); } },
+        { "noise", [](uint32_t, uint32_t) { return 12.5; } },
+    };
+
+    struct Run {
+        float    scale = 0.0f;          ///< Escala final
+        uint64_t changes = 0;
+        double   settledMs = 0.0;       ///< GPU media tras el primer cuarto
+        double   lastQuarterMs = 0.0;
+        uint32_t settledFrames = 0;
+        uint32_t overBudget = 0;        ///< Fotogramas tras el primer cuarto por encima del presupuesto más la banda muerta
+        bool     steps = true;
+    };
+
+    /// Comprueba un cambio de escala de before a after tras updates medidas desde el anterior.
+    bool ValidStep(const ResolutionControllerConfig& config, float before, float after, uint32_t updates)
+    {
+        const float epsilon = 1e-5f;
+        if (after < config.minScale || after > config.maxScale) return false;
+        if (after - before > config.maxGrowth + epsilon) return false;
+        bool atLimit = after == config.minScale || after == config.maxScale;
+        if (std::fabs(after - before) < config.minStep - epsilon && !atLimit) return false;
+        return updates > config.settleFrames;
+    }
+
+    Run Simulate(const Scenario& scenario, uint32_t frames, uint32_t seed)
+    {
+        ResolutionController controller;
+        const ResolutionControllerConfig& config = controller.Config();
+        std::mt19937 random(seed);
+        std::normal_distribution<double> noise(0.0, NoiseMs);
+
+        Run run;
+        std::deque<double> pending;
+        uint32_t updates = config.settleFrames + 1;     // El primer cambio no espera a ninguno anterior
+        double settledTotal = 0.0;
+        double lastQuarterTotal = 0.0;
+        const uint32_t warmUp = frames / 4;
+        const uint32_t lastQuarter = frames - frames / 4;
+
+        for (uint32_t frame = 0; frame < frames; frame++)
+        {
+            double scale = controller.Scale();
+            double gpuMs = FixedGpuMs + scenario.load(frame, frames) * scale * scale + noise(random);
+            if (frame >= warmUp)
+            {
+                settledTotal += gpuMs;
+                run.settledFrames++;
+                if (gpuMs > config.gpuBudgetMs * (1.0 + config.deadband)) run.overBudget++;
+            }
+            if (frame >= lastQuarter)
+            {
+                lastQuarterTotal += gpuMs;
+            }
+
+            pending.push_back(gpuMs);
+            if (pending.size() > TimingDelay)
+            {
+                float before = controller.Scale();
+                float after = controller.Update(pending.front());
+                pending.pop_front();
+                updates++;
+                if (after != before)
+                {
+                    run.steps = run.steps && ValidStep(config, before, after, updates);
+                    updates = 0;
+                }
+            }
+        }
+
+        run.scale = controller.Scale();
+        run.changes = controller.Changes();
+        run.settledMs = settledTotal / run.settledFrames;
+        run.lastQuarterMs = lastQuarterTotal / (frames - lastQuarter);
+        return run;
+    }
+
+    bool Converges(const char* name, const Run& run, const ResolutionControllerConfig& config, uint32_t frames)
+    {
+        double budget = config.gpuBudgetMs;
+        if (strcmp(name, "over") == 0)
+        {
+            return std::fabs(run.lastQuarterMs - budget) < 0.1 * budget && run.scale > config.minScale && run.scale < config.maxScale;
+        }
+        if (strcmp(name, "oscillating") == 0)
+        {
+            return std::fabs(run.settledMs - budget) < 0.05 * budget && run.overBudget <= frames / 5;
+        }
+        if (strcmp(name, "under") == 0 || strcmp(name, "noise") == 0)
+        {
+            return run.scale == config.maxScale && run.changes == 0;
+        }
+        if (strcmp(name, "clamp") == 0)
+        {
+            return run.scale == config.minScale;
+        }
+        return run.scale == config.maxScale;
+    }
+
+    bool CheckDisabled()
+    {
+        ResolutionController controller;
+        for (uint32_t i = 0; i < 100; i++)
+        {
+            controller.Update(40.0);
+        }
+        if (!(controller.Scale() < controller.Config().maxScale)) return false;
+
+        controller.SetEnabled(false);
+        if (controller.Scale() != controller.Config().maxScale) return false;
+
+        uint64_t changes = controller.Changes();
+        for (uint32_t i = 0; i < 100; i++)
+        {
+            if (controller.Update(40.0) != controller.Config().maxScale) return false;
+        }
+        return controller.Changes() == changes;
+    }
+
+    bool CheckAxis(uint32_t output, float scale, uint32_t size, uint32_t limit, uint32_t previous, uint32_t alignment)
+    {
+        if (size > limit || size < previous) return false;
+        if (size == limit) return output * scale >= limit - alignment / 2.0f;
+        return size % alignment == 0 && std::fabs(size - output * scale) <= alignment / 2.0f;
+    }
+
+    bool CheckSizes()
+    {
+        const ResolutionSize outputs[] = { { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 }, { 1280, 720 }, { 1366, 768 }, { 1001, 603 } };
+        const uint32_t alignment = 8;
+        for (ResolutionSize output : outputs)
+        {
+            ResolutionSize limit = DynamicResolution::ScaledSize(output, 1.0f, ResolutionSize{ UINT32_MAX, UINT32_MAX }, 1);
+            if (limit.width != output.width || limit.height != output.height) return false;
+
+            ResolutionSize previous;
+            for (uint32_t step = 50; step <= 100; step++)
+            {
+                float scale = step / 100.0f;
+                ResolutionSize size = DynamicResolution::ScaledSize(output, scale, limit, alignment);
+                if (!CheckAxis(output.width, scale, size.width, limit.width, previous.width, alignment) ||
+                    !CheckAxis(output.height, scale, size.height, limit.height, previous.height, alignment))
+                {
+                    std::cerr << "size: " << output.width << 'x' << output.height << " a escala " << scale
+                              << " da " << size.width << 'x' << size.height << '\n';
+                    return false;
+                }
+                previous = size;
+            }
+        }
+        return true;
+    }
+
+    bool CheckUpscale()
+    {
+        const ResolutionSize target = { 1920, 1080 };
+        const ResolutionSize sizes[] = { { 1920, 1080 }, { 1440, 808 }, { 960, 544 }, { 8, 8 } };
+        const float epsilon = 1e-6f;
+        for (ResolutionSize size : sizes)
+        {
+            UpscaleConstants constants = DynamicResolution::Upscale(size, target);
+            if (std::fabs(constants.uvScale.x * target.width - size.width) > epsilon * target.width ||
+                std::fabs(constants.uvScale.y * target.height - size.height) > epsilon * target.height ||
+                std::fabs(constants.uvMax.x * target.width - (size.width - 0.5f)) > epsilon * target.width ||
+                std::fabs(constants.uvMax.y * target.height - (size.height - 0.5f)) > epsilon * target.height)
+            {
+                return false;
+            }
+        }
+
+        // Sin destino no hay nada que ampliar.
+        UpscaleConstants empty = DynamicResolution::Upscale(target, ResolutionSize{});
+        return empty.uvScale.x == 0.0f && empty.uvScale.y == 0.0f && empty.uvMax.x == 0.0f && empty.uvMax.y == 0.0f;
+    }
+
+    bool Report(const char* name, bool passed)
+    {
+        std::cerr << name << (passed ? ": ok\n" : ": FALLO\n");
+        return passed;
+    }
+
+    int Usage()
+    {
+        std::cerr << "Uso: DynamicResolutionTest [--frames N] [--seed N]\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t frames = 1200;
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            frames = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            return Usage();
+        }
+    }
+    if (frames < 400)
+    {
+        return Usage();
+    }
+
+    const ResolutionControllerConfig config;
+    bool converges = true;
+    bool steps = true;
+
+    std::cout << "scenario,scale,changes,settledGpuMs,lastQuarterGpuMs,overBudgetFrames\n";
+    for (const Scenario& scenario : scenarios)
+    {
+        Run run = Simulate(scenario, frames, seed);
+        std::cout << scenario.name << ',' << run.scale << ',' << run.changes << ',' << run.settledMs << ','
+                  << run.lastQuarterMs << ',' << run.overBudget << '\n';
+
+        if (!Converges(scenario.name, run, config, run.settledFrames))
+        {
+            std::cerr << "converge: " << scenario.name << " no acaba donde debe\n";
+            converges = false;
+        }
+        if (!run.steps)
+        {
+            std::cerr << "steps: " << scenario.name << " da un cambio de escala no válido\n";
+            steps = false;
+        }
+    }
+
+    bool passed = true;
+    passed &= Report("converge", converges);
+    passed &= Report("steps", steps);
+    passed &= Report("disabled", CheckDisabled());
+    passed &= Report("size", CheckSizes());
+    passed &= Report("upscale", CheckUpscale());
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,223 @@
+﻿/**
+ * @file FrameAllocationTest.cpp
+ * @brief Comprueba que el bucle de fotograma estable no pide memoria al montículo.
+ *
+ * Uso: FrameAllocationTest [--entities N] [--warmup N] [--frames N] [--threads N]
+ *
+ * Repite el fotograma de App::Run y App::RenderFrame sin ventana ni GPU: una cuadrícula de N cubos
+ * animados (por defecto 4096) por el hilo de Simulation; en el hilo de juego, Interpolate,
+ * BuildDrawPackets y SortDrawPackets sobre dos FramePacket alternos; y, en lugar de grabar en
+ * D3D12, cada dibujado de la DrawQueue se entrega a un NullCommandSink con los mismos paquetes
+ * que grabaría la captura, contando en RenderStats y cerrando con RenderStats::EndFrame.
+ *
+ * Tras --warmup fotogramas (por defecto 120, como AllocationWarmupFrames en App.cpp), se cuentan
+ * con AllocationTracker las asignaciones de todos los hilos durante --frames fotogramas (por
+ * defecto 600). Se escribe en CSV lo asignado en cada fase y, si hubo algo en la estable, el
+ * primer fotograma afectado y el informe por etiquetas en la salida de error. Devuelve 1 si la
+ * fase estable asignó algo. Necesita DirectXMath; véase CullingBenchmark:
+ *
+ *     g++ -std=c++17 -O2 -isystem "$DIRECTXMATH/Inc" -isystem "$DIRECTX_HEADERS/include/wsl/stubs"
+ *         -I Tools/FrameAllocationTest -I Mythforge/Source Tools/FrameAllocationTest/FrameAllocationTest.cpp
+ *         Mythforge/Source/Scene.cpp Mythforge/Source/Simulation.cpp Mythforge/Source/Entities.cpp
+ *         Mythforge/Source/Culling.cpp Mythforge/Source/Bvh.cpp Mythforge/Source/Occlusion.cpp
+ *         Mythforge/Source/VectorMath.cpp Mythforge/Source/VectorStreams.cpp Mythforge/Source/DrawQueue.cpp
+ *         Mythforge/Source/FrameArena.cpp Mythforge/Source/CommandStream.cpp Mythforge/Source/RenderStats.cpp
+ *         Mythforge/Source/FrameStats.cpp Mythforge/Source/JobSystem.cpp Mythforge/Source/AllocationTracker.cpp
+ *         Mythforge/Source/Profiler.cpp -pthread
+ */
+
+#include "pch.h"
+#include "AllocationTracker.h"
+#include "CommandStream.h"
+#include "FramePacket.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "Simulation.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    constexpr CaptureId ConstantBuffer = 1;
+    constexpr CaptureId Pipeline = 2;
+    constexpr CaptureId ShaderHeap = 3;
+    constexpr CaptureId RenderTargetHeap = 4;
+    constexpr CaptureId DepthHeap = 5;
+    constexpr CaptureId BackBuffer = 6;
+    constexpr uint32_t IndexCount = 36;
+
+    template<typename T>
+    void Send(NullCommandSink& sink, CommandOp op, const T& payload)
+    {
+        DispatchCommandPacket(CommandPacket{ op, reinterpret_cast<const uint8_t*>(&payload), sizeof(T) }, sink);
+    }
+
+    /// Lo que hace App::RenderFrame con un paquete, entregado al backend nulo.
+    void RenderFrame(const FramePacket& packet, NullCommandSink& sink)
+    {
+        PROFILE_SCOPE("RenderFrame");
+        Send(sink, CommandOp::BeginFrame, FrameCommand{ static_cast<uint32_t>(packet.frame) });
+        Send(sink, CommandOp::Barrier, BarrierCommand{ BackBuffer, 0, 0, 4 });
+        Send(sink, CommandOp::SetRenderTargets, SetRenderTargetsCommand{ RenderTargetHeap, 0, DepthHeap, 0 });
+        Send(sink, CommandOp::ClearRenderTarget, ClearRenderTargetCommand{ RenderTargetHeap, 0, { 0.4f, 0.6f, 0.9f, 1.0f } });
+        Send(sink, CommandOp::ClearDepth, ClearDepthCommand{ DepthHeap, 0, 1, 1.0f, 0 });
+        RenderStats::Add(RenderCounter::RenderTargetBinds);
+        RenderStats::Add(RenderCounter::Clears, 2);
+        RenderStats::Add(RenderCounter::Barriers);
+
+        // Constantes del dibujado seguidas de su contenido, como las escribe Cube::UpdateConstantBuffer.
+        struct {
+            BufferWriteCommand command;
+            XMFLOAT4X4         matrices[2];
+        } constants;
+        {
+            RenderStatsPass statsPass("Draw Packets");
+            uint32_t drawIndex = 0;
+            for (const DrawQueueItem& item : packet.drawQueue)
+            {
+                const DrawPacket& drawPacket = packet.drawList.packets[item.value];
+                constants.command = BufferWriteCommand{ ConstantBuffer, sizeof(constants.matrices), drawIndex * 256ull };
+                constants.matrices[0] = drawPacket.world;
+                constants.matrices[1] = packet.viewProjection;
+                Send(sink, CommandOp::WriteBuffer, constants);
+                Send(sink, CommandOp::SetPipeline, ObjectCommand{ Pipeline });
+                Send(sink, CommandOp::SetRootTable, SetRootTableCommand{ 0, ShaderHeap, drawIndex });
+                Send(sink, CommandOp::DrawIndexed, DrawIndexedCommand{ IndexCount, 1, 0, 0, 0 });
+                RenderStats::Add(RenderCounter::RootParameterWrites);
+                RenderStats::Add(RenderCounter::DrawCalls);
+                RenderStats::Add(RenderCounter::Primitives, IndexCount / 3);
+                drawIndex++;
+            }
+        }
+
+        Send(sink, CommandOp::Barrier, BarrierCommand{ BackBuffer, 0, 4, 0 });
+        Send(sink, CommandOp::Present, FrameCommand{ static_cast<uint32_t>(packet.frame) });
+        Send(sink, CommandOp::EndFrame, FrameCommand{ static_cast<uint32_t>(packet.frame) });
+        RenderStats::Add(RenderCounter::CpuAllocations, packet.allocations.allocations);
+        RenderStats::Add(RenderCounter::CpuAllocatedBytes, packet.allocations.bytes);
+        RenderStats::EndFrame();
+    }
+
+    int Usage()
+    {
+        std::cerr << "Uso: FrameAllocationTest [--entities N] [--warmup N] [--frames N] [--threads N]\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t entities = 4096;
+    uint64_t warmup = 120;
+    uint64_t frames = 600;
+    uint32_t threads = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--entities") == 0 && i + 1 < argc)
+        {
+            entities = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+        {
+            warmup = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            frames = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            return Usage();
+        }
+    }
+    if (entities == 0 || frames == 0)
+    {
+        return Usage();
+    }
+
+    JobSystem jobSystem(threads);
+    World world;
+    uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(entities))));
+    LocalBounds cubeBounds{ XMFLOAT3(1.0f, 1.0f, 1.0f) };
+    for (uint32_t i = 0; i < entities; i++)
+    {
+        float x = (static_cast<float>(i % side) - side * 0.5f) * 3.0f;
+        float z = static_cast<float>(i / side) * 3.0f + 5.0f;
+        world.Create(
+            Transform{ XMFLOAT3(x, 0.0f, z), 0.0f },
+            cubeBounds,
+            InnerOccluderBox(cubeBounds),
+            SpinAnimation{ 0.02f },
+            BobAnimation{ 0.002f, 0.0f, 2.0f, static_cast<float>(i) * 0.1f },
+            MeshInstance{ nullptr, 1, 1, DrawLayer::Opaque });
+    }
+
+    Simulation simulation(world, jobSystem);
+    simulation.Start();
+
+    XMMATRIX view = XMMatrixLookToRH(XMVectorSet(0.0f, 40.0f, -20.0f, 1.0f), XMVectorSet(0.0f, -1.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    XMMATRIX viewProjection = XMMatrixMultiply(view, XMMatrixPerspectiveFovRH(XMConvertToRadians(70.0f), 16.0f / 9.0f, 0.1f, 1000.0f));
+
+    FramePacket packets[2];
+    SceneCulling sceneCulling;
+    std::vector<Transform> frameTransforms;
+    NullCommandSink sink;
+
+    AllocationCounters phases[2] = {};
+    uint64_t firstAllocatingFrame = 0;
+    uint64_t draws = 0;
+    for (uint64_t frame = 0; frame < warmup + frames; frame++)
+    {
+        FramePacket& packet = packets[frame % 2];
+        AllocationCounters frameStart = AllocationTracker::Totals();
+        {
+            PROFILE_SCOPE("Frame");
+            AllocationScope allocationScope("Frame");
+            packet.arena.Reset();
+            packet.frame = frame;
+            XMStoreFloat4x4(&packet.viewProjection, viewProjection);
+
+            simulation.Interpolate(static_cast<int64_t>(Profiler::TimestampToMicroseconds(Profiler::Now())), frameTransforms);
+            BuildDrawPackets(world, frameTransforms.data(), viewProjection, sceneCulling, packet.arena, packet.drawList);
+            SortDrawPackets(packet.drawList, packet.drawQueue, jobSystem);
+            packet.allocations = AllocationTracker::Totals() - frameStart;
+        }
+        RenderFrame(packet, sink);
+
+        AllocationCounters used = AllocationTracker::Totals() - frameStart;
+        bool steady = frame >= warmup;
+        phases[steady].allocations += used.allocations;
+        phases[steady].bytes += used.bytes;
+        phases[steady].frees += used.frees;
+        if (steady)
+        {
+            draws += packet.drawQueue.Count();
+            if (used.allocations > 0 && firstAllocatingFrame == 0)
+            {
+                firstAllocatingFrame = frame;
+            }
+        }
+    }
+    simulation.Stop();
+
+    std::cout << "phase,frames,allocations,bytes,frees,drawsPerFrame\n";
+    std::cout << "warmup," << warmup << ',' << phases[0].allocations << ',' << phases[0].bytes << ',' << phases[0].frees << ",\n";
+    std::cout << "steady," << frames << ',' << phases[1].allocations << ',' << phases[1].bytes << ',' << phases[1].frees << ',' << draws / frames << '\n';
+
+    bool passed = phases[1].allocations == 0 && draws > 0;
+    if (phases[1].allocations > 0)
+    {
+        std::cerr << "Primer fotograma con asignaciones: " << firstAllocatingFrame << '\n';
+        AllocationTracker::WriteReport(std::cerr);
+    }
+    std::cout << "steady: " << (passed ? "ok" : "FALLO") << '\n';
+    return passed ? 0 : 1;
+}
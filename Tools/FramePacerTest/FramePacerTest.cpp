@@ -0,0 +1,253 @@
+﻿/**
+ * @file FramePacerTest.cpp
+ * @brief Prueba de FramePacer contra una pantalla y una GPU simuladas.
+ *
+ * Uso: FramePacerTest [--frames N] [--seed N]
+ *
+ * Cada escenario simula N fotogramas (por defecto 3000) a 60 Hz en los tres modos. La CPU y la
+ * GPU tardan lo que dice el escenario más un ruido normal; la GPU empieza cuando acaba la CPU y
+ * queda libre la anterior, y cada fotograma se ve en la primera vsync tras acabar la GPU, no antes
+ * de su intervalo. Como en el motor, la cadena tiene tres búferes (el fotograma f + 3 no empieza
+ * hasta que se muestra f), los tiempos de GPU llegan al controlador con dos fotogramas de retraso
+ * y el periodo de refresco inicial es erróneo (16,0 ms) hasta que OnVsync lo corrige.
+ *
+ * Se escribe en CSV la latencia de entrada a imagen media y máxima, las vsyncs perdidas, los
+ * tirones (intervalos entre imágenes distintos del planificado), el intervalo final y el periodo
+ * estimado. Se comprueba:
+ *
+ * - plans: todo plan empieza no antes de now y, si espera, deja la CPU, la GPU y el margen
+ *   previstos antes de su objetivo; en LatencyCapped el margen no lleva la latencia prevista por
+ *   encima del tope. Pasado el calentamiento el objetivo cae en una vsync de la rejilla; antes no,
+ *   porque el objetivo anterior se fijó con el periodo erróneo.
+ * - period: el periodo estimado converge a 16667 us.
+ * - interval: intervalo 1 cuando max(cpu, gpu) cabe en un periodo y 2 con 22 ms de GPU.
+ * - latency: los modos con ritmo reducen la latencia media del modo Unpaced al menos un 40%.
+ * - judder: con 22 ms de GPU, LowLatency da diez veces menos tirones que Unpaced.
+ * - deterministic: las mismas entradas producen los mismos planes.
+ *
+ * Devuelve 1 si algo falla. Compila en cualquier plataforma:
+ *
+ *     g++ -std=c++17 -O2 -I Tools/FramePacerTest -I Mythforge/Source Tools/FramePacerTest/FramePacerTest.cpp
+ *         Mythforge/Source/FramePacer.cpp
+ */
+
+#include "pch.h"
+#include "FramePacer.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <random>
+
+namespace
+{
+    constexpr int64_t Period = 16667;       ///< Refresco real de la pantalla simulada, 60 Hz
+    constexpr int64_t LatencyCap = 20000;
+    constexpr uint64_t WarmupFrames = 100;  ///< No cuentan para las medias: el periodo y las predicciones aún convergen
+
+    struct Scenario {
+        const char* name;
+        double      cpuMean;
+        double      cpuJitter;
+        double      gpuMean;
+        double      gpuJitter;
+        double      spikeChance;            ///< Probabilidad de que un fotograma tenga un pico de GPU
+        double      spikeUs;
+        uint32_t    expectedInterval;
+    };
+
+    struct RunResult {
+        double   averageLatencyMs = 0.0;
+        double   maxLatencyMs = 0.0;
+        uint64_t missed = 0;
+        uint64_t judder = 0;
+        uint32_t interval = 0;
+        int64_t  period = 0;
+        uint64_t planHash = 14695981039346656037ull;
+        bool     plansValid = true;
+    };
+
+    int64_t CeilToVsync(int64_t time)
+    {
+        return (time + Period - 1) / Period * Period;
+    }
+
+    /// Comprueba lo que todo plan debe cumplir, sea cual sea el escenario.
+    bool ValidPlan(const FramePacer& pacer, const FramePlan& plan, int64_t now, bool warm)
+    {
+        if (plan.start < now || plan.interval < 1 || plan.interval > pacer.Config().maxInterval) return false;
+        if (pacer.Mode() == FramePacingMode::Unpaced) return plan.start == now && plan.margin == 0;
+        if (warm && pacer.NextVsync(plan.target) != plan.target) return false;
+        if (plan.start > now && plan.start + plan.predictedCpu + plan.predictedGpu + plan.margin > plan.target) return false;
+        if (pacer.Mode() == FramePacingMode::LatencyCapped &&
+            plan.margin > (std::max<int64_t>)(0, LatencyCap - plan.predictedCpu - plan.predictedGpu))
+        {
+            return false;
+        }
+        return true;
+    }
+
+    RunResult Run(const Scenario& scenario, FramePacingMode mode, uint64_t frames, uint32_t seed)
+    {
+        FramePacerConfig config;
+        config.mode = mode;
+        config.refreshPeriod = 16000;
+        config.latencyCap = LatencyCap;
+        FramePacer pacer(config);
+
+        std::mt19937 rng(seed);
+        std::normal_distribution<double> noise(0.0, 1.0);
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+        RunResult result;
+        int64_t now = 0;
+        int64_t gpuBusy = 0;
+        int64_t lastDisplayed = 0;
+        int64_t latencyTotal = 0;
+        int64_t latencyMax = 0;
+        std::deque<FrameTiming> pendingTimings;
+        std::deque<int64_t> swapChain;
+        for (uint64_t f = 0; f < frames; f++)
+        {
+            FramePlan plan = pacer.Plan(now);
+            result.plansValid = ValidPlan(pacer, plan, now, f >= WarmupFrames) && result.plansValid;
+            result.planHash = (result.planHash ^ static_cast<uint64_t>(plan.start)) * 1099511628211ull;
+            result.planHash = (result.planHash ^ static_cast<uint64_t>(plan.target)) * 1099511628211ull;
+
+            double spike = uniform(rng) < scenario.spikeChance ? scenario.spikeUs : 0.0;
+            int64_t cpu = static_cast<int64_t>((std::max)(200.0, scenario.cpuMean + scenario.cpuJitter * noise(rng)));
+            int64_t gpu = static_cast<int64_t>((std::max)(200.0, scenario.gpuMean + scenario.gpuJitter * noise(rng) + spike));
+            int64_t cpuEnd = plan.start + cpu;
+            int64_t gpuStart = (std::max)(cpuEnd, gpuBusy);
+            int64_t gpuEnd = gpuStart + gpu;
+            gpuBusy = gpuEnd;
+
+            int64_t earliest = lastDisplayed ? lastDisplayed + static_cast<int64_t>(plan.interval) * Period : 0;
+            int64_t displayed = (std::max)(CeilToVsync(gpuEnd), CeilToVsync(earliest));
+            if (lastDisplayed && displayed - lastDisplayed != static_cast<int64_t>(plan.interval) * Period) result.judder++;
+            if (displayed > plan.target + Period / 2) result.missed++;
+            lastDisplayed = displayed;
+            if (f >= WarmupFrames)
+            {
+                latencyTotal += displayed - plan.start;
+                latencyMax = (std::max)(latencyMax, displayed - plan.start);
+            }
+
+            FrameTiming timing;
+            timing.frame = plan.frame;
+            timing.start = plan.start;
+            timing.cpuEnd = cpuEnd;
+            timing.gpuStart = gpuStart;
+            timing.gpuEnd = gpuEnd;
+            pendingTimings.push_back(timing);
+            if (pendingTimings.size() > 2)
+            {
+                pacer.CompleteFrame(pendingTimings.front());
+                pendingTimings.pop_front();
+            }
+            pacer.OnVsync(cpuEnd / Period * Period, static_cast<uint64_t>(cpuEnd / Period));
+
+            swapChain.push_back(displayed);
+            int64_t bufferFree = 0;
+            if (swapChain.size() >= 3)
+            {
+                bufferFree = swapChain.front();
+                swapChain.pop_front();
+            }
+            now = (std::max)(cpuEnd, bufferFree);
+        }
+
+        uint64_t counted = frames - WarmupFrames;
+        result.averageLatencyMs = static_cast<double>(latencyTotal) / counted / 1000.0;
+        result.maxLatencyMs = static_cast<double>(latencyMax) / 1000.0;
+        result.interval = pacer.Plan(now).interval;
+        result.period = pacer.RefreshPeriod();
+        return result;
+    }
+
+    bool Report(const char* name, bool passed)
+    {
+        std::cout << name << ": " << (passed ? "ok" : "FALLO") << '\n';
+        return passed;
+    }
+
+    int Usage()
+    {
+        std::cerr << "Uso: FramePacerTest [--frames N] [--seed N]\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t frames = 3000;
+    uint32_t seed = 42;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            frames = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            return Usage();
+        }
+    }
+    if (frames <= 2 * WarmupFrames)
+    {
+        return Usage();
+    }
+
+    const Scenario scenarios[] = {
+        { "light", 3000, 300, 5000, 500, 0.0, 0.0, 1 },
+        { "gpu-bound", 4000, 400, 14500, 800, 0.0, 0.0, 1 },
+        { "cpu+gpu>period", 9000, 600, 12000, 600, 0.0, 0.0, 1 },
+        { "spiky", 3000, 300, 6000, 500, 0.03, 9000.0, 1 },
+        { "heavy", 6000, 500, 22000, 1500, 0.0, 0.0, 2 },
+    };
+    const FramePacingMode modes[] = { FramePacingMode::Unpaced, FramePacingMode::LowLatency, FramePacingMode::LatencyCapped };
+
+    bool plans = true;
+    bool period = true;
+    bool interval = true;
+    bool latency = true;
+    bool judder = true;
+    std::cout << "scenario,mode,avgLatencyMs,maxLatencyMs,missed,judder,interval,periodUs\n";
+    for (const Scenario& scenario : scenarios)
+    {
+        RunResult results[3];
+        for (size_t m = 0; m < 3; m++)
+        {
+            const RunResult& result = results[m] = Run(scenario, modes[m], frames, seed);
+            std::cout << scenario.name << ',' << FramePacer::ModeName(modes[m]) << ',' << result.averageLatencyMs << ',' << result.maxLatencyMs
+                      << ',' << result.missed << ',' << result.judder << ',' << result.interval << ',' << result.period << '\n';
+            plans = result.plansValid && plans;
+            period = result.period >= Period - 1 && result.period <= Period + 1 && period;
+        }
+        const RunResult& unpaced = results[0];
+        for (size_t m = 1; m < 3; m++)
+        {
+            interval = results[m].interval == scenario.expectedInterval && interval;
+            latency = results[m].averageLatencyMs <= 0.6 * unpaced.averageLatencyMs && latency;
+        }
+        if (scenario.expectedInterval > 1)
+        {
+            judder = results[1].judder * 10 <= unpaced.judder && judder;
+        }
+    }
+
+    bool passed = Report("plans", plans);
+    passed = Report("period", period) && passed;
+    passed = Report("interval", interval) && passed;
+    passed = Report("latency", latency) && passed;
+    passed = Report("judder", judder) && passed;
+    passed = Report("deterministic", Run(scenarios[3], FramePacingMode::LowLatency, frames, seed).planHash ==
+                                         Run(scenarios[3], FramePacingMode::LowLatency, frames, seed).planHash) && passed;
+    return passed ? 0 : 1;
+}
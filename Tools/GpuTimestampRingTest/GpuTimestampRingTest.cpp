@@ -0,0 +1,276 @@
+﻿/**
+ * @file GpuTimestampRingTest.cpp
+ * @brief Prueba de GpuTimestampRing con una GPU simulada que escribe timestamps sintéticos.
+ *
+ * Uso: GpuTimestampRingTest [--frames N]
+ *
+ * Repite lo que hace GpuProfiler con una cola de consultas y un búfer de lectura falsos: cada
+ * fotograma abre ámbitos anidados en el hueco que le toca, la GPU simulada escribe sus timestamps
+ * en el búfer y el hueco se resuelve cuando vuelve a tocarle. Se comprueba:
+ *
+ * - wrap: con tres huecos y N fotogramas (por defecto 1000), cada resolución devuelve los ámbitos
+ *   del fotograma que se grabó en ese hueco, con su anidamiento y sus duraciones.
+ * - late: un hueco resuelto varios fotogramas tarde no se mezcla con los grabados después, y un
+ *   fotograma sin consultas no queda pendiente.
+ * - budget: los ámbitos que no caben en el presupuesto del fotograma se ignoran junto con su final.
+ * - ticks: la conversión a milisegundos y al reloj del perfilador con varias frecuencias de GPU,
+ *   con timestamps anteriores a la calibración y con relojes cerca de 2^63.
+ *
+ * Devuelve 1 si algo falla. Compila en cualquier plataforma:
+ *
+ *     g++ -std=c++17 -O2 -I Tools/GpuTimestampRingTest -I Mythforge/Source
+ *         Tools/GpuTimestampRingTest/GpuTimestampRingTest.cpp Mythforge/Source/GpuTimestampRing.cpp
+ */
+
+#include "pch.h"
+#include "GpuTimestampRing.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    constexpr uint32_t FramesInFlight = 3;
+    constexpr uint32_t MaxScopes = 8;
+
+    bool Near(double value, double expected)
+    {
+        return std::fabs(value - expected) <= 1e-9 * (std::fabs(expected) + 1.0);
+    }
+
+    bool Report(const char* name, bool passed)
+    {
+        std::cout << name << ": " << (passed ? "ok" : "FALLO") << '\n';
+        return passed;
+    }
+
+    /**
+     * @class SimulatedGpu
+     * @brief Búfer de lectura del perfilador, donde la GPU simulada escribe el timestamp de cada consulta.
+     */
+    class SimulatedGpu {
+    public:
+        explicit SimulatedGpu(const GpuTimestampRing& ring) : readback(ring.TotalQueries(), 0) {}
+
+        void Write(uint32_t query, uint64_t timestamp) { readback[query] = timestamp; }
+        const uint64_t* Slot(const GpuTimestampRing& ring, uint32_t slot) const { return readback.data() + ring.FirstQuery(slot); }
+
+    private:
+        std::vector<uint64_t> readback;
+    };
+
+    /// Graba el fotograma frame como GpuProfiler: "GPU Frame" y dentro "Clear" y "Draw", con "Mesh" dentro de "Draw".
+    /// Las duraciones dependen de frame para que cada resolución pueda saber de qué fotograma viene.
+    void RecordFrame(GpuTimestampRing& ring, SimulatedGpu& gpu, uint32_t slot, uint64_t frame, uint64_t& clock)
+    {
+        GpuClockCalibration calibration;
+        calibration.gpuTimestamp = clock;
+        calibration.gpuFrequency = 1000000;
+        calibration.cpuTicks = 1000 * frame;
+        calibration.cpuTicksPerMicrosecond = 2.0;
+        ring.BeginFrame(slot, calibration);
+
+        uint32_t frameBegin = ring.BeginScope("GPU Frame");
+        gpu.Write(frameBegin, clock);
+        uint32_t clearBegin = ring.BeginScope("Clear");
+        gpu.Write(clearBegin, clock += 10);
+        gpu.Write(ring.EndScope(), clock += 100 + frame % 7);
+        uint32_t drawBegin = ring.BeginScope("Draw");
+        gpu.Write(drawBegin, clock += 5);
+        uint32_t meshBegin = ring.BeginScope("Mesh");
+        gpu.Write(meshBegin, clock);
+        gpu.Write(ring.EndScope(), clock += 1000 + frame);
+        gpu.Write(ring.EndScope(), clock += 20);
+        gpu.Write(ring.EndScope(), clock += 3);
+        ring.EndFrame();
+        clock += 16667;
+    }
+
+    /// Comprueba que timings son los ámbitos que RecordFrame grabó para frame.
+    bool CheckFrame(const GpuTimestampRing& ring, const std::vector<GpuScopeTiming>& timings, uint64_t frame)
+    {
+        const char* names[] = { "GPU Frame", "Clear", "Draw", "Mesh" };
+        const uint32_t depths[] = { 0, 1, 1, 2 };
+        const double clear = 100.0 + frame % 7;
+        const double mesh = 1000.0 + frame;
+        const double durations[] = { 10 + clear + 5 + mesh + 20 + 3, clear, mesh + 20, mesh };
+        const double starts[] = { 0, 10, 10 + clear + 5, 10 + clear + 5 };
+        if (timings.size() != 4) return false;
+        for (size_t i = 0; i < 4; i++)
+        {
+            // A 1 MHz un tick es un microsegundo.
+            const GpuScopeTiming& timing = timings[i];
+            if (strcmp(timing.name, names[i]) != 0 || timing.depth != depths[i] ||
+                !Near(timing.durationMs, durations[i] / 1000.0) || !Near(timing.startMs, starts[i] / 1000.0) ||
+                timing.cpuEnd - timing.cpuStart != static_cast<uint64_t>(2 * durations[i]))
+            {
+                return false;
+            }
+        }
+        return timings[0].cpuStart == 1000 * frame && Near(ring.LastFrameMs(), durations[0] / 1000.0);
+    }
+
+    bool TestWrap(uint64_t frames)
+    {
+        GpuTimestampRing ring;
+        ring.Initialize(FramesInFlight, MaxScopes);
+        SimulatedGpu gpu(ring);
+        uint64_t clock = 5000;
+        uint64_t resolvedFrames = 0;
+        bool passed = true;
+        for (uint64_t frame = 0; frame < frames; frame++)
+        {
+            uint32_t slot = static_cast<uint32_t>(frame % FramesInFlight);
+            bool pending = ring.IsPending(slot);
+            passed = pending == (frame >= FramesInFlight) && passed;
+            if (pending)
+            {
+                passed = CheckFrame(ring, ring.Resolve(slot, gpu.Slot(ring, slot)), frame - FramesInFlight) && passed;
+                passed = !ring.IsPending(slot) && passed;
+                resolvedFrames++;
+            }
+            RecordFrame(ring, gpu, slot, frame, clock);
+        }
+        return passed && resolvedFrames == frames - FramesInFlight;
+    }
+
+    bool TestLate()
+    {
+        GpuTimestampRing ring;
+        ring.Initialize(FramesInFlight, MaxScopes);
+        SimulatedGpu gpu(ring);
+        uint64_t clock = 1u << 20;
+        bool passed = true;
+
+        // El hueco 0 se queda sin resolver mientras los otros dos se graban y se resuelven varias veces.
+        RecordFrame(ring, gpu, 0, 0, clock);
+        for (uint64_t frame = 1; frame < 7; frame++)
+        {
+            uint32_t slot = 1 + static_cast<uint32_t>(frame % 2);
+            if (ring.IsPending(slot))
+            {
+                passed = CheckFrame(ring, ring.Resolve(slot, gpu.Slot(ring, slot)), frame - 2) && passed;
+            }
+            RecordFrame(ring, gpu, slot, frame, clock);
+        }
+        passed = ring.IsPending(0) && ring.IsPending(1) && ring.IsPending(2) && passed;
+        passed = CheckFrame(ring, ring.Resolve(0, gpu.Slot(ring, 0)), 0) && passed;
+
+        // Un fotograma sin ámbitos no usa consultas ni queda pendiente.
+        ring.BeginFrame(0, GpuClockCalibration());
+        passed = ring.EndFrame() == 0 && !ring.IsPending(0) && passed;
+
+        // Un final que la GPU no llegó a escribir (anterior al inicio) da duración cero.
+        ring.BeginFrame(0, GpuClockCalibration());
+        uint32_t begin = ring.BeginScope("Unwritten");
+        uint32_t end = ring.EndScope();
+        ring.EndFrame();
+        gpu.Write(begin, 900);
+        gpu.Write(end, 0);
+        const std::vector<GpuScopeTiming>& unwritten = ring.Resolve(0, gpu.Slot(ring, 0));
+        passed = unwritten.size() == 1 && unwritten[0].durationMs == 0.0 && passed;
+        return passed;
+    }
+
+    bool TestBudget()
+    {
+        GpuTimestampRing ring;
+        ring.Initialize(1, 3);
+        ring.BeginFrame(0, GpuClockCalibration());
+        bool passed = ring.QueriesPerFrame() == 6;
+
+        // Tres ámbitos caben; el cuarto, anidado dentro del tercero, y el quinto no.
+        uint32_t a = ring.BeginScope("A");
+        uint32_t b = ring.BeginScope("B");
+        uint32_t bEnd = ring.EndScope();
+        uint32_t c = ring.BeginScope("C");
+        uint32_t d = ring.BeginScope("D");
+        uint32_t dEnd = ring.EndScope();
+        uint32_t cEnd = ring.EndScope();
+        uint32_t aEnd = ring.EndScope();
+        uint32_t e = ring.BeginScope("E");
+        uint32_t eEnd = ring.EndScope();
+        passed = a == 0 && aEnd == 1 && b == 2 && bEnd == 3 && c == 4 && cEnd == 5 && passed;
+        passed = d == GpuTimestampRing::InvalidQuery && dEnd == GpuTimestampRing::InvalidQuery && passed;
+        passed = e == GpuTimestampRing::InvalidQuery && eEnd == GpuTimestampRing::InvalidQuery && passed;
+        passed = ring.EndFrame() == 6 && passed;
+
+        const uint64_t timestamps[] = { 100, 400, 110, 150, 200, 390 };
+        const std::vector<GpuScopeTiming>& timings = ring.Resolve(0, timestamps);
+        passed = timings.size() == 3 && strcmp(timings[2].name, "C") == 0 && timings[2].depth == 1 && passed;
+        return passed;
+    }
+
+    bool TestTicks()
+    {
+        bool passed = true;
+        const uint64_t frequencies[] = { 1000000, 10000000, 19200000, 24000000, 1000000000 };
+        const uint64_t bases[] = { 0, 123456789, (uint64_t(1) << 63) - 1000000000 };
+        for (uint64_t frequency : frequencies)
+        {
+            for (uint64_t base : bases)
+            {
+                GpuTimestampRing ring;
+                ring.Initialize(2, 2);
+                GpuClockCalibration calibration;
+                calibration.gpuFrequency = frequency;
+                calibration.gpuTimestamp = base + frequency / 100;      // 10 ms después del primer timestamp
+                calibration.cpuTicks = uint64_t(1) << 40;
+                calibration.cpuTicksPerMicrosecond = 2.5;
+                ring.BeginFrame(1, calibration);
+                ring.BeginScope("Frame");
+                ring.BeginScope("Pass");
+                ring.EndScope();
+                ring.EndScope();
+                ring.EndFrame();
+
+                // Frame dura 16,5 ms; Pass empieza 1 ms después y dura 12,25 ms.
+                const uint64_t ms = frequency / 1000;
+                const uint64_t timestamps[] = { base, base + 16 * ms + ms / 2, base + ms, base + 13 * ms + ms / 4 };
+                const std::vector<GpuScopeTiming>& timings = ring.Resolve(1, timestamps);
+                passed = timings.size() == 2 && Near(timings[0].durationMs, 16.5) && Near(timings[1].startMs, 1.0) &&
+                    Near(timings[1].durationMs, 12.25) && Near(ring.LastFrameMs(), 16.5) && passed;
+
+                // El primer timestamp es 10 ms anterior a la calibración: 25 000 ticks de CPU antes.
+                passed = timings.size() == 2 && timings[0].cpuStart == calibration.cpuTicks - 25000 &&
+                    timings[1].cpuStart == calibration.cpuTicks - 22500 && passed;
+                passed = GpuToCpuTicks(calibration, calibration.gpuTimestamp + 2 * frequency) == calibration.cpuTicks + 5000000 && passed;
+            }
+        }
+        return passed;
+    }
+
+    int Usage()
+    {
+        std::cerr << "Uso: GpuTimestampRingTest [--frames N]\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t frames = 1000;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            frames = strtoull(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            return Usage();
+        }
+    }
+    if (frames <= FramesInFlight)
+    {
+        return Usage();
+    }
+
+    bool passed = Report("wrap", TestWrap(frames));
+    passed = Report("late", TestLate()) && passed;
+    passed = Report("budget", TestBudget()) && passed;
+    passed = Report("ticks", TestTicks()) && passed;
+    return passed ? 0 : 1;
+}
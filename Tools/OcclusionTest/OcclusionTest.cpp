@@ -0,0 +1,260 @@
+﻿/**
+ * @file OcclusionTest.cpp
+ * @brief Prueba OcclusionBuffer con oclusores y oclusos conocidos y con escenas al azar comprobadas por trazado de rayos.
+ *
+ * Uso: OcclusionTest [--scenes N] [--seed N]
+ *
+ * La cámara está en (0, 0, -5) mirando hacia +z, con la proyección a derechas de la aplicación.
+ * Se comprueba:
+ *
+ * - wall: una pared que llena la pantalla oculta una caja detrás, pero no una delante ni a sí misma.
+ * - partial: un cubo girado no oculta una caja grande detrás que lo sobresale y sí una pequeña.
+ * - self: un cubo cuyo oclusor es su caja reducida al 90%, como da InnerOccluderBox, nunca se
+ *   oculta a sí mismo, esté donde esté.
+ * - conservative: en N escenas al azar (por defecto 50) de 20 oclusores y 200 oclusos, cada
+ *   ocluso descartado tiene 200 puntos al azar cuyo rayo desde la cámara choca con algún
+ *   oclusor. Los oclusores se ensanchan 0,15 m en la prueba del rayo: la cobertura se muestrea en
+ *   el centro de cada píxel, y una rendija entre dos oclusores más estrecha que un píxel puede
+ *   ocultar lo que hay detrás.
+ * - order: CullOccluded conserva el orden de los índices visibles y cuenta los probados y los
+ *   descartados.
+ * - deterministic: la misma escena da la misma profundidad en dos búferes.
+ *
+ * Se escribe en CSV los oclusos probados y descartados de las escenas al azar y los que no
+ * estaban ocultos. Devuelve 1 si algo falla. Necesita DirectXMath; véase CullingBenchmark:
+ *
+ *     g++ -std=c++17 -O2 -isystem "$DIRECTXMATH/Inc" -isystem "$DIRECTX_HEADERS/include/wsl/stubs"
+ *         -I Tools/OcclusionTest -I Mythforge/Source Tools/OcclusionTest/OcclusionTest.cpp
+ *         Mythforge/Source/Occlusion.cpp Mythforge/Source/Culling.cpp
+ */
+
+#include "pch.h"
+#include "Occlusion.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+namespace
+{
+    XMMATRIX ViewProjection()
+    {
+        XMMATRIX view = XMMatrixLookToRH(XMVectorSet(0.0f, 0.0f, -5.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+        return XMMatrixMultiply(view, XMMatrixPerspectiveFovRH(XMConvertToRadians(70.0f), 16.0f / 9.0f, 0.1f, 100.0f));
+    }
+
+    /// Prueba de losas: devuelve true si el segmento origin + t * direction, t en [0, 1], toca la caja.
+    bool RayHitsBox(const XMFLOAT3& origin, const XMFLOAT3& direction, const XMFLOAT3& center, const XMFLOAT3& extents)
+    {
+        const float o[3] = { origin.x, origin.y, origin.z };
+        const float d[3] = { direction.x, direction.y, direction.z };
+        const float c[3] = { center.x, center.y, center.z };
+        const float e[3] = { extents.x, extents.y, extents.z };
+        float tMin = 0.0f;
+        float tMax = 1.0f;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float inverse = 1.0f / (std::fabs(d[axis]) < 1e-20f ? 1e-20f : d[axis]);
+            float t1 = (c[axis] - e[axis] - o[axis]) * inverse;
+            float t2 = (c[axis] + e[axis] - o[axis]) * inverse;
+            tMin = (std::max)(tMin, (std::min)(t1, t2));
+            tMax = (std::min)(tMax, (std::max)(t1, t2));
+        }
+        return tMin <= tMax;
+    }
+
+    bool TestWall()
+    {
+        OcclusionBuffer buffer;
+        buffer.Clear(ViewProjection());
+        buffer.RasterizeBox(XMFLOAT3(20.0f, 20.0f, 0.5f), XMMatrixTranslation(0.0f, 0.0f, 10.0f));
+        return buffer.TrianglesRasterized() > 0 &&
+               !buffer.IsVisible(XMFLOAT3(0.0f, 0.0f, 20.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)) &&
+               buffer.IsVisible(XMFLOAT3(0.0f, 0.0f, 5.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)) &&
+               buffer.IsVisible(XMFLOAT3(0.0f, 0.0f, 10.0f), XMFLOAT3(20.0f, 20.0f, 0.5f));
+    }
+
+    bool TestPartial()
+    {
+        OcclusionBuffer buffer;
+        buffer.Clear(ViewProjection());
+        buffer.RasterizeBox(XMFLOAT3(1.0f, 1.0f, 1.0f), XMMatrixRotationY(0.3f) * XMMatrixTranslation(0.0f, 0.0f, 5.0f));
+        return buffer.IsVisible(XMFLOAT3(0.0f, 0.0f, 30.0f), XMFLOAT3(10.0f, 10.0f, 1.0f)) &&
+               !buffer.IsVisible(XMFLOAT3(0.0f, 0.0f, 8.0f), XMFLOAT3(0.2f, 0.2f, 0.2f));
+    }
+
+    bool TestSelf(std::mt19937& rng)
+    {
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        std::uniform_real_distribution<float> depth(2.0f, 90.0f);
+        std::uniform_real_distribution<float> angle(0.0f, XM_2PI);
+        XMMATRIX viewProjection = ViewProjection();
+        for (int i = 0; i < 2000; i++)
+        {
+            float z = depth(rng);
+            XMFLOAT3 position(unit(rng) * z * 0.5f, unit(rng) * z * 0.3f, z);
+            float yaw = angle(rng);
+            OcclusionBuffer buffer;
+            buffer.Clear(viewProjection);
+            buffer.RasterizeBox(XMFLOAT3(0.9f, 0.9f, 0.9f), XMMatrixRotationY(yaw) * XMMatrixTranslation(position.x, position.y, position.z));
+
+            // Caja alineada que envuelve el cubo unidad girado, como la que calcula la escena.
+            float c = std::fabs(std::cos(yaw));
+            float s = std::fabs(std::sin(yaw));
+            if (!buffer.IsVisible(position, XMFLOAT3(c + s, 1.0f, c + s))) return false;
+        }
+        return true;
+    }
+
+    struct RandomResult {
+        uint32_t tested = 0;
+        uint32_t culled = 0;
+        uint32_t exposed = 0;   ///< Descartados con algún punto a la vista
+    };
+
+    RandomResult TestRandomScenes(uint32_t scenes, std::mt19937& rng)
+    {
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        const XMFLOAT3 camera(0.0f, 0.0f, -5.0f);
+        const float gap = 0.15f;
+        XMMATRIX viewProjection = ViewProjection();
+
+        RandomResult result;
+        std::vector<XMFLOAT3> centers;
+        std::vector<XMFLOAT3> extents;
+        for (uint32_t scene = 0; scene < scenes; scene++)
+        {
+            OcclusionBuffer buffer;
+            buffer.Clear(viewProjection);
+            centers.clear();
+            extents.clear();
+            for (int i = 0; i < 20; i++)
+            {
+                XMFLOAT3 center(unit(rng) * 8.0f, unit(rng) * 5.0f, 10.0f + unit(rng) * 5.0f);
+                XMFLOAT3 extent(1.0f + std::fabs(unit(rng)) * 2.0f, 1.0f + std::fabs(unit(rng)) * 2.0f, 0.2f + std::fabs(unit(rng)));
+                buffer.RasterizeBox(extent, XMMatrixTranslation(center.x, center.y, center.z));
+                centers.push_back(center);
+                extents.push_back(XMFLOAT3(extent.x + gap, extent.y + gap, extent.z));
+            }
+
+            for (int j = 0; j < 200; j++)
+            {
+                XMFLOAT3 center(unit(rng) * 10.0f, unit(rng) * 6.0f, 22.0f + unit(rng) * 5.0f);
+                XMFLOAT3 extent(0.3f, 0.3f, 0.3f);
+                result.tested++;
+                if (buffer.IsVisible(center, extent)) continue;
+                result.culled++;
+
+                for (int sample = 0; sample < 200; sample++)
+                {
+                    XMFLOAT3 point(center.x + unit(rng) * extent.x, center.y + unit(rng) * extent.y, center.z + unit(rng) * extent.z);
+                    XMFLOAT3 direction(point.x - camera.x, point.y - camera.y, point.z - camera.z);
+                    bool hidden = false;
+                    for (size_t k = 0; k < centers.size() && !hidden; k++)
+                    {
+                        hidden = RayHitsBox(camera, direction, centers[k], extents[k]);
+                    }
+                    if (!hidden)
+                    {
+                        result.exposed++;
+                        break;
+                    }
+                }
+            }
+        }
+        return result;
+    }
+
+    bool TestOrder()
+    {
+        OcclusionBuffer buffer;
+        buffer.Clear(ViewProjection());
+        buffer.RasterizeBox(XMFLOAT3(2.0f, 2.0f, 0.5f), XMMatrixTranslation(0.0f, 0.0f, 10.0f));
+
+        // Los pares quedan detrás del oclusor y los impares a un lado, a la vista.
+        CullingBounds bounds;
+        std::vector<uint32_t> visible;
+        for (uint32_t i = 0; i < 64; i++)
+        {
+            float x = (i % 2) ? 6.0f : 0.0f;
+            bounds.Add(XMFLOAT3(x, 0.0f, 20.0f + i * 0.1f), XMFLOAT3(0.3f, 0.3f, 0.3f));
+            visible.push_back(63 - i);
+        }
+        OcclusionStats stats = {};
+        CullOccluded(buffer, bounds, visible, &stats);
+
+        bool passed = stats.occludeesTested == 64 && stats.occludeesCulled == 32 && visible.size() == 32;
+        for (size_t i = 0; passed && i < visible.size(); i++)
+        {
+            passed = visible[i] % 2 == 1 && (i == 0 || visible[i] < visible[i - 1]);
+        }
+        return passed;
+    }
+
+    bool TestDeterministic()
+    {
+        std::vector<float> depth[2];
+        for (std::vector<float>& resolved : depth)
+        {
+            std::mt19937 rng(11);
+            std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+            OcclusionBuffer buffer;
+            buffer.Clear(ViewProjection());
+            for (int i = 0; i < 50; i++)
+            {
+                buffer.RasterizeBox(XMFLOAT3(0.5f + std::fabs(unit(rng)), 0.5f + std::fabs(unit(rng)), 0.5f),
+                                    XMMatrixRotationY(unit(rng)) * XMMatrixTranslation(unit(rng) * 10.0f, unit(rng) * 6.0f, 15.0f + unit(rng) * 10.0f));
+            }
+            buffer.ResolveDepth(resolved);
+        }
+        return !depth[0].empty() && depth[0] == depth[1];
+    }
+
+    bool Report(const char* name, bool passed)
+    {
+        std::cout << name << ": " << (passed ? "ok" : "FALLO") << '\n';
+        return passed;
+    }
+
+    int Usage()
+    {
+        std::cerr << "Uso: OcclusionTest [--scenes N] [--seed N]\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t scenes = 50;
+    uint32_t seed = 7;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--scenes") == 0 && i + 1 < argc)
+        {
+            scenes = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            return Usage();
+        }
+    }
+
+    std::mt19937 rng(seed);
+    RandomResult random = TestRandomScenes(scenes, rng);
+    std::cout << "scenes,tested,culled,exposed\n" << scenes << ',' << random.tested << ',' << random.culled << ',' << random.exposed << '\n';
+
+    bool passed = Report("wall", TestWall());
+    passed = Report("partial", TestPartial()) && passed;
+    passed = Report("self", TestSelf(rng)) && passed;
+    passed = Report("conservative", random.culled > 0 && random.exposed == 0) && passed;
+    passed = Report("order", TestOrder()) && passed;
+    passed = Report("deterministic", TestDeterministic()) && passed;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,399 @@
+﻿/**
+ * @file QueueBenchmark.cpp
+ * @brief Prueba de estrés y medida de rendimiento de las colas de ConcurrentQueues.
+ *
+ * Uso: QueueBenchmark [--stress] [--threads 1,2,4,...] [--ops N]
+ *
+ * --stress hace circular muchos elementos por SpscRing, MpmcQueue y MpscQueue con varios hilos y
+ * comprueba que cada uno sale exactamente una vez y en el orden de su productor; también pasa
+ * elementos de uno en uno con EventCount para detectar avisos perdidos. Devuelve 1 si algo falla.
+ * Sin --stress escribe en CSV las operaciones por segundo (un Push más un Pop cuentan como dos)
+ * de cada cola frente a un anillo protegido por std::mutex, con la mitad de los hilos produciendo
+ * y la otra mitad consumiendo; con un solo hilo, ese hilo hace las dos cosas. Compila en
+ * cualquier plataforma; para buscar carreras se compila también con ThreadSanitizer:
+ *
+ *     g++ -std=c++17 -O2 -I Tools/QueueBenchmark -I Mythforge/Source Tools/QueueBenchmark/QueueBenchmark.cpp
+ *         Mythforge/Source/ConcurrentQueues.cpp -pthread [-fsanitize=thread -g]
+ */
+
+#include "pch.h"
+#include "ConcurrentQueues.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr size_t QueueCapacity = 1024;
+
+    /// Referencia: el mismo anillo acotado con un mutex alrededor.
+    template<typename T>
+    class MutexQueue {
+    public:
+        explicit MutexQueue(size_t capacity) : items(capacity) {}
+
+        bool TryPush(const T& value)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (count == items.size()) return false;
+            items[(head + count) % items.size()] = value;
+            count++;
+            return true;
+        }
+
+        bool TryPop(T& value)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (count == 0) return false;
+            value = items[head];
+            head = (head + 1) % items.size();
+            count--;
+            return true;
+        }
+
+    private:
+        std::mutex     mutex;
+        std::vector<T> items;
+        size_t         head = 0;
+        size_t         count = 0;
+    };
+
+    /// Elemento de prueba: productor en los 16 bits altos y número de secuencia en el resto.
+    uint64_t Encode(uint32_t producer, uint64_t sequence)
+    {
+        return (static_cast<uint64_t>(producer) << 48) | sequence;
+    }
+
+    /**
+     * @brief Producers hilos meten ops elementos cada uno y consumers hilos los sacan.
+     * @param check Si no es nulo, se llama en el consumidor con cada elemento sacado.
+     * @return Segundos desde que empiezan todos los hilos hasta que se saca el último elemento.
+     */
+    template<typename Queue, typename Check>
+    double RunProducersConsumers(Queue& queue, uint32_t producers, uint32_t consumers, uint64_t ops, Check&& check)
+    {
+        std::atomic<uint32_t> ready{ 0 };
+        std::atomic<bool> go{ false };
+        std::atomic<uint64_t> remaining{ producers * ops };
+        std::vector<std::thread> threads;
+
+        auto waitStart = [&]() {
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+        };
+
+        for (uint32_t p = 0; p < producers; p++)
+        {
+            threads.emplace_back([&, p]() {
+                waitStart();
+                for (uint64_t i = 0; i < ops; i++)
+                {
+                    while (!queue.TryPush(Encode(p, i))) std::this_thread::yield();
+                }
+            });
+        }
+        for (uint32_t c = 0; c < consumers; c++)
+        {
+            threads.emplace_back([&, c]() {
+                waitStart();
+                uint64_t value;
+                while (remaining.load(std::memory_order_relaxed) > 0)
+                {
+                    if (queue.TryPop(value))
+                    {
+                        check(c, value);
+                        remaining.fetch_sub(1, std::memory_order_relaxed);
+                    }
+                    else
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+
+        while (ready.load() != producers + consumers) std::this_thread::yield();
+        auto start = std::chrono::steady_clock::now();
+        go.store(true, std::memory_order_release);
+        for (std::thread& thread : threads) thread.join();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /// Un solo hilo que mete y saca alternando.
+    template<typename Queue>
+    double RunSingleThread(Queue& queue, uint64_t ops)
+    {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t value;
+        for (uint64_t i = 0; i < ops; i++)
+        {
+            queue.TryPush(i);
+            queue.TryPop(value);
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /**
+     * @class OrderCheck
+     * @brief Comprueba que cada consumidor ve los elementos de cada productor en orden y que salen todos.
+     */
+    class OrderCheck {
+    public:
+        OrderCheck(uint32_t producers, uint32_t consumers, uint64_t ops)
+            : producers(producers), ops(ops), last(static_cast<size_t>(producers) * consumers, -1), counts(producers)
+        {
+        }
+
+        void operator()(uint32_t consumer, uint64_t value)
+        {
+            uint32_t producer = static_cast<uint32_t>(value >> 48);
+            int64_t sequence = static_cast<int64_t>(value & ((uint64_t(1) << 48) - 1));
+            if (producer >= producers || sequence >= static_cast<int64_t>(ops))
+            {
+                errors.fetch_add(1);
+                return;
+            }
+            int64_t& previous = last[static_cast<size_t>(consumer) * producers + producer];
+            if (sequence <= previous) errors.fetch_add(1);
+            previous = sequence;
+            counts[producer].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        bool Passed() const
+        {
+            if (errors.load() != 0) return false;
+            for (const std::atomic<uint64_t>& count : counts)
+            {
+                if (count.load() != ops) return false;
+            }
+            return true;
+        }
+
+    private:
+        uint32_t                           producers;
+        uint64_t                           ops;
+        std::vector<int64_t>               last;    ///< Última secuencia vista por consumidor y productor; solo la escribe su consumidor
+        std::vector<std::atomic<uint64_t>> counts;
+        std::atomic<uint64_t>              errors{ 0 };
+    };
+
+    struct TestNode : MpscNode {
+        uint64_t value = 0;
+    };
+
+    /// MpscQueue con nodos preasignados: cada productor encola los suyos y el consumidor los comprueba.
+    double RunMpsc(uint32_t producers, uint64_t ops, OrderCheck* check)
+    {
+        MpscQueue queue;
+        std::vector<std::unique_ptr<TestNode[]>> nodes;
+        for (uint32_t p = 0; p < producers; p++)
+        {
+            nodes.emplace_back(new TestNode[ops]);
+        }
+
+        std::atomic<bool> go{ false };
+        std::vector<std::thread> threads;
+        for (uint32_t p = 0; p < producers; p++)
+        {
+            threads.emplace_back([&, p]() {
+                while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+                for (uint64_t i = 0; i < ops; i++)
+                {
+                    nodes[p][i].value = Encode(p, i);
+                    queue.Push(&nodes[p][i]);
+                }
+            });
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        go.store(true, std::memory_order_release);
+        uint64_t remaining = producers * ops;
+        while (remaining > 0)
+        {
+            if (MpscNode* node = queue.Pop())
+            {
+                if (check) (*check)(0, static_cast<TestNode*>(node)->value);
+                remaining--;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (std::thread& thread : threads) thread.join();
+        return seconds;
+    }
+
+    /// Pasa elementos de uno en uno por un SpscRing durmiendo en EventCount en ambos sentidos; un aviso perdido lo cuelga.
+    bool EventCountPingPong(uint64_t rounds)
+    {
+        SpscRing<uint64_t> ping(2);
+        SpscRing<uint64_t> pong(2);
+        EventCount pingEvent;
+        EventCount pongEvent;
+
+        auto pop = [](SpscRing<uint64_t>& ring, EventCount& event) {
+            uint64_t value;
+            for (;;)
+            {
+                if (ring.TryPop(value)) return value;
+                uint64_t key = event.PrepareWait();
+                if (ring.TryPop(value))
+                {
+                    event.CancelWait();
+                    return value;
+                }
+                event.Wait(key);
+            }
+        };
+
+        std::thread echo([&]() {
+            for (uint64_t i = 0; i < rounds; i++)
+            {
+                uint64_t value = pop(ping, pingEvent);
+                pong.TryPush(value + 1);
+                pongEvent.NotifyOne();
+            }
+        });
+
+        bool passed = true;
+        for (uint64_t i = 0; i < rounds; i++)
+        {
+            ping.TryPush(i);
+            pingEvent.NotifyOne();
+            passed = pop(pong, pongEvent) == i + 1 && passed;
+        }
+        echo.join();
+        return passed;
+    }
+
+    bool Report(const char* name, bool passed)
+    {
+        std::cout << name << ": " << (passed ? "ok" : "FALLO") << '\n';
+        return passed;
+    }
+
+    int Stress(uint64_t ops)
+    {
+        bool passed = true;
+        {
+            SpscRing<uint64_t> queue(64);
+            OrderCheck check(1, 1, ops);
+            RunProducersConsumers(queue, 1, 1, ops, check);
+            passed = Report("SpscRing 1x1", check.Passed()) && passed;
+        }
+        const uint32_t shapes[][2] = { { 1, 4 }, { 4, 1 }, { 4, 4 }, { 8, 8 } };
+        for (const auto& shape : shapes)
+        {
+            MpmcQueue<uint64_t> queue(64);
+            OrderCheck check(shape[0], shape[1], ops);
+            RunProducersConsumers(queue, shape[0], shape[1], ops, check);
+            std::string name = "MpmcQueue " + std::to_string(shape[0]) + "x" + std::to_string(shape[1]);
+            passed = Report(name.c_str(), check.Passed()) && passed;
+        }
+        for (uint32_t producers : { 1u, 4u, 8u })
+        {
+            OrderCheck check(producers, 1, ops);
+            RunMpsc(producers, ops, &check);
+            std::string name = "MpscQueue " + std::to_string(producers) + "x1";
+            passed = Report(name.c_str(), check.Passed()) && passed;
+        }
+        passed = Report("EventCount", EventCountPingPong(ops / 10 + 1)) && passed;
+        return passed ? 0 : 1;
+    }
+
+    int Usage()
+    {
+        std::cerr << "Uso: QueueBenchmark [--stress] [--threads 1,2,4,...] [--ops N]\n";
+        return 2;
+    }
+
+    void WriteRow(const char* queue, uint32_t threads, uint64_t operations, double seconds)
+    {
+        std::cout << queue << ',' << threads << ',' << operations << ',' << operations / seconds << '\n';
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool stress = false;
+    uint64_t ops = 200000;
+    std::vector<uint32_t> threadCounts = { 1, 2, 4, 8, 16, 32, 64 };
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--stress") == 0)
+        {
+            stress = true;
+        }
+        else if (strcmp(argv[i], "--ops") == 0 && i + 1 < argc)
+        {
+            ops = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threadCounts.clear();
+            for (char* token = strtok(argv[++i], ","); token; token = strtok(nullptr, ","))
+            {
+                threadCounts.push_back((std::max)(1u, static_cast<uint32_t>(strtoul(token, nullptr, 10))));
+            }
+        }
+        else
+        {
+            return Usage();
+        }
+    }
+    if (ops == 0 || threadCounts.empty())
+    {
+        return Usage();
+    }
+
+    if (stress)
+    {
+        return Stress(ops);
+    }
+
+    // ops es el total de elementos de cada medida, repartido entre los productores.
+    std::cout << "queue,threads,operations,opsPerSec\n";
+    auto ignore = [](uint32_t, uint64_t) {};
+    for (uint32_t threads : threadCounts)
+    {
+        if (threads == 1)
+        {
+            MpmcQueue<uint64_t> mpmc(QueueCapacity);
+            WriteRow("MpmcQueue", 1, ops * 2, RunSingleThread(mpmc, ops));
+            MutexQueue<uint64_t> locked(QueueCapacity);
+            WriteRow("MutexQueue", 1, ops * 2, RunSingleThread(locked, ops));
+            continue;
+        }
+
+        uint32_t producers = threads / 2;
+        uint32_t consumers = threads - producers;
+        uint64_t perProducer = (std::max<uint64_t>)(1, ops / producers);
+        uint64_t operations = perProducer * producers * 2;
+
+        if (threads == 2)
+        {
+            SpscRing<uint64_t> spsc(QueueCapacity);
+            WriteRow("SpscRing", 2, operations, RunProducersConsumers(spsc, 1, 1, perProducer, ignore));
+        }
+        MpmcQueue<uint64_t> mpmc(QueueCapacity);
+        WriteRow("MpmcQueue", threads, operations, RunProducersConsumers(mpmc, producers, consumers, perProducer, ignore));
+        MutexQueue<uint64_t> locked(QueueCapacity);
+        WriteRow("MutexQueue", threads, operations, RunProducersConsumers(locked, producers, consumers, perProducer, ignore));
+
+        // MpscQueue: todos menos uno producen y uno consume.
+        uint64_t mpscPerProducer = (std::max<uint64_t>)(1, ops / (threads - 1));
+        WriteRow("MpscQueue", threads, mpscPerProducer * (threads - 1) * 2, RunMpsc(threads - 1, mpscPerProducer, nullptr));
+    }
+    return 0;
+}
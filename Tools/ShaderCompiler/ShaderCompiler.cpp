@@ -0,0 +1,706 @@
+/**
+ * @file ShaderCompiler.cpp
+ * @brief Compila los shaders de Mythforge con DXC, con permutaciones y una caché por contenido.
+ *
+ * Uso: ShaderCompiler [--shaders carpeta] [--out carpeta] [--cache carpeta] [--dxc ruta]
+ *                     [--model 6_1] [--threads N] [--include carpeta]... [--force]
+ *
+ * Recorre VertexShaders y PixelShaders dentro de --shaders (por defecto Mythforge/Shaders), igual
+ * que el paso FxCompile del proyecto: la carpeta decide la etapa y el punto de entrada es main. Un
+ * shader declara sus ejes de permutación con un #define marcado con axis y los valores que toma;
+ * el valor del #define es el de la permutación por defecto:
+ *
+ *     #ifndef NUM_TEXTURES
+ *     #define NUM_TEXTURES 2 // axis: 1 2
+ *     #endif
+ *
+ * Se compila el producto de todos los ejes. La permutación por defecto se escribe como Nombre.cso,
+ * que es la que carga el motor, y las demás como Nombre.EJE_valor.cso, con un eje tras otro. Junto
+ * a cada .cso va un .json con la reflexión que DXC deja en su listado (-Fc): las firmas de entrada
+ * y de salida y los enlaces de recursos. La salida (por defecto Shaders) tiene la misma estructura
+ * que la carpeta Shaders del paquete de la app.
+ *
+ * Antes de nada escribe en Constants, dentro de --shaders, la declaración de HLSL de cada constant
+ * buffer de Source/ShaderConstants.h, que los shaders incluyen. La herramienta se compila con esa
+ * cabecera, así que un cambio en un buffer llega a los shaders en la siguiente compilación y, como
+ * el .hlsli entra en el hash de quien lo incluye, recompila solo esos.
+ *
+ * Cada permutación se identifica por un hash del fuente, de todos los #include que alcanza, de sus
+ * defines, del perfil y de la versión de DXC. Si el hash ya está en la caché (por defecto .cache
+ * dentro de la salida) se copia sin compilar; si no, se compila en el JobSystem, una llamada a DXC
+ * por núcleo. Tras cambiar una línea solo se recompilan las permutaciones del fichero cambiado y de
+ * los que lo incluyen. --force ignora la caché. Los ficheros de salida que no cambian no se
+ * reescriben, para no disparar el despliegue de los que dependen de su fecha.
+ *
+ * Se escribe en CSV una línea por permutación con su estado (cached, compiled o failed) y lo que
+ * tardó; los errores de DXC van a la salida de errores y la herramienta devuelve 1. DXC existe para
+ * Windows y para Linux y aquí solo se lanza como proceso, así que compila en cualquier plataforma:
+ *
+ *     g++ -std=c++17 -O2 -I Tools/ShaderCompiler -I Mythforge/Source Tools/ShaderCompiler/ShaderCompiler.cpp
+ *         Mythforge/Source/JobSystem.cpp Mythforge/Source/AllocationTracker.cpp
+ *         Mythforge/Source/Profiler.cpp -pthread
+ */
+
+#include "pch.h"
+#include "JobSystem.h"
+#include "ShaderConstants.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <system_error>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+namespace
+{
+    namespace fs = std::filesystem;
+    using Clock = std::chrono::steady_clock;
+
+    constexpr uint64_t FnvOffset = 14695981039346656037ull;
+
+    uint64_t Hash(uint64_t hash, const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    /// Con el terminador incluido: "ab" + "c" y "a" + "bc" no dan el mismo hash.
+    uint64_t Hash(uint64_t hash, const std::string& text)
+    {
+        return Hash(hash, text.c_str(), text.size() + 1);
+    }
+
+    std::string HexKey(uint64_t key)
+    {
+        char text[17];
+        snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(key));
+        return text;
+    }
+
+    bool ReadFile(const fs::path& path, std::string& contents)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return false;
+        std::ostringstream stream;
+        stream << file.rdbuf();
+        contents = stream.str();
+        return true;
+    }
+
+    /// Solo escribe si el contenido cambia; devuelve false si no se pudo escribir.
+    bool WriteIfChanged(const fs::path& path, const std::string& contents)
+    {
+        std::string current;
+        if (ReadFile(path, current) && current == contents) return true;
+
+        std::error_code error;
+        fs::create_directories(path.parent_path(), error);
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        return static_cast<bool>(file);
+    }
+
+    std::string Trim(const std::string& text)
+    {
+        size_t begin = text.find_first_not_of(" \t\r\n");
+        if (begin == std::string::npos) return std::string();
+        size_t end = text.find_last_not_of(" \t\r\n");
+        return text.substr(begin, end - begin + 1);
+    }
+
+    std::vector<std::string> SplitWhitespace(const std::string& text)
+    {
+        std::vector<std::string> tokens;
+        std::istringstream stream(text);
+        std::string token;
+        while (stream >> token)
+        {
+            tokens.push_back(token);
+        }
+        return tokens;
+    }
+
+    std::vector<std::string> SplitLines(const std::string& text)
+    {
+        std::vector<std::string> lines;
+        std::istringstream stream(text);
+        std::string line;
+        while (std::getline(stream, line))
+        {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    /// Entre comillas para la línea de órdenes; las rutas de los shaders no llevan comillas.
+    std::string Quote(const std::string& text)
+    {
+        return "\"" + text + "\"";
+    }
+
+    /// Ejecuta la orden y devuelve su código de salida. En Windows, cmd /c quita un par de comillas exteriores.
+    int RunCommand(const std::string& command)
+    {
+#ifdef _WIN32
+        return std::system(("\"" + command + "\"").c_str());
+#else
+        return std::system(command.c_str());
+#endif
+    }
+
+    /// Salida estándar de la orden, o vacía si no se pudo lanzar.
+    std::string CaptureOutput(const std::string& command)
+    {
+        std::string output;
+#ifdef _WIN32
+        FILE* pipe = popen(("\"" + command + "\"").c_str(), "r");
+#else
+        FILE* pipe = popen(command.c_str(), "r");
+#endif
+        if (!pipe) return output;
+        char buffer[256];
+        while (fgets(buffer, sizeof(buffer), pipe))
+        {
+            output += buffer;
+        }
+        if (pclose(pipe) != 0) output.clear();
+        return output;
+    }
+
+    struct Axis {
+        std::string              name;
+        std::string              defaultValue;
+        std::vector<std::string> values;
+    };
+
+    struct ShaderSource {
+        fs::path          path;
+        std::string       relativePath;     ///< Respecto a --shaders, con / como separador
+        std::string       stage;            ///< vs o ps
+        std::vector<Axis> axes;
+        uint64_t          contentHash = FnvOffset;  ///< Fuente e includes
+    };
+
+    struct Permutation {
+        const ShaderSource*                              source = nullptr;
+        std::vector<std::pair<std::string, std::string>> defines;
+        fs::path                                         output;   ///< Sin extensión
+        uint64_t                                         key = 0;
+        const char*                                      status = "";
+        double                                           ms = 0.0;
+        std::string                                      log;
+    };
+
+    struct Options {
+        fs::path              shaders = "Mythforge/Shaders";
+        fs::path              out = "Shaders";
+        fs::path              cache;
+        std::string           dxc = "dxc";
+        std::string           model = "6_1";
+        uint32_t              threads = 0;
+        std::vector<fs::path> includes;
+        bool                  force = false;
+    };
+
+    /// Ruta del include entre comillas o ángulos de la línea, o vacía si la línea no es un #include.
+    std::string IncludeName(const std::string& line)
+    {
+        std::string trimmed = Trim(line);
+        if (trimmed.compare(0, 1, "#") != 0) return std::string();
+        std::string directive = Trim(trimmed.substr(1));
+        if (directive.compare(0, 7, "include") != 0) return std::string();
+
+        size_t open = directive.find_first_of("\"<", 7);
+        if (open == std::string::npos) return std::string();
+        size_t close = directive.find(directive[open] == '"' ? '"' : '>', open + 1);
+        if (close == std::string::npos) return std::string();
+        return directive.substr(open + 1, close - open - 1);
+    }
+
+    /**
+     * @brief Añade al hash el fichero y, en orden de aparición, todo lo que incluye.
+     *
+     * Se siguen los #include de todas las ramas de #if: hashear de más solo cuesta alguna
+     * recompilación, y de menos dejaría en la caché un binario viejo.
+     */
+    bool HashWithIncludes(const fs::path& path, const std::vector<fs::path>& includeDirs, std::set<fs::path>& visited, uint64_t& hash, std::string& error)
+    {
+        std::error_code ignored;
+        fs::path canonical = fs::weakly_canonical(path, ignored);
+        if (!visited.insert(canonical).second) return true;
+
+        std::string text;
+        if (!ReadFile(path, text))
+        {
+            error = "No se puede leer " + path.string();
+            return false;
+        }
+        hash = Hash(hash, text);
+
+        for (const std::string& line : SplitLines(text))
+        {
+            std::string name = IncludeName(line);
+            if (name.empty()) continue;
+
+            // Como DXC: primero junto al fichero que incluye y después en las carpetas de -I.
+            std::vector<fs::path> candidates = { path.parent_path() / name };
+            for (const fs::path& directory : includeDirs)
+            {
+                candidates.push_back(directory / name);
+            }
+            auto found = std::find_if(candidates.begin(), candidates.end(), [](const fs::path& candidate) {
+                std::error_code code;
+                return fs::is_regular_file(candidate, code);
+            });
+
+            // El nombre tal cual se escribió, no la ruta: la caché vale para otra copia del repositorio.
+            hash = Hash(hash, name);
+            if (found == candidates.end())
+            {
+                error = path.string() + ": no se encuentra " + name;
+                return false;
+            }
+            if (!HashWithIncludes(*found, includeDirs, visited, hash, error)) return false;
+        }
+        return true;
+    }
+
+    /// Ejes del fuente: #define NOMBRE valor // axis: v1 v2 ...
+    bool ParseAxes(const std::string& text, const std::string& file, std::vector<Axis>& axes, std::string& error)
+    {
+        for (const std::string& line : SplitLines(text))
+        {
+            size_t marker = line.find("// axis:");
+            if (marker == std::string::npos) continue;
+
+            std::vector<std::string> define = SplitWhitespace(line.substr(0, marker));
+            Axis axis;
+            axis.values = SplitWhitespace(line.substr(marker + 8));
+            if (define.size() != 3 || define[0] != "#define" || axis.values.empty())
+            {
+                error = file + ": un eje se escribe #define NOMBRE valor // axis: v1 v2 ...";
+                return false;
+            }
+            axis.name = define[1];
+            axis.defaultValue = define[2];
+            if (std::find(axis.values.begin(), axis.values.end(), axis.defaultValue) == axis.values.end())
+            {
+                error = file + ": el valor por defecto de " + axis.name + " no está entre los del eje";
+                return false;
+            }
+            axes.push_back(axis);
+        }
+        return true;
+    }
+
+    /// Producto de los ejes, empezando por la de los valores por defecto.
+    void ExpandPermutations(const ShaderSource& source, const fs::path& outDir, std::vector<Permutation>& permutations)
+    {
+        std::vector<size_t> choice;
+        size_t count = 1;
+        for (const Axis& axis : source.axes)
+        {
+            choice.push_back(std::find(axis.values.begin(), axis.values.end(), axis.defaultValue) - axis.values.begin());
+            count *= axis.values.size();
+        }
+
+        // Un contador con un dígito por eje que da la vuelta: pasa una vez por cada combinación.
+        for (size_t n = 0; n < count; n++)
+        {
+            Permutation permutation;
+            permutation.source = &source;
+            std::string suffix;
+            for (size_t i = 0; i < source.axes.size(); i++)
+            {
+                const Axis& axis = source.axes[i];
+                const std::string& value = axis.values[choice[i]];
+                permutation.defines.emplace_back(axis.name, value);
+                if (value != axis.defaultValue)
+                {
+                    suffix += "." + axis.name + "_" + value;
+                }
+            }
+            fs::path relative = fs::path(source.relativePath);
+            permutation.output = outDir / relative.parent_path() / (relative.stem().string() + suffix);
+            permutations.push_back(std::move(permutation));
+
+            for (size_t axis = 0; axis < choice.size(); axis++)
+            {
+                if (++choice[axis] < source.axes[axis].values.size()) break;
+                choice[axis] = 0;
+            }
+        }
+    }
+
+    std::string JsonString(const std::string& text)
+    {
+        std::string escaped = "\"";
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                escaped += '\\';
+                escaped += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+            }
+            else
+            {
+                escaped += c;
+            }
+        }
+        return escaped + "\"";
+    }
+
+    /**
+     * @brief Tablas de reflexión del listado de DXC, como arrays JSON de objetos por columna.
+     *
+     * Cada tabla es un título (Input signature:, Output signature:, Resource Bindings:), la fila de
+     * nombres de columna, una fila de guiones y una fila por entrada hasta la primera línea vacía.
+     * Los guiones marcan dónde acaba cada nombre de columna, que puede llevar espacios (HLSL Bind).
+     * Las celdas no, pero pueden pasar del ancho de su columna: se separan por espacios, y una
+     * celda vacía solo puede ser la última (Used).
+     */
+    std::string Reflect(const std::string& listing)
+    {
+        static const std::pair<const char*, const char*> sections[] = {
+            { "Input signature:", "inputSignature" },
+            { "Output signature:", "outputSignature" },
+            { "Resource Bindings:", "resourceBindings" },
+        };
+
+        std::ostringstream json;
+        std::vector<std::string> lines = SplitLines(listing);
+        bool firstSection = true;
+        for (const auto& section : sections)
+        {
+            json << (firstSection ? "" : ",\n") << "  " << JsonString(section.second) << ": [";
+            firstSection = false;
+
+            size_t line = 0;
+            while (line < lines.size() && Trim(lines[line]) != std::string("; ") + section.first)
+            {
+                line++;
+            }
+
+            std::string header;
+            std::vector<std::string> columns;
+            bool firstRow = true;
+            for (line++; line < lines.size(); line++)
+            {
+                if (lines[line].compare(0, 1, ";") != 0) break;
+                std::string content = Trim(lines[line].substr(1));
+                if (content.empty())
+                {
+                    if (header.empty()) continue;
+                    break;
+                }
+                if (header.empty())
+                {
+                    header = lines[line];
+                    continue;
+                }
+                if (columns.empty() && content[0] == '-')
+                {
+                    // Desde detrás del ; del comentario.
+                    const std::string& dashes = lines[line];
+                    size_t previousEnd = 1;
+                    for (size_t begin = dashes.find('-'); begin != std::string::npos; begin = dashes.find('-', previousEnd))
+                    {
+                        size_t end = (std::min)(dashes.find(' ', begin), dashes.size());
+                        columns.push_back(Trim(previousEnd < header.size() ? header.substr(previousEnd, end - previousEnd) : std::string()));
+                        previousEnd = end;
+                    }
+                    continue;
+                }
+                if (columns.empty() || content == "no parameters") continue;
+
+                std::vector<std::string> cells = SplitWhitespace(content);
+                json << (firstRow ? "\n" : ",\n") << "    {";
+                firstRow = false;
+                for (size_t column = 0; column < columns.size(); column++)
+                {
+                    json << (column ? ", " : " ") << JsonString(columns[column]) << ": "
+                        << JsonString(column < cells.size() ? cells[column] : std::string());
+                }
+                json << " }";
+            }
+            json << (firstRow ? "]" : "\n  ]");
+        }
+        return json.str();
+    }
+
+    std::string ReflectionJson(const Permutation& permutation, const std::string& profile, const std::string& listing)
+    {
+        std::ostringstream json;
+        json << "{\n  \"source\": " << JsonString(permutation.source->relativePath)
+            << ",\n  \"profile\": " << JsonString(profile)
+            << ",\n  \"key\": " << JsonString(HexKey(permutation.key))
+            << ",\n  \"defines\": {";
+        for (size_t i = 0; i < permutation.defines.size(); i++)
+        {
+            json << (i ? ", " : " ") << JsonString(permutation.defines[i].first) << ": " << JsonString(permutation.defines[i].second);
+        }
+        json << (permutation.defines.empty() ? "}" : " }") << ",\n" << Reflect(listing) << "\n}\n";
+        return json.str();
+    }
+
+    std::string Profile(const ShaderSource& source, const Options& options)
+    {
+        return source.stage + "_" + options.model;
+    }
+
+    /// Compila una permutación en la caché si no estaba y copia el .cso y el .json a la salida.
+    void Build(Permutation& permutation, const Options& options)
+    {
+        Clock::time_point start = Clock::now();
+        fs::path cached = options.cache / HexKey(permutation.key);
+        fs::path cachedShader = cached.string() + ".cso";
+        fs::path cachedReflection = cached.string() + ".json";
+        std::string profile = Profile(*permutation.source, options);
+
+        std::string shader;
+        std::string reflection;
+        std::error_code error;
+        if (!options.force && ReadFile(cachedShader, shader) && ReadFile(cachedReflection, reflection))
+        {
+            permutation.status = "cached";
+        }
+        else
+        {
+            // Se compila a nombres temporales y se renombra al final: una compilación cortada no deja nada en la caché.
+            fs::path temporary = cached.string() + ".tmp";
+            std::string command = Quote(options.dxc) + " -nologo -T " + profile + " -E main";
+            for (const auto& define : permutation.defines)
+            {
+                command += " -D " + define.first + "=" + define.second;
+            }
+            for (const fs::path& directory : options.includes)
+            {
+                command += " -I " + Quote(directory.string());
+            }
+            command += " -Fo " + Quote(temporary.string() + ".cso") + " -Fc " + Quote(temporary.string() + ".lst") + " "
+                + Quote(permutation.source->path.string()) + " > " + Quote(temporary.string() + ".log") + " 2>&1";
+
+            int exitCode = RunCommand(command);
+            std::string listing;
+            ReadFile(temporary.string() + ".log", permutation.log);
+            if (exitCode != 0 || !ReadFile(temporary.string() + ".cso", shader) || !ReadFile(temporary.string() + ".lst", listing))
+            {
+                permutation.status = "failed";
+                if (permutation.log.empty()) permutation.log = "No se pudo lanzar: " + command + "\n";
+            }
+            else
+            {
+                reflection = ReflectionJson(permutation, profile, listing);
+                WriteIfChanged(cachedReflection, reflection);
+                fs::rename(temporary.string() + ".cso", cachedShader, error);
+                permutation.status = error ? "failed" : "compiled";
+                if (error) permutation.log = "No se pudo guardar " + cachedShader.string() + ": " + error.message() + "\n";
+            }
+            fs::remove(temporary.string() + ".cso", error);
+            fs::remove(temporary.string() + ".lst", error);
+            fs::remove(temporary.string() + ".log", error);
+        }
+
+        if (strcmp(permutation.status, "failed") != 0)
+        {
+            if (!WriteIfChanged(permutation.output.string() + ".cso", shader) || !WriteIfChanged(permutation.output.string() + ".json", reflection))
+            {
+                permutation.status = "failed";
+                permutation.log = "No se pudo escribir " + permutation.output.string() + "\n";
+            }
+        }
+        permutation.ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    int Usage()
+    {
+        std::cerr << "Uso: ShaderCompiler [--shaders carpeta] [--out carpeta] [--cache carpeta] [--dxc ruta]\n"
+                     "                    [--model 6_1] [--threads N] [--include carpeta]... [--force]\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--shaders") == 0 && i + 1 < argc)
+        {
+            options.shaders = argv[++i];
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+        {
+            options.out = argv[++i];
+        }
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+        {
+            options.cache = argv[++i];
+        }
+        else if (strcmp(argv[i], "--dxc") == 0 && i + 1 < argc)
+        {
+            options.dxc = argv[++i];
+        }
+        else if (strcmp(argv[i], "--model") == 0 && i + 1 < argc)
+        {
+            options.model = argv[++i];
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            options.threads = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--include") == 0 && i + 1 < argc)
+        {
+            options.includes.push_back(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--force") == 0)
+        {
+            options.force = true;
+        }
+        else
+        {
+            return Usage();
+        }
+    }
+    if (options.cache.empty())
+    {
+        options.cache = options.out / ".cache";
+    }
+
+    Clock::time_point start = Clock::now();
+
+    // La versión entra en todas las claves: otro DXC invalida la caché entera.
+    std::string version = CaptureOutput(Quote(options.dxc) + " --version");
+    if (version.empty())
+    {
+        std::cerr << "No se puede ejecutar " << options.dxc << " --version\n";
+        return 1;
+    }
+
+    for (const ShaderConstants::GeneratedInclude& include : ShaderConstants::Includes())
+    {
+        fs::path path = options.shaders / "Constants" / include.fileName;
+        if (!WriteIfChanged(path, include.text))
+        {
+            std::cerr << "No se puede escribir " << path.string() << '\n';
+            return 1;
+        }
+    }
+
+    static const std::pair<const char*, const char*> stages[] = {
+        { "VertexShaders", "vs" },
+        { "PixelShaders", "ps" },
+    };
+
+    std::vector<ShaderSource> sources;
+    for (const auto& stage : stages)
+    {
+        std::error_code error;
+        fs::path directory = options.shaders / stage.first;
+        std::vector<fs::path> files;
+        for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+        {
+            if (it->path().extension() == ".hlsl") files.push_back(it->path());
+        }
+        // En orden de nombre: el CSV y las claves no dependen del orden del sistema de ficheros.
+        std::sort(files.begin(), files.end());
+        for (const fs::path& file : files)
+        {
+            ShaderSource source;
+            source.path = file;
+            source.relativePath = (fs::path(stage.first) / file.filename()).generic_string();
+            source.stage = stage.second;
+
+            std::string text;
+            std::string failure;
+            std::set<fs::path> visited;
+            if (!ReadFile(file, text) || !ParseAxes(text, source.relativePath, source.axes, failure) ||
+                !HashWithIncludes(file, options.includes, visited, source.contentHash, failure))
+            {
+                std::cerr << (failure.empty() ? "No se puede leer " + file.string() : failure) << '\n';
+                return 1;
+            }
+            sources.push_back(std::move(source));
+        }
+    }
+    if (sources.empty())
+    {
+        std::cerr << "No hay shaders en " << options.shaders.string() << '\n';
+        return 1;
+    }
+
+    std::vector<Permutation> permutations;
+    for (const ShaderSource& source : sources)
+    {
+        ExpandPermutations(source, options.out, permutations);
+    }
+    for (Permutation& permutation : permutations)
+    {
+        uint64_t key = Hash(FnvOffset, version);
+        key = Hash(key, Profile(*permutation.source, options));
+        key = Hash(key, &permutation.source->contentHash, sizeof(permutation.source->contentHash));
+        for (const auto& define : permutation.defines)
+        {
+            key = Hash(Hash(key, define.first), define.second);
+        }
+        permutation.key = key;
+    }
+
+    std::error_code error;
+    fs::create_directories(options.cache, error);
+
+    // Cada llamada a DXC ocupa un hilo mientras espera al proceso; el hilo que llama también compila.
+    JobSystem jobSystem(options.threads);
+    jobSystem.ParallelFor(static_cast<uint32_t>(permutations.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            Build(permutations[i], options);
+        }
+    });
+
+    uint32_t compiled = 0;
+    uint32_t failed = 0;
+    std::cout << "source,permutation,profile,key,status,ms\n";
+    for (const Permutation& permutation : permutations)
+    {
+        std::cout << permutation.source->relativePath << ',' << permutation.output.filename().string() << ','
+            << Profile(*permutation.source, options) << ',' << HexKey(permutation.key) << ','
+            << permutation.status << ',' << permutation.ms << '\n';
+        if (strcmp(permutation.status, "failed") == 0)
+        {
+            std::cerr << permutation.source->relativePath << " (" << permutation.output.filename().string() << "):\n" << permutation.log;
+            failed++;
+        }
+        else if (strcmp(permutation.status, "compiled") == 0)
+        {
+            compiled++;
+        }
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::cerr << permutations.size() << " permutaciones: " << compiled << " compiladas, " << failed << " con error, "
+        << permutations.size() - compiled - failed << " de la caché en " << ms << " ms con " << jobSystem.WorkerCount() + 1 << " hilos\n";
+    return failed > 0 ? 1 : 0;
+}
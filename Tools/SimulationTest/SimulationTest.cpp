@@ -0,0 +1,263 @@
+﻿/**
+ * @file SimulationTest.cpp
+ * @brief Prueba el paso fijo y la interpolación de Simulation con intervalos de fotograma conocidos.
+ *
+ * Uso: SimulationTest [--entities N]
+ *
+ * La simulación avanza a 60 pasos por segundo con Simulation::Advance, sin su hilo, sobre un World
+ * de N entidades (por defecto 64) con SpinAnimation. Cada secuencia simula dos segundos de
+ * fotogramas de duración fija: 1/60 s, 1/120 s, 1/30 s, 1/60 s más 0,2 ms, y 0,5 s, que StepTimer
+ * recorta a 0,1 s. Se escribe en CSV, por secuencia, los fotogramas, los pasos, las instantáneas
+ * publicadas y los fotogramas retenidos. Se comprueba:
+ *
+ * - steps: cada secuencia da los pasos que caben en su tiempo simulado: 120, salvo la de 0,5 s,
+ *   que da 6 por fotograma; la de 0,2 ms de más también 120, porque StepTimer la ajusta al paso.
+ * - published: se publica una instantánea por fotograma que avanza, así que al recuperar varios
+ *   pasos de golpe (1/30 s, 0,5 s) hay menos instantáneas que pasos.
+ * - alpha: Interpolate, un paso por detrás del instante pedido, interpola entre las dos últimas
+ *   instantáneas con alpha = (now - paso - anterior) / (actual - anterior), recortado a [0, 1], y
+ *   las rotaciones son la mezcla de las de esos dos pasos.
+ * - held: si se pide un instante posterior a la última instantánea más un paso, alpha es 1 y el
+ *   fotograma cuenta como retenido.
+ *
+ * Devuelve 1 si algo falla. Necesita DirectXMath; véase CullingBenchmark:
+ *
+ *     g++ -std=c++17 -O2 -isystem "$DIRECTXMATH/Inc" -isystem "$DIRECTX_HEADERS/include/wsl/stubs"
+ *         -I Tools/SimulationTest -I Mythforge/Source Tools/SimulationTest/SimulationTest.cpp
+ *         Mythforge/Source/Simulation.cpp Mythforge/Source/Scene.cpp Mythforge/Source/Entities.cpp
+ *         Mythforge/Source/Culling.cpp Mythforge/Source/Bvh.cpp Mythforge/Source/Occlusion.cpp
+ *         Mythforge/Source/VectorMath.cpp Mythforge/Source/VectorStreams.cpp Mythforge/Source/DrawQueue.cpp
+ *         Mythforge/Source/FrameArena.cpp Mythforge/Source/FrameStats.cpp Mythforge/Source/JobSystem.cpp
+ *         Mythforge/Source/AllocationTracker.cpp Mythforge/Source/Profiler.cpp -pthread
+ */
+
+#include "pch.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "Simulation.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    constexpr double StepSeconds = 1.0 / 60.0;
+    constexpr uint64_t TicksPerMicrosecond = DX::StepTimer::TicksPerSecond / 1000000;
+
+    struct Sequence {
+        const char* name;
+        uint64_t    frameTicks;
+        uint32_t    frames;
+        uint64_t    expectedSteps;
+        uint64_t    expectedPublished;
+    };
+
+    /**
+     * @struct Model
+     * @brief Cuentas de StepTimer en modo fijo hechas a mano: ajuste al paso, recorte y resto.
+     */
+    struct Model {
+        uint64_t stepTicks = DX::StepTimer::SecondsToTicks(StepSeconds);
+        uint64_t leftOver = 0;
+        uint64_t steps = 0;
+        uint64_t published = 0;
+        int64_t  previousTime = 0;
+        int64_t  currentTime = 0;
+        uint64_t previousTick = 0;
+        uint64_t currentTick = 0;
+
+        void Advance(int64_t now, uint64_t ticks)
+        {
+            ticks = (std::min)(ticks, DX::StepTimer::TicksPerSecond / 10);
+            if (std::llabs(static_cast<long long>(ticks) - static_cast<long long>(stepTicks)) < static_cast<long long>(DX::StepTimer::TicksPerSecond / 4000))
+            {
+                ticks = stepTicks;
+            }
+            leftOver += ticks;
+            uint64_t count = leftOver / stepTicks;
+            leftOver %= stepTicks;
+            if (count == 0) return;
+
+            steps += count;
+            published++;
+            previousTime = currentTime;
+            previousTick = currentTick;
+            currentTime = now - static_cast<int64_t>(leftOver / TicksPerMicrosecond);
+            currentTick = steps;
+        }
+
+        float Alpha(int64_t now) const
+        {
+            int64_t renderTime = now - static_cast<int64_t>(StepSeconds * 1000000.0);
+            double alpha = static_cast<double>(renderTime - previousTime) / static_cast<double>(currentTime - previousTime);
+            return static_cast<float>((std::min)((std::max)(alpha, 0.0), 1.0));
+        }
+    };
+
+    struct Result {
+        uint64_t steps = 0;
+        uint64_t published = 0;
+        uint64_t heldFrames = 0;
+        bool     alpha = true;
+        bool     held = true;
+    };
+
+    /// Rotación inicial y paso de cada entidad, por índice de entidad.
+    struct Spin {
+        float rotation;
+        float step;
+    };
+
+    std::vector<Spin> ReadSpins(World& world)
+    {
+        std::vector<Spin> spins(world.IndexCapacity());
+        world.ForEachChunk<Transform, SpinAnimation>([&spins](uint32_t count, const Entity* entities, Transform* transforms, SpinAnimation* animations) {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                spins[entities[i].index] = Spin{ transforms[i].yRotation, animations[i].yRotationStep };
+            }
+        });
+        return spins;
+    }
+
+    /// Comprueba un fotograma interpolado en now contra el modelo.
+    bool CheckFrame(Simulation& simulation, const Model& model, const std::vector<Spin>& spins, int64_t now, std::vector<Transform>& transforms)
+    {
+        SimulationFrame frame = simulation.Interpolate(now, transforms);
+        float alpha = model.Alpha(now);
+        if (frame.previousTick != model.previousTick || frame.currentTick != model.currentTick || std::fabs(frame.alpha - alpha) > 1e-5f)
+        {
+            std::cerr << "alpha: en " << now << " se interpoló " << frame.previousTick << '-' << frame.currentTick << " con " << frame.alpha
+                      << ", se esperaba " << model.previousTick << '-' << model.currentTick << " con " << alpha << '\n';
+            return false;
+        }
+
+        for (size_t i = 0; i < spins.size(); i++)
+        {
+            float from = spins[i].rotation + spins[i].step * frame.previousTick;
+            float to = spins[i].rotation + spins[i].step * frame.currentTick;
+            if (std::fabs(transforms[i].yRotation - (from + alpha * (to - from))) > 1e-4f)
+            {
+                std::cerr << "alpha: la entidad " << i << " tiene la rotación " << transforms[i].yRotation << '\n';
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Cada secuencia empieza con un World nuevo, así las rotaciones se quedan en valores pequeños y precisos.
+    Result Run(uint32_t entities, JobSystem& jobs, const Sequence& sequence)
+    {
+        World world;
+        for (uint32_t i = 0; i < entities; i++)
+        {
+            uint32_t variant = i % 64;
+            world.Create(Transform{ XMFLOAT3(static_cast<float>(i), 0.0f, 0.0f), 0.1f * variant }, SpinAnimation{ 0.01f + 0.0005f * variant });
+        }
+
+        std::vector<Spin> spins = ReadSpins(world);
+        Simulation simulation(world, jobs, StepSeconds);
+        std::vector<Transform> transforms;
+
+        // Los instantes empiezan un poco después de la instantánea que publica el constructor.
+        Model model;
+        int64_t now = static_cast<int64_t>(Profiler::TimestampToMicroseconds(Profiler::Now())) + 1000;
+        model.currentTime = now;
+
+        Result result;
+        for (uint32_t frame = 0; frame < sequence.frames; frame++)
+        {
+            now += static_cast<int64_t>(sequence.frameTicks / TicksPerMicrosecond);
+            simulation.Advance(now, sequence.frameTicks);
+            model.Advance(now, sequence.frameTicks);
+
+            // Hasta la segunda publicación la anterior es la del constructor, cuyo instante no se conoce.
+            if (model.published < 2) continue;
+
+            int64_t stepMicroseconds = static_cast<int64_t>(StepSeconds * 1000000.0);
+            for (int64_t offset : { int64_t(0), stepMicroseconds / 3, stepMicroseconds / 2 })
+            {
+                result.alpha = result.alpha && CheckFrame(simulation, model, spins, now + offset, transforms);
+            }
+
+            uint64_t heldBefore = simulation.Stats().heldFrames;
+            SimulationFrame late = simulation.Interpolate(model.currentTime + 2 * stepMicroseconds, transforms);
+            result.held = result.held && late.alpha == 1.0f && simulation.Stats().heldFrames == heldBefore + 1;
+        }
+
+        result.steps = simulation.Stats().steps;
+        result.published = simulation.Stats().published - 1;    // Sin la del constructor
+        result.heldFrames = simulation.Stats().heldFrames;
+        return result;
+    }
+
+    bool Report(const char* name, bool passed)
+    {
+        std::cerr << name << (passed ? ": ok\n" : ": FALLO\n");
+        return passed;
+    }
+
+    int Usage()
+    {
+        std::cerr << "Uso: SimulationTest [--entities N]\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t entities = 64;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--entities") == 0 && i + 1 < argc)
+        {
+            entities = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            return Usage();
+        }
+    }
+    if (entities == 0)
+    {
+        return Usage();
+    }
+
+    JobSystem jobs;
+
+    const uint64_t step = DX::StepTimer::SecondsToTicks(StepSeconds);
+    const Sequence sequences[] = {
+        { "1/60", step, 120, 120, 120 },
+        { "1/120", DX::StepTimer::SecondsToTicks(1.0 / 120.0), 240, 120, 120 },
+        { "1/30", DX::StepTimer::SecondsToTicks(1.0 / 30.0), 60, 120, 60 },
+        { "1/60+0.2ms", step + 2000, 120, 120, 120 },
+        { "0.5", DX::StepTimer::SecondsToTicks(0.5), 4, 24, 4 },
+    };
+
+    bool steps = true;
+    bool published = true;
+    bool alpha = true;
+    bool held = true;
+
+    std::cout << "sequence,frames,steps,published,heldFrames\n";
+    for (const Sequence& sequence : sequences)
+    {
+        Result result = Run(entities, jobs, sequence);
+        std::cout << sequence.name << ',' << sequence.frames << ',' << result.steps << ',' << result.published << ',' << result.heldFrames << '\n';
+
+        steps = steps && result.steps == sequence.expectedSteps;
+        published = published && result.published == sequence.expectedPublished && result.published <= result.steps;
+        alpha = alpha && result.alpha;
+        held = held && result.held;
+    }
+
+    bool passed = true;
+    passed &= Report("steps", steps);
+    passed &= Report("published", published);
+    passed &= Report("alpha", alpha);
+    passed &= Report("held", held);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,498 @@
+﻿/**
+ * @file VectorMathBenchmark.cpp
+ * @brief Comprueba la precisión de VectorMath.h contra una referencia en double y mide cuánto cuesta cada operación.
+ *
+ * Uso: VectorMathBenchmark [--count N] [--repeat N]
+ *
+ * La primera tabla es la batería de precisión: cada operación se aplica a 20 000 entradas al azar
+ * y se compara con la misma cuenta hecha en double a partir de las mismas entradas. El error se
+ * mide relativo a la magnitud de los términos que se suman (1 + la suma de sus valores absolutos),
+ * que es lo que acota el redondeo en float aunque el resultado se cancele. Se escribe el error
+ * máximo y la tolerancia, y si alguna operación la supera devuelve 1.
+ *
+ * La segunda mide N operaciones (por defecto un millón) sobre un conjunto de entradas que cabe en
+ * caché, o sobre arrays de N elementos en los kernels por lotes. Donde tiene sentido se mide
+ * también la misma operación escrita en C++ escalar, como estaría sin la capa SIMD, y su cociente.
+ * Se escribe el mejor tiempo de --repeat repeticiones en nanosegundos por operación.
+ *
+ * Compila en cualquier plataforma; con -DMYTHFORGE_SIMD_SCALAR mide la implementación escalar:
+ *
+ *     g++ -std=c++17 -O2 -msse4.1 -I Tools/VectorMathBenchmark -I Mythforge/Source
+ *         Tools/VectorMathBenchmark/VectorMathBenchmark.cpp Mythforge/Source/VectorMath.cpp
+ */
+
+#include "pch.h"
+#include "VectorMath.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr uint32_t PrecisionSamples = 20000;
+    constexpr uint32_t WorkingSet = 4096;
+
+    volatile float sink;
+
+    struct Double3 { double x, y, z; };
+    struct Double4 { double x, y, z, w; };
+
+    Double3 ToDouble(const Vector3& v) { return { v.x, v.y, v.z }; }
+    Double4 ToDouble(const Quaternion& q) { return { q.x, q.y, q.z, q.w }; }
+
+    double Dot(const Double3& a, const Double3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+    Double3 Cross(const Double3& a, const Double3& b)
+    {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+
+    /// Producto b * a, que aplica primero a, como QuaternionMultiply.
+    Double4 Multiply(const Double4& a, const Double4& b)
+    {
+        return {
+            b.w * a.x + b.x * a.w + b.y * a.z - b.z * a.y,
+            b.w * a.y - b.x * a.z + b.y * a.w + b.z * a.x,
+            b.w * a.z + b.x * a.y - b.y * a.x + b.z * a.w,
+            b.w * a.w - b.x * a.x - b.y * a.y - b.z * a.z };
+    }
+
+    /// q * v * q⁻¹ con cuaterniones en double.
+    Double3 Rotate(const Double3& v, const Double4& q)
+    {
+        Double4 conjugate = { -q.x, -q.y, -q.z, q.w };
+        Double4 rotated = Multiply(Multiply(conjugate, Double4{ v.x, v.y, v.z, 0.0 }), q);
+        return { rotated.x, rotated.y, rotated.z };
+    }
+
+    /// Error de value relativo a magnitude, la suma de los valores absolutos de los términos de la referencia.
+    double Error(double value, double reference, double magnitude = 0.0)
+    {
+        return std::fabs(value - reference) / (1.0 + std::max(magnitude, std::fabs(reference)));
+    }
+
+    double Error(const Vector3& value, const Double3& reference, double magnitude = 0.0)
+    {
+        return std::max({ Error(value.x, reference.x, magnitude), Error(value.y, reference.y, magnitude), Error(value.z, reference.z, magnitude) });
+    }
+
+    double Length(const Double3& v) { return std::sqrt(Dot(v, v)); }
+
+    /// Error de un cuaternión, que representa la misma rotación que su opuesto.
+    double Error(const Quaternion& value, const Double4& reference)
+    {
+        double same = std::max({ Error(value.x, reference.x), Error(value.y, reference.y), Error(value.z, reference.z), Error(value.w, reference.w) });
+        double opposite = std::max({ Error(value.x, -reference.x), Error(value.y, -reference.y), Error(value.z, -reference.z), Error(value.w, -reference.w) });
+        return std::min(same, opposite);
+    }
+
+    /// Entradas al azar compartidas por la batería de precisión y el microbenchmark.
+    struct Inputs {
+        std::mt19937 random{ 30 };
+        std::uniform_real_distribution<float> unit{ -1.0f, 1.0f };
+
+        float Value(float range) { return range * unit(random); }
+        Vector3 Point() { return Vector3(Value(10.0f), Value(10.0f), Value(10.0f)); }
+        Quaternion Rotation() { return QuaternionRotationAxis(Point(), Value(Pi)); }
+
+        /// Rotación, escala entre 0,5 y 2 y traslación: la forma de las matrices de mundo del motor.
+        Matrix4x4 World()
+        {
+            float scale = 1.25f + 0.75f * unit(random);
+            return MatrixMultiply(MatrixMultiply(MatrixScaling(Vector3(scale, scale, scale)), MatrixRotationQuaternion(Rotation())), MatrixTranslation(Point()));
+        }
+
+        Matrix4x4 Any()
+        {
+            Matrix4x4 m;
+            for (Vector4A& row : m.r)
+            {
+                row = Vector4(Value(2.0f), Value(2.0f), Value(2.0f), Value(2.0f));
+            }
+            return m;
+        }
+
+        static constexpr float Pi = 3.14159265f;
+    };
+
+    struct Check {
+        const char* name;
+        double tolerance;
+        double maxError = 0.0;
+    };
+
+    bool RunPrecision()
+    {
+        Inputs inputs;
+        Check dot{ "Dot", 1e-6 };
+        Check cross{ "Cross", 1e-6 };
+        Check normalize{ "Normalize", 1e-6 };
+        Check multiply{ "MatrixMultiply", 1e-6 };
+        Check inverse{ "MatrixInverse", 2e-6 };
+        Check transform{ "TransformPoint", 1e-6 };
+        Check batch{ "TransformPoints", 1e-6 };
+        Check rotation{ "MatrixRotationQuaternion", 2e-6 };
+        Check rotate{ "Rotate", 2e-6 };
+        Check compose{ "QuaternionMultiply", 1e-6 };
+        Check slerp{ "QuaternionSlerp", 2e-6 };
+        Check normalizeBatch{ "NormalizeVectors", 1e-6 };
+
+        std::vector<Vector3> points(PrecisionSamples);
+        std::vector<Vector3> transformed(PrecisionSamples);
+        std::vector<Vector3> normalized(PrecisionSamples);
+        Matrix4x4 batchMatrix = inputs.World();
+        for (Vector3& point : points)
+        {
+            point = inputs.Point();
+        }
+        TransformPoints(batchMatrix, points.data(), transformed.data(), points.size());
+        NormalizeVectors(points.data(), normalized.data(), points.size());
+
+        for (uint32_t i = 0; i < PrecisionSamples; i++)
+        {
+            Vector3 a = inputs.Point();
+            Vector3 b = inputs.Point();
+            Double3 da = ToDouble(a);
+            Double3 db = ToDouble(b);
+
+            double magnitude = std::fabs(da.x * db.x) + std::fabs(da.y * db.y) + std::fabs(da.z * db.z);
+            dot.maxError = std::max(dot.maxError, Error(::Dot(a, b), Dot(da, db), magnitude));
+            cross.maxError = std::max(cross.maxError, Error(::Cross(a, b), Cross(da, db), Length(da) * Length(db)));
+            double length = Length(da);
+            normalize.maxError = std::max(normalize.maxError, Error(::Normalize(a), Double3{ da.x / length, da.y / length, da.z / length }));
+
+            // Producto de matrices y transformación de puntos, con vectores fila como en el motor.
+            Matrix4x4 m = inputs.Any();
+            Matrix4x4 n = inputs.Any();
+            Matrix4x4 product = MatrixMultiply(m, n);
+            for (int row = 0; row < 4; row++)
+            {
+                for (int column = 0; column < 4; column++)
+                {
+                    double expected = 0.0;
+                    double terms = 0.0;
+                    for (int k = 0; k < 4; k++)
+                    {
+                        double term = static_cast<double>((&m.r[row].x)[k]) * (&n.r[k].x)[column];
+                        expected += term;
+                        terms += std::fabs(term);
+                    }
+                    multiply.maxError = std::max(multiply.maxError, Error((&product.r[row].x)[column], expected, terms));
+                }
+            }
+
+            Matrix4x4 world = inputs.World();
+            Matrix4x4 worldInverse = MatrixInverse(world);
+            for (int row = 0; row < 4; row++)
+            {
+                for (int column = 0; column < 4; column++)
+                {
+                    double identity = 0.0;
+                    double terms = 0.0;
+                    for (int k = 0; k < 4; k++)
+                    {
+                        double term = static_cast<double>((&world.r[row].x)[k]) * (&worldInverse.r[k].x)[column];
+                        identity += term;
+                        terms += std::fabs(term);
+                    }
+                    inverse.maxError = std::max(inverse.maxError, Error(identity, row == column ? 1.0 : 0.0, terms));
+                }
+            }
+
+            // Punto transformado en double y la mayor suma de valores absolutos de sus componentes.
+            auto transformError = [](const Vector3& value, const Vector3& p, const Matrix4x4& matrix) {
+                double error = 0.0;
+                for (int column = 0; column < 3; column++)
+                {
+                    double terms[4] = { p.x * static_cast<double>((&matrix.r[0].x)[column]), p.y * static_cast<double>((&matrix.r[1].x)[column]),
+                        p.z * static_cast<double>((&matrix.r[2].x)[column]), (&matrix.r[3].x)[column] };
+                    double expected = terms[0] + terms[1] + terms[2] + terms[3];
+                    double magnitude = std::fabs(terms[0]) + std::fabs(terms[1]) + std::fabs(terms[2]) + std::fabs(terms[3]);
+                    error = std::max(error, Error((&value.x)[column], expected, magnitude));
+                }
+                return error;
+            };
+            transform.maxError = std::max(transform.maxError, transformError(TransformPoint(a, world), a, world));
+            batch.maxError = std::max(batch.maxError, transformError(transformed[i], points[i], batchMatrix));
+
+            Double3 dp = ToDouble(points[i]);
+            double pointLength = Length(dp);
+            normalizeBatch.maxError = std::max(normalizeBatch.maxError, Error(normalized[i], Double3{ dp.x / pointLength, dp.y / pointLength, dp.z / pointLength }));
+
+            // Cuaterniones contra el producto de Hamilton y la rotación q v q⁻¹ en double.
+            Quaternion q = inputs.Rotation();
+            Quaternion r = inputs.Rotation();
+            Double4 dq = ToDouble(q);
+            Double4 dr = ToDouble(r);
+            rotation.maxError = std::max(rotation.maxError, Error(TransformPoint(a, MatrixRotationQuaternion(q)), Rotate(da, dq), length));
+            rotate.maxError = std::max(rotate.maxError, Error(::Rotate(a, q), Rotate(da, dq), length));
+            compose.maxError = std::max(compose.maxError, Error(QuaternionMultiply(q, r), Multiply(dq, dr)));
+
+            float t = 0.5f + 0.5f * inputs.unit(inputs.random);
+            double cosine = dq.x * dr.x + dq.y * dr.y + dq.z * dr.z + dq.w * dr.w;
+            Double4 target = cosine < 0.0 ? Double4{ -dr.x, -dr.y, -dr.z, -dr.w } : dr;
+            cosine = std::fabs(cosine);
+            double weightA = 1.0 - t;
+            double weightB = t;
+            if (cosine < 1.0 - 1e-9)
+            {
+                double angle = std::acos(cosine);
+                weightA = std::sin((1.0 - t) * angle) / std::sin(angle);
+                weightB = std::sin(t * angle) / std::sin(angle);
+            }
+            Double4 expected = { weightA * dq.x + weightB * target.x, weightA * dq.y + weightB * target.y,
+                weightA * dq.z + weightB * target.z, weightA * dq.w + weightB * target.w };
+            double norm = std::sqrt(expected.x * expected.x + expected.y * expected.y + expected.z * expected.z + expected.w * expected.w);
+            slerp.maxError = std::max(slerp.maxError, Error(QuaternionSlerp(q, r, t), Double4{ expected.x / norm, expected.y / norm, expected.z / norm, expected.w / norm }));
+        }
+
+        bool ok = true;
+        std::cout << "check,samples,maxError,tolerance,backend\n";
+        for (const Check& check : { dot, cross, normalize, multiply, inverse, transform, batch, rotation, rotate, compose, slerp, normalizeBatch })
+        {
+            std::cout << check.name << ',' << PrecisionSamples << ',' << check.maxError << ',' << check.tolerance << ',' << Simd::BackendName() << '\n';
+            ok = ok && check.maxError <= check.tolerance;
+        }
+        return ok;
+    }
+
+    // Las mismas operaciones en C++ escalar, como se escribirían sin VectorMath.h.
+
+    float ScalarDot(const Vector3& a, const Vector3& b)
+    {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    Vector3 ScalarCross(const Vector3& a, const Vector3& b)
+    {
+        return Vector3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+    }
+
+    Vector3 ScalarNormalize(const Vector3& v)
+    {
+        float length = std::sqrt(ScalarDot(v, v));
+        return length > 0.0f ? Vector3(v.x / length, v.y / length, v.z / length) : v;
+    }
+
+    Matrix4x4 ScalarMultiply(const Matrix4x4& a, const Matrix4x4& b)
+    {
+        Matrix4x4 result;
+        for (int row = 0; row < 4; row++)
+        {
+            float values[4];
+            for (int column = 0; column < 4; column++)
+            {
+                values[column] = 0.0f;
+                for (int k = 0; k < 4; k++)
+                {
+                    values[column] += (&a.r[row].x)[k] * (&b.r[k].x)[column];
+                }
+            }
+            result.r[row] = Vector4(values[0], values[1], values[2], values[3]);
+        }
+        return result;
+    }
+
+    Vector3 ScalarTransformPoint(const Vector3& p, const Matrix4x4& m)
+    {
+        return Vector3(
+            p.x * m.r[0].x + p.y * m.r[1].x + p.z * m.r[2].x + m.r[3].x,
+            p.x * m.r[0].y + p.y * m.r[1].y + p.z * m.r[2].y + m.r[3].y,
+            p.x * m.r[0].z + p.y * m.r[1].z + p.z * m.r[2].z + m.r[3].z);
+    }
+
+    Quaternion ScalarQuaternionMultiply(const Quaternion& a, const Quaternion& b)
+    {
+        Quaternion q;
+        q.x = b.w * a.x + b.x * a.w + b.y * a.z - b.z * a.y;
+        q.y = b.w * a.y - b.x * a.z + b.y * a.w + b.z * a.x;
+        q.z = b.w * a.z + b.x * a.y - b.y * a.x + b.z * a.w;
+        q.w = b.w * a.w - b.x * a.x - b.y * a.y - b.z * a.z;
+        return q;
+    }
+
+    Vector3 ScalarRotate(const Vector3& v, const Quaternion& q)
+    {
+        Vector3 u(q.x, q.y, q.z);
+        Vector3 t = ScalarCross(u, v);
+        t = Vector3(2.0f * t.x, 2.0f * t.y, 2.0f * t.z);
+        Vector3 c = ScalarCross(u, t);
+        return Vector3(v.x + q.w * t.x + c.x, v.y + q.w * t.y + c.y, v.z + q.w * t.z + c.z);
+    }
+
+    float Sum(const Vector3& v) { return v.x + v.y + v.z; }
+    float Sum(const Quaternion& q) { return q.x + q.y + q.z + q.w; }
+    float Sum(const Matrix4x4& m) { return m.r[0].x + m.r[1].y + m.r[2].z + m.r[3].w; }
+
+    /// Mejor tiempo en nanosegundos por operación de repeat pasadas de run, que hace operations operaciones.
+    template<typename Run>
+    double NanosecondsPerOperation(uint32_t repeat, uint64_t operations, Run&& run)
+    {
+        double best = 0.0;
+        for (uint32_t i = 0; i < repeat; i++)
+        {
+            Clock::time_point start = Clock::now();
+            run();
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            if (i == 0 || seconds < best) best = seconds;
+        }
+        return best * 1e9 / operations;
+    }
+
+    void WriteRow(const char* operation, uint64_t count, double nanoseconds, double scalarNanoseconds = 0.0)
+    {
+        std::cout << operation << ',' << count << ',' << nanoseconds << ',';
+        if (scalarNanoseconds > 0.0)
+        {
+            std::cout << scalarNanoseconds << ',' << scalarNanoseconds / nanoseconds;
+        }
+        else
+        {
+            std::cout << ',';
+        }
+        std::cout << '\n';
+    }
+
+    /// Aplica op a los elementos del conjunto de trabajo hasta sumar count operaciones.
+    template<typename Op>
+    void Repeat(uint64_t count, Op&& op)
+    {
+        float total = 0.0f;
+        for (uint64_t done = 0; done < count; done += WorkingSet)
+        {
+            for (uint32_t i = 0; i < WorkingSet; i++)
+            {
+                total += op(i);
+            }
+        }
+        sink = total;
+    }
+
+    void RunBenchmark(uint32_t count, uint32_t repeat)
+    {
+        Inputs inputs;
+        std::vector<Vector3> a(WorkingSet), b(WorkingSet);
+        std::vector<Matrix4x4> m(WorkingSet), n(WorkingSet);
+        std::vector<Quaternion> q(WorkingSet), r(WorkingSet);
+        for (uint32_t i = 0; i < WorkingSet; i++)
+        {
+            a[i] = inputs.Point();
+            b[i] = inputs.Point();
+            m[i] = inputs.World();
+            n[i] = inputs.World();
+            q[i] = inputs.Rotation();
+            r[i] = inputs.Rotation();
+        }
+        uint64_t operations = (count + WorkingSet - 1) / WorkingSet * static_cast<uint64_t>(WorkingSet);
+
+        auto measure = [&](auto&& op) {
+            return NanosecondsPerOperation(repeat, operations, [&]() { Repeat(operations, op); });
+        };
+
+        std::cout << "operation,count,nsPerOp,scalarNsPerOp,speedup\n";
+        WriteRow("Dot", operations,
+            measure([&](uint32_t i) { return ::Dot(a[i], b[i]); }),
+            measure([&](uint32_t i) { return ScalarDot(a[i], b[i]); }));
+        WriteRow("Cross", operations,
+            measure([&](uint32_t i) { return Sum(::Cross(a[i], b[i])); }),
+            measure([&](uint32_t i) { return Sum(ScalarCross(a[i], b[i])); }));
+        WriteRow("Normalize", operations,
+            measure([&](uint32_t i) { return Sum(::Normalize(a[i])); }),
+            measure([&](uint32_t i) { return Sum(ScalarNormalize(a[i])); }));
+        WriteRow("MatrixMultiply", operations,
+            measure([&](uint32_t i) { return Sum(MatrixMultiply(m[i], n[i])); }),
+            measure([&](uint32_t i) { return Sum(ScalarMultiply(m[i], n[i])); }));
+        WriteRow("MatrixInverse", operations,
+            measure([&](uint32_t i) { return Sum(MatrixInverse(m[i])); }));
+        WriteRow("TransformPoint", operations,
+            measure([&](uint32_t i) { return Sum(TransformPoint(a[i], m[i])); }),
+            measure([&](uint32_t i) { return Sum(ScalarTransformPoint(a[i], m[i])); }));
+        WriteRow("QuaternionMultiply", operations,
+            measure([&](uint32_t i) { return Sum(QuaternionMultiply(q[i], r[i])); }),
+            measure([&](uint32_t i) { return Sum(ScalarQuaternionMultiply(q[i], r[i])); }));
+        WriteRow("Rotate", operations,
+            measure([&](uint32_t i) { return Sum(::Rotate(a[i], q[i])); }),
+            measure([&](uint32_t i) { return Sum(ScalarRotate(a[i], q[i])); }));
+        WriteRow("QuaternionSlerp", operations,
+            measure([&](uint32_t i) { return Sum(QuaternionSlerp(q[i], r[i], 0.3f)); }));
+
+        // Kernels por lotes sobre arrays de count elementos, que ya no caben en caché.
+        std::vector<Vector3> points(count), output(count);
+        std::vector<Vector4A> points4(count), output4(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            points[i] = inputs.Point();
+            points4[i] = Vector4(points[i].x, points[i].y, points[i].z, 1.0f);
+        }
+        Matrix4x4 world = inputs.World();
+        WriteRow("TransformPoints", count,
+            NanosecondsPerOperation(repeat, count, [&]() { TransformPoints(world, points.data(), output.data(), count); }),
+            NanosecondsPerOperation(repeat, count, [&]() {
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    output[i] = ScalarTransformPoint(points[i], world);
+                }
+            }));
+        WriteRow("TransformVectors4", count,
+            NanosecondsPerOperation(repeat, count, [&]() { TransformVectors4(world, points4.data(), output4.data(), count); }));
+        WriteRow("NormalizeVectors", count,
+            NanosecondsPerOperation(repeat, count, [&]() { NormalizeVectors(points.data(), output.data(), count); }),
+            NanosecondsPerOperation(repeat, count, [&]() {
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    output[i] = ScalarNormalize(points[i]);
+                }
+            }));
+        sink = output[count / 2].x + output4[count / 2].y;
+    }
+
+    int Usage()
+    {
+        std::cerr << "Uso: VectorMathBenchmark [--count N] [--repeat N]\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t count = 1000000;
+    uint32_t repeat = 5;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--count") == 0 && i + 1 < argc)
+        {
+            count = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+        {
+            repeat = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            return Usage();
+        }
+    }
+    if (count == 0 || repeat == 0)
+    {
+        return Usage();
+    }
+
+    bool precise = RunPrecision();
+    std::cout << '\n';
+    RunBenchmark(count, repeat);
+
+    if (!precise)
+    {
+        std::cerr << "Alguna operación supera la tolerancia respecto a la referencia en double\n";
+        return 1;
+    }
+    return 0;
+}
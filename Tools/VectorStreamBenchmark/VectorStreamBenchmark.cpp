@@ -0,0 +1,226 @@
+﻿/**
+ * @file VectorStreamBenchmark.cpp
+ * @brief Compara los kernels de VectorStreams.h sobre flujos SoA con los de VectorMath.h sobre arrays AoS de Vector3.
+ *
+ * Uso: VectorStreamBenchmark [--count N] [--repeat N]
+ *
+ * Con N vectores al azar (por defecto un millón) mide cuatro kernels por tres caminos:
+ *
+ * - aos: el array de Vector3, con el kernel por lotes de VectorMath.h donde lo hay y con un
+ *   bucle de Vector3 donde no (ComputeBounds).
+ * - soa: el kernel de VectorStreams.h sobre un Vector3Stream ya rellenado.
+ * - soa+copy: lo mismo contando el Gather desde el array AoS y, si el kernel escribe vectores,
+ *   el Scatter de vuelta; es lo que cuesta si los datos no viven ya en un flujo.
+ *
+ * Además se mide Gather y Scatter solos, con Vector3 seguidos y con las posiciones de vértices
+ * como los de Cube::vertices (posición y coordenadas de textura, 20 bytes por vértice).
+ *
+ * Se escribe en CSV el mejor tiempo de --repeat repeticiones, los nanosegundos por vector y la
+ * aceleración respecto a aos. Al final se comprueba que los dos caminos dan el mismo resultado;
+ * devuelve 1 si no. Compila en cualquier plataforma:
+ *
+ *     g++ -std=c++17 -O2 -mavx2 -mfma -I Tools/VectorStreamBenchmark -I Mythforge/Source
+ *         Tools/VectorStreamBenchmark/VectorStreamBenchmark.cpp Mythforge/Source/VectorMath.cpp
+ *         Mythforge/Source/VectorStreams.cpp
+ */
+
+#include "pch.h"
+#include "VectorMath.h"
+#include "VectorStreams.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    /// La misma disposición que VertexPosTexCoord, sin depender de DirectXMath.
+    struct Vertex {
+        Vector3 position;
+        Vector2 texCoord;
+    };
+
+    /// Mejor tiempo en segundos de repeat llamadas a run; prepare se llama antes de cada una y no cuenta.
+    template<typename Prepare, typename Run>
+    double Best(uint32_t repeat, Prepare&& prepare, Run&& run)
+    {
+        double best = 0.0;
+        for (uint32_t i = 0; i < repeat; i++)
+        {
+            prepare();
+            Clock::time_point start = Clock::now();
+            run();
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            if (i == 0 || seconds < best) best = seconds;
+        }
+        return best;
+    }
+
+    template<typename Run>
+    double Best(uint32_t repeat, Run&& run)
+    {
+        return Best(repeat, []() {}, run);
+    }
+
+    void WriteRow(const char* kernel, const char* path, size_t count, double seconds, double aosSeconds)
+    {
+        std::cout << kernel << ',' << path << ',' << count << ',' << seconds * 1000.0 << ',' << seconds * 1e9 / count << ',';
+        if (aosSeconds > 0.0)
+        {
+            std::cout << aosSeconds / seconds;
+        }
+        std::cout << '\n';
+    }
+
+    /// Mayor diferencia entre dos arrays, relativa a 1 + |esperado|.
+    double MaxError(const std::vector<Vector3>& values, const std::vector<Vector3>& expected)
+    {
+        double error = 0.0;
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                double reference = (&expected[i].x)[axis];
+                error = std::max(error, std::fabs((&values[i].x)[axis] - reference) / (1.0 + std::fabs(reference)));
+            }
+        }
+        return error;
+    }
+
+    int Usage()
+    {
+        std::cerr << "Uso: VectorStreamBenchmark [--count N] [--repeat N]\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t count = 1000000;
+    uint32_t repeat = 5;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--count") == 0 && i + 1 < argc)
+        {
+            count = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+        {
+            repeat = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            return Usage();
+        }
+    }
+    if (count == 0 || repeat == 0)
+    {
+        return Usage();
+    }
+
+    std::mt19937 random(31);
+    std::uniform_real_distribution<float> value(-10.0f, 10.0f);
+    std::vector<Vector3> points(count);
+    std::vector<Vertex> vertices(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        points[i] = Vector3(value(random), value(random), value(random));
+        vertices[i] = Vertex{ points[i], Vector2(0.5f, 0.5f) };
+    }
+    Matrix4x4 world = MatrixMultiply(MatrixMultiply(MatrixScaling(Vector3(2.0f, 2.0f, 2.0f)), MatrixRotationY(0.3f)), MatrixTranslation(Vector3(1.0f, 2.0f, 3.0f)));
+
+    std::vector<Vector3> aosOutput(count);
+    std::vector<Vector3> soaOutput(count);
+    Vector3Stream stream;
+    Vector3Stream streamOutput;
+    stream.Gather(points.data(), count);
+    bool ok = true;
+
+    std::cout << "kernel,path,count,ms,nsPerVector,speedup\n";
+
+    // Copias entre AoS y SoA.
+    double seconds = Best(repeat, [&]() { stream.Gather(points.data(), count); });
+    WriteRow("Gather", "vector3", count, seconds, 0.0);
+    seconds = Best(repeat, [&]() { stream.Gather(&vertices[0].position, sizeof(Vertex), count); });
+    WriteRow("Gather", "vertex", count, seconds, 0.0);
+    seconds = Best(repeat, [&]() { stream.Scatter(soaOutput.data()); });
+    WriteRow("Scatter", "vector3", count, seconds, 0.0);
+    ok = ok && MaxError(soaOutput, points) == 0.0;
+
+    // TransformPoints.
+    double aos = Best(repeat, [&]() { TransformPoints(world, points.data(), aosOutput.data(), count); });
+    WriteRow("TransformPoints", "aos", count, aos, aos);
+    stream.Gather(points.data(), count);
+    seconds = Best(repeat, [&]() { TransformPoints(world, stream, streamOutput); });
+    WriteRow("TransformPoints", "soa", count, seconds, aos);
+    seconds = Best(repeat, [&]() {
+        stream.Gather(points.data(), count);
+        TransformPoints(world, stream, streamOutput);
+        streamOutput.Scatter(soaOutput.data());
+    });
+    WriteRow("TransformPoints", "soa+copy", count, seconds, aos);
+    ok = ok && MaxError(soaOutput, aosOutput) <= 1e-6;
+
+    // TransformVectors.
+    aos = Best(repeat, [&]() { TransformVectors(world, points.data(), aosOutput.data(), count); });
+    WriteRow("TransformVectors", "aos", count, aos, aos);
+    seconds = Best(repeat, [&]() { TransformVectors(world, stream, streamOutput); });
+    WriteRow("TransformVectors", "soa", count, seconds, aos);
+    seconds = Best(repeat, [&]() {
+        stream.Gather(points.data(), count);
+        TransformVectors(world, stream, streamOutput);
+        streamOutput.Scatter(soaOutput.data());
+    });
+    WriteRow("TransformVectors", "soa+copy", count, seconds, aos);
+    ok = ok && MaxError(soaOutput, aosOutput) <= 1e-6;
+
+    // NormalizeVectors trabaja en su sitio: cada repetición vuelve a partir de los vectores originales.
+    aos = Best(repeat, [&]() { NormalizeVectors(points.data(), aosOutput.data(), count); });
+    WriteRow("NormalizeVectors", "aos", count, aos, aos);
+    seconds = Best(repeat, [&]() { stream.Gather(points.data(), count); }, [&]() { NormalizeVectors(stream); });
+    WriteRow("NormalizeVectors", "soa", count, seconds, aos);
+    seconds = Best(repeat, [&]() {
+        stream.Gather(points.data(), count);
+        NormalizeVectors(stream);
+        stream.Scatter(soaOutput.data());
+    });
+    WriteRow("NormalizeVectors", "soa+copy", count, seconds, aos);
+    ok = ok && MaxError(soaOutput, aosOutput) <= 1e-6;
+
+    // ComputeBounds no tiene kernel por lotes en VectorMath.h; la referencia es el bucle de Min y Max.
+    Vector3 aosMin, aosMax;
+    aos = Best(repeat, [&]() {
+        aosMin = points[0];
+        aosMax = points[0];
+        for (const Vector3& point : points)
+        {
+            aosMin = Min(aosMin, point);
+            aosMax = Max(aosMax, point);
+        }
+    });
+    WriteRow("ComputeBounds", "aos", count, aos, aos);
+    stream.Gather(points.data(), count);
+    Vector3 soaMin, soaMax;
+    seconds = Best(repeat, [&]() { ComputeBounds(stream, soaMin, soaMax); });
+    WriteRow("ComputeBounds", "soa", count, seconds, aos);
+    seconds = Best(repeat, [&]() {
+        stream.Gather(points.data(), count);
+        ComputeBounds(stream, soaMin, soaMax);
+    });
+    WriteRow("ComputeBounds", "soa+copy", count, seconds, aos);
+    ok = ok && soaMin == aosMin && soaMax == aosMax;
+
+    if (!ok)
+    {
+        std::cerr << "Los kernels SoA no coinciden con los de VectorMath.h\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,10 @@
+﻿/**
+ * @file pch.h
+ * @brief Cabecera precompilada mínima para compilar fuentes del motor fuera del proyecto UWP.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>